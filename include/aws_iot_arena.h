@@ -0,0 +1,120 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_arena.h
+ * @brief Bump allocator over caller-supplied memory
+ *
+ * An arena hands out aligned blocks from a single region of memory owned by the
+ * caller, typically a static array. Blocks are never freed individually, the whole arena
+ * is released at once with aws_iot_arena_reset. The SDK never calls malloc, the arena only
+ * lets the application decide how its memory is split between several clients.
+ *
+ * An arena is not thread safe. It is meant to be used while clients are being initialized.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_ARENA_H_
+#define AWS_IOT_SDK_SRC_IOT_ARENA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "aws_iot_error.h"
+
+#ifndef AWS_IOT_ARENA_ALIGNMENT
+#define AWS_IOT_ARENA_ALIGNMENT 8 ///< Alignment of every block taken from an arena, must be a power of two
+#endif
+
+/**
+ * @brief Arena state
+ *
+ * Set up with aws_iot_arena_init, the members should not be modified directly.
+ */
+typedef struct {
+	unsigned char *pBase; ///< Start of the memory region
+	size_t size; ///< Size of the memory region in bytes
+	size_t used; ///< Bytes handed out so far, including alignment padding
+} IoT_Arena_t;
+
+/**
+ * @brief Initialize an arena over a memory region
+ *
+ * @param pArena Arena to initialize
+ * @param pMemory Memory region, must stay valid for as long as any block from the arena is in use
+ * @param size Size of the memory region in bytes
+ *
+ * @return An IoT Error Type defining successful/failed initialization
+ */
+IoT_Error_t aws_iot_arena_init(IoT_Arena_t *pArena, void *pMemory, size_t size);
+
+/**
+ * @brief Take a block from the arena
+ *
+ * The returned block is aligned to AWS_IOT_ARENA_ALIGNMENT bytes.
+ *
+ * @param pArena Arena to allocate from
+ * @param size Size of the block in bytes
+ *
+ * @return Pointer to the block, NULL if the arena is exhausted or size is 0
+ */
+void *aws_iot_arena_alloc(IoT_Arena_t *pArena, size_t size);
+
+/**
+ * @brief Number of bytes still available in the arena
+ *
+ * A block of this size may not fit if the next free byte is not aligned.
+ *
+ * @param pArena Arena to query
+ *
+ * @return Remaining bytes, 0 if pArena is NULL
+ */
+size_t aws_iot_arena_remaining(const IoT_Arena_t *pArena);
+
+/**
+ * @brief Current position of the arena, for aws_iot_arena_rewind
+ *
+ * @param pArena Arena to query
+ *
+ * @return Bytes handed out so far, 0 if pArena is NULL
+ */
+size_t aws_iot_arena_mark(const IoT_Arena_t *pArena);
+
+/**
+ * @brief Release the blocks taken since aws_iot_arena_mark returned mark
+ *
+ * Used to give back the blocks of an initialization that failed half way.
+ *
+ * @param pArena Arena to rewind
+ * @param mark Value returned by aws_iot_arena_mark
+ */
+void aws_iot_arena_rewind(IoT_Arena_t *pArena, size_t mark);
+
+/**
+ * @brief Release every block taken from the arena
+ *
+ * Any client still using a block from the arena must have been disconnected and freed first.
+ *
+ * @param pArena Arena to reset
+ */
+void aws_iot_arena_reset(IoT_Arena_t *pArena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_ARENA_H_ */
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_cbor.h
+ * @brief CBOR encoding and decoding of jsonStruct_t fields
+ *
+ * Binary counterpart of the shadow JSON builder for telemetry topics that do not need JSON. The
+ * same jsonStruct_t descriptors are written as a CBOR map (RFC 8949) with the keys as text strings
+ * and read back from one. Nothing is allocated and no text is formatted or parsed with the C
+ * library, integers are written in the shortest form, a double that is exactly representable
+ * as a float is written as a float.
+ *
+ * Values are mapped as follows:
+ * - SHADOW_JSON_INT* and SHADOW_JSON_UINT*: unsigned or negative integers
+ * - SHADOW_JSON_FLOAT and SHADOW_JSON_DOUBLE: floating point, integers are accepted when decoding
+ * - SHADOW_JSON_BOOL: true or false
+ * - SHADOW_JSON_STRING: text string, pData is NUL terminated when encoding
+ * - SHADOW_JSON_OBJECT: pData holds dataLength bytes of an already encoded CBOR item, for
+ *   example a nested map, copied as is when encoding
+ *
+ * When decoding, strings and objects are not copied if pData is NULL, the callback of the field
+ * then sees them in place in the decoded buffer. Indefinite length items are not supported.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_CBOR_H_
+#define AWS_IOT_SDK_SRC_IOT_CBOR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aws_iot_error.h"
+#include "aws_iot_shadow_json_data.h"
+
+/**
+ * Deepest nesting of arrays, maps and tags skipped while decoding, deeper input is rejected.
+ */
+#ifndef AWS_IOT_CBOR_MAX_DEPTH
+#define AWS_IOT_CBOR_MAX_DEPTH 8
+#endif
+
+/**
+ * @brief Encode fields as a CBOR map
+ *
+ * This is a variadic function like aws_iot_shadow_add_reported, count is the number of
+ * jsonStruct_t pointers that follow.
+ *
+ * @param pBuffer Buffer the map is written to
+ * @param bufferLen Size of the buffer
+ * @param pEncodedLen Set to the length of the map
+ * @param count Number of jsonStruct_t pointers that follow
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR for a NULL argument, key or value, or MAX_SIZE_ERROR if
+ * the map does not fit in the buffer
+ */
+IoT_Error_t aws_iot_cbor_encode(unsigned char *pBuffer, size_t bufferLen, size_t *pEncodedLen, uint8_t count, ...);
+
+/**
+ * @brief Decode a CBOR map into fields
+ *
+ * Every entry of the map whose key matches the key of one of the fields is stored in pData,
+ * after which the callback of the field, if any, is called. For strings the callback gets the
+ * text, for all other types the encoded CBOR item. Entries without a matching field are skipped.
+ *
+ * @param pBuffer Encoded map
+ * @param bufferLen Length of the map
+ * @param count Number of jsonStruct_t pointers that follow
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR for a NULL argument or CBOR_ERROR if the data is not a
+ * well-formed map or a value does not fit the type or size of its field. Fields decoded before
+ * the error keep their new value.
+ */
+IoT_Error_t aws_iot_cbor_decode(const unsigned char *pBuffer, size_t bufferLen, uint8_t count, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_CBOR_H_ */
@@ -38,6 +38,8 @@ extern "C" {
  * Values greater than 0 are specific non-error return codes
  */
 typedef enum {
+	/** Returned by a network layer that staged the bytes of a write to be sent with its next batch */
+			NETWORK_SSL_WRITE_QUEUED = 7,
 	/** Returned when the Network physical layer is connected */
 			NETWORK_PHYSICAL_LAYER_CONNECTED = 6,
 	/** Returned when the Network is manually disconnected */
@@ -156,7 +158,27 @@ typedef enum {
 	/** Some limit has been exceeded, e.g. the maximum number of subscriptions has been reached */
 			LIMIT_EXCEEDED_ERROR = -51,
 	/** Invalid input topic type */
-			INVALID_TOPIC_TYPE_ERROR = -52
+			INVALID_TOPIC_TYPE_ERROR = -52,
+	/** Condition variable initialization failed */
+			CONDITION_INIT_ERROR = -53,
+	/** Condition variable wait request failed */
+			CONDITION_WAIT_ERROR = -54,
+	/** Condition variable signal or broadcast request failed */
+			CONDITION_SIGNAL_ERROR = -55,
+	/** Condition variable destroy failed */
+			CONDITION_DESTROY_ERROR = -56,
+	/** A wait on a condition variable, semaphore or event timed out */
+			THREAD_WAIT_TIMEOUT_ERROR = -57,
+	/** An arena did not have enough memory left for the requested block */
+			ARENA_EXHAUSTED_ERROR = -58,
+	/** MQTT 5.0: The server acknowledged a request with a reason code indicating a failure */
+			MQTT_REQUEST_REJECTED_ERROR = -59,
+	/** A payload codec could not encode an outgoing or decode an incoming message */
+			PAYLOAD_CODEC_ERROR = -60,
+	/** CBOR data is malformed or a value does not match the type of its field */
+			CBOR_ERROR = -61,
+	/** MQTT 5.0: The server closed the connection with a DISCONNECT, see aws_iot_mqtt_get_server_disconnect_reason */
+			MQTT_SERVER_DISCONNECTED_ERROR = -62
 } IoT_Error_t;
 
 #ifdef __cplusplus
@@ -205,6 +205,29 @@ IoT_Error_t parseStringValue(char *buf, size_t bufLen, const char *jsonString, j
  */
 jsmntok_t *findToken(const char *key, const char *jsonString, jsmntok_t *token);
 
+/**
+ * @brief          Tokenize a JSON document without the members with the given keys
+ *
+ * The members are skipped byte by byte before they reach the tokenizer, so their values take
+ * no tokens and the object that held them looks as if they were never there. Only keys of
+ * objects up to maxPruneDepth deep are pruned, the top level object is depth 1, so a key
+ * with the same name deeper in the document is kept.
+ *
+ * @param pParser		parser, initialized by this function
+ * @param jsonString	json string
+ * @param jsonLen		length of the json string
+ * @param pTokens		tokens to fill
+ * @param maxTokens		number of tokens
+ * @param ppPrunedKeys	keys of the members to leave out
+ * @param prunedKeyCount	number of keys
+ * @param maxPruneDepth	deepest object the keys are pruned in
+ *
+ * @return 				number of tokens or a negative jsmnerr like jsmn_parse
+ */
+int32_t parseJsonPruned(jsmn_parser *pParser, const char *jsonString, size_t jsonLen, jsmntok_t *pTokens,
+						uint32_t maxTokens, const char *const *ppPrunedKeys, uint32_t prunedKeyCount,
+						uint32_t maxPruneDepth);
+
 #ifdef __cplusplus
 }
 #endif
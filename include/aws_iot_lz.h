@@ -0,0 +1,105 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_lz.h
+ * @brief Small LZ77 compressor without heap use
+ *
+ * Compresses a buffer in one call into a caller-supplied output buffer. The only state is a hash
+ * table of 2^AWS_IOT_LZ_HASH_BITS positions in IoT_LZ_Context_t, the decompressor needs no state
+ * at all. Both sides can share a dictionary, typically a few hundred bytes of representative
+ * payloads, which lets the first bytes of a short message refer back to it.
+ *
+ * The output is a sequence of blocks of a token byte, literals and a back reference, the same
+ * layout as an LZ4 block: the high nibble of the token is the number of literals, the low nibble
+ * the match length minus 4, a nibble of 15 is continued in the following bytes, each 255 adds 255
+ * and the first byte below 255 ends the length. The literals are followed by a 2 byte
+ * little-endian distance back into the dictionary and the output. The last block has literals only.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_LZ_H_
+#define AWS_IOT_SDK_SRC_IOT_LZ_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aws_iot_error.h"
+
+/**
+ * Size of the hash table of the compressor as a power of two. Each entry takes 4 bytes, larger
+ * tables find more matches in long inputs.
+ */
+#ifndef AWS_IOT_LZ_HASH_BITS
+#define AWS_IOT_LZ_HASH_BITS 10
+#endif
+
+/**
+ * @brief Compressor state
+ *
+ * Only used during aws_iot_lz_compress, one context can be reused for any number of inputs but
+ * not by two threads at once.
+ */
+typedef struct {
+	uint32_t hashTable[1u << AWS_IOT_LZ_HASH_BITS]; ///< Last position of every hash of 4 bytes
+} IoT_LZ_Context_t;
+
+/**
+ * @brief Compress a buffer
+ *
+ * @param pContext Compressor state
+ * @param pDictionary Dictionary shared with the decompressor, NULL for none
+ * @param dictionaryLen Length of the dictionary, only the last 65535 bytes are used
+ * @param pIn Data to compress
+ * @param inLen Length of the data
+ * @param pOut Output buffer
+ * @param outLen Size of the output buffer
+ * @param pWrittenLen Set to the length of the compressed data
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR for invalid arguments or MAX_SIZE_ERROR if the compressed
+ * data does not fit in the output buffer
+ */
+IoT_Error_t aws_iot_lz_compress(IoT_LZ_Context_t *pContext, const unsigned char *pDictionary, size_t dictionaryLen,
+								const unsigned char *pIn, size_t inLen, unsigned char *pOut, size_t outLen,
+								size_t *pWrittenLen);
+
+/**
+ * @brief Decompress a buffer
+ *
+ * Safe on untrusted input, every length and distance is checked against the input, the
+ * dictionary and the output buffer.
+ *
+ * @param pDictionary Dictionary used to compress, NULL for none
+ * @param dictionaryLen Length of the dictionary
+ * @param pIn Compressed data
+ * @param inLen Length of the compressed data
+ * @param pOut Output buffer
+ * @param outLen Size of the output buffer
+ * @param pWrittenLen Set to the length of the decompressed data
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR for invalid arguments, MAX_SIZE_ERROR if the data does
+ * not fit in the output buffer or FAILURE for malformed input
+ */
+IoT_Error_t aws_iot_lz_decompress(const unsigned char *pDictionary, size_t dictionaryLen, const unsigned char *pIn,
+								  size_t inLen, unsigned char *pOut, size_t outLen, size_t *pWrittenLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_LZ_H_ */
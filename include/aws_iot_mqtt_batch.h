@@ -0,0 +1,156 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_mqtt_batch.h
+ * @brief Batching publisher for telemetry samples
+ *
+ * Packs many small samples into one PUBLISH on a fixed topic, so the MQTT header, the topic,
+ * the TLS record and for QoS1 the round trip to the server are paid once per batch instead of
+ * once per sample. Samples are copied into a buffer supplied by the caller, either as a JSON
+ * array of the samples or as records of a 2 byte big-endian length followed by the sample.
+ *
+ * A batch is published when the next sample does not fit, when it holds maxSamples samples or
+ * when its oldest sample is older than maxAge_ms. The age is only checked by
+ * aws_iot_mqtt_batch_poll, which is meant to be called next to aws_iot_mqtt_yield. A batch that
+ * could not be published, for example because the client is reconnecting, is kept and
+ * published by the first poll after the client is connected again. Call aws_iot_mqtt_batch_flush
+ * before disconnecting to publish the remaining samples.
+ *
+ * A batching publisher is not thread safe, append, poll and flush must be called from the
+ * same thread.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_MQTT_BATCH_H_
+#define AWS_IOT_SDK_SRC_IOT_MQTT_BATCH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aws_iot_error.h"
+#include "aws_iot_mqtt_client.h"
+#include "timer_interface.h"
+
+/**
+ * @brief Layout of the samples in a batch
+ */
+typedef enum {
+	BATCH_FORMAT_JSON_ARRAY = 0, ///< Samples are JSON values, the batch is "[s1,s2,...]"
+	BATCH_FORMAT_LENGTH_PREFIXED = 1 ///< Each sample is preceded by its length as a 2 byte big-endian integer
+} IoT_Batch_Format_t;
+
+/**
+ * @brief Batching publisher parameters
+ */
+typedef struct {
+	const char *pTopicName; ///< Topic the batches are published on, must stay valid
+	uint16_t topicNameLen; ///< Length of the topic
+	QoS qos; ///< QoS of the batches
+	IoT_Batch_Format_t format; ///< Layout of the samples
+	unsigned char *pBuffer; ///< Buffer the samples are packed into, must stay valid
+	size_t bufferLen; ///< Size of the buffer, bounds the payload of a batch
+	uint32_t maxSamples; ///< Publish once a batch holds this many samples, 0 for no limit
+	uint32_t maxAge_ms; ///< Publish once the oldest sample is this old, 0 for no limit
+} IoT_Batch_Publisher_Params;
+
+/**
+ * @brief Batching publisher state
+ *
+ * Set up with aws_iot_mqtt_batch_init, the members should not be modified directly.
+ */
+typedef struct {
+	AWS_IoT_Client *pClient; ///< Client the batches are published with
+	IoT_Batch_Publisher_Params params; ///< Copy of the parameters given at init
+	size_t len; ///< Bytes in the buffer
+	uint32_t sampleCount; ///< Samples in the buffer
+	bool isFlushPending; ///< A threshold was reached or a publish failed, publish on the next poll
+	Timer ageTimer; ///< Expires maxAge_ms after the first sample of the batch
+	uint32_t batchCount; ///< Batches published since init
+} IoT_Batch_Publisher_t;
+
+/**
+ * @brief Initialize a batching publisher
+ *
+ * The client must be initialized, it does not need to be connected yet. The buffer plus the
+ * topic and the packet headers must fit in the write buffer of the client.
+ *
+ * @param pBatch Batching publisher to initialize
+ * @param pClient Client the batches are published with
+ * @param pParams Parameters, copied
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR for invalid arguments or MAX_SIZE_ERROR if a full batch
+ * would not fit in the write buffer of the client
+ */
+IoT_Error_t aws_iot_mqtt_batch_init(IoT_Batch_Publisher_t *pBatch, AWS_IoT_Client *pClient,
+									const IoT_Batch_Publisher_Params *pParams);
+
+/**
+ * @brief Add a sample to the batch
+ *
+ * If the sample does not fit in the buffer the current batch is published first. Reaching
+ * maxSamples publishes the batch right away; if that fails the samples are kept and the
+ * publish is retried by the next append or poll. With MQTT 5.0 a batch is also kept within
+ * the Maximum Packet Size of the server.
+ *
+ * @param pBatch Batching publisher
+ * @param pSample Sample to copy into the batch, a JSON value for BATCH_FORMAT_JSON_ARRAY
+ * @param sampleLen Length of the sample
+ *
+ * @return SUCCESS if the sample was added. MAX_SIZE_ERROR if the sample is larger than a batch,
+ * or the error of the publish if the batch was full and could not be published; the sample was
+ * not added in both cases.
+ */
+IoT_Error_t aws_iot_mqtt_batch_append(IoT_Batch_Publisher_t *pBatch, const void *pSample, size_t sampleLen);
+
+/**
+ * @brief Publish the batch if it is due
+ *
+ * Publishes the batch if its oldest sample is older than maxAge_ms or if an earlier publish is
+ * pending and the client is connected. Does nothing while the client is disconnected.
+ *
+ * @param pBatch Batching publisher
+ *
+ * @return SUCCESS if nothing was due or the batch was published, otherwise the error of the
+ * publish. The samples are kept when the publish fails, except for MAX_SIZE_ERROR, see
+ * aws_iot_mqtt_batch_flush.
+ */
+IoT_Error_t aws_iot_mqtt_batch_poll(IoT_Batch_Publisher_t *pBatch);
+
+/**
+ * @brief Publish the batch now
+ *
+ * @param pBatch Batching publisher
+ *
+ * @return SUCCESS if the batch was published or was empty, otherwise the error of the publish.
+ * The samples are kept when the publish fails, except for MAX_SIZE_ERROR: the server lowered
+ * its Maximum Packet Size on a reconnect below the batch, which is dropped.
+ */
+IoT_Error_t aws_iot_mqtt_batch_flush(IoT_Batch_Publisher_t *pBatch);
+
+/**
+ * @brief Number of samples waiting in the batch
+ */
+uint32_t aws_iot_mqtt_batch_pending_samples(const IoT_Batch_Publisher_t *pBatch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_MQTT_BATCH_H_ */
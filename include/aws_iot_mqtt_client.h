@@ -52,6 +52,8 @@ extern "C" {
 /* AWS Specific header files */
 #include "aws_iot_error.h"
 #include "aws_iot_config.h"
+#include "aws_iot_arena.h"
+#include "aws_iot_pool.h"
 
 /* Platform specific implementation header files */
 #include "network_interface.h"
@@ -96,11 +98,14 @@ typedef struct {
 /**
  * @brief MQTT Version Type
  *
- * Defining an MQTT version type. Only 3.1.1 is supported at this time
+ * Defining an MQTT version type. With MQTT 5.0 the client sends its maximum packet size in
+ * CONNECT, takes the receive maximum, topic alias maximum, maximum packet size and keep alive
+ * of the server from CONNACK and replaces the topic of outgoing publishes with topic aliases.
  *
  */
 typedef enum {
-	MQTT_3_1_1 = 4    ///< MQTT 3.1.1 (protocol message byte = 4)
+	MQTT_3_1_1 = 4,    ///< MQTT 3.1.1 (protocol message byte = 4)
+	MQTT_5_0 = 5       ///< MQTT 5.0 (protocol message byte = 5)
 } MQTT_Ver_t;
 
 /**
@@ -183,15 +188,22 @@ typedef struct {
 #ifdef _ENABLE_THREAD_SUPPORT_
 	bool isBlockOnThreadLockEnabled;		///< Timeout for Thread blocking calls. Set to 0 to block until lock is obtained. In milliseconds
 #endif
+	unsigned char *pWriteBuf;			///< Buffer for outgoing data, NULL to take it from pBufferArena or use the built-in buffer
+	size_t writeBufLen;				///< Size of pWriteBuf, or of the block taken from pBufferArena
+	unsigned char *pReadBuf;			///< Buffer for incoming data, NULL to take it from pBufferArena or use the built-in buffer
+	size_t readBufLen;				///< Size of pReadBuf, or of the block taken from pBufferArena
+	IoT_Arena_t *pBufferArena;			///< Arena the buffers are taken from when no buffer is given, may be NULL
+	uint32_t maxSubscriptions;			///< Number of subscriptions the client can hold, 0 for AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS built-in handlers
+	IoT_Arena_t *pSubscriptionArena;		///< Arena the subscription store is taken from, required when maxSubscriptions is set
 } IoT_Client_Init_Params;
 /** Default initializer for client */
 extern const IoT_Client_Init_Params iotClientInitParamsDefault;
 
 /** Default initializer for client */
 #ifdef _ENABLE_THREAD_SUPPORT_
-#define IoT_Client_Init_Params_initializer { true, NULL, 0, NULL, NULL, NULL, 2000, 20000, 5000, true, NULL, NULL, false }
+#define IoT_Client_Init_Params_initializer { true, NULL, 0, NULL, NULL, NULL, 2000, 20000, 5000, true, NULL, NULL, false, NULL, 0, NULL, 0, NULL, 0, NULL }
 #else
-#define IoT_Client_Init_Params_initializer { true, NULL, 0, NULL, NULL, NULL, 2000, 20000, 5000, true, NULL, NULL }
+#define IoT_Client_Init_Params_initializer { true, NULL, 0, NULL, NULL, NULL, 2000, 20000, 5000, true, NULL, NULL, NULL, 0, NULL, 0, NULL, 0, NULL }
 #endif
 
 /**
@@ -243,11 +255,173 @@ typedef struct _MessageHandlers {
 	void *pApplicationHandlerData; ///< Context to pass to application handler
 } MessageHandlers;   /* Message handlers are indexed by subscription topic */
 
+/** Number of uint32_t links the subscription store keeps for every handler */
+#define AWS_IOT_MQTT_SUBSCRIPTION_LINKS_PER_HANDLER 4
+
+/**
+ * @brief MQTT Subscription Store
+ *
+ * Holds the message handlers of a client. Handler slots come from a pool, every handler is
+ * linked into a hash bucket chosen by its topic filter and filters with wildcards are also
+ * kept in a separate list. Adding, removing and finding a filter take constant time on
+ * average and an incoming message only has to be matched against the wildcard filters.
+ * Only accessed from the thread that owns the client state.
+ */
+typedef struct _SubscriptionStore {
+	IoT_Pool_t handlerPool; ///< Hands out free handler slots
+	MessageHandlers *pHandlers; ///< Handler slots, a slot is in use when its topicName is set
+	uint32_t *pBuckets; ///< First handler of every hash bucket
+	uint32_t *pChain; ///< Next handler in the same hash bucket
+	uint32_t *pWildcards; ///< Handlers whose filter contains + or #
+	uint32_t *pWildcardPos; ///< Position of every handler in pWildcards
+	uint32_t bucketMask; ///< Number of buckets minus one, the number of buckets is a power of two
+	uint32_t wildcardCount; ///< Number of entries in pWildcards, including removed ones
+	uint32_t wildcardsRemoved; ///< Entries of pWildcards removed during a match, compacted when it ends
+	uint32_t slotsRemoved; ///< Handler slots removed during a match, given back to the pool when it ends
+	uint32_t matchDepth; ///< Number of matches in progress
+	uint32_t count; ///< Number of handlers in use
+} SubscriptionStore;
+
+/**
+ * Number of topic aliases a client keeps for its outgoing publishes with MQTT 5.0. The client
+ * uses the smaller of this and the topic alias maximum of the server. Must be at least 1.
+ */
+#ifndef AWS_IOT_MQTT_MAX_TOPIC_ALIASES
+#define AWS_IOT_MQTT_MAX_TOPIC_ALIASES 8
+#endif
+
+/** Longest topic name that gets a topic alias, longer topics are always sent in full */
+#ifndef AWS_IOT_MQTT_TOPIC_ALIAS_MAX_TOPIC_LEN
+#define AWS_IOT_MQTT_TOPIC_ALIAS_MAX_TOPIC_LEN 64
+#endif
+
+/**
+ * @brief MQTT 5.0 Topic Alias
+ *
+ * A topic the server knows by its alias. The alias is the index of the entry plus one.
+ */
+typedef struct {
+	uint32_t lastUsed; ///< Value of the use counter when the alias was last sent, 0 if the alias is not assigned
+	uint16_t topicNameLen; ///< Length of topicName
+	char topicName[AWS_IOT_MQTT_TOPIC_ALIAS_MAX_TOPIC_LEN]; ///< Copy of the topic, not NUL terminated
+} TopicAlias;
+
+/**
+ * @brief MQTT 5.0 Topic Alias Table
+ *
+ * Maps the topics of outgoing publishes to topic aliases. When every alias is in use the least
+ * recently used one is given to the new topic. Reset on every connect, since aliases only last
+ * for one network connection. Only accessed while holding the write buffer.
+ */
+typedef struct _TopicAliasTable {
+	uint32_t useCounter; ///< Incremented whenever an alias is sent
+	uint16_t aliasCount; ///< Aliases usable on this connection
+	TopicAlias aliases[AWS_IOT_MQTT_MAX_TOPIC_ALIASES]; ///< Aliases 1 to aliasCount
+} TopicAliasTable;
+
+/**
+ * Number of topic filters that can have a payload codec, see aws_iot_mqtt_set_payload_codec.
+ */
+#ifndef AWS_IOT_MQTT_NUM_PAYLOAD_CODECS
+#define AWS_IOT_MQTT_NUM_PAYLOAD_CODECS 4
+#endif
+
+/**
+ * @brief Payload Codec
+ *
+ * Transforms the payload of every message on the topics it is registered for, for example to
+ * compress it. encode is called on the payload of an outgoing publish while the client holds the
+ * write buffer, decode on an incoming payload before it is delivered. Both write at most outLen
+ * bytes to pOut and set pWrittenLen. On any other result than SUCCESS the publish fails with
+ * PAYLOAD_CODEC_ERROR or the incoming message is dropped. See aws_iot_mqtt_payload_codec.h for the built-in LZ codec.
+ */
+typedef struct _IoT_Payload_Codec {
+	IoT_Error_t (*encode)(void *pContext, const unsigned char *pIn, size_t inLen, unsigned char *pOut,
+						  size_t outLen, size_t *pWrittenLen); ///< Transforms an outgoing payload
+	IoT_Error_t (*decode)(void *pContext, const unsigned char *pIn, size_t inLen, unsigned char *pOut,
+						  size_t outLen, size_t *pWrittenLen); ///< Restores an incoming payload
+	void *pContext; ///< Passed to encode and decode
+} IoT_Payload_Codec_t;
+
+/**
+ * @brief Payload codec of a topic filter
+ */
+typedef struct {
+	const char *pTopicFilter; ///< NUL terminated topic filter, may contain wildcards, NULL if the entry is unused
+	const IoT_Payload_Codec_t *pCodec; ///< Codec for payloads on matching topics
+} PayloadCodecFilter;
+
+/**
+ * Number of QoS 1 messages the duplicate window remembers, see aws_iot_mqtt_set_duplicate_suppression.
+ */
+#ifndef AWS_IOT_MQTT_DUPLICATE_WINDOW_LEN
+#define AWS_IOT_MQTT_DUPLICATE_WINDOW_LEN 16
+#endif
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+/**
+ * Number of QoS 1 publishes that can wait for their PUBACK at the same time, further
+ * publishers wait for a free entry until their command timeout. An MQTT 5 server with a
+ * smaller Receive Maximum lowers the limit for its connection.
+ */
+#ifndef AWS_IOT_MQTT_NUM_ACK_WAITERS
+#define AWS_IOT_MQTT_NUM_ACK_WAITERS 8
+#endif
+
+/**
+ * @brief QoS 1 Publish Waiting for its PUBACK
+ *
+ * With thread support QoS 1 publishes from several threads wait for their PUBACK at the same
+ * time. Whichever thread reads a PUBACK stores the result in the entry of its packet ID and sets
+ * the event. The event is also set when the waiting thread may become the one that reads.
+ */
+typedef struct _AckWaiter {
+	uint16_t packetId; ///< Packet ID of the publish, 0 if the entry is free
+	bool isAcked; ///< Whether the PUBACK arrived
+	IoT_Error_t rc; ///< Result of the PUBACK, valid once isAcked is set
+	IoT_Event_t event; ///< Wakes up the waiting thread
+} AckWaiter;
+#endif
+
+/**
+ * @brief Duplicate Suppression Counters
+ */
+typedef struct {
+	uint32_t duplicatesReceived; ///< QoS 1 messages received with the DUP flag set
+	uint32_t duplicatesSuppressed; ///< Duplicates that were acknowledged but not delivered again
+} IoT_Duplicate_Stats_t;
+
+/**
+ * @brief QoS 1 message in the duplicate window
+ */
+typedef struct {
+	uint32_t hash; ///< FNV-1a hash of the topic name and payload
+	uint16_t packetId; ///< Packet ID the message arrived with
+} DuplicateWindowEntry;
+
+/**
+ * @brief QoS 1 Duplicate Window
+ *
+ * The last AWS_IOT_MQTT_DUPLICATE_WINDOW_LEN QoS 1 messages delivered to the application. A
+ * message that arrives again with the DUP flag, the same packet ID and the same topic and payload
+ * is acknowledged but not delivered. The entries last as long as the session and are cleared when
+ * the server starts a new one. Only accessed from the thread that reads.
+ */
+typedef struct _DuplicateWindow {
+	bool isEnabled; ///< Whether duplicates are suppressed
+	uint32_t next; ///< Entry the next message is written to
+	uint32_t count; ///< Entries in use
+	DuplicateWindowEntry entries[AWS_IOT_MQTT_DUPLICATE_WINDOW_LEN]; ///< Recent messages, oldest replaced first
+	IoT_Duplicate_Stats_t stats; ///< Counters, kept when the window is cleared
+} DuplicateWindow;
+
 /**
  * @brief MQTT Client Status
  *
  * Defining a type for MQTT Client Status
  * Contains information about the state of the MQTT Client
+ * clientState and isPingOutstanding are shared between threads and must only be
+ * accessed through the client state APIs, which update them atomically.
  *
  */
 typedef struct _ClientStatus {
@@ -278,19 +452,48 @@ typedef struct _ClientData {
 	size_t writeBufSize; ///< Size of this client's outgoing data buffer
 	size_t readBufSize; ///< Size of this client's incoming data buffer
 	size_t readBufIndex; ///< Current offset into the incoming data buffer
-	unsigned char writeBuf[AWS_IOT_MQTT_TX_BUF_LEN]; ///< Buffer for outgoing data
-	unsigned char readBuf[AWS_IOT_MQTT_RX_BUF_LEN]; ///< Buffer for incoming data
+	unsigned char *writeBuf; ///< Buffer for outgoing data, set up by aws_iot_mqtt_init
+	unsigned char *readBuf; ///< Buffer for incoming data, set up by aws_iot_mqtt_init
+#ifndef DISABLE_IOT_MQTT_DEFAULT_BUFFERS
+	unsigned char defaultWriteBuf[AWS_IOT_MQTT_TX_BUF_LEN]; ///< Built-in outgoing buffer, used when none is given at init
+	unsigned char defaultReadBuf[AWS_IOT_MQTT_RX_BUF_LEN]; ///< Built-in incoming buffer, used when none is given at init
+#endif
 
 #ifdef _ENABLE_THREAD_SUPPORT_
 	bool isBlockOnThreadLockEnabled; ///< Whether to use nonblocking or blocking mutex APIs
-	IoT_Mutex_t state_change_mutex; ///< Mutex protecting the client's state machine
+	IoT_Mutex_t state_change_mutex; ///< Mutex protecting the client's state machine when atomics are unavailable
 	IoT_Mutex_t tls_read_mutex; ///< Mutex protecting incoming data
 	IoT_Mutex_t tls_write_mutex; ///< Mutex protecting outgoing data
+	IoT_Mutex_t ack_wait_mutex; ///< Mutex protecting ackWaiters
+	IoT_Semaphore_t ackWaiterSlots; ///< Counts the free entries of ackWaiters
+	uint32_t ackWaitersHeld; ///< Free entries of ackWaiters taken out of ackWaiterSlots for the Receive Maximum
+	uint32_t ackWaitersToHold; ///< Entries to take out of ackWaiterSlots for the Receive Maximum of the connection
+	AckWaiter ackWaiters[AWS_IOT_MQTT_NUM_ACK_WAITERS]; ///< QoS 1 publishes waiting for their PUBACK
+	IoT_Thread_Id_t callbackThread; ///< Thread that last called subscription handlers, protected by ack_wait_mutex
 #endif
 
 	IoT_Client_Connect_Params options; ///< Options passed when the client was initialized
 
-	MessageHandlers messageHandlers[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS]; ///< Callbacks for incoming messages
+	uint16_t serverReceiveMaximum; ///< MQTT 5.0: QoS 1 publishes the server accepts at a time, from CONNACK
+	uint32_t serverMaximumPacketSize; ///< MQTT 5.0: Largest packet the server accepts, 0 if it has no limit
+	uint8_t serverDisconnectReason; ///< MQTT 5.0: Reason code of the last DISCONNECT from the server, 0 if none
+	TopicAliasTable topicAliases; ///< MQTT 5.0: Topic aliases of outgoing publishes
+
+	PayloadCodecFilter payloadCodecs[AWS_IOT_MQTT_NUM_PAYLOAD_CODECS]; ///< Codecs by topic filter, the first match wins
+	IoT_Pool_t *pPayloadCodecPool; ///< Buffers for encoded and decoded payloads, NULL until set
+	uint32_t undecodablePayloadCount; ///< Incoming messages dropped because their codec could not decode them
+
+	DuplicateWindow duplicateWindow; ///< Recent QoS 1 messages, see aws_iot_mqtt_set_duplicate_suppression
+
+	IoT_Pool_t *pRxBufferPool; ///< Buffers for incoming packets that can be retained, NULL until set
+	unsigned char *pInitReadBuf; ///< Buffer set up by aws_iot_mqtt_init, used again when the pool is removed
+	size_t initReadBufSize; ///< Size of pInitReadBuf
+	bool isRxBufferRetainable; ///< A message in a pool buffer is being delivered and was not retained yet
+
+	SubscriptionStore subscriptions; ///< Callbacks for incoming messages, set up by aws_iot_mqtt_init
+	MessageHandlers defaultMessageHandlers[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS]; ///< Built-in handlers, used when maxSubscriptions is not set at init
+	uint32_t defaultSubscriptionLinks[AWS_IOT_MQTT_SUBSCRIPTION_LINKS_PER_HANDLER * AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS]; ///< Links for the built-in handlers
+	uint32_t defaultSubscriptionBuckets[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS]; ///< Hash buckets for the built-in handlers
 	iot_disconnect_handler disconnectHandler; ///< Callback when a disconnection is detected
 	void *disconnectHandlerData; ///< Context for disconnect handler
 } ClientData;
@@ -321,6 +524,10 @@ struct _Client {
  * @functionpage{aws_iot_mqtt_autoreconnect_set_status,mqtt,autoreconnect_set_status}
  * @functionpage{aws_iot_mqtt_get_network_disconnected_count,mqtt,get_network_disconnected_count}
  * @functionpage{aws_iot_mqtt_reset_network_disconnected_count,mqtt,reset_network_disconnected_count}
+ * @functionpage{aws_iot_mqtt_get_server_disconnect_reason,mqtt,get_server_disconnect_reason}
+ * @functionpage{aws_iot_mqtt_set_duplicate_suppression,mqtt,set_duplicate_suppression}
+ * @functionpage{aws_iot_mqtt_get_duplicate_stats,mqtt,get_duplicate_stats}
+ * @functionpage{aws_iot_mqtt_reset_duplicate_stats,mqtt,reset_duplicate_stats}
  */
 
 /**
@@ -483,6 +690,73 @@ uint32_t aws_iot_mqtt_get_network_disconnected_count(AWS_IoT_Client *pClient);
 void aws_iot_mqtt_reset_network_disconnected_count(AWS_IoT_Client *pClient);
 /* @[declare_mqtt_reset_network_disconnected_count] */
 
+/**
+ * @brief Get the reason code of the last DISCONNECT an MQTT 5.0 server sent.
+ *
+ * The server can close the connection with a DISCONNECT, for example when the same client ID
+ * connects again or the server shuts down. The client then closes the network and
+ * @ref mqtt_function_yield returns MQTT_SERVER_DISCONNECTED_ERROR, or starts a reconnect when
+ * auto-reconnect is enabled. The reason code is kept until the next successful connect, so it
+ * can be read from the disconnect handler.
+ *
+ * @param[in] pClient MQTT client context
+ *
+ * @return The reason code, MQTT v5.0 Specification 3.14.2.1, or 0 if the server did not send a
+ * DISCONNECT since the client connected.
+ */
+/* @[declare_mqtt_get_server_disconnect_reason] */
+uint8_t aws_iot_mqtt_get_server_disconnect_reason(AWS_IoT_Client *pClient);
+/* @[declare_mqtt_get_server_disconnect_reason] */
+
+/**
+ * @brief Enable or disable suppression of redelivered QoS 1 messages.
+ *
+ * The server sends a QoS 1 message again with the DUP flag when it did not get the PUBACK before
+ * the connection was lost and the client reconnects with a persistent session. With suppression enabled the client
+ * remembers the last AWS_IOT_MQTT_DUPLICATE_WINDOW_LEN QoS 1 messages it delivered and only
+ * acknowledges a redelivery that matches one of them, by packet ID, topic and payload, instead of
+ * calling the subscription handler again. A redelivery of an older message is delivered as before.
+ *
+ * @param[in] pClient MQTT client context
+ * @param[in] isEnabled Whether duplicates are suppressed, the window is cleared on every change
+ *
+ * @return Returns NULL_VALUE_ERROR if provided a bad parameter; otherwise, always
+ * returns SUCCESS.
+ *
+ * @warning Do not call this function if @ref mqtt_function_yield is in progress.
+ */
+/* @[declare_mqtt_set_duplicate_suppression] */
+IoT_Error_t aws_iot_mqtt_set_duplicate_suppression(AWS_IoT_Client *pClient, bool isEnabled);
+/* @[declare_mqtt_set_duplicate_suppression] */
+
+/**
+ * @brief Get the duplicate counters of an MQTT client context.
+ *
+ * @param[in] pClient MQTT client context
+ * @param[out] pStats Receives the QoS 1 duplicates received and suppressed since the client was
+ * created (or since the last call to @ref mqtt_function_reset_duplicate_stats). Duplicates are
+ * counted whether or not suppression is enabled.
+ *
+ * @return Returns NULL_VALUE_ERROR if provided a bad parameter; otherwise, always
+ * returns SUCCESS.
+ *
+ * @warning Do not call this function if @ref mqtt_function_yield is in progress.
+ */
+/* @[declare_mqtt_get_duplicate_stats] */
+IoT_Error_t aws_iot_mqtt_get_duplicate_stats(AWS_IoT_Client *pClient, IoT_Duplicate_Stats_t *pStats);
+/* @[declare_mqtt_get_duplicate_stats] */
+
+/**
+ * @brief Reset the duplicate counters of an MQTT client context to zero.
+ *
+ * @param[in] pClient MQTT client context
+ *
+ * @warning Do not call this function if @ref mqtt_function_yield is in progress.
+ */
+/* @[declare_mqtt_reset_duplicate_stats] */
+void aws_iot_mqtt_reset_duplicate_stats(AWS_IoT_Client *pClient);
+/* @[declare_mqtt_reset_duplicate_stats] */
+
 #ifdef __cplusplus
 }
 #endif
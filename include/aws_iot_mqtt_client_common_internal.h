@@ -104,20 +104,177 @@ unsigned char aws_iot_mqtt_internal_read_char(unsigned char **pptr);
 void aws_iot_mqtt_internal_write_char(unsigned char **pptr, unsigned char c);
 void aws_iot_mqtt_internal_write_utf8_string(unsigned char **pptr, const char *string, uint16_t stringLen);
 
+void aws_iot_mqtt_internal_write_uint_32(unsigned char **pptr, uint32_t anInt);
+
+/* MQTT 5.0 property identifiers the client uses, MQTT v5.0 Specification 2.2.2.2 */
+#define MQTT5_PROPERTY_SESSION_EXPIRY_INTERVAL 0x11 /**< Four byte integer */
+#define MQTT5_PROPERTY_SERVER_KEEP_ALIVE 0x13 /**< Two byte integer */
+#define MQTT5_PROPERTY_RECEIVE_MAXIMUM 0x21 /**< Two byte integer */
+#define MQTT5_PROPERTY_TOPIC_ALIAS_MAXIMUM 0x22 /**< Two byte integer */
+#define MQTT5_PROPERTY_TOPIC_ALIAS 0x23 /**< Two byte integer */
+#define MQTT5_PROPERTY_MAXIMUM_PACKET_SIZE 0x27 /**< Four byte integer */
+
+#define MQTT5_DEFAULT_RECEIVE_MAXIMUM 65535 /**< Receive maximum when the server does not send one */
+#define MQTT5_REASON_CODE_FAILURE 0x80 /**< Reason codes from this value on indicate a failure */
+#define MQTT5_REASON_CODE_MALFORMED_PACKET 0x81 /**< A packet could not be decoded */
+
+/**
+ * MQTT 5.0 properties of an incoming packet the client acts on. Every other property is skipped.
+ */
+typedef struct {
+	uint16_t receiveMaximum; ///< Receive Maximum, MQTT5_DEFAULT_RECEIVE_MAXIMUM when absent
+	uint16_t topicAliasMaximum; ///< Topic Alias Maximum, 0 when absent
+	uint16_t serverKeepAlive; ///< Server Keep Alive, only valid when isServerKeepAlivePresent is set
+	bool isServerKeepAlivePresent; ///< Whether Server Keep Alive was sent
+	uint32_t maximumPacketSize; ///< Maximum Packet Size, 0 when absent
+	uint16_t topicAlias; ///< Topic Alias, 0 when absent
+} MQTT5_Properties;
+
+IoT_Error_t aws_iot_mqtt_internal_read_properties(unsigned char **pptr, unsigned char *enddata,
+												  MQTT5_Properties *pProperties);
+
+bool aws_iot_mqtt_internal_is_topic_matched(char *pTopicFilter, char *pTopicName, uint16_t topicNameLen);
+
+/**
+ * Subscription store, see SubscriptionStore.
+ *
+ * A topic filter ends at its length or at the first NUL character, whichever comes first,
+ * the same way unsubscribe and wildcard matching have always treated it.
+ */
+typedef struct {
+	uint32_t next; ///< Next handler to check in the hash bucket
+	uint32_t wildcardPos; ///< Next wildcard filter to check
+} SubscriptionMatchCursor;
+
+IoT_Error_t aws_iot_mqtt_internal_subscription_store_init(SubscriptionStore *pStore, MessageHandlers *pHandlers,
+														  uint32_t capacity, uint32_t *pLinks,
+														  uint32_t *pBuckets, uint32_t bucketCount);
+IoT_Error_t aws_iot_mqtt_internal_subscription_store_init_from_arena(SubscriptionStore *pStore, IoT_Arena_t *pArena,
+																	 uint32_t capacity);
+uint32_t aws_iot_mqtt_internal_subscription_store_capacity(const SubscriptionStore *pStore);
+bool aws_iot_mqtt_internal_subscription_store_is_full(const SubscriptionStore *pStore);
+MessageHandlers *aws_iot_mqtt_internal_subscription_store_add(SubscriptionStore *pStore,
+															  const MessageHandlers *pHandler);
+MessageHandlers *aws_iot_mqtt_internal_subscription_store_find(const SubscriptionStore *pStore,
+															   const char *pTopicFilter, uint16_t topicFilterLen);
+uint32_t aws_iot_mqtt_internal_subscription_store_remove(SubscriptionStore *pStore, const char *pTopicFilter,
+														 uint16_t topicFilterLen);
+MessageHandlers *aws_iot_mqtt_internal_subscription_store_at(const SubscriptionStore *pStore, uint32_t index);
+void aws_iot_mqtt_internal_subscription_store_match_begin(SubscriptionStore *pStore, const char *pTopicName,
+														  uint16_t topicNameLen, SubscriptionMatchCursor *pCursor);
+MessageHandlers *aws_iot_mqtt_internal_subscription_store_match_next(const SubscriptionStore *pStore,
+																	 char *pTopicName, uint16_t topicNameLen,
+																	 SubscriptionMatchCursor *pCursor);
+void aws_iot_mqtt_internal_subscription_store_match_end(SubscriptionStore *pStore);
+
 IoT_Error_t aws_iot_mqtt_internal_flushBuffers( AWS_IoT_Client *pClient );
+IoT_Error_t aws_iot_mqtt_internal_lock_write_buffer(AWS_IoT_Client *pClient);
+IoT_Error_t aws_iot_mqtt_internal_unlock_write_buffer(AWS_IoT_Client *pClient);
+IoT_Error_t aws_iot_mqtt_internal_connect_network(AWS_IoT_Client *pClient);
+IoT_Error_t aws_iot_mqtt_internal_close_network(AWS_IoT_Client *pClient);
 IoT_Error_t aws_iot_mqtt_internal_send_packet(AWS_IoT_Client *pClient, size_t length, Timer *pTimer);
 IoT_Error_t aws_iot_mqtt_internal_cycle_read(AWS_IoT_Client *pClient, Timer *pTimer, uint8_t *pPacketType);
 IoT_Error_t aws_iot_mqtt_internal_wait_for_read(AWS_IoT_Client *pClient, uint8_t packetType, Timer *pTimer);
 IoT_Error_t aws_iot_mqtt_internal_serialize_zero(unsigned char *pTxBuf, size_t txBufLen,
 												 MessageTypes packetType, size_t *pSerializedLength);
+IoT_Error_t aws_iot_mqtt_internal_serialize_publish(unsigned char *pTxBuf, size_t txBufLen, uint8_t dup,
+													QoS qos, uint8_t retained, uint16_t packetId,
+													const char *pTopicName, uint16_t topicNameLen,
+													const unsigned char *pPayload, size_t payloadLen,
+													uint32_t *pSerializedLen);
 IoT_Error_t aws_iot_mqtt_internal_deserialize_publish(uint8_t *dup, QoS *qos,
 													  uint8_t *retained, uint16_t *pPacketId,
 													  char **pTopicName, uint16_t *topicNameLen,
 													  unsigned char **payload, size_t *payloadLen,
 													  unsigned char *pRxBuf, size_t rxBufLen);
+IoT_Error_t aws_iot_mqtt_internal_serialize_publish_v5(unsigned char *pTxBuf, size_t txBufLen, uint8_t dup,
+													   QoS qos, uint8_t retained, uint16_t packetId,
+													   const char *pTopicName, uint16_t topicNameLen,
+													   uint16_t topicAlias, const unsigned char *pPayload,
+													   size_t payloadLen, uint32_t *pSerializedLen);
+IoT_Error_t aws_iot_mqtt_internal_deserialize_publish_v5(uint8_t *dup, QoS *qos,
+														 uint8_t *retained, uint16_t *pPacketId,
+														 char **pTopicName, uint16_t *topicNameLen,
+														 unsigned char **payload, size_t *payloadLen,
+														 unsigned char *pRxBuf, size_t rxBufLen);
+IoT_Error_t aws_iot_mqtt_internal_deserialize_ack_v5(unsigned char *pPacketType, unsigned char *dup,
+													 uint16_t *pPacketId, unsigned char *pReasonCode,
+													 unsigned char *pRxBuf, size_t rxBufLen);
+IoT_Error_t aws_iot_mqtt_internal_deserialize_disconnect_v5(unsigned char *pReasonCode,
+															unsigned char *pRxBuf, size_t rxBufLen);
+IoT_Error_t aws_iot_mqtt_internal_deserialize_puback(AWS_IoT_Client *pClient, uint16_t *pPacketId);
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+/**
+ * QoS 1 publishes waiting for their PUBACK, see AckWaiter.
+ *
+ * add_ack_waiter takes a free entry for the packet ID, waiting for one until the timer expires,
+ * and must be called before the publish is sent. wait_for_ack returns the result of the PUBACK,
+ * reading from the network itself while no other thread does. remove_ack_waiter gives the entry
+ * back. wake_ack_waiters lets every waiting thread check the client state again.
+ * limit_ack_waiters keeps the entries in use within the Receive Maximum of the server.
+ */
+IoT_Error_t aws_iot_mqtt_internal_init_ack_waiters(AWS_IoT_Client *pClient);
+IoT_Error_t aws_iot_mqtt_internal_destroy_ack_waiters(AWS_IoT_Client *pClient);
+IoT_Error_t aws_iot_mqtt_internal_add_ack_waiter(AWS_IoT_Client *pClient, uint16_t packetId, Timer *pTimer,
+												 AckWaiter **ppWaiter);
+IoT_Error_t aws_iot_mqtt_internal_wait_for_ack(AWS_IoT_Client *pClient, AckWaiter *pWaiter, Timer *pTimer);
+void aws_iot_mqtt_internal_remove_ack_waiter(AWS_IoT_Client *pClient, AckWaiter *pWaiter);
+void aws_iot_mqtt_internal_wake_ack_waiters(AWS_IoT_Client *pClient);
+void aws_iot_mqtt_internal_limit_ack_waiters(AWS_IoT_Client *pClient, uint16_t receiveMaximum);
+#endif
+
+/**
+ * MQTT 5.0 topic aliases of outgoing publishes, see TopicAliasTable.
+ *
+ * get_topic_alias returns the alias to send with a publish on the given topic, 0 when the topic
+ * has to be sent without one. pIsAliasKnown is set when the server already knows the alias and
+ * the topic can be left out. Both must be called while holding the write buffer.
+ */
+void aws_iot_mqtt_internal_reset_topic_aliases(TopicAliasTable *pTable, uint16_t aliasCount);
+uint16_t aws_iot_mqtt_internal_get_topic_alias(TopicAliasTable *pTable, const char *pTopicName,
+											   uint16_t topicNameLen, bool *pIsAliasKnown);
+
+/**
+ * QoS 1 duplicate window, see DuplicateWindow.
+ *
+ * is_duplicate_publish counts a received message with the DUP flag and returns true when
+ * suppression is enabled and the message is in the window. Any other message is added to the
+ * window. reset_duplicate_window clears the entries, the setting and counters stay.
+ */
+void aws_iot_mqtt_internal_reset_duplicate_window(DuplicateWindow *pWindow);
+bool aws_iot_mqtt_internal_is_duplicate_publish(DuplicateWindow *pWindow, const IoT_Publish_Message_Params *pParams,
+												const char *pTopicName, uint16_t topicNameLen);
+
+/**
+ * Payload codec of a topic, NULL if it matches no filter set with aws_iot_mqtt_set_payload_codec.
+ */
+const IoT_Payload_Codec_t *aws_iot_mqtt_internal_find_payload_codec(AWS_IoT_Client *pClient, const char *pTopicName,
+																    uint16_t topicNameLen);
+
+/**
+ * Atomic access to the fields of ClientStatus that are shared between threads.
+ *
+ * With thread support enabled on GCC or Clang these map onto the __atomic builtins, which
+ * follow the C11 memory model without requiring the fields to be declared _Atomic (the client
+ * struct is also included from C++ and from C99 applications). Loads use acquire ordering and
+ * stores use release ordering so that a thread observing a new state also observes the writes
+ * made before the transition. Without thread support they compile down to plain accesses.
+ */
+#if defined(_ENABLE_THREAD_SUPPORT_) && (defined(__GNUC__) || defined(__clang__))
+#define AWS_IOT_MQTT_ATOMIC_STATE_SUPPORTED
+#define AWS_IOT_MQTT_ATOMIC_LOAD(pField) __atomic_load_n((pField), __ATOMIC_ACQUIRE)
+#define AWS_IOT_MQTT_ATOMIC_STORE(pField, value) __atomic_store_n((pField), (value), __ATOMIC_RELEASE)
+#define AWS_IOT_MQTT_ATOMIC_CAS(pField, pExpected, desired) \
+	__atomic_compare_exchange_n((pField), (pExpected), (desired), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#else
+#define AWS_IOT_MQTT_ATOMIC_LOAD(pField) (*(pField))
+#define AWS_IOT_MQTT_ATOMIC_STORE(pField, value) (*(pField) = (value))
+#endif
 
 IoT_Error_t aws_iot_mqtt_set_client_state(AWS_IoT_Client *pClient, ClientState expectedCurrentState,
 										  ClientState newState);
+void aws_iot_mqtt_force_client_state(AWS_IoT_Client *pClient, ClientState newState);
 
 #ifdef _ENABLE_THREAD_SUPPORT_
 
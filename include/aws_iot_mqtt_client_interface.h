@@ -81,6 +81,9 @@ extern "C" {
  * - @functionname{mqtt_function_autoreconnect_set_status}
  * - @functionname{mqtt_function_get_network_disconnected_count}
  * - @functionname{mqtt_function_reset_network_disconnected_count}
+ * - @functionname{mqtt_function_set_duplicate_suppression}
+ * - @functionname{mqtt_function_get_duplicate_stats}
+ * - @functionname{mqtt_function_reset_duplicate_stats}
  */
 
 /**
@@ -103,6 +106,14 @@ extern "C" {
  * a new MQTT client context. Once the client context is no longer needed,
  * @ref mqtt_function_free should be called.
  *
+ * The packet buffers are the ones given in pInitParams, blocks of the given sizes
+ * taken from pInitParams->pBufferArena, or the client's built-in buffers, in that order.
+ * Buffers given by the caller must stay valid until the client is freed.
+ *
+ * The client holds AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS subscriptions, or
+ * pInitParams->maxSubscriptions if set, in which case the subscription store is
+ * taken from pInitParams->pSubscriptionArena.
+ *
  * @param[in] pClient MQTT client context to initialize
  * @param[in] pInitParams The MQTT connection parameters
  *
@@ -154,6 +165,15 @@ IoT_Error_t aws_iot_mqtt_connect(AWS_IoT_Client *pClient, IoT_Client_Connect_Par
  * passed to the TLS layer. For a QoS 1 message, this function returns after the
  * receipt of the PUBACK for the transmitted message.
  *
+ * A QoS 0 publish only needs the write side of the connection, so it may be
+ * called from any thread while another thread is in @ref mqtt_function_yield.
+ * With the threading layer enabled a QoS 1 publish may be called from any
+ * thread as well. It waits until the thread that reads from the network hands
+ * over its PUBACK, and reads itself while no other thread does. Up to
+ * `AWS_IOT_MQTT_NUM_ACK_WAITERS` QoS 1 publishes wait at the same time.
+ * Without the threading layer a QoS 1 publish returns `MQTT_CLIENT_NOT_IDLE_ERROR`
+ * if another operation is reading from the network.
+ *
  * @param pClient MQTT client context
  * @param pTopicName Topic name to publish to
  * @param topicNameLen Length of the topic name
@@ -177,6 +197,11 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
  * @ref mqtt_function_yield must always be called regularly if any subscriptions
  * are active.
  *
+ * @note Unlike a publish, a subscribe changes the subscriptions the reading thread
+ * walks. It returns `MQTT_CLIENT_NOT_IDLE_ERROR` while another thread is in
+ * @ref mqtt_function_yield or otherwise reading from the network, also with the
+ * threading layer enabled. Call it from a subscription callback or retry it.
+ *
  * @param[in] pClient MQTT client context
  * @param[in] pTopicName Topic for subscription
  * @param[in] topicNameLen Length of topic
@@ -185,7 +210,8 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
  * on this subscription
  * @param[in] pApplicationHandlerData Data passed to the callback
  *
- * @return `IoT_Error_t`: See `aws_iot_error.h`
+ * @return `IoT_Error_t`: See `aws_iot_error.h`, MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR if the
+ * client already holds as many subscriptions as it was initialized for
  *
  * @attention The `pTopicName` parameter is not copied. It must remain valid for the duration
  * of the subscription (until @ref mqtt_function_unsubscribe) is called.
@@ -205,9 +231,13 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
  * @note This function does not need to be called after @ref mqtt_function_attempt_reconnect
  * or if auto-reconnect is enabled.
  *
+ * With MQTT 5, filters the server refuses with a SUBACK reason code are removed from the client
+ * and the other filters are still restored.
+ *
  * @param[in] pClient MQTT client context
  *
- * @return `IoT_Error_t`: See `aws_iot_error.h`
+ * @return `IoT_Error_t`: See `aws_iot_error.h`, `MQTT_REQUEST_REJECTED_ERROR` if the server
+ * refused a filter
  */
 /* @[declare_mqtt_resubscribe] */
 IoT_Error_t aws_iot_mqtt_resubscribe(AWS_IoT_Client *pClient);
@@ -220,6 +250,9 @@ IoT_Error_t aws_iot_mqtt_resubscribe(AWS_IoT_Client *pClient);
  * It sends an MQTT UNSUBSCRIBE packet to the server and removes the topic's message
  * handler stored by the client.
  *
+ * @note Like @ref mqtt_function_subscribe, this function returns `MQTT_CLIENT_NOT_IDLE_ERROR`
+ * while another thread is reading from the network, also with the threading layer enabled.
+ *
  * @param[in] pClient MQTT client context
  * @param[in] pTopicFilter Topic filter of the subscription to remove
  * @param[in] topicFilterLen Length of topic filter to remove
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_mqtt_connection_pool.h
+ * @brief Connection pool that shards topics across several MQTT connections
+ *
+ * One connection is limited by its TLS stream and by the throughput the server allows per
+ * connection. A connection pool owns several clients to the same server, each with its own
+ * client ID, and offers publish, subscribe and unsubscribe like a single client. Every topic
+ * belongs to one connection, chosen by a consistent hash of the topic name or filter, so
+ * messages on a topic keep their order and a subscription receives what is published through
+ * the pool on the same topic string. Growing the pool from N to N + 1 connections moves about
+ * 1 / (N + 1) of the topics, all of them to the new connection.
+ *
+ * The clients are connected, reconnected and yielded independently. A publish on a topic whose
+ * connection is down fails with the error of that client instead of moving to another
+ * connection, which would break the order of the topic. With auto reconnect enabled in the
+ * init parameters every client reconnects and resubscribes on its own.
+ *
+ * The pool adds no locking. With the threading layer enabled different threads can publish
+ * through the pool at the same time, a client only serializes the threads that use it. To use
+ * more than one core, yield every client from its own thread with
+ * aws_iot_mqtt_connection_pool_get_client instead of aws_iot_mqtt_connection_pool_yield.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_MQTT_CONNECTION_POOL_H_
+#define AWS_IOT_SDK_SRC_IOT_MQTT_CONNECTION_POOL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "aws_iot_error.h"
+#include "aws_iot_mqtt_client.h"
+
+/**
+ * Largest number of connections in a pool.
+ */
+#ifndef AWS_IOT_MQTT_POOL_MAX_CONNECTIONS
+#define AWS_IOT_MQTT_POOL_MAX_CONNECTIONS 8
+#endif
+
+/**
+ * Size of the client IDs of the connections, "<client ID>-<index>" and a terminating NUL.
+ */
+#ifndef AWS_IOT_MQTT_POOL_CLIENT_ID_LEN
+#define AWS_IOT_MQTT_POOL_CLIENT_ID_LEN 64
+#endif
+
+/**
+ * @brief Connection pool state
+ *
+ * Set up with aws_iot_mqtt_connection_pool_init, the members should not be modified directly.
+ */
+typedef struct {
+	AWS_IoT_Client *pClients; ///< Clients of the pool, one per connection
+	uint32_t clientCount; ///< Number of clients
+	char clientIds[AWS_IOT_MQTT_POOL_MAX_CONNECTIONS][AWS_IOT_MQTT_POOL_CLIENT_ID_LEN]; ///< Client IDs, referenced by the clients while connected
+} IoT_MQTT_Connection_Pool_t;
+
+/**
+ * @brief Initialize a connection pool
+ *
+ * Initializes every client with aws_iot_mqtt_init and the same parameters, so every client
+ * gets its own network connection to the same server. The parameters can't give the clients
+ * pWriteBuf or pReadBuf, which all clients would share; set pBufferArena to take separate
+ * buffers for each client instead.
+ *
+ * @param pPool Connection pool to initialize
+ * @param pClients Array of clientCount clients, must stay valid until aws_iot_mqtt_connection_pool_free
+ * @param clientCount Number of connections, 1 to AWS_IOT_MQTT_POOL_MAX_CONNECTIONS
+ * @param pInitParams Parameters for aws_iot_mqtt_init
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR for invalid arguments, including a pWriteBuf or pReadBuf,
+ * or the error of aws_iot_mqtt_init.
+ * Clients initialized before an error are freed again and their blocks of pBufferArena and
+ * pSubscriptionArena given back.
+ */
+IoT_Error_t aws_iot_mqtt_connection_pool_init(IoT_MQTT_Connection_Pool_t *pPool, AWS_IoT_Client *pClients,
+											  uint32_t clientCount, IoT_Client_Init_Params *pInitParams);
+
+/**
+ * @brief Connect every client that is not connected
+ *
+ * Connection i uses the client ID "<pClientID>-<i>", all other parameters are the same for every
+ * connection. A client that fails to connect does not stop the others, and calling this again
+ * only connects the clients that are still not connected.
+ *
+ * @param pPool Connection pool
+ * @param pConnectParams Parameters for aws_iot_mqtt_connect, pClientID is required
+ *
+ * @return SUCCESS if every client is connected, NULL_VALUE_ERROR for invalid arguments,
+ * MAX_SIZE_ERROR if a client ID does not fit in AWS_IOT_MQTT_POOL_CLIENT_ID_LEN, otherwise the
+ * error of the first client that failed to connect
+ */
+IoT_Error_t aws_iot_mqtt_connection_pool_connect(IoT_MQTT_Connection_Pool_t *pPool,
+												 IoT_Client_Connect_Params *pConnectParams);
+
+/**
+ * @brief Index of the connection a topic or topic filter belongs to
+ *
+ * @param pPool Connection pool
+ * @param pTopic Topic name or filter
+ * @param topicLen Length of the topic
+ *
+ * @return Index from 0 to the number of connections - 1
+ */
+uint32_t aws_iot_mqtt_connection_pool_route(const IoT_MQTT_Connection_Pool_t *pPool, const char *pTopic,
+											uint16_t topicLen);
+
+/**
+ * @brief Client of a connection
+ *
+ * @param pPool Connection pool
+ * @param index Index of the connection
+ *
+ * @return The client, or NULL if the index is out of range
+ */
+AWS_IoT_Client *aws_iot_mqtt_connection_pool_get_client(IoT_MQTT_Connection_Pool_t *pPool, uint32_t index);
+
+/**
+ * @brief Publish on the connection of the topic
+ *
+ * Same as aws_iot_mqtt_publish on the client aws_iot_mqtt_connection_pool_route selects.
+ *
+ * @return The result of aws_iot_mqtt_publish, NULL_VALUE_ERROR for invalid arguments
+ */
+IoT_Error_t aws_iot_mqtt_connection_pool_publish(IoT_MQTT_Connection_Pool_t *pPool, const char *pTopicName,
+												 uint16_t topicNameLen, IoT_Publish_Message_Params *pParams);
+
+/**
+ * @brief Subscribe on the connection of the topic filter
+ *
+ * Same as aws_iot_mqtt_subscribe on the client aws_iot_mqtt_connection_pool_route selects for the
+ * filter. The handler gets that client. The server delivers a matching message to every
+ * connection that subscribed the filter, whichever connection published it, so a filter
+ * subscribed once through the pool, wildcards included, receives all matching messages.
+ * Subscribing the same filter on more clients makes each message arrive once per client.
+ *
+ * @return The result of aws_iot_mqtt_subscribe, NULL_VALUE_ERROR for invalid arguments
+ */
+IoT_Error_t aws_iot_mqtt_connection_pool_subscribe(IoT_MQTT_Connection_Pool_t *pPool, const char *pTopicName,
+												   uint16_t topicNameLen, QoS qos,
+												   pApplicationHandler_t pApplicationHandler,
+												   void *pApplicationHandlerData);
+
+/**
+ * @brief Unsubscribe on the connection of the topic filter
+ *
+ * @return The result of aws_iot_mqtt_unsubscribe, NULL_VALUE_ERROR for invalid arguments
+ */
+IoT_Error_t aws_iot_mqtt_connection_pool_unsubscribe(IoT_MQTT_Connection_Pool_t *pPool, const char *pTopicFilter,
+													 uint16_t topicFilterLen);
+
+/**
+ * @brief Yield every client
+ *
+ * Yields the clients one after the other, each for an equal share of timeout_ms and at least
+ * 1 ms. Meant for single threaded applications, see the file description for more cores.
+ *
+ * @param pPool Connection pool
+ * @param timeout_ms Total time to yield
+ *
+ * @return SUCCESS if every yield succeeded, otherwise the result of the first client that did
+ * not return SUCCESS, for example NETWORK_ATTEMPTING_RECONNECT. Every client is yielded either way.
+ */
+IoT_Error_t aws_iot_mqtt_connection_pool_yield(IoT_MQTT_Connection_Pool_t *pPool, uint32_t timeout_ms);
+
+/**
+ * @brief Disconnect every connected client
+ *
+ * @return SUCCESS, or the error of the first client that failed to disconnect
+ */
+IoT_Error_t aws_iot_mqtt_connection_pool_disconnect(IoT_MQTT_Connection_Pool_t *pPool);
+
+/**
+ * @brief Free every client of the pool
+ *
+ * @return SUCCESS, or the error of the first client that could not be freed
+ */
+IoT_Error_t aws_iot_mqtt_connection_pool_free(IoT_MQTT_Connection_Pool_t *pPool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_MQTT_CONNECTION_POOL_H_ */
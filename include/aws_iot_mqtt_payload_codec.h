@@ -0,0 +1,127 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_mqtt_payload_codec.h
+ * @brief Per-topic payload codecs such as compression
+ *
+ * A codec registered for a topic filter encodes the payload of every publish on a matching
+ * topic before it is serialized, and decodes the payload of every incoming message on a matching
+ * topic before it is delivered to the subscription callbacks. Both peers must use the same codec
+ * on the same topics, the payload carries no marker the other side could detect it by.
+ *
+ * The encoded and decoded payloads are written to blocks of a pool set with
+ * aws_iot_mqtt_set_payload_codec_pool, one block per message for as long as the publish is
+ * serialized or the callbacks run. The block size bounds the payload after encoding and after
+ * decoding. A publish fails with LIMIT_EXCEEDED_ERROR when no block is free. An incoming QoS 1
+ * message is not acknowledged when no block is free. The server sends it again only after the
+ * client reconnects to a persistent session (isCleanSession false), with a clean session the
+ * message is lost, so size the pool for the messages in flight. A message whose payload the
+ * codec rejects is acknowledged and dropped, see aws_iot_mqtt_get_undecodable_payload_count.
+ *
+ * aws_iot_mqtt_lz_codec_init sets up the built-in codec based on aws_iot_lz.h, which needs no
+ * heap. Other compressors fit the same interface, for example zlib with a preset dictionary
+ * (deflateSetDictionary / inflateSetDictionary) or zstd with a trained dictionary
+ * (ZSTD_compress_usingCDict / ZSTD_decompress_usingDDict): encode and decode are called with the
+ * whole payload and a bounded output buffer, and pContext holds the compressor state.
+ *
+ * Codecs should be set before connecting. encode runs while the client holds the write buffer,
+ * decode in the thread calling aws_iot_mqtt_yield, so a codec whose encode and decode share
+ * state must protect it itself when publish and yield run in different threads.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_MQTT_PAYLOAD_CODEC_H_
+#define AWS_IOT_SDK_SRC_IOT_MQTT_PAYLOAD_CODEC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aws_iot_error.h"
+#include "aws_iot_lz.h"
+#include "aws_iot_mqtt_client.h"
+#include "aws_iot_pool.h"
+
+/**
+ * @brief State of the built-in LZ codec
+ *
+ * Encoded payloads start with one byte giving the method, 0 for a payload stored as is and 1
+ * for an aws_iot_lz block, followed by the data. Payloads that do not get smaller are stored.
+ */
+typedef struct {
+	IoT_LZ_Context_t lz; ///< Compressor state
+	const unsigned char *pDictionary; ///< Dictionary shared with the peer, NULL for none
+	size_t dictionaryLen; ///< Length of the dictionary
+} IoT_LZ_Codec_Context_t;
+
+/**
+ * @brief Set the pool the payload codecs write to
+ *
+ * @param pClient MQTT client
+ * @param pPool Pool of buffers, the block size bounds encoded and decoded payloads
+ *
+ * @return SUCCESS or NULL_VALUE_ERROR
+ */
+IoT_Error_t aws_iot_mqtt_set_payload_codec_pool(AWS_IoT_Client *pClient, IoT_Pool_t *pPool);
+
+/**
+ * @brief Set the codec for a topic filter
+ *
+ * A topic uses the codec of the first registered filter it matches. Setting a filter again
+ * replaces its codec, a NULL codec removes the filter.
+ *
+ * @param pClient MQTT client
+ * @param pTopicFilter NUL terminated topic filter, may contain wildcards, must stay valid
+ * @param pCodec Codec to use, must stay valid, NULL to remove the filter
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR for invalid arguments or if no pool is set, or
+ * LIMIT_EXCEEDED_ERROR if AWS_IOT_MQTT_NUM_PAYLOAD_CODECS filters are already set
+ */
+IoT_Error_t aws_iot_mqtt_set_payload_codec(AWS_IoT_Client *pClient, const char *pTopicFilter,
+										   const IoT_Payload_Codec_t *pCodec);
+
+/**
+ * @brief Number of incoming messages dropped because their codec could not decode them
+ *
+ * Such a message is acknowledged, a payload that can't be decoded would fail again on every
+ * redelivery. A rising count usually means the peer uses another codec or dictionary.
+ *
+ * @param pClient MQTT client
+ *
+ * @return Messages dropped since aws_iot_mqtt_init, 0 if pClient is NULL
+ */
+uint32_t aws_iot_mqtt_get_undecodable_payload_count(const AWS_IoT_Client *pClient);
+
+/**
+ * @brief Set up the built-in LZ codec
+ *
+ * @param pCodec Codec to set up
+ * @param pContext State of the codec, must stay valid as long as the codec is used
+ * @param pDictionary Dictionary shared with the peer, NULL for none, must stay valid
+ * @param dictionaryLen Length of the dictionary
+ *
+ * @return SUCCESS or NULL_VALUE_ERROR
+ */
+IoT_Error_t aws_iot_mqtt_lz_codec_init(IoT_Payload_Codec_t *pCodec, IoT_LZ_Codec_Context_t *pContext,
+									   const unsigned char *pDictionary, size_t dictionaryLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_MQTT_PAYLOAD_CODEC_H_ */
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_mqtt_rx_lease.h
+ * @brief Incoming messages that stay valid after the subscription callback
+ *
+ * The topic and payload given to a subscription callback point into the read buffer of the
+ * client and are overwritten by the next packet, so an application that handles messages in
+ * another thread has to copy them first. With a pool set by aws_iot_mqtt_set_rx_buffer_pool the
+ * client reads every packet into a block of the pool instead. A callback can retain the block
+ * of the message it was called for with aws_iot_mqtt_retain_rx_buffer; the client then reads
+ * the next packet into another block, and the topic and payload stay valid until the lease is
+ * released with aws_iot_mqtt_release_rx_buffer, from any thread.
+ *
+ * When every block is retained the client does not read from the network at all and the server
+ * is slowed down by TCP flow control. aws_iot_mqtt_yield still sends keep alive pings and
+ * returns LIMIT_EXCEEDED_ERROR, and so do calls waiting for an acknowledgement, until a lease is
+ * released. A PINGRESP is not read either, so leases should be released well within the keep
+ * alive interval. With thread support the pool must be lock-free (GCC or Clang) for leases to be
+ * released from other threads, see aws_iot_pool.h.
+ *
+ * The block size bounds the packets the client can receive, like the size of the read buffer.
+ * Messages whose payload was decoded by a payload codec are delivered from a codec block and
+ * cannot be retained.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_MQTT_RX_LEASE_H_
+#define AWS_IOT_SDK_SRC_IOT_MQTT_RX_LEASE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aws_iot_error.h"
+#include "aws_iot_mqtt_client.h"
+#include "aws_iot_pool.h"
+
+/**
+ * @brief Retained read buffer
+ *
+ * The topic name and payload of the message the buffer was retained for are valid until it is
+ * released.
+ */
+typedef struct {
+	void *pBlock; ///< Block of the RX buffer pool, NULL once released
+} IoT_Mqtt_Rx_Lease_t;
+
+/**
+ * @brief Set the pool incoming packets are read into
+ *
+ * Only while the client is not connected. The read buffer given to aws_iot_mqtt_init is not
+ * used while a pool is set; setting NULL goes back to it.
+ *
+ * @param pClient MQTT client
+ * @param pPool Pool of read buffers, NULL to remove the pool. Blocks retained from an earlier
+ * pool must be released before
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR or NETWORK_ALREADY_CONNECTED_ERROR
+ */
+IoT_Error_t aws_iot_mqtt_set_rx_buffer_pool(AWS_IoT_Client *pClient, IoT_Pool_t *pPool);
+
+/**
+ * @brief Keep the message being delivered after the callback returns
+ *
+ * Only from a subscription callback, once per message. Other callbacks matching the same
+ * message still see it, the lease covers them too.
+ *
+ * @param pClient MQTT client
+ * @param pLease Set to the retained buffer
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR, or FAILURE when no pool is set, outside of a callback,
+ * for a decoded payload or when the message was already retained
+ */
+IoT_Error_t aws_iot_mqtt_retain_rx_buffer(AWS_IoT_Client *pClient, IoT_Mqtt_Rx_Lease_t *pLease);
+
+/**
+ * @brief Give a retained buffer back to the client
+ *
+ * Can be called from any thread.
+ *
+ * @param pClient MQTT client the buffer was retained from
+ * @param pLease Lease set by aws_iot_mqtt_retain_rx_buffer, cleared
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR for a lease that was already released, or FAILURE if the
+ * block is not from the pool of the client
+ */
+IoT_Error_t aws_iot_mqtt_release_rx_buffer(AWS_IoT_Client *pClient, IoT_Mqtt_Rx_Lease_t *pLease);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_MQTT_RX_LEASE_H_ */
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_pool.h
+ * @brief Fixed-block pool allocator
+ *
+ * A pool manages a fixed number of equally sized blocks in memory supplied by the caller,
+ * either static arrays or blocks taken from an arena. Allocation and release take constant
+ * time and never fall back to the heap, so the number of records a component can hold is
+ * chosen at init time instead of at compile time.
+ *
+ * Free blocks are kept on a stack of indices that lives next to the blocks rather than inside
+ * them, so the content of a released block is left untouched and a caller can still scan all
+ * blocks for its own in-use marker. With thread support enabled on GCC or Clang, alloc and free
+ * are lock-free; the head of the stack carries a tag that is bumped on every update to rule out
+ * ABA races. Without atomics the pool is not thread safe.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_POOL_H_
+#define AWS_IOT_SDK_SRC_IOT_POOL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aws_iot_error.h"
+#include "aws_iot_arena.h"
+
+/**
+ * @brief Pool state
+ *
+ * Set up with aws_iot_pool_init or aws_iot_pool_init_from_arena, the members should not be
+ * modified directly.
+ */
+typedef struct {
+	unsigned char *pBlocks; ///< First block
+	uint32_t *pNext; ///< Free stack links, one per block
+	size_t blockSize; ///< Distance between two blocks in bytes
+	uint32_t blockCount; ///< Number of blocks
+	uint64_t freeHead; ///< Index of the first free block in the low 32 bits, update tag in the high 32 bits
+} IoT_Pool_t;
+
+/**
+ * @brief Initialize a pool over caller-supplied memory
+ *
+ * pBlocks is usually an array of the record type, which takes care of alignment.
+ *
+ * @param pPool Pool to initialize
+ * @param pBlocks Memory for blockCount blocks of blockSize bytes
+ * @param blockSize Size of a block in bytes
+ * @param blockCount Number of blocks
+ * @param pLinks Array of blockCount entries used for the free stack
+ *
+ * @return An IoT Error Type defining successful/failed initialization
+ */
+IoT_Error_t aws_iot_pool_init(IoT_Pool_t *pPool, void *pBlocks, size_t blockSize, uint32_t blockCount,
+							  uint32_t *pLinks);
+
+/**
+ * @brief Initialize a pool with memory taken from an arena
+ *
+ * The block size is rounded up to AWS_IOT_ARENA_ALIGNMENT.
+ *
+ * @param pPool Pool to initialize
+ * @param pArena Arena to take the blocks and the free stack from
+ * @param blockSize Size of a block in bytes
+ * @param blockCount Number of blocks
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR for invalid arguments or ARENA_EXHAUSTED_ERROR
+ */
+IoT_Error_t aws_iot_pool_init_from_arena(IoT_Pool_t *pPool, IoT_Arena_t *pArena, size_t blockSize,
+										 uint32_t blockCount);
+
+/**
+ * @brief Take a block from the pool
+ *
+ * The content of the block is whatever it was when it was last released.
+ *
+ * @param pPool Pool to allocate from
+ *
+ * @return Pointer to the block, NULL if every block is in use
+ */
+void *aws_iot_pool_alloc(IoT_Pool_t *pPool);
+
+/**
+ * @brief Return a block to the pool
+ *
+ * @param pPool Pool the block was taken from
+ * @param pBlock Block to release
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR for NULL arguments or FAILURE if pBlock was not
+ * taken from this pool or was already released
+ */
+IoT_Error_t aws_iot_pool_free(IoT_Pool_t *pPool, void *pBlock);
+
+/**
+ * @brief Return every block to the pool
+ *
+ * Not thread safe, no block may be in use by another thread while the pool is reset.
+ *
+ * @param pPool Pool to reset
+ */
+void aws_iot_pool_reset(IoT_Pool_t *pPool);
+
+/**
+ * @brief Number of blocks in the pool
+ */
+uint32_t aws_iot_pool_capacity(const IoT_Pool_t *pPool);
+
+/**
+ * @brief Number of free blocks
+ *
+ * Walks the free stack, so it takes time proportional to the number of free blocks. Only
+ * exact while no other thread uses the pool, meant for diagnostics and tests.
+ */
+uint32_t aws_iot_pool_available(IoT_Pool_t *pPool);
+
+/**
+ * @brief Block at a given index, whether it is in use or not
+ *
+ * @return Pointer to the block, NULL if index is out of range
+ */
+void *aws_iot_pool_block_at(const IoT_Pool_t *pPool, uint32_t index);
+
+/**
+ * @brief Index of a block, the inverse of aws_iot_pool_block_at
+ *
+ * @return Index of the block, aws_iot_pool_capacity if pBlock does not belong to the pool
+ */
+uint32_t aws_iot_pool_index_of(const IoT_Pool_t *pPool, const void *pBlock);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_POOL_H_ */
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_probes.h
+ * @brief Static tracepoints for profiling the SDK in production
+ *
+ * Built with ENABLE_IOT_PROBES the probes are USDT probes of the provider aws_iot, defined with
+ * sys/sdt.h from SystemTap, which bpftrace, perf and BCC can attach to. A probe nobody is attached
+ * to is a nop, but its arguments are still computed, which for a local or a field is a load. Every
+ * probe has a semaphore that the tracer increments while it is attached, IOT_PROBE_ENABLED reads
+ * it so arguments that take more work are only computed while somebody listens. Without
+ * ENABLE_IOT_PROBES the macros are empty, their arguments are not evaluated and IOT_PROBE_ENABLED
+ * is 0. The tracer timestamps every probe hit, latencies are measured by pairing two probes on the
+ * same packet ID or record index.
+ */
+
+#ifndef _IOT_PROBES_H
+#define _IOT_PROBES_H
+
+#ifdef ENABLE_IOT_PROBES
+
+#ifndef _SDT_HAS_SEMAPHORES
+#define _SDT_HAS_SEMAPHORES 1
+#endif
+#include <sys/sdt.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Every probe of the SDK. A new probe must be added here, sys/sdt.h refers to its semaphore.
+ */
+#define IOT_PROBE_LIST(X) \
+	X(packet_send_start) \
+	X(packet_send) \
+	X(packet_read) \
+	X(message_deliver) \
+	X(message_delivered) \
+	X(message_duplicate) \
+	X(keepalive_ping) \
+	X(keepalive_pong) \
+	X(keepalive_timeout) \
+	X(reconnect_attempt) \
+	X(reconnect_done) \
+	X(shadow_ack_wait) \
+	X(shadow_ack)
+
+/* The name sys/sdt.h expects, defined in aws_iot_mqtt_client_common_internal.c */
+#define IOT_PROBE_SEMAPHORE(name) aws_iot_##name##_semaphore
+#define IOT_PROBE_DECLARE_SEMAPHORE(name) extern volatile unsigned short IOT_PROBE_SEMAPHORE(name);
+IOT_PROBE_LIST(IOT_PROBE_DECLARE_SEMAPHORE)
+
+#ifdef __cplusplus
+}
+#endif
+
+#define IOT_PROBE_ENABLED(name) __builtin_expect(0 != IOT_PROBE_SEMAPHORE(name), 0)
+
+#define IOT_PROBE1(name, a1) DTRACE_PROBE1(aws_iot, name, a1)
+#define IOT_PROBE2(name, a1, a2) DTRACE_PROBE2(aws_iot, name, a1, a2)
+#define IOT_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(aws_iot, name, a1, a2, a3)
+#define IOT_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(aws_iot, name, a1, a2, a3, a4)
+
+#else
+
+#define IOT_PROBE_ENABLED(name) 0
+
+#define IOT_PROBE1(name, a1)
+#define IOT_PROBE2(name, a1, a2)
+#define IOT_PROBE3(name, a1, a2, a3)
+#define IOT_PROBE4(name, a1, a2, a3, a4)
+
+#endif
+
+#endif /* _IOT_PROBES_H */
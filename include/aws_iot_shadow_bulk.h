@@ -0,0 +1,207 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_shadow_bulk.h
+ * @brief Pipelined get, update and delete requests for the shadows of many things
+ *
+ * A gateway that syncs the shadows of its child devices with aws_iot_shadow_get and
+ * aws_iot_shadow_update makes one request at a time per thing, limited by
+ * MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME and MAX_THINGNAME_HANDLED_AT_ANY_GIVEN_TIME, and every
+ * request on a new thing subscribes to its accepted and rejected topics and waits for the
+ * subscription to settle first.
+ *
+ * A bulk sync takes a list of requests instead. It subscribes once to the accepted and rejected
+ * topics of every thing with a wildcard, "$aws/things/+/shadow/get/accepted" and so on for the
+ * actions in the list, and keeps up to windowSize requests in flight: a new request is sent as
+ * soon as a response arrives, from the subscription callback. Every request is reported once
+ * through the callback, when its response arrives or when it times out.
+ *
+ * Requests for the same thing and action are never in flight together, the later one waits
+ * until the earlier one completed. This keeps updates of one thing in the order of the list
+ * and lets responses be matched by thing and action, the client token only guards against a
+ * late response to a request that already timed out.
+ *
+ * The wildcard subscriptions also receive responses to requests made by other clients of the
+ * same account, the policy of the gateway should only allow the things it manages. A bulk sync
+ * is not thread safe and only one can be started on a client at a time.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_SHADOW_BULK_H_
+#define AWS_IOT_SDK_SRC_IOT_SHADOW_BULK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_error.h"
+#include "aws_iot_shadow_interface.h"
+#include "timer_interface.h"
+
+/** Largest window of requests in flight */
+#ifndef AWS_IOT_SHADOW_BULK_MAX_WINDOW
+#define AWS_IOT_SHADOW_BULK_MAX_WINDOW 32
+#endif
+
+/**
+ * @brief One request of a bulk sync
+ */
+typedef struct {
+	const char *pThingName; ///< Thing of the request, shorter than MAX_SIZE_OF_THING_NAME
+	ShadowActions_t action; ///< SHADOW_GET, SHADOW_UPDATE or SHADOW_DELETE
+	const char *pJsonDocument; ///< NUL terminated update document, see aws_iot_shadow_update. Not used for get and delete
+	void *pContext; ///< Passed to the callback
+} IoT_Shadow_Bulk_Request_t;
+
+/**
+ * @brief Called once for every request
+ *
+ * Called from aws_iot_shadow_yield or aws_iot_mqtt_yield for a response and from
+ * aws_iot_shadow_bulk_poll or aws_iot_shadow_bulk_stop for a timeout.
+ *
+ * @param requestIndex Index of the request in the list
+ * @param pRequest Request
+ * @param status SHADOW_ACK_ACCEPTED, SHADOW_ACK_REJECTED or SHADOW_ACK_TIMEOUT
+ * @param pReceivedJsonDocument Payload of the response, not NUL terminated. NULL for a timeout
+ * @param jsonLen Length of the payload
+ */
+typedef void (*fpShadowBulkCallback_t)(uint32_t requestIndex, const IoT_Shadow_Bulk_Request_t *pRequest,
+									   Shadow_Ack_Status_t status, const char *pReceivedJsonDocument, size_t jsonLen);
+
+/**
+ * @brief Bulk sync parameters
+ */
+typedef struct {
+	const IoT_Shadow_Bulk_Request_t *pRequests; ///< Requests, in the order they are sent. Must stay valid
+	uint32_t requestCount; ///< Number of requests
+	uint32_t windowSize; ///< Requests in flight at most, 1 to AWS_IOT_SHADOW_BULK_MAX_WINDOW
+	uint32_t timeout_ms; ///< Time to wait for the response to a request
+	fpShadowBulkCallback_t callback; ///< Called once for every request
+} IoT_Shadow_Bulk_Params;
+
+/**
+ * @brief Bulk sync counters
+ */
+typedef struct {
+	uint32_t sent; ///< Requests published
+	uint32_t accepted; ///< Requests completed with SHADOW_ACK_ACCEPTED
+	uint32_t rejected; ///< Requests completed with SHADOW_ACK_REJECTED
+	uint32_t timedOut; ///< Requests completed with SHADOW_ACK_TIMEOUT
+	uint32_t ignored; ///< Responses that matched no request in flight
+	uint32_t publishFailures; ///< Requests that could not be published and were retried
+} IoT_Shadow_Bulk_Stats_t;
+
+/**
+ * @brief Request in flight
+ */
+typedef struct {
+	bool isInFlight; ///< Slot holds a request waiting for its response
+	uint32_t requestIndex; ///< Index of the request
+	char clientToken[MAX_SIZE_CLIENT_ID_WITH_SEQUENCE]; ///< Client token of the request, empty if it had none
+	Timer timer; ///< Expires when the request times out
+} ShadowBulkSlot_t;
+
+/**
+ * @brief Bulk sync state
+ *
+ * Set up with aws_iot_shadow_bulk_init, the members should not be modified directly.
+ */
+typedef struct {
+	AWS_IoT_Client *pClient; ///< Client the requests are sent with
+	IoT_Shadow_Bulk_Params params; ///< Copy of the parameters given at init
+	uint8_t actionMask; ///< Bit (1 << action) for every action in the list
+	uint8_t subscribedMask; ///< Bit (1 << action) for every action subscribed to
+	uint32_t nextRequest; ///< Index of the next request to send
+	uint32_t inFlightCount; ///< Slots in use
+	uint32_t completedCount; ///< Requests reported through the callback
+	ShadowBulkSlot_t slots[AWS_IOT_SHADOW_BULK_MAX_WINDOW]; ///< Requests in flight
+	IoT_Shadow_Bulk_Stats_t stats; ///< Counters
+} IoT_Shadow_Bulk_t;
+
+/**
+ * @brief Set up a bulk sync
+ *
+ * Checks every request, nothing is sent yet.
+ *
+ * @param pBulk Bulk sync
+ * @param pClient Client, connected before aws_iot_shadow_bulk_start. The client tokens of get
+ * and delete requests are made from the client ID given to aws_iot_shadow_connect
+ * @param pParams Parameters, copied
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR for a missing argument, thing name or update document, or
+ * MAX_SIZE_ERROR for a window out of range or a thing name that is too long
+ */
+IoT_Error_t aws_iot_shadow_bulk_init(IoT_Shadow_Bulk_t *pBulk, AWS_IoT_Client *pClient,
+									 const IoT_Shadow_Bulk_Params *pParams);
+
+/**
+ * @brief Subscribe to the responses and send the first window of requests
+ *
+ * @param pBulk Bulk sync set up with aws_iot_shadow_bulk_init
+ *
+ * @return SUCCESS, the error of a subscription, after which nothing is subscribed, or the error
+ * of a publish, which is retried by aws_iot_shadow_bulk_poll
+ */
+IoT_Error_t aws_iot_shadow_bulk_start(IoT_Shadow_Bulk_t *pBulk);
+
+/**
+ * @brief Time out requests and fill the window
+ *
+ * Call after every yield. Requests are also sent when a response arrives, poll is needed for
+ * the timeouts and to retry requests that could not be published.
+ *
+ * @param pBulk Started bulk sync
+ *
+ * @return SUCCESS or the error of a publish
+ */
+IoT_Error_t aws_iot_shadow_bulk_poll(IoT_Shadow_Bulk_t *pBulk);
+
+/**
+ * @brief Whether every request was reported through the callback
+ *
+ * @param pBulk Bulk sync
+ */
+bool aws_iot_shadow_bulk_is_done(const IoT_Shadow_Bulk_t *pBulk);
+
+/**
+ * @brief Unsubscribe from the responses
+ *
+ * Requests still in flight are reported as timed out, requests that were not sent are not
+ * reported.
+ *
+ * @param pBulk Bulk sync
+ *
+ * @return SUCCESS or the error of the first unsubscribe that failed
+ */
+IoT_Error_t aws_iot_shadow_bulk_stop(IoT_Shadow_Bulk_t *pBulk);
+
+/**
+ * @brief Counters of a bulk sync
+ *
+ * @param pBulk Bulk sync
+ * @param pStats Set to the counters
+ */
+void aws_iot_shadow_bulk_get_stats(const IoT_Shadow_Bulk_t *pBulk, IoT_Shadow_Bulk_Stats_t *pStats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_SHADOW_BULK_H_ */
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_shadow_codegen.h
+ * @brief Support functions for encoders and decoders generated from a shadow schema
+ *
+ * tools/shadow_codegen/aws_iot_shadow_codegen.py turns a JSON Schema of the shadow state into a
+ * C struct with an encoder and a decoder for it. The generated code writes fixed key strings
+ * of known length and the values directly, without the type dispatch, key strlen and snprintf
+ * of jsonStruct_t, and finds the field of a received key with a perfect hash computed when the
+ * code was generated. The functions here are what the generated code has in common, they are
+ * not meant to be called by the application.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_SHADOW_CODEGEN_H_
+#define AWS_IOT_SDK_SRC_IOT_SHADOW_CODEGEN_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "jsmn.h"
+#include "aws_iot_error.h"
+
+/**
+ * @brief Output buffer of a generated encoder
+ *
+ * The first error is kept and later writes are ignored, so the generated code only checks
+ * the result once at the end.
+ */
+typedef struct {
+	char *pCursor; ///< Next byte to write
+	char *pEnd; ///< Last byte of the buffer, kept for the NUL
+	IoT_Error_t rc; ///< SUCCESS or SHADOW_JSON_BUFFER_TRUNCATED
+} ShadowCodegenWriter_t;
+
+/**
+ * @brief Slot of a generated perfect hash table
+ *
+ * Empty slots have a keyLen of 0.
+ */
+typedef struct {
+	const char *pKey; ///< Key of the field
+	uint16_t keyLen; ///< Length of the key
+	int16_t field; ///< Index of the field in its object
+} ShadowCodegenKey_t;
+
+/**
+ * @brief Start writing at an offset into a buffer
+ *
+ * @param pWriter Writer
+ * @param pBuffer Buffer
+ * @param offset Bytes of the buffer already used
+ * @param bufferLen Size of the buffer
+ */
+void aws_iot_shadow_codegen_writer_init(ShadowCodegenWriter_t *pWriter, char *pBuffer, size_t offset,
+										size_t bufferLen);
+
+/**
+ * @brief Write text of known length, such as a key with its quotes and colon
+ */
+void aws_iot_shadow_codegen_write(ShadowCodegenWriter_t *pWriter, const char *pText, size_t textLen);
+
+/** @brief Write a signed integer */
+void aws_iot_shadow_codegen_write_int32(ShadowCodegenWriter_t *pWriter, int32_t value);
+
+/** @brief Write an unsigned integer */
+void aws_iot_shadow_codegen_write_uint32(ShadowCodegenWriter_t *pWriter, uint32_t value);
+
+/** @brief Write a floating point number the way aws_iot_shadow_add_reported does, with "%f" */
+void aws_iot_shadow_codegen_write_double(ShadowCodegenWriter_t *pWriter, double value);
+
+/** @brief Write true or false */
+void aws_iot_shadow_codegen_write_bool(ShadowCodegenWriter_t *pWriter, bool value);
+
+/** @brief Write a NUL terminated string in quotes, it is not escaped */
+void aws_iot_shadow_codegen_write_string(ShadowCodegenWriter_t *pWriter, const char *pValue);
+
+/**
+ * @brief Close an object whose members were each written with a trailing comma
+ *
+ * The last comma becomes the closing brace, an object without members gets "}".
+ */
+void aws_iot_shadow_codegen_end_object(ShadowCodegenWriter_t *pWriter);
+
+/**
+ * @brief NUL terminate the output
+ *
+ * @param pWriter Writer
+ * @param pBuffer Buffer given to aws_iot_shadow_codegen_writer_init
+ * @param pLen Set to the length of the text in the buffer, may be NULL
+ *
+ * @return SUCCESS or SHADOW_JSON_BUFFER_TRUNCATED if the buffer was too small
+ */
+IoT_Error_t aws_iot_shadow_codegen_writer_finish(ShadowCodegenWriter_t *pWriter, const char *pBuffer, size_t *pLen);
+
+/**
+ * @brief Hash of a key, FNV-1a started from the seed
+ *
+ * The generator computes the same hash to pick a seed for which the keys of an object do not
+ * collide, so any change here has to be made in the generator too.
+ */
+uint32_t aws_iot_shadow_codegen_hash(uint32_t seed, const char *pKey, size_t keyLen);
+
+/**
+ * @brief Find the field of a key in a generated table
+ *
+ * The slot is the hash with its high half folded into the low half, masked.
+ *
+ * @param pTable Table of mask + 1 slots
+ * @param seed Seed of the table
+ * @param mask Number of slots minus one, the number of slots is a power of two
+ * @param pKey Key, not NUL terminated
+ * @param keyLen Length of the key
+ *
+ * @return Index of the field or -1 for a key that is not in the schema
+ */
+int32_t aws_iot_shadow_codegen_lookup(const ShadowCodegenKey_t *pTable, uint32_t seed, uint32_t mask,
+									  const char *pKey, size_t keyLen);
+
+/**
+ * @brief Tokenize a received document, leaving out the metadata
+ *
+ * @return Number of tokens or a negative jsmnerr
+ */
+int32_t aws_iot_shadow_codegen_parse(const char *pJsonDocument, size_t jsonLen, jsmntok_t *pTokens,
+									 uint32_t maxTokens);
+
+/**
+ * @brief Index of the token after the value at valueIndex and everything nested in it
+ */
+int32_t aws_iot_shadow_codegen_skip(const jsmntok_t *pTokens, int32_t tokenCount, int32_t valueIndex);
+
+/**
+ * @brief Find a member of an object
+ *
+ * @param pJsonDocument Document
+ * @param pTokens Tokens of the document
+ * @param tokenCount Number of tokens
+ * @param objectIndex Index of the object token
+ * @param pKey Key of the member
+ * @param keyLen Length of the key
+ *
+ * @return Index of the value token or -1 if the object has no such member or is not an object
+ */
+int32_t aws_iot_shadow_codegen_find_member(const char *pJsonDocument, const jsmntok_t *pTokens, int32_t tokenCount,
+										   int32_t objectIndex, const char *pKey, size_t keyLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_SHADOW_CODEGEN_H_ */
@@ -57,6 +57,9 @@ typedef struct {
 	char *pClientKey; ///< Location of Device private key
 	bool enableAutoReconnect;        ///< Set to true to enable auto reconnect
 	iot_disconnect_handler disconnectHandler;    ///< Callback to be invoked upon connection loss.
+	IoT_Arena_t *pRecordArena; ///< Arena for the pending ack records, NULL to use MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME built-in records. Every init takes new records unless isRecordArenaReused is set
+	uint32_t maxPendingAcks; ///< Number of actions that can wait for an ack at the same time when pRecordArena is set
+	bool isRecordArenaReused; ///< Reuse the records of the last successful init with the same pRecordArena and maxPendingAcks. Only set it if the arena has not been rewound or reset since
 } ShadowInitParameters_t;
 
 /*!
@@ -286,6 +289,21 @@ void aws_iot_shadow_enable_discard_old_delta_msgs(void);
  */
 void aws_iot_shadow_disable_discard_old_delta_msgs(void);
 
+/**
+ * @brief Leave the metadata of received documents out of the JSON tokens
+ *
+ * Responses and deltas carry a top level "metadata" object with a timestamp for every field of the state,
+ * which can take as many tokens as the state itself. With pruning, the default, the metadata is skipped
+ * before it is tokenized, so it neither counts against MAX_JSON_TOKEN_EXPECTED nor costs parsing time.
+ * Callbacks still get the complete document.
+ */
+void aws_iot_shadow_enable_metadata_pruning(void);
+
+/**
+ * @brief Tokenize the metadata of received documents like the rest of the document
+ */
+void aws_iot_shadow_disable_metadata_pruning(void);
+
 /**
  * @brief This function is used to enable or disable autoreconnect
  *
@@ -26,6 +26,8 @@ extern "C" {
 #include "aws_iot_error.h"
 #include "aws_iot_shadow_json_data.h"
 
+extern bool shadowPruneMetadataFlag;
+
 bool isJsonValidAndParse(const char *pJsonDocument, size_t jsonSize, void *pJsonHandler, int32_t *pTokenCount);
 
 bool isJsonKeyMatchingAndUpdateValue(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount,
@@ -26,6 +26,11 @@ extern "C" {
 #include "aws_iot_config.h"
 
 
+/**
+ * @brief Called with the raw payload of every update/delta message
+ */
+typedef void (*fpShadowDeltaObserver_t)(const char *pJsonDocument, size_t jsonLen, void *pContext);
+
 extern uint32_t shadowJsonVersionNum;
 extern bool shadowDiscardOldDeltaFlag;
 
@@ -34,19 +39,22 @@ extern uint16_t myThingNameLen;
 extern char mqttClientID[MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES];
 extern uint16_t mqttClientIDLen;
 
+IoT_Error_t initializeAckWaitList(IoT_Arena_t *pArena, uint32_t maxPendingAcks, bool isArenaReused);
 void initializeRecords(AWS_IoT_Client *pClient);
 bool isSubscriptionPresent(const char *pThingName, ShadowActions_t action);
 IoT_Error_t subscribeToShadowActionAcks(const char *pThingName, ShadowActions_t action, bool isSticky);
 void incrementSubscriptionCnt(const char *pThingName, ShadowActions_t action, bool isSticky);
 
 IoT_Error_t publishToShadowAction(const char *pThingName, ShadowActions_t action, const char *pJsonDocumentToBeSent);
-void addToAckWaitList(uint8_t indexAckWaitList, const char *pThingName, ShadowActions_t action,
+void addToAckWaitList(uint32_t indexAckWaitList, const char *pThingName, ShadowActions_t action,
 					  const char *pExtractedClientToken, fpActionCallback_t callback, void *pCallbackContext,
 					  uint32_t timeout_seconds);
-bool getNextFreeIndexOfAckWaitList(uint8_t *pIndex);
+bool reserveAckWaitListIndex(uint32_t *pIndex);
+void releaseAckWaitListIndex(uint32_t indexAckWaitList);
 void HandleExpiredResponseCallbacks(void);
 void initDeltaTokens(void);
 IoT_Error_t registerJsonTokenOnDelta(jsonStruct_t *pStruct);
+IoT_Error_t registerDeltaObserver(fpShadowDeltaObserver_t observer, void *pContext);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,285 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_shadow_replica.h
+ * @brief Local replica of the desired and reported state of the device shadow
+ *
+ * The replica keeps every leaf of the desired and reported sections of the shadow of the thing
+ * given to aws_iot_shadow_connect, with its path ("light.color") and its value as JSON text,
+ * together with the shadow version. It is kept up to date from the update/documents and
+ * update/delta topics, a full GET is only made when the replica is empty or a delta shows
+ * that updates were missed. The metadata of the shadow is never stored.
+ *
+ * All state lives in one block of memory given to aws_iot_shadow_replica_init. The block only
+ * holds offsets and a checksum, so it can be a file mapped with aws_iot_shadow_replica_map_file:
+ * after a reboot the replica is usable at once and the device only has to catch up. A block
+ * that was torn by a crash fails the checksum and is started empty.
+ *
+ * Updates are applied version by version:
+ * - update/documents carries the complete state after an update. It is applied when its version
+ *   is not older than the replica, only leaves that changed are reported.
+ * - update/delta carries the desired fields that differ from reported. It is merged into the
+ *   desired section when it is the next version, older deltas are dropped. A delta that skips
+ *   versions is merged as well but makes the next aws_iot_shadow_replica_sync do a GET.
+ * - get/accepted replaces the whole replica.
+ *
+ * Only one replica can be started, like the shadow client it is not thread safe.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_SHADOW_REPLICA_H_
+#define AWS_IOT_SDK_SRC_IOT_SHADOW_REPLICA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aws_iot_error.h"
+#include "aws_iot_mqtt_client_interface.h"
+
+/**
+ * Longest path of a leaf including the dots, for example "light.color". Longer leaves are
+ * not stored and make the message fail with MAX_SIZE_ERROR. At most 255.
+ */
+#ifndef AWS_IOT_SHADOW_REPLICA_MAX_PATH_LEN
+#define AWS_IOT_SHADOW_REPLICA_MAX_PATH_LEN 64
+#endif
+
+#if AWS_IOT_SHADOW_REPLICA_MAX_PATH_LEN > 255
+#error "AWS_IOT_SHADOW_REPLICA_MAX_PATH_LEN must be at most 255, a record stores the path length in one byte"
+#endif
+
+/**
+ * Number of JSON tokens a document may have. The metadata and the previous state of documents
+ * messages are skipped without using tokens, so this only has to cover the state.
+ */
+#ifndef AWS_IOT_SHADOW_REPLICA_MAX_JSON_TOKENS
+#define AWS_IOT_SHADOW_REPLICA_MAX_JSON_TOKENS 256
+#endif
+
+/** Seconds to wait for the response to the GET of a resync */
+#ifndef AWS_IOT_SHADOW_REPLICA_GET_TIMEOUT_SEC
+#define AWS_IOT_SHADOW_REPLICA_GET_TIMEOUT_SEC 10
+#endif
+
+/**
+ * @brief Section of the shadow state
+ */
+typedef enum {
+	SHADOW_REPLICA_DESIRED = 0,
+	SHADOW_REPLICA_REPORTED = 1
+} ShadowReplicaSection_t;
+
+/**
+ * @brief Called for every leaf that changed
+ *
+ * @param section Section of the leaf
+ * @param pPath NUL terminated path of the leaf
+ * @param pValue New value as JSON text, NUL terminated, NULL if the leaf was removed
+ * @param valueLen Length of the value
+ * @param pContext Context given to aws_iot_shadow_replica_init
+ */
+typedef void (*fpShadowReplicaChange_t)(ShadowReplicaSection_t section, const char *pPath, const char *pValue,
+										size_t valueLen, void *pContext);
+
+/**
+ * @brief Replica Counters
+ */
+typedef struct {
+	uint32_t fullGets; ///< GET requests made to resynchronize
+	uint32_t documentsApplied; ///< Full documents applied, from get/accepted or update/documents
+	uint32_t deltasApplied; ///< Delta messages merged
+	uint32_t staleDiscarded; ///< Messages dropped because the replica already had a newer version
+	uint32_t versionGaps; ///< Deltas that showed missed versions
+	uint32_t bytesReceived; ///< Payload bytes of all shadow messages handed to the replica
+} IoT_Shadow_Replica_Stats_t;
+
+/**
+ * @brief Shadow Replica
+ */
+typedef struct {
+	unsigned char *pStorage; ///< Block holding the leaves and the version
+	size_t storageLen; ///< Size of the block
+	fpShadowReplicaChange_t changeCallback; ///< Called for every leaf that changed, may be NULL
+	void *pChangeContext; ///< Passed to changeCallback
+	bool isWarmStart; ///< The block held a valid replica when it was initialized
+	bool isResyncNeeded; ///< The next aws_iot_shadow_replica_sync makes a GET
+	bool isGetPending; ///< A GET was made and its response has not arrived
+	IoT_Shadow_Replica_Stats_t stats; ///< Counters
+} IoT_Shadow_Replica_t;
+
+/**
+ * @brief Set up a replica in a block of memory
+ *
+ * A block that holds a valid replica is kept, anything else is formatted as an empty replica
+ * that needs a GET.
+ *
+ * @param pReplica Replica
+ * @param pStorage Block for the replica, at least 64 bytes and 4 byte aligned
+ * @param storageLen Size of the block
+ * @param changeCallback Called for every leaf that changed, may be NULL
+ * @param pChangeContext Passed to changeCallback
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR or MAX_SIZE_ERROR if the block is too small
+ */
+IoT_Error_t aws_iot_shadow_replica_init(IoT_Shadow_Replica_t *pReplica, void *pStorage, size_t storageLen,
+										fpShadowReplicaChange_t changeCallback, void *pChangeContext);
+
+/**
+ * @brief Start receiving updates
+ *
+ * Subscribes to update/documents and update/delta of the thing given to aws_iot_shadow_connect.
+ * The documents subscription is QoS 1, so with a persistent session updates made while the
+ * device was offline are delivered after the reconnect. With a clean session, which is what
+ * aws_iot_shadow_connect uses, a warm replica is checked with one GET; leaves that did not
+ * change are not reported again.
+ *
+ * @param pClient Client connected with aws_iot_shadow_connect
+ * @param pReplica Replica set up with aws_iot_shadow_replica_init
+ *
+ * @return SUCCESS or the error of the subscription
+ */
+IoT_Error_t aws_iot_shadow_replica_start(AWS_IoT_Client *pClient, IoT_Shadow_Replica_t *pReplica);
+
+/**
+ * @brief Make a GET if the replica needs one
+ *
+ * Call after aws_iot_shadow_yield. Does nothing unless the replica is empty, a version gap was
+ * seen or aws_iot_shadow_replica_request_resync was called, and no GET is pending.
+ *
+ * @param pClient Client connected with aws_iot_shadow_connect
+ * @param pReplica Started replica
+ *
+ * @return SUCCESS or the error of aws_iot_shadow_get
+ */
+IoT_Error_t aws_iot_shadow_replica_sync(AWS_IoT_Client *pClient, IoT_Shadow_Replica_t *pReplica);
+
+/**
+ * @brief Make the next aws_iot_shadow_replica_sync do a GET
+ *
+ * For example when the application knows it missed messages, such as after a reconnect with a
+ * clean session.
+ *
+ * @param pReplica Replica
+ */
+void aws_iot_shadow_replica_request_resync(IoT_Shadow_Replica_t *pReplica);
+
+/**
+ * @brief Whether the replica holds a shadow version and no GET is needed
+ *
+ * @param pReplica Replica
+ */
+bool aws_iot_shadow_replica_is_synchronized(const IoT_Shadow_Replica_t *pReplica);
+
+/**
+ * @brief Shadow version of the replica, 0 if it is empty
+ *
+ * @param pReplica Replica
+ */
+uint32_t aws_iot_shadow_replica_get_version(const IoT_Shadow_Replica_t *pReplica);
+
+/**
+ * @brief Look up a leaf
+ *
+ * @param pReplica Replica
+ * @param section Section of the leaf
+ * @param pPath Path of the leaf, for example "light.color"
+ * @param ppValue Set to the JSON text of the value, NUL terminated, valid until the replica changes
+ * @param pValueLen Set to the length of the value, may be NULL
+ *
+ * @return true if the leaf exists
+ */
+bool aws_iot_shadow_replica_get_value(const IoT_Shadow_Replica_t *pReplica, ShadowReplicaSection_t section,
+									  const char *pPath, const char **ppValue, size_t *pValueLen);
+
+/**
+ * @brief Apply a get/accepted document, replacing the replica
+ *
+ * @param pReplica Replica
+ * @param pJsonDocument Document
+ * @param jsonLen Length of the document
+ *
+ * @return SUCCESS, JSON_PARSE_ERROR, MAX_SIZE_ERROR for a leaf with a long path or
+ * LIMIT_EXCEEDED_ERROR if the block is full. After an error the replica needs a GET.
+ */
+IoT_Error_t aws_iot_shadow_replica_apply_full(IoT_Shadow_Replica_t *pReplica, const char *pJsonDocument,
+											  size_t jsonLen);
+
+/**
+ * @brief Apply an update/documents message
+ *
+ * @return As aws_iot_shadow_replica_apply_full, SUCCESS for a message that was dropped as stale
+ */
+IoT_Error_t aws_iot_shadow_replica_apply_documents(IoT_Shadow_Replica_t *pReplica, const char *pJsonDocument,
+												   size_t jsonLen);
+
+/**
+ * @brief Apply an update/delta message
+ *
+ * @return As aws_iot_shadow_replica_apply_full, SUCCESS for a message that was dropped as stale
+ */
+IoT_Error_t aws_iot_shadow_replica_apply_delta(IoT_Shadow_Replica_t *pReplica, const char *pJsonDocument,
+											   size_t jsonLen);
+
+/**
+ * @brief Counters of the replica
+ *
+ * @param pReplica Replica
+ * @param pStats Set to the counters
+ */
+void aws_iot_shadow_replica_get_stats(const IoT_Shadow_Replica_t *pReplica, IoT_Shadow_Replica_Stats_t *pStats);
+
+/**
+ * @brief Map a file as the block of a replica
+ *
+ * Provided by the platform, see platform/linux/common/shadow_replica_file.c. The file is
+ * created or resized to storageLen bytes and mapped shared, so every change of the replica is
+ * in the page cache at once and survives the process.
+ *
+ * @param pPath File name
+ * @param storageLen Size of the block
+ * @param ppStorage Set to the mapped block
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR or FAILURE if the file can't be opened or mapped
+ */
+IoT_Error_t aws_iot_shadow_replica_map_file(const char *pPath, size_t storageLen, void **ppStorage);
+
+/**
+ * @brief Write the mapped block to the file, for example before a planned power off
+ *
+ * @param pStorage Block from aws_iot_shadow_replica_map_file
+ * @param storageLen Size of the block
+ *
+ * @return SUCCESS or FAILURE
+ */
+IoT_Error_t aws_iot_shadow_replica_flush_file(void *pStorage, size_t storageLen);
+
+/**
+ * @brief Unmap a block from aws_iot_shadow_replica_map_file
+ *
+ * @param pStorage Block from aws_iot_shadow_replica_map_file
+ * @param storageLen Size of the block
+ */
+void aws_iot_shadow_replica_unmap_file(void *pStorage, size_t storageLen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_SHADOW_REPLICA_H_ */
@@ -116,7 +116,9 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *TLSParams);
  * @param integer - number of bytes to write
  * @param Timer * - operation timer
  * @return integer - number of bytes written or TLS error
- * @return IoT_Error_t - successful write or TLS error code
+ * @return IoT_Error_t - successful write or TLS error code. A layer that sends in batches returns
+ * NETWORK_SSL_WRITE_QUEUED once it holds the bytes that are not sent yet, the number of bytes
+ * written then counts only the ones already sent.
  */
 IoT_Error_t iot_tls_write(Network *, unsigned char *, size_t, Timer *, size_t *);
 
@@ -129,6 +131,10 @@ IoT_Error_t iot_tls_write(Network *, unsigned char *, size_t, Timer *, size_t *)
  * @param Timer * - operation timer
  * @param size_t - pointer to store number of bytes read
  * @return IoT_Error_t - successful read or TLS error code
+ *
+ * With _ENABLE_THREAD_SUPPORT_ one thread reads while another writes on the same Network.
+ * A port must allow this or serialize read and write internally, the client only keeps
+ * two readers or two writers apart.
  */
 IoT_Error_t iot_tls_read(Network *, unsigned char *, size_t, Timer *, size_t *);
 
@@ -36,6 +36,8 @@ extern "C" {
  */
 #include "threads_platform.h"
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <aws_iot_error.h>
 
 /**
@@ -76,7 +78,8 @@ IoT_Error_t aws_iot_thread_mutex_lock(IoT_Mutex_t *);
  * This is not a blocking call.
  *
  * @param IoT_Mutex_t - pointer to the mutex to be locked
- * @return IoT_Error_t - error code indicating result of operation
+ * @return IoT_Error_t - error code indicating result of operation, MUTEX_LOCK_ERROR only if another
+ * thread holds the mutex, another error if the mutex could not be locked for any other reason
  */
 IoT_Error_t aws_iot_thread_mutex_trylock(IoT_Mutex_t *);
 
@@ -100,6 +103,203 @@ IoT_Error_t aws_iot_thread_mutex_unlock(IoT_Mutex_t *);
  */
 IoT_Error_t aws_iot_thread_mutex_destroy(IoT_Mutex_t *);
 
+/**
+ * @brief Condition Variable Type
+ *
+ * Forward declaration of a condition variable struct.  The definition of this struct is
+ * platform dependent.  When porting to a new platform add this definition
+ * in "threads_platform.h".
+ *
+ */
+typedef struct _IoT_Cond_t IoT_Cond_t;
+
+/**
+ * @brief Initialize the provided condition variable
+ *
+ * Call this function to initialize the condition variable
+ *
+ * @param IoT_Cond_t - pointer to the condition variable to be initialized
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_cond_init(IoT_Cond_t *);
+
+/**
+ * @brief Wait on the provided condition variable
+ *
+ * The mutex must be locked by the caller. It is released while waiting and locked
+ * again before this function returns. This is a blocking call.
+ *
+ * @param IoT_Cond_t - pointer to the condition variable to wait on
+ * @param IoT_Mutex_t - pointer to the mutex protecting the condition
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_cond_wait(IoT_Cond_t *, IoT_Mutex_t *);
+
+/**
+ * @brief Wait on the provided condition variable with a timeout
+ *
+ * Same as aws_iot_thread_cond_wait but returns THREAD_WAIT_TIMEOUT_ERROR if the
+ * condition variable was not signaled within the timeout.
+ *
+ * @param IoT_Cond_t - pointer to the condition variable to wait on
+ * @param IoT_Mutex_t - pointer to the mutex protecting the condition
+ * @param uint32_t - maximum time to wait in milliseconds
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_cond_timedwait(IoT_Cond_t *, IoT_Mutex_t *, uint32_t);
+
+/**
+ * @brief Wake up one thread waiting on the provided condition variable
+ *
+ * @param IoT_Cond_t - pointer to the condition variable to be signaled
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_cond_signal(IoT_Cond_t *);
+
+/**
+ * @brief Wake up all threads waiting on the provided condition variable
+ *
+ * @param IoT_Cond_t - pointer to the condition variable to be signaled
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_cond_broadcast(IoT_Cond_t *);
+
+/**
+ * @brief Destroy the provided condition variable
+ *
+ * @param IoT_Cond_t - pointer to the condition variable to be destroyed
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_cond_destroy(IoT_Cond_t *);
+
+/**
+ * @brief Semaphore Type
+ *
+ * Forward declaration of a counting semaphore struct.  The definition of this struct is
+ * platform dependent.  When porting to a new platform add this definition
+ * in "threads_platform.h".
+ *
+ */
+typedef struct _IoT_Semaphore_t IoT_Semaphore_t;
+
+/**
+ * @brief Initialize the provided semaphore
+ *
+ * @param IoT_Semaphore_t - pointer to the semaphore to be initialized
+ * @param uint32_t - initial count of the semaphore
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_semaphore_init(IoT_Semaphore_t *, uint32_t);
+
+/**
+ * @brief Take the provided semaphore
+ *
+ * Decrements the count of the semaphore, waiting up to the timeout for it to become
+ * non-zero. A timeout of 0 does not block.
+ *
+ * @param IoT_Semaphore_t - pointer to the semaphore to be taken
+ * @param uint32_t - maximum time to wait in milliseconds
+ * @return IoT_Error_t - error code indicating result of operation, THREAD_WAIT_TIMEOUT_ERROR if the count stayed at zero
+ */
+IoT_Error_t aws_iot_thread_semaphore_wait(IoT_Semaphore_t *, uint32_t);
+
+/**
+ * @brief Give the provided semaphore
+ *
+ * Increments the count of the semaphore and wakes up one waiting thread.
+ *
+ * @param IoT_Semaphore_t - pointer to the semaphore to be given
+ * @return IoT_Error_t - error code indicating result of operation, LIMIT_EXCEEDED_ERROR if the count is at UINT32_MAX
+ */
+IoT_Error_t aws_iot_thread_semaphore_post(IoT_Semaphore_t *);
+
+/**
+ * @brief Destroy the provided semaphore
+ *
+ * @param IoT_Semaphore_t - pointer to the semaphore to be destroyed
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_semaphore_destroy(IoT_Semaphore_t *);
+
+/**
+ * @brief Event Type
+ *
+ * Forward declaration of an event struct.  An event is a flag that threads can wait on.
+ * Once set it stays set, releasing all current and future waiters, until it is cleared.
+ * The definition of this struct is platform dependent.  When porting to a new platform
+ * add this definition in "threads_platform.h".
+ *
+ */
+typedef struct _IoT_Event_t IoT_Event_t;
+
+/**
+ * @brief Initialize the provided event in the cleared state
+ *
+ * @param IoT_Event_t - pointer to the event to be initialized
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_event_init(IoT_Event_t *);
+
+/**
+ * @brief Wait for the provided event to be set
+ *
+ * A timeout of 0 does not block.
+ *
+ * @param IoT_Event_t - pointer to the event to wait on
+ * @param uint32_t - maximum time to wait in milliseconds
+ * @return IoT_Error_t - error code indicating result of operation, THREAD_WAIT_TIMEOUT_ERROR if the event was not set
+ */
+IoT_Error_t aws_iot_thread_event_wait(IoT_Event_t *, uint32_t);
+
+/**
+ * @brief Set the provided event and wake up all waiting threads
+ *
+ * @param IoT_Event_t - pointer to the event to be set
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_event_set(IoT_Event_t *);
+
+/**
+ * @brief Clear the provided event
+ *
+ * @param IoT_Event_t - pointer to the event to be cleared
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_event_clear(IoT_Event_t *);
+
+/**
+ * @brief Destroy the provided event
+ *
+ * @param IoT_Event_t - pointer to the event to be destroyed
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_event_destroy(IoT_Event_t *);
+
+/**
+ * @brief Thread ID Type
+ *
+ * Forward declaration of a thread ID struct, which identifies a running thread.
+ * The definition of this struct is platform dependent.  When porting to a new platform
+ * add this definition in "threads_platform.h".
+ *
+ */
+typedef struct _IoT_Thread_Id_t IoT_Thread_Id_t;
+
+/**
+ * @brief Get the ID of the calling thread
+ *
+ * @param IoT_Thread_Id_t - pointer to the thread ID to be set
+ */
+void aws_iot_thread_id_get_current(IoT_Thread_Id_t *);
+
+/**
+ * @brief Check whether a thread ID is the one of the calling thread
+ *
+ * @param IoT_Thread_Id_t - pointer to a thread ID set by aws_iot_thread_id_get_current
+ * @return bool - true if the ID is the one of the calling thread
+ */
+bool aws_iot_thread_id_is_current(const IoT_Thread_Id_t *);
+
 #ifdef __cplusplus
 }
 #endif
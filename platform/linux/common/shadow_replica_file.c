@@ -0,0 +1,79 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file shadow_replica_file.c
+ * @brief Linux implementation of the file backed block of the shadow replica.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "aws_iot_shadow_replica.h"
+
+IoT_Error_t aws_iot_shadow_replica_map_file(const char *pPath, size_t storageLen, void **ppStorage) {
+	struct stat fileStat;
+	void *pStorage;
+	int fd;
+
+	if(NULL == pPath || NULL == ppStorage) {
+		return NULL_VALUE_ERROR;
+	}
+
+	fd = open(pPath, O_RDWR | O_CREAT, 0600);
+	if(0 > fd) {
+		return FAILURE;
+	}
+
+	/* A file of another size can't hold a replica of this size, aws_iot_shadow_replica_init formats it */
+	if(0 != fstat(fd, &fileStat) ||
+	   ((size_t) fileStat.st_size != storageLen && 0 != ftruncate(fd, (off_t) storageLen))) {
+		close(fd);
+		return FAILURE;
+	}
+
+	pStorage = mmap(NULL, storageLen, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(MAP_FAILED == pStorage) {
+		return FAILURE;
+	}
+
+	*ppStorage = pStorage;
+	return SUCCESS;
+}
+
+IoT_Error_t aws_iot_shadow_replica_flush_file(void *pStorage, size_t storageLen) {
+	if(NULL == pStorage) {
+		return NULL_VALUE_ERROR;
+	}
+
+	return (0 == msync(pStorage, storageLen, MS_SYNC)) ? SUCCESS : FAILURE;
+}
+
+void aws_iot_shadow_replica_unmap_file(void *pStorage, size_t storageLen) {
+	if(NULL != pStorage) {
+		(void) munmap(pStorage, storageLen);
+	}
+}
+
+#ifdef __cplusplus
+}
+#endif
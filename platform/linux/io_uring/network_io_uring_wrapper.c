@@ -0,0 +1,1023 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file network_io_uring_wrapper.c
+ * @brief Network layer for many connections on one io_uring
+ *
+ * All connections share one ring, driven by whichever connection is read or written. Every
+ * connection always has a receive in flight into its staging buffer, so a read is a copy as
+ * long as data has arrived. A write copies into the send staging buffer and returns
+ * NETWORK_SSL_WRITE_QUEUED, it only waits if the buffer is full. The staged sends of all
+ * connections are submitted with one io_uring_enter the next time any connection reads, or on
+ * iot_uring_flush. written_len counts only bytes the kernel has reported sent, a send that
+ * fails makes the next write of the connection fail. The staging buffers are registered with
+ * the ring, which saves mapping them for every operation.
+ *
+ * TLS is done by mbedTLS on top of the staging buffers, the send and receive callbacks given
+ * to mbedtls_ssl_set_bio copy records in and out of them. DISABLE_IOT_URING_TLS builds the
+ * layer as plain TCP, for a local broker or a TLS terminating proxy.
+ *
+ * The ring is not locked, all clients using this layer must be driven from one thread. Needs
+ * Linux 5.11 or later.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <errno.h>
+#include <netdb.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include "aws_iot_error.h"
+#include "aws_iot_log.h"
+#include "network_interface.h"
+
+/* Longest wait for queued sends when disconnecting */
+#define IOT_URING_DISCONNECT_TIMEOUT_MS 100
+
+/* Longest wait of the mbedTLS callbacks for a send to complete, and the read timeout after the handshake */
+#define IOT_URING_TLS_WAIT_MS 10
+
+#define IOT_URING_OP_SEND 1ULL
+
+typedef enum {
+	IOT_URING_SLOT_FREE = 0,
+	IOT_URING_SLOT_OPEN,
+	IOT_URING_SLOT_CLOSING ///< Waiting for its operations to complete before the slot can be reused
+} IoT_Uring_Slot_State_t;
+
+typedef struct {
+	int fd;
+	IoT_Uring_Slot_State_t state;
+	bool isRxPending;
+	bool isRxClosed; ///< End of stream or receive error
+	bool isTxFailed;
+	bool isTxDirty; ///< In the list of connections with unsubmitted data
+	uint32_t rxStart;
+	uint32_t rxEnd;
+	uint32_t txLen; ///< Bytes in the send staging buffer, including the ones in flight
+	uint32_t txInFlight;
+} IoT_Uring_Connection_t;
+
+typedef struct {
+	int ringFd;
+	bool isInitialized;
+	bool isFixed; ///< Staging buffers are registered
+	unsigned sqEntries;
+	unsigned sqTail;
+	unsigned toSubmit;
+	unsigned *pSqHead;
+	unsigned *pSqTail;
+	unsigned sqMask;
+	struct io_uring_sqe *pSqes;
+	unsigned *pCqHead;
+	unsigned *pCqTail;
+	unsigned cqMask;
+	struct io_uring_cqe *pCqes;
+	IoT_Uring_Stats_t stats;
+} IoT_Uring_t;
+
+static IoT_Uring_t ring = { .ringFd = -1 };
+static IoT_Uring_Connection_t connections[IOT_URING_MAX_CONNECTIONS];
+static uint32_t dirtyConnections[IOT_URING_MAX_CONNECTIONS];
+static uint32_t dirtyCount;
+/* [connection][0] receives, [connection][1] sends */
+static unsigned char stagingBuffers[IOT_URING_MAX_CONNECTIONS][2][IOT_URING_BUFFER_LEN];
+
+static unsigned char *_iot_uring_rx_buf(uint32_t index) {
+	return stagingBuffers[index][0];
+}
+
+static unsigned char *_iot_uring_tx_buf(uint32_t index) {
+	return stagingBuffers[index][1];
+}
+
+static IoT_Error_t _iot_uring_setup(void) {
+	struct io_uring_params params;
+	struct iovec iov;
+	size_t sqRingSize, cqRingSize;
+	unsigned char *pSqRing, *pCqRing;
+	unsigned *pArray;
+	unsigned i;
+	int fd;
+
+	if(ring.isInitialized) {
+		return SUCCESS;
+	}
+
+	memset(&params, 0, sizeof(params));
+	fd = (int) syscall(__NR_io_uring_setup, IOT_URING_ENTRIES, &params);
+	if(0 > fd) {
+		IOT_ERROR("io_uring_setup failed: %d", errno);
+		return NETWORK_ERR_NET_SOCKET_FAILED;
+	}
+	if(0 == (params.features & IORING_FEAT_SINGLE_MMAP) || 0 == (params.features & IORING_FEAT_EXT_ARG)) {
+		IOT_ERROR("io_uring of this kernel is too old");
+		close(fd);
+		return NETWORK_ERR_NET_SOCKET_FAILED;
+	}
+
+	sqRingSize = params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+	cqRingSize = params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+	if(cqRingSize > sqRingSize) {
+		sqRingSize = cqRingSize;
+	}
+	pSqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if(MAP_FAILED == pSqRing) {
+		close(fd);
+		return NETWORK_ERR_NET_SOCKET_FAILED;
+	}
+	pCqRing = pSqRing;
+	ring.pSqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+					  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if(MAP_FAILED == ring.pSqes) {
+		munmap(pSqRing, sqRingSize);
+		close(fd);
+		return NETWORK_ERR_NET_SOCKET_FAILED;
+	}
+
+	ring.pSqHead = (unsigned *) (pSqRing + params.sq_off.head);
+	ring.pSqTail = (unsigned *) (pSqRing + params.sq_off.tail);
+	ring.sqMask = *(unsigned *) (pSqRing + params.sq_off.ring_mask);
+	ring.sqEntries = params.sq_entries;
+	ring.sqTail = *ring.pSqTail;
+	/* Submission queue entries are used in order, the index array never changes */
+	pArray = (unsigned *) (pSqRing + params.sq_off.array);
+	for(i = 0; i < params.sq_entries; i++) {
+		pArray[i] = i;
+	}
+	ring.pCqHead = (unsigned *) (pCqRing + params.cq_off.head);
+	ring.pCqTail = (unsigned *) (pCqRing + params.cq_off.tail);
+	ring.cqMask = *(unsigned *) (pCqRing + params.cq_off.ring_mask);
+	ring.pCqes = (struct io_uring_cqe *) (pCqRing + params.cq_off.cqes);
+
+	/* One block for all staging buffers, plain reads and writes are used if it cannot be pinned */
+	iov.iov_base = stagingBuffers;
+	iov.iov_len = sizeof(stagingBuffers);
+	ring.isFixed = (0 == syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, &iov, 1));
+	if(!ring.isFixed) {
+		IOT_WARN("Staging buffers not registered with io_uring: %d", errno);
+	}
+
+	for(i = 0; i < IOT_URING_MAX_CONNECTIONS; i++) {
+		connections[i].fd = -1;
+		connections[i].state = IOT_URING_SLOT_FREE;
+	}
+
+	ring.ringFd = fd;
+	ring.isInitialized = true;
+
+	return SUCCESS;
+}
+
+/* NULL if the submission queue is full even after submitting */
+static struct io_uring_sqe *_iot_uring_get_sqe(void);
+
+/* Adds the connection to the ones whose staged bytes are submitted the next time the ring is entered */
+static void _iot_uring_mark_dirty(uint32_t index) {
+	if(!connections[index].isTxDirty) {
+		connections[index].isTxDirty = true;
+		dirtyConnections[dirtyCount++] = index;
+	}
+}
+
+static void _iot_uring_queue(uint32_t index, bool isSend) {
+	IoT_Uring_Connection_t *pConn = &connections[index];
+	struct io_uring_sqe *pSqe = _iot_uring_get_sqe();
+	unsigned char *pBuf;
+	uint32_t len;
+
+	if(NULL == pSqe) {
+		if(isSend) {
+			/* Tried again with the next batch, a receive is posted again by the next read */
+			_iot_uring_mark_dirty(index);
+		}
+		return;
+	}
+
+	if(isSend) {
+		pBuf = _iot_uring_tx_buf(index);
+		len = pConn->txLen;
+		pConn->txInFlight = len;
+		pSqe->opcode = ring.isFixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+		ring.stats.sends++;
+	} else {
+		pBuf = _iot_uring_rx_buf(index) + pConn->rxEnd;
+		len = IOT_URING_BUFFER_LEN - pConn->rxEnd;
+		pConn->isRxPending = true;
+		pSqe->opcode = ring.isFixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+		ring.stats.receives++;
+	}
+
+	pSqe->fd = pConn->fd;
+	pSqe->addr = (uint64_t) (uintptr_t) pBuf;
+	pSqe->len = len;
+	pSqe->buf_index = 0;
+	pSqe->user_data = ((uint64_t) index << 1) | (isSend ? IOT_URING_OP_SEND : 0);
+
+	ring.sqTail++;
+	__atomic_store_n(ring.pSqTail, ring.sqTail, __ATOMIC_RELEASE);
+	ring.toSubmit++;
+}
+
+static void _iot_uring_queue_recv(uint32_t index) {
+	IoT_Uring_Connection_t *pConn = &connections[index];
+
+	if(IOT_URING_SLOT_OPEN != pConn->state || pConn->isRxPending || pConn->isRxClosed) {
+		return;
+	}
+
+	if(pConn->rxStart == pConn->rxEnd) {
+		pConn->rxStart = 0;
+		pConn->rxEnd = 0;
+	} else if(IOT_URING_BUFFER_LEN == pConn->rxEnd) {
+		if(0 == pConn->rxStart) {
+			/* Full, the next read makes room */
+			return;
+		}
+		memmove(_iot_uring_rx_buf(index), _iot_uring_rx_buf(index) + pConn->rxStart, pConn->rxEnd - pConn->rxStart);
+		pConn->rxEnd -= pConn->rxStart;
+		pConn->rxStart = 0;
+	}
+
+	_iot_uring_queue(index, false);
+}
+
+static void _iot_uring_complete(uint64_t userData, int32_t res) {
+	uint32_t index = (uint32_t) (userData >> 1);
+	IoT_Uring_Connection_t *pConn = &connections[index];
+
+	if(IOT_URING_OP_SEND & userData) {
+		if(0 < res) {
+			memmove(_iot_uring_tx_buf(index), _iot_uring_tx_buf(index) + res, pConn->txLen - (uint32_t) res);
+			pConn->txLen -= (uint32_t) res;
+			ring.stats.bytesSent += (uint64_t) res;
+		} else if(-EAGAIN != res && -EINTR != res) {
+			pConn->isTxFailed = true;
+			pConn->txLen = 0;
+		}
+		pConn->txInFlight = 0;
+		if(IOT_URING_SLOT_OPEN == pConn->state && 0 < pConn->txLen && !pConn->isTxFailed) {
+			/* Rest of a short send and everything queued since */
+			_iot_uring_queue(index, true);
+		}
+	} else {
+		pConn->isRxPending = false;
+		if(0 < res) {
+			pConn->rxEnd += (uint32_t) res;
+		} else if(-EAGAIN != res && -EINTR != res) {
+			pConn->isRxClosed = true;
+		}
+		_iot_uring_queue_recv(index);
+	}
+
+	if(IOT_URING_SLOT_CLOSING == pConn->state && !pConn->isRxPending && 0 == pConn->txInFlight) {
+		close(pConn->fd);
+		pConn->fd = -1;
+		pConn->state = IOT_URING_SLOT_FREE;
+	}
+}
+
+static void _iot_uring_reap(void) {
+	unsigned head = *ring.pCqHead;
+	unsigned tail = __atomic_load_n(ring.pCqTail, __ATOMIC_ACQUIRE);
+	struct io_uring_cqe *pCqe;
+
+	while(head != tail) {
+		pCqe = &ring.pCqes[head & ring.cqMask];
+		ring.stats.completions++;
+		_iot_uring_complete(pCqe->user_data, pCqe->res);
+		head++;
+		if(head == tail) {
+			/* Completions of the sends and receives queued above */
+			__atomic_store_n(ring.pCqHead, head, __ATOMIC_RELEASE);
+			tail = __atomic_load_n(ring.pCqTail, __ATOMIC_ACQUIRE);
+		}
+	}
+
+	__atomic_store_n(ring.pCqHead, head, __ATOMIC_RELEASE);
+}
+
+/* Queues a send for every connection that got data since the last time */
+static void _iot_uring_queue_dirty(void) {
+	IoT_Uring_Connection_t *pConn;
+	uint32_t count = dirtyCount;
+	uint32_t i;
+
+	/* A connection that finds the submission queue full is added again, behind the ones already handled */
+	dirtyCount = 0;
+	for(i = 0; i < count; i++) {
+		pConn = &connections[dirtyConnections[i]];
+		pConn->isTxDirty = false;
+		if(IOT_URING_SLOT_OPEN == pConn->state && 0 == pConn->txInFlight && 0 < pConn->txLen &&
+		   !pConn->isTxFailed) {
+			_iot_uring_queue(dirtyConnections[i], true);
+		}
+	}
+}
+
+/* Submits everything queued and waits up to waitMs for a completion of any connection */
+static IoT_Error_t _iot_uring_enter(uint32_t waitMs) {
+	struct io_uring_getevents_arg arg;
+	struct __kernel_timespec ts;
+	unsigned flags = 0;
+	unsigned minComplete = 0;
+	void *pArg = NULL;
+	size_t argLen = 0;
+	long ret;
+
+	_iot_uring_queue_dirty();
+
+	if(0 < waitMs && *ring.pCqHead == __atomic_load_n(ring.pCqTail, __ATOMIC_ACQUIRE)) {
+		ts.tv_sec = waitMs / 1000;
+		ts.tv_nsec = (long long) (waitMs % 1000) * 1000000LL;
+		memset(&arg, 0, sizeof(arg));
+		arg.sigmask_sz = _NSIG / 8;
+		arg.ts = (uint64_t) (uintptr_t) &ts;
+		flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+		minComplete = 1;
+		pArg = &arg;
+		argLen = sizeof(arg);
+	}
+
+	if(0 < ring.toSubmit || 0 < minComplete) {
+		ret = syscall(__NR_io_uring_enter, ring.ringFd, ring.toSubmit, minComplete, flags, pArg, argLen);
+		ring.stats.enters++;
+		if(0 <= ret) {
+			ring.toSubmit -= (unsigned) ret;
+		} else if(ETIME != errno && EINTR != errno && EAGAIN != errno && EBUSY != errno) {
+			IOT_ERROR("io_uring_enter failed: %d", errno);
+			return NETWORK_SSL_WRITE_ERROR;
+		}
+	}
+
+	_iot_uring_reap();
+
+	return SUCCESS;
+}
+
+static struct io_uring_sqe *_iot_uring_get_sqe(void) {
+	struct io_uring_sqe *pSqe;
+
+	if(ring.sqTail - __atomic_load_n(ring.pSqHead, __ATOMIC_ACQUIRE) >= ring.sqEntries) {
+		(void) syscall(__NR_io_uring_enter, ring.ringFd, ring.toSubmit, 0, 0, NULL, 0);
+		ring.stats.enters++;
+		ring.toSubmit = ring.sqTail - __atomic_load_n(ring.pSqHead, __ATOMIC_ACQUIRE);
+		if(ring.toSubmit >= ring.sqEntries) {
+			IOT_ERROR("io_uring submission queue is full");
+			return NULL;
+		}
+	}
+
+	pSqe = &ring.pSqes[ring.sqTail & ring.sqMask];
+	memset(pSqe, 0, sizeof(*pSqe));
+	return pSqe;
+}
+
+static void _iot_uring_release(TLSDataParams *pParams) {
+	IoT_Uring_Connection_t *pConn;
+
+	if(0 > pParams->connection) {
+		return;
+	}
+
+	pConn = &connections[pParams->connection];
+	(void) shutdown(pConn->fd, SHUT_RDWR);
+	pConn->state = IOT_URING_SLOT_CLOSING;
+	if(!pConn->isRxPending && 0 == pConn->txInFlight) {
+		close(pConn->fd);
+		pConn->fd = -1;
+		pConn->state = IOT_URING_SLOT_FREE;
+	}
+	/* Otherwise the slot is freed once the shut down socket completes its operations */
+
+	pParams->connection = -1;
+	pParams->server_fd = -1;
+}
+
+/* Copies as much as fits into the send staging buffer, returns the bytes copied */
+static size_t _iot_uring_stage(uint32_t index, const unsigned char *pMsg, size_t len) {
+	IoT_Uring_Connection_t *pConn = &connections[index];
+	size_t space = IOT_URING_BUFFER_LEN - pConn->txLen;
+
+	if(space > len) {
+		space = len;
+	}
+	if(0 < space) {
+		memcpy(_iot_uring_tx_buf(index) + pConn->txLen, pMsg, space);
+		pConn->txLen += (uint32_t) space;
+		ring.stats.bytesStaged += space;
+		_iot_uring_mark_dirty(index);
+	}
+
+	return space;
+}
+
+/* Submits the staged bytes of the connection and waits until the kernel reports all of them sent */
+static IoT_Error_t _iot_uring_wait_sent(uint32_t index, Timer *timer) {
+	IoT_Uring_Connection_t *pConn = &connections[index];
+	bool isExpired = false;
+
+	for(;;) {
+		if(pConn->isTxFailed) {
+			return NETWORK_SSL_WRITE_ERROR;
+		}
+		if(0 == pConn->txLen) {
+			return SUCCESS;
+		}
+		if(isExpired) {
+			return NETWORK_SSL_WRITE_TIMEOUT_ERROR;
+		}
+
+		/* Enter at least once, the sends are submitted even if the timer has expired */
+		isExpired = has_timer_expired(timer);
+		if(SUCCESS != _iot_uring_enter(isExpired ? 0 : left_ms(timer))) {
+			return NETWORK_SSL_WRITE_ERROR;
+		}
+	}
+}
+
+/* Copies what has been received, returns the bytes copied */
+static size_t _iot_uring_copy_rx(uint32_t index, unsigned char *pMsg, size_t len) {
+	IoT_Uring_Connection_t *pConn = &connections[index];
+	size_t available = pConn->rxEnd - pConn->rxStart;
+
+	if(available > len) {
+		available = len;
+	}
+	if(0 < available) {
+		memcpy(pMsg, _iot_uring_rx_buf(index) + pConn->rxStart, available);
+		pConn->rxStart += (uint32_t) available;
+	}
+
+	return available;
+}
+
+#ifdef DISABLE_IOT_URING_TLS
+/* Bytes of the last staged ones that are sent, sends complete in the order the bytes were staged */
+static size_t _iot_uring_sent_of(uint32_t index, size_t staged) {
+	size_t unsent = connections[index].txLen;
+
+	return staged - ((unsent < staged) ? unsent : staged);
+}
+
+static IoT_Error_t _iot_uring_write(uint32_t index, const unsigned char *pMsg, size_t len, Timer *timer,
+									size_t *written_len) {
+	IoT_Uring_Connection_t *pConn = &connections[index];
+	size_t staged_so_far = 0;
+	bool isExpired = false;
+	IoT_Error_t rc = NETWORK_SSL_WRITE_QUEUED;
+
+	for(;;) {
+		if(pConn->isTxFailed) {
+			/* This or an earlier queued send failed */
+			rc = NETWORK_SSL_WRITE_ERROR;
+			break;
+		}
+		staged_so_far += _iot_uring_stage(index, pMsg + staged_so_far, len - staged_so_far);
+		if(staged_so_far == len) {
+			break;
+		}
+		if(isExpired) {
+			rc = NETWORK_SSL_WRITE_TIMEOUT_ERROR;
+			break;
+		}
+
+		/* The staging buffer is full, submit the batch and wait for a send to make room */
+		isExpired = has_timer_expired(timer);
+		if(SUCCESS != _iot_uring_enter(isExpired ? 0 : left_ms(timer))) {
+			rc = NETWORK_SSL_WRITE_ERROR;
+			break;
+		}
+	}
+
+	*written_len = _iot_uring_sent_of(index, staged_so_far);
+	if(NETWORK_SSL_WRITE_QUEUED == rc && len == *written_len) {
+		rc = SUCCESS;
+	}
+
+	return rc;
+}
+
+static IoT_Error_t _iot_uring_read(uint32_t index, unsigned char *pMsg, size_t len, Timer *timer, size_t *read_len) {
+	IoT_Uring_Connection_t *pConn = &connections[index];
+	size_t rxLen = 0;
+	size_t copied;
+	bool isExpired = false;
+
+	for(;;) {
+		copied = _iot_uring_copy_rx(index, pMsg, len);
+		pMsg += copied;
+		len -= copied;
+		rxLen += copied;
+
+		// Evaluate timeout after the read to make sure read is done at least once
+		if(0 == len || isExpired) {
+			break;
+		}
+		if(pConn->isRxClosed) {
+			/* Peer closed the connection or the socket failed */
+			return NETWORK_SSL_READ_ERROR;
+		}
+
+		_iot_uring_queue_recv(index);
+		isExpired = has_timer_expired(timer);
+		if(SUCCESS != _iot_uring_enter(isExpired ? 0 : left_ms(timer))) {
+			return NETWORK_SSL_READ_ERROR;
+		}
+	}
+
+	/* Like the plain TCP layer, partial reads are reported so the client can resume the packet */
+	*read_len = rxLen;
+
+	if(len == 0) {
+		return SUCCESS;
+	}
+
+	if(rxLen == 0) {
+		return NETWORK_SSL_NOTHING_TO_READ;
+	} else {
+		return NETWORK_SSL_READ_TIMEOUT_ERROR;
+	}
+}
+#else
+/*
+ * Send callback of mbedTLS. Only stages the record, it is submitted with the next batch.
+ */
+static int _iot_uring_bio_send(void *ctx, const unsigned char *buf, size_t len) {
+	TLSDataParams *pParams = (TLSDataParams *) ctx;
+	uint32_t index;
+	size_t staged;
+
+	if(0 > pParams->connection) {
+		return MBEDTLS_ERR_NET_INVALID_CONTEXT;
+	}
+	index = (uint32_t) pParams->connection;
+	if(connections[index].isTxFailed) {
+		return MBEDTLS_ERR_NET_SEND_FAILED;
+	}
+
+	staged = _iot_uring_stage(index, buf, len);
+	if(0 == staged) {
+		/* The staging buffer is full, give a send the chance to complete */
+		if(SUCCESS != _iot_uring_enter(IOT_URING_TLS_WAIT_MS)) {
+			return MBEDTLS_ERR_NET_SEND_FAILED;
+		}
+		return MBEDTLS_ERR_SSL_WANT_WRITE;
+	}
+
+	return (int) staged;
+}
+
+/*
+ * Receive callback of mbedTLS, returns as soon as any data has arrived. A timeout of 0 waits
+ * without limit, like mbedtls_net_recv_timeout.
+ */
+static int _iot_uring_bio_recv(void *ctx, unsigned char *buf, size_t len, uint32_t timeout) {
+	TLSDataParams *pParams = (TLSDataParams *) ctx;
+	Timer timer;
+	uint32_t index;
+	uint32_t waitMs;
+	size_t copied;
+	bool isExpired = false;
+
+	if(0 > pParams->connection) {
+		return MBEDTLS_ERR_NET_INVALID_CONTEXT;
+	}
+	index = (uint32_t) pParams->connection;
+
+	init_timer(&timer);
+	countdown_ms(&timer, timeout);
+
+	for(;;) {
+		copied = _iot_uring_copy_rx(index, buf, len);
+		if(0 < copied) {
+			return (int) copied;
+		}
+		if(connections[index].isRxClosed) {
+			return MBEDTLS_ERR_NET_CONN_RESET;
+		}
+		if(isExpired) {
+			return MBEDTLS_ERR_SSL_TIMEOUT;
+		}
+
+		_iot_uring_queue_recv(index);
+		if(0 == timeout) {
+			waitMs = IOT_URING_TLS_WAIT_MS;
+		} else {
+			isExpired = has_timer_expired(&timer);
+			waitMs = isExpired ? 0 : left_ms(&timer);
+		}
+		if(SUCCESS != _iot_uring_enter(waitMs)) {
+			return MBEDTLS_ERR_NET_RECV_FAILED;
+		}
+	}
+}
+
+static void _iot_uring_tls_init(TLSDataParams *pParams) {
+	mbedtls_ssl_init(&(pParams->ssl));
+	mbedtls_ssl_config_init(&(pParams->conf));
+	mbedtls_ctr_drbg_init(&(pParams->ctr_drbg));
+	mbedtls_entropy_init(&(pParams->entropy));
+	mbedtls_x509_crt_init(&(pParams->cacert));
+	mbedtls_x509_crt_init(&(pParams->clicert));
+	mbedtls_pk_init(&(pParams->pkey));
+	pParams->flags = 0;
+}
+
+static void _iot_uring_tls_free(TLSDataParams *pParams) {
+	mbedtls_x509_crt_free(&(pParams->clicert));
+	mbedtls_x509_crt_free(&(pParams->cacert));
+	mbedtls_pk_free(&(pParams->pkey));
+	mbedtls_ssl_free(&(pParams->ssl));
+	mbedtls_ssl_config_free(&(pParams->conf));
+	mbedtls_ctr_drbg_free(&(pParams->ctr_drbg));
+	mbedtls_entropy_free(&(pParams->entropy));
+}
+
+/* Runs the handshake over the connected slot, with the io_uring staging buffers as transport */
+static IoT_Error_t _iot_uring_tls_handshake(Network *pNetwork) {
+	TLSDataParams *pParams = &(pNetwork->tlsDataParams);
+	TLSConnectParams *pConnectParams = &(pNetwork->tlsConnectParams);
+	const char *pers = "aws_iot_uring_tls_wrapper";
+	const char *alpnProtocols[] = { "x-amzn-mqtt-ca", NULL };
+	char vrfy_buf[512];
+	int ret;
+
+	if((ret = mbedtls_ctr_drbg_seed(&(pParams->ctr_drbg), mbedtls_entropy_func, &(pParams->entropy),
+									(const unsigned char *) pers, strlen(pers))) != 0) {
+		IOT_ERROR("mbedtls_ctr_drbg_seed returned -0x%x", -ret);
+		return NETWORK_MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
+	}
+
+	if(0 > mbedtls_x509_crt_parse_file(&(pParams->cacert), pConnectParams->pRootCALocation)) {
+		IOT_ERROR("Parsing the root certificate failed");
+		return NETWORK_X509_ROOT_CRT_PARSE_ERROR;
+	}
+	if(0 != mbedtls_x509_crt_parse_file(&(pParams->clicert), pConnectParams->pDeviceCertLocation)) {
+		IOT_ERROR("Parsing the device certificate failed");
+		return NETWORK_X509_DEVICE_CRT_PARSE_ERROR;
+	}
+	if(0 != mbedtls_pk_parse_keyfile(&(pParams->pkey), pConnectParams->pDevicePrivateKeyLocation, "")) {
+		IOT_ERROR("Parsing the private key failed");
+		return NETWORK_PK_PRIVATE_KEY_PARSE_ERROR;
+	}
+
+	if((ret = mbedtls_ssl_config_defaults(&(pParams->conf), MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+										  MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
+		IOT_ERROR("mbedtls_ssl_config_defaults returned -0x%x", -ret);
+		return SSL_CONNECTION_ERROR;
+	}
+	if(pConnectParams->ServerVerificationFlag == true) {
+		mbedtls_ssl_conf_authmode(&(pParams->conf), MBEDTLS_SSL_VERIFY_REQUIRED);
+	} else {
+		mbedtls_ssl_conf_authmode(&(pParams->conf), MBEDTLS_SSL_VERIFY_OPTIONAL);
+	}
+	mbedtls_ssl_conf_rng(&(pParams->conf), mbedtls_ctr_drbg_random, &(pParams->ctr_drbg));
+	mbedtls_ssl_conf_ca_chain(&(pParams->conf), &(pParams->cacert), NULL);
+	if((ret = mbedtls_ssl_conf_own_cert(&(pParams->conf), &(pParams->clicert), &(pParams->pkey))) != 0) {
+		IOT_ERROR("mbedtls_ssl_conf_own_cert returned %d", ret);
+		return SSL_CONNECTION_ERROR;
+	}
+	mbedtls_ssl_conf_read_timeout(&(pParams->conf), pConnectParams->timeout_ms);
+
+	/* Use the AWS IoT ALPN extension for MQTT if port 443 is requested. */
+	if(443 == pConnectParams->DestinationPort) {
+		if((ret = mbedtls_ssl_conf_alpn_protocols(&(pParams->conf), alpnProtocols)) != 0) {
+			IOT_ERROR("mbedtls_ssl_conf_alpn_protocols returned -0x%x", -ret);
+			return SSL_CONNECTION_ERROR;
+		}
+	}
+
+	if((ret = mbedtls_ssl_setup(&(pParams->ssl), &(pParams->conf))) != 0) {
+		IOT_ERROR("mbedtls_ssl_setup returned -0x%x", -ret);
+		return SSL_CONNECTION_ERROR;
+	}
+	if((ret = mbedtls_ssl_set_hostname(&(pParams->ssl), pConnectParams->pDestinationURL)) != 0) {
+		IOT_ERROR("mbedtls_ssl_set_hostname returned %d", ret);
+		return SSL_CONNECTION_ERROR;
+	}
+	mbedtls_ssl_set_bio(&(pParams->ssl), pParams, _iot_uring_bio_send, NULL, _iot_uring_bio_recv);
+
+	while((ret = mbedtls_ssl_handshake(&(pParams->ssl))) != 0) {
+		if(ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+			/* The staged handshake records are only sent when the ring is entered */
+			continue;
+		}
+		if(ret != MBEDTLS_ERR_SSL_WANT_READ) {
+			IOT_ERROR("mbedtls_ssl_handshake returned -0x%x", -ret);
+			return SSL_CONNECTION_ERROR;
+		}
+	}
+
+	if(pConnectParams->ServerVerificationFlag == true) {
+		if((pParams->flags = mbedtls_ssl_get_verify_result(&(pParams->ssl))) != 0) {
+			mbedtls_x509_crt_verify_info(vrfy_buf, sizeof(vrfy_buf), "  ! ", pParams->flags);
+			IOT_ERROR("%s\n", vrfy_buf);
+			return SSL_CONNECTION_ERROR;
+		}
+	}
+
+	mbedtls_ssl_conf_read_timeout(&(pParams->conf), IOT_URING_TLS_WAIT_MS);
+
+	return SUCCESS;
+}
+#endif
+
+IoT_Error_t iot_uring_flush(void) {
+	if(!ring.isInitialized) {
+		return SUCCESS;
+	}
+
+	return _iot_uring_enter(0);
+}
+
+void iot_uring_get_stats(IoT_Uring_Stats_t *pStats) {
+	if(NULL != pStats) {
+		*pStats = ring.stats;
+	}
+}
+
+IoT_Error_t iot_tls_init(Network *pNetwork, char *pRootCALocation, char *pDeviceCertLocation,
+						 char *pDevicePrivateKeyLocation, char *pDestinationURL,
+						 uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
+	pNetwork->tlsConnectParams.DestinationPort = destinationPort;
+	pNetwork->tlsConnectParams.pDestinationURL = pDestinationURL;
+	pNetwork->tlsConnectParams.pDeviceCertLocation = pDeviceCertLocation;
+	pNetwork->tlsConnectParams.pDevicePrivateKeyLocation = pDevicePrivateKeyLocation;
+	pNetwork->tlsConnectParams.pRootCALocation = pRootCALocation;
+	pNetwork->tlsConnectParams.timeout_ms = timeout_ms;
+	pNetwork->tlsConnectParams.ServerVerificationFlag = ServerVerificationFlag;
+
+	pNetwork->connect = iot_tls_connect;
+	pNetwork->read = iot_tls_read;
+	pNetwork->write = iot_tls_write;
+	pNetwork->disconnect = iot_tls_disconnect;
+	pNetwork->isConnected = iot_tls_is_connected;
+	pNetwork->destroy = iot_tls_destroy;
+
+	pNetwork->tlsDataParams.server_fd = -1;
+	pNetwork->tlsDataParams.connection = -1;
+#ifndef DISABLE_IOT_URING_TLS
+	_iot_uring_tls_init(&(pNetwork->tlsDataParams));
+#endif
+
+	return _iot_uring_setup();
+}
+
+IoT_Error_t iot_tls_is_connected(Network *pNetwork) {
+	IOT_UNUSED(pNetwork);
+
+	/* Use this to add implementation which can check for physical layer disconnect */
+	return NETWORK_PHYSICAL_LAYER_CONNECTED;
+}
+
+IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
+	struct addrinfo hints, *pAddrList, *pAddr;
+	IoT_Uring_Connection_t *pConn;
+	char port[6];
+	int32_t index = -1;
+	int fd = -1;
+	int flag = 1;
+	int32_t i;
+	bool isTxDirty;
+#ifndef DISABLE_IOT_URING_TLS
+	IoT_Error_t rc;
+#endif
+
+	if(NULL == pNetwork) {
+		return NULL_VALUE_ERROR;
+	}
+
+	if(NULL != params) {
+		pNetwork->tlsConnectParams = *params;
+	}
+
+	/* A reconnect without destroy */
+	_iot_uring_release(&(pNetwork->tlsDataParams));
+#ifndef DISABLE_IOT_URING_TLS
+	_iot_uring_tls_free(&(pNetwork->tlsDataParams));
+	_iot_uring_tls_init(&(pNetwork->tlsDataParams));
+#endif
+
+	for(i = 0; i < IOT_URING_MAX_CONNECTIONS; i++) {
+		if(IOT_URING_SLOT_FREE == connections[i].state) {
+			index = i;
+			break;
+		}
+	}
+	if(0 > index) {
+		IOT_ERROR("All %d io_uring connections are in use", IOT_URING_MAX_CONNECTIONS);
+		return NETWORK_ERR_NET_SOCKET_FAILED;
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	snprintf(port, sizeof(port), "%u", pNetwork->tlsConnectParams.DestinationPort);
+
+	if(0 != getaddrinfo(pNetwork->tlsConnectParams.pDestinationURL, port, &hints, &pAddrList)) {
+		return NETWORK_ERR_NET_UNKNOWN_HOST;
+	}
+
+	for(pAddr = pAddrList; NULL != pAddr; pAddr = pAddr->ai_next) {
+		fd = socket(pAddr->ai_family, pAddr->ai_socktype, pAddr->ai_protocol);
+		if(0 > fd) {
+			continue;
+		}
+		if(0 == connect(fd, pAddr->ai_addr, pAddr->ai_addrlen)) {
+			break;
+		}
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(pAddrList);
+
+	if(0 > fd) {
+		return NETWORK_ERR_NET_CONNECT_FAILED;
+	}
+
+	(void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+	pConn = &connections[index];
+	/* A slot released before its entry in the dirty list was handled keeps that entry */
+	isTxDirty = pConn->isTxDirty;
+	memset(pConn, 0, sizeof(*pConn));
+	pConn->isTxDirty = isTxDirty;
+	pConn->fd = fd;
+	pConn->state = IOT_URING_SLOT_OPEN;
+	pNetwork->tlsDataParams.server_fd = fd;
+	pNetwork->tlsDataParams.connection = index;
+
+	/* Submitted with the next batch */
+	_iot_uring_queue_recv((uint32_t) index);
+
+#ifndef DISABLE_IOT_URING_TLS
+	rc = _iot_uring_tls_handshake(pNetwork);
+	if(SUCCESS != rc) {
+		_iot_uring_release(&(pNetwork->tlsDataParams));
+		return rc;
+	}
+#endif
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_write(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *written_len) {
+	int32_t index = pNetwork->tlsDataParams.connection;
+#ifndef DISABLE_IOT_URING_TLS
+	size_t written_so_far = 0;
+	IoT_Error_t rc = SUCCESS;
+	int ret;
+#endif
+
+	*written_len = 0;
+	if(0 > index) {
+		return NETWORK_SSL_WRITE_ERROR;
+	}
+
+#ifdef DISABLE_IOT_URING_TLS
+	return _iot_uring_write((uint32_t) index, pMsg, len, timer, written_len);
+#else
+	while(written_so_far < len) {
+		ret = mbedtls_ssl_write(&(pNetwork->tlsDataParams.ssl), pMsg + written_so_far, len - written_so_far);
+		if(0 < ret) {
+			written_so_far += (size_t) ret;
+		} else if(ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+			IOT_ERROR("mbedtls_ssl_write returned -0x%x", -ret);
+			rc = NETWORK_SSL_WRITE_ERROR;
+			break;
+		} else if(has_timer_expired(timer)) {
+			rc = NETWORK_SSL_WRITE_TIMEOUT_ERROR;
+			break;
+		}
+	}
+
+	/* A record does not map back to the bytes it carries, they count once every staged record is sent */
+	if(0 == connections[index].txLen) {
+		*written_len = written_so_far;
+	} else if(SUCCESS == rc) {
+		rc = NETWORK_SSL_WRITE_QUEUED;
+	}
+
+	return rc;
+#endif
+}
+
+IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *read_len) {
+	int32_t index = pNetwork->tlsDataParams.connection;
+#ifndef DISABLE_IOT_URING_TLS
+	size_t rxLen = 0;
+	int ret;
+#endif
+
+	if(0 > index) {
+		return NETWORK_SSL_READ_ERROR;
+	}
+
+#ifdef DISABLE_IOT_URING_TLS
+	return _iot_uring_read((uint32_t) index, pMsg, len, timer, read_len);
+#else
+	while(len > 0) {
+		// This read will timeout after IOT_URING_TLS_WAIT_MS if there's no data to be read
+		ret = mbedtls_ssl_read(&(pNetwork->tlsDataParams.ssl), pMsg, len);
+		if(ret > 0) {
+			rxLen += (size_t) ret;
+			pMsg += ret;
+			len -= (size_t) ret;
+		} else if(ret == 0 || (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE &&
+							   ret != MBEDTLS_ERR_SSL_TIMEOUT)) {
+			return NETWORK_SSL_READ_ERROR;
+		}
+
+		// Evaluate timeout after the read to make sure read is done at least once
+		if(has_timer_expired(timer)) {
+			break;
+		}
+	}
+
+	/* Like the plain TCP layer, partial reads are reported so the client can resume the packet */
+	*read_len = rxLen;
+
+	if(len == 0) {
+		return SUCCESS;
+	}
+
+	if(rxLen == 0) {
+		return NETWORK_SSL_NOTHING_TO_READ;
+	} else {
+		return NETWORK_SSL_READ_TIMEOUT_ERROR;
+	}
+#endif
+}
+
+IoT_Error_t iot_tls_disconnect(Network *pNetwork) {
+	IoT_Uring_Connection_t *pConn;
+	Timer timer;
+	int32_t index = pNetwork->tlsDataParams.connection;
+#ifndef DISABLE_IOT_URING_TLS
+	int ret;
+#endif
+
+	if(0 > index) {
+		return SUCCESS;
+	}
+	pConn = &connections[index];
+
+	init_timer(&timer);
+	countdown_ms(&timer, IOT_URING_DISCONNECT_TIMEOUT_MS);
+
+#ifndef DISABLE_IOT_URING_TLS
+	do {
+		ret = mbedtls_ssl_close_notify(&(pNetwork->tlsDataParams.ssl));
+	} while(ret == MBEDTLS_ERR_SSL_WANT_WRITE && !has_timer_expired(&timer));
+#endif
+
+	/* The DISCONNECT packet and anything else still staged, like the close notify alert */
+	(void) _iot_uring_wait_sent((uint32_t) index, &timer);
+
+	(void) shutdown(pConn->fd, SHUT_RDWR);
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_destroy(Network *pNetwork) {
+	_iot_uring_release(&(pNetwork->tlsDataParams));
+#ifndef DISABLE_IOT_URING_TLS
+	_iot_uring_tls_free(&(pNetwork->tlsDataParams));
+	_iot_uring_tls_init(&(pNetwork->tlsDataParams));
+#endif
+	(void) iot_uring_flush();
+
+	return SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef IOTSDKC_NETWORK_MBEDTLS_PLATFORM_H_H
+
+#include <stdint.h>
+
+#include "aws_iot_error.h"
+
+#ifndef DISABLE_IOT_URING_TLS
+#include "mbedtls/config.h"
+
+#include "mbedtls/platform.h"
+#include "mbedtls/net.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509.h"
+#include "mbedtls/error.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Largest number of connections open at the same time.
+ */
+#ifndef IOT_URING_MAX_CONNECTIONS
+#define IOT_URING_MAX_CONNECTIONS 1024
+#endif
+
+/**
+ * Size of the receive and of the send staging buffer of every connection. All staging buffers
+ * are one static block that is registered with the ring.
+ */
+#ifndef IOT_URING_BUFFER_LEN
+#define IOT_URING_BUFFER_LEN 4096
+#endif
+
+/**
+ * Size of the submission queue. Every connection has at most one receive and one send in
+ * flight, so twice the number of connections never blocks on a full queue.
+ */
+#ifndef IOT_URING_ENTRIES
+#define IOT_URING_ENTRIES (2 * IOT_URING_MAX_CONNECTIONS)
+#endif
+
+/**
+ * @brief TLS Connection Parameters
+ *
+ * The io_uring network layer keeps the socket and the connection slot in the shared ring.
+ * mbedTLS reads and writes the records through the staging buffers of the slot, unless the
+ * layer is built with DISABLE_IOT_URING_TLS.
+ */
+typedef struct _TLSDataParams {
+	int server_fd;
+	int32_t connection; ///< Slot in the connection table, -1 when not connected
+#ifndef DISABLE_IOT_URING_TLS
+	mbedtls_entropy_context entropy;
+	mbedtls_ctr_drbg_context ctr_drbg;
+	mbedtls_ssl_context ssl;
+	mbedtls_ssl_config conf;
+	uint32_t flags;
+	mbedtls_x509_crt cacert;
+	mbedtls_x509_crt clicert;
+	mbedtls_pk_context pkey;
+#endif
+}TLSDataParams;
+
+/**
+ * @brief Counters of the shared ring
+ */
+typedef struct {
+	uint64_t enters; ///< io_uring_enter calls, the only system calls on the data path
+	uint64_t sends; ///< Send operations submitted
+	uint64_t receives; ///< Receive operations submitted
+	uint64_t completions;
+	uint64_t bytesStaged; ///< Bytes copied into the send staging buffers
+	uint64_t bytesSent; ///< Bytes the kernel has reported sent
+} IoT_Uring_Stats_t;
+
+/**
+ * @brief Submit the queued operations of every connection and handle their completions
+ *
+ * Writes only stage their bytes. The sends of all connections are submitted together the next
+ * time any connection reads or when this is called, so an application that publishes without
+ * yielding should call it after a round of publishes. It does not wait for a completion.
+ *
+ * @return SUCCESS, or NETWORK_SSL_WRITE_ERROR if the ring could not be entered
+ */
+IoT_Error_t iot_uring_flush(void);
+
+/**
+ * @brief Copy the counters of the shared ring
+ */
+void iot_uring_get_stats(IoT_Uring_Stats_t *pStats);
+
+#define IOTSDKC_NETWORK_MBEDTLS_PLATFORM_H_H
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //IOTSDKC_NETWORK_MBEDTLS_PLATFORM_H_H
@@ -27,6 +27,31 @@ extern "C" {
 #include "network_interface.h"
 #include "network_platform.h"
 
+#ifdef ENABLE_IOT_TLS_KTLS
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <linux/tls.h>
+
+#include "mbedtls/platform_util.h"
+#include "mbedtls/ssl_ciphersuites.h"
+
+#if !defined(MBEDTLS_SSL_EXPORT_KEYS)
+#error "ENABLE_IOT_TLS_KTLS needs MBEDTLS_SSL_EXPORT_KEYS in the mbedTLS configuration"
+#endif
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+/* TLS record content types */
+#define IOT_KTLS_RECORD_ALERT 21
+#define IOT_KTLS_RECORD_APPLICATION_DATA 23
+#endif
 
 /* This is the value used for ssl read timeout */
 #define IOT_SSL_READ_TIMEOUT 10
@@ -60,6 +85,224 @@ static int _iot_tls_verify_cert(void *data, mbedtls_x509_crt *crt, int depth, ui
 	return 0;
 }
 
+#ifdef ENABLE_IOT_TLS_KTLS
+/*
+ * Called by mbedTLS when the keys are derived. Only AES-GCM keys are kept, the kernel does not
+ * implement the other ciphers the SDK may negotiate.
+ */
+static int _iot_tls_export_keys(void *p_expkey, const unsigned char *ms, const unsigned char *kb, size_t maclen,
+								size_t keylen, size_t ivlen) {
+	TLSDataParams *tlsDataParams = (TLSDataParams *) p_expkey;
+	((void) ms);
+
+	tlsDataParams->ktlsKeyLen = 0;
+	if(0 != maclen || sizeof(tlsDataParams->ktlsClientSalt) != ivlen ||
+	   (16 != keylen && 32 != keylen)) {
+		return 0;
+	}
+
+	/* Key block: client write key, server write key, client IV, server IV */
+	memcpy(tlsDataParams->ktlsClientKey, kb, keylen);
+	memcpy(tlsDataParams->ktlsServerKey, kb + keylen, keylen);
+	memcpy(tlsDataParams->ktlsClientSalt, kb + (2 * keylen), ivlen);
+	memcpy(tlsDataParams->ktlsServerSalt, kb + (2 * keylen) + ivlen, ivlen);
+	tlsDataParams->ktlsKeyLen = keylen;
+
+	return 0;
+}
+
+static int _iot_tls_ktls_set_key(int fd, int direction, const unsigned char *key, size_t keyLen,
+								 const unsigned char *salt, const unsigned char *seq) {
+	union {
+		struct tls12_crypto_info_aes_gcm_128 gcm128;
+#ifdef TLS_CIPHER_AES_GCM_256
+		struct tls12_crypto_info_aes_gcm_256 gcm256;
+#endif
+	} info;
+	socklen_t infoLen;
+	int ret;
+
+	memset(&info, 0, sizeof(info));
+	if(16 == keyLen) {
+		info.gcm128.info.version = TLS_1_2_VERSION;
+		info.gcm128.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+		/* mbedTLS uses the sequence number as explicit nonce */
+		memcpy(info.gcm128.iv, seq, TLS_CIPHER_AES_GCM_128_IV_SIZE);
+		memcpy(info.gcm128.key, key, TLS_CIPHER_AES_GCM_128_KEY_SIZE);
+		memcpy(info.gcm128.salt, salt, TLS_CIPHER_AES_GCM_128_SALT_SIZE);
+		memcpy(info.gcm128.rec_seq, seq, TLS_CIPHER_AES_GCM_128_REC_SEQ_SIZE);
+		infoLen = sizeof(info.gcm128);
+	} else {
+#ifdef TLS_CIPHER_AES_GCM_256
+		info.gcm256.info.version = TLS_1_2_VERSION;
+		info.gcm256.info.cipher_type = TLS_CIPHER_AES_GCM_256;
+		memcpy(info.gcm256.iv, seq, TLS_CIPHER_AES_GCM_256_IV_SIZE);
+		memcpy(info.gcm256.key, key, TLS_CIPHER_AES_GCM_256_KEY_SIZE);
+		memcpy(info.gcm256.salt, salt, TLS_CIPHER_AES_GCM_256_SALT_SIZE);
+		memcpy(info.gcm256.rec_seq, seq, TLS_CIPHER_AES_GCM_256_REC_SEQ_SIZE);
+		infoLen = sizeof(info.gcm256);
+#else
+		return -1;
+#endif
+	}
+
+	ret = setsockopt(fd, SOL_TLS, direction, &info, infoLen);
+	mbedtls_platform_zeroize(&info, sizeof(info));
+
+	return ret;
+}
+
+/*
+ * Hands the record layer to the kernel. Any step that fails leaves the connection with mbedTLS,
+ * an installed "tls" ULP without keys passes data through unchanged. Receive is offloaded first,
+ * so mbedTLS never has to answer a record while the kernel encrypts what it sends.
+ */
+static void _iot_tls_ktls_enable(TLSDataParams *tlsDataParams) {
+	const mbedtls_ssl_ciphersuite_t *ciphersuite;
+	int fd = tlsDataParams->server_fd.fd;
+
+	ciphersuite = mbedtls_ssl_ciphersuite_from_string(mbedtls_ssl_get_ciphersuite(&(tlsDataParams->ssl)));
+	if(0 == tlsDataParams->ktlsKeyLen || NULL == ciphersuite ||
+	   MBEDTLS_SSL_MINOR_VERSION_3 != tlsDataParams->ssl.minor_ver ||
+	   (MBEDTLS_CIPHER_AES_128_GCM != ciphersuite->cipher && MBEDTLS_CIPHER_AES_256_GCM != ciphersuite->cipher)) {
+		IOT_DEBUG("  . kTLS not used for %s\n", mbedtls_ssl_get_ciphersuite(&(tlsDataParams->ssl)));
+	} else if(0 != mbedtls_ssl_check_pending(&(tlsDataParams->ssl))) {
+		/* Records already read by mbedTLS would be lost to the kernel */
+		IOT_DEBUG("  . kTLS not used, records are pending in mbedTLS\n");
+	} else if(0 != setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls"))) {
+		IOT_INFO("kTLS is not available (errno %d), using mbedTLS for the record layer", errno);
+	} else if(0 != _iot_tls_ktls_set_key(fd, TLS_RX, tlsDataParams->ktlsServerKey, tlsDataParams->ktlsKeyLen,
+										 tlsDataParams->ktlsServerSalt, tlsDataParams->ssl.in_ctr)) {
+		IOT_INFO("kTLS receive offload failed (errno %d), using mbedTLS for the record layer", errno);
+	} else {
+		tlsDataParams->isKtlsRx = true;
+		if(0 != _iot_tls_ktls_set_key(fd, TLS_TX, tlsDataParams->ktlsClientKey, tlsDataParams->ktlsKeyLen,
+									  tlsDataParams->ktlsClientSalt, tlsDataParams->ssl.out_ctr)) {
+			IOT_INFO("kTLS send offload failed (errno %d), sending with mbedTLS", errno);
+		} else {
+			tlsDataParams->isKtlsTx = true;
+		}
+		IOT_DEBUG("  . kTLS enabled for %s\n", mbedtls_ssl_get_ciphersuite(&(tlsDataParams->ssl)));
+	}
+
+	mbedtls_platform_zeroize(tlsDataParams->ktlsClientKey, sizeof(tlsDataParams->ktlsClientKey));
+	mbedtls_platform_zeroize(tlsDataParams->ktlsServerKey, sizeof(tlsDataParams->ktlsServerKey));
+	mbedtls_platform_zeroize(tlsDataParams->ktlsClientSalt, sizeof(tlsDataParams->ktlsClientSalt));
+	mbedtls_platform_zeroize(tlsDataParams->ktlsServerSalt, sizeof(tlsDataParams->ktlsServerSalt));
+	tlsDataParams->ktlsKeyLen = 0;
+}
+
+static IoT_Error_t _iot_tls_ktls_write(TLSDataParams *tlsDataParams, unsigned char *pMsg, size_t len, Timer *timer,
+									   size_t *written_len) {
+	size_t written_so_far = 0;
+	ssize_t ret;
+
+	while(written_so_far < len && !has_timer_expired(timer)) {
+		ret = send(tlsDataParams->server_fd.fd, pMsg + written_so_far, len - written_so_far, MSG_NOSIGNAL);
+		if(0 < ret) {
+			written_so_far += (size_t) ret;
+		} else if(0 > ret && (EINTR == errno || EAGAIN == errno || EWOULDBLOCK == errno)) {
+			continue;
+		} else {
+			IOT_ERROR(" failed\n  ! kTLS send returned errno %d\n\n", errno);
+			*written_len = written_so_far;
+			return NETWORK_SSL_WRITE_ERROR;
+		}
+	}
+
+	*written_len = written_so_far;
+	if(written_so_far != len) {
+		return NETWORK_SSL_WRITE_TIMEOUT_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+static IoT_Error_t _iot_tls_ktls_read(TLSDataParams *tlsDataParams, unsigned char *pMsg, size_t len, Timer *timer,
+									  size_t *read_len) {
+	unsigned char control[CMSG_SPACE(sizeof(unsigned char))];
+	struct pollfd pfd;
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	struct iovec iov;
+	size_t rxLen = 0;
+	ssize_t ret;
+
+	pfd.fd = tlsDataParams->server_fd.fd;
+	pfd.events = POLLIN;
+
+	while(len > 0) {
+		/* Same granularity as the mbedTLS read timeout */
+		ret = poll(&pfd, 1, IOT_SSL_READ_TIMEOUT);
+		if(0 < ret) {
+			memset(&msg, 0, sizeof(msg));
+			iov.iov_base = pMsg;
+			iov.iov_len = len;
+			msg.msg_iov = &iov;
+			msg.msg_iovlen = 1;
+			msg.msg_control = control;
+			msg.msg_controllen = sizeof(control);
+
+			ret = recvmsg(pfd.fd, &msg, MSG_DONTWAIT);
+			if(0 < ret) {
+				/* Anything but application data, e.g. a close_notify alert, ends the connection */
+				cmsg = CMSG_FIRSTHDR(&msg);
+				if(NULL != cmsg && SOL_TLS == cmsg->cmsg_level && TLS_GET_RECORD_TYPE == cmsg->cmsg_type &&
+				   IOT_KTLS_RECORD_APPLICATION_DATA != *((unsigned char *) CMSG_DATA(cmsg))) {
+					return NETWORK_SSL_READ_ERROR;
+				}
+				rxLen += (size_t) ret;
+				pMsg += ret;
+				len -= (size_t) ret;
+			} else if(0 == ret || (EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno)) {
+				return NETWORK_SSL_READ_ERROR;
+			}
+		} else if(0 > ret && EINTR != errno) {
+			return NETWORK_SSL_READ_ERROR;
+		}
+
+		if(has_timer_expired(timer)) {
+			break;
+		}
+	}
+
+	if(len == 0) {
+		*read_len = rxLen;
+		return SUCCESS;
+	}
+
+	if(rxLen == 0) {
+		return NETWORK_SSL_NOTHING_TO_READ;
+	} else {
+		return NETWORK_SSL_READ_TIMEOUT_ERROR;
+	}
+}
+
+/* mbedtls_ssl_close_notify would encrypt the alert a second time, send it as an alert record instead */
+static void _iot_tls_ktls_close_notify(TLSDataParams *tlsDataParams) {
+	unsigned char control[CMSG_SPACE(sizeof(unsigned char))];
+	unsigned char alert[2] = { MBEDTLS_SSL_ALERT_LEVEL_WARNING, MBEDTLS_SSL_ALERT_MSG_CLOSE_NOTIFY };
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	struct iovec iov;
+
+	memset(&msg, 0, sizeof(msg));
+	iov.iov_base = alert;
+	iov.iov_len = sizeof(alert);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_TLS;
+	cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(unsigned char));
+	*((unsigned char *) CMSG_DATA(cmsg)) = IOT_KTLS_RECORD_ALERT;
+
+	(void) sendmsg(tlsDataParams->server_fd.fd, &msg, MSG_NOSIGNAL);
+}
+#endif
+
 void _iot_tls_set_connect_params(Network *pNetwork, char *pRootCALocation, char *pDeviceCertLocation,
 								 char *pDevicePrivateKeyLocation, char *pDestinationURL,
 								 uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
@@ -72,6 +315,46 @@ void _iot_tls_set_connect_params(Network *pNetwork, char *pRootCALocation, char
 	pNetwork->tlsConnectParams.ServerVerificationFlag = ServerVerificationFlag;
 }
 
+/* Serializes the calls into the SSL context, mbedTLS can't read and write one session from two
+ * threads at the same time */
+static void _iot_tls_lock(TLSDataParams *tlsDataParams) {
+#ifdef _ENABLE_THREAD_SUPPORT_
+	(void) aws_iot_thread_mutex_lock(&(tlsDataParams->ssl_mutex));
+#else
+	IOT_UNUSED(tlsDataParams);
+#endif
+}
+
+static void _iot_tls_unlock(TLSDataParams *tlsDataParams) {
+#ifdef _ENABLE_THREAD_SUPPORT_
+	(void) aws_iot_thread_mutex_unlock(&(tlsDataParams->ssl_mutex));
+#else
+	IOT_UNUSED(tlsDataParams);
+#endif
+}
+
+/* Waits up to IOT_SSL_READ_TIMEOUT for data without holding the SSL context, so a read does
+ * not hold up a write from another thread. Returns > 0 if mbedtls_ssl_read has something to
+ * read, 0 on timeout. Without thread support nothing else uses the context and mbedtls_ssl_read
+ * waits itself. */
+static int _iot_tls_poll_read(TLSDataParams *tlsDataParams) {
+#ifdef _ENABLE_THREAD_SUPPORT_
+	size_t avail;
+
+	_iot_tls_lock(tlsDataParams);
+	avail = mbedtls_ssl_get_bytes_avail(&(tlsDataParams->ssl));
+	_iot_tls_unlock(tlsDataParams);
+	if(0 != avail) {
+		return 1;
+	}
+
+	return mbedtls_net_poll(&(tlsDataParams->server_fd), MBEDTLS_NET_POLL_READ, IOT_SSL_READ_TIMEOUT);
+#else
+	IOT_UNUSED(tlsDataParams);
+	return 1;
+#endif
+}
+
 IoT_Error_t iot_tls_init(Network *pNetwork, char *pRootCALocation, char *pDeviceCertLocation,
 						 char *pDevicePrivateKeyLocation, char *pDestinationURL,
 						 uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
@@ -87,7 +370,11 @@ IoT_Error_t iot_tls_init(Network *pNetwork, char *pRootCALocation, char *pDevice
 
 	pNetwork->tlsDataParams.flags = 0;
 
+#ifdef _ENABLE_THREAD_SUPPORT_
+	return aws_iot_thread_mutex_init(&(pNetwork->tlsDataParams.ssl_mutex));
+#else
 	return SUCCESS;
+#endif
 }
 
 IoT_Error_t iot_tls_is_connected(Network *pNetwork) {
@@ -118,6 +405,11 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 	}
 
 	tlsDataParams = &(pNetwork->tlsDataParams);
+#ifdef ENABLE_IOT_TLS_KTLS
+	tlsDataParams->isKtlsTx = false;
+	tlsDataParams->isKtlsRx = false;
+	tlsDataParams->ktlsKeyLen = 0;
+#endif
 
 	mbedtls_net_init(&(tlsDataParams->server_fd));
 	mbedtls_ssl_init(&(tlsDataParams->ssl));
@@ -202,6 +494,9 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 	}
 
 	mbedtls_ssl_conf_read_timeout(&(tlsDataParams->conf), pNetwork->tlsConnectParams.timeout_ms);
+#ifdef ENABLE_IOT_TLS_KTLS
+	mbedtls_ssl_conf_export_keys_cb(&(tlsDataParams->conf), _iot_tls_export_keys, tlsDataParams);
+#endif
 
 	/* Use the AWS IoT ALPN extension for MQTT if port 443 is requested. */
 	if(443 == pNetwork->tlsConnectParams.DestinationPort) {
@@ -277,6 +572,12 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 
 	mbedtls_ssl_conf_read_timeout(&(tlsDataParams->conf), IOT_SSL_READ_TIMEOUT);
 
+#ifdef ENABLE_IOT_TLS_KTLS
+	if(SUCCESS == ret) {
+		_iot_tls_ktls_enable(tlsDataParams);
+	}
+#endif
+
 	return (IoT_Error_t) ret;
 }
 
@@ -287,10 +588,21 @@ IoT_Error_t iot_tls_write(Network *pNetwork, unsigned char *pMsg, size_t len, Ti
 	int ret = 0;
 	TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
 
+#ifdef ENABLE_IOT_TLS_KTLS
+	if(tlsDataParams->isKtlsTx) {
+		return _iot_tls_ktls_write(tlsDataParams, pMsg, len, timer, written_len);
+	}
+#endif
+
 	for(written_so_far = 0, frags = 0;
 		written_so_far < len && !has_timer_expired(timer); written_so_far += ret, frags++) {
-		while(!has_timer_expired(timer) &&
-			  (ret = mbedtls_ssl_write(&(tlsDataParams->ssl), pMsg + written_so_far, len - written_so_far)) <= 0) {
+		while(!has_timer_expired(timer)) {
+			_iot_tls_lock(tlsDataParams);
+			ret = mbedtls_ssl_write(&(tlsDataParams->ssl), pMsg + written_so_far, len - written_so_far);
+			_iot_tls_unlock(tlsDataParams);
+			if(ret > 0) {
+				break;
+			}
 			if(ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
 				IOT_ERROR(" failed\n  ! mbedtls_ssl_write returned -0x%x\n\n", -ret);
 				/* All other negative return values indicate connection needs to be reset.
@@ -320,9 +632,22 @@ IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Tim
 	size_t rxLen = 0;
 	int ret;
 
+#ifdef ENABLE_IOT_TLS_KTLS
+	if(pNetwork->tlsDataParams.isKtlsRx) {
+		return _iot_tls_ktls_read(&(pNetwork->tlsDataParams), pMsg, len, timer, read_len);
+	}
+#endif
+
 	while (len > 0) {
 		// This read will timeout after IOT_SSL_READ_TIMEOUT if there's no data to be read
-		ret = mbedtls_ssl_read(ssl, pMsg, len);
+		ret = _iot_tls_poll_read(&(pNetwork->tlsDataParams));
+		if (ret > 0) {
+			_iot_tls_lock(&(pNetwork->tlsDataParams));
+			ret = mbedtls_ssl_read(ssl, pMsg, len);
+			_iot_tls_unlock(&(pNetwork->tlsDataParams));
+		} else if (ret == 0) {
+			ret = MBEDTLS_ERR_SSL_TIMEOUT;
+		}
 		if (ret > 0) {
 			rxLen += ret;
 			pMsg += ret;
@@ -352,9 +677,19 @@ IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Tim
 IoT_Error_t iot_tls_disconnect(Network *pNetwork) {
 	mbedtls_ssl_context *ssl = &(pNetwork->tlsDataParams.ssl);
 	int ret = 0;
+
+#ifdef ENABLE_IOT_TLS_KTLS
+	if(pNetwork->tlsDataParams.isKtlsTx) {
+		_iot_tls_ktls_close_notify(&(pNetwork->tlsDataParams));
+		return SUCCESS;
+	}
+#endif
+
+	_iot_tls_lock(&(pNetwork->tlsDataParams));
 	do {
 		ret = mbedtls_ssl_close_notify(ssl);
 	} while(ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+	_iot_tls_unlock(&(pNetwork->tlsDataParams));
 
 	/* All other negative return values indicate connection needs to be reset.
 	 * No further action required since this is disconnect call */
@@ -28,6 +28,8 @@
 #include "mbedtls/debug.h"
 #include "mbedtls/timing.h"
 
+#include "threads_interface.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -48,6 +50,18 @@ typedef struct _TLSDataParams {
 	mbedtls_x509_crt clicert;
 	mbedtls_pk_context pkey;
 	mbedtls_net_context server_fd;
+#ifdef _ENABLE_THREAD_SUPPORT_
+	IoT_Mutex_t ssl_mutex; ///< Lets one thread read while another writes, set up by iot_tls_init
+#endif
+#ifdef ENABLE_IOT_TLS_KTLS
+	bool isKtlsTx; ///< Records sent by the kernel after the handshake
+	bool isKtlsRx; ///< Records received by the kernel after the handshake
+	size_t ktlsKeyLen; ///< Length of each write key below, 0 if the keys cannot be offloaded
+	unsigned char ktlsClientKey[32];
+	unsigned char ktlsServerKey[32];
+	unsigned char ktlsClientSalt[4]; ///< Implicit part of the AES-GCM nonce
+	unsigned char ktlsServerSalt[4];
+#endif
 }TLSDataParams;
 
 #define IOTSDKC_NETWORK_MBEDTLS_PLATFORM_H_H
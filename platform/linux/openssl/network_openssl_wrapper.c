@@ -0,0 +1,585 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <timer_platform.h>
+
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#include "aws_iot_error.h"
+#include "aws_iot_log.h"
+#include "network_interface.h"
+#include "network_platform.h"
+
+/* This is the value used for ssl read timeout */
+#define IOT_SSL_READ_TIMEOUT 10
+
+/* Locations starting with this are PEM data instead of a file name */
+#define IOT_TLS_PEM_PREFIX "-----BEGIN"
+
+/* AWS IoT ALPN protocol for MQTT on port 443, in wire format with the length first */
+static const unsigned char alpnProtocols[] = { 14, 'x', '-', 'a', 'm', 'z', 'n', '-', 'm', 'q', 't', 't', '-', 'c', 'a' };
+
+static void _iot_tls_log_error(const char *pWhat) {
+#ifdef ENABLE_IOT_ERROR
+	char buf[256];
+
+	ERR_error_string_n(ERR_get_error(), buf, sizeof(buf));
+	IOT_ERROR(" failed\n  ! %s: %s\n\n", pWhat, buf);
+#else
+	/* Nothing is logged without error logging, the queue is only cleared */
+	IOT_UNUSED(pWhat);
+#endif
+	ERR_clear_error();
+}
+
+/* Password callback for encrypted PEM data. Without one OpenSSL asks for the password on the
+ * terminal and blocks the connect, an encrypted key fails to load instead, as with mbedTLS */
+static int _iot_tls_no_password(char *pBuf, int size, int rwflag, void *pUserData) {
+	IOT_UNUSED(pBuf);
+	IOT_UNUSED(size);
+	IOT_UNUSED(rwflag);
+	IOT_UNUSED(pUserData);
+
+	return 0;
+}
+
+static bool _iot_tls_is_pem(const char *pLocation) {
+	return (0 == strncmp(pLocation, IOT_TLS_PEM_PREFIX, sizeof(IOT_TLS_PEM_PREFIX) - 1));
+}
+
+static IoT_Error_t _iot_tls_load_root_ca(SSL_CTX *pCtx, const char *pLocation) {
+	X509_STORE *pStore;
+	X509 *pCert;
+	BIO *pBio;
+	int count = 0;
+
+	if(!_iot_tls_is_pem(pLocation)) {
+		if(1 != SSL_CTX_load_verify_locations(pCtx, pLocation, NULL)) {
+			_iot_tls_log_error("SSL_CTX_load_verify_locations");
+			return NETWORK_X509_ROOT_CRT_PARSE_ERROR;
+		}
+		return SUCCESS;
+	}
+
+	pBio = BIO_new_mem_buf(pLocation, -1);
+	if(NULL == pBio) {
+		return NETWORK_X509_ROOT_CRT_PARSE_ERROR;
+	}
+	pStore = SSL_CTX_get_cert_store(pCtx);
+	while(NULL != (pCert = PEM_read_bio_X509(pBio, NULL, _iot_tls_no_password, NULL))) {
+		if(1 == X509_STORE_add_cert(pStore, pCert)) {
+			count++;
+		}
+		X509_free(pCert);
+	}
+	/* The loop ends with a "no start line" error at the end of the data */
+	ERR_clear_error();
+	BIO_free(pBio);
+
+	return (0 < count) ? SUCCESS : NETWORK_X509_ROOT_CRT_PARSE_ERROR;
+}
+
+static IoT_Error_t _iot_tls_load_device_cert(SSL_CTX *pCtx, const char *pLocation) {
+	X509 *pCert;
+	BIO *pBio;
+	int ret;
+
+	if(!_iot_tls_is_pem(pLocation)) {
+		if(1 != SSL_CTX_use_certificate_chain_file(pCtx, pLocation)) {
+			_iot_tls_log_error("SSL_CTX_use_certificate_chain_file");
+			return NETWORK_X509_DEVICE_CRT_PARSE_ERROR;
+		}
+		return SUCCESS;
+	}
+
+	pBio = BIO_new_mem_buf(pLocation, -1);
+	if(NULL == pBio) {
+		return NETWORK_X509_DEVICE_CRT_PARSE_ERROR;
+	}
+	pCert = PEM_read_bio_X509(pBio, NULL, _iot_tls_no_password, NULL);
+	ret = (NULL != pCert) ? SSL_CTX_use_certificate(pCtx, pCert) : 0;
+	X509_free(pCert);
+	/* Any further certificates are the chain of the device certificate */
+	while(1 == ret && NULL != (pCert = PEM_read_bio_X509(pBio, NULL, _iot_tls_no_password, NULL))) {
+		if(1 != SSL_CTX_add0_chain_cert(pCtx, pCert)) {
+			X509_free(pCert);
+			ret = 0;
+		}
+	}
+	BIO_free(pBio);
+
+	if(1 != ret) {
+		_iot_tls_log_error("SSL_CTX_use_certificate");
+		return NETWORK_X509_DEVICE_CRT_PARSE_ERROR;
+	}
+	ERR_clear_error();
+
+	return SUCCESS;
+}
+
+static IoT_Error_t _iot_tls_load_private_key(SSL_CTX *pCtx, const char *pLocation) {
+	EVP_PKEY *pKey;
+	BIO *pBio;
+	int ret;
+
+	if(!_iot_tls_is_pem(pLocation)) {
+		ret = SSL_CTX_use_PrivateKey_file(pCtx, pLocation, SSL_FILETYPE_PEM);
+	} else {
+		pBio = BIO_new_mem_buf(pLocation, -1);
+		if(NULL == pBio) {
+			return NETWORK_PK_PRIVATE_KEY_PARSE_ERROR;
+		}
+		pKey = PEM_read_bio_PrivateKey(pBio, NULL, _iot_tls_no_password, NULL);
+		ret = (NULL != pKey) ? SSL_CTX_use_PrivateKey(pCtx, pKey) : 0;
+		EVP_PKEY_free(pKey);
+		BIO_free(pBio);
+	}
+
+	if(1 != ret || 1 != SSL_CTX_check_private_key(pCtx)) {
+		_iot_tls_log_error("SSL_CTX_use_PrivateKey");
+		return NETWORK_PK_PRIVATE_KEY_PARSE_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+static IoT_Error_t _iot_tls_tcp_connect(TLSDataParams *tlsDataParams, const char *pHost, uint16_t port) {
+	struct addrinfo hints, *pAddrList, *pAddr;
+	char portBuffer[6];
+	int fd = -1;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	snprintf(portBuffer, sizeof(portBuffer), "%u", port);
+
+	IOT_DEBUG("  . Connecting to %s/%s...", pHost, portBuffer);
+	if(0 != getaddrinfo(pHost, portBuffer, &hints, &pAddrList)) {
+		return NETWORK_ERR_NET_UNKNOWN_HOST;
+	}
+
+	for(pAddr = pAddrList; NULL != pAddr; pAddr = pAddr->ai_next) {
+		fd = socket(pAddr->ai_family, pAddr->ai_socktype, pAddr->ai_protocol);
+		if(0 > fd) {
+			continue;
+		}
+		if(0 == connect(fd, pAddr->ai_addr, pAddr->ai_addrlen)) {
+			break;
+		}
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(pAddrList);
+
+	if(0 > fd) {
+		return NETWORK_ERR_NET_CONNECT_FAILED;
+	}
+
+	/* Reads and the handshake wait in poll, so every timeout is kept */
+	if(0 != fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK)) {
+		close(fd);
+		return NETWORK_ERR_NET_SOCKET_FAILED;
+	}
+
+	tlsDataParams->server_fd = fd;
+	IOT_DEBUG(" ok\n");
+
+	return SUCCESS;
+}
+
+/* Serializes the calls into the SSL session, OpenSSL can't read and write one session from two
+ * threads at the same time. Waiting for the socket happens outside, so a read does not hold up a write. */
+static void _iot_tls_lock(TLSDataParams *tlsDataParams) {
+#ifdef _ENABLE_THREAD_SUPPORT_
+	(void) aws_iot_thread_mutex_lock(&(tlsDataParams->ssl_mutex));
+#else
+	IOT_UNUSED(tlsDataParams);
+#endif
+}
+
+static void _iot_tls_unlock(TLSDataParams *tlsDataParams) {
+#ifdef _ENABLE_THREAD_SUPPORT_
+	(void) aws_iot_thread_mutex_unlock(&(tlsDataParams->ssl_mutex));
+#else
+	IOT_UNUSED(tlsDataParams);
+#endif
+}
+
+/* Waits until the socket is ready for what OpenSSL asked for with the SSL_get_error code.
+ * False for any other error and when the socket failed or was closed, the caller retries
+ * after a timeout or an interrupted wait */
+static bool _iot_tls_wait(TLSDataParams *tlsDataParams, int sslError, uint32_t timeout_ms) {
+	struct pollfd pfd;
+	int events;
+
+	pfd.fd = tlsDataParams->server_fd;
+	switch(sslError) {
+		case SSL_ERROR_WANT_READ:
+			pfd.events = POLLIN;
+			break;
+		case SSL_ERROR_WANT_WRITE:
+			pfd.events = POLLOUT;
+			break;
+		default:
+			return false;
+	}
+
+	pfd.revents = 0;
+
+	events = poll(&pfd, 1, (int) timeout_ms);
+	if(0 > events) {
+		if(EINTR == errno) {
+			return true;
+		}
+		IOT_ERROR(" failed\n  ! poll returned errno %d\n\n", errno);
+		return false;
+	}
+
+	/* Data still readable before a hang up is left to SSL_read, which reports the close after it */
+	if(0 != (pfd.revents & (POLLERR | POLLNVAL)) ||
+	   (0 != (pfd.revents & POLLHUP) && 0 == (pfd.revents & POLLIN))) {
+		IOT_ERROR(" failed\n  ! Socket error, poll revents 0x%x\n\n", (unsigned int) pfd.revents);
+		return false;
+	}
+
+	return true;
+}
+
+static void _iot_tls_release(TLSDataParams *tlsDataParams) {
+	if(NULL != tlsDataParams->pSsl) {
+		SSL_free(tlsDataParams->pSsl);
+		tlsDataParams->pSsl = NULL;
+	}
+	if(NULL != tlsDataParams->pCtx) {
+		SSL_CTX_free(tlsDataParams->pCtx);
+		tlsDataParams->pCtx = NULL;
+	}
+	if(0 <= tlsDataParams->server_fd) {
+		close(tlsDataParams->server_fd);
+		tlsDataParams->server_fd = -1;
+	}
+}
+
+void _iot_tls_set_connect_params(Network *pNetwork, char *pRootCALocation, char *pDeviceCertLocation,
+								 char *pDevicePrivateKeyLocation, char *pDestinationURL,
+								 uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
+	pNetwork->tlsConnectParams.DestinationPort = destinationPort;
+	pNetwork->tlsConnectParams.pDestinationURL = pDestinationURL;
+	pNetwork->tlsConnectParams.pDeviceCertLocation = pDeviceCertLocation;
+	pNetwork->tlsConnectParams.pDevicePrivateKeyLocation = pDevicePrivateKeyLocation;
+	pNetwork->tlsConnectParams.pRootCALocation = pRootCALocation;
+	pNetwork->tlsConnectParams.timeout_ms = timeout_ms;
+	pNetwork->tlsConnectParams.ServerVerificationFlag = ServerVerificationFlag;
+}
+
+void iot_tls_openssl_forget_session(TLSDataParams *pTlsDataParams) {
+	if(NULL != pTlsDataParams && NULL != pTlsDataParams->pSession) {
+		SSL_SESSION_free(pTlsDataParams->pSession);
+		pTlsDataParams->pSession = NULL;
+	}
+}
+
+IoT_Error_t iot_tls_init(Network *pNetwork, char *pRootCALocation, char *pDeviceCertLocation,
+						 char *pDevicePrivateKeyLocation, char *pDestinationURL,
+						 uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
+	_iot_tls_set_connect_params(pNetwork, pRootCALocation, pDeviceCertLocation, pDevicePrivateKeyLocation,
+								pDestinationURL, destinationPort, timeout_ms, ServerVerificationFlag);
+
+	pNetwork->connect = iot_tls_connect;
+	pNetwork->read = iot_tls_read;
+	pNetwork->write = iot_tls_write;
+	pNetwork->disconnect = iot_tls_disconnect;
+	pNetwork->isConnected = iot_tls_is_connected;
+	pNetwork->destroy = iot_tls_destroy;
+
+	pNetwork->tlsDataParams.flags = 0;
+	pNetwork->tlsDataParams.pCtx = NULL;
+	pNetwork->tlsDataParams.pSsl = NULL;
+	pNetwork->tlsDataParams.server_fd = -1;
+	pNetwork->tlsDataParams.pSession = NULL;
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	return aws_iot_thread_mutex_init(&(pNetwork->tlsDataParams.ssl_mutex));
+#else
+	return SUCCESS;
+#endif
+}
+
+IoT_Error_t iot_tls_is_connected(Network *pNetwork) {
+	IOT_UNUSED(pNetwork);
+
+	/* Use this to add implementation which can check for physical layer disconnect */
+	return NETWORK_PHYSICAL_LAYER_CONNECTED;
+}
+
+IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
+	TLSDataParams *tlsDataParams = NULL;
+	X509_VERIFY_PARAM *pVerifyParam;
+	IoT_Error_t rc;
+	Timer timer;
+	int ret;
+
+	if(NULL == pNetwork) {
+		return NULL_VALUE_ERROR;
+	}
+
+	if(NULL != params) {
+		_iot_tls_set_connect_params(pNetwork, params->pRootCALocation, params->pDeviceCertLocation,
+									params->pDevicePrivateKeyLocation, params->pDestinationURL,
+									params->DestinationPort, params->timeout_ms, params->ServerVerificationFlag);
+	}
+
+	tlsDataParams = &(pNetwork->tlsDataParams);
+	_iot_tls_release(tlsDataParams);
+
+	IOT_DEBUG("  . Setting up the SSL/TLS structure...");
+	tlsDataParams->pCtx = SSL_CTX_new(TLS_client_method());
+	if(NULL == tlsDataParams->pCtx) {
+		_iot_tls_log_error("SSL_CTX_new");
+		return NETWORK_SSL_INIT_ERROR;
+	}
+	(void) SSL_CTX_set_min_proto_version(tlsDataParams->pCtx, TLS1_2_VERSION);
+	SSL_CTX_set_default_passwd_cb(tlsDataParams->pCtx, _iot_tls_no_password);
+	SSL_CTX_set_mode(tlsDataParams->pCtx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#if defined(ENABLE_IOT_TLS_KTLS) && defined(SSL_OP_ENABLE_KTLS)
+	/* OpenSSL hands the record layer to the kernel itself when it was built with kTLS */
+	SSL_CTX_set_options(tlsDataParams->pCtx, SSL_OP_ENABLE_KTLS);
+#endif
+
+	IOT_DEBUG("  . Loading the CA root certificate ...");
+	rc = _iot_tls_load_root_ca(tlsDataParams->pCtx, pNetwork->tlsConnectParams.pRootCALocation);
+	if(SUCCESS != rc) {
+		IOT_ERROR(" failed\n  !  unable to load the root CA\n\n");
+		_iot_tls_release(tlsDataParams);
+		return rc;
+	}
+
+	IOT_DEBUG("  . Loading the client cert. and key...");
+	rc = _iot_tls_load_device_cert(tlsDataParams->pCtx, pNetwork->tlsConnectParams.pDeviceCertLocation);
+	if(SUCCESS == rc) {
+		rc = _iot_tls_load_private_key(tlsDataParams->pCtx, pNetwork->tlsConnectParams.pDevicePrivateKeyLocation);
+	}
+	if(SUCCESS != rc) {
+		_iot_tls_release(tlsDataParams);
+		return rc;
+	}
+	IOT_DEBUG(" ok\n");
+
+	rc = _iot_tls_tcp_connect(tlsDataParams, pNetwork->tlsConnectParams.pDestinationURL,
+							  pNetwork->tlsConnectParams.DestinationPort);
+	if(SUCCESS != rc) {
+		IOT_ERROR(" failed\n  ! unable to connect to %s: %d\n\n", pNetwork->tlsConnectParams.pDestinationURL, rc);
+		_iot_tls_release(tlsDataParams);
+		return rc;
+	}
+
+	tlsDataParams->pSsl = SSL_new(tlsDataParams->pCtx);
+	if(NULL == tlsDataParams->pSsl || 1 != SSL_set_fd(tlsDataParams->pSsl, tlsDataParams->server_fd) ||
+	   1 != SSL_set_tlsext_host_name(tlsDataParams->pSsl, pNetwork->tlsConnectParams.pDestinationURL)) {
+		_iot_tls_log_error("SSL_new");
+		_iot_tls_release(tlsDataParams);
+		return SSL_CONNECTION_ERROR;
+	}
+
+	if(pNetwork->tlsConnectParams.ServerVerificationFlag == true) {
+		SSL_set_verify(tlsDataParams->pSsl, SSL_VERIFY_PEER, NULL);
+		pVerifyParam = SSL_get0_param(tlsDataParams->pSsl);
+		X509_VERIFY_PARAM_set_hostflags(pVerifyParam, X509_CHECK_FLAG_NO_PARTIAL_WILDCARDS);
+		if(1 != X509_VERIFY_PARAM_set1_host(pVerifyParam, pNetwork->tlsConnectParams.pDestinationURL, 0)) {
+			_iot_tls_log_error("X509_VERIFY_PARAM_set1_host");
+			_iot_tls_release(tlsDataParams);
+			return SSL_CONNECTION_ERROR;
+		}
+	} else {
+		SSL_set_verify(tlsDataParams->pSsl, SSL_VERIFY_NONE, NULL);
+	}
+
+	/* Use the AWS IoT ALPN extension for MQTT if port 443 is requested. */
+	if(443 == pNetwork->tlsConnectParams.DestinationPort) {
+		if(0 != SSL_set_alpn_protos(tlsDataParams->pSsl, alpnProtocols, sizeof(alpnProtocols))) {
+			_iot_tls_log_error("SSL_set_alpn_protos");
+			_iot_tls_release(tlsDataParams);
+			return SSL_CONNECTION_ERROR;
+		}
+	}
+
+	if(NULL != tlsDataParams->pSession) {
+		(void) SSL_set_session(tlsDataParams->pSsl, tlsDataParams->pSession);
+	}
+
+	IOT_DEBUG("  . Performing the SSL/TLS handshake...");
+	init_timer(&timer);
+	countdown_ms(&timer, pNetwork->tlsConnectParams.timeout_ms);
+	while(1 != (ret = SSL_connect(tlsDataParams->pSsl))) {
+		if(has_timer_expired(&timer)) {
+			IOT_ERROR(" failed\n  ! SSL/TLS handshake timed out\n");
+			_iot_tls_release(tlsDataParams);
+			return NETWORK_SSL_CONNECT_TIMEOUT_ERROR;
+		}
+		if(!_iot_tls_wait(tlsDataParams, SSL_get_error(tlsDataParams->pSsl, ret), left_ms(&timer))) {
+			tlsDataParams->flags = (uint32_t) SSL_get_verify_result(tlsDataParams->pSsl);
+			if(X509_V_OK != tlsDataParams->flags) {
+				IOT_ERROR(" failed\n  ! Unable to verify the server's certificate: %s\n",
+						  X509_verify_cert_error_string((long) tlsDataParams->flags));
+			}
+			_iot_tls_log_error("SSL_connect");
+			_iot_tls_release(tlsDataParams);
+			return SSL_CONNECTION_ERROR;
+		}
+	}
+
+	IOT_DEBUG(" ok\n    [ Protocol is %s ]\n    [ Ciphersuite is %s ]\n    [ Session %s ]\n",
+			  SSL_get_version(tlsDataParams->pSsl), SSL_get_cipher_name(tlsDataParams->pSsl),
+			  SSL_session_reused(tlsDataParams->pSsl) ? "resumed" : "new");
+	tlsDataParams->flags = (uint32_t) SSL_get_verify_result(tlsDataParams->pSsl);
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_write(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *written_len) {
+	TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+	size_t written_so_far = 0;
+	bool isErrorFlag = false;
+	int ret, sslError;
+
+	if(NULL == tlsDataParams->pSsl) {
+		*written_len = 0;
+		return NETWORK_SSL_WRITE_ERROR;
+	}
+
+	while(written_so_far < len && !has_timer_expired(timer)) {
+		_iot_tls_lock(tlsDataParams);
+		ret = SSL_write(tlsDataParams->pSsl, pMsg + written_so_far, (int) (len - written_so_far));
+		sslError = SSL_get_error(tlsDataParams->pSsl, ret);
+		_iot_tls_unlock(tlsDataParams);
+		if(0 < ret) {
+			written_so_far += (size_t) ret;
+		} else if(!_iot_tls_wait(tlsDataParams, sslError, IOT_SSL_READ_TIMEOUT)) {
+			_iot_tls_log_error("SSL_write");
+			/* All other errors indicate connection needs to be reset.
+			 * Will be caught in ping request so ignored here */
+			isErrorFlag = true;
+			break;
+		}
+	}
+
+	*written_len = written_so_far;
+
+	if(isErrorFlag) {
+		return NETWORK_SSL_WRITE_ERROR;
+	} else if(has_timer_expired(timer) && written_so_far != len) {
+		return NETWORK_SSL_WRITE_TIMEOUT_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *read_len) {
+	TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+	size_t rxLen = 0;
+	int ret, sslError;
+
+	if(NULL == tlsDataParams->pSsl) {
+		return NETWORK_SSL_READ_ERROR;
+	}
+
+	while(len > 0) {
+		_iot_tls_lock(tlsDataParams);
+		ret = SSL_read(tlsDataParams->pSsl, pMsg, (int) len);
+		sslError = SSL_get_error(tlsDataParams->pSsl, ret);
+		_iot_tls_unlock(tlsDataParams);
+		if(ret > 0) {
+			rxLen += (size_t) ret;
+			pMsg += ret;
+			len -= (size_t) ret;
+		} else if(!_iot_tls_wait(tlsDataParams, sslError, IOT_SSL_READ_TIMEOUT)) {
+			/* Closed by the server or a TLS error */
+			ERR_clear_error();
+			return NETWORK_SSL_READ_ERROR;
+		}
+
+		// Evaluate timeout after the read to make sure read is done at least once
+		if(has_timer_expired(timer)) {
+			break;
+		}
+	}
+
+	if(len == 0) {
+		*read_len = rxLen;
+		return SUCCESS;
+	}
+
+	if(rxLen == 0) {
+		return NETWORK_SSL_NOTHING_TO_READ;
+	} else {
+		return NETWORK_SSL_READ_TIMEOUT_ERROR;
+	}
+}
+
+IoT_Error_t iot_tls_disconnect(Network *pNetwork) {
+	TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+
+	/* Sends close_notify without waiting for the reply of the server */
+	if(NULL != tlsDataParams->pSsl) {
+		_iot_tls_lock(tlsDataParams);
+		(void) SSL_shutdown(tlsDataParams->pSsl);
+		_iot_tls_unlock(tlsDataParams);
+		ERR_clear_error();
+	}
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_destroy(Network *pNetwork) {
+	TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+	SSL_SESSION *pSession;
+
+	/* Kept for the reconnect, TLS 1.3 tickets only arrive after the handshake */
+	if(NULL != tlsDataParams->pSsl) {
+		pSession = SSL_get1_session(tlsDataParams->pSsl);
+		if(NULL != pSession && SSL_SESSION_is_resumable(pSession)) {
+			iot_tls_openssl_forget_session(tlsDataParams);
+			tlsDataParams->pSession = pSession;
+		} else if(NULL != pSession) {
+			SSL_SESSION_free(pSession);
+		}
+	}
+
+	_iot_tls_release(tlsDataParams);
+
+	return SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef IOTSDKC_NETWORK_MBEDTLS_PLATFORM_H_H
+
+#include <stdint.h>
+
+#include <openssl/ssl.h>
+
+#include "aws_iot_error.h"
+#include "threads_interface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief TLS Connection Parameters
+ *
+ * Defines a type containing TLS specific parameters to be passed down to the
+ * TLS networking layer to create a TLS secured socket.
+ *
+ * The root CA, device certificate and private key locations are either file names or PEM
+ * data in memory, anything that starts with "-----BEGIN" is parsed as PEM.
+ */
+typedef struct _TLSDataParams {
+	SSL_CTX *pCtx;
+	SSL *pSsl;
+	int server_fd;
+	uint32_t flags;
+	SSL_SESSION *pSession; ///< Session of the last connection, offered again on the next connect
+#ifdef _ENABLE_THREAD_SUPPORT_
+	IoT_Mutex_t ssl_mutex; ///< Lets one thread read while another writes, set up by iot_tls_init
+#endif
+}TLSDataParams;
+
+/**
+ * @brief Release the session kept for resumption
+ *
+ * iot_tls_destroy keeps the session of the connection so that a reconnect can resume it
+ * without a full handshake. Call this when the Network is not used anymore.
+ */
+void iot_tls_openssl_forget_session(TLSDataParams *pTlsDataParams);
+
+#define IOTSDKC_NETWORK_MBEDTLS_PLATFORM_H_H
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //IOTSDKC_NETWORK_MBEDTLS_PLATFORM_H_H
@@ -23,6 +23,8 @@ extern "C" {
 #endif
 
 #include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 /**
  * @brief Mutex Type
@@ -34,6 +36,51 @@ struct _IoT_Mutex_t {
 	pthread_mutex_t lock;
 };
 
+/**
+ * @brief Condition Variable Type
+ *
+ * definition of the Condition Variable struct. Platform specific
+ * Timed waits are measured against CLOCK_MONOTONIC
+ *
+ */
+struct _IoT_Cond_t {
+	pthread_cond_t cond;
+};
+
+/**
+ * @brief Semaphore Type
+ *
+ * definition of the Semaphore struct. Platform specific
+ *
+ */
+struct _IoT_Semaphore_t {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	uint32_t count;
+};
+
+/**
+ * @brief Event Type
+ *
+ * definition of the Event struct. Platform specific
+ *
+ */
+struct _IoT_Event_t {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool isSet;
+};
+
+/**
+ * @brief Thread ID Type
+ *
+ * definition of the Thread ID struct. Platform specific
+ *
+ */
+struct _IoT_Thread_Id_t {
+	pthread_t thread;
+};
+
 #ifdef __cplusplus
 }
 #endif
@@ -20,6 +20,57 @@
 extern "C" {
 #endif
 
+#include <errno.h>
+#include <time.h>
+
+/**
+ * @brief Initialize a pthread condition variable which times out against CLOCK_MONOTONIC
+ *
+ * Wall clock adjustments (NTP, manual changes) must not shorten or extend timed waits
+ *
+ * @param pCond - pointer to the pthread condition variable to be initialized
+ * @return int - 0 on success, pthread error code otherwise
+ */
+static int _aws_iot_thread_monotonic_cond_init(pthread_cond_t *pCond) {
+	pthread_condattr_t attr;
+	int rc;
+
+	rc = pthread_condattr_init(&attr);
+	if(0 != rc) {
+		return rc;
+	}
+
+	rc = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	if(0 == rc) {
+		rc = pthread_cond_init(pCond, &attr);
+	}
+
+	pthread_condattr_destroy(&attr);
+	return rc;
+}
+
+/**
+ * @brief Compute the CLOCK_MONOTONIC deadline timeout_ms from now
+ *
+ * @param pDeadline - output, absolute time to pass to pthread_cond_timedwait
+ * @param timeout_ms - time from now in milliseconds
+ * @return int - 0 on success, errno value otherwise
+ */
+static int _aws_iot_thread_deadline_ms(struct timespec *pDeadline, uint32_t timeout_ms) {
+	if(0 != clock_gettime(CLOCK_MONOTONIC, pDeadline)) {
+		return errno;
+	}
+
+	pDeadline->tv_sec += timeout_ms / 1000;
+	pDeadline->tv_nsec += (long) (timeout_ms % 1000) * 1000000L;
+	if(pDeadline->tv_nsec >= 1000000000L) {
+		pDeadline->tv_sec++;
+		pDeadline->tv_nsec -= 1000000000L;
+	}
+
+	return 0;
+}
+
 /**
  * @brief Initialize the provided mutex
  *
@@ -61,12 +112,14 @@ int rc = pthread_mutex_lock(&(pMutex->lock));
  * Non-Blocking, immediately returns with failure if lock attempt fails
  *
  * @param IoT_Mutex_t - pointer to the mutex to be locked
- * @return IoT_Error_t - error code indicating result of operation
+ * @return IoT_Error_t - error code indicating result of operation, MUTEX_LOCK_ERROR if another thread holds the mutex
  */
 IoT_Error_t aws_iot_thread_mutex_trylock(IoT_Mutex_t *pMutex) {
 int rc = pthread_mutex_trylock(&(pMutex->lock));
-	if(0 != rc) {
+	if(EBUSY == rc) {
 		return MUTEX_LOCK_ERROR;
+	} else if(0 != rc) {
+		return FAILURE;
 	}
 
 	return SUCCESS;
@@ -104,6 +157,356 @@ IoT_Error_t aws_iot_thread_mutex_destroy(IoT_Mutex_t *pMutex) {
 	return SUCCESS;
 }
 
+/**
+ * @brief Initialize the provided condition variable
+ *
+ * @param IoT_Cond_t - pointer to the condition variable to be initialized
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_cond_init(IoT_Cond_t *pCond) {
+	if(0 != _aws_iot_thread_monotonic_cond_init(&(pCond->cond))) {
+		return CONDITION_INIT_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+/**
+ * @brief Wait on the provided condition variable
+ *
+ * Blocking, the mutex must be locked by the caller and is locked again on return
+ *
+ * @param IoT_Cond_t - pointer to the condition variable to wait on
+ * @param IoT_Mutex_t - pointer to the mutex protecting the condition
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_cond_wait(IoT_Cond_t *pCond, IoT_Mutex_t *pMutex) {
+	if(0 != pthread_cond_wait(&(pCond->cond), &(pMutex->lock))) {
+		return CONDITION_WAIT_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+/**
+ * @brief Wait on the provided condition variable with a timeout
+ *
+ * @param IoT_Cond_t - pointer to the condition variable to wait on
+ * @param IoT_Mutex_t - pointer to the mutex protecting the condition
+ * @param uint32_t - maximum time to wait in milliseconds
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_cond_timedwait(IoT_Cond_t *pCond, IoT_Mutex_t *pMutex, uint32_t timeout_ms) {
+	struct timespec deadline;
+	int rc = _aws_iot_thread_deadline_ms(&deadline, timeout_ms);
+	if(0 == rc) {
+		rc = pthread_cond_timedwait(&(pCond->cond), &(pMutex->lock), &deadline);
+	}
+
+	if(ETIMEDOUT == rc) {
+		return THREAD_WAIT_TIMEOUT_ERROR;
+	} else if(0 != rc) {
+		return CONDITION_WAIT_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+/**
+ * @brief Wake up one thread waiting on the provided condition variable
+ *
+ * @param IoT_Cond_t - pointer to the condition variable to be signaled
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_cond_signal(IoT_Cond_t *pCond) {
+	if(0 != pthread_cond_signal(&(pCond->cond))) {
+		return CONDITION_SIGNAL_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+/**
+ * @brief Wake up all threads waiting on the provided condition variable
+ *
+ * @param IoT_Cond_t - pointer to the condition variable to be signaled
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_cond_broadcast(IoT_Cond_t *pCond) {
+	if(0 != pthread_cond_broadcast(&(pCond->cond))) {
+		return CONDITION_SIGNAL_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+/**
+ * @brief Destroy the provided condition variable
+ *
+ * @param IoT_Cond_t - pointer to the condition variable to be destroyed
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_cond_destroy(IoT_Cond_t *pCond) {
+	if(0 != pthread_cond_destroy(&(pCond->cond))) {
+		return CONDITION_DESTROY_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+/**
+ * @brief Initialize the provided semaphore
+ *
+ * Built on a mutex and a condition variable rather than sem_t, so that timed waits
+ * use the monotonic clock
+ *
+ * @param IoT_Semaphore_t - pointer to the semaphore to be initialized
+ * @param uint32_t - initial count of the semaphore
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_semaphore_init(IoT_Semaphore_t *pSemaphore, uint32_t initialCount) {
+	if(0 != pthread_mutex_init(&(pSemaphore->lock), NULL)) {
+		return MUTEX_INIT_ERROR;
+	}
+
+	if(0 != _aws_iot_thread_monotonic_cond_init(&(pSemaphore->cond))) {
+		pthread_mutex_destroy(&(pSemaphore->lock));
+		return CONDITION_INIT_ERROR;
+	}
+
+	pSemaphore->count = initialCount;
+
+	return SUCCESS;
+}
+
+/**
+ * @brief Take the provided semaphore
+ *
+ * @param IoT_Semaphore_t - pointer to the semaphore to be taken
+ * @param uint32_t - maximum time to wait in milliseconds, 0 to return immediately
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_semaphore_wait(IoT_Semaphore_t *pSemaphore, uint32_t timeout_ms) {
+	IoT_Error_t rc = SUCCESS;
+	int waitRc = 0;
+	struct timespec deadline;
+
+	if(0 != pthread_mutex_lock(&(pSemaphore->lock))) {
+		return MUTEX_LOCK_ERROR;
+	}
+
+	if(0 == pSemaphore->count) {
+		waitRc = (0 == timeout_ms) ? ETIMEDOUT : _aws_iot_thread_deadline_ms(&deadline, timeout_ms);
+	}
+
+	/* The deadline is fixed up front so spurious wakeups don't extend the wait */
+	while(0 == pSemaphore->count && 0 == waitRc) {
+		waitRc = pthread_cond_timedwait(&(pSemaphore->cond), &(pSemaphore->lock), &deadline);
+	}
+
+	if(0 < pSemaphore->count) {
+		/* A post may have raced with the timeout, take it anyway */
+		pSemaphore->count--;
+	} else if(ETIMEDOUT == waitRc) {
+		rc = THREAD_WAIT_TIMEOUT_ERROR;
+	} else {
+		rc = CONDITION_WAIT_ERROR;
+	}
+
+	if(0 != pthread_mutex_unlock(&(pSemaphore->lock))) {
+		return MUTEX_UNLOCK_ERROR;
+	}
+
+	return rc;
+}
+
+/**
+ * @brief Give the provided semaphore
+ *
+ * @param IoT_Semaphore_t - pointer to the semaphore to be given
+ * @return IoT_Error_t - error code indicating result of operation, LIMIT_EXCEEDED_ERROR if the count is at UINT32_MAX
+ */
+IoT_Error_t aws_iot_thread_semaphore_post(IoT_Semaphore_t *pSemaphore) {
+	IoT_Error_t rc = SUCCESS;
+
+	if(0 != pthread_mutex_lock(&(pSemaphore->lock))) {
+		return MUTEX_LOCK_ERROR;
+	}
+
+	if(UINT32_MAX == pSemaphore->count) {
+		/* Wrapping to 0 would lose every post */
+		rc = LIMIT_EXCEEDED_ERROR;
+	} else {
+		pSemaphore->count++;
+		if(0 != pthread_cond_signal(&(pSemaphore->cond))) {
+			rc = CONDITION_SIGNAL_ERROR;
+		}
+	}
+
+	if(0 != pthread_mutex_unlock(&(pSemaphore->lock))) {
+		return MUTEX_UNLOCK_ERROR;
+	}
+
+	return rc;
+}
+
+/**
+ * @brief Destroy the provided semaphore
+ *
+ * @param IoT_Semaphore_t - pointer to the semaphore to be destroyed
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_semaphore_destroy(IoT_Semaphore_t *pSemaphore) {
+	if(0 != pthread_cond_destroy(&(pSemaphore->cond))) {
+		return CONDITION_DESTROY_ERROR;
+	}
+
+	if(0 != pthread_mutex_destroy(&(pSemaphore->lock))) {
+		return MUTEX_DESTROY_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+/**
+ * @brief Initialize the provided event in the cleared state
+ *
+ * @param IoT_Event_t - pointer to the event to be initialized
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_event_init(IoT_Event_t *pEvent) {
+	if(0 != pthread_mutex_init(&(pEvent->lock), NULL)) {
+		return MUTEX_INIT_ERROR;
+	}
+
+	if(0 != _aws_iot_thread_monotonic_cond_init(&(pEvent->cond))) {
+		pthread_mutex_destroy(&(pEvent->lock));
+		return CONDITION_INIT_ERROR;
+	}
+
+	pEvent->isSet = false;
+
+	return SUCCESS;
+}
+
+/**
+ * @brief Wait for the provided event to be set
+ *
+ * @param IoT_Event_t - pointer to the event to wait on
+ * @param uint32_t - maximum time to wait in milliseconds, 0 to return immediately
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_event_wait(IoT_Event_t *pEvent, uint32_t timeout_ms) {
+	IoT_Error_t rc = SUCCESS;
+	int waitRc = 0;
+	struct timespec deadline;
+
+	if(0 != pthread_mutex_lock(&(pEvent->lock))) {
+		return MUTEX_LOCK_ERROR;
+	}
+
+	if(false == pEvent->isSet) {
+		waitRc = (0 == timeout_ms) ? ETIMEDOUT : _aws_iot_thread_deadline_ms(&deadline, timeout_ms);
+	}
+
+	/* The deadline is fixed up front so spurious wakeups don't extend the wait */
+	while(false == pEvent->isSet && 0 == waitRc) {
+		waitRc = pthread_cond_timedwait(&(pEvent->cond), &(pEvent->lock), &deadline);
+	}
+
+	if(false == pEvent->isSet) {
+		rc = (ETIMEDOUT == waitRc) ? THREAD_WAIT_TIMEOUT_ERROR : CONDITION_WAIT_ERROR;
+	}
+
+	if(0 != pthread_mutex_unlock(&(pEvent->lock))) {
+		return MUTEX_UNLOCK_ERROR;
+	}
+
+	return rc;
+}
+
+/**
+ * @brief Set the provided event and wake up all waiting threads
+ *
+ * @param IoT_Event_t - pointer to the event to be set
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_event_set(IoT_Event_t *pEvent) {
+	IoT_Error_t rc = SUCCESS;
+
+	if(0 != pthread_mutex_lock(&(pEvent->lock))) {
+		return MUTEX_LOCK_ERROR;
+	}
+
+	pEvent->isSet = true;
+	if(0 != pthread_cond_broadcast(&(pEvent->cond))) {
+		rc = CONDITION_SIGNAL_ERROR;
+	}
+
+	if(0 != pthread_mutex_unlock(&(pEvent->lock))) {
+		return MUTEX_UNLOCK_ERROR;
+	}
+
+	return rc;
+}
+
+/**
+ * @brief Clear the provided event
+ *
+ * @param IoT_Event_t - pointer to the event to be cleared
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_event_clear(IoT_Event_t *pEvent) {
+	if(0 != pthread_mutex_lock(&(pEvent->lock))) {
+		return MUTEX_LOCK_ERROR;
+	}
+
+	pEvent->isSet = false;
+
+	if(0 != pthread_mutex_unlock(&(pEvent->lock))) {
+		return MUTEX_UNLOCK_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+/**
+ * @brief Destroy the provided event
+ *
+ * @param IoT_Event_t - pointer to the event to be destroyed
+ * @return IoT_Error_t - error code indicating result of operation
+ */
+IoT_Error_t aws_iot_thread_event_destroy(IoT_Event_t *pEvent) {
+	if(0 != pthread_cond_destroy(&(pEvent->cond))) {
+		return CONDITION_DESTROY_ERROR;
+	}
+
+	if(0 != pthread_mutex_destroy(&(pEvent->lock))) {
+		return MUTEX_DESTROY_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+/**
+ * @brief Get the ID of the calling thread
+ *
+ * @param IoT_Thread_Id_t - pointer to the thread ID to be set
+ */
+void aws_iot_thread_id_get_current(IoT_Thread_Id_t *pThreadId) {
+	pThreadId->thread = pthread_self();
+}
+
+/**
+ * @brief Check whether a thread ID is the one of the calling thread
+ *
+ * @param IoT_Thread_Id_t - pointer to a thread ID set by aws_iot_thread_id_get_current
+ * @return bool - true if the ID is the one of the calling thread
+ */
+bool aws_iot_thread_id_is_current(const IoT_Thread_Id_t *pThreadId) {
+	return (0 != pthread_equal(pThreadId->thread, pthread_self()));
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_arena.c
+ * @brief Bump allocator over caller-supplied memory
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "aws_iot_arena.h"
+#include "aws_iot_log.h"
+
+IoT_Error_t aws_iot_arena_init(IoT_Arena_t *pArena, void *pMemory, size_t size) {
+	FUNC_ENTRY;
+
+	if(NULL == pArena || NULL == pMemory || 0 == size) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	pArena->pBase = (unsigned char *) pMemory;
+	pArena->size = size;
+	pArena->used = 0;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+void *aws_iot_arena_alloc(IoT_Arena_t *pArena, size_t size) {
+	uintptr_t next;
+	size_t padding;
+
+	if(NULL == pArena || NULL == pArena->pBase || 0 == size) {
+		return NULL;
+	}
+
+	/* Align the address rather than the offset, the region itself may be unaligned */
+	next = (uintptr_t) (pArena->pBase + pArena->used);
+	padding = (size_t) ((AWS_IOT_ARENA_ALIGNMENT - (next & (AWS_IOT_ARENA_ALIGNMENT - 1))) &
+						(AWS_IOT_ARENA_ALIGNMENT - 1));
+
+	if(padding > pArena->size - pArena->used || size > pArena->size - pArena->used - padding) {
+		IOT_WARN("Arena exhausted, %u bytes requested, %u bytes left", (unsigned int) size,
+				 (unsigned int) (pArena->size - pArena->used));
+		return NULL;
+	}
+
+	pArena->used += padding;
+	next = (uintptr_t) (pArena->pBase + pArena->used);
+	pArena->used += size;
+
+	return (void *) next;
+}
+
+size_t aws_iot_arena_remaining(const IoT_Arena_t *pArena) {
+	if(NULL == pArena) {
+		return 0;
+	}
+
+	return pArena->size - pArena->used;
+}
+
+size_t aws_iot_arena_mark(const IoT_Arena_t *pArena) {
+	if(NULL == pArena) {
+		return 0;
+	}
+
+	return pArena->used;
+}
+
+void aws_iot_arena_rewind(IoT_Arena_t *pArena, size_t mark) {
+	if(NULL != pArena && mark < pArena->used) {
+		pArena->used = mark;
+	}
+}
+
+void aws_iot_arena_reset(IoT_Arena_t *pArena) {
+	if(NULL != pArena) {
+		pArena->used = 0;
+	}
+}
+
+#ifdef __cplusplus
+}
+#endif
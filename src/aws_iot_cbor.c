@@ -0,0 +1,572 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_cbor.c
+ * @brief CBOR encoding and decoding of jsonStruct_t fields
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <float.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "aws_iot_cbor.h"
+#include "aws_iot_log.h"
+
+#define CBOR_MAJOR_UNSIGNED 0
+#define CBOR_MAJOR_NEGATIVE 1
+#define CBOR_MAJOR_BYTES 2
+#define CBOR_MAJOR_TEXT 3
+#define CBOR_MAJOR_ARRAY 4
+#define CBOR_MAJOR_MAP 5
+#define CBOR_MAJOR_TAG 6
+#define CBOR_MAJOR_SIMPLE 7
+
+#define CBOR_INFO_UINT8 24
+#define CBOR_INFO_UINT16 25
+#define CBOR_INFO_UINT32 26
+#define CBOR_INFO_UINT64 27
+
+#define CBOR_SIMPLE_FALSE 20
+#define CBOR_SIMPLE_TRUE 21
+
+/** Initial bytes of the simple values and floats, major type 7 */
+#define CBOR_FALSE 0xF4
+#define CBOR_TRUE 0xF5
+#define CBOR_FLOAT32 0xFA
+#define CBOR_FLOAT64 0xFB
+
+static void _aws_iot_cbor_write_be(unsigned char *pOut, uint64_t value, size_t len) {
+	size_t i;
+
+	for(i = len; i > 0; i--) {
+		pOut[i - 1] = (unsigned char) (value & 0xFF);
+		value >>= 8;
+	}
+}
+
+/* Initial byte of an item and its argument in the shortest form */
+static bool _aws_iot_cbor_write_head(unsigned char **ppOut, const unsigned char *pEnd, uint8_t major,
+									 uint64_t value) {
+	size_t len;
+	uint8_t info;
+
+	if(value < CBOR_INFO_UINT8) {
+		len = 0;
+		info = (uint8_t) value;
+	} else if(value <= 0xFFu) {
+		len = 1;
+		info = CBOR_INFO_UINT8;
+	} else if(value <= 0xFFFFu) {
+		len = 2;
+		info = CBOR_INFO_UINT16;
+	} else if(value <= 0xFFFFFFFFu) {
+		len = 4;
+		info = CBOR_INFO_UINT32;
+	} else {
+		len = 8;
+		info = CBOR_INFO_UINT64;
+	}
+
+	if((size_t) (pEnd - *ppOut) < len + 1) {
+		return false;
+	}
+	**ppOut = (unsigned char) ((major << 5) | info);
+	_aws_iot_cbor_write_be(*ppOut + 1, value, len);
+	*ppOut += len + 1;
+
+	return true;
+}
+
+static bool _aws_iot_cbor_write_string(unsigned char **ppOut, const unsigned char *pEnd, const char *pString) {
+	size_t len = strlen(pString);
+
+	if(!_aws_iot_cbor_write_head(ppOut, pEnd, CBOR_MAJOR_TEXT, len) || (size_t) (pEnd - *ppOut) < len) {
+		return false;
+	}
+	memcpy(*ppOut, pString, len);
+	*ppOut += len;
+
+	return true;
+}
+
+static bool _aws_iot_cbor_write_integer(unsigned char **ppOut, const unsigned char *pEnd, int64_t value) {
+	if(0 <= value) {
+		return _aws_iot_cbor_write_head(ppOut, pEnd, CBOR_MAJOR_UNSIGNED, (uint64_t) value);
+	}
+
+	return _aws_iot_cbor_write_head(ppOut, pEnd, CBOR_MAJOR_NEGATIVE, (uint64_t) (-1 - value));
+}
+
+/* Written as a float when that loses nothing */
+static bool _aws_iot_cbor_write_double(unsigned char **ppOut, const unsigned char *pEnd, double value) {
+	float single;
+	uint32_t bits32;
+	uint64_t bits64;
+
+	if(value != value || value > DBL_MAX || value < -DBL_MAX ||
+	   (value <= FLT_MAX && value >= -FLT_MAX && (double) (float) value == value)) {
+		if((size_t) (pEnd - *ppOut) < 5) {
+			return false;
+		}
+		single = (float) value;
+		memcpy(&bits32, &single, sizeof(bits32));
+		**ppOut = CBOR_FLOAT32;
+		_aws_iot_cbor_write_be(*ppOut + 1, bits32, 4);
+		*ppOut += 5;
+		return true;
+	}
+
+	if((size_t) (pEnd - *ppOut) < 9) {
+		return false;
+	}
+	memcpy(&bits64, &value, sizeof(bits64));
+	**ppOut = CBOR_FLOAT64;
+	_aws_iot_cbor_write_be(*ppOut + 1, bits64, 8);
+	*ppOut += 9;
+
+	return true;
+}
+
+static IoT_Error_t _aws_iot_cbor_encode_value(unsigned char **ppOut, const unsigned char *pEnd,
+											  const jsonStruct_t *pField) {
+	bool isWritten = false;
+
+	switch(pField->type) {
+		case SHADOW_JSON_INT32:
+			isWritten = _aws_iot_cbor_write_integer(ppOut, pEnd, *(int32_t *) pField->pData);
+			break;
+		case SHADOW_JSON_INT16:
+			isWritten = _aws_iot_cbor_write_integer(ppOut, pEnd, *(int16_t *) pField->pData);
+			break;
+		case SHADOW_JSON_INT8:
+			isWritten = _aws_iot_cbor_write_integer(ppOut, pEnd, *(int8_t *) pField->pData);
+			break;
+		case SHADOW_JSON_UINT32:
+			isWritten = _aws_iot_cbor_write_integer(ppOut, pEnd, *(uint32_t *) pField->pData);
+			break;
+		case SHADOW_JSON_UINT16:
+			isWritten = _aws_iot_cbor_write_integer(ppOut, pEnd, *(uint16_t *) pField->pData);
+			break;
+		case SHADOW_JSON_UINT8:
+			isWritten = _aws_iot_cbor_write_integer(ppOut, pEnd, *(uint8_t *) pField->pData);
+			break;
+		case SHADOW_JSON_FLOAT:
+			isWritten = _aws_iot_cbor_write_double(ppOut, pEnd, *(float *) pField->pData);
+			break;
+		case SHADOW_JSON_DOUBLE:
+			isWritten = _aws_iot_cbor_write_double(ppOut, pEnd, *(double *) pField->pData);
+			break;
+		case SHADOW_JSON_BOOL:
+			if(*ppOut < pEnd) {
+				*(*ppOut)++ = *(bool *) pField->pData ? CBOR_TRUE : CBOR_FALSE;
+				isWritten = true;
+			}
+			break;
+		case SHADOW_JSON_STRING:
+			isWritten = _aws_iot_cbor_write_string(ppOut, pEnd, (const char *) pField->pData);
+			break;
+		case SHADOW_JSON_OBJECT:
+			if(0 == pField->dataLength) {
+				return NULL_VALUE_ERROR;
+			}
+			if((size_t) (pEnd - *ppOut) >= pField->dataLength) {
+				memcpy(*ppOut, pField->pData, pField->dataLength);
+				*ppOut += pField->dataLength;
+				isWritten = true;
+			}
+			break;
+		default:
+			return NULL_VALUE_ERROR;
+	}
+
+	return isWritten ? SUCCESS : MAX_SIZE_ERROR;
+}
+
+IoT_Error_t aws_iot_cbor_encode(unsigned char *pBuffer, size_t bufferLen, size_t *pEncodedLen, uint8_t count, ...) {
+	unsigned char *pOut = pBuffer;
+	const unsigned char *pEnd = pBuffer + bufferLen;
+	jsonStruct_t *pField;
+	IoT_Error_t rc = SUCCESS;
+	uint8_t i;
+	va_list pArgs;
+
+	FUNC_ENTRY;
+
+	if(NULL == pBuffer || NULL == pEncodedLen) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(!_aws_iot_cbor_write_head(&pOut, pEnd, CBOR_MAJOR_MAP, count)) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+
+	va_start(pArgs, count);
+	for(i = 0; i < count && SUCCESS == rc; i++) {
+		pField = va_arg(pArgs, jsonStruct_t *);
+		if(NULL == pField || NULL == pField->pKey || NULL == pField->pData) {
+			rc = NULL_VALUE_ERROR;
+		} else if(!_aws_iot_cbor_write_string(&pOut, pEnd, pField->pKey)) {
+			rc = MAX_SIZE_ERROR;
+		} else {
+			rc = _aws_iot_cbor_encode_value(&pOut, pEnd, pField);
+		}
+	}
+	va_end(pArgs);
+
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	*pEncodedLen = (size_t) (pOut - pBuffer);
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+/* Initial byte and argument of the next item, for major type 7 info is the additional information */
+static bool _aws_iot_cbor_read_head(const unsigned char **ppIn, const unsigned char *pEnd, uint8_t *pMajor,
+									uint8_t *pInfo, uint64_t *pValue) {
+	size_t len, i;
+
+	if(*ppIn >= pEnd) {
+		return false;
+	}
+
+	*pMajor = (uint8_t) (**ppIn >> 5);
+	*pInfo = (uint8_t) (**ppIn & 0x1F);
+	(*ppIn)++;
+
+	if(*pInfo < CBOR_INFO_UINT8) {
+		*pValue = *pInfo;
+		return true;
+	}
+	if(*pInfo > CBOR_INFO_UINT64) {
+		/* Reserved values and indefinite lengths */
+		return false;
+	}
+
+	len = (size_t) 1 << (*pInfo - CBOR_INFO_UINT8);
+	if((size_t) (pEnd - *ppIn) < len) {
+		return false;
+	}
+	*pValue = 0;
+	for(i = 0; i < len; i++) {
+		*pValue = (*pValue << 8) | (*ppIn)[i];
+	}
+	*ppIn += len;
+
+	return true;
+}
+
+static bool _aws_iot_cbor_skip(const unsigned char **ppIn, const unsigned char *pEnd, uint32_t depth) {
+	uint8_t major, info;
+	uint64_t value, i;
+
+	if(depth > AWS_IOT_CBOR_MAX_DEPTH || !_aws_iot_cbor_read_head(ppIn, pEnd, &major, &info, &value)) {
+		return false;
+	}
+
+	switch(major) {
+		case CBOR_MAJOR_BYTES:
+		case CBOR_MAJOR_TEXT:
+			if((uint64_t) (pEnd - *ppIn) < value) {
+				return false;
+			}
+			*ppIn += value;
+			break;
+		case CBOR_MAJOR_MAP:
+			if(value > UINT64_MAX / 2) {
+				return false;
+			}
+			value *= 2;
+			/* fall through */
+		case CBOR_MAJOR_ARRAY:
+			/* Every item takes at least one byte, a count larger than the input fails early */
+			for(i = 0; i < value; i++) {
+				if(!_aws_iot_cbor_skip(ppIn, pEnd, depth + 1)) {
+					return false;
+				}
+			}
+			break;
+		case CBOR_MAJOR_TAG:
+			return _aws_iot_cbor_skip(ppIn, pEnd, depth + 1);
+		default:
+			break;
+	}
+
+	return true;
+}
+
+/* Integer in [min, max] */
+static bool _aws_iot_cbor_to_integer(uint8_t major, uint64_t value, int64_t min, int64_t max, int64_t *pResult) {
+	if(CBOR_MAJOR_UNSIGNED == major && value <= (uint64_t) max) {
+		*pResult = (int64_t) value;
+		return true;
+	}
+	if(CBOR_MAJOR_NEGATIVE == major && 0 > min && value <= (uint64_t) (-(min + 1))) {
+		*pResult = -1 - (int64_t) value;
+		return true;
+	}
+
+	return false;
+}
+
+static double _aws_iot_cbor_half_to_double(uint16_t half) {
+	uint32_t sign = (uint32_t) (half & 0x8000u) << 16;
+	uint32_t exponent = (half >> 10) & 0x1Fu;
+	uint32_t mantissa = half & 0x3FFu;
+	uint32_t bits;
+	float single;
+
+	if(0 == exponent) {
+		/* Zero and subnormals, mantissa * 2^-24 */
+		return (0 != sign ? -1.0 : 1.0) * (double) mantissa / 16777216.0;
+	}
+	if(0x1F == exponent) {
+		bits = sign | 0x7F800000u | (mantissa << 13);
+	} else {
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+	memcpy(&single, &bits, sizeof(single));
+
+	return single;
+}
+
+static bool _aws_iot_cbor_to_double(uint8_t major, uint8_t info, uint64_t value, double *pResult) {
+	uint32_t bits32;
+	float single;
+
+	if(CBOR_MAJOR_UNSIGNED == major) {
+		*pResult = (double) value;
+	} else if(CBOR_MAJOR_NEGATIVE == major) {
+		*pResult = -1.0 - (double) value;
+	} else if(CBOR_MAJOR_SIMPLE == major && CBOR_INFO_UINT16 == info) {
+		*pResult = _aws_iot_cbor_half_to_double((uint16_t) value);
+	} else if(CBOR_MAJOR_SIMPLE == major && CBOR_INFO_UINT32 == info) {
+		bits32 = (uint32_t) value;
+		memcpy(&single, &bits32, sizeof(single));
+		*pResult = single;
+	} else if(CBOR_MAJOR_SIMPLE == major && CBOR_INFO_UINT64 == info) {
+		memcpy(pResult, &value, sizeof(*pResult));
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+/* Stores the value at *ppIn in the field and moves past it */
+static bool _aws_iot_cbor_decode_value(const unsigned char **ppIn, const unsigned char *pEnd, jsonStruct_t *pField) {
+	const unsigned char *pItem = *ppIn;
+	const unsigned char *pValue;
+	uint32_t valueLen;
+	uint8_t major, info;
+	uint64_t value;
+	int64_t integer;
+	double real;
+
+	if(!_aws_iot_cbor_read_head(ppIn, pEnd, &major, &info, &value)) {
+		return false;
+	}
+
+	switch(pField->type) {
+		case SHADOW_JSON_INT32:
+			if(sizeof(int32_t) > pField->dataLength ||
+			   !_aws_iot_cbor_to_integer(major, value, INT32_MIN, INT32_MAX, &integer)) {
+				return false;
+			}
+			*(int32_t *) pField->pData = (int32_t) integer;
+			break;
+		case SHADOW_JSON_INT16:
+			if(sizeof(int16_t) > pField->dataLength ||
+			   !_aws_iot_cbor_to_integer(major, value, INT16_MIN, INT16_MAX, &integer)) {
+				return false;
+			}
+			*(int16_t *) pField->pData = (int16_t) integer;
+			break;
+		case SHADOW_JSON_INT8:
+			if(sizeof(int8_t) > pField->dataLength ||
+			   !_aws_iot_cbor_to_integer(major, value, INT8_MIN, INT8_MAX, &integer)) {
+				return false;
+			}
+			*(int8_t *) pField->pData = (int8_t) integer;
+			break;
+		case SHADOW_JSON_UINT32:
+			if(sizeof(uint32_t) > pField->dataLength ||
+			   !_aws_iot_cbor_to_integer(major, value, 0, UINT32_MAX, &integer)) {
+				return false;
+			}
+			*(uint32_t *) pField->pData = (uint32_t) integer;
+			break;
+		case SHADOW_JSON_UINT16:
+			if(sizeof(uint16_t) > pField->dataLength ||
+			   !_aws_iot_cbor_to_integer(major, value, 0, UINT16_MAX, &integer)) {
+				return false;
+			}
+			*(uint16_t *) pField->pData = (uint16_t) integer;
+			break;
+		case SHADOW_JSON_UINT8:
+			if(sizeof(uint8_t) > pField->dataLength ||
+			   !_aws_iot_cbor_to_integer(major, value, 0, UINT8_MAX, &integer)) {
+				return false;
+			}
+			*(uint8_t *) pField->pData = (uint8_t) integer;
+			break;
+		case SHADOW_JSON_FLOAT:
+			if(sizeof(float) > pField->dataLength || !_aws_iot_cbor_to_double(major, info, value, &real) ||
+			   (real == real && (real > FLT_MAX || real < -FLT_MAX) && real <= DBL_MAX && real >= -DBL_MAX)) {
+				return false;
+			}
+			*(float *) pField->pData = (float) real;
+			break;
+		case SHADOW_JSON_DOUBLE:
+			if(sizeof(double) > pField->dataLength || !_aws_iot_cbor_to_double(major, info, value, &real)) {
+				return false;
+			}
+			*(double *) pField->pData = real;
+			break;
+		case SHADOW_JSON_BOOL:
+			if(sizeof(bool) > pField->dataLength || CBOR_MAJOR_SIMPLE != major ||
+			   (CBOR_SIMPLE_FALSE != info && CBOR_SIMPLE_TRUE != info)) {
+				return false;
+			}
+			*(bool *) pField->pData = (CBOR_SIMPLE_TRUE == info);
+			break;
+		case SHADOW_JSON_STRING:
+			if(CBOR_MAJOR_TEXT != major || (uint64_t) (pEnd - *ppIn) < value) {
+				return false;
+			}
+			if(NULL != pField->pData) {
+				if(value >= pField->dataLength) {
+					return false;
+				}
+				memcpy(pField->pData, *ppIn, (size_t) value);
+				((char *) pField->pData)[value] = '\0';
+			}
+			pValue = *ppIn;
+			valueLen = (uint32_t) value;
+			*ppIn += value;
+			if(NULL != pField->cb) {
+				pField->cb((const char *) pValue, valueLen, pField);
+			}
+			return true;
+		case SHADOW_JSON_OBJECT:
+			*ppIn = pItem;
+			if(!_aws_iot_cbor_skip(ppIn, pEnd, 0)) {
+				return false;
+			}
+			if(NULL != pField->pData) {
+				if((size_t) (*ppIn - pItem) > pField->dataLength) {
+					return false;
+				}
+				memcpy(pField->pData, pItem, (size_t) (*ppIn - pItem));
+			}
+			break;
+		default:
+			return false;
+	}
+
+	if(NULL != pField->cb) {
+		pField->cb((const char *) pItem, (uint32_t) (*ppIn - pItem), pField);
+	}
+
+	return true;
+}
+
+/* Stops at the first differing character, keys of other fields rarely share a prefix */
+static bool _aws_iot_cbor_key_equals(const char *pFieldKey, const unsigned char *pKey, size_t keyLen) {
+	size_t i;
+
+	for(i = 0; i < keyLen; i++) {
+		if('\0' == pFieldKey[i] || (unsigned char) pFieldKey[i] != pKey[i]) {
+			return false;
+		}
+	}
+
+	return '\0' == pFieldKey[keyLen];
+}
+
+IoT_Error_t aws_iot_cbor_decode(const unsigned char *pBuffer, size_t bufferLen, uint8_t count, ...) {
+	const unsigned char *pIn = pBuffer;
+	const unsigned char *pEnd = pBuffer + bufferLen;
+	const unsigned char *pKey;
+	jsonStruct_t *pField, *pMatch;
+	uint8_t major, info;
+	uint64_t pairs, keyLen, i;
+	uint8_t j;
+	va_list pArgs;
+
+	FUNC_ENTRY;
+
+	if(NULL == pBuffer) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(!_aws_iot_cbor_read_head(&pIn, pEnd, &major, &info, &pairs) || CBOR_MAJOR_MAP != major) {
+		FUNC_EXIT_RC(CBOR_ERROR);
+	}
+
+	for(i = 0; i < pairs; i++) {
+		pKey = pIn;
+		if(!_aws_iot_cbor_read_head(&pIn, pEnd, &major, &info, &keyLen)) {
+			FUNC_EXIT_RC(CBOR_ERROR);
+		}
+
+		/* Fields only have text keys, other keys are skipped with their value */
+		pMatch = NULL;
+		if(CBOR_MAJOR_TEXT == major) {
+			if((uint64_t) (pEnd - pIn) < keyLen) {
+				FUNC_EXIT_RC(CBOR_ERROR);
+			}
+			pKey = pIn;
+			pIn += keyLen;
+
+			va_start(pArgs, count);
+			for(j = 0; j < count && NULL == pMatch; j++) {
+				pField = va_arg(pArgs, jsonStruct_t *);
+				if(NULL != pField && NULL != pField->pKey &&
+				   _aws_iot_cbor_key_equals(pField->pKey, pKey, (size_t) keyLen)) {
+					pMatch = pField;
+				}
+			}
+			va_end(pArgs);
+		} else {
+			pIn = pKey;
+			if(!_aws_iot_cbor_skip(&pIn, pEnd, 0)) {
+				FUNC_EXIT_RC(CBOR_ERROR);
+			}
+		}
+
+		if(NULL != pMatch) {
+			if(!_aws_iot_cbor_decode_value(&pIn, pEnd, pMatch)) {
+				IOT_WARN("CBOR value of %s does not match its field", pMatch->pKey);
+				FUNC_EXIT_RC(CBOR_ERROR);
+			}
+		} else if(!_aws_iot_cbor_skip(&pIn, pEnd, 0)) {
+			FUNC_EXIT_RC(CBOR_ERROR);
+		}
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -222,6 +222,135 @@ jsmntok_t *findToken(const char *key, const char *jsonString, jsmntok_t *token)
 	return NULL;
 }
 
+/* Index after the string that starts with the quote at pos, 0 if it is not terminated */
+static size_t skipJsonString(const char *jsonString, size_t jsonLen, size_t pos) {
+	for(pos++; pos < jsonLen && '\0' != jsonString[pos]; pos++) {
+		if('\\' == jsonString[pos]) {
+			pos++;
+		} else if('"' == jsonString[pos]) {
+			return pos + 1;
+		}
+	}
+
+	return 0;
+}
+
+static size_t skipJsonWhitespace(const char *jsonString, size_t jsonLen, size_t pos) {
+	while(pos < jsonLen && (' ' == jsonString[pos] || '\t' == jsonString[pos] || '\r' == jsonString[pos] ||
+							'\n' == jsonString[pos])) {
+		pos++;
+	}
+
+	return pos;
+}
+
+/* Index after the value that starts at pos, 0 if it is not complete */
+static size_t skipJsonValue(const char *jsonString, size_t jsonLen, size_t pos) {
+	uint32_t depth = 0;
+	char c;
+
+	while(pos < jsonLen && '\0' != jsonString[pos]) {
+		c = jsonString[pos];
+		if('"' == c) {
+			pos = skipJsonString(jsonString, jsonLen, pos);
+			if(0 == pos || 0 == depth) {
+				return pos;
+			}
+			continue;
+		}
+
+		if('{' == c || '[' == c) {
+			depth++;
+		} else if('}' == c || ']' == c) {
+			if(0 == depth) {
+				return pos;
+			}
+			depth--;
+			if(0 == depth) {
+				return pos + 1;
+			}
+		} else if(0 == depth && (',' == c || ' ' == c || '\t' == c || '\r' == c || '\n' == c)) {
+			/* End of a primitive */
+			return pos;
+		}
+		pos++;
+	}
+
+	return 0;
+}
+
+static bool isPrunedJsonKey(const char *pKey, size_t keyLen, const char *const *ppPrunedKeys, uint32_t prunedKeyCount) {
+	uint32_t i;
+
+	for(i = 0; i < prunedKeyCount; i++) {
+		if(strlen(ppPrunedKeys[i]) == keyLen && 0 == strncmp(ppPrunedKeys[i], pKey, keyLen)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int32_t parseJsonPruned(jsmn_parser *pParser, const char *jsonString, size_t jsonLen, jsmntok_t *pTokens,
+						uint32_t maxTokens, const char *const *ppPrunedKeys, uint32_t prunedKeyCount,
+						uint32_t maxPruneDepth) {
+	size_t pos = 0, keyStart, memberEnd;
+	uint32_t depth = 0;
+	int32_t tokenCount;
+	char c;
+
+	jsmn_init(pParser);
+
+	while(pos < jsonLen && '\0' != jsonString[pos]) {
+		c = jsonString[pos];
+		if('"' != c) {
+			if('{' == c || '[' == c) {
+				depth++;
+			} else if(('}' == c || ']' == c) && 0 < depth) {
+				depth--;
+			}
+			pos++;
+			continue;
+		}
+
+		keyStart = pos;
+		pos = skipJsonString(jsonString, jsonLen, pos);
+		if(0 == pos) {
+			/* jsmn reports the unterminated string */
+			break;
+		}
+
+		if(0 == depth || depth > maxPruneDepth ||
+		   !isPrunedJsonKey(jsonString + keyStart + 1, pos - keyStart - 2, ppPrunedKeys, prunedKeyCount)) {
+			continue;
+		}
+
+		memberEnd = skipJsonWhitespace(jsonString, jsonLen, pos);
+		if(memberEnd >= jsonLen || ':' != jsonString[memberEnd]) {
+			/* A string value, not a key */
+			continue;
+		}
+		memberEnd = skipJsonValue(jsonString, jsonLen, skipJsonWhitespace(jsonString, jsonLen, memberEnd + 1));
+		if(0 == memberEnd) {
+			break;
+		}
+		memberEnd = skipJsonWhitespace(jsonString, jsonLen, memberEnd);
+		if(memberEnd < jsonLen && ',' == jsonString[memberEnd]) {
+			memberEnd++;
+		}
+
+		/* Tokenize up to the key, the object is still open so that part always ends with JSMN_ERROR_PART */
+		tokenCount = jsmn_parse(pParser, jsonString, keyStart, pTokens, maxTokens);
+		if(0 > tokenCount && JSMN_ERROR_PART != tokenCount) {
+			return tokenCount;
+		}
+		pParser->pos = (unsigned int) memberEnd;
+		pos = memberEnd;
+	}
+
+	return jsmn_parse(pParser, jsonString, jsonLen, pTokens, maxTokens);
+}
+
 #ifdef __cplusplus
 }
 #endif
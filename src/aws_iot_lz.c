@@ -0,0 +1,290 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_lz.c
+ * @brief Small LZ77 compressor without heap use
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "aws_iot_lz.h"
+#include "aws_iot_log.h"
+
+#define AWS_IOT_LZ_MIN_MATCH 4
+#define AWS_IOT_LZ_MAX_DISTANCE 0xFFFFu
+#define AWS_IOT_LZ_NIBBLE_MAX 15
+#define AWS_IOT_LZ_EMPTY 0xFFFFFFFFu
+
+#define AWS_IOT_LZ_HASH(value) ((uint32_t) (((value) * 2654435761u) >> (32 - AWS_IOT_LZ_HASH_BITS)))
+
+/* Positions below dictionaryLen are in the dictionary, the input follows right after it */
+typedef struct {
+	const unsigned char *pDictionary;
+	size_t dictionaryLen;
+	const unsigned char *pIn;
+} IoT_LZ_Window_t;
+
+static uint32_t _aws_iot_lz_read_32(const unsigned char *p) {
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/* Length of the match between the window at candidate and the input at pos, at most maxLen */
+static size_t _aws_iot_lz_match_length(const IoT_LZ_Window_t *pWindow, size_t candidate, size_t pos,
+									   size_t maxLen) {
+	const unsigned char *pCurrent = &(pWindow->pIn[pos - pWindow->dictionaryLen]);
+	const unsigned char *pMatch;
+	size_t len = 0;
+
+	/* A match starting in the dictionary may run on into the input */
+	while(len < maxLen && candidate + len < pWindow->dictionaryLen) {
+		if(pWindow->pDictionary[candidate + len] != pCurrent[len]) {
+			return len;
+		}
+		len++;
+	}
+
+	pMatch = &(pWindow->pIn[candidate + len - pWindow->dictionaryLen]);
+	while(len < maxLen && *pMatch == pCurrent[len]) {
+		pMatch++;
+		len++;
+	}
+
+	return len;
+}
+
+static bool _aws_iot_lz_write_length(unsigned char **ppOut, const unsigned char *pOutEnd, size_t len) {
+	while(len >= 255) {
+		if(*ppOut >= pOutEnd) {
+			return false;
+		}
+		*(*ppOut)++ = 255;
+		len -= 255;
+	}
+	if(*ppOut >= pOutEnd) {
+		return false;
+	}
+	*(*ppOut)++ = (unsigned char) len;
+
+	return true;
+}
+
+/* One block, matchLen 0 for the last block which has literals only */
+static bool _aws_iot_lz_write_block(unsigned char **ppOut, const unsigned char *pOutEnd,
+									const unsigned char *pLiterals, size_t literalLen, size_t distance,
+									size_t matchLen) {
+	unsigned char *pToken;
+	size_t matchCode = (0 == matchLen) ? 0 : matchLen - AWS_IOT_LZ_MIN_MATCH;
+
+	if(*ppOut >= pOutEnd) {
+		return false;
+	}
+	pToken = (*ppOut)++;
+	*pToken = (unsigned char) ((((literalLen < AWS_IOT_LZ_NIBBLE_MAX) ? literalLen : AWS_IOT_LZ_NIBBLE_MAX) << 4) |
+							   ((matchCode < AWS_IOT_LZ_NIBBLE_MAX) ? matchCode : AWS_IOT_LZ_NIBBLE_MAX));
+
+	if(literalLen >= AWS_IOT_LZ_NIBBLE_MAX &&
+	   !_aws_iot_lz_write_length(ppOut, pOutEnd, literalLen - AWS_IOT_LZ_NIBBLE_MAX)) {
+		return false;
+	}
+	if((size_t) (pOutEnd - *ppOut) < literalLen) {
+		return false;
+	}
+	memcpy(*ppOut, pLiterals, literalLen);
+	*ppOut += literalLen;
+
+	if(0 == matchLen) {
+		return true;
+	}
+
+	if((size_t) (pOutEnd - *ppOut) < 2) {
+		return false;
+	}
+	*(*ppOut)++ = (unsigned char) (distance & 0xFF);
+	*(*ppOut)++ = (unsigned char) (distance >> 8);
+	if(matchCode >= AWS_IOT_LZ_NIBBLE_MAX &&
+	   !_aws_iot_lz_write_length(ppOut, pOutEnd, matchCode - AWS_IOT_LZ_NIBBLE_MAX)) {
+		return false;
+	}
+
+	return true;
+}
+
+IoT_Error_t aws_iot_lz_compress(IoT_LZ_Context_t *pContext, const unsigned char *pDictionary, size_t dictionaryLen,
+								const unsigned char *pIn, size_t inLen, unsigned char *pOut, size_t outLen,
+								size_t *pWrittenLen) {
+	IoT_LZ_Window_t window;
+	unsigned char *pOutPos = pOut;
+	const unsigned char *pOutEnd = pOut + outLen;
+	size_t pos, anchor, end, candidate, matchLen, i;
+	uint32_t hash;
+
+	FUNC_ENTRY;
+
+	if(NULL == pContext || (NULL == pDictionary && 0 != dictionaryLen) || (NULL == pIn && 0 != inLen) ||
+	   NULL == pOut || NULL == pWrittenLen) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(dictionaryLen > AWS_IOT_LZ_MAX_DISTANCE) {
+		pDictionary += dictionaryLen - AWS_IOT_LZ_MAX_DISTANCE;
+		dictionaryLen = AWS_IOT_LZ_MAX_DISTANCE;
+	}
+
+	window.pDictionary = pDictionary;
+	window.dictionaryLen = dictionaryLen;
+	window.pIn = pIn;
+
+	for(i = 0; i < (1u << AWS_IOT_LZ_HASH_BITS); i++) {
+		pContext->hashTable[i] = AWS_IOT_LZ_EMPTY;
+	}
+	for(i = 0; i + AWS_IOT_LZ_MIN_MATCH <= dictionaryLen; i++) {
+		pContext->hashTable[AWS_IOT_LZ_HASH(_aws_iot_lz_read_32(&pDictionary[i]))] = (uint32_t) i;
+	}
+
+	/* Positions from here on are in the window, the input starts at dictionaryLen */
+	pos = dictionaryLen;
+	anchor = dictionaryLen;
+	end = dictionaryLen + inLen;
+	while(pos + AWS_IOT_LZ_MIN_MATCH <= end) {
+		hash = AWS_IOT_LZ_HASH(_aws_iot_lz_read_32(&pIn[pos - dictionaryLen]));
+		candidate = pContext->hashTable[hash];
+		pContext->hashTable[hash] = (uint32_t) pos;
+
+		if(AWS_IOT_LZ_EMPTY == candidate || pos - candidate > AWS_IOT_LZ_MAX_DISTANCE) {
+			pos++;
+			continue;
+		}
+
+		matchLen = _aws_iot_lz_match_length(&window, candidate, pos, end - pos);
+		if(matchLen < AWS_IOT_LZ_MIN_MATCH) {
+			pos++;
+			continue;
+		}
+
+		if(!_aws_iot_lz_write_block(&pOutPos, pOutEnd, &pIn[anchor - dictionaryLen], pos - anchor, pos - candidate,
+									matchLen)) {
+			FUNC_EXIT_RC(MAX_SIZE_ERROR);
+		}
+		pos += matchLen;
+		anchor = pos;
+		/* Remember the position just before the next search so that runs are found again */
+		if(pos + AWS_IOT_LZ_MIN_MATCH <= end + 2 && pos - 2 >= dictionaryLen) {
+			pContext->hashTable[AWS_IOT_LZ_HASH(_aws_iot_lz_read_32(&pIn[pos - 2 - dictionaryLen]))] =
+				(uint32_t) (pos - 2);
+		}
+	}
+
+	if(!_aws_iot_lz_write_block(&pOutPos, pOutEnd, &pIn[anchor - dictionaryLen], end - anchor, 0, 0)) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+
+	*pWrittenLen = (size_t) (pOutPos - pOut);
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+static bool _aws_iot_lz_read_length(const unsigned char **ppIn, const unsigned char *pInEnd, size_t *pLen) {
+	unsigned char value;
+
+	do {
+		if(*ppIn >= pInEnd) {
+			return false;
+		}
+		value = *(*ppIn)++;
+		*pLen += value;
+	} while(255 == value);
+
+	return true;
+}
+
+IoT_Error_t aws_iot_lz_decompress(const unsigned char *pDictionary, size_t dictionaryLen, const unsigned char *pIn,
+								  size_t inLen, unsigned char *pOut, size_t outLen, size_t *pWrittenLen) {
+	const unsigned char *pInEnd = pIn + inLen;
+	size_t outPos = 0;
+	size_t literalLen, matchLen, distance;
+	unsigned char token;
+
+	FUNC_ENTRY;
+
+	if((NULL == pDictionary && 0 != dictionaryLen) || NULL == pIn || NULL == pOut || NULL == pWrittenLen) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	while(pIn < pInEnd) {
+		token = *pIn++;
+
+		literalLen = (size_t) (token >> 4);
+		if(AWS_IOT_LZ_NIBBLE_MAX == literalLen && !_aws_iot_lz_read_length(&pIn, pInEnd, &literalLen)) {
+			FUNC_EXIT_RC(FAILURE);
+		}
+		if((size_t) (pInEnd - pIn) < literalLen) {
+			FUNC_EXIT_RC(FAILURE);
+		}
+		if(outLen - outPos < literalLen) {
+			FUNC_EXIT_RC(MAX_SIZE_ERROR);
+		}
+		memcpy(&pOut[outPos], pIn, literalLen);
+		pIn += literalLen;
+		outPos += literalLen;
+
+		if(pIn == pInEnd) {
+			break;
+		}
+
+		if(pInEnd - pIn < 2) {
+			FUNC_EXIT_RC(FAILURE);
+		}
+		distance = (size_t) pIn[0] | ((size_t) pIn[1] << 8);
+		pIn += 2;
+		matchLen = (size_t) (token & 0x0F);
+		if(AWS_IOT_LZ_NIBBLE_MAX == matchLen && !_aws_iot_lz_read_length(&pIn, pInEnd, &matchLen)) {
+			FUNC_EXIT_RC(FAILURE);
+		}
+		matchLen += AWS_IOT_LZ_MIN_MATCH;
+
+		if(0 == distance || distance > outPos + dictionaryLen) {
+			FUNC_EXIT_RC(FAILURE);
+		}
+		if(outLen - outPos < matchLen) {
+			FUNC_EXIT_RC(MAX_SIZE_ERROR);
+		}
+
+		/* Byte by byte, the match may overlap the bytes it produces */
+		while(0 < matchLen && distance > outPos) {
+			pOut[outPos] = pDictionary[dictionaryLen - (distance - outPos)];
+			outPos++;
+			matchLen--;
+		}
+		while(0 < matchLen) {
+			pOut[outPos] = pOut[outPos - distance];
+			outPos++;
+			matchLen--;
+		}
+	}
+
+	*pWrittenLen = outPos;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,226 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_mqtt_batch.c
+ * @brief Batching publisher for telemetry samples
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+
+#include "aws_iot_mqtt_batch.h"
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_client_common_internal.h"
+#include "aws_iot_log.h"
+
+/** Largest sample of BATCH_FORMAT_LENGTH_PREFIXED */
+#define AWS_IOT_BATCH_MAX_RECORD_LEN 0xFFFFu
+/** Packet id and the largest MQTT 5.0 publish properties the client sends, a topic alias */
+#define AWS_IOT_BATCH_PUBLISH_OVERHEAD (2 + 4)
+
+static void _aws_iot_mqtt_batch_reset(IoT_Batch_Publisher_t *pBatch) {
+	pBatch->len = 0;
+	pBatch->sampleCount = 0;
+	pBatch->isFlushPending = false;
+	if(BATCH_FORMAT_JSON_ARRAY == pBatch->params.format) {
+		pBatch->params.pBuffer[0] = '[';
+		pBatch->len = 1;
+	}
+}
+
+/* Bytes the buffer needs for one more sample, including the separator and the closing bracket */
+static size_t _aws_iot_mqtt_batch_space_needed(const IoT_Batch_Publisher_t *pBatch, size_t sampleLen) {
+	if(BATCH_FORMAT_JSON_ARRAY == pBatch->params.format) {
+		return sampleLen + ((0 == pBatch->sampleCount) ? 0 : 1) + 1;
+	}
+
+	return sampleLen + 2;
+}
+
+/* Payload bytes a batch can hold, the buffer or less when the server set an MQTT 5.0 Maximum Packet Size */
+static size_t _aws_iot_mqtt_batch_capacity(const IoT_Batch_Publisher_t *pBatch) {
+	uint32_t maxPacketSize = pBatch->pClient->clientData.serverMaximumPacketSize;
+	/* Fixed header with the longest remaining length, topic and the variable header */
+	size_t overhead = 1 + 4 + 2 + pBatch->params.topicNameLen + AWS_IOT_BATCH_PUBLISH_OVERHEAD;
+
+	if(0 == maxPacketSize || pBatch->params.bufferLen + overhead <= maxPacketSize) {
+		return pBatch->params.bufferLen;
+	}
+
+	return (maxPacketSize > overhead) ? maxPacketSize - overhead : 0;
+}
+
+IoT_Error_t aws_iot_mqtt_batch_init(IoT_Batch_Publisher_t *pBatch, AWS_IoT_Client *pClient,
+									const IoT_Batch_Publisher_Params *pParams) {
+	uint32_t remLen;
+
+	FUNC_ENTRY;
+
+	if(NULL == pBatch || NULL == pClient || NULL == pParams || NULL == pParams->pTopicName ||
+	   0 == pParams->topicNameLen || NULL == pParams->pBuffer || 2 > pParams->bufferLen ||
+	   (QOS0 != pParams->qos && QOS1 != pParams->qos) ||
+	   (BATCH_FORMAT_JSON_ARRAY != pParams->format && BATCH_FORMAT_LENGTH_PREFIXED != pParams->format)) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	remLen = (uint32_t) (pParams->bufferLen + (size_t) pParams->topicNameLen + 2 + AWS_IOT_BATCH_PUBLISH_OVERHEAD);
+	if(aws_iot_mqtt_internal_get_final_packet_length_from_remaining_length(remLen) > pClient->clientData.writeBufSize) {
+		IOT_ERROR("Batch buffer of %u bytes does not fit in the client write buffer", (unsigned) pParams->bufferLen);
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+
+	pBatch->pClient = pClient;
+	pBatch->params = *pParams;
+	pBatch->batchCount = 0;
+	init_timer(&(pBatch->ageTimer));
+	_aws_iot_mqtt_batch_reset(pBatch);
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_mqtt_batch_append(IoT_Batch_Publisher_t *pBatch, const void *pSample, size_t sampleLen) {
+	unsigned char *ptr;
+	size_t capacity;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pBatch || NULL == pSample || 0 == sampleLen) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	/* Both formats add 2 bytes to a lone sample, the brackets or the length */
+	capacity = _aws_iot_mqtt_batch_capacity(pBatch);
+	if(sampleLen + 2 > capacity ||
+	   (BATCH_FORMAT_LENGTH_PREFIXED == pBatch->params.format && AWS_IOT_BATCH_MAX_RECORD_LEN < sampleLen)) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+
+	if((pBatch->isFlushPending && aws_iot_mqtt_is_client_connected(pBatch->pClient)) ||
+	   pBatch->len + _aws_iot_mqtt_batch_space_needed(pBatch, sampleLen) > capacity) {
+		rc = aws_iot_mqtt_batch_flush(pBatch);
+		if(SUCCESS != rc && pBatch->len + _aws_iot_mqtt_batch_space_needed(pBatch, sampleLen) > capacity) {
+			FUNC_EXIT_RC(rc);
+		}
+	}
+
+	if(0 == pBatch->sampleCount && 0 != pBatch->params.maxAge_ms) {
+		countdown_ms(&(pBatch->ageTimer), pBatch->params.maxAge_ms);
+	}
+
+	ptr = &(pBatch->params.pBuffer[pBatch->len]);
+	if(BATCH_FORMAT_JSON_ARRAY == pBatch->params.format) {
+		if(0 != pBatch->sampleCount) {
+			*ptr++ = ',';
+		}
+	} else {
+		aws_iot_mqtt_internal_write_uint_16(&ptr, (uint16_t) sampleLen);
+	}
+	memcpy(ptr, pSample, sampleLen);
+	ptr += sampleLen;
+	pBatch->len = (size_t) (ptr - pBatch->params.pBuffer);
+	pBatch->sampleCount++;
+
+	if(0 != pBatch->params.maxSamples && pBatch->sampleCount >= pBatch->params.maxSamples) {
+		/* Retried by the next append or poll while the client is disconnected or the publish fails */
+		pBatch->isFlushPending = true;
+		if(aws_iot_mqtt_is_client_connected(pBatch->pClient)) {
+			(void) aws_iot_mqtt_batch_flush(pBatch);
+		}
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_mqtt_batch_poll(IoT_Batch_Publisher_t *pBatch) {
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pBatch) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(0 == pBatch->sampleCount || !aws_iot_mqtt_is_client_connected(pBatch->pClient)) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	if(pBatch->isFlushPending || (0 != pBatch->params.maxAge_ms && has_timer_expired(&(pBatch->ageTimer)))) {
+		rc = aws_iot_mqtt_batch_flush(pBatch);
+		FUNC_EXIT_RC(rc);
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_mqtt_batch_flush(IoT_Batch_Publisher_t *pBatch) {
+	IoT_Publish_Message_Params publishParams;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pBatch) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(0 == pBatch->sampleCount) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	if(BATCH_FORMAT_JSON_ARRAY == pBatch->params.format) {
+		/* Space for the bracket is reserved by every append */
+		pBatch->params.pBuffer[pBatch->len] = ']';
+	}
+
+	publishParams.qos = pBatch->params.qos;
+	publishParams.isRetained = 0;
+	publishParams.isDup = 0;
+	publishParams.id = 0;
+	publishParams.payload = pBatch->params.pBuffer;
+	publishParams.payloadLen = pBatch->len + ((BATCH_FORMAT_JSON_ARRAY == pBatch->params.format) ? 1 : 0);
+
+	rc = aws_iot_mqtt_publish(pBatch->pClient, pBatch->params.pTopicName, pBatch->params.topicNameLen,
+							  &publishParams);
+	if(MAX_SIZE_ERROR == rc) {
+		/* The server lowered its Maximum Packet Size after the samples were added, the batch can
+		 * never be published */
+		IOT_ERROR("Batch of %u samples is larger than the server accepts, samples dropped",
+				  (unsigned) pBatch->sampleCount);
+		_aws_iot_mqtt_batch_reset(pBatch);
+		FUNC_EXIT_RC(rc);
+	}
+	if(SUCCESS != rc) {
+		IOT_WARN("Publishing a batch of %u samples failed: %d", (unsigned) pBatch->sampleCount, rc);
+		pBatch->isFlushPending = true;
+		FUNC_EXIT_RC(rc);
+	}
+
+	pBatch->batchCount++;
+	_aws_iot_mqtt_batch_reset(pBatch);
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+uint32_t aws_iot_mqtt_batch_pending_samples(const IoT_Batch_Publisher_t *pBatch) {
+	return (NULL == pBatch) ? 0 : pBatch->sampleCount;
+}
+
+#ifdef __cplusplus
+}
+#endif
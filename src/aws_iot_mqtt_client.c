@@ -69,7 +69,7 @@ ClientState aws_iot_mqtt_get_client_state(AWS_IoT_Client *pClient) {
 		return CLIENT_STATE_INVALID;
 	}
 
-	FUNC_EXIT_RC(pClient->clientStatus.clientState);
+	FUNC_EXIT_RC(AWS_IOT_MQTT_ATOMIC_LOAD(&(pClient->clientStatus.clientState)));
 }
 
 #ifdef _ENABLE_THREAD_SUPPORT_
@@ -123,6 +123,9 @@ IoT_Error_t aws_iot_mqtt_client_unlock_mutex(AWS_IoT_Client *pClient, IoT_Mutex_
 /**
  * @brief Change the state in an MQTT client
  *
+ * The transition only happens if the client is still in expectedCurrentState. When atomics
+ * are available this is a single compare-and-swap, otherwise the state_change_mutex is used.
+ *
  * @param pClient MQTT client
  * @param expectedCurrentState What the current state of the client should be
  * @param newState What the new state of the client should be
@@ -132,7 +135,7 @@ IoT_Error_t aws_iot_mqtt_client_unlock_mutex(AWS_IoT_Client *pClient, IoT_Mutex_
 IoT_Error_t aws_iot_mqtt_set_client_state(AWS_IoT_Client *pClient, ClientState expectedCurrentState,
 										  ClientState newState) {
 	IoT_Error_t rc;
-#ifdef _ENABLE_THREAD_SUPPORT_
+#if defined(_ENABLE_THREAD_SUPPORT_) && !defined(AWS_IOT_MQTT_ATOMIC_STATE_SUPPORTED)
 	IoT_Error_t threadRc = FAILURE;
 #endif
 
@@ -141,6 +144,13 @@ IoT_Error_t aws_iot_mqtt_set_client_state(AWS_IoT_Client *pClient, ClientState e
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
 
+#ifdef AWS_IOT_MQTT_ATOMIC_STATE_SUPPORTED
+	if(AWS_IOT_MQTT_ATOMIC_CAS(&(pClient->clientStatus.clientState), &expectedCurrentState, newState)) {
+		rc = SUCCESS;
+	} else {
+		rc = MQTT_UNEXPECTED_CLIENT_STATE_ERROR;
+	}
+#else
 #ifdef _ENABLE_THREAD_SUPPORT_
 	rc = aws_iot_mqtt_client_lock_mutex(pClient, &(pClient->clientData.state_change_mutex));
 	if(SUCCESS != rc) {
@@ -160,10 +170,38 @@ IoT_Error_t aws_iot_mqtt_set_client_state(AWS_IoT_Client *pClient, ClientState e
 		rc = threadRc;
 	}
 #endif
+#endif
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	/* Nobody reads anymore, a QoS 1 publish waiting for its PUBACK can read itself */
+	if(SUCCESS == rc && CLIENT_STATE_CONNECTED_IDLE == newState) {
+		aws_iot_mqtt_internal_wake_ack_waiters(pClient);
+	}
+#endif
 
 	FUNC_EXIT_RC(rc);
 }
 
+/**
+ * @brief Move an MQTT client to a new state regardless of its current state
+ *
+ * Used where the transition must happen unconditionally, e.g. after the network
+ * has been lost or once a disconnect has been sent.
+ *
+ * @param pClient MQTT client
+ * @param newState What the new state of the client should be
+ */
+void aws_iot_mqtt_force_client_state(AWS_IoT_Client *pClient, ClientState newState) {
+	FUNC_ENTRY;
+	if(NULL == pClient) {
+		FUNC_EXIT;
+		return;
+	}
+
+	AWS_IOT_MQTT_ATOMIC_STORE(&(pClient->clientStatus.clientState), newState);
+	FUNC_EXIT;
+}
+
 IoT_Error_t aws_iot_mqtt_set_connect_params(AWS_IoT_Client *pClient, IoT_Client_Connect_Params *pNewConnectParams) {
 	FUNC_ENTRY;
 	if(NULL == pClient || NULL == pNewConnectParams) {
@@ -225,16 +263,73 @@ IoT_Error_t aws_iot_mqtt_free(AWS_IoT_Client *pClient)
 		}else{
 			(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_write_mutex));
 		}
+
+		if (rc == SUCCESS)
+		{
+			rc = aws_iot_mqtt_internal_destroy_ack_waiters(pClient);
+		}else{
+			(void)aws_iot_mqtt_internal_destroy_ack_waiters(pClient);
+		}
 	#endif
 	}
 
     FUNC_EXIT_RC(rc);
 }
 
+/**
+ * @brief Pick the buffer a client uses for one direction
+ *
+ * A buffer given by the caller takes precedence, then a block of the requested size from the
+ * arena and finally the built-in buffer, if the SDK was built with one.
+ */
+static IoT_Error_t _aws_iot_mqtt_select_buffer(unsigned char *pGivenBuf, size_t givenLen, IoT_Arena_t *pArena,
+											   unsigned char *pDefaultBuf, size_t defaultLen,
+											   unsigned char **ppBuf, size_t *pBufSize) {
+	if(NULL != pGivenBuf) {
+		if(0 == givenLen) {
+			return NULL_VALUE_ERROR;
+		}
+		*ppBuf = pGivenBuf;
+		*pBufSize = givenLen;
+		return SUCCESS;
+	}
+
+	if(NULL != pArena && 0 != givenLen) {
+		*ppBuf = (unsigned char *) aws_iot_arena_alloc(pArena, givenLen);
+		if(NULL == *ppBuf) {
+			return ARENA_EXHAUSTED_ERROR;
+		}
+		*pBufSize = givenLen;
+		return SUCCESS;
+	}
+
+	if(NULL == pDefaultBuf) {
+		IOT_ERROR("No buffer given and the built-in buffers are disabled");
+		return NULL_VALUE_ERROR;
+	}
+
+	*ppBuf = pDefaultBuf;
+	*pBufSize = defaultLen;
+	return SUCCESS;
+}
+
+/**
+ * @brief Give back the blocks a failed init took from the arenas of the init params
+ *
+ * The subscription arena is rewound first, it may be the same arena as the buffer arena.
+ */
+static void _aws_iot_mqtt_init_rewind_arenas(IoT_Client_Init_Params *pInitParams, size_t bufferMark,
+											 size_t subscriptionMark) {
+	aws_iot_arena_rewind(pInitParams->pSubscriptionArena, subscriptionMark);
+	aws_iot_arena_rewind(pInitParams->pBufferArena, bufferMark);
+}
+
 IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, IoT_Client_Init_Params *pInitParams) {
-	uint32_t i;
 	IoT_Error_t rc;
 	IoT_Client_Connect_Params default_options = IoT_Client_Connect_Params_initializer;
+	unsigned char *pDefaultWriteBuf = NULL;
+	unsigned char *pDefaultReadBuf = NULL;
+	size_t bufferMark, subscriptionMark;
 
 	FUNC_ENTRY;
 
@@ -244,25 +339,70 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, IoT_Client_Init_Params *p
 		FUNC_EXIT_RC(NULL_VALUE_ERROR);
 	}
 
-	for(i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++i) {
-		pClient->clientData.messageHandlers[i].topicName = NULL;
-		pClient->clientData.messageHandlers[i].pApplicationHandler = NULL;
-		pClient->clientData.messageHandlers[i].pApplicationHandlerData = NULL;
-		pClient->clientData.messageHandlers[i].qos = QOS0;
+#ifndef DISABLE_IOT_MQTT_DEFAULT_BUFFERS
+	pDefaultWriteBuf = pClient->clientData.defaultWriteBuf;
+	pDefaultReadBuf = pClient->clientData.defaultReadBuf;
+#endif
+
+	/* A failed init must not keep blocks of the arenas, the caller may retry with the same ones */
+	bufferMark = aws_iot_arena_mark(pInitParams->pBufferArena);
+	subscriptionMark = aws_iot_arena_mark(pInitParams->pSubscriptionArena);
+
+	rc = _aws_iot_mqtt_select_buffer(pInitParams->pWriteBuf, pInitParams->writeBufLen, pInitParams->pBufferArena,
+									 pDefaultWriteBuf, AWS_IOT_MQTT_TX_BUF_LEN,
+									 &(pClient->clientData.writeBuf), &(pClient->clientData.writeBufSize));
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	rc = _aws_iot_mqtt_select_buffer(pInitParams->pReadBuf, pInitParams->readBufLen, pInitParams->pBufferArena,
+									 pDefaultReadBuf, AWS_IOT_MQTT_RX_BUF_LEN,
+									 &(pClient->clientData.readBuf), &(pClient->clientData.readBufSize));
+	if(SUCCESS != rc) {
+		_aws_iot_mqtt_init_rewind_arenas(pInitParams, bufferMark, subscriptionMark);
+		FUNC_EXIT_RC(rc);
+	}
+
+	if(0 != pInitParams->maxSubscriptions) {
+		rc = aws_iot_mqtt_internal_subscription_store_init_from_arena(&(pClient->clientData.subscriptions),
+																	  pInitParams->pSubscriptionArena,
+																	  pInitParams->maxSubscriptions);
+	} else {
+		rc = aws_iot_mqtt_internal_subscription_store_init(&(pClient->clientData.subscriptions),
+														   pClient->clientData.defaultMessageHandlers,
+														   AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS,
+														   pClient->clientData.defaultSubscriptionLinks,
+														   pClient->clientData.defaultSubscriptionBuckets,
+														   AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS);
+	}
+	if(SUCCESS != rc) {
+		_aws_iot_mqtt_init_rewind_arenas(pInitParams, bufferMark, subscriptionMark);
+		FUNC_EXIT_RC(rc);
 	}
 
 	pClient->clientData.packetTimeoutMs = pInitParams->mqttPacketTimeout_ms;
 	pClient->clientData.commandTimeoutMs = pInitParams->mqttCommandTimeout_ms;
-	pClient->clientData.writeBufSize = AWS_IOT_MQTT_TX_BUF_LEN;
-	pClient->clientData.readBufSize = AWS_IOT_MQTT_RX_BUF_LEN;
 	pClient->clientData.counterNetworkDisconnected = 0;
 	pClient->clientData.disconnectHandler = pInitParams->disconnectHandler;
 	pClient->clientData.disconnectHandlerData = pInitParams->disconnectHandlerData;
 	pClient->clientData.nextPacketId = 1;
+	pClient->clientData.serverReceiveMaximum = MQTT5_DEFAULT_RECEIVE_MAXIMUM;
+	pClient->clientData.serverMaximumPacketSize = 0;
+	pClient->clientData.serverDisconnectReason = 0;
+	aws_iot_mqtt_internal_reset_topic_aliases(&(pClient->clientData.topicAliases), 0);
+	memset(pClient->clientData.payloadCodecs, 0, sizeof(pClient->clientData.payloadCodecs));
+	pClient->clientData.pPayloadCodecPool = NULL;
+	pClient->clientData.undecodablePayloadCount = 0;
+	memset(&(pClient->clientData.duplicateWindow), 0, sizeof(pClient->clientData.duplicateWindow));
+	pClient->clientData.pRxBufferPool = NULL;
+	pClient->clientData.pInitReadBuf = NULL;
+	pClient->clientData.initReadBufSize = 0;
+	pClient->clientData.isRxBufferRetainable = false;
 
 	/* Initialize default connection options */
 	rc = aws_iot_mqtt_set_connect_params(pClient, &default_options);
 	if(SUCCESS != rc) {
+		_aws_iot_mqtt_init_rewind_arenas(pInitParams, bufferMark, subscriptionMark);
 		FUNC_EXIT_RC(rc);
 	}
 
@@ -270,22 +410,33 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, IoT_Client_Init_Params *p
 	pClient->clientData.isBlockOnThreadLockEnabled = pInitParams->isBlockOnThreadLockEnabled;
 	rc = aws_iot_thread_mutex_init(&(pClient->clientData.state_change_mutex));
 	if(SUCCESS != rc) {
+		_aws_iot_mqtt_init_rewind_arenas(pInitParams, bufferMark, subscriptionMark);
 		FUNC_EXIT_RC(rc);
 	}
 	rc = aws_iot_thread_mutex_init(&(pClient->clientData.tls_read_mutex));
 	if(SUCCESS != rc) {
 		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.state_change_mutex));
+		_aws_iot_mqtt_init_rewind_arenas(pInitParams, bufferMark, subscriptionMark);
 		FUNC_EXIT_RC(rc);
 	}
 	rc = aws_iot_thread_mutex_init(&(pClient->clientData.tls_write_mutex));
 	if(SUCCESS != rc) {
 		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_read_mutex));
 		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.state_change_mutex));
+		_aws_iot_mqtt_init_rewind_arenas(pInitParams, bufferMark, subscriptionMark);
+		FUNC_EXIT_RC(rc);
+	}
+	rc = aws_iot_mqtt_internal_init_ack_waiters(pClient);
+	if(SUCCESS != rc) {
+		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_write_mutex));
+		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_read_mutex));
+		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.state_change_mutex));
+		_aws_iot_mqtt_init_rewind_arenas(pInitParams, bufferMark, subscriptionMark);
 		FUNC_EXIT_RC(rc);
 	}
 #endif
 
-	pClient->clientStatus.isPingOutstanding = 0;
+	AWS_IOT_MQTT_ATOMIC_STORE(&(pClient->clientStatus.isPingOutstanding), false);
 	pClient->clientStatus.isAutoReconnectEnabled = pInitParams->enableAutoReconnect;
 
 	rc = iot_tls_init(&(pClient->networkStack), pInitParams->pRootCALocation, pInitParams->pDeviceCertLocation,
@@ -297,8 +448,10 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, IoT_Client_Init_Params *p
 		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_read_mutex));
 		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.state_change_mutex));
 		(void)aws_iot_thread_mutex_destroy(&(pClient->clientData.tls_write_mutex));
+		(void)aws_iot_mqtt_internal_destroy_ack_waiters(pClient);
 		#endif
-		pClient->clientStatus.clientState = CLIENT_STATE_INVALID;
+		aws_iot_mqtt_force_client_state(pClient, CLIENT_STATE_INVALID);
+		_aws_iot_mqtt_init_rewind_arenas(pInitParams, bufferMark, subscriptionMark);
 		FUNC_EXIT_RC(rc);
 	}
 
@@ -306,14 +459,35 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, IoT_Client_Init_Params *p
 	init_timer(&(pClient->pingRespTimer));
 	init_timer(&(pClient->reconnectDelayTimer));
 
-	pClient->clientStatus.clientState = CLIENT_STATE_INITIALIZED;
+	aws_iot_mqtt_force_client_state(pClient, CLIENT_STATE_INITIALIZED);
 
 	FUNC_EXIT_RC(SUCCESS);
 }
 
 uint16_t aws_iot_mqtt_get_next_packet_id(AWS_IoT_Client *pClient) {
+#ifdef AWS_IOT_MQTT_ATOMIC_STATE_SUPPORTED
+	/* QoS 1 publishes from several threads take packet IDs at the same time */
+	uint16_t packetId = AWS_IOT_MQTT_ATOMIC_LOAD(&(pClient->clientData.nextPacketId));
+	uint16_t nextPacketId;
+
+	do {
+		nextPacketId = (uint16_t) ((MAX_PACKET_ID == packetId) ? 1 : (packetId + 1));
+	} while(!AWS_IOT_MQTT_ATOMIC_CAS(&(pClient->clientData.nextPacketId), &packetId, nextPacketId));
+
+	return nextPacketId;
+#elif defined(_ENABLE_THREAD_SUPPORT_)
+	uint16_t nextPacketId;
+
+	(void) aws_iot_thread_mutex_lock(&(pClient->clientData.ack_wait_mutex));
+	nextPacketId = pClient->clientData.nextPacketId = (uint16_t) ((MAX_PACKET_ID == pClient->clientData.nextPacketId) ? 1 : (
+			pClient->clientData.nextPacketId + 1));
+	(void) aws_iot_thread_mutex_unlock(&(pClient->clientData.ack_wait_mutex));
+
+	return nextPacketId;
+#else
 	return pClient->clientData.nextPacketId = (uint16_t) ((MAX_PACKET_ID == pClient->clientData.nextPacketId) ? 1 : (
 			pClient->clientData.nextPacketId + 1));
+#endif
 }
 
 bool aws_iot_mqtt_is_client_connected(AWS_IoT_Client *pClient) {
@@ -326,7 +500,7 @@ bool aws_iot_mqtt_is_client_connected(AWS_IoT_Client *pClient) {
 		FUNC_EXIT_RC(false);
 	}
 
-	switch(pClient->clientStatus.clientState) {
+	switch(aws_iot_mqtt_get_client_state(pClient)) {
 		case CLIENT_STATE_INVALID:
 		case CLIENT_STATE_INITIALIZED:
 		case CLIENT_STATE_CONNECTING:
@@ -392,6 +566,35 @@ void aws_iot_mqtt_reset_network_disconnected_count(AWS_IoT_Client *pClient) {
 	pClient->clientData.counterNetworkDisconnected = 0;
 }
 
+uint8_t aws_iot_mqtt_get_server_disconnect_reason(AWS_IoT_Client *pClient) {
+	return pClient->clientData.serverDisconnectReason;
+}
+
+IoT_Error_t aws_iot_mqtt_set_duplicate_suppression(AWS_IoT_Client *pClient, bool isEnabled) {
+	FUNC_ENTRY;
+	if(NULL == pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	aws_iot_mqtt_internal_reset_duplicate_window(&(pClient->clientData.duplicateWindow));
+	pClient->clientData.duplicateWindow.isEnabled = isEnabled;
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_mqtt_get_duplicate_stats(AWS_IoT_Client *pClient, IoT_Duplicate_Stats_t *pStats) {
+	FUNC_ENTRY;
+	if(NULL == pClient || NULL == pStats) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	*pStats = pClient->clientData.duplicateWindow.stats;
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+void aws_iot_mqtt_reset_duplicate_stats(AWS_IoT_Client *pClient) {
+	memset(&(pClient->clientData.duplicateWindow.stats), 0, sizeof(IoT_Duplicate_Stats_t));
+}
+
 #ifdef __cplusplus
 }
 #endif
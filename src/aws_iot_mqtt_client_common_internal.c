@@ -42,10 +42,14 @@ extern "C" {
 
 #include <aws_iot_mqtt_client.h>
 #include "aws_iot_mqtt_client_common_internal.h"
+#include "aws_iot_probes.h"
 
 /** Max length of packet header */
 #define MAX_NO_OF_REMAINING_LENGTH_BYTES 4
 
+#define AWS_IOT_MQTT_DUPLICATE_FNV_OFFSET 2166136261u
+#define AWS_IOT_MQTT_DUPLICATE_FNV_PRIME 16777619u
+
 /**
  * @brief Encodes the message length according to the MQTT algorithm
  *
@@ -161,6 +165,17 @@ void aws_iot_mqtt_internal_write_uint_16(unsigned char **pptr, uint16_t anInt) {
 	(*pptr)++;
 }
 
+/**
+ * @brief Writes an integer as 4 bytes to an output buffer.
+ *
+ * @param pptr pointer to the output buffer - incremented by the number of bytes used & returned
+ * @param anInt the integer to write
+ */
+void aws_iot_mqtt_internal_write_uint_32(unsigned char **pptr, uint32_t anInt) {
+	aws_iot_mqtt_internal_write_uint_16(pptr, (uint16_t) (anInt >> 16));
+	aws_iot_mqtt_internal_write_uint_16(pptr, (uint16_t) (anInt & 0xFFFF));
+}
+
 /**
  * @brief Reads one character from the input buffer.
  *
@@ -200,6 +215,156 @@ void aws_iot_mqtt_internal_write_utf8_string(unsigned char **pptr, const char *s
 	}
 }
 
+/**
+ * @brief Reads a variable byte integer, without reading past the end of the data
+ *
+ * @param pptr pointer to the input buffer - incremented by the number of bytes used & returned
+ * @param enddata pointer to the end of the data: do not read beyond
+ * @param pValue the value read
+ * @return SUCCESS if successful, MQTT_DECODE_REMAINING_LENGTH_ERROR if not
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_read_varint(unsigned char **pptr, unsigned char *enddata,
+													  uint32_t *pValue) {
+	uint32_t multiplier = 1;
+	uint32_t len = 0;
+	unsigned char encodedByte;
+
+	*pValue = 0;
+	do {
+		if(*pptr >= enddata || MAX_NO_OF_REMAINING_LENGTH_BYTES <= len++) {
+			return MQTT_DECODE_REMAINING_LENGTH_ERROR;
+		}
+		encodedByte = aws_iot_mqtt_internal_read_char(pptr);
+		*pValue += (encodedByte & 127) * multiplier;
+		multiplier *= 128;
+	} while((encodedByte & 128) != 0);
+
+	return SUCCESS;
+}
+
+/**
+ * @brief Reads the properties of an incoming MQTT 5.0 packet
+ *
+ * Stores the properties the client acts on and skips every other one. The properties start
+ * with their length, MQTT v5.0 Specification 2.2.2.
+ *
+ * @param pptr pointer to the property length - incremented past the properties
+ * @param enddata pointer to the end of the packet: do not read beyond
+ * @param pProperties the properties read, may be NULL to only skip them
+ * @return SUCCESS if successful, FAILURE if the properties are malformed
+ */
+IoT_Error_t aws_iot_mqtt_internal_read_properties(unsigned char **pptr, unsigned char *enddata,
+												  MQTT5_Properties *pProperties) {
+	unsigned char *curdata = *pptr;
+	unsigned char *propertiesEnd;
+	unsigned char identifier;
+	uint32_t propertiesLen, skipLen, subscriptionId;
+	uint16_t value16;
+
+	if(NULL != pProperties) {
+		memset(pProperties, 0, sizeof(MQTT5_Properties));
+		pProperties->receiveMaximum = MQTT5_DEFAULT_RECEIVE_MAXIMUM;
+	}
+
+	if(SUCCESS != _aws_iot_mqtt_internal_read_varint(&curdata, enddata, &propertiesLen) ||
+	   propertiesLen > (uint32_t) (enddata - curdata)) {
+		return FAILURE;
+	}
+	propertiesEnd = curdata + propertiesLen;
+
+	while(curdata < propertiesEnd) {
+		identifier = aws_iot_mqtt_internal_read_char(&curdata);
+		skipLen = 0;
+		switch(identifier) {
+			case 0x01: /* Payload Format Indicator */
+			case 0x17: /* Request Problem Information */
+			case 0x19: /* Request Response Information */
+			case 0x24: /* Maximum QoS */
+			case 0x25: /* Retain Available */
+			case 0x28: /* Wildcard Subscription Available */
+			case 0x29: /* Subscription Identifier Available */
+			case 0x2A: /* Shared Subscription Available */
+				skipLen = 1;
+				break;
+			case MQTT5_PROPERTY_SERVER_KEEP_ALIVE:
+			case MQTT5_PROPERTY_RECEIVE_MAXIMUM:
+			case MQTT5_PROPERTY_TOPIC_ALIAS_MAXIMUM:
+			case MQTT5_PROPERTY_TOPIC_ALIAS:
+				if(2 > propertiesEnd - curdata) {
+					return FAILURE;
+				}
+				value16 = aws_iot_mqtt_internal_read_uint16_t(&curdata);
+				if(NULL != pProperties) {
+					if(MQTT5_PROPERTY_SERVER_KEEP_ALIVE == identifier) {
+						pProperties->serverKeepAlive = value16;
+						pProperties->isServerKeepAlivePresent = true;
+					} else if(MQTT5_PROPERTY_RECEIVE_MAXIMUM == identifier) {
+						pProperties->receiveMaximum = value16;
+					} else if(MQTT5_PROPERTY_TOPIC_ALIAS_MAXIMUM == identifier) {
+						pProperties->topicAliasMaximum = value16;
+					} else {
+						pProperties->topicAlias = value16;
+					}
+				}
+				break;
+			case 0x02: /* Message Expiry Interval */
+			case MQTT5_PROPERTY_SESSION_EXPIRY_INTERVAL:
+			case 0x18: /* Will Delay Interval */
+				skipLen = 4;
+				break;
+			case MQTT5_PROPERTY_MAXIMUM_PACKET_SIZE:
+				if(4 > propertiesEnd - curdata) {
+					return FAILURE;
+				}
+				if(NULL != pProperties) {
+					pProperties->maximumPacketSize = ((uint32_t) aws_iot_mqtt_internal_read_uint16_t(&curdata)) << 16;
+					pProperties->maximumPacketSize |= aws_iot_mqtt_internal_read_uint16_t(&curdata);
+				} else {
+					curdata += 4;
+				}
+				break;
+			case 0x0B: /* Subscription Identifier */
+				if(SUCCESS != _aws_iot_mqtt_internal_read_varint(&curdata, propertiesEnd, &subscriptionId)) {
+					return FAILURE;
+				}
+				break;
+			case 0x03: /* Content Type */
+			case 0x08: /* Response Topic */
+			case 0x09: /* Correlation Data */
+			case 0x12: /* Assigned Client Identifier */
+			case 0x15: /* Authentication Method */
+			case 0x16: /* Authentication Data */
+			case 0x1A: /* Response Information */
+			case 0x1C: /* Server Reference */
+			case 0x1F: /* Reason String */
+			case 0x26: /* User Property, a pair of strings */
+				if(2 > propertiesEnd - curdata) {
+					return FAILURE;
+				}
+				skipLen = aws_iot_mqtt_internal_read_uint16_t(&curdata);
+				if(0x26 == identifier) {
+					if(skipLen + 2 > (uint32_t) (propertiesEnd - curdata)) {
+						return FAILURE;
+					}
+					curdata += skipLen;
+					skipLen = aws_iot_mqtt_internal_read_uint16_t(&curdata);
+				}
+				break;
+			default:
+				/* Unknown property, the length of the rest can not be known */
+				return FAILURE;
+		}
+
+		if(skipLen > (uint32_t) (propertiesEnd - curdata)) {
+			return FAILURE;
+		}
+		curdata += skipLen;
+	}
+
+	*pptr = propertiesEnd;
+	return SUCCESS;
+}
+
 /**
  * @brief Initialize the MQTTHeader structure.
  *
@@ -296,9 +461,508 @@ IoT_Error_t aws_iot_mqtt_internal_init_header(MQTTHeader *pHeader, MessageTypes
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+/**
+ * @brief Take ownership of the outgoing data buffer of an MQTT client
+ *
+ * The write buffer is shared by every operation that sends a packet, including
+ * the PUBACK and PINGREQ sent from yield. It must be held from the moment a packet
+ * is serialized into the buffer until the packet has been sent. This is the only
+ * lock required to send a packet, so sending never has to wait for a read in progress.
+ *
+ * @param pClient MQTT client
+ *
+ * @return IoT_Error_t of mutex operation, always SUCCESS without thread support
+ */
+IoT_Error_t aws_iot_mqtt_internal_lock_write_buffer(AWS_IoT_Client *pClient) {
+	if(NULL == pClient) {
+		return NULL_VALUE_ERROR;
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	return aws_iot_mqtt_client_lock_mutex(pClient, &(pClient->clientData.tls_write_mutex));
+#else
+	return SUCCESS;
+#endif
+}
+
+/**
+ * @brief Release ownership of the outgoing data buffer of an MQTT client
+ *
+ * @param pClient MQTT client
+ *
+ * @return IoT_Error_t of mutex operation, always SUCCESS without thread support
+ */
+IoT_Error_t aws_iot_mqtt_internal_unlock_write_buffer(AWS_IoT_Client *pClient) {
+	if(NULL == pClient) {
+		return NULL_VALUE_ERROR;
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	return aws_iot_mqtt_client_unlock_mutex(pClient, &(pClient->clientData.tls_write_mutex));
+#else
+	return SUCCESS;
+#endif
+}
+
+/**
+ * @brief Open the network connection of an MQTT client
+ *
+ * Holds the outgoing data buffer, waiting for it even when the client uses trylock, so that
+ * a QoS 0 publish from another thread never writes to a connection that is being set up.
+ *
+ * @param pClient MQTT client
+ *
+ * @return IoT_Error_t of the network connect
+ */
+IoT_Error_t aws_iot_mqtt_internal_connect_network(AWS_IoT_Client *pClient) {
+	IoT_Error_t rc;
+
+	if(NULL == pClient) {
+		return NULL_VALUE_ERROR;
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	rc = aws_iot_thread_mutex_lock(&(pClient->clientData.tls_write_mutex));
+	if(SUCCESS != rc) {
+		return rc;
+	}
+#endif
+	rc = pClient->networkStack.connect(&(pClient->networkStack), NULL);
+#ifdef _ENABLE_THREAD_SUPPORT_
+	(void) aws_iot_thread_mutex_unlock(&(pClient->clientData.tls_write_mutex));
+#endif
+
+	return rc;
+}
+
+/**
+ * @brief Close and destroy the network connection of an MQTT client
+ *
+ * The client state must already say that the client is not connected. Like
+ * aws_iot_mqtt_internal_connect_network this holds the outgoing data buffer, so a sender
+ * either finishes before the connection is destroyed or sees the new state afterwards.
+ *
+ * @param pClient MQTT client
+ *
+ * @return IoT_Error_t of the network destroy
+ */
+IoT_Error_t aws_iot_mqtt_internal_close_network(AWS_IoT_Client *pClient) {
+	IoT_Error_t rc;
+
+	if(NULL == pClient) {
+		return NULL_VALUE_ERROR;
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	rc = aws_iot_thread_mutex_lock(&(pClient->clientData.tls_write_mutex));
+	if(SUCCESS != rc) {
+		return rc;
+	}
+#endif
+	(void) pClient->networkStack.disconnect(&(pClient->networkStack));
+	rc = pClient->networkStack.destroy(&(pClient->networkStack));
+#ifdef _ENABLE_THREAD_SUPPORT_
+	(void) aws_iot_thread_mutex_unlock(&(pClient->clientData.tls_write_mutex));
+	/* No PUBACK can arrive anymore */
+	aws_iot_mqtt_internal_wake_ack_waiters(pClient);
+#endif
+
+	return rc;
+}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+/**
+ * @brief Set up the QoS 1 ack waiters of an MQTT client, all entries free
+ *
+ * @param pClient MQTT client
+ *
+ * @return IoT_Error_t of the thread primitives, nothing is left initialized on failure
+ */
+IoT_Error_t aws_iot_mqtt_internal_init_ack_waiters(AWS_IoT_Client *pClient) {
+	IoT_Error_t rc;
+	uint32_t i;
+
+	rc = aws_iot_thread_mutex_init(&(pClient->clientData.ack_wait_mutex));
+	if(SUCCESS != rc) {
+		return rc;
+	}
+	rc = aws_iot_thread_semaphore_init(&(pClient->clientData.ackWaiterSlots), AWS_IOT_MQTT_NUM_ACK_WAITERS);
+	if(SUCCESS != rc) {
+		(void) aws_iot_thread_mutex_destroy(&(pClient->clientData.ack_wait_mutex));
+		return rc;
+	}
+	pClient->clientData.ackWaitersHeld = 0;
+	pClient->clientData.ackWaitersToHold = 0;
+	for(i = 0; i < AWS_IOT_MQTT_NUM_ACK_WAITERS; i++) {
+		pClient->clientData.ackWaiters[i].packetId = 0;
+		rc = aws_iot_thread_event_init(&(pClient->clientData.ackWaiters[i].event));
+		if(SUCCESS != rc) {
+			while(0 < i) {
+				i--;
+				(void) aws_iot_thread_event_destroy(&(pClient->clientData.ackWaiters[i].event));
+			}
+			(void) aws_iot_thread_semaphore_destroy(&(pClient->clientData.ackWaiterSlots));
+			(void) aws_iot_thread_mutex_destroy(&(pClient->clientData.ack_wait_mutex));
+			return rc;
+		}
+	}
+
+	return SUCCESS;
+}
+
+/**
+ * @brief Release the thread primitives of the QoS 1 ack waiters of an MQTT client
+ *
+ * @param pClient MQTT client
+ *
+ * @return SUCCESS, or the first error of destroying a primitive, all are destroyed either way
+ */
+IoT_Error_t aws_iot_mqtt_internal_destroy_ack_waiters(AWS_IoT_Client *pClient) {
+	IoT_Error_t rc, destroyRc;
+	uint32_t i;
+
+	rc = SUCCESS;
+	for(i = 0; i < AWS_IOT_MQTT_NUM_ACK_WAITERS; i++) {
+		destroyRc = aws_iot_thread_event_destroy(&(pClient->clientData.ackWaiters[i].event));
+		if(SUCCESS == rc) {
+			rc = destroyRc;
+		}
+	}
+	destroyRc = aws_iot_thread_semaphore_destroy(&(pClient->clientData.ackWaiterSlots));
+	if(SUCCESS == rc) {
+		rc = destroyRc;
+	}
+	destroyRc = aws_iot_thread_mutex_destroy(&(pClient->clientData.ack_wait_mutex));
+	if(SUCCESS == rc) {
+		rc = destroyRc;
+	}
+
+	return rc;
+}
+
+/**
+ * @brief Whether the calling thread is running subscription handlers of the client
+ *
+ * @param pClient MQTT client
+ * @param clientState Current state of the client
+ */
+static bool _aws_iot_mqtt_internal_is_callback_thread(AWS_IoT_Client *pClient, ClientState clientState) {
+	bool isCallbackThread;
+
+	if(CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN != clientState) {
+		return false;
+	}
+
+	(void) aws_iot_thread_mutex_lock(&(pClient->clientData.ack_wait_mutex));
+	isCallbackThread = aws_iot_thread_id_is_current(&(pClient->clientData.callbackThread));
+	(void) aws_iot_thread_mutex_unlock(&(pClient->clientData.ack_wait_mutex));
+
+	return isCallbackThread;
+}
+
+/**
+ * @brief Read one packet from the network for a QoS 1 publish if the calling thread may
+ *
+ * Any thread may read while the client is idle. While subscription handlers run, only the
+ * thread running them may read, the topic and payload they were given are in the read buffer.
+ *
+ * @param pClient MQTT client
+ * @param pTimer Time left for the publish
+ * @param pIsRead Output, whether the calling thread read
+ *
+ * @return SUCCESS, MQTT_NOTHING_TO_READ, or the error of reading from the network
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_read_for_ack(AWS_IoT_Client *pClient, Timer *pTimer, bool *pIsRead) {
+	IoT_Error_t rc, stateRc;
+	ClientState clientState;
+	uint8_t packetType;
+
+	*pIsRead = false;
+	clientState = aws_iot_mqtt_get_client_state(pClient);
+	if(CLIENT_STATE_CONNECTED_IDLE != clientState && !_aws_iot_mqtt_internal_is_callback_thread(pClient, clientState)) {
+		return SUCCESS;
+	}
+	if(SUCCESS != aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS)) {
+		return SUCCESS;
+	}
+
+	*pIsRead = true;
+	rc = aws_iot_mqtt_internal_cycle_read(pClient, pTimer, &packetType);
+	stateRc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS, clientState);
+	if(SUCCESS == rc) {
+		rc = stateRc;
+	}
+
+	return rc;
+}
+
+/**
+ * @brief Take an ack waiter entry for a QoS 1 publish
+ *
+ * A publish from a subscription handler reads from the network while it waits, the entries
+ * may all be taken by publishes whose PUBACK nobody else can read.
+ *
+ * @param pClient MQTT client
+ * @param packetId Packet ID of the publish
+ * @param pTimer Time left for the publish
+ * @param ppWaiter Output, the entry to pass to wait_for_ack and remove_ack_waiter
+ *
+ * @return SUCCESS, MQTT_REQUEST_TIMEOUT_ERROR if no entry became free in time, otherwise the
+ * error of the thread primitives or of reading from the network
+ */
+IoT_Error_t aws_iot_mqtt_internal_add_ack_waiter(AWS_IoT_Client *pClient, uint16_t packetId, Timer *pTimer,
+												 AckWaiter **ppWaiter) {
+	IoT_Error_t rc;
+	bool isCallbackThread, isRead;
+	uint32_t i;
+
+	while(1) {
+		isCallbackThread = _aws_iot_mqtt_internal_is_callback_thread(pClient, aws_iot_mqtt_get_client_state(pClient));
+		rc = aws_iot_thread_semaphore_wait(&(pClient->clientData.ackWaiterSlots),
+										   isCallbackThread ? 0 : left_ms(pTimer));
+		if(SUCCESS == rc) {
+			break;
+		} else if(THREAD_WAIT_TIMEOUT_ERROR != rc) {
+			return rc;
+		} else if(has_timer_expired(pTimer)) {
+			return MQTT_REQUEST_TIMEOUT_ERROR;
+		}
+		if(isCallbackThread) {
+			rc = _aws_iot_mqtt_internal_read_for_ack(pClient, pTimer, &isRead);
+			if(SUCCESS != rc && MQTT_NOTHING_TO_READ != rc) {
+				return rc;
+			}
+		}
+	}
+
+	rc = aws_iot_thread_mutex_lock(&(pClient->clientData.ack_wait_mutex));
+	if(SUCCESS != rc) {
+		(void) aws_iot_thread_semaphore_post(&(pClient->clientData.ackWaiterSlots));
+		return rc;
+	}
+	/* The semaphore guarantees a free entry */
+	for(i = 0; 0 != pClient->clientData.ackWaiters[i].packetId; i++) {
+	}
+	*ppWaiter = &(pClient->clientData.ackWaiters[i]);
+	(*ppWaiter)->packetId = packetId;
+	(*ppWaiter)->isAcked = false;
+	(*ppWaiter)->rc = SUCCESS;
+	(void) aws_iot_thread_mutex_unlock(&(pClient->clientData.ack_wait_mutex));
+
+	return SUCCESS;
+}
+
+/**
+ * @brief Give back an ack waiter entry taken with add_ack_waiter
+ *
+ * @param pClient MQTT client
+ * @param pWaiter The entry
+ */
+void aws_iot_mqtt_internal_remove_ack_waiter(AWS_IoT_Client *pClient, AckWaiter *pWaiter) {
+	bool isHeld = false;
+
+	(void) aws_iot_thread_mutex_lock(&(pClient->clientData.ack_wait_mutex));
+	pWaiter->packetId = 0;
+	/* Kept out of ackWaiterSlots while the Receive Maximum asks for more than were free */
+	if(pClient->clientData.ackWaitersHeld < pClient->clientData.ackWaitersToHold) {
+		pClient->clientData.ackWaitersHeld++;
+		isHeld = true;
+	}
+	(void) aws_iot_thread_mutex_unlock(&(pClient->clientData.ack_wait_mutex));
+	(void) aws_iot_thread_event_clear(&(pWaiter->event));
+	if(!isHeld) {
+		(void) aws_iot_thread_semaphore_post(&(pClient->clientData.ackWaiterSlots));
+	}
+}
+
+/**
+ * @brief Limit the QoS 1 publishes in flight to the Receive Maximum of the server
+ *
+ * Entries beyond the Receive Maximum are taken out of ackWaiterSlots. Entries still used by
+ * publishes of an earlier connection are taken once remove_ack_waiter gives them back.
+ *
+ * @param pClient MQTT client
+ * @param receiveMaximum Receive Maximum from the CONNACK, MQTT5_DEFAULT_RECEIVE_MAXIMUM if none
+ */
+void aws_iot_mqtt_internal_limit_ack_waiters(AWS_IoT_Client *pClient, uint16_t receiveMaximum) {
+	uint32_t limit = receiveMaximum;
+
+	if(0 == limit || AWS_IOT_MQTT_NUM_ACK_WAITERS < limit) {
+		limit = AWS_IOT_MQTT_NUM_ACK_WAITERS;
+	}
+
+	(void) aws_iot_thread_mutex_lock(&(pClient->clientData.ack_wait_mutex));
+	pClient->clientData.ackWaitersToHold = AWS_IOT_MQTT_NUM_ACK_WAITERS - limit;
+	while(pClient->clientData.ackWaitersHeld > pClient->clientData.ackWaitersToHold) {
+		(void) aws_iot_thread_semaphore_post(&(pClient->clientData.ackWaiterSlots));
+		pClient->clientData.ackWaitersHeld--;
+	}
+	while(pClient->clientData.ackWaitersHeld < pClient->clientData.ackWaitersToHold
+		  && SUCCESS == aws_iot_thread_semaphore_wait(&(pClient->clientData.ackWaiterSlots), 0)) {
+		pClient->clientData.ackWaitersHeld++;
+	}
+	(void) aws_iot_thread_mutex_unlock(&(pClient->clientData.ack_wait_mutex));
+}
+
+/**
+ * @brief Wake up every thread waiting in wait_for_ack
+ *
+ * Called when the client stops reading, so one of them can take over, and when the connection
+ * is closed.
+ *
+ * @param pClient MQTT client
+ */
+void aws_iot_mqtt_internal_wake_ack_waiters(AWS_IoT_Client *pClient) {
+	uint32_t i;
+
+	(void) aws_iot_thread_mutex_lock(&(pClient->clientData.ack_wait_mutex));
+	for(i = 0; i < AWS_IOT_MQTT_NUM_ACK_WAITERS; i++) {
+		if(0 != pClient->clientData.ackWaiters[i].packetId) {
+			(void) aws_iot_thread_event_set(&(pClient->clientData.ackWaiters[i].event));
+		}
+	}
+	(void) aws_iot_thread_mutex_unlock(&(pClient->clientData.ack_wait_mutex));
+}
+
+/**
+ * @brief Hand the PUBACK in the read buffer to the publish waiting for it
+ *
+ * A PUBACK nobody waits for anymore, e.g. because the publish timed out, is dropped.
+ *
+ * @param pClient MQTT client that read the PUBACK
+ *
+ * @return SUCCESS, or the error of deserializing the PUBACK
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_deliver_puback(AWS_IoT_Client *pClient) {
+	IoT_Error_t rc;
+	uint16_t packetId = 0;
+	uint32_t i;
+
+	rc = aws_iot_mqtt_internal_deserialize_puback(pClient, &packetId);
+	if(SUCCESS != rc && MQTT_REQUEST_REJECTED_ERROR != rc) {
+		return rc;
+	}
+
+	(void) aws_iot_thread_mutex_lock(&(pClient->clientData.ack_wait_mutex));
+	for(i = 0; i < AWS_IOT_MQTT_NUM_ACK_WAITERS; i++) {
+		if(packetId == pClient->clientData.ackWaiters[i].packetId) {
+			pClient->clientData.ackWaiters[i].isAcked = true;
+			pClient->clientData.ackWaiters[i].rc = rc;
+			(void) aws_iot_thread_event_set(&(pClient->clientData.ackWaiters[i].event));
+			break;
+		}
+	}
+	(void) aws_iot_thread_mutex_unlock(&(pClient->clientData.ack_wait_mutex));
+
+	return SUCCESS;
+}
+
+/**
+ * @brief Wait for the PUBACK of a QoS 1 publish
+ *
+ * While no other thread reads from the network, e.g. in yield or while subscribing, the
+ * waiting thread moves the client to CLIENT_STATE_CONNECTED_PUBLISH_IN_PROGRESS and reads
+ * itself, handing over PUBACKs for other publishes. A publish from a subscription handler
+ * reads on the thread that runs the handlers. Otherwise it sleeps on the event of its entry
+ * until the PUBACK is handed over or the reading thread is done.
+ *
+ * @param pClient MQTT client
+ * @param pWaiter Entry of the publish
+ * @param pTimer Time left for the publish
+ *
+ * @return Result of the PUBACK, MQTT_REQUEST_TIMEOUT_ERROR, NETWORK_DISCONNECTED_ERROR,
+ * or the error of reading from the network
+ */
+IoT_Error_t aws_iot_mqtt_internal_wait_for_ack(AWS_IoT_Client *pClient, AckWaiter *pWaiter, Timer *pTimer) {
+	IoT_Error_t rc;
+	bool isAcked, isRead;
+
+	FUNC_ENTRY;
+
+	while(1) {
+		/* Cleared before checking, so a wake up from now on is not lost */
+		rc = aws_iot_thread_event_clear(&(pWaiter->event));
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+
+		(void) aws_iot_thread_mutex_lock(&(pClient->clientData.ack_wait_mutex));
+		isAcked = pWaiter->isAcked;
+		rc = pWaiter->rc;
+		(void) aws_iot_thread_mutex_unlock(&(pClient->clientData.ack_wait_mutex));
+		if(isAcked) {
+			FUNC_EXIT_RC(rc);
+		}
+		if(has_timer_expired(pTimer)) {
+			FUNC_EXIT_RC(MQTT_REQUEST_TIMEOUT_ERROR);
+		}
+		if(!aws_iot_mqtt_is_client_connected(pClient)) {
+			FUNC_EXIT_RC(NETWORK_DISCONNECTED_ERROR);
+		}
+
+		/* Read while nobody else does */
+		rc = _aws_iot_mqtt_internal_read_for_ack(pClient, pTimer, &isRead);
+		if(isRead) {
+			if(SUCCESS != rc && MQTT_NOTHING_TO_READ != rc) {
+				FUNC_EXIT_RC(rc);
+			}
+			continue;
+		}
+
+		rc = aws_iot_thread_event_wait(&(pWaiter->event), left_ms(pTimer));
+		if(SUCCESS != rc && THREAD_WAIT_TIMEOUT_ERROR != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+	}
+}
+#endif
+
+#ifdef ENABLE_IOT_PROBES
+/* Semaphores of all probes of the SDK, a tracer increments the one of a probe while it is attached */
+#define IOT_PROBE_DEFINE_SEMAPHORE(name) \
+	volatile unsigned short IOT_PROBE_SEMAPHORE(name) __attribute__((section(".probes"))) = 0;
+IOT_PROBE_LIST(IOT_PROBE_DEFINE_SEMAPHORE)
+
+/**
+ * @brief Packet ID of a serialized packet for the probes, 0 if the packet has none
+ *
+ * @param pBuf Packet starting with the fixed header
+ * @param length Length of the packet
+ */
+static uint16_t _aws_iot_mqtt_internal_probe_packet_id(const unsigned char *pBuf, size_t length) {
+	MQTTHeader header;
+	size_t pos = 1;
+	uint16_t topicLen;
+
+	header.byte = pBuf[0];
+	while(pos < length && pos <= MAX_NO_OF_REMAINING_LENGTH_BYTES && 0 != (pBuf[pos] & 128)) {
+		pos++;
+	}
+	pos++;
+
+	if(PUBLISH == MQTT_HEADER_FIELD_TYPE(header.byte)) {
+		if(QOS0 == MQTT_HEADER_FIELD_QOS(header.byte) || pos + 2 > length) {
+			return 0;
+		}
+		topicLen = (uint16_t) ((pBuf[pos] << 8) | pBuf[pos + 1]);
+		pos += 2 + (size_t) topicLen;
+	} else if(PUBACK > MQTT_HEADER_FIELD_TYPE(header.byte) || UNSUBACK < MQTT_HEADER_FIELD_TYPE(header.byte)) {
+		return 0;
+	}
+
+	if(pos + 2 > length) {
+		return 0;
+	}
+
+	return (uint16_t) ((pBuf[pos] << 8) | pBuf[pos + 1]);
+}
+#endif
+
 /**
  * @brief Send an MQTT packet on the network
  *
+ * The caller must hold the write buffer, see aws_iot_mqtt_internal_lock_write_buffer
+ *
  * @param pClient MQTT client which holds packet
  * @param length Length of packet to send
  * @param pTimer Amount of time allowed to send packet
@@ -320,22 +984,27 @@ IoT_Error_t aws_iot_mqtt_internal_send_packet(AWS_IoT_Client *pClient, size_t le
 		FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
 	}
 
-#ifdef _ENABLE_THREAD_SUPPORT_
-	rc = aws_iot_mqtt_client_lock_mutex(pClient, &(pClient->clientData.tls_write_mutex));
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
-	}
-#endif
-
+	rc = NETWORK_SSL_WRITE_TIMEOUT_ERROR;
 	sentLen = 0;
 	sent = 0;
 
+	/* Finding the packet ID walks the header, only done while a tracer is attached */
+	if(IOT_PROBE_ENABLED(packet_send_start)) {
+		IOT_PROBE3(packet_send_start, MQTT_HEADER_FIELD_TYPE(pClient->clientData.writeBuf[0]),
+				   _aws_iot_mqtt_internal_probe_packet_id(pClient->clientData.writeBuf, length), length);
+	}
+
 	while(sent < length && !has_timer_expired(pTimer)) {
 		rc = pClient->networkStack.write(&(pClient->networkStack),
 						 &pClient->clientData.writeBuf[sent],
 						 (length - sent),
 						 pTimer,
 						 &sentLen);
+		if(NETWORK_SSL_WRITE_QUEUED == rc) {
+			/* The network layer holds the rest of the packet and reports a failed send on a later call */
+			sent = length;
+			break;
+		}
 		if(SUCCESS != rc) {
 			/* there was an error writing the data */
 			break;
@@ -343,17 +1012,15 @@ IoT_Error_t aws_iot_mqtt_internal_send_packet(AWS_IoT_Client *pClient, size_t le
 		sent += sentLen;
 	}
 
-#ifdef _ENABLE_THREAD_SUPPORT_
-	rc = aws_iot_mqtt_client_unlock_mutex(pClient, &(pClient->clientData.tls_write_mutex));
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
-	}
-#endif
-
 	if(sent == length) {
 		/* record the fact that we have successfully sent the packet */
 		//countdown_sec(&c->pingTimer, c->clientData.keepAliveInterval);
-		FUNC_EXIT_RC(SUCCESS);
+		rc = SUCCESS;
+	}
+
+	if(IOT_PROBE_ENABLED(packet_send)) {
+		IOT_PROBE4(packet_send, MQTT_HEADER_FIELD_TYPE(pClient->clientData.writeBuf[0]),
+				   _aws_iot_mqtt_internal_probe_packet_id(pClient->clientData.writeBuf, length), sent, rc);
 	}
 
 	FUNC_EXIT_RC(rc)
@@ -433,6 +1100,15 @@ static IoT_Error_t _aws_iot_mqtt_internal_read_packet(AWS_IoT_Client *pClient, T
 	bytes_to_be_read = 0;
 	read_len = 0;
 
+	/* No read buffer after a callback retained the last block of the RX buffer pool */
+	if(NULL == pClient->clientData.readBuf) {
+		pClient->clientData.readBuf = (unsigned char *) aws_iot_pool_alloc(pClient->clientData.pRxBufferPool);
+		if(NULL == pClient->clientData.readBuf) {
+			/* Left unread until a lease is released, TCP flow control holds the server back */
+			return LIMIT_EXCEEDED_ERROR;
+		}
+	}
+
     rc = _aws_iot_mqtt_internal_readWrapper( pClient, offset, 1, pTimer, &read_len );
 	/* 1. read the header byte.  This has the packet type in it */
 	if(NETWORK_SSL_NOTHING_TO_READ == rc) {
@@ -488,13 +1164,19 @@ static IoT_Error_t _aws_iot_mqtt_internal_read_packet(AWS_IoT_Client *pClient, T
 	header.byte = pClient->clientData.readBuf[0];
 	*pPacketType = MQTT_HEADER_FIELD_TYPE(header.byte);
 
+	if(IOT_PROBE_ENABLED(packet_read)) {
+		IOT_PROBE3(packet_read, *pPacketType,
+				   _aws_iot_mqtt_internal_probe_packet_id(pClient->clientData.readBuf, rem_len + offset),
+				   rem_len + offset);
+	}
+
 	FUNC_EXIT_RC(rc);
 }
 
 // assume topic filter and name is in correct format
 // # can only be at end
 // + and # can only be next to separator
-static bool _aws_iot_mqtt_internal_is_topic_matched(char *pTopicFilter, char *pTopicName, uint16_t topicNameLen) {
+bool aws_iot_mqtt_internal_is_topic_matched(char *pTopicFilter, char *pTopicName, uint16_t topicNameLen) {
 
 	char *curf, *curn, *curn_end;
 
@@ -533,9 +1215,10 @@ static bool _aws_iot_mqtt_internal_is_topic_matched(char *pTopicFilter, char *pT
 static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClient, char *pTopicName,
 														  uint16_t topicNameLen,
 														  IoT_Publish_Message_Params *pMessageParams) {
-	uint32_t itr;
 	IoT_Error_t rc;
 	ClientState clientState;
+	SubscriptionMatchCursor cursor;
+	MessageHandlers *pHandler;
 
 	FUNC_ENTRY;
 
@@ -547,76 +1230,227 @@ static IoT_Error_t _aws_iot_mqtt_internal_deliver_message(AWS_IoT_Client *pClien
 	 * But while callback return is in progress, Yield should not be called.
 	 * The state for CB_RETURN accomplishes that, as yield cannot be called while in that state */
 	clientState = aws_iot_mqtt_get_client_state(pClient);
+#ifdef _ENABLE_THREAD_SUPPORT_
+	/* Lets a QoS 1 publish from a handler read the network, see aws_iot_mqtt_internal_wait_for_ack */
+	(void) aws_iot_thread_mutex_lock(&(pClient->clientData.ack_wait_mutex));
+	aws_iot_thread_id_get_current(&(pClient->clientData.callbackThread));
+	(void) aws_iot_thread_mutex_unlock(&(pClient->clientData.ack_wait_mutex));
+#endif
 	aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN);
 
-	/* Find the right message handler - indexed by topic */
-	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++itr) {
-		if(NULL != pClient->clientData.messageHandlers[itr].topicName) {
-			if(((topicNameLen == pClient->clientData.messageHandlers[itr].topicNameLen)
-				&&
-				(strncmp(pTopicName, (char *) pClient->clientData.messageHandlers[itr].topicName, topicNameLen) == 0))
-			   || _aws_iot_mqtt_internal_is_topic_matched((char *) pClient->clientData.messageHandlers[itr].topicName,
-														  pTopicName, topicNameLen)) {
-				if(NULL != pClient->clientData.messageHandlers[itr].pApplicationHandler) {
-					pClient->clientData.messageHandlers[itr].pApplicationHandler(pClient, pTopicName, topicNameLen,
-																				 pMessageParams,
-																				 pClient->clientData.messageHandlers[itr].pApplicationHandlerData);
-				}
-			}
+	IOT_PROBE4(message_deliver, pMessageParams->id, pMessageParams->qos, topicNameLen, pMessageParams->payloadLen);
+
+	/* Find the right message handlers - indexed by topic */
+	aws_iot_mqtt_internal_subscription_store_match_begin(&(pClient->clientData.subscriptions), pTopicName,
+														 topicNameLen, &cursor);
+	while(NULL != (pHandler = aws_iot_mqtt_internal_subscription_store_match_next(&(pClient->clientData.subscriptions),
+																				   pTopicName, topicNameLen,
+																				   &cursor))) {
+		if(NULL != pHandler->pApplicationHandler) {
+			pHandler->pApplicationHandler(pClient, pTopicName, topicNameLen, pMessageParams,
+										  pHandler->pApplicationHandlerData);
 		}
 	}
+	aws_iot_mqtt_internal_subscription_store_match_end(&(pClient->clientData.subscriptions));
+	IOT_PROBE1(message_delivered, pMessageParams->id);
 	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN, clientState);
 
 	FUNC_EXIT_RC(rc);
 }
 
+/**
+ * @brief Forget the messages of the duplicate window, e.g. because the server started a new session
+ *
+ * @param pWindow The duplicate window
+ */
+void aws_iot_mqtt_internal_reset_duplicate_window(DuplicateWindow *pWindow) {
+	pWindow->next = 0;
+	pWindow->count = 0;
+	memset(pWindow->entries, 0, sizeof(pWindow->entries));
+}
+
+static uint32_t _aws_iot_mqtt_internal_duplicate_hash(uint32_t hash, const unsigned char *pData, size_t len) {
+	size_t i;
+
+	for(i = 0; i < len; i++) {
+		hash ^= pData[i];
+		hash *= AWS_IOT_MQTT_DUPLICATE_FNV_PRIME;
+	}
+
+	return hash;
+}
+
+/**
+ * @brief Check an incoming QoS 1 message against the duplicate window
+ *
+ * The packet ID alone is not enough, the server may reuse it as soon as it has the PUBACK. The
+ * hash of the topic and payload keeps a new message on a reused packet ID from being dropped.
+ *
+ * @param pWindow The duplicate window
+ * @param pParams The received message
+ * @param pTopicName Topic the message was received on
+ * @param topicNameLen Length of the topic
+ *
+ * @return true if the message was already delivered and must not be delivered again
+ */
+bool aws_iot_mqtt_internal_is_duplicate_publish(DuplicateWindow *pWindow, const IoT_Publish_Message_Params *pParams,
+												const char *pTopicName, uint16_t topicNameLen) {
+	uint32_t hash, i;
+
+	if(pParams->isDup) {
+		pWindow->stats.duplicatesReceived++;
+	}
+
+	if(!pWindow->isEnabled) {
+		return false;
+	}
+
+	hash = _aws_iot_mqtt_internal_duplicate_hash(AWS_IOT_MQTT_DUPLICATE_FNV_OFFSET,
+												 (const unsigned char *) pTopicName, topicNameLen);
+	hash = _aws_iot_mqtt_internal_duplicate_hash(hash, (const unsigned char *) pParams->payload,
+												 pParams->payloadLen);
+
+	if(pParams->isDup) {
+		for(i = 0; i < pWindow->count; i++) {
+			if(pWindow->entries[i].packetId == pParams->id && pWindow->entries[i].hash == hash) {
+				pWindow->stats.duplicatesSuppressed++;
+				return true;
+			}
+		}
+	}
+
+	pWindow->entries[pWindow->next].packetId = pParams->id;
+	pWindow->entries[pWindow->next].hash = hash;
+	pWindow->next = (pWindow->next + 1) % AWS_IOT_MQTT_DUPLICATE_WINDOW_LEN;
+	if(pWindow->count < AWS_IOT_MQTT_DUPLICATE_WINDOW_LEN) {
+		pWindow->count++;
+	}
+
+	return false;
+}
+
+/**
+ * @brief Send the PUBACK of a QoS 1 message
+ *
+ * Only warns on failure, the server sends the PUBLISH again in that case.
+ *
+ * @param pClient MQTT client
+ * @param packetId Packet id of the message
+ */
+static void _aws_iot_mqtt_internal_send_puback(AWS_IoT_Client *pClient, uint16_t packetId) {
+	Timer sendTimer;
+	uint32_t len = 0;
+	IoT_Error_t rc;
+
+	/* Initialize timer for sending PUBACK. */
+	init_timer(&sendTimer);
+	countdown_ms(&sendTimer, pClient->clientData.commandTimeoutMs);
+
+	rc = aws_iot_mqtt_internal_lock_write_buffer(pClient);
+	if(SUCCESS != rc) {
+		IOT_WARN("Write buffer busy, PUBACK not sent");
+		return;
+	}
+
+	rc = aws_iot_mqtt_internal_serialize_ack(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, PUBACK, 0,
+											 packetId, &len);
+	if(SUCCESS == rc) {
+		rc = aws_iot_mqtt_internal_send_packet(pClient, len, &sendTimer);
+		if(SUCCESS != rc) {
+			IOT_WARN("Failed to send PUBACK");
+		}
+	} else {
+		IOT_WARN("Failed to generate PUBACK");
+	}
+	(void) aws_iot_mqtt_internal_unlock_write_buffer(pClient);
+}
+
 static IoT_Error_t _aws_iot_mqtt_internal_handle_publish(AWS_IoT_Client *pClient) {
 	char *topicName;
 	uint16_t topicNameLen;
-	uint32_t len;
 	IoT_Error_t rc;
 	IoT_Publish_Message_Params msg;
-	Timer sendTimer;
+	const IoT_Payload_Codec_t *pCodec;
+	unsigned char *pDecoded;
+	size_t decodedLen;
 
 	FUNC_ENTRY;
 
 	topicName = NULL;
 	topicNameLen = 0;
-	len = 0;
 
-	rc = aws_iot_mqtt_internal_deserialize_publish(&msg.isDup, &msg.qos, &msg.isRetained,
-												   &msg.id, &topicName, &topicNameLen,
-												   (unsigned char **) &msg.payload, &msg.payloadLen,
-												   pClient->clientData.readBuf,
-												   pClient->clientData.readBufSize);
+	if(MQTT_5_0 == pClient->clientData.options.MQTTVersion) {
+		rc = aws_iot_mqtt_internal_deserialize_publish_v5(&msg.isDup, &msg.qos, &msg.isRetained,
+														  &msg.id, &topicName, &topicNameLen,
+														  (unsigned char **) &msg.payload, &msg.payloadLen,
+														  pClient->clientData.readBuf,
+														  pClient->clientData.readBufSize);
+	} else {
+		rc = aws_iot_mqtt_internal_deserialize_publish(&msg.isDup, &msg.qos, &msg.isRetained,
+													   &msg.id, &topicName, &topicNameLen,
+													   (unsigned char **) &msg.payload, &msg.payloadLen,
+													   pClient->clientData.readBuf,
+													   pClient->clientData.readBufSize);
+	}
 
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
+	/* Decode before the message is acknowledged. Without a free pool block the message is not
+	 * acknowledged. A server only redelivers an unacknowledged QoS 1 message when the client
+	 * reconnects to a persistent session, with a clean session the message is lost. A payload
+	 * the codec rejects would fail the same way every time, it is acknowledged, counted and dropped.
+	 * The decoded payload lives in a pool block for as long as the callbacks run. */
+	pDecoded = NULL;
+	pCodec = aws_iot_mqtt_internal_find_payload_codec(pClient, topicName, topicNameLen);
+	if(NULL != pCodec) {
+		pDecoded = (unsigned char *) aws_iot_pool_alloc(pClient->clientData.pPayloadCodecPool);
+		if(NULL == pDecoded) {
+			IOT_WARN("No payload codec buffer free, message dropped");
+			FUNC_EXIT_RC(LIMIT_EXCEEDED_ERROR);
+		}
+		rc = pCodec->decode(pCodec->pContext, (const unsigned char *) msg.payload, msg.payloadLen, pDecoded,
+							pClient->clientData.pPayloadCodecPool->blockSize, &decodedLen);
+		if(SUCCESS != rc) {
+			IOT_ERROR("Decoding the payload failed: %d, message dropped", rc);
+			(void) aws_iot_pool_free(pClient->clientData.pPayloadCodecPool, pDecoded);
+			pClient->clientData.undecodablePayloadCount++;
+			if(QOS1 == msg.qos) {
+				_aws_iot_mqtt_internal_send_puback(pClient, msg.id);
+			}
+			FUNC_EXIT_RC(PAYLOAD_CODEC_ERROR);
+		}
+		msg.payload = pDecoded;
+		msg.payloadLen = decodedLen;
+	}
+
 	/* Send acknowledgement of QoS 1 message. */
 	if(QOS1 == msg.qos) {
-		/* Initialize timer for sending PUBACK. */
-		init_timer(&sendTimer);
-		countdown_ms(&sendTimer, pClient->clientData.commandTimeoutMs);
-
-		/* Generate and send a PUBACK. Warn if the PUBACK isn't sent; the server
-		will send the PUBLISH again in that case. */
-		rc = aws_iot_mqtt_internal_serialize_ack(pClient->clientData.writeBuf,
-			pClient->clientData.writeBufSize, PUBACK, 0, msg.id, &len);
-
-		if(SUCCESS == rc) {
-			rc = aws_iot_mqtt_internal_send_packet(pClient, len, &sendTimer);
-
-			if(SUCCESS != rc) {
-				IOT_WARN("Failed to send PUBACK");
+		_aws_iot_mqtt_internal_send_puback(pClient, msg.id);
+
+		/* A redelivery of a message the application already has is acknowledged but not delivered again */
+		if(aws_iot_mqtt_internal_is_duplicate_publish(&(pClient->clientData.duplicateWindow), &msg, topicName,
+													  topicNameLen)) {
+			IOT_DEBUG("Duplicate of packet %u not delivered", msg.id);
+			IOT_PROBE1(message_duplicate, msg.id);
+			if(NULL != pDecoded) {
+				(void) aws_iot_pool_free(pClient->clientData.pPayloadCodecPool, pDecoded);
 			}
-		} else {
-			IOT_WARN("Failed to generate PUBACK");
+			FUNC_EXIT_RC(SUCCESS);
 		}
 	}
 
+	if(NULL != pDecoded) {
+		rc = _aws_iot_mqtt_internal_deliver_message(pClient, topicName, topicNameLen, &msg);
+		(void) aws_iot_pool_free(pClient->clientData.pPayloadCodecPool, pDecoded);
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* The callbacks can retain the read buffer when it is a block of the RX buffer pool */
+	pClient->clientData.isRxBufferRetainable = (NULL != pClient->clientData.pRxBufferPool);
 	rc = _aws_iot_mqtt_internal_deliver_message(pClient, topicName, topicNameLen, &msg);
+	pClient->clientData.isRxBufferRetainable = false;
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
@@ -624,6 +1458,32 @@ static IoT_Error_t _aws_iot_mqtt_internal_handle_publish(AWS_IoT_Client *pClient
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+/**
+ * @brief Closes the connection after an MQTT 5.0 server sent a DISCONNECT
+ *
+ * The client must not send anything after it, not even its own DISCONNECT. A DISCONNECT that
+ * can't be decoded still ends the connection and is recorded as a malformed packet.
+ *
+ * @param pClient MQTT client
+ *
+ * @return MQTT_SERVER_DISCONNECTED_ERROR
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_handle_server_disconnect(AWS_IoT_Client *pClient) {
+	unsigned char reasonCode;
+
+	if(SUCCESS != aws_iot_mqtt_internal_deserialize_disconnect_v5(&reasonCode, pClient->clientData.readBuf,
+																   pClient->clientData.readBufSize)) {
+		reasonCode = MQTT5_REASON_CODE_MALFORMED_PACKET;
+	}
+	IOT_WARN("Disconnected by the server, reason code 0x%02X", reasonCode);
+	pClient->clientData.serverDisconnectReason = reasonCode;
+
+	aws_iot_mqtt_force_client_state(pClient, CLIENT_STATE_DISCONNECTED_ERROR);
+	(void) aws_iot_mqtt_internal_close_network(pClient);
+
+	return MQTT_SERVER_DISCONNECTED_ERROR;
+}
+
 /**
  * @brief Read an MQTT packet from the network
  *
@@ -670,11 +1530,16 @@ IoT_Error_t aws_iot_mqtt_internal_cycle_read(AWS_IoT_Client *pClient, Timer *pTi
 
 	switch(*pPacketType) {
 		case CONNACK:
-		case PUBACK:
 		case SUBACK:
 		case UNSUBACK:
 			/* SDK is blocking, these responses will be forwarded to calling function to process */
 			break;
+		case PUBACK:
+#ifdef _ENABLE_THREAD_SUPPORT_
+			/* Several QoS 1 publishes can be waiting, not only the one of the calling thread */
+			rc = _aws_iot_mqtt_internal_deliver_puback(pClient);
+#endif
+			break;
 		case PUBLISH: {
 			rc = _aws_iot_mqtt_internal_handle_publish(pClient);
 			break;
@@ -685,9 +1550,18 @@ IoT_Error_t aws_iot_mqtt_internal_cycle_read(AWS_IoT_Client *pClient, Timer *pTi
 			break;
 		case PINGRESP: {
 			/* There is no outstanding ping request anymore. */
-			pClient->clientStatus.isPingOutstanding = false;
+			AWS_IOT_MQTT_ATOMIC_STORE(&(pClient->clientStatus.isPingOutstanding), false);
+			IOT_PROBE1(keepalive_pong, pClient->clientData.keepAliveInterval);
 			break;
 		}
+		case DISCONNECT:
+			/* Only an MQTT 5.0 server sends a DISCONNECT */
+			if(MQTT_5_0 == pClient->clientData.options.MQTTVersion) {
+				rc = _aws_iot_mqtt_internal_handle_server_disconnect(pClient);
+			} else {
+				rc = MQTT_RX_MESSAGE_PACKET_TYPE_INVALID_ERROR;
+			}
+			break;
 		default: {
 			/* Either unknown packet type or Failure occurred
              * Should not happen */
@@ -99,6 +99,34 @@ typedef enum {
 	CONNACK_NOT_AUTHORIZED_ERROR = 5 /**< Not authorized */
 } MQTT_Connack_Return_Codes;
 
+/** MQTT 5.0 connect reason codes from server, MQTT v5.0 Specification 3.2.2.2 */
+typedef enum {
+	CONNACK_V5_UNSUPPORTED_PROTOCOL_VERSION = 0x84, /**< Unsupported protocol version */
+	CONNACK_V5_CLIENT_IDENTIFIER_NOT_VALID = 0x85, /**< Client identifier not valid */
+	CONNACK_V5_BAD_USER_NAME_OR_PASSWORD = 0x86, /**< Bad user name or password */
+	CONNACK_V5_NOT_AUTHORIZED = 0x87, /**< Not authorized */
+	CONNACK_V5_SERVER_UNAVAILABLE = 0x88, /**< Server unavailable */
+	CONNACK_V5_SERVER_BUSY = 0x89 /**< Server busy */
+} MQTT_Connack_Reason_Codes;
+
+/** Session expiry interval that keeps the session like an MQTT 3.1.1 persistent session */
+#define CONNECT_V5_SESSION_NEVER_EXPIRES 0xFFFFFFFF
+
+/**
+  * Determines the length of the MQTT 5.0 connect properties that would be produced using the supplied connect options.
+  * @param options the options to be used to build the connect packet
+  * @return the length of the properties, without the property length itself
+  */
+static uint32_t _aws_iot_get_connect_properties_length(IoT_Client_Connect_Params *pConnectParams) {
+	uint32_t len = 5; /* Maximum Packet Size */
+
+	if(!pConnectParams->isCleanSession) {
+		len += 5; /* Session Expiry Interval */
+	}
+
+	return len;
+}
+
 /**
   * Determines the length of the MQTT connect packet that would be produced using the supplied connect options.
   * @param options the options to be used to build the connect packet
@@ -107,20 +135,20 @@ typedef enum {
   */
 static uint32_t _aws_iot_get_connect_packet_length(IoT_Client_Connect_Params *pConnectParams) {
 	uint32_t len;
-	/* Enable when adding further MQTT versions */
-	/*size_t len = 0;
-	switch(pConnectParams->MQTTVersion) {
-		case MQTT_3_1_1:
-			len = 10;
-			break;
-	}*/
 	FUNC_ENTRY;
 
 	len = 10; // Len = 10 for MQTT_3_1_1
+	if(MQTT_5_0 == pConnectParams->MQTTVersion) {
+		/* The properties are short enough for a one byte property length */
+		len = len + 1 + _aws_iot_get_connect_properties_length(pConnectParams);
+	}
 	len = len + pConnectParams->clientIDLen + 2;
 
 	if(pConnectParams->isWillMsgPresent) {
 		len = len + pConnectParams->will.topicNameLen + 2 + pConnectParams->will.msgLen + 2;
+		if(MQTT_5_0 == pConnectParams->MQTTVersion) {
+			len = len + 1; /* Will Properties, always empty */
+		}
 	}
 
 	if(NULL != pConnectParams->pUsername) {
@@ -139,12 +167,13 @@ static uint32_t _aws_iot_get_connect_packet_length(IoT_Client_Connect_Params *pC
   * @param buf the buffer into which the packet will be serialized
   * @param len the length in bytes of the supplied buffer
   * @param options the options to be used to build the connect packet
+  * @param maximumPacketSize MQTT 5.0 only, the largest packet the client accepts
   * @param serialized length
   * @return IoT_Error_t indicating function execution status
   */
 static IoT_Error_t _aws_iot_mqtt_serialize_connect(unsigned char *pTxBuf, size_t txBufLen,
 												   IoT_Client_Connect_Params *pConnectParams,
-												   size_t *pSerializedLen) {
+												   uint32_t maximumPacketSize, size_t *pSerializedLen) {
 	unsigned char *ptr;
 	uint32_t len;
 	IoT_Error_t rc;
@@ -162,6 +191,7 @@ static IoT_Error_t _aws_iot_mqtt_serialize_connect(unsigned char *pTxBuf, size_t
 	/* Check needed here before we start writing to the Tx buffer */
 	switch(pConnectParams->MQTTVersion) {
 		case MQTT_3_1_1:
+		case MQTT_5_0:
 			break;
 		default:
 			return MQTT_CONNACK_UNACCEPTABLE_PROTOCOL_VERSION_ERROR;
@@ -182,11 +212,8 @@ static IoT_Error_t _aws_iot_mqtt_serialize_connect(unsigned char *pTxBuf, size_t
 
 	ptr += aws_iot_mqtt_internal_write_len_to_buffer(ptr, len); /* write remaining length */
 
-	// Enable if adding support for more versions
-	//if(MQTT_3_1_1 == pConnectParams->MQTTVersion) {
 	aws_iot_mqtt_internal_write_utf8_string(&ptr, "MQTT", 4);
 	aws_iot_mqtt_internal_write_char(&ptr, (unsigned char) pConnectParams->MQTTVersion);
-	//}
 
 	flags.all = 0;
 	if (pConnectParams->isCleanSession)
@@ -212,6 +239,17 @@ static IoT_Error_t _aws_iot_mqtt_serialize_connect(unsigned char *pTxBuf, size_t
 	aws_iot_mqtt_internal_write_char(&ptr, flags.all);
 	aws_iot_mqtt_internal_write_uint_16(&ptr, pConnectParams->keepAliveIntervalInSec);
 
+	if(MQTT_5_0 == pConnectParams->MQTTVersion) {
+		aws_iot_mqtt_internal_write_char(&ptr, (unsigned char) _aws_iot_get_connect_properties_length(pConnectParams));
+		aws_iot_mqtt_internal_write_char(&ptr, MQTT5_PROPERTY_MAXIMUM_PACKET_SIZE);
+		aws_iot_mqtt_internal_write_uint_32(&ptr, maximumPacketSize);
+		if(!pConnectParams->isCleanSession) {
+			/* Without it the server drops the session on disconnect, unlike with MQTT 3.1.1 */
+			aws_iot_mqtt_internal_write_char(&ptr, MQTT5_PROPERTY_SESSION_EXPIRY_INTERVAL);
+			aws_iot_mqtt_internal_write_uint_32(&ptr, CONNECT_V5_SESSION_NEVER_EXPIRES);
+		}
+	}
+
 	/* If the code have passed the check for incorrect values above, no client id was passed as argument */
 	if(NULL == pConnectParams->pClientID) {
 		aws_iot_mqtt_internal_write_uint_16(&ptr, 0);
@@ -220,6 +258,9 @@ static IoT_Error_t _aws_iot_mqtt_serialize_connect(unsigned char *pTxBuf, size_t
 	}
 
 	if(pConnectParams->isWillMsgPresent) {
+		if(MQTT_5_0 == pConnectParams->MQTTVersion) {
+			aws_iot_mqtt_internal_write_char(&ptr, 0); /* Will Properties */
+		}
 		aws_iot_mqtt_internal_write_utf8_string(&ptr, pConnectParams->will.pTopicName,
 												pConnectParams->will.topicNameLen);
 		aws_iot_mqtt_internal_write_utf8_string(&ptr, pConnectParams->will.pMessage, pConnectParams->will.msgLen);
@@ -240,13 +281,19 @@ static IoT_Error_t _aws_iot_mqtt_serialize_connect(unsigned char *pTxBuf, size_t
 
 /**
   * Deserializes the supplied (wire) buffer into connack data - return code
-  * @param sessionPresent the session present flag returned (only for MQTT 3.1.1)
+  *
+  * A server that does not support MQTT 5.0 answers an MQTT 5.0 connect with an MQTT 3.1.1
+  * CONNACK, so both formats are accepted when the properties are requested.
+  *
+  * @param sessionPresent the session present flag returned
   * @param connack_rc returned integer value of the connack return code
+  * @param pProperties returned MQTT 5.0 properties, NULL to accept only an MQTT 3.1.1 CONNACK
   * @param buf the raw buffer data, of the correct length determined by the remaining length field
   * @param buflen the length in bytes of the data in the supplied buffer
   * @return IoT_Error_t indicating function execution status
   */
 static IoT_Error_t _aws_iot_mqtt_deserialize_connack(unsigned char *pSessionPresent, IoT_Error_t *pConnackRc,
+													 MQTT5_Properties *pProperties,
 													 unsigned char *pRxBuf, size_t rxBufLen) {
 	unsigned char *curdata, *enddata;
 	unsigned char connack_rc_char;
@@ -284,16 +331,54 @@ static IoT_Error_t _aws_iot_mqtt_deserialize_connack(unsigned char *pSessionPres
 		FUNC_EXIT_RC(rc);
 	}
 
-	/* CONNACK remaining length should always be 2 as per MQTT 3.1.1 spec */
+	/* CONNACK remaining length should always be 2 as per MQTT 3.1.1 spec,
+	 * with MQTT 5.0 it is at least 3 to include the property length */
 	curdata += (readBytesLen);
 	enddata = curdata + decodedLen;
-	if(2 != (enddata - curdata)) {
+	if(2 != decodedLen && (NULL == pProperties || 3 > decodedLen)) {
 		FUNC_EXIT_RC(MQTT_DECODE_REMAINING_LENGTH_ERROR);
 	}
+	if((size_t) (enddata - pRxBuf) > rxBufLen) {
+		FUNC_EXIT_RC(MQTT_RX_BUFFER_TOO_SHORT_ERROR);
+	}
 
 	flags.all = aws_iot_mqtt_internal_read_char(&curdata);
-	*pSessionPresent = flags.bits.sessionpresent;
+	/* Session present is bit 0, the order of the bit-field in flags.bits depends on the compiler */
+	*pSessionPresent = (unsigned char) (flags.all & 0x01);
 	connack_rc_char = aws_iot_mqtt_internal_read_char(&curdata);
+	if(2 != decodedLen) {
+		if(SUCCESS != aws_iot_mqtt_internal_read_properties(&curdata, enddata, pProperties)) {
+			FUNC_EXIT_RC(FAILURE);
+		}
+
+		switch(connack_rc_char) {
+			case CONNACK_CONNECTION_ACCEPTED:
+				*pConnackRc = MQTT_CONNACK_CONNECTION_ACCEPTED;
+				break;
+			case CONNACK_V5_UNSUPPORTED_PROTOCOL_VERSION:
+				*pConnackRc = MQTT_CONNACK_UNACCEPTABLE_PROTOCOL_VERSION_ERROR;
+				break;
+			case CONNACK_V5_CLIENT_IDENTIFIER_NOT_VALID:
+				*pConnackRc = MQTT_CONNACK_IDENTIFIER_REJECTED_ERROR;
+				break;
+			case CONNACK_V5_SERVER_UNAVAILABLE:
+			case CONNACK_V5_SERVER_BUSY:
+				*pConnackRc = MQTT_CONNACK_SERVER_UNAVAILABLE_ERROR;
+				break;
+			case CONNACK_V5_BAD_USER_NAME_OR_PASSWORD:
+				*pConnackRc = MQTT_CONNACK_BAD_USERDATA_ERROR;
+				break;
+			case CONNACK_V5_NOT_AUTHORIZED:
+				*pConnackRc = MQTT_CONNACK_NOT_AUTHORIZED_ERROR;
+				break;
+			default:
+				*pConnackRc = MQTT_CONNACK_UNKNOWN_ERROR;
+				break;
+		}
+
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
 	switch(connack_rc_char) {
 		case CONNACK_CONNECTION_ACCEPTED:
 			*pConnackRc = MQTT_CONNACK_CONNECTION_ACCEPTED;
@@ -380,6 +465,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, IoT_C
 	char sessionPresent = 0;
 	size_t len = 0;
 	IoT_Error_t rc = FAILURE;
+	MQTT5_Properties connackProperties;
 
 	FUNC_ENTRY;
 
@@ -391,7 +477,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, IoT_C
 		}
 	}
 
-	rc = pClient->networkStack.connect(&(pClient->networkStack), NULL);
+	rc = aws_iot_mqtt_internal_connect_network(pClient);
 	if(SUCCESS != rc) {
 		/* TLS Connect failed, return error */
 		FUNC_EXIT_RC(rc);
@@ -401,15 +487,20 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, IoT_C
 	countdown_ms(&connect_timer, pClient->clientData.commandTimeoutMs);
 
 	pClient->clientData.keepAliveInterval = pClient->clientData.options.keepAliveIntervalInSec;
-	rc = _aws_iot_mqtt_serialize_connect(pClient->clientData.writeBuf, pClient->clientData.writeBufSize,
-										 &(pClient->clientData.options), &len);
-	if(SUCCESS != rc || 0 >= len) {
+	rc = aws_iot_mqtt_internal_lock_write_buffer(pClient);
+	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
-	/* send the connect packet */
-	rc = aws_iot_mqtt_internal_send_packet(pClient, len, &connect_timer);
-	if(SUCCESS != rc) {
+	rc = _aws_iot_mqtt_serialize_connect(pClient->clientData.writeBuf, pClient->clientData.writeBufSize,
+										 &(pClient->clientData.options),
+										 (uint32_t) pClient->clientData.readBufSize, &len);
+	if(SUCCESS == rc && 0 < len) {
+		/* send the connect packet */
+		rc = aws_iot_mqtt_internal_send_packet(pClient, len, &connect_timer);
+	}
+	(void) aws_iot_mqtt_internal_unlock_write_buffer(pClient);
+	if(SUCCESS != rc || 0 >= len) {
 		FUNC_EXIT_RC(rc);
 	}
 
@@ -420,8 +511,12 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, IoT_C
 	}
 
 	/* Received CONNACK, check the return code */
-	rc = _aws_iot_mqtt_deserialize_connack((unsigned char *) &sessionPresent, &connack_rc, pClient->clientData.readBuf,
-										   pClient->clientData.readBufSize);
+	memset(&connackProperties, 0, sizeof(connackProperties));
+	connackProperties.receiveMaximum = MQTT5_DEFAULT_RECEIVE_MAXIMUM;
+	rc = _aws_iot_mqtt_deserialize_connack((unsigned char *) &sessionPresent, &connack_rc,
+										   (MQTT_5_0 == pClient->clientData.options.MQTTVersion) ?
+										   &connackProperties : NULL,
+										   pClient->clientData.readBuf, pClient->clientData.readBufSize);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
@@ -430,8 +525,27 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, IoT_C
 		FUNC_EXIT_RC(connack_rc);
 	}
 
+	/* Limits the server set for this connection, an MQTT 3.1.1 server sets none. Topic
+	 * aliases only last for one connection. Without thread support only one QoS 1 publish
+	 * is in flight at a time, which is within any receive maximum. */
+	pClient->clientData.serverReceiveMaximum = connackProperties.receiveMaximum;
+#ifdef _ENABLE_THREAD_SUPPORT_
+	aws_iot_mqtt_internal_limit_ack_waiters(pClient, connackProperties.receiveMaximum);
+#endif
+	pClient->clientData.serverMaximumPacketSize = connackProperties.maximumPacketSize;
+	pClient->clientData.serverDisconnectReason = 0;
+	aws_iot_mqtt_internal_reset_topic_aliases(&(pClient->clientData.topicAliases),
+											  connackProperties.topicAliasMaximum);
+	/* Messages of an earlier session can't be redelivered in a new one */
+	if(!sessionPresent) {
+		aws_iot_mqtt_internal_reset_duplicate_window(&(pClient->clientData.duplicateWindow));
+	}
+	if(connackProperties.isServerKeepAlivePresent) {
+		pClient->clientData.keepAliveInterval = connackProperties.serverKeepAlive;
+	}
+
 	/* Ensure that a ping request is sent after keepAliveInterval. */
-	pClient->clientStatus.isPingOutstanding = false;
+	AWS_IOT_MQTT_ATOMIC_STORE(&(pClient->clientStatus.isPingOutstanding), false);
 	countdown_sec(&pClient->pingReqTimer, pClient->clientData.keepAliveInterval);
 
 	FUNC_EXIT_RC(SUCCESS);
@@ -471,8 +585,7 @@ IoT_Error_t aws_iot_mqtt_connect(AWS_IoT_Client *pClient, IoT_Client_Connect_Par
 	rc = _aws_iot_mqtt_internal_connect(pClient, pConnectParams);
 
 	if(SUCCESS != rc) {
-		pClient->networkStack.disconnect(&(pClient->networkStack));
-		disconRc = pClient->networkStack.destroy(&(pClient->networkStack));
+		disconRc = aws_iot_mqtt_internal_close_network(pClient);
 		if (SUCCESS != disconRc) {
 			FUNC_EXIT_RC(NETWORK_DISCONNECTED_ERROR);
 		}
@@ -503,10 +616,16 @@ static IoT_Error_t _aws_iot_mqtt_internal_disconnect(AWS_IoT_Client *pClient) {
 
 	FUNC_ENTRY;
 
+	rc = aws_iot_mqtt_internal_lock_write_buffer(pClient);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
 	rc = aws_iot_mqtt_internal_serialize_zero(pClient->clientData.writeBuf, pClient->clientData.writeBufSize,
 											  DISCONNECT,
 											  &serialized_len);
 	if(SUCCESS != rc) {
+		(void) aws_iot_mqtt_internal_unlock_write_buffer(pClient);
 		FUNC_EXIT_RC(rc);
 	}
 
@@ -517,10 +636,10 @@ static IoT_Error_t _aws_iot_mqtt_internal_disconnect(AWS_IoT_Client *pClient) {
 	if(serialized_len > 0) {
 		(void)aws_iot_mqtt_internal_send_packet(pClient, serialized_len, &timer);
 	}
+	(void) aws_iot_mqtt_internal_unlock_write_buffer(pClient);
 
 	/* Clean network stack */
-	pClient->networkStack.disconnect(&(pClient->networkStack));
-	rc = pClient->networkStack.destroy(&(pClient->networkStack));
+	rc = aws_iot_mqtt_internal_close_network(pClient);
 	if(SUCCESS != rc) {
 		/* TLS Destroy failed, return error */
 		FUNC_EXIT_RC(FAILURE);
@@ -553,15 +672,72 @@ IoT_Error_t aws_iot_mqtt_disconnect(AWS_IoT_Client *pClient) {
 	rc = _aws_iot_mqtt_internal_disconnect(pClient);
 
 	if(SUCCESS != rc) {
-		pClient->clientStatus.clientState = clientState;
+		aws_iot_mqtt_force_client_state(pClient, clientState);
 	} else {
 		/* If called from Keepalive, this gets set to CLIENT_STATE_DISCONNECTED_ERROR */
-		pClient->clientStatus.clientState = CLIENT_STATE_DISCONNECTED_MANUALLY;
+		aws_iot_mqtt_force_client_state(pClient, CLIENT_STATE_DISCONNECTED_MANUALLY);
 	}
 
 	FUNC_EXIT_RC(rc);
 }
 
+/**
+  * Deserializes the supplied (wire) buffer into an MQTT 5.0 DISCONNECT from the server
+  *
+  * A DISCONNECT may end after the fixed header, the reason code is 0 (normal disconnection) then.
+  *
+  * @param pReasonCode returned integer - the reason code, MQTT v5.0 Specification 3.14.2.1
+  * @param pRxBuf the raw buffer data, of the correct length determined by the remaining length field
+  * @param rxBufLen the length in bytes of the data in the supplied buffer
+  *
+  * @return An IoT Error Type defining successful/failed call
+  */
+IoT_Error_t aws_iot_mqtt_internal_deserialize_disconnect_v5(unsigned char *pReasonCode,
+															unsigned char *pRxBuf, size_t rxBufLen) {
+	IoT_Error_t rc;
+	unsigned char *curdata = pRxBuf;
+	unsigned char *enddata;
+	uint32_t decodedLen = 0;
+	uint32_t readBytesLen = 0;
+	MQTTHeader header = {0};
+
+	FUNC_ENTRY;
+
+	if(NULL == pReasonCode || NULL == pRxBuf) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(2 > rxBufLen) {
+		FUNC_EXIT_RC(MQTT_RX_BUFFER_TOO_SHORT_ERROR);
+	}
+
+	header.byte = aws_iot_mqtt_internal_read_char(&curdata);
+	if(DISCONNECT != MQTT_HEADER_FIELD_TYPE(header.byte)) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	rc = aws_iot_mqtt_internal_decode_remaining_length_from_buffer(curdata, &decodedLen, &readBytesLen);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+	curdata += readBytesLen;
+	enddata = curdata + decodedLen;
+	if((size_t) (enddata - pRxBuf) > rxBufLen) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	/* Reason code, then properties if there are any */
+	*pReasonCode = 0;
+	if(curdata < enddata) {
+		*pReasonCode = aws_iot_mqtt_internal_read_char(&curdata);
+		if(curdata < enddata && SUCCESS != aws_iot_mqtt_internal_read_properties(&curdata, enddata, NULL)) {
+			FUNC_EXIT_RC(FAILURE);
+		}
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
 IoT_Error_t aws_iot_mqtt_attempt_reconnect(AWS_IoT_Client *pClient) {
 	IoT_Error_t rc;
 	ClientState currentState = aws_iot_mqtt_get_client_state(pClient);
@@ -591,8 +767,9 @@ IoT_Error_t aws_iot_mqtt_attempt_reconnect(AWS_IoT_Client *pClient) {
 		}
 	}
 
+	/* Filters the server refused are logged and dropped, the connection is back */
 	rc = aws_iot_mqtt_resubscribe(pClient);
-	if(SUCCESS != rc) {
+	if(SUCCESS != rc && MQTT_REQUEST_REJECTED_ERROR != rc) {
 		FUNC_EXIT_RC(NETWORK_ATTEMPTING_RECONNECT);
 	}
 
@@ -69,28 +69,20 @@ static IoT_Error_t _aws_iot_mqtt_read_string_with_len(char **stringVar, uint16_t
 }
 
 /**
-  * Serializes the supplied publish data into the supplied buffer, ready for sending
-  * @param pTxBuf the buffer into which the packet will be serialized
-  * @param txBufLen the length in bytes of the supplied buffer
-  * @param dup uint8_t - the MQTT dup flag
-  * @param qos QoS - the MQTT QoS value
-  * @param retained uint8_t - the MQTT retained flag
-  * @param packetId uint16_t - the MQTT packet identifier
-  * @param pTopicName char * - the MQTT topic in the publish
-  * @param topicNameLen uint16_t - the length of the Topic Name
-  * @param pPayload byte buffer - the MQTT publish payload
-  * @param payloadLen size_t - the length of the MQTT payload
-  * @param pSerializedLen uint32_t - pointer to the variable that stores serialized len
+  * Serializes the supplied publish data into the supplied buffer, for either protocol version
+  * @param isMqtt5 bool - whether to write the MQTT 5.0 properties
+  * @param topicAlias uint16_t - the MQTT 5.0 topic alias, 0 for none
   *
-  * @return An IoT Error Type defining successful/failed call
+  * See aws_iot_mqtt_internal_serialize_publish for the other parameters
   */
-static IoT_Error_t _aws_iot_mqtt_internal_serialize_publish(unsigned char *pTxBuf, size_t txBufLen, uint8_t dup,
-															QoS qos, uint8_t retained, uint16_t packetId,
-															const char *pTopicName, uint16_t topicNameLen,
-															const unsigned char *pPayload, size_t payloadLen,
-															uint32_t *pSerializedLen) {
+static IoT_Error_t _aws_iot_mqtt_serialize_publish(unsigned char *pTxBuf, size_t txBufLen, uint8_t dup,
+												   QoS qos, uint8_t retained, uint16_t packetId,
+												   const char *pTopicName, uint16_t topicNameLen,
+												   bool isMqtt5, uint16_t topicAlias,
+												   const unsigned char *pPayload, size_t payloadLen,
+												   uint32_t *pSerializedLen) {
 	unsigned char *ptr;
-	uint32_t rem_len;
+	uint32_t rem_len, propertiesLen;
 	IoT_Error_t rc;
 	MQTTHeader header = {0};
 
@@ -101,11 +93,15 @@ static IoT_Error_t _aws_iot_mqtt_internal_serialize_publish(unsigned char *pTxBu
 
 	ptr = pTxBuf;
 	rem_len = 0;
+	propertiesLen = (0 != topicAlias) ? 3 : 0; /* identifier + alias */
 
 	rem_len += (uint32_t) (topicNameLen + payloadLen + 2);
 	if(qos > 0) {
 		rem_len += 2; /* packetId */
 	}
+	if(isMqtt5) {
+		rem_len += 1 + propertiesLen; /* property length fits in one byte */
+	}
 	if(aws_iot_mqtt_internal_get_final_packet_length_from_remaining_length(rem_len) > txBufLen) {
 		FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
 	}
@@ -124,6 +120,14 @@ static IoT_Error_t _aws_iot_mqtt_internal_serialize_publish(unsigned char *pTxBu
 		aws_iot_mqtt_internal_write_uint_16(&ptr, packetId);
 	}
 
+	if(isMqtt5) {
+		aws_iot_mqtt_internal_write_char(&ptr, (unsigned char) propertiesLen);
+		if(0 != topicAlias) {
+			aws_iot_mqtt_internal_write_char(&ptr, MQTT5_PROPERTY_TOPIC_ALIAS);
+			aws_iot_mqtt_internal_write_uint_16(&ptr, topicAlias);
+		}
+	}
+
 	memcpy(ptr, pPayload, payloadLen);
 	ptr += payloadLen;
 
@@ -132,6 +136,51 @@ static IoT_Error_t _aws_iot_mqtt_internal_serialize_publish(unsigned char *pTxBu
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+/**
+  * Serializes the supplied publish data into the supplied buffer, ready for sending
+  * @param pTxBuf the buffer into which the packet will be serialized
+  * @param txBufLen the length in bytes of the supplied buffer
+  * @param dup uint8_t - the MQTT dup flag
+  * @param qos QoS - the MQTT QoS value
+  * @param retained uint8_t - the MQTT retained flag
+  * @param packetId uint16_t - the MQTT packet identifier
+  * @param pTopicName char * - the MQTT topic in the publish
+  * @param topicNameLen uint16_t - the length of the Topic Name
+  * @param pPayload byte buffer - the MQTT publish payload
+  * @param payloadLen size_t - the length of the MQTT payload
+  * @param pSerializedLen uint32_t - pointer to the variable that stores serialized len
+  *
+  * @return An IoT Error Type defining successful/failed call
+  */
+IoT_Error_t aws_iot_mqtt_internal_serialize_publish(unsigned char *pTxBuf, size_t txBufLen, uint8_t dup,
+													QoS qos, uint8_t retained, uint16_t packetId,
+													const char *pTopicName, uint16_t topicNameLen,
+													const unsigned char *pPayload, size_t payloadLen,
+													uint32_t *pSerializedLen) {
+	return _aws_iot_mqtt_serialize_publish(pTxBuf, txBufLen, dup, qos, retained, packetId, pTopicName,
+										   topicNameLen, false, 0, pPayload, payloadLen, pSerializedLen);
+}
+
+/**
+  * Serializes the supplied publish data into the supplied buffer as an MQTT 5.0 PUBLISH
+  * @param topicAlias uint16_t - the topic alias, 0 for none. topicNameLen may be 0 when the
+  *        server already knows the alias
+  *
+  * See aws_iot_mqtt_internal_serialize_publish for the other parameters
+  */
+IoT_Error_t aws_iot_mqtt_internal_serialize_publish_v5(unsigned char *pTxBuf, size_t txBufLen, uint8_t dup,
+													   QoS qos, uint8_t retained, uint16_t packetId,
+													   const char *pTopicName, uint16_t topicNameLen,
+													   uint16_t topicAlias, const unsigned char *pPayload,
+													   size_t payloadLen, uint32_t *pSerializedLen) {
+	if(0 == topicNameLen && 0 == topicAlias) {
+		return NULL_VALUE_ERROR;
+	}
+
+	return _aws_iot_mqtt_serialize_publish(pTxBuf, txBufLen, dup, qos, retained, packetId, pTopicName,
+										   topicNameLen, true, topicAlias, pPayload, payloadLen, pSerializedLen);
+}
+
 /**
   * Serializes the ack packet into the supplied buffer.
   * @param pTxBuf the buffer into which the packet will be serialized
@@ -177,6 +226,195 @@ IoT_Error_t aws_iot_mqtt_internal_serialize_ack(unsigned char *pTxBuf, size_t tx
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+/**
+ * @brief Forget every topic alias, e.g. because a new network connection was made
+ *
+ * @param pTable The topic alias table
+ * @param aliasCount Number of aliases the server allows, capped at AWS_IOT_MQTT_MAX_TOPIC_ALIASES
+ */
+void aws_iot_mqtt_internal_reset_topic_aliases(TopicAliasTable *pTable, uint16_t aliasCount) {
+	uint16_t itr;
+
+	if(aliasCount > AWS_IOT_MQTT_MAX_TOPIC_ALIASES) {
+		aliasCount = AWS_IOT_MQTT_MAX_TOPIC_ALIASES;
+	}
+
+	pTable->useCounter = 0;
+	pTable->aliasCount = aliasCount;
+	for(itr = 0; itr < AWS_IOT_MQTT_MAX_TOPIC_ALIASES; ++itr) {
+		pTable->aliases[itr].lastUsed = 0;
+		pTable->aliases[itr].topicNameLen = 0;
+	}
+}
+
+/**
+ * @brief Find or assign the topic alias of an outgoing publish
+ *
+ * @param pTable The topic alias table
+ * @param pTopicName Topic of the publish
+ * @param topicNameLen Length of the topic
+ * @param pIsAliasKnown Set when the server already knows the alias and the topic can be left out
+ *
+ * @return The alias to send, 0 to send the topic without an alias
+ */
+uint16_t aws_iot_mqtt_internal_get_topic_alias(TopicAliasTable *pTable, const char *pTopicName,
+											   uint16_t topicNameLen, bool *pIsAliasKnown) {
+	TopicAlias *pAlias;
+	uint16_t itr, leastRecentlyUsed;
+
+	*pIsAliasKnown = false;
+	if(0 == pTable->aliasCount || AWS_IOT_MQTT_TOPIC_ALIAS_MAX_TOPIC_LEN < topicNameLen) {
+		return 0;
+	}
+
+	if(0 == ++(pTable->useCounter)) {
+		/* 0 marks unassigned aliases, start over. The server keeps its mapping until an
+		 * alias is sent with a topic again, which is what happens for every topic now. */
+		aws_iot_mqtt_internal_reset_topic_aliases(pTable, pTable->aliasCount);
+		pTable->useCounter = 1;
+	}
+
+	leastRecentlyUsed = 0;
+	for(itr = 0; itr < pTable->aliasCount; ++itr) {
+		pAlias = &(pTable->aliases[itr]);
+		if(0 != pAlias->lastUsed && topicNameLen == pAlias->topicNameLen &&
+		   0 == memcmp(pAlias->topicName, pTopicName, topicNameLen)) {
+			pAlias->lastUsed = pTable->useCounter;
+			*pIsAliasKnown = true;
+			return (uint16_t) (itr + 1);
+		}
+		if(pAlias->lastUsed < pTable->aliases[leastRecentlyUsed].lastUsed) {
+			leastRecentlyUsed = itr;
+		}
+	}
+
+	/* New topic, it takes over an unassigned or the least recently used alias. The publish
+	 * carries both the topic and the alias, which tells the server about the new mapping. */
+	pAlias = &(pTable->aliases[leastRecentlyUsed]);
+	memcpy(pAlias->topicName, pTopicName, topicNameLen);
+	pAlias->topicNameLen = topicNameLen;
+	pAlias->lastUsed = pTable->useCounter;
+
+	return (uint16_t) (leastRecentlyUsed + 1);
+}
+
+/**
+ * @brief Result of the PUBACK in the read buffer of a client
+ *
+ * @param pClient MQTT client that read the PUBACK
+ * @param pPacketId Output, packet ID of the acknowledged publish
+ *
+ * @return SUCCESS, MQTT_REQUEST_REJECTED_ERROR with pPacketId set if an MQTT 5.0 server
+ * refused the message, otherwise the error of deserializing the PUBACK
+ */
+IoT_Error_t aws_iot_mqtt_internal_deserialize_puback(AWS_IoT_Client *pClient, uint16_t *pPacketId) {
+	unsigned char dup, type, reasonCode;
+	IoT_Error_t rc;
+
+	if(MQTT_5_0 == pClient->clientData.options.MQTTVersion) {
+		rc = aws_iot_mqtt_internal_deserialize_ack_v5(&type, &dup, pPacketId, &reasonCode,
+													  pClient->clientData.readBuf, pClient->clientData.readBufSize);
+		if(SUCCESS == rc && MQTT5_REASON_CODE_FAILURE <= reasonCode) {
+			IOT_ERROR("PUBACK reason code 0x%02X", reasonCode);
+			rc = MQTT_REQUEST_REJECTED_ERROR;
+		}
+	} else {
+		rc = aws_iot_mqtt_internal_deserialize_ack(&type, &dup, pPacketId, pClient->clientData.readBuf,
+												   pClient->clientData.readBufSize);
+	}
+
+	return rc;
+}
+
+/**
+ * @brief Serialize a publish into the write buffer and send it
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pTopicName Topic Name to publish to
+ * @param topicNameLen Length of the topic name
+ * @param pParams Pointer to Publish Message parameters, with the packet ID set for QoS 1
+ * @param pTimer Time left for the publish
+ *
+ * @return An IoT Error Type defining successful/failed send
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_send_publish(AWS_IoT_Client *pClient, const char *pTopicName,
+													   uint16_t topicNameLen, IoT_Publish_Message_Params *pParams,
+													   Timer *pTimer) {
+	uint32_t len = 0;
+	uint16_t topicAlias = 0;
+	bool isAliasKnown = false;
+	const IoT_Payload_Codec_t *pCodec;
+	const unsigned char *pPayload = (const unsigned char *) pParams->payload;
+	size_t payloadLen = pParams->payloadLen;
+	unsigned char *pEncoded = NULL;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	rc = aws_iot_mqtt_internal_lock_write_buffer(pClient);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* A QoS 0 publish only checked the state before waiting for the write buffer. The
+	 * connection is closed or set up while holding it, after the state has changed. */
+	if(!aws_iot_mqtt_is_client_connected(pClient)) {
+		(void) aws_iot_mqtt_internal_unlock_write_buffer(pClient);
+		FUNC_EXIT_RC(NETWORK_DISCONNECTED_ERROR);
+	}
+
+	/* Encode into a pool block, which is released once the packet is in the write buffer */
+	pCodec = aws_iot_mqtt_internal_find_payload_codec(pClient, pTopicName, topicNameLen);
+	if(NULL != pCodec) {
+		pEncoded = (unsigned char *) aws_iot_pool_alloc(pClient->clientData.pPayloadCodecPool);
+		if(NULL == pEncoded) {
+			(void) aws_iot_mqtt_internal_unlock_write_buffer(pClient);
+			FUNC_EXIT_RC(LIMIT_EXCEEDED_ERROR);
+		}
+		rc = pCodec->encode(pCodec->pContext, pPayload, payloadLen, pEncoded,
+							pClient->clientData.pPayloadCodecPool->blockSize, &payloadLen);
+		if(SUCCESS != rc) {
+			IOT_ERROR("Encoding the payload failed: %d", rc);
+			(void) aws_iot_pool_free(pClient->clientData.pPayloadCodecPool, pEncoded);
+			(void) aws_iot_mqtt_internal_unlock_write_buffer(pClient);
+			FUNC_EXIT_RC(PAYLOAD_CODEC_ERROR);
+		}
+		pPayload = pEncoded;
+	}
+
+	if(MQTT_5_0 == pClient->clientData.options.MQTTVersion) {
+		topicAlias = aws_iot_mqtt_internal_get_topic_alias(&(pClient->clientData.topicAliases), pTopicName,
+														   topicNameLen, &isAliasKnown);
+		rc = aws_iot_mqtt_internal_serialize_publish_v5(pClient->clientData.writeBuf,
+														pClient->clientData.writeBufSize, 0, pParams->qos,
+														pParams->isRetained, pParams->id, pTopicName,
+														isAliasKnown ? 0 : topicNameLen, topicAlias,
+														pPayload, payloadLen, &len);
+		if(SUCCESS == rc && 0 != pClient->clientData.serverMaximumPacketSize &&
+		   len > pClient->clientData.serverMaximumPacketSize) {
+			rc = MAX_SIZE_ERROR;
+		}
+	} else {
+		rc = aws_iot_mqtt_internal_serialize_publish(pClient->clientData.writeBuf,
+													 pClient->clientData.writeBufSize, 0, pParams->qos,
+													 pParams->isRetained, pParams->id, pTopicName, topicNameLen,
+													 pPayload, payloadLen, &len);
+	}
+	if(NULL != pEncoded) {
+		(void) aws_iot_pool_free(pClient->clientData.pPayloadCodecPool, pEncoded);
+	}
+	if(SUCCESS == rc) {
+		/* send the publish packet */
+		rc = aws_iot_mqtt_internal_send_packet(pClient, len, pTimer);
+	}
+	if(SUCCESS != rc && 0 != topicAlias && !isAliasKnown) {
+		/* The server never learned about the new alias */
+		pClient->clientData.topicAliases.aliases[topicAlias - 1].lastUsed = 0;
+	}
+	(void) aws_iot_mqtt_internal_unlock_write_buffer(pClient);
+	FUNC_EXIT_RC(rc);
+}
+
 /**
  * @brief Publish an MQTT message on a topic
  *
@@ -197,10 +435,12 @@ IoT_Error_t aws_iot_mqtt_internal_serialize_ack(unsigned char *pTxBuf, size_t tx
 static IoT_Error_t _aws_iot_mqtt_internal_publish(AWS_IoT_Client *pClient, const char *pTopicName,
 												  uint16_t topicNameLen, IoT_Publish_Message_Params *pParams) {
 	Timer timer;
-	uint32_t len = 0;
-	uint16_t packet_id;
-	unsigned char dup, type;
 	IoT_Error_t rc;
+#ifdef _ENABLE_THREAD_SUPPORT_
+	AckWaiter *pWaiter = NULL;
+#else
+	uint16_t packet_id;
+#endif
 
 	FUNC_ENTRY;
 
@@ -209,43 +449,45 @@ static IoT_Error_t _aws_iot_mqtt_internal_publish(AWS_IoT_Client *pClient, const
 
 	if(QOS1 == pParams->qos) {
 		pParams->id = aws_iot_mqtt_get_next_packet_id(pClient);
+#ifdef _ENABLE_THREAD_SUPPORT_
+		/* Registered before sending, the PUBACK may be read by another thread right away */
+		rc = aws_iot_mqtt_internal_add_ack_waiter(pClient, pParams->id, &timer, &pWaiter);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+#endif
 	}
 
-	rc = _aws_iot_mqtt_internal_serialize_publish(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
-												  pParams->qos, pParams->isRetained, pParams->id, pTopicName,
-												  topicNameLen, (unsigned char *) pParams->payload,
-												  pParams->payloadLen, &len);
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
-	}
-
-	/* send the publish packet */
-	rc = aws_iot_mqtt_internal_send_packet(pClient, len, &timer);
-	if(SUCCESS != rc) {
-		FUNC_EXIT_RC(rc);
-	}
+	rc = _aws_iot_mqtt_internal_send_publish(pClient, pTopicName, topicNameLen, pParams, &timer);
 
 	/* Wait for ack if QoS1 */
-	if(QOS1 == pParams->qos) {
+	if(SUCCESS == rc && QOS1 == pParams->qos) {
+#ifdef _ENABLE_THREAD_SUPPORT_
+		rc = aws_iot_mqtt_internal_wait_for_ack(pClient, pWaiter, &timer);
+#else
 		rc = aws_iot_mqtt_internal_wait_for_read(pClient, PUBACK, &timer);
-		if(SUCCESS != rc) {
-			FUNC_EXIT_RC(rc);
+		if(SUCCESS == rc) {
+			rc = aws_iot_mqtt_internal_deserialize_puback(pClient, &packet_id);
 		}
+#endif
+	}
 
-		rc = aws_iot_mqtt_internal_deserialize_ack(&type, &dup, &packet_id, pClient->clientData.readBuf,
-												   pClient->clientData.readBufSize);
-		if(SUCCESS != rc) {
-			FUNC_EXIT_RC(rc);
-		}
+#ifdef _ENABLE_THREAD_SUPPORT_
+	if(NULL != pWaiter) {
+		aws_iot_mqtt_internal_remove_ack_waiter(pClient, pWaiter);
 	}
+#endif
 
-	FUNC_EXIT_RC(SUCCESS);
+	FUNC_EXIT_RC(rc);
 }
 
 IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
 								 IoT_Publish_Message_Params *pParams) {
-	IoT_Error_t rc, pubRc;
+	IoT_Error_t pubRc;
+#ifndef _ENABLE_THREAD_SUPPORT_
+	IoT_Error_t rc;
 	ClientState clientState;
+#endif
 
 	FUNC_ENTRY;
 
@@ -257,6 +499,22 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
 		FUNC_EXIT_RC(NETWORK_DISCONNECTED_ERROR);
 	}
 
+	/* A QoS0 publish never reads from the network, so it only needs the write side
+	 * of the connection. It does not touch the client state and can run while
+	 * another thread is in yield or waiting for an ack. Concurrent senders are
+	 * serialized on the write buffer, which is also held while the connection is
+	 * closed or set up. */
+	if(QOS0 == pParams->qos) {
+		pubRc = _aws_iot_mqtt_internal_publish(pClient, pTopicName, topicNameLen, pParams);
+		FUNC_EXIT_RC(pubRc);
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	/* A QoS 1 publish waits for its PUBACK in the ack waiters. It reads from the network itself
+	 * only while no other thread does, otherwise the thread that reads the PUBACK hands it over. */
+	pubRc = _aws_iot_mqtt_internal_publish(pClient, pTopicName, topicNameLen, pParams);
+	FUNC_EXIT_RC(pubRc);
+#else
 	clientState = aws_iot_mqtt_get_client_state(pClient);
 	if(CLIENT_STATE_CONNECTED_IDLE != clientState && CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN != clientState) {
 		FUNC_EXIT_RC(MQTT_CLIENT_NOT_IDLE_ERROR);
@@ -275,6 +533,7 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
 	}
 
 	FUNC_EXIT_RC(pubRc);
+#endif
 }
 
 /**
@@ -287,16 +546,17 @@ IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName
   * @param topicNameLen returned uint16_t - the length of the MQTT topic in the publish
   * @param payload returned byte buffer - the MQTT publish payload
   * @param payloadLen returned size_t - the length of the MQTT payload
+  * @param isMqtt5 bool - whether the packet has MQTT 5.0 properties
   * @param pRxBuf the raw buffer data, of the correct length determined by the remaining length field
   * @param rxBufLen the length in bytes of the data in the supplied buffer
   *
   * @return An IoT Error Type defining successful/failed call
   */
-IoT_Error_t aws_iot_mqtt_internal_deserialize_publish(uint8_t *dup, QoS *qos,
-													  uint8_t *retained, uint16_t *pPacketId,
-													  char **pTopicName, uint16_t *topicNameLen,
-													  unsigned char **payload, size_t *payloadLen,
-													  unsigned char *pRxBuf, size_t rxBufLen) {
+static IoT_Error_t _aws_iot_mqtt_deserialize_publish(uint8_t *dup, QoS *qos,
+													 uint8_t *retained, uint16_t *pPacketId,
+													 char **pTopicName, uint16_t *topicNameLen,
+													 unsigned char **payload, size_t *payloadLen,
+													 bool isMqtt5, unsigned char *pRxBuf, size_t rxBufLen) {
 	unsigned char *curData = pRxBuf;
 	unsigned char *endData = NULL;
 	IoT_Error_t rc = FAILURE;
@@ -347,12 +607,36 @@ IoT_Error_t aws_iot_mqtt_internal_deserialize_publish(uint8_t *dup, QoS *qos,
 		*pPacketId = aws_iot_mqtt_internal_read_uint16_t(&curData);
 	}
 
+	/* The client allows no topic aliases from the server, so every publish has a topic */
+	if(isMqtt5 && (SUCCESS != aws_iot_mqtt_internal_read_properties(&curData, endData, NULL) ||
+				   0 == *topicNameLen)) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
 	*payloadLen = (size_t) (endData - curData);
 	*payload = curData;
 
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+IoT_Error_t aws_iot_mqtt_internal_deserialize_publish(uint8_t *dup, QoS *qos,
+													  uint8_t *retained, uint16_t *pPacketId,
+													  char **pTopicName, uint16_t *topicNameLen,
+													  unsigned char **payload, size_t *payloadLen,
+													  unsigned char *pRxBuf, size_t rxBufLen) {
+	return _aws_iot_mqtt_deserialize_publish(dup, qos, retained, pPacketId, pTopicName, topicNameLen,
+											 payload, payloadLen, false, pRxBuf, rxBufLen);
+}
+
+IoT_Error_t aws_iot_mqtt_internal_deserialize_publish_v5(uint8_t *dup, QoS *qos,
+														 uint8_t *retained, uint16_t *pPacketId,
+														 char **pTopicName, uint16_t *topicNameLen,
+														 unsigned char **payload, size_t *payloadLen,
+														 unsigned char *pRxBuf, size_t rxBufLen) {
+	return _aws_iot_mqtt_deserialize_publish(dup, qos, retained, pPacketId, pTopicName, topicNameLen,
+											 payload, payloadLen, true, pRxBuf, rxBufLen);
+}
+
 /**
   * Deserializes the supplied (wire) buffer into an ack
   * @param pPacketType returned integer - the MQTT packet type
@@ -406,6 +690,78 @@ IoT_Error_t aws_iot_mqtt_internal_deserialize_ack(unsigned char *pPacketType, un
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+/**
+  * Deserializes the supplied (wire) buffer into an MQTT 5.0 PUBACK, SUBACK or UNSUBACK
+  *
+  * A PUBACK may end after the packet identifier, the reason code is 0 (success) then.
+  * For SUBACK and UNSUBACK the reason code of the first topic filter is returned.
+  *
+  * @param pPacketType returned integer - the MQTT packet type
+  * @param dup returned integer - the MQTT dup flag
+  * @param pPacketId returned integer - the MQTT packet identifier
+  * @param pReasonCode returned integer - the reason code, MQTT5_REASON_CODE_FAILURE or above for a failure
+  * @param pRxBuf the raw buffer data, of the correct length determined by the remaining length field
+  * @param rxBufLen the length in bytes of the data in the supplied buffer
+  *
+  * @return An IoT Error Type defining successful/failed call
+  */
+IoT_Error_t aws_iot_mqtt_internal_deserialize_ack_v5(unsigned char *pPacketType, unsigned char *dup,
+													 uint16_t *pPacketId, unsigned char *pReasonCode,
+													 unsigned char *pRxBuf, size_t rxBufLen) {
+	IoT_Error_t rc = FAILURE;
+	unsigned char *curdata = pRxBuf;
+	unsigned char *enddata = NULL;
+	uint32_t decodedLen = 0;
+	uint32_t readBytesLen = 0;
+	MQTTHeader header = {0};
+
+	FUNC_ENTRY;
+
+	if(NULL == pPacketType || NULL == dup || NULL == pPacketId || NULL == pReasonCode || NULL == pRxBuf) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	/* Fixed header is two bytes, the packet identifier another two, MQTT v5.0 Specification 3.4 */
+	if(4 > rxBufLen) {
+		FUNC_EXIT_RC(MQTT_RX_BUFFER_TOO_SHORT_ERROR);
+	}
+
+	header.byte = aws_iot_mqtt_internal_read_char(&curdata);
+	*dup = MQTT_HEADER_FIELD_DUP(header.byte);
+	*pPacketType = MQTT_HEADER_FIELD_TYPE(header.byte);
+
+	/* read remaining length */
+	rc = aws_iot_mqtt_internal_decode_remaining_length_from_buffer(curdata, &decodedLen, &readBytesLen);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+	curdata += (readBytesLen);
+	enddata = curdata + decodedLen;
+
+	if(enddata - curdata < 2 || (size_t) (enddata - pRxBuf) > rxBufLen) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	*pPacketId = aws_iot_mqtt_internal_read_uint16_t(&curdata);
+	*pReasonCode = 0;
+
+	if(SUBACK == *pPacketType || UNSUBACK == *pPacketType) {
+		/* Properties, then one reason code per topic filter */
+		if(SUCCESS != aws_iot_mqtt_internal_read_properties(&curdata, enddata, NULL) || curdata >= enddata) {
+			FUNC_EXIT_RC(FAILURE);
+		}
+		*pReasonCode = aws_iot_mqtt_internal_read_char(&curdata);
+	} else if(curdata < enddata) {
+		/* Reason code, then properties if there are any */
+		*pReasonCode = aws_iot_mqtt_internal_read_char(&curdata);
+		if(curdata < enddata && SUCCESS != aws_iot_mqtt_internal_read_properties(&curdata, enddata, NULL)) {
+			FUNC_EXIT_RC(FAILURE);
+		}
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
 #ifdef __cplusplus
 }
 #endif
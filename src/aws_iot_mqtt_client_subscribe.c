@@ -51,6 +51,7 @@ extern "C" {
   * @param pTopicNameList - array of topic filter names
   * @param pTopicNameLenList - array of length of topic filter names
   * @param pRequestedQoSs - array of requested QoS
+  * @param isMqtt5 - whether to write the (empty) MQTT 5.0 properties
   * @param pSerializedLen - the length of the serialized data
   *
   * @return An IoT Error Type defining successful/failed operation
@@ -58,7 +59,7 @@ extern "C" {
 static IoT_Error_t _aws_iot_mqtt_serialize_subscribe(unsigned char *pTxBuf, size_t txBufLen,
 													 unsigned char dup, uint16_t packetId, uint32_t topicCount,
 													 const char **pTopicNameList, uint16_t *pTopicNameLenList,
-													 QoS *pRequestedQoSs, uint32_t *pSerializedLen) {
+													 QoS *pRequestedQoSs, bool isMqtt5, uint32_t *pSerializedLen) {
 	unsigned char *ptr;
 	uint32_t itr, rem_len;
 	IoT_Error_t rc;
@@ -71,6 +72,9 @@ static IoT_Error_t _aws_iot_mqtt_serialize_subscribe(unsigned char *pTxBuf, size
 
 	ptr = pTxBuf;
 	rem_len = 2; /* packetId */
+	if(isMqtt5) {
+		rem_len += 1; /* property length */
+	}
 
 	for(itr = 0; itr < topicCount; ++itr) {
 		rem_len += (uint32_t) (pTopicNameLenList[itr] + 2 + 1); /* topic + length + req_qos */
@@ -91,6 +95,9 @@ static IoT_Error_t _aws_iot_mqtt_serialize_subscribe(unsigned char *pTxBuf, size
 	ptr += aws_iot_mqtt_internal_write_len_to_buffer(ptr, rem_len);
 
 	aws_iot_mqtt_internal_write_uint_16(&ptr, packetId);
+	if(isMqtt5) {
+		aws_iot_mqtt_internal_write_char(&ptr, 0);
+	}
 
 	for(itr = 0; itr < topicCount; ++itr) {
 		aws_iot_mqtt_internal_write_utf8_string(&ptr, pTopicNameList[itr], pTopicNameLenList[itr]);
@@ -107,14 +114,15 @@ static IoT_Error_t _aws_iot_mqtt_serialize_subscribe(unsigned char *pTxBuf, size
   * @param pPacketId returned integer - the MQTT packet identifier
   * @param maxExpectedQoSCount - the maximum number of members allowed in the grantedQoSs array
   * @param pGrantedQoSCount returned uint32_t - number of members in the grantedQoSs array
-  * @param pGrantedQoSs returned array of QoS type - the granted qualities of service
+  * @param pGrantedQoSs returned array of QoS type - the granted qualities of service, or the MQTT 5.0 reason codes
+  * @param isMqtt5 - whether the packet has MQTT 5.0 properties
   * @param pRxBuf the raw buffer data, of the correct length determined by the remaining length field
   * @param rxBufLen the length in bytes of the data in the supplied buffer
   *
   * @return An IoT Error Type defining successful/failed operation
   */
 static IoT_Error_t _aws_iot_mqtt_deserialize_suback(uint16_t *pPacketId, uint32_t maxExpectedQoSCount,
-													uint32_t *pGrantedQoSCount, QoS *pGrantedQoSs,
+													uint32_t *pGrantedQoSCount, QoS *pGrantedQoSs, bool isMqtt5,
 													unsigned char *pRxBuf, size_t rxBufLen) {
 	unsigned char *curData, *endData;
 	uint32_t decodedLen, readBytesLen;
@@ -158,6 +166,11 @@ static IoT_Error_t _aws_iot_mqtt_deserialize_suback(uint16_t *pPacketId, uint32_
 
 	*pPacketId = aws_iot_mqtt_internal_read_uint16_t(&curData);
 
+	if(isMqtt5 && ((size_t) (endData - pRxBuf) > rxBufLen ||
+				   SUCCESS != aws_iot_mqtt_internal_read_properties(&curData, endData, NULL))) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
 	*pGrantedQoSCount = 0;
 	while(curData < endData) {
 		if(*pGrantedQoSCount > maxExpectedQoSCount) {
@@ -169,21 +182,6 @@ static IoT_Error_t _aws_iot_mqtt_deserialize_suback(uint16_t *pPacketId, uint32_
 	FUNC_EXIT_RC(SUCCESS);
 }
 
-/* Returns MAX_MESSAGE_HANDLERS value if no free index is available */
-static uint32_t _aws_iot_mqtt_get_free_message_handler_index(AWS_IoT_Client *pClient) {
-	uint32_t itr;
-
-	FUNC_ENTRY;
-
-	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; itr++) {
-		if(pClient->clientData.messageHandlers[itr].topicName == NULL) {
-			break;
-		}
-	}
-
-	FUNC_EXIT_RC(itr);
-}
-
 /**
  * @brief Subscribe to an MQTT topic.
  *
@@ -209,10 +207,12 @@ static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, con
 													pApplicationHandler_t pApplicationHandler,
 													void *pApplicationHandlerData) {
 	uint16_t txPacketId, rxPacketId;
-	uint32_t serializedLen, indexOfFreeMessageHandler, count;
+	uint32_t serializedLen, count;
 	IoT_Error_t rc;
 	Timer timer;
 	QoS grantedQoS[3] = {QOS0, QOS0, QOS0};
+	MessageHandlers handler;
+	bool isMqtt5 = (MQTT_5_0 == pClient->clientData.options.MQTTVersion);
 
 	FUNC_ENTRY;
 	init_timer(&timer);
@@ -223,19 +223,23 @@ static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, con
 	txPacketId = aws_iot_mqtt_get_next_packet_id(pClient);
 	rxPacketId = 0;
 
-	rc = _aws_iot_mqtt_serialize_subscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
-										   txPacketId, 1, &pTopicName, &topicNameLen, &qos, &serializedLen);
+	if(aws_iot_mqtt_internal_subscription_store_is_full(&(pClient->clientData.subscriptions))) {
+		FUNC_EXIT_RC(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR);
+	}
+
+	rc = aws_iot_mqtt_internal_lock_write_buffer(pClient);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
-	indexOfFreeMessageHandler = _aws_iot_mqtt_get_free_message_handler_index(pClient);
-	if(AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS <= indexOfFreeMessageHandler) {
-		FUNC_EXIT_RC(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR);
+	rc = _aws_iot_mqtt_serialize_subscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
+										   txPacketId, 1, &pTopicName, &topicNameLen, &qos, isMqtt5,
+										   &serializedLen);
+	if(SUCCESS == rc) {
+		/* send the subscribe packet */
+		rc = aws_iot_mqtt_internal_send_packet(pClient, serializedLen, &timer);
 	}
-
-	/* send the subscribe packet */
-	rc = aws_iot_mqtt_internal_send_packet(pClient, serializedLen, &timer);
+	(void) aws_iot_mqtt_internal_unlock_write_buffer(pClient);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
@@ -247,12 +251,17 @@ static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, con
 	}
 
 	/* Granted QoS can be 0, 1 or 2 */
-	rc = _aws_iot_mqtt_deserialize_suback(&rxPacketId, 1, &count, grantedQoS, pClient->clientData.readBuf,
+	rc = _aws_iot_mqtt_deserialize_suback(&rxPacketId, 1, &count, grantedQoS, isMqtt5, pClient->clientData.readBuf,
 										  pClient->clientData.readBufSize);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
+	if(isMqtt5 && 0 < count && MQTT5_REASON_CODE_FAILURE <= (unsigned int) grantedQoS[0]) {
+		IOT_ERROR("SUBACK reason code 0x%02X", (unsigned int) grantedQoS[0]);
+		FUNC_EXIT_RC(MQTT_REQUEST_REJECTED_ERROR);
+	}
+
 	/* TODO : Figure out how to test this before activating this check */
 	//if(txPacketId != rxPacketId) {
 	/* Different SUBACK received than expected. Return error
@@ -260,15 +269,17 @@ static IoT_Error_t _aws_iot_mqtt_internal_subscribe(AWS_IoT_Client *pClient, con
 	//	return RX_MESSAGE_INVALID_ERROR;
 	//}
 
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].topicName =
-			pTopicName;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].topicNameLen =
-			topicNameLen;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].pApplicationHandler =
-			pApplicationHandler;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].pApplicationHandlerData =
-			pApplicationHandlerData;
-	pClient->clientData.messageHandlers[indexOfFreeMessageHandler].qos = qos;
+	handler.topicName = pTopicName;
+	handler.topicNameLen = topicNameLen;
+	handler.resubscribed = 0;
+	handler.qos = qos;
+	handler.pApplicationHandler = pApplicationHandler;
+	handler.pApplicationHandlerData = pApplicationHandlerData;
+
+	/* Cannot fail, the client state only lets one subscribe run at a time */
+	if(NULL == aws_iot_mqtt_internal_subscription_store_add(&(pClient->clientData.subscriptions), &handler)) {
+		FUNC_EXIT_RC(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR);
+	}
 
 	FUNC_EXIT_RC(SUCCESS);
 }
@@ -324,43 +335,49 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
  */
 static IoT_Error_t _aws_iot_mqtt_internal_resubscribe(AWS_IoT_Client *pClient) {
 	uint16_t packetId;
-	uint32_t len, count, existingSubCount, itr;
-	IoT_Error_t rc;
+	uint32_t len, count, capacity, itr;
+	IoT_Error_t rc, rejectedRc = SUCCESS;
 	Timer timer;
 	QoS grantedQoS[3] = {QOS0, QOS0, QOS0};
+	MessageHandlers *pHandler;
+	bool isMqtt5 = (MQTT_5_0 == pClient->clientData.options.MQTTVersion);
 
 	FUNC_ENTRY;
 
 	packetId = 0;
 	len = 0;
 	count = 0;
-	existingSubCount = _aws_iot_mqtt_get_free_message_handler_index(pClient);
+	capacity = aws_iot_mqtt_internal_subscription_store_capacity(&(pClient->clientData.subscriptions));
 
-	for(itr = 0; itr < existingSubCount; itr++) {
-		if(pClient->clientData.messageHandlers[itr].topicName == NULL) {
+	for(itr = 0; itr < capacity; itr++) {
+		pHandler = aws_iot_mqtt_internal_subscription_store_at(&(pClient->clientData.subscriptions), itr);
+		if(NULL == pHandler) {
 			continue;
 		}
 
 		/* Do not attempt to subscribe to topics which have already been subscribed
 		 to in the previous re-subscribe attempts. */
-		if(pClient->clientData.messageHandlers[itr].resubscribed == 1) {
+		if(pHandler->resubscribed == 1) {
 			continue;
 		}
 
 		init_timer(&timer);
 		countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
 
-		rc = _aws_iot_mqtt_serialize_subscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
-											   aws_iot_mqtt_get_next_packet_id(pClient), 1,
-											   &(pClient->clientData.messageHandlers[itr].topicName),
-											   &(pClient->clientData.messageHandlers[itr].topicNameLen),
-											   &(pClient->clientData.messageHandlers[itr].qos), &len);
+		rc = aws_iot_mqtt_internal_lock_write_buffer(pClient);
 		if(SUCCESS != rc) {
 			FUNC_EXIT_RC(rc);
 		}
 
-		/* send the subscribe packet */
-		rc = aws_iot_mqtt_internal_send_packet(pClient, len, &timer);
+		rc = _aws_iot_mqtt_serialize_subscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
+											   aws_iot_mqtt_get_next_packet_id(pClient), 1,
+											   &(pHandler->topicName), &(pHandler->topicNameLen), &(pHandler->qos),
+											   isMqtt5, &len);
+		if(SUCCESS == rc) {
+			/* send the subscribe packet */
+			rc = aws_iot_mqtt_internal_send_packet(pClient, len, &timer);
+		}
+		(void) aws_iot_mqtt_internal_unlock_write_buffer(pClient);
 		if(SUCCESS != rc) {
 			FUNC_EXIT_RC(rc);
 		}
@@ -372,18 +389,29 @@ static IoT_Error_t _aws_iot_mqtt_internal_resubscribe(AWS_IoT_Client *pClient) {
 		}
 
 		/* Granted QoS can be 0, 1 or 2 */
-		rc = _aws_iot_mqtt_deserialize_suback(&packetId, 1, &count, grantedQoS, pClient->clientData.readBuf,
-											  pClient->clientData.readBufSize);
+		rc = _aws_iot_mqtt_deserialize_suback(&packetId, 1, &count, grantedQoS, isMqtt5,
+											  pClient->clientData.readBuf, pClient->clientData.readBufSize);
 		if(SUCCESS != rc) {
 			FUNC_EXIT_RC(rc);
 		}
 
+		/* A filter the server refuses now is dropped like one refused by aws_iot_mqtt_subscribe,
+		 * asking again on the next attempt would only be refused again */
+		if(isMqtt5 && 0 < count && MQTT5_REASON_CODE_FAILURE <= (unsigned int) grantedQoS[0]) {
+			IOT_ERROR("Resubscribe to %.*s refused with SUBACK reason code 0x%02X", (int) pHandler->topicNameLen,
+					  pHandler->topicName, (unsigned int) grantedQoS[0]);
+			(void) aws_iot_mqtt_internal_subscription_store_remove(&(pClient->clientData.subscriptions),
+																   pHandler->topicName, pHandler->topicNameLen);
+			rejectedRc = MQTT_REQUEST_REJECTED_ERROR;
+			continue;
+		}
+
 		/* Record that this topic has been subscribed to, so that we do not
 		 * attempt to subscribe again to the same topic. */
-		pClient->clientData.messageHandlers[itr].resubscribed = 1;
+		pHandler->resubscribed = 1;
 	}
 
-	FUNC_EXIT_RC(SUCCESS);
+	FUNC_EXIT_RC(rejectedRc);
 }
 
 IoT_Error_t aws_iot_mqtt_resubscribe(AWS_IoT_Client *pClient) {
@@ -422,9 +450,12 @@ IoT_Error_t aws_iot_mqtt_resubscribe(AWS_IoT_Client *pClient) {
 
 	/* It is possible that the subscribe operation fails, do not change the state
 	 in that case so that the subscribe is attempted again in the next iteration
-	 of yield. */
-	if(SUCCESS == resubRc) {
-		resubRc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_RESUBSCRIBE_IN_PROGRESS, CLIENT_STATE_CONNECTED_IDLE);
+	 of yield. Refused filters have been dropped and are not attempted again. */
+	if(SUCCESS == resubRc || MQTT_REQUEST_REJECTED_ERROR == resubRc) {
+		rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_RESUBSCRIBE_IN_PROGRESS, CLIENT_STATE_CONNECTED_IDLE);
+		if(SUCCESS != rc) {
+			resubRc = rc;
+		}
 	}
 
 	FUNC_EXIT_RC(resubRc);
@@ -0,0 +1,388 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_mqtt_client_subscription_store.c
+ * @brief Subscription store of the MQTT client
+ *
+ * Handlers are never moved once added, so a pointer returned by the store stays valid until the
+ * subscription is removed. Removed handlers keep their hash link so that a match in progress can
+ * continue past them when a callback unsubscribes. For the same reason the slot of a handler removed
+ * during a match is only given back to the pool when the last match ends, a callback that adds a
+ * handler must not relink a slot the cursor is about to follow. The wildcard list is not compacted
+ * while a match is in progress either, removed entries are left as AWS_IOT_MQTT_SUBSCRIPTION_NONE
+ * and dropped when the last match ends.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aws_iot_mqtt_client_common_internal.h"
+
+/** Marks the end of a hash bucket and a handler that is not in the wildcard list */
+#define AWS_IOT_MQTT_SUBSCRIPTION_NONE 0xFFFFFFFFu
+/** Wildcard position of a slot removed during a match that has not been given back to the pool yet */
+#define AWS_IOT_MQTT_SUBSCRIPTION_REMOVED 0xFFFFFFFEu
+
+#define AWS_IOT_MQTT_SUBSCRIPTION_FNV_OFFSET 2166136261u
+#define AWS_IOT_MQTT_SUBSCRIPTION_FNV_PRIME 16777619u
+
+/* Length of a topic filter up to its first NUL character */
+static uint16_t _aws_iot_mqtt_subscription_key_length(const char *pTopicFilter, uint16_t topicFilterLen) {
+	uint16_t len = 0;
+
+	while(len < topicFilterLen && '\0' != pTopicFilter[len]) {
+		len++;
+	}
+
+	return len;
+}
+
+/* FNV-1a, topic filters are short and share long prefixes so every byte has to count */
+static uint32_t _aws_iot_mqtt_subscription_hash(const char *pKey, uint16_t keyLen) {
+	uint32_t hash = AWS_IOT_MQTT_SUBSCRIPTION_FNV_OFFSET;
+	uint16_t i;
+
+	for(i = 0; i < keyLen; i++) {
+		hash ^= (unsigned char) pKey[i];
+		hash *= AWS_IOT_MQTT_SUBSCRIPTION_FNV_PRIME;
+	}
+
+	return hash;
+}
+
+static bool _aws_iot_mqtt_subscription_key_equals(const MessageHandlers *pHandler, const char *pKey, uint16_t keyLen) {
+	return keyLen <= pHandler->topicNameLen && 0 == memcmp(pHandler->topicName, pKey, keyLen) &&
+		   (keyLen == pHandler->topicNameLen || '\0' == pHandler->topicName[keyLen]);
+}
+
+static bool _aws_iot_mqtt_subscription_has_wildcard(const char *pKey, uint16_t keyLen) {
+	return NULL != memchr(pKey, '+', keyLen) || NULL != memchr(pKey, '#', keyLen);
+}
+
+IoT_Error_t aws_iot_mqtt_internal_subscription_store_init(SubscriptionStore *pStore, MessageHandlers *pHandlers,
+														  uint32_t capacity, uint32_t *pLinks,
+														  uint32_t *pBuckets, uint32_t bucketCount) {
+	uint32_t buckets = 1;
+	uint32_t i;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pStore || NULL == pHandlers || NULL == pLinks || NULL == pBuckets || 0 == capacity ||
+	   0 == bucketCount) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = aws_iot_pool_init(&(pStore->handlerPool), pHandlers, sizeof(MessageHandlers), capacity, pLinks);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* Round down to a power of two so that the bucket is picked with a mask */
+	while(buckets <= bucketCount / 2) {
+		buckets <<= 1;
+	}
+
+	pStore->pHandlers = pHandlers;
+	pStore->pBuckets = pBuckets;
+	pStore->pChain = pLinks + capacity;
+	pStore->pWildcards = pLinks + 2 * (size_t) capacity;
+	pStore->pWildcardPos = pLinks + 3 * (size_t) capacity;
+	pStore->bucketMask = buckets - 1;
+	pStore->wildcardCount = 0;
+	pStore->wildcardsRemoved = 0;
+	pStore->slotsRemoved = 0;
+	pStore->matchDepth = 0;
+	pStore->count = 0;
+
+	for(i = 0; i < buckets; i++) {
+		pBuckets[i] = AWS_IOT_MQTT_SUBSCRIPTION_NONE;
+	}
+
+	for(i = 0; i < capacity; i++) {
+		pHandlers[i].topicName = NULL;
+		pHandlers[i].topicNameLen = 0;
+		pHandlers[i].resubscribed = 0;
+		pHandlers[i].qos = QOS0;
+		pHandlers[i].pApplicationHandler = NULL;
+		pHandlers[i].pApplicationHandlerData = NULL;
+		pStore->pChain[i] = AWS_IOT_MQTT_SUBSCRIPTION_NONE;
+		pStore->pWildcardPos[i] = AWS_IOT_MQTT_SUBSCRIPTION_NONE;
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_mqtt_internal_subscription_store_init_from_arena(SubscriptionStore *pStore, IoT_Arena_t *pArena,
+																	 uint32_t capacity) {
+	MessageHandlers *pHandlers;
+	uint32_t *pLinks;
+	uint32_t *pBuckets;
+	uint32_t bucketCount = 1;
+
+	FUNC_ENTRY;
+
+	if(NULL == pStore || NULL == pArena || 0 == capacity) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	/* Only possible where size_t is 32 bits wide */
+	if((uint64_t) capacity * (sizeof(MessageHandlers) + (AWS_IOT_MQTT_SUBSCRIPTION_LINKS_PER_HANDLER + 2) *
+							  sizeof(uint32_t)) > (size_t) -1) {
+		FUNC_EXIT_RC(ARENA_EXHAUSTED_ERROR);
+	}
+
+	/* At least one bucket per handler keeps the chains short */
+	while(bucketCount < capacity && bucketCount < 0x80000000u) {
+		bucketCount <<= 1;
+	}
+
+	pHandlers = (MessageHandlers *) aws_iot_arena_alloc(pArena, sizeof(MessageHandlers) * capacity);
+	pLinks = (uint32_t *) aws_iot_arena_alloc(pArena, sizeof(uint32_t) * AWS_IOT_MQTT_SUBSCRIPTION_LINKS_PER_HANDLER *
+														  (size_t) capacity);
+	pBuckets = (uint32_t *) aws_iot_arena_alloc(pArena, sizeof(uint32_t) * (size_t) bucketCount);
+	if(NULL == pHandlers || NULL == pLinks || NULL == pBuckets) {
+		FUNC_EXIT_RC(ARENA_EXHAUSTED_ERROR);
+	}
+
+	FUNC_EXIT_RC(aws_iot_mqtt_internal_subscription_store_init(pStore, pHandlers, capacity, pLinks, pBuckets,
+															   bucketCount));
+}
+
+uint32_t aws_iot_mqtt_internal_subscription_store_capacity(const SubscriptionStore *pStore) {
+	return aws_iot_pool_capacity(&(pStore->handlerPool));
+}
+
+bool aws_iot_mqtt_internal_subscription_store_is_full(const SubscriptionStore *pStore) {
+	return pStore->count + pStore->slotsRemoved >= aws_iot_pool_capacity(&(pStore->handlerPool));
+}
+
+/* Drops the entries of the wildcard list removed during a match, keeping the order of the others */
+static void _aws_iot_mqtt_subscription_compact_wildcards(SubscriptionStore *pStore) {
+	uint32_t from, to = 0;
+
+	for(from = 0; from < pStore->wildcardCount; from++) {
+		if(AWS_IOT_MQTT_SUBSCRIPTION_NONE != pStore->pWildcards[from]) {
+			pStore->pWildcards[to] = pStore->pWildcards[from];
+			pStore->pWildcardPos[pStore->pWildcards[to]] = to;
+			to++;
+		}
+	}
+
+	pStore->wildcardCount = to;
+	pStore->wildcardsRemoved = 0;
+}
+
+/* Gives the slots removed during a match back to the pool */
+static void _aws_iot_mqtt_subscription_free_removed_slots(SubscriptionStore *pStore) {
+	uint32_t index;
+
+	for(index = 0; index < aws_iot_pool_capacity(&(pStore->handlerPool)); index++) {
+		if(AWS_IOT_MQTT_SUBSCRIPTION_REMOVED == pStore->pWildcardPos[index]) {
+			pStore->pWildcardPos[index] = AWS_IOT_MQTT_SUBSCRIPTION_NONE;
+			(void) aws_iot_pool_free(&(pStore->handlerPool), &(pStore->pHandlers[index]));
+		}
+	}
+
+	pStore->slotsRemoved = 0;
+}
+
+MessageHandlers *aws_iot_mqtt_internal_subscription_store_add(SubscriptionStore *pStore,
+															  const MessageHandlers *pHandler) {
+	MessageHandlers *pSlot;
+	uint32_t index, bucket, pos;
+	uint16_t keyLen;
+
+	if(NULL == pStore || NULL == pHandler || NULL == pHandler->topicName) {
+		return NULL;
+	}
+
+	pSlot = (MessageHandlers *) aws_iot_pool_alloc(&(pStore->handlerPool));
+	if(NULL == pSlot) {
+		return NULL;
+	}
+
+	*pSlot = *pHandler;
+	index = (uint32_t) (pSlot - pStore->pHandlers);
+	keyLen = _aws_iot_mqtt_subscription_key_length(pSlot->topicName, pSlot->topicNameLen);
+
+	bucket = _aws_iot_mqtt_subscription_hash(pSlot->topicName, keyLen) & pStore->bucketMask;
+	pStore->pChain[index] = pStore->pBuckets[bucket];
+	pStore->pBuckets[bucket] = index;
+
+	if(_aws_iot_mqtt_subscription_has_wildcard(pSlot->topicName, keyLen)) {
+		pos = pStore->wildcardCount;
+		if(pos == aws_iot_pool_capacity(&(pStore->handlerPool))) {
+			/* The list is full of entries removed during this match, reuse one. A match in
+			 * progress may miss the new handler, which it is allowed to */
+			for(pos = 0; AWS_IOT_MQTT_SUBSCRIPTION_NONE != pStore->pWildcards[pos]; pos++) {
+			}
+			pStore->wildcardsRemoved--;
+		} else {
+			pStore->wildcardCount++;
+		}
+		pStore->pWildcardPos[index] = pos;
+		pStore->pWildcards[pos] = index;
+	} else {
+		pStore->pWildcardPos[index] = AWS_IOT_MQTT_SUBSCRIPTION_NONE;
+	}
+
+	pStore->count++;
+
+	return pSlot;
+}
+
+MessageHandlers *aws_iot_mqtt_internal_subscription_store_find(const SubscriptionStore *pStore,
+															   const char *pTopicFilter, uint16_t topicFilterLen) {
+	uint32_t index;
+	uint16_t keyLen;
+
+	if(NULL == pStore || NULL == pTopicFilter) {
+		return NULL;
+	}
+
+	keyLen = _aws_iot_mqtt_subscription_key_length(pTopicFilter, topicFilterLen);
+	index = pStore->pBuckets[_aws_iot_mqtt_subscription_hash(pTopicFilter, keyLen) & pStore->bucketMask];
+	while(AWS_IOT_MQTT_SUBSCRIPTION_NONE != index) {
+		if(_aws_iot_mqtt_subscription_key_equals(&(pStore->pHandlers[index]), pTopicFilter, keyLen)) {
+			return &(pStore->pHandlers[index]);
+		}
+		index = pStore->pChain[index];
+	}
+
+	return NULL;
+}
+
+uint32_t aws_iot_mqtt_internal_subscription_store_remove(SubscriptionStore *pStore, const char *pTopicFilter,
+														 uint16_t topicFilterLen) {
+	uint32_t *pLink;
+	uint32_t index, pos, last;
+	uint32_t removed = 0;
+	uint16_t keyLen;
+
+	if(NULL == pStore || NULL == pTopicFilter) {
+		return 0;
+	}
+
+	keyLen = _aws_iot_mqtt_subscription_key_length(pTopicFilter, topicFilterLen);
+	pLink = &(pStore->pBuckets[_aws_iot_mqtt_subscription_hash(pTopicFilter, keyLen) & pStore->bucketMask]);
+
+	/* Keep going after the first match, the same filter may be registered with 2 callbacks */
+	while(AWS_IOT_MQTT_SUBSCRIPTION_NONE != *pLink) {
+		index = *pLink;
+		if(!_aws_iot_mqtt_subscription_key_equals(&(pStore->pHandlers[index]), pTopicFilter, keyLen)) {
+			pLink = &(pStore->pChain[index]);
+			continue;
+		}
+
+		*pLink = pStore->pChain[index];
+
+		pos = pStore->pWildcardPos[index];
+		if(AWS_IOT_MQTT_SUBSCRIPTION_NONE != pos && 0 < pStore->matchDepth) {
+			/* Moving the last entry here could put it behind the cursor of the match */
+			pStore->pWildcards[pos] = AWS_IOT_MQTT_SUBSCRIPTION_NONE;
+			pStore->wildcardsRemoved++;
+			pStore->pWildcardPos[index] = AWS_IOT_MQTT_SUBSCRIPTION_NONE;
+		} else if(AWS_IOT_MQTT_SUBSCRIPTION_NONE != pos) {
+			last = pStore->pWildcards[--pStore->wildcardCount];
+			pStore->pWildcards[pos] = last;
+			pStore->pWildcardPos[last] = pos;
+			pStore->pWildcardPos[index] = AWS_IOT_MQTT_SUBSCRIPTION_NONE;
+		}
+
+		pStore->pHandlers[index].topicName = NULL;
+		if(0 < pStore->matchDepth) {
+			/* A cursor may still follow the chain link of this slot */
+			pStore->pWildcardPos[index] = AWS_IOT_MQTT_SUBSCRIPTION_REMOVED;
+			pStore->slotsRemoved++;
+		} else {
+			(void) aws_iot_pool_free(&(pStore->handlerPool), &(pStore->pHandlers[index]));
+		}
+		pStore->count--;
+		removed++;
+	}
+
+	return removed;
+}
+
+MessageHandlers *aws_iot_mqtt_internal_subscription_store_at(const SubscriptionStore *pStore, uint32_t index) {
+	if(NULL == pStore || index >= aws_iot_pool_capacity(&(pStore->handlerPool)) ||
+	   NULL == pStore->pHandlers[index].topicName) {
+		return NULL;
+	}
+
+	return &(pStore->pHandlers[index]);
+}
+
+/* Every match_begin has to be followed by match_end once the handlers were called */
+void aws_iot_mqtt_internal_subscription_store_match_begin(SubscriptionStore *pStore, const char *pTopicName,
+														  uint16_t topicNameLen, SubscriptionMatchCursor *pCursor) {
+	pCursor->next = pStore->pBuckets[_aws_iot_mqtt_subscription_hash(pTopicName, topicNameLen) & pStore->bucketMask];
+	pCursor->wildcardPos = 0;
+	pStore->matchDepth++;
+}
+
+/* A handler added by a callback while a match is in progress may or may not be returned, a
+ * removed one is not returned any more, every other handler is returned once */
+MessageHandlers *aws_iot_mqtt_internal_subscription_store_match_next(const SubscriptionStore *pStore,
+																	 char *pTopicName, uint16_t topicNameLen,
+																	 SubscriptionMatchCursor *pCursor) {
+	MessageHandlers *pHandler;
+	uint32_t index;
+
+	/* Exact filters first, wildcard filters sharing the bucket are matched below */
+	while(AWS_IOT_MQTT_SUBSCRIPTION_NONE != pCursor->next) {
+		index = pCursor->next;
+		pHandler = &(pStore->pHandlers[index]);
+		pCursor->next = pStore->pChain[index];
+		if(NULL != pHandler->topicName && AWS_IOT_MQTT_SUBSCRIPTION_NONE == pStore->pWildcardPos[index] &&
+		   _aws_iot_mqtt_subscription_key_equals(pHandler, pTopicName, topicNameLen)) {
+			return pHandler;
+		}
+	}
+
+	while(pCursor->wildcardPos < pStore->wildcardCount) {
+		index = pStore->pWildcards[pCursor->wildcardPos++];
+		if(AWS_IOT_MQTT_SUBSCRIPTION_NONE == index) {
+			continue;
+		}
+		pHandler = &(pStore->pHandlers[index]);
+		if(aws_iot_mqtt_internal_is_topic_matched((char *) pHandler->topicName, pTopicName, topicNameLen)) {
+			return pHandler;
+		}
+	}
+
+	return NULL;
+}
+
+void aws_iot_mqtt_internal_subscription_store_match_end(SubscriptionStore *pStore) {
+	if(0 < pStore->matchDepth) {
+		pStore->matchDepth--;
+	}
+
+	if(0 == pStore->matchDepth && 0 < pStore->wildcardsRemoved) {
+		_aws_iot_mqtt_subscription_compact_wildcards(pStore);
+	}
+
+	if(0 == pStore->matchDepth && 0 < pStore->slotsRemoved) {
+		_aws_iot_mqtt_subscription_free_removed_slots(pStore);
+	}
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -50,13 +50,15 @@ extern "C" {
   * @param count - number of members in the topicFilters array
   * @param pTopicNameList - array of topic filter names
   * @param pTopicNameLenList - array of length of topic filter names in pTopicNameList
+  * @param isMqtt5 - whether to write the (empty) MQTT 5.0 properties
   * @param pSerializedLen - the length of the serialized data
   * @return IoT_Error_t indicating function execution status
   */
 static IoT_Error_t _aws_iot_mqtt_serialize_unsubscribe(unsigned char *pTxBuf, size_t txBufLen,
 													   uint8_t dup, uint16_t packetId,
 													   uint32_t count, const char **pTopicNameList,
-													   uint16_t *pTopicNameLenList, uint32_t *pSerializedLen) {
+													   uint16_t *pTopicNameLenList, bool isMqtt5,
+													   uint32_t *pSerializedLen) {
 	unsigned char *ptr = pTxBuf;
 	uint32_t i = 0;
 	uint32_t rem_len = 2; /* packetId */
@@ -65,6 +67,10 @@ static IoT_Error_t _aws_iot_mqtt_serialize_unsubscribe(unsigned char *pTxBuf, si
 
 	FUNC_ENTRY;
 
+	if(isMqtt5) {
+		rem_len += 1; /* property length */
+	}
+
 	for(i = 0; i < count; ++i) {
 		rem_len += (uint32_t) (pTopicNameLenList[i] + 2); /* topic + length */
 	}
@@ -82,6 +88,9 @@ static IoT_Error_t _aws_iot_mqtt_serialize_unsubscribe(unsigned char *pTxBuf, si
 	ptr += aws_iot_mqtt_internal_write_len_to_buffer(ptr, rem_len); /* write remaining length */
 
 	aws_iot_mqtt_internal_write_uint_16(&ptr, packetId);
+	if(isMqtt5) {
+		aws_iot_mqtt_internal_write_char(&ptr, 0);
+	}
 
 	for(i = 0; i < count; ++i) {
 		aws_iot_mqtt_internal_write_utf8_string(&ptr, pTopicNameList[i], pTopicNameLenList[i]);
@@ -96,21 +105,32 @@ static IoT_Error_t _aws_iot_mqtt_serialize_unsubscribe(unsigned char *pTxBuf, si
 /**
   * Deserializes the supplied (wire) buffer into unsuback data
   * @param pPacketId returned integer - the MQTT packet identifier
+  * @param isMqtt5 - whether the packet has MQTT 5.0 properties and reason codes
   * @param pRxBuf the raw buffer data, of the correct length determined by the remaining length field
   * @param rxBufLen the length in bytes of the data in the supplied buffer
   * @return IoT_Error_t indicating function execution status
   */
-static IoT_Error_t _aws_iot_mqtt_deserialize_unsuback(uint16_t *pPacketId, unsigned char *pRxBuf, size_t rxBufLen) {
+static IoT_Error_t _aws_iot_mqtt_deserialize_unsuback(uint16_t *pPacketId, bool isMqtt5,
+													  unsigned char *pRxBuf, size_t rxBufLen) {
 	unsigned char type = 0;
 	unsigned char dup = 0;
+	unsigned char reasonCode = 0;
 	IoT_Error_t rc;
 
 	FUNC_ENTRY;
 
-	rc = aws_iot_mqtt_internal_deserialize_ack(&type, &dup, pPacketId, pRxBuf, rxBufLen);
+	if(isMqtt5) {
+		rc = aws_iot_mqtt_internal_deserialize_ack_v5(&type, &dup, pPacketId, &reasonCode, pRxBuf, rxBufLen);
+	} else {
+		rc = aws_iot_mqtt_internal_deserialize_ack(&type, &dup, pPacketId, pRxBuf, rxBufLen);
+	}
 	if(SUCCESS == rc && UNSUBACK != type) {
 		rc = FAILURE;
 	}
+	if(SUCCESS == rc && MQTT5_REASON_CODE_FAILURE <= reasonCode) {
+		IOT_ERROR("UNSUBACK reason code 0x%02X", reasonCode);
+		rc = MQTT_REQUEST_REJECTED_ERROR;
+	}
 
 	FUNC_EXIT_RC(rc);
 }
@@ -138,37 +158,32 @@ static IoT_Error_t _aws_iot_mqtt_internal_unsubscribe(AWS_IoT_Client *pClient, c
 
 	uint16_t packet_id;
 	uint32_t serializedLen = 0;
-	uint32_t i = 0;
 	IoT_Error_t rc;
-	bool subscriptionExists = false;
+	bool isMqtt5 = (MQTT_5_0 == pClient->clientData.options.MQTTVersion);
 
 	FUNC_ENTRY;
 
-	/* Remove from message handler array */
-	for(i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++i) {
-		if(pClient->clientData.messageHandlers[i].topicName != NULL &&
-		   (strcmp(pClient->clientData.messageHandlers[i].topicName, pTopicFilter) == 0)) {
-			subscriptionExists = true;
-            break;
-		}
-	}
-
-	if(false == subscriptionExists) {
+	if(NULL == aws_iot_mqtt_internal_subscription_store_find(&(pClient->clientData.subscriptions), pTopicFilter,
+															 topicFilterLen)) {
 		FUNC_EXIT_RC(FAILURE);
 	}
 
 	init_timer(&timer);
 	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
 
-	rc = _aws_iot_mqtt_serialize_unsubscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
-											 aws_iot_mqtt_get_next_packet_id(pClient), 1, &pTopicFilter,
-											 &topicFilterLen, &serializedLen);
+	rc = aws_iot_mqtt_internal_lock_write_buffer(pClient);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
-	/* send the unsubscribe packet */
-	rc = aws_iot_mqtt_internal_send_packet(pClient, serializedLen, &timer);
+	rc = _aws_iot_mqtt_serialize_unsubscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
+											 aws_iot_mqtt_get_next_packet_id(pClient), 1, &pTopicFilter,
+											 &topicFilterLen, isMqtt5, &serializedLen);
+	if(SUCCESS == rc) {
+		/* send the unsubscribe packet */
+		rc = aws_iot_mqtt_internal_send_packet(pClient, serializedLen, &timer);
+	}
+	(void) aws_iot_mqtt_internal_unlock_write_buffer(pClient);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
@@ -178,20 +193,16 @@ static IoT_Error_t _aws_iot_mqtt_internal_unsubscribe(AWS_IoT_Client *pClient, c
 		FUNC_EXIT_RC(rc);
 	}
 
-	rc = _aws_iot_mqtt_deserialize_unsuback(&packet_id, pClient->clientData.readBuf, pClient->clientData.readBufSize);
+	rc = _aws_iot_mqtt_deserialize_unsuback(&packet_id, isMqtt5, pClient->clientData.readBuf,
+											pClient->clientData.readBufSize);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
 	}
 
-	/* Remove from message handler array */
-	for(i = 0; i < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; ++i) {
-		if(pClient->clientData.messageHandlers[i].topicName != NULL &&
-		   (strcmp(pClient->clientData.messageHandlers[i].topicName, pTopicFilter) == 0)) {
-			pClient->clientData.messageHandlers[i].topicName = NULL;
-			/* We don't want to break here, in case the same topic is registered
-             * with 2 callbacks. Unlikely scenario */
-		}
-	}
+	/* Removes every handler for this filter, in case the same topic is registered
+	 * with 2 callbacks. Unlikely scenario */
+	(void) aws_iot_mqtt_internal_subscription_store_remove(&(pClient->clientData.subscriptions), pTopicFilter,
+														   topicFilterLen);
 
 	FUNC_EXIT_RC(SUCCESS);
 }
@@ -40,14 +40,14 @@ extern "C" {
 #endif
 
 #include "aws_iot_mqtt_client_common_internal.h"
+#include "aws_iot_probes.h"
 
 /**
   * This is for the case when the aws_iot_mqtt_internal_send_packet Fails.
   */
 static void _aws_iot_mqtt_force_client_disconnect(AWS_IoT_Client *pClient) {
-	pClient->clientStatus.clientState = CLIENT_STATE_DISCONNECTED_ERROR;
-	pClient->networkStack.disconnect(&(pClient->networkStack));
-	pClient->networkStack.destroy(&(pClient->networkStack));
+	aws_iot_mqtt_force_client_state(pClient, CLIENT_STATE_DISCONNECTED_ERROR);
+	(void) aws_iot_mqtt_internal_close_network(pClient);
 }
 
 static IoT_Error_t _aws_iot_mqtt_handle_disconnect(AWS_IoT_Client *pClient) {
@@ -61,13 +61,13 @@ static IoT_Error_t _aws_iot_mqtt_handle_disconnect(AWS_IoT_Client *pClient) {
 		_aws_iot_mqtt_force_client_disconnect(pClient);
 	}
 
-	pClient->clientStatus.clientState = CLIENT_STATE_DISCONNECTED_ERROR;
+	aws_iot_mqtt_force_client_state(pClient, CLIENT_STATE_DISCONNECTED_ERROR);
 
 	if(NULL != pClient->clientData.disconnectHandler) {
 		pClient->clientData.disconnectHandler(pClient, pClient->clientData.disconnectHandlerData);
 	}
 
-	if (pClient->clientStatus.clientState == CLIENT_STATE_CONNECTED_IDLE) {
+	if (aws_iot_mqtt_get_client_state(pClient) == CLIENT_STATE_CONNECTED_IDLE) {
 		FUNC_EXIT_RC(SUCCESS);
 	}
 
@@ -91,8 +91,11 @@ static IoT_Error_t _aws_iot_mqtt_handle_reconnect(AWS_IoT_Client *pClient) {
 		rc = pClient->networkStack.isConnected(&(pClient->networkStack));
 	}
 
+	IOT_PROBE2(reconnect_attempt, pClient->clientData.currentReconnectWaitInterval, rc);
+
 	if(NETWORK_PHYSICAL_LAYER_CONNECTED == rc) {
 		rc = aws_iot_mqtt_attempt_reconnect(pClient);
+		IOT_PROBE1(reconnect_done, rc);
 		if(NETWORK_RECONNECTED == rc) {
 			rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_IDLE,
 											   CLIENT_STATE_CONNECTED_YIELD_IN_PROGRESS);
@@ -127,13 +130,14 @@ static IoT_Error_t _aws_iot_mqtt_keep_alive(AWS_IoT_Client *pClient) {
 		FUNC_EXIT_RC(SUCCESS);
 	}
 
-	if(pClient->clientStatus.isPingOutstanding) {
+	if(AWS_IOT_MQTT_ATOMIC_LOAD(&(pClient->clientStatus.isPingOutstanding))) {
 		/* We are waiting for a PINGRESP from the broker. If the pingRespTimer,
 		 * has expired, it indicates that the transport layer connection is
 		 * lost and therefore, we initiate MQTT disconnect (which will triggger)
 		 * the re-connect workflow, if enabled. If the pingRespTimer is not
 		 * expired, there is nothing to do and we continue waiting for PINGRESP. */
 		if(has_timer_expired(&pClient->pingRespTimer)) {
+			IOT_PROBE1(keepalive_timeout, pClient->clientData.keepAliveInterval);
 			rc = _aws_iot_mqtt_handle_disconnect(pClient);
 			FUNC_EXIT_RC(rc);
 		} else {
@@ -154,21 +158,37 @@ static IoT_Error_t _aws_iot_mqtt_keep_alive(AWS_IoT_Client *pClient) {
 
 	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
 	serialized_len = 0;
+
+	rc = aws_iot_mqtt_internal_lock_write_buffer(pClient);
+#ifdef _ENABLE_THREAD_SUPPORT_
+	/* Another thread may be sending right now. That traffic keeps the connection
+	 * alive as well, so the ping can wait for the next cycle. */
+	if(MUTEX_LOCK_ERROR == rc && !pClient->clientData.isBlockOnThreadLockEnabled) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+#endif
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
 	rc = aws_iot_mqtt_internal_serialize_zero(pClient->clientData.writeBuf, pClient->clientData.writeBufSize,
 											  PINGREQ, &serialized_len);
 	if(SUCCESS != rc) {
+		(void) aws_iot_mqtt_internal_unlock_write_buffer(pClient);
 		FUNC_EXIT_RC(rc);
 	}
 
 	/* send the ping packet */
 	rc = aws_iot_mqtt_internal_send_packet(pClient, serialized_len, &timer);
+	(void) aws_iot_mqtt_internal_unlock_write_buffer(pClient);
 	if(SUCCESS != rc) {
 		//If sending a PING fails we can no longer determine if we are connected.  In this case we decide we are disconnected and begin reconnection attempts
 		rc = _aws_iot_mqtt_handle_disconnect(pClient);
 		FUNC_EXIT_RC(rc);
 	}
 
-	pClient->clientStatus.isPingOutstanding = true;
+	AWS_IOT_MQTT_ATOMIC_STORE(&(pClient->clientStatus.isPingOutstanding), true);
+	IOT_PROBE1(keepalive_ping, pClient->clientData.keepAliveInterval);
 	/* Start a timer to wait for PINGRESP from server. */
 	countdown_sec(&pClient->pingRespTimer, pClient->clientData.keepAliveInterval);
 	/* Start a timer to keep track of when to send the next PINGREQ. */
@@ -199,7 +219,7 @@ static IoT_Error_t _aws_iot_mqtt_keep_alive(AWS_IoT_Client *pClient) {
 
 static IoT_Error_t _aws_iot_mqtt_internal_yield(AWS_IoT_Client *pClient, uint32_t timeout_ms) {
 	IoT_Error_t yieldRc = SUCCESS;
-	int itr = 0;
+	uint32_t itr, capacity;
 
 	uint8_t packet_type;
 	ClientState clientState;
@@ -232,6 +252,21 @@ static IoT_Error_t _aws_iot_mqtt_internal_yield(AWS_IoT_Client *pClient, uint32_
 		yieldRc = aws_iot_mqtt_internal_cycle_read(pClient, &timer, &packet_type);
 		if(SUCCESS == yieldRc) {
 			yieldRc = _aws_iot_mqtt_keep_alive(pClient);
+		} else if(LIMIT_EXCEEDED_ERROR == yieldRc) {
+			/* Every RX buffer is retained or no codec buffer was free, the connection is kept alive
+			 * and the error returned so the application can release buffers */
+			yieldRc = _aws_iot_mqtt_keep_alive(pClient);
+			if(SUCCESS == yieldRc) {
+				yieldRc = LIMIT_EXCEEDED_ERROR;
+			}
+		} else if(MQTT_SERVER_DISCONNECTED_ERROR == yieldRc) {
+			/* The connection is closed already, see aws_iot_mqtt_get_server_disconnect_reason */
+			if(NULL != pClient->clientData.disconnectHandler) {
+				pClient->clientData.disconnectHandler(pClient, pClient->clientData.disconnectHandlerData);
+			}
+			if(CLIENT_STATE_CONNECTED_IDLE == aws_iot_mqtt_get_client_state(pClient)) {
+				yieldRc = SUCCESS;
+			}
 		} else {
 			// SSL read and write errors are terminal, connection must be closed and retried
 			if(NETWORK_SSL_READ_ERROR == yieldRc || NETWORK_SSL_WRITE_ERROR == yieldRc || NETWORK_SSL_WRITE_TIMEOUT_ERROR == yieldRc) {
@@ -239,7 +274,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_yield(AWS_IoT_Client *pClient, uint32_
 			}
 		}
 
-		if(NETWORK_DISCONNECTED_ERROR == yieldRc) {
+		if(NETWORK_DISCONNECTED_ERROR == yieldRc || MQTT_SERVER_DISCONNECTED_ERROR == yieldRc) {
 			pClient->clientData.counterNetworkDisconnected++;
 			if(1 == pClient->clientStatus.isAutoReconnectEnabled) {
 				yieldRc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_DISCONNECTED_ERROR,
@@ -251,8 +286,9 @@ static IoT_Error_t _aws_iot_mqtt_internal_yield(AWS_IoT_Client *pClient, uint32_
 				pClient->clientData.currentReconnectWaitInterval = AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL;
 				countdown_ms(&(pClient->reconnectDelayTimer), pClient->clientData.currentReconnectWaitInterval);
 
-				for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; itr++) {
-					pClient->clientData.messageHandlers[itr].resubscribed = 0;
+				capacity = aws_iot_mqtt_internal_subscription_store_capacity(&(pClient->clientData.subscriptions));
+				for(itr = 0; itr < capacity; itr++) {
+					pClient->clientData.subscriptions.pHandlers[itr].resubscribed = 0;
 				}
 
 				/* Depending on timer values, it is possible that yield timer has expired
@@ -308,7 +344,8 @@ IoT_Error_t aws_iot_mqtt_yield(AWS_IoT_Client *pClient, uint32_t timeout_ms) {
 
 	yieldRc = _aws_iot_mqtt_internal_yield(pClient, timeout_ms);
 
-	if(NETWORK_DISCONNECTED_ERROR != yieldRc && NETWORK_ATTEMPTING_RECONNECT != yieldRc) {
+	if(NETWORK_DISCONNECTED_ERROR != yieldRc && NETWORK_ATTEMPTING_RECONNECT != yieldRc &&
+	   MQTT_SERVER_DISCONNECTED_ERROR != yieldRc) {
 		rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_YIELD_IN_PROGRESS,
 										   CLIENT_STATE_CONNECTED_IDLE);
 		if(SUCCESS == yieldRc && SUCCESS != rc) {
@@ -0,0 +1,288 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_mqtt_connection_pool.c
+ * @brief Connection pool that shards topics across several MQTT connections
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "aws_iot_mqtt_connection_pool.h"
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_log.h"
+
+#define AWS_IOT_MQTT_POOL_FNV_OFFSET 0xCBF29CE484222325ULL
+#define AWS_IOT_MQTT_POOL_FNV_PRIME 0x100000001B3ULL
+
+/* 64 bit FNV-1a */
+static uint64_t _aws_iot_mqtt_connection_pool_hash(const char *pTopic, uint16_t topicLen) {
+	uint64_t hash = AWS_IOT_MQTT_POOL_FNV_OFFSET;
+	uint16_t i;
+
+	for(i = 0; i < topicLen; i++) {
+		hash ^= (unsigned char) pTopic[i];
+		hash *= AWS_IOT_MQTT_POOL_FNV_PRIME;
+	}
+
+	return hash;
+}
+
+/* Jump consistent hash (Lamping and Veach), a key only moves when it moves to the new bucket */
+static uint32_t _aws_iot_mqtt_connection_pool_jump(uint64_t key, uint32_t buckets) {
+	int64_t bucket = -1;
+	int64_t next = 0;
+
+	while(next < (int64_t) buckets) {
+		bucket = next;
+		key = key * 2862933555777941757ULL + 1;
+		next = (int64_t) ((double) (bucket + 1) * ((double) (1ULL << 31) / (double) ((key >> 33) + 1)));
+	}
+
+	return (uint32_t) bucket;
+}
+
+IoT_Error_t aws_iot_mqtt_connection_pool_init(IoT_MQTT_Connection_Pool_t *pPool, AWS_IoT_Client *pClients,
+											  uint32_t clientCount, IoT_Client_Init_Params *pInitParams) {
+	IoT_Error_t rc;
+	uint32_t i;
+	size_t bufferMark, subscriptionMark;
+
+	FUNC_ENTRY;
+
+	if(NULL == pPool || NULL == pClients || NULL == pInitParams || 0 == clientCount ||
+	   AWS_IOT_MQTT_POOL_MAX_CONNECTIONS < clientCount) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	/* Every client gets the same parameters, a given buffer would be shared by all of them */
+	if(NULL != pInitParams->pWriteBuf || NULL != pInitParams->pReadBuf) {
+		IOT_ERROR("Connection pool clients need their own buffers, use pBufferArena");
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	/* The clients that did initialize give their arena blocks back when a later one fails */
+	bufferMark = aws_iot_arena_mark(pInitParams->pBufferArena);
+	subscriptionMark = aws_iot_arena_mark(pInitParams->pSubscriptionArena);
+
+	for(i = 0; i < clientCount; i++) {
+		rc = aws_iot_mqtt_init(&pClients[i], pInitParams);
+		if(SUCCESS != rc) {
+			IOT_ERROR("Connection pool client %u failed to initialize", (unsigned) i);
+			while(0 < i) {
+				(void) aws_iot_mqtt_free(&pClients[--i]);
+			}
+			aws_iot_arena_rewind(pInitParams->pSubscriptionArena, subscriptionMark);
+			aws_iot_arena_rewind(pInitParams->pBufferArena, bufferMark);
+			FUNC_EXIT_RC(rc);
+		}
+	}
+
+	memset(pPool->clientIds, 0, sizeof(pPool->clientIds));
+	pPool->pClients = pClients;
+	pPool->clientCount = clientCount;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_mqtt_connection_pool_connect(IoT_MQTT_Connection_Pool_t *pPool,
+												 IoT_Client_Connect_Params *pConnectParams) {
+	IoT_Client_Connect_Params params;
+	IoT_Error_t rc, firstError = SUCCESS;
+	int idLen;
+	uint32_t i;
+
+	FUNC_ENTRY;
+
+	if(NULL == pPool || NULL == pConnectParams || NULL == pConnectParams->pClientID ||
+	   0 == pConnectParams->clientIDLen) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	for(i = 0; i < pPool->clientCount; i++) {
+		if(aws_iot_mqtt_is_client_connected(&pPool->pClients[i])) {
+			continue;
+		}
+
+		idLen = snprintf(pPool->clientIds[i], AWS_IOT_MQTT_POOL_CLIENT_ID_LEN, "%.*s-%u",
+						 (int) pConnectParams->clientIDLen, pConnectParams->pClientID, (unsigned) i);
+		if(0 > idLen || AWS_IOT_MQTT_POOL_CLIENT_ID_LEN <= idLen) {
+			FUNC_EXIT_RC(MAX_SIZE_ERROR);
+		}
+
+		params = *pConnectParams;
+		params.pClientID = pPool->clientIds[i];
+		params.clientIDLen = (uint16_t) idLen;
+		rc = aws_iot_mqtt_connect(&pPool->pClients[i], &params);
+		if(SUCCESS != rc) {
+			IOT_WARN("Connection pool client %s failed to connect: %d", pPool->clientIds[i], rc);
+			if(SUCCESS == firstError) {
+				firstError = rc;
+			}
+		}
+	}
+
+	FUNC_EXIT_RC(firstError);
+}
+
+uint32_t aws_iot_mqtt_connection_pool_route(const IoT_MQTT_Connection_Pool_t *pPool, const char *pTopic,
+											uint16_t topicLen) {
+	if(1 >= pPool->clientCount) {
+		return 0;
+	}
+
+	return _aws_iot_mqtt_connection_pool_jump(_aws_iot_mqtt_connection_pool_hash(pTopic, topicLen),
+											  pPool->clientCount);
+}
+
+AWS_IoT_Client *aws_iot_mqtt_connection_pool_get_client(IoT_MQTT_Connection_Pool_t *pPool, uint32_t index) {
+	if(NULL == pPool || index >= pPool->clientCount) {
+		return NULL;
+	}
+
+	return &pPool->pClients[index];
+}
+
+IoT_Error_t aws_iot_mqtt_connection_pool_publish(IoT_MQTT_Connection_Pool_t *pPool, const char *pTopicName,
+												 uint16_t topicNameLen, IoT_Publish_Message_Params *pParams) {
+	AWS_IoT_Client *pClient;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pPool || NULL == pTopicName) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	pClient = &pPool->pClients[aws_iot_mqtt_connection_pool_route(pPool, pTopicName, topicNameLen)];
+	rc = aws_iot_mqtt_publish(pClient, pTopicName, topicNameLen, pParams);
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_mqtt_connection_pool_subscribe(IoT_MQTT_Connection_Pool_t *pPool, const char *pTopicName,
+												   uint16_t topicNameLen, QoS qos,
+												   pApplicationHandler_t pApplicationHandler,
+												   void *pApplicationHandlerData) {
+	AWS_IoT_Client *pClient;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pPool || NULL == pTopicName) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	pClient = &pPool->pClients[aws_iot_mqtt_connection_pool_route(pPool, pTopicName, topicNameLen)];
+	rc = aws_iot_mqtt_subscribe(pClient, pTopicName, topicNameLen, qos, pApplicationHandler,
+								pApplicationHandlerData);
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_mqtt_connection_pool_unsubscribe(IoT_MQTT_Connection_Pool_t *pPool, const char *pTopicFilter,
+													 uint16_t topicFilterLen) {
+	AWS_IoT_Client *pClient;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pPool || NULL == pTopicFilter) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	pClient = &pPool->pClients[aws_iot_mqtt_connection_pool_route(pPool, pTopicFilter, topicFilterLen)];
+	rc = aws_iot_mqtt_unsubscribe(pClient, pTopicFilter, topicFilterLen);
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_mqtt_connection_pool_yield(IoT_MQTT_Connection_Pool_t *pPool, uint32_t timeout_ms) {
+	IoT_Error_t rc, firstResult = SUCCESS;
+	uint32_t share, i;
+
+	FUNC_ENTRY;
+
+	if(NULL == pPool) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	share = timeout_ms / pPool->clientCount;
+	if(0 == share) {
+		share = 1;
+	}
+
+	for(i = 0; i < pPool->clientCount; i++) {
+		rc = aws_iot_mqtt_yield(&pPool->pClients[i], share);
+		if(SUCCESS != rc && SUCCESS == firstResult) {
+			firstResult = rc;
+		}
+	}
+
+	FUNC_EXIT_RC(firstResult);
+}
+
+IoT_Error_t aws_iot_mqtt_connection_pool_disconnect(IoT_MQTT_Connection_Pool_t *pPool) {
+	IoT_Error_t rc, firstError = SUCCESS;
+	uint32_t i;
+
+	FUNC_ENTRY;
+
+	if(NULL == pPool) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	for(i = 0; i < pPool->clientCount; i++) {
+		if(!aws_iot_mqtt_is_client_connected(&pPool->pClients[i])) {
+			continue;
+		}
+		rc = aws_iot_mqtt_disconnect(&pPool->pClients[i]);
+		if(SUCCESS != rc && SUCCESS == firstError) {
+			firstError = rc;
+		}
+	}
+
+	FUNC_EXIT_RC(firstError);
+}
+
+IoT_Error_t aws_iot_mqtt_connection_pool_free(IoT_MQTT_Connection_Pool_t *pPool) {
+	IoT_Error_t rc, firstError = SUCCESS;
+	uint32_t i;
+
+	FUNC_ENTRY;
+
+	if(NULL == pPool) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	for(i = 0; i < pPool->clientCount; i++) {
+		rc = aws_iot_mqtt_free(&pPool->pClients[i]);
+		if(SUCCESS != rc && SUCCESS == firstError) {
+			firstError = rc;
+		}
+	}
+	pPool->clientCount = 0;
+
+	FUNC_EXIT_RC(firstError);
+}
+
+#ifdef __cplusplus
+}
+#endif
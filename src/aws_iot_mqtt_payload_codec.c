@@ -0,0 +1,201 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_mqtt_payload_codec.c
+ * @brief Per-topic payload codecs and the built-in LZ codec
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+
+#include "aws_iot_mqtt_payload_codec.h"
+#include "aws_iot_mqtt_client_common_internal.h"
+#include "aws_iot_log.h"
+
+#define AWS_IOT_LZ_CODEC_STORED 0x00
+#define AWS_IOT_LZ_CODEC_COMPRESSED 0x01
+
+IoT_Error_t aws_iot_mqtt_set_payload_codec_pool(AWS_IoT_Client *pClient, IoT_Pool_t *pPool) {
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pPool) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	pClient->clientData.pPayloadCodecPool = pPool;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+uint32_t aws_iot_mqtt_get_undecodable_payload_count(const AWS_IoT_Client *pClient) {
+	if(NULL == pClient) {
+		return 0;
+	}
+
+	return pClient->clientData.undecodablePayloadCount;
+}
+
+IoT_Error_t aws_iot_mqtt_set_payload_codec(AWS_IoT_Client *pClient, const char *pTopicFilter,
+										   const IoT_Payload_Codec_t *pCodec) {
+	PayloadCodecFilter *pFree = NULL;
+	PayloadCodecFilter *pEntry;
+	uint32_t i;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pTopicFilter || '\0' == pTopicFilter[0] ||
+	   (NULL != pCodec && (NULL == pCodec->encode || NULL == pCodec->decode))) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(NULL != pCodec && NULL == pClient->clientData.pPayloadCodecPool) {
+		IOT_ERROR("Set a payload codec pool before setting a codec");
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	for(i = 0; i < AWS_IOT_MQTT_NUM_PAYLOAD_CODECS; i++) {
+		pEntry = &(pClient->clientData.payloadCodecs[i]);
+		if(NULL == pEntry->pTopicFilter) {
+			if(NULL == pFree) {
+				pFree = pEntry;
+			}
+		} else if(0 == strcmp(pEntry->pTopicFilter, pTopicFilter)) {
+			if(NULL == pCodec) {
+				pEntry->pTopicFilter = NULL;
+			}
+			pEntry->pCodec = pCodec;
+			FUNC_EXIT_RC(SUCCESS);
+		}
+	}
+
+	if(NULL == pCodec) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+	if(NULL == pFree) {
+		FUNC_EXIT_RC(LIMIT_EXCEEDED_ERROR);
+	}
+
+	pFree->pCodec = pCodec;
+	pFree->pTopicFilter = pTopicFilter;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+const IoT_Payload_Codec_t *aws_iot_mqtt_internal_find_payload_codec(AWS_IoT_Client *pClient, const char *pTopicName,
+																   uint16_t topicNameLen) {
+	const PayloadCodecFilter *pEntry;
+	uint32_t i;
+
+	if(NULL == pClient->clientData.pPayloadCodecPool) {
+		return NULL;
+	}
+
+	for(i = 0; i < AWS_IOT_MQTT_NUM_PAYLOAD_CODECS; i++) {
+		pEntry = &(pClient->clientData.payloadCodecs[i]);
+		if(NULL != pEntry->pTopicFilter &&
+		   aws_iot_mqtt_internal_is_topic_matched((char *) pEntry->pTopicFilter, (char *) pTopicName, topicNameLen)) {
+			return pEntry->pCodec;
+		}
+	}
+
+	return NULL;
+}
+
+static IoT_Error_t _aws_iot_mqtt_lz_codec_encode(void *pContext, const unsigned char *pIn, size_t inLen,
+												 unsigned char *pOut, size_t outLen, size_t *pWrittenLen) {
+	IoT_LZ_Codec_Context_t *pLz = (IoT_LZ_Codec_Context_t *) pContext;
+	IoT_Error_t rc;
+
+	if(1 > outLen) {
+		return MAX_SIZE_ERROR;
+	}
+
+	/* Compressing into one byte less than the input gives up as soon as it stops paying off */
+	if(1 < inLen) {
+		pOut[0] = AWS_IOT_LZ_CODEC_COMPRESSED;
+		rc = aws_iot_lz_compress(&(pLz->lz), pLz->pDictionary, pLz->dictionaryLen, pIn, inLen, &pOut[1],
+								 ((inLen < outLen) ? inLen : outLen) - 1, pWrittenLen);
+		if(SUCCESS == rc) {
+			(*pWrittenLen)++;
+			return SUCCESS;
+		}
+		if(MAX_SIZE_ERROR != rc) {
+			return rc;
+		}
+	}
+
+	if(inLen + 1 > outLen) {
+		return MAX_SIZE_ERROR;
+	}
+	pOut[0] = AWS_IOT_LZ_CODEC_STORED;
+	if(0 != inLen) {
+		memcpy(&pOut[1], pIn, inLen);
+	}
+	*pWrittenLen = inLen + 1;
+
+	return SUCCESS;
+}
+
+static IoT_Error_t _aws_iot_mqtt_lz_codec_decode(void *pContext, const unsigned char *pIn, size_t inLen,
+												 unsigned char *pOut, size_t outLen, size_t *pWrittenLen) {
+	IoT_LZ_Codec_Context_t *pLz = (IoT_LZ_Codec_Context_t *) pContext;
+
+	if(1 > inLen) {
+		return FAILURE;
+	}
+
+	if(AWS_IOT_LZ_CODEC_COMPRESSED == pIn[0]) {
+		return aws_iot_lz_decompress(pLz->pDictionary, pLz->dictionaryLen, &pIn[1], inLen - 1, pOut, outLen,
+									 pWrittenLen);
+	}
+
+	if(AWS_IOT_LZ_CODEC_STORED != pIn[0]) {
+		return FAILURE;
+	}
+	if(inLen - 1 > outLen) {
+		return MAX_SIZE_ERROR;
+	}
+	if(1 < inLen) {
+		memcpy(pOut, &pIn[1], inLen - 1);
+	}
+	*pWrittenLen = inLen - 1;
+
+	return SUCCESS;
+}
+
+IoT_Error_t aws_iot_mqtt_lz_codec_init(IoT_Payload_Codec_t *pCodec, IoT_LZ_Codec_Context_t *pContext,
+									   const unsigned char *pDictionary, size_t dictionaryLen) {
+	FUNC_ENTRY;
+
+	if(NULL == pCodec || NULL == pContext || (NULL == pDictionary && 0 != dictionaryLen)) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	pContext->pDictionary = pDictionary;
+	pContext->dictionaryLen = dictionaryLen;
+	pCodec->encode = _aws_iot_mqtt_lz_codec_encode;
+	pCodec->decode = _aws_iot_mqtt_lz_codec_decode;
+	pCodec->pContext = pContext;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_mqtt_rx_lease.c
+ * @brief Read buffers taken from a pool that subscription callbacks can retain
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aws_iot_mqtt_rx_lease.h"
+#include "aws_iot_mqtt_client_common_internal.h"
+#include "aws_iot_log.h"
+
+IoT_Error_t aws_iot_mqtt_set_rx_buffer_pool(AWS_IoT_Client *pClient, IoT_Pool_t *pPool) {
+	ClientData *pData;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(aws_iot_mqtt_is_client_connected(pClient)) {
+		IOT_ERROR("Set the RX buffer pool before connecting");
+		FUNC_EXIT_RC(NETWORK_ALREADY_CONNECTED_ERROR);
+	}
+
+	pData = &(pClient->clientData);
+	if(NULL == pData->pRxBufferPool) {
+		pData->pInitReadBuf = pData->readBuf;
+		pData->initReadBufSize = pData->readBufSize;
+	} else if(NULL != pData->readBuf) {
+		(void) aws_iot_pool_free(pData->pRxBufferPool, pData->readBuf);
+	}
+
+	if(NULL == pPool) {
+		pData->readBuf = pData->pInitReadBuf;
+		pData->readBufSize = pData->initReadBufSize;
+	} else {
+		/* NULL while every block is retained, the next read takes a block */
+		pData->readBuf = (unsigned char *) aws_iot_pool_alloc(pPool);
+		pData->readBufSize = pPool->blockSize;
+	}
+	pData->pRxBufferPool = pPool;
+	pData->isRxBufferRetainable = false;
+	(void) aws_iot_mqtt_internal_flushBuffers(pClient);
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_mqtt_retain_rx_buffer(AWS_IoT_Client *pClient, IoT_Mqtt_Rx_Lease_t *pLease) {
+	IoT_Error_t rc = SUCCESS;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pLease) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(!pClient->clientData.isRxBufferRetainable) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	rc = aws_iot_mqtt_client_lock_mutex(pClient, &(pClient->clientData.tls_read_mutex));
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+#endif
+
+	pLease->pBlock = pClient->clientData.readBuf;
+	pClient->clientData.isRxBufferRetainable = false;
+	pClient->clientData.readBuf = (unsigned char *) aws_iot_pool_alloc(pClient->clientData.pRxBufferPool);
+	if(NULL == pClient->clientData.readBuf) {
+		IOT_DEBUG("Every RX buffer is retained, reading stops until one is released");
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	rc = aws_iot_mqtt_client_unlock_mutex(pClient, &(pClient->clientData.tls_read_mutex));
+#endif
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_mqtt_release_rx_buffer(AWS_IoT_Client *pClient, IoT_Mqtt_Rx_Lease_t *pLease) {
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pLease || NULL == pLease->pBlock || NULL == pClient->clientData.pRxBufferPool) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = aws_iot_pool_free(pClient->clientData.pRxBufferPool, pLease->pBlock);
+	pLease->pBlock = NULL;
+
+	FUNC_EXIT_RC(rc);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_pool.c
+ * @brief Fixed-block pool allocator
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include "aws_iot_pool.h"
+#include "aws_iot_log.h"
+
+/** Link value marking the end of the free stack */
+#define AWS_IOT_POOL_END 0xFFFFFFFFu
+/** Link value marking a block that is in use */
+#define AWS_IOT_POOL_IN_USE 0xFFFFFFFEu
+
+#define AWS_IOT_POOL_HEAD_INDEX(head) ((uint32_t) ((head) & 0xFFFFFFFFu))
+#define AWS_IOT_POOL_HEAD_TAG(head) ((uint32_t) ((head) >> 32))
+#define AWS_IOT_POOL_HEAD(tag, index) ((((uint64_t) (tag)) << 32) | (uint64_t) (index))
+
+/* Same scheme as the client state atomics in aws_iot_mqtt_client_common_internal.h. The 64-bit
+ * compare-and-swap on the stack head may need libatomic on 32-bit targets without a double-word CAS. */
+#if defined(_ENABLE_THREAD_SUPPORT_) && (defined(__GNUC__) || defined(__clang__))
+#define AWS_IOT_POOL_ATOMIC_LOAD(pField) __atomic_load_n((pField), __ATOMIC_ACQUIRE)
+#define AWS_IOT_POOL_ATOMIC_STORE(pField, value) __atomic_store_n((pField), (value), __ATOMIC_RELEASE)
+#define AWS_IOT_POOL_ATOMIC_CAS(pField, pExpected, desired) \
+	__atomic_compare_exchange_n((pField), (pExpected), (desired), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#else
+#define AWS_IOT_POOL_ATOMIC_LOAD(pField) (*(pField))
+#define AWS_IOT_POOL_ATOMIC_STORE(pField, value) (*(pField) = (value))
+#define AWS_IOT_POOL_ATOMIC_CAS(pField, pExpected, desired) \
+	((*(pField) == *(pExpected)) ? (*(pField) = (desired), true) : (*(pExpected) = *(pField), false))
+#endif
+
+IoT_Error_t aws_iot_pool_init(IoT_Pool_t *pPool, void *pBlocks, size_t blockSize, uint32_t blockCount,
+							  uint32_t *pLinks) {
+	FUNC_ENTRY;
+
+	if(NULL == pPool || NULL == pBlocks || NULL == pLinks || 0 == blockSize || 0 == blockCount ||
+	   AWS_IOT_POOL_IN_USE <= blockCount) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	pPool->pBlocks = (unsigned char *) pBlocks;
+	pPool->pNext = pLinks;
+	pPool->blockSize = blockSize;
+	pPool->blockCount = blockCount;
+	aws_iot_pool_reset(pPool);
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_pool_init_from_arena(IoT_Pool_t *pPool, IoT_Arena_t *pArena, size_t blockSize,
+										 uint32_t blockCount) {
+	void *pBlocks;
+	uint32_t *pLinks;
+
+	FUNC_ENTRY;
+
+	if(NULL == pPool || NULL == pArena || 0 == blockSize || 0 == blockCount) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	/* Keep every block aligned, not just the first one */
+	blockSize = (blockSize + AWS_IOT_ARENA_ALIGNMENT - 1) & ~((size_t) AWS_IOT_ARENA_ALIGNMENT - 1);
+	if(blockCount > ((size_t) -1) / blockSize) {
+		FUNC_EXIT_RC(ARENA_EXHAUSTED_ERROR);
+	}
+
+	pBlocks = aws_iot_arena_alloc(pArena, blockSize * blockCount);
+	pLinks = (uint32_t *) aws_iot_arena_alloc(pArena, sizeof(uint32_t) * blockCount);
+	if(NULL == pBlocks || NULL == pLinks) {
+		FUNC_EXIT_RC(ARENA_EXHAUSTED_ERROR);
+	}
+
+	FUNC_EXIT_RC(aws_iot_pool_init(pPool, pBlocks, blockSize, blockCount, pLinks));
+}
+
+void *aws_iot_pool_alloc(IoT_Pool_t *pPool) {
+	uint64_t head;
+	uint32_t index;
+	uint32_t next;
+
+	if(NULL == pPool || NULL == pPool->pBlocks) {
+		return NULL;
+	}
+
+	head = AWS_IOT_POOL_ATOMIC_LOAD(&(pPool->freeHead));
+	do {
+		index = AWS_IOT_POOL_HEAD_INDEX(head);
+		if(AWS_IOT_POOL_END == index) {
+			return NULL;
+		}
+		/* May be stale if another thread takes the block first, the tag makes the swap fail then */
+		next = AWS_IOT_POOL_ATOMIC_LOAD(&(pPool->pNext[index]));
+	} while(!AWS_IOT_POOL_ATOMIC_CAS(&(pPool->freeHead), &head,
+									 AWS_IOT_POOL_HEAD(AWS_IOT_POOL_HEAD_TAG(head) + 1, next)));
+
+	AWS_IOT_POOL_ATOMIC_STORE(&(pPool->pNext[index]), AWS_IOT_POOL_IN_USE);
+
+	return pPool->pBlocks + (size_t) index * pPool->blockSize;
+}
+
+IoT_Error_t aws_iot_pool_free(IoT_Pool_t *pPool, void *pBlock) {
+	uint64_t head;
+	uint32_t index;
+
+	if(NULL == pPool || NULL == pBlock || NULL == pPool->pBlocks) {
+		return NULL_VALUE_ERROR;
+	}
+
+	index = aws_iot_pool_index_of(pPool, pBlock);
+	if(index >= pPool->blockCount) {
+		IOT_ERROR("Block %p does not belong to the pool", pBlock);
+		return FAILURE;
+	}
+
+	/* Catches a block released twice in a row, not two threads racing to release the same block */
+	if(AWS_IOT_POOL_IN_USE != AWS_IOT_POOL_ATOMIC_LOAD(&(pPool->pNext[index]))) {
+		IOT_ERROR("Block %p released twice", pBlock);
+		return FAILURE;
+	}
+
+	head = AWS_IOT_POOL_ATOMIC_LOAD(&(pPool->freeHead));
+	do {
+		AWS_IOT_POOL_ATOMIC_STORE(&(pPool->pNext[index]), AWS_IOT_POOL_HEAD_INDEX(head));
+	} while(!AWS_IOT_POOL_ATOMIC_CAS(&(pPool->freeHead), &head,
+									 AWS_IOT_POOL_HEAD(AWS_IOT_POOL_HEAD_TAG(head) + 1, index)));
+
+	return SUCCESS;
+}
+
+void aws_iot_pool_reset(IoT_Pool_t *pPool) {
+	uint32_t i;
+
+	if(NULL == pPool || NULL == pPool->pBlocks) {
+		return;
+	}
+
+	for(i = 0; i + 1 < pPool->blockCount; i++) {
+		pPool->pNext[i] = i + 1;
+	}
+	pPool->pNext[pPool->blockCount - 1] = AWS_IOT_POOL_END;
+
+	AWS_IOT_POOL_ATOMIC_STORE(&(pPool->freeHead), AWS_IOT_POOL_HEAD(0, 0));
+}
+
+uint32_t aws_iot_pool_capacity(const IoT_Pool_t *pPool) {
+	if(NULL == pPool) {
+		return 0;
+	}
+
+	return pPool->blockCount;
+}
+
+uint32_t aws_iot_pool_available(IoT_Pool_t *pPool) {
+	uint32_t count = 0;
+	uint32_t index;
+
+	if(NULL == pPool || NULL == pPool->pBlocks) {
+		return 0;
+	}
+
+	/* Not kept as a counter so that alloc and free stay at a single atomic operation each */
+	index = AWS_IOT_POOL_HEAD_INDEX(AWS_IOT_POOL_ATOMIC_LOAD(&(pPool->freeHead)));
+	while(index < pPool->blockCount && count < pPool->blockCount) {
+		count++;
+		index = AWS_IOT_POOL_ATOMIC_LOAD(&(pPool->pNext[index]));
+	}
+
+	return count;
+}
+
+void *aws_iot_pool_block_at(const IoT_Pool_t *pPool, uint32_t index) {
+	if(NULL == pPool || NULL == pPool->pBlocks || index >= pPool->blockCount) {
+		return NULL;
+	}
+
+	return pPool->pBlocks + (size_t) index * pPool->blockSize;
+}
+
+uint32_t aws_iot_pool_index_of(const IoT_Pool_t *pPool, const void *pBlock) {
+	const unsigned char *pByte = (const unsigned char *) pBlock;
+	size_t offset;
+
+	if(NULL == pPool || NULL == pPool->pBlocks || pByte < pPool->pBlocks) {
+		return aws_iot_pool_capacity(pPool);
+	}
+
+	offset = (size_t) (pByte - pPool->pBlocks);
+	if(0 != offset % pPool->blockSize || offset / pPool->blockSize >= pPool->blockCount) {
+		return pPool->blockCount;
+	}
+
+	return (uint32_t) (offset / pPool->blockSize);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -33,7 +33,7 @@ extern "C" {
 #include "aws_iot_shadow_records.h"
 
 const ShadowInitParameters_t ShadowInitParametersDefault = {(char *) AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, NULL, NULL,
-															NULL, false, NULL};
+															NULL, false, NULL, NULL, 0, false};
 
 const ShadowConnectParameters_t ShadowConnectParametersDefault = {(char *) AWS_IOT_MY_THING_NAME,
 								  (char *) AWS_IOT_MQTT_CLIENT_ID, 0, NULL};
@@ -56,6 +56,14 @@ void aws_iot_shadow_disable_discard_old_delta_msgs(void) {
 	shadowDiscardOldDeltaFlag = false;
 }
 
+void aws_iot_shadow_enable_metadata_pruning(void) {
+	shadowPruneMetadataFlag = true;
+}
+
+void aws_iot_shadow_disable_metadata_pruning(void) {
+	shadowPruneMetadataFlag = false;
+}
+
 IoT_Error_t aws_iot_shadow_free(AWS_IoT_Client *pClient)
 {
     IoT_Error_t rc;
@@ -91,6 +99,11 @@ IoT_Error_t aws_iot_shadow_init(AWS_IoT_Client *pClient, ShadowInitParameters_t
 	mqttInitParams.isSSLHostnameVerify = true;
 	mqttInitParams.disconnectHandler = pParams->disconnectHandler;
 
+	rc = initializeAckWaitList(pParams->pRecordArena, pParams->maxPendingAcks, pParams->isRecordArenaReused);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
 	rc = aws_iot_mqtt_init(pClient, &mqttInitParams);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
@@ -35,7 +35,7 @@ IoT_Error_t aws_iot_shadow_internal_action(const char *pThingName, ShadowActions
 	IoT_Error_t ret_val = SUCCESS;
 	bool isClientTokenPresent = false;
 	bool isAckWaitListFree = false;
-	uint8_t indexAckWaitList;
+	uint32_t indexAckWaitList;
 	char extractedClientToken[MAX_SIZE_CLIENT_ID_WITH_SEQUENCE];
 
 	FUNC_ENTRY;
@@ -47,7 +47,7 @@ IoT_Error_t aws_iot_shadow_internal_action(const char *pThingName, ShadowActions
 	isClientTokenPresent = extractClientToken(pJsonDocumentToBeSent, jsonSize, extractedClientToken, MAX_SIZE_CLIENT_ID_WITH_SEQUENCE );
 
 	if(isClientTokenPresent && (NULL != callback)) {
-		if(getNextFreeIndexOfAckWaitList(&indexAckWaitList)) {
+		if(reserveAckWaitListIndex(&indexAckWaitList)) {
 			isAckWaitListFree = true;
 		}
 
@@ -67,9 +67,13 @@ IoT_Error_t aws_iot_shadow_internal_action(const char *pThingName, ShadowActions
 		ret_val = publishToShadowAction(pThingName, action, pJsonDocumentToBeSent);
 	}
 
-	if(isClientTokenPresent && (NULL != callback) && (SUCCESS == ret_val) && isAckWaitListFree) {
-		addToAckWaitList(indexAckWaitList, pThingName, action, extractedClientToken, callback, pCallbackContext,
-						 timeout_seconds);
+	if(isClientTokenPresent && (NULL != callback) && isAckWaitListFree) {
+		if(SUCCESS == ret_val) {
+			addToAckWaitList(indexAckWaitList, pThingName, action, extractedClientToken, callback, pCallbackContext,
+							 timeout_seconds);
+		} else {
+			releaseAckWaitListIndex(indexAckWaitList);
+		}
 	}
 
 	FUNC_EXIT_RC(ret_val);
@@ -0,0 +1,440 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_shadow_bulk.c
+ * @brief Pipelined shadow requests for many things
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "aws_iot_shadow_bulk.h"
+#include "aws_iot_log.h"
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_shadow_json.h"
+
+#define SHADOW_BULK_ACTION_COUNT 3
+#define SHADOW_BULK_TOPIC_PREFIX "$aws/things/"
+#define SHADOW_BULK_TOPIC_PREFIX_LEN (sizeof(SHADOW_BULK_TOPIC_PREFIX) - 1)
+#define SHADOW_BULK_TOPIC_SHADOW "/shadow/"
+#define SHADOW_BULK_TOPIC_SHADOW_LEN (sizeof(SHADOW_BULK_TOPIC_SHADOW) - 1)
+
+/* Indexed by ShadowActions_t */
+static const char *const shadowBulkActionNames[SHADOW_BULK_ACTION_COUNT] = {"get", "update", "delete"};
+
+static const char *const shadowBulkAcceptedFilters[SHADOW_BULK_ACTION_COUNT] = {
+	"$aws/things/+/shadow/get/accepted",
+	"$aws/things/+/shadow/update/accepted",
+	"$aws/things/+/shadow/delete/accepted"
+};
+
+static const char *const shadowBulkRejectedFilters[SHADOW_BULK_ACTION_COUNT] = {
+	"$aws/things/+/shadow/get/rejected",
+	"$aws/things/+/shadow/update/rejected",
+	"$aws/things/+/shadow/delete/rejected"
+};
+
+IoT_Error_t aws_iot_shadow_bulk_init(IoT_Shadow_Bulk_t *pBulk, AWS_IoT_Client *pClient,
+									 const IoT_Shadow_Bulk_Params *pParams) {
+	const IoT_Shadow_Bulk_Request_t *pRequest;
+	uint8_t actionMask = 0;
+	uint32_t i;
+
+	FUNC_ENTRY;
+
+	if(NULL == pBulk || NULL == pClient || NULL == pParams || NULL == pParams->callback ||
+	   (NULL == pParams->pRequests && 0 != pParams->requestCount)) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(0 == pParams->windowSize || AWS_IOT_SHADOW_BULK_MAX_WINDOW < pParams->windowSize) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+
+	for(i = 0; i < pParams->requestCount; i++) {
+		pRequest = &pParams->pRequests[i];
+		if(NULL == pRequest->pThingName || SHADOW_BULK_ACTION_COUNT <= (uint32_t) pRequest->action ||
+		   (SHADOW_UPDATE == pRequest->action && NULL == pRequest->pJsonDocument)) {
+			FUNC_EXIT_RC(NULL_VALUE_ERROR);
+		}
+		if(MAX_SIZE_OF_THING_NAME <= strlen(pRequest->pThingName)) {
+			FUNC_EXIT_RC(MAX_SIZE_ERROR);
+		}
+		actionMask = (uint8_t) (actionMask | (1u << pRequest->action));
+	}
+
+	memset(pBulk, 0, sizeof(IoT_Shadow_Bulk_t));
+	pBulk->pClient = pClient;
+	pBulk->params = *pParams;
+	pBulk->actionMask = actionMask;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+static uint32_t _aws_iot_shadow_bulk_release(IoT_Shadow_Bulk_t *pBulk, ShadowBulkSlot_t *pSlot) {
+	pSlot->isInFlight = false;
+	pBulk->inFlightCount--;
+
+	return pSlot->requestIndex;
+}
+
+static void _aws_iot_shadow_bulk_complete(IoT_Shadow_Bulk_t *pBulk, uint32_t requestIndex, Shadow_Ack_Status_t status,
+										  const char *pJsonDocument, size_t jsonLen) {
+	pBulk->completedCount++;
+
+	if(SHADOW_ACK_ACCEPTED == status) {
+		pBulk->stats.accepted++;
+	} else if(SHADOW_ACK_REJECTED == status) {
+		pBulk->stats.rejected++;
+	} else {
+		pBulk->stats.timedOut++;
+	}
+
+	pBulk->params.callback(requestIndex, &pBulk->params.pRequests[requestIndex], status, pJsonDocument, jsonLen);
+}
+
+static bool _aws_iot_shadow_bulk_is_pending(const IoT_Shadow_Bulk_t *pBulk, const IoT_Shadow_Bulk_Request_t *pRequest) {
+	const IoT_Shadow_Bulk_Request_t *pOther;
+	uint32_t i;
+
+	for(i = 0; i < pBulk->params.windowSize; i++) {
+		if(pBulk->slots[i].isInFlight) {
+			pOther = &pBulk->params.pRequests[pBulk->slots[i].requestIndex];
+			if(pOther->action == pRequest->action && 0 == strcmp(pOther->pThingName, pRequest->pThingName)) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+static IoT_Error_t _aws_iot_shadow_bulk_send(IoT_Shadow_Bulk_t *pBulk, ShadowBulkSlot_t *pSlot,
+											 const IoT_Shadow_Bulk_Request_t *pRequest) {
+	char topic[MAX_SHADOW_TOPIC_LENGTH_BYTES];
+	char emptyDocument[MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE];
+	const char *pDocument = pRequest->pJsonDocument;
+	IoT_Publish_Message_Params params;
+	size_t documentLen;
+	IoT_Error_t rc;
+
+	if(SHADOW_UPDATE != pRequest->action) {
+		rc = aws_iot_shadow_internal_get_request_json(emptyDocument, sizeof(emptyDocument));
+		if(SUCCESS != rc) {
+			return rc;
+		}
+		pDocument = emptyDocument;
+	}
+
+	documentLen = strlen(pDocument);
+	if(!extractClientToken(pDocument, documentLen, pSlot->clientToken, sizeof(pSlot->clientToken))) {
+		pSlot->clientToken[0] = '\0';
+	}
+
+	snprintf(topic, sizeof(topic), SHADOW_BULK_TOPIC_PREFIX "%s" SHADOW_BULK_TOPIC_SHADOW "%s",
+			 pRequest->pThingName, shadowBulkActionNames[pRequest->action]);
+
+	params.qos = QOS0;
+	params.isRetained = 0;
+	params.payload = (void *) pDocument;
+	params.payloadLen = documentLen;
+
+	return aws_iot_mqtt_publish(pBulk->pClient, topic, (uint16_t) strlen(topic), &params);
+}
+
+static IoT_Error_t _aws_iot_shadow_bulk_fill(IoT_Shadow_Bulk_t *pBulk) {
+	const IoT_Shadow_Bulk_Request_t *pRequest;
+	ShadowBulkSlot_t *pSlot = NULL;
+	uint32_t i;
+	IoT_Error_t rc;
+
+	while(pBulk->inFlightCount < pBulk->params.windowSize && pBulk->nextRequest < pBulk->params.requestCount) {
+		pRequest = &pBulk->params.pRequests[pBulk->nextRequest];
+
+		/* Waits for the earlier request on the same thing and action, the requests after it wait too */
+		if(_aws_iot_shadow_bulk_is_pending(pBulk, pRequest)) {
+			break;
+		}
+
+		for(i = 0; i < pBulk->params.windowSize; i++) {
+			if(!pBulk->slots[i].isInFlight) {
+				pSlot = &pBulk->slots[i];
+				break;
+			}
+		}
+
+		rc = _aws_iot_shadow_bulk_send(pBulk, pSlot, pRequest);
+		if(SUCCESS != rc) {
+			pBulk->stats.publishFailures++;
+			return rc;
+		}
+
+		pSlot->isInFlight = true;
+		pSlot->requestIndex = pBulk->nextRequest;
+		init_timer(&pSlot->timer);
+		countdown_ms(&pSlot->timer, pBulk->params.timeout_ms);
+		pBulk->nextRequest++;
+		pBulk->inFlightCount++;
+		pBulk->stats.sent++;
+	}
+
+	return SUCCESS;
+}
+
+/* Splits "$aws/things/<thing>/shadow/<action>/<accepted|rejected>" */
+static bool _aws_iot_shadow_bulk_parse_topic(const char *pTopicName, uint16_t topicNameLen, const char **ppThingName,
+											 size_t *pThingNameLen, ShadowActions_t *pAction,
+											 Shadow_Ack_Status_t *pStatus) {
+	const char *pEnd = pTopicName + topicNameLen;
+	const char *pThing, *pCursor, *pAck;
+	size_t actionLen;
+	uint32_t action;
+
+	if(topicNameLen <= SHADOW_BULK_TOPIC_PREFIX_LEN ||
+	   0 != memcmp(pTopicName, SHADOW_BULK_TOPIC_PREFIX, SHADOW_BULK_TOPIC_PREFIX_LEN)) {
+		return false;
+	}
+
+	pThing = pTopicName + SHADOW_BULK_TOPIC_PREFIX_LEN;
+	pCursor = pThing;
+	while(pCursor < pEnd && '/' != *pCursor) {
+		pCursor++;
+	}
+	if((size_t) (pEnd - pCursor) <= SHADOW_BULK_TOPIC_SHADOW_LEN ||
+	   0 != memcmp(pCursor, SHADOW_BULK_TOPIC_SHADOW, SHADOW_BULK_TOPIC_SHADOW_LEN)) {
+		return false;
+	}
+	*ppThingName = pThing;
+	*pThingNameLen = (size_t) (pCursor - pThing);
+
+	pCursor += SHADOW_BULK_TOPIC_SHADOW_LEN;
+	pAck = pCursor;
+	while(pAck < pEnd && '/' != *pAck) {
+		pAck++;
+	}
+	if(pAck == pEnd) {
+		return false;
+	}
+	actionLen = (size_t) (pAck - pCursor);
+	pAck++;
+
+	for(action = 0; action < SHADOW_BULK_ACTION_COUNT; action++) {
+		if(actionLen == strlen(shadowBulkActionNames[action]) &&
+		   0 == memcmp(pCursor, shadowBulkActionNames[action], actionLen)) {
+			break;
+		}
+	}
+	if(SHADOW_BULK_ACTION_COUNT == action) {
+		return false;
+	}
+	*pAction = (ShadowActions_t) action;
+
+	if((size_t) (pEnd - pAck) == strlen("accepted") && 0 == memcmp(pAck, "accepted", strlen("accepted"))) {
+		*pStatus = SHADOW_ACK_ACCEPTED;
+	} else if((size_t) (pEnd - pAck) == strlen("rejected") && 0 == memcmp(pAck, "rejected", strlen("rejected"))) {
+		*pStatus = SHADOW_ACK_REJECTED;
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+static void _aws_iot_shadow_bulk_response_callback(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
+												   IoT_Publish_Message_Params *pParams, void *pData) {
+	IoT_Shadow_Bulk_t *pBulk = (IoT_Shadow_Bulk_t *) pData;
+	char receivedClientToken[MAX_SIZE_CLIENT_ID_WITH_SEQUENCE];
+	const IoT_Shadow_Bulk_Request_t *pRequest;
+	ShadowBulkSlot_t *pSlot = NULL;
+	const char *pThingName;
+	size_t thingNameLen;
+	ShadowActions_t action;
+	Shadow_Ack_Status_t status;
+	uint32_t i, requestIndex;
+
+	IOT_UNUSED(pClient);
+
+	if(!_aws_iot_shadow_bulk_parse_topic(pTopicName, topicNameLen, &pThingName, &thingNameLen, &action, &status)) {
+		pBulk->stats.ignored++;
+		return;
+	}
+
+	/* At most one request per thing and action is in flight */
+	for(i = 0; i < pBulk->params.windowSize; i++) {
+		if(pBulk->slots[i].isInFlight) {
+			pRequest = &pBulk->params.pRequests[pBulk->slots[i].requestIndex];
+			if(pRequest->action == action && 0 == strncmp(pRequest->pThingName, pThingName, thingNameLen) &&
+			   '\0' == pRequest->pThingName[thingNameLen]) {
+				pSlot = &pBulk->slots[i];
+				break;
+			}
+		}
+	}
+
+	if(NULL == pSlot) {
+		pBulk->stats.ignored++;
+		return;
+	}
+
+	if('\0' != pSlot->clientToken[0]) {
+		if(!extractClientToken((const char *) pParams->payload, pParams->payloadLen, receivedClientToken,
+							   sizeof(receivedClientToken)) ||
+		   0 != strcmp(receivedClientToken, pSlot->clientToken)) {
+			IOT_DEBUG("Response on %.*s is for an earlier request", (int) topicNameLen, pTopicName);
+			pBulk->stats.ignored++;
+			return;
+		}
+	}
+
+	/* Reported after the next request went out, so the window does not wait for the application */
+	requestIndex = _aws_iot_shadow_bulk_release(pBulk, pSlot);
+	(void) _aws_iot_shadow_bulk_fill(pBulk);
+
+	_aws_iot_shadow_bulk_complete(pBulk, requestIndex, status, (const char *) pParams->payload, pParams->payloadLen);
+}
+
+static void _aws_iot_shadow_bulk_unsubscribe(IoT_Shadow_Bulk_t *pBulk, IoT_Error_t *pRc) {
+	IoT_Error_t rc;
+	uint32_t action;
+
+	for(action = 0; action < SHADOW_BULK_ACTION_COUNT; action++) {
+		if(0 == (pBulk->subscribedMask & (1u << action))) {
+			continue;
+		}
+		rc = aws_iot_mqtt_unsubscribe(pBulk->pClient, shadowBulkAcceptedFilters[action],
+									  (uint16_t) strlen(shadowBulkAcceptedFilters[action]));
+		if(SUCCESS != rc && SUCCESS == *pRc) {
+			*pRc = rc;
+		}
+		rc = aws_iot_mqtt_unsubscribe(pBulk->pClient, shadowBulkRejectedFilters[action],
+									  (uint16_t) strlen(shadowBulkRejectedFilters[action]));
+		if(SUCCESS != rc && SUCCESS == *pRc) {
+			*pRc = rc;
+		}
+		pBulk->subscribedMask = (uint8_t) (pBulk->subscribedMask & ~(1u << action));
+	}
+}
+
+IoT_Error_t aws_iot_shadow_bulk_start(IoT_Shadow_Bulk_t *pBulk) {
+	IoT_Error_t rc = SUCCESS;
+	IoT_Error_t unsubscribeRc = SUCCESS;
+	uint32_t action;
+
+	FUNC_ENTRY;
+
+	if(NULL == pBulk || NULL == pBulk->pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	for(action = 0; action < SHADOW_BULK_ACTION_COUNT && SUCCESS == rc; action++) {
+		if(0 == (pBulk->actionMask & (1u << action))) {
+			continue;
+		}
+		rc = aws_iot_mqtt_subscribe(pBulk->pClient, shadowBulkAcceptedFilters[action],
+									(uint16_t) strlen(shadowBulkAcceptedFilters[action]), QOS0,
+									_aws_iot_shadow_bulk_response_callback, pBulk);
+		if(SUCCESS != rc) {
+			break;
+		}
+		rc = aws_iot_mqtt_subscribe(pBulk->pClient, shadowBulkRejectedFilters[action],
+									(uint16_t) strlen(shadowBulkRejectedFilters[action]), QOS0,
+									_aws_iot_shadow_bulk_response_callback, pBulk);
+		if(SUCCESS != rc) {
+			/* Makes the cleanup below remove the accepted filter of this action too */
+			pBulk->subscribedMask = (uint8_t) (pBulk->subscribedMask | (1u << action));
+			break;
+		}
+		pBulk->subscribedMask = (uint8_t) (pBulk->subscribedMask | (1u << action));
+	}
+
+	if(SUCCESS != rc) {
+		IOT_ERROR("Bulk sync failed to subscribe to the responses: %d", rc);
+		_aws_iot_shadow_bulk_unsubscribe(pBulk, &unsubscribeRc);
+		FUNC_EXIT_RC(rc);
+	}
+
+	rc = _aws_iot_shadow_bulk_fill(pBulk);
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_bulk_poll(IoT_Shadow_Bulk_t *pBulk) {
+	IoT_Error_t rc;
+	uint32_t i, requestIndex;
+
+	FUNC_ENTRY;
+
+	if(NULL == pBulk || NULL == pBulk->pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	for(i = 0; i < pBulk->params.windowSize; i++) {
+		if(pBulk->slots[i].isInFlight && has_timer_expired(&pBulk->slots[i].timer)) {
+			requestIndex = _aws_iot_shadow_bulk_release(pBulk, &pBulk->slots[i]);
+			_aws_iot_shadow_bulk_complete(pBulk, requestIndex, SHADOW_ACK_TIMEOUT, NULL, 0);
+		}
+	}
+
+	rc = _aws_iot_shadow_bulk_fill(pBulk);
+
+	FUNC_EXIT_RC(rc);
+}
+
+bool aws_iot_shadow_bulk_is_done(const IoT_Shadow_Bulk_t *pBulk) {
+	if(NULL == pBulk) {
+		return false;
+	}
+
+	return pBulk->completedCount == pBulk->params.requestCount;
+}
+
+IoT_Error_t aws_iot_shadow_bulk_stop(IoT_Shadow_Bulk_t *pBulk) {
+	IoT_Error_t rc = SUCCESS;
+	uint32_t i, requestIndex;
+
+	FUNC_ENTRY;
+
+	if(NULL == pBulk || NULL == pBulk->pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	_aws_iot_shadow_bulk_unsubscribe(pBulk, &rc);
+
+	for(i = 0; i < pBulk->params.windowSize; i++) {
+		if(pBulk->slots[i].isInFlight) {
+			requestIndex = _aws_iot_shadow_bulk_release(pBulk, &pBulk->slots[i]);
+			_aws_iot_shadow_bulk_complete(pBulk, requestIndex, SHADOW_ACK_TIMEOUT, NULL, 0);
+		}
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+void aws_iot_shadow_bulk_get_stats(const IoT_Shadow_Bulk_t *pBulk, IoT_Shadow_Bulk_Stats_t *pStats) {
+	if(NULL == pBulk || NULL == pStats) {
+		return;
+	}
+
+	*pStats = pBulk->stats;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_shadow_codegen.c
+ * @brief Support functions for encoders and decoders generated from a shadow schema
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "aws_iot_shadow_codegen.h"
+#include "aws_iot_json_utils.h"
+
+#define SHADOW_CODEGEN_FNV_PRIME 16777619u
+
+/* Longest integer is "-2147483648" */
+#define SHADOW_CODEGEN_INT_TEXT_LEN 11
+
+/* "%f" of the largest double needs over 300 characters */
+#define SHADOW_CODEGEN_DOUBLE_TEXT_LEN 320
+
+static const char *const shadowCodegenPrunedKeys[] = {"metadata"};
+
+void aws_iot_shadow_codegen_writer_init(ShadowCodegenWriter_t *pWriter, char *pBuffer, size_t offset,
+										size_t bufferLen) {
+	pWriter->rc = SUCCESS;
+	if(pBuffer == NULL || bufferLen == 0) {
+		pWriter->pCursor = NULL;
+		pWriter->pEnd = NULL;
+		pWriter->rc = SHADOW_JSON_BUFFER_TRUNCATED;
+		return;
+	}
+	if(offset >= bufferLen) {
+		pWriter->pCursor = pBuffer + bufferLen - 1;
+		pWriter->pEnd = pWriter->pCursor;
+		pWriter->rc = SHADOW_JSON_BUFFER_TRUNCATED;
+		return;
+	}
+	pWriter->pCursor = pBuffer + offset;
+	pWriter->pEnd = pBuffer + bufferLen - 1;
+}
+
+void aws_iot_shadow_codegen_write(ShadowCodegenWriter_t *pWriter, const char *pText, size_t textLen) {
+	if(pWriter->rc != SUCCESS) {
+		return;
+	}
+	if((size_t) (pWriter->pEnd - pWriter->pCursor) < textLen) {
+		pWriter->rc = SHADOW_JSON_BUFFER_TRUNCATED;
+		return;
+	}
+	memcpy(pWriter->pCursor, pText, textLen);
+	pWriter->pCursor += textLen;
+}
+
+static void _aws_iot_shadow_codegen_write_digits(ShadowCodegenWriter_t *pWriter, bool isNegative,
+												 uint32_t magnitude) {
+	char text[SHADOW_CODEGEN_INT_TEXT_LEN];
+	size_t start = sizeof(text);
+
+	do {
+		text[--start] = (char) ('0' + (magnitude % 10));
+		magnitude /= 10;
+	} while(magnitude != 0);
+
+	if(isNegative) {
+		text[--start] = '-';
+	}
+
+	aws_iot_shadow_codegen_write(pWriter, text + start, sizeof(text) - start);
+}
+
+void aws_iot_shadow_codegen_write_int32(ShadowCodegenWriter_t *pWriter, int32_t value) {
+	if(value < 0) {
+		/* Negated in unsigned arithmetic so INT32_MIN does not overflow */
+		_aws_iot_shadow_codegen_write_digits(pWriter, true, 0u - (uint32_t) value);
+		return;
+	}
+	_aws_iot_shadow_codegen_write_digits(pWriter, false, (uint32_t) value);
+}
+
+void aws_iot_shadow_codegen_write_uint32(ShadowCodegenWriter_t *pWriter, uint32_t value) {
+	_aws_iot_shadow_codegen_write_digits(pWriter, false, value);
+}
+
+void aws_iot_shadow_codegen_write_double(ShadowCodegenWriter_t *pWriter, double value) {
+	char text[SHADOW_CODEGEN_DOUBLE_TEXT_LEN];
+	int textLen;
+
+	textLen = snprintf(text, sizeof(text), "%f", value);
+	if(textLen < 0 || (size_t) textLen >= sizeof(text)) {
+		if(pWriter->rc == SUCCESS) {
+			pWriter->rc = SHADOW_JSON_ERROR;
+		}
+		return;
+	}
+	aws_iot_shadow_codegen_write(pWriter, text, (size_t) textLen);
+}
+
+void aws_iot_shadow_codegen_write_bool(ShadowCodegenWriter_t *pWriter, bool value) {
+	if(value) {
+		aws_iot_shadow_codegen_write(pWriter, "true", 4);
+		return;
+	}
+	aws_iot_shadow_codegen_write(pWriter, "false", 5);
+}
+
+void aws_iot_shadow_codegen_write_string(ShadowCodegenWriter_t *pWriter, const char *pValue) {
+	aws_iot_shadow_codegen_write(pWriter, "\"", 1);
+	aws_iot_shadow_codegen_write(pWriter, pValue, strlen(pValue));
+	aws_iot_shadow_codegen_write(pWriter, "\"", 1);
+}
+
+void aws_iot_shadow_codegen_end_object(ShadowCodegenWriter_t *pWriter) {
+	if(pWriter->rc == SUCCESS && *(pWriter->pCursor - 1) == ',') {
+		*(pWriter->pCursor - 1) = '}';
+		return;
+	}
+	aws_iot_shadow_codegen_write(pWriter, "}", 1);
+}
+
+IoT_Error_t aws_iot_shadow_codegen_writer_finish(ShadowCodegenWriter_t *pWriter, const char *pBuffer, size_t *pLen) {
+	if(pWriter->pCursor == NULL) {
+		return pWriter->rc;
+	}
+	*(pWriter->pCursor) = '\0';
+	if(pLen != NULL) {
+		*pLen = (size_t) (pWriter->pCursor - pBuffer);
+	}
+
+	return pWriter->rc;
+}
+
+uint32_t aws_iot_shadow_codegen_hash(uint32_t seed, const char *pKey, size_t keyLen) {
+	uint32_t hash = seed;
+	size_t i;
+
+	for(i = 0; i < keyLen; i++) {
+		hash ^= (uint8_t) pKey[i];
+		hash *= SHADOW_CODEGEN_FNV_PRIME;
+	}
+
+	return hash;
+}
+
+int32_t aws_iot_shadow_codegen_lookup(const ShadowCodegenKey_t *pTable, uint32_t seed, uint32_t mask,
+									  const char *pKey, size_t keyLen) {
+	uint32_t hash = aws_iot_shadow_codegen_hash(seed, pKey, keyLen);
+	const ShadowCodegenKey_t *pSlot;
+
+	/* The low bits of FNV-1a only depend on the low bits of the seed */
+	pSlot = &pTable[(hash ^ (hash >> 16)) & mask];
+
+	if(pSlot->keyLen != keyLen || memcmp(pSlot->pKey, pKey, keyLen) != 0) {
+		return -1;
+	}
+
+	return pSlot->field;
+}
+
+int32_t aws_iot_shadow_codegen_parse(const char *pJsonDocument, size_t jsonLen, jsmntok_t *pTokens,
+									 uint32_t maxTokens) {
+	jsmn_parser parser;
+
+	return parseJsonPruned(&parser, pJsonDocument, jsonLen, pTokens, maxTokens, shadowCodegenPrunedKeys,
+						   sizeof(shadowCodegenPrunedKeys) / sizeof(shadowCodegenPrunedKeys[0]), 1);
+}
+
+int32_t aws_iot_shadow_codegen_skip(const jsmntok_t *pTokens, int32_t tokenCount, int32_t valueIndex) {
+	int32_t i = valueIndex + 1;
+
+	/* Tokens nested in the value start before it ends */
+	while(i < tokenCount && pTokens[i].start < pTokens[valueIndex].end) {
+		i++;
+	}
+
+	return i;
+}
+
+int32_t aws_iot_shadow_codegen_find_member(const char *pJsonDocument, const jsmntok_t *pTokens, int32_t tokenCount,
+										   int32_t objectIndex, const char *pKey, size_t keyLen) {
+	int32_t i, end;
+
+	if(objectIndex < 0 || objectIndex >= tokenCount || pTokens[objectIndex].type != JSMN_OBJECT) {
+		return -1;
+	}
+
+	end = aws_iot_shadow_codegen_skip(pTokens, tokenCount, objectIndex);
+	i = objectIndex + 1;
+	while(i + 1 < end) {
+		if((size_t) (pTokens[i].end - pTokens[i].start) == keyLen
+		   && memcmp(pJsonDocument + pTokens[i].start, pKey, keyLen) == 0) {
+			return i + 1;
+		}
+		i = aws_iot_shadow_codegen_skip(pTokens, tokenCount, i + 1);
+	}
+
+	return -1;
+}
+
+#ifdef __cplusplus
+}
+#endif
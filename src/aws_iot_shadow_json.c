@@ -376,15 +376,29 @@ static IoT_Error_t convertDataToString(char *pStringBuffer, size_t maxSizoString
 static jsmn_parser shadowJsonParser;
 static jsmntok_t jsonTokenStruct[MAX_JSON_TOKEN_EXPECTED];
 
+/* Responses mirror the whole state with timestamps under the top level "metadata" key */
+static const char *const shadowPrunedJsonKeys[] = {"metadata"};
+bool shadowPruneMetadataFlag = true;
+
+static int32_t parseShadowJson(const char *pJsonDocument, size_t jsonSize) {
+	if(shadowPruneMetadataFlag) {
+		return parseJsonPruned(&shadowJsonParser, pJsonDocument, jsonSize, jsonTokenStruct,
+							   sizeof(jsonTokenStruct) / sizeof(jsonTokenStruct[0]), shadowPrunedJsonKeys,
+							   sizeof(shadowPrunedJsonKeys) / sizeof(shadowPrunedJsonKeys[0]), 1);
+	}
+
+	jsmn_init(&shadowJsonParser);
+
+	return jsmn_parse(&shadowJsonParser, pJsonDocument, jsonSize, jsonTokenStruct,
+					  sizeof(jsonTokenStruct) / sizeof(jsonTokenStruct[0]));
+}
+
 bool isJsonValidAndParse(const char *pJsonDocument, size_t jsonSize, void *pJsonHandler, int32_t *pTokenCount) {
 	int32_t tokenCount;
 
 	IOT_UNUSED(pJsonHandler);
 
-	jsmn_init(&shadowJsonParser);
-
-	tokenCount = jsmn_parse(&shadowJsonParser, pJsonDocument, jsonSize, jsonTokenStruct,
-							sizeof(jsonTokenStruct) / sizeof(jsonTokenStruct[0]));
+	tokenCount = parseShadowJson(pJsonDocument, jsonSize);
 
 	if(tokenCount < 0) {
 		IOT_WARN("Failed to parse JSON: %d\n", tokenCount);
@@ -480,10 +494,7 @@ bool isJsonKeyMatchingAndUpdateValue(const char *pJsonDocument, void *pJsonHandl
 bool isReceivedJsonValid(const char *pJsonDocument, size_t jsonSize ) {
 	int32_t tokenCount;
 
-	jsmn_init(&shadowJsonParser);
-
-	tokenCount = jsmn_parse(&shadowJsonParser, pJsonDocument, jsonSize, jsonTokenStruct,
-							sizeof(jsonTokenStruct) / sizeof(jsonTokenStruct[0]));
+	tokenCount = parseShadowJson(pJsonDocument, jsonSize);
 
 	if(tokenCount < 0) {
 		IOT_WARN("Failed to parse JSON: %d\n", tokenCount);
@@ -502,10 +513,7 @@ bool extractClientToken(const char *pJsonDocument, size_t jsonSize, char *pExtra
 	int32_t tokenCount, i;
 	size_t length;
 	jsmntok_t ClientJsonToken;
-	jsmn_init(&shadowJsonParser);
-
-	tokenCount = jsmn_parse(&shadowJsonParser, pJsonDocument, jsonSize, jsonTokenStruct,
-							sizeof(jsonTokenStruct) / sizeof(jsonTokenStruct[0]));
+	tokenCount = parseShadowJson(pJsonDocument, jsonSize);
 
 	if(tokenCount < 0) {
 		IOT_WARN("Failed to parse JSON: %d\n", tokenCount);
@@ -31,6 +31,8 @@ extern "C" {
 #include "aws_iot_json_utils.h"
 #include "aws_iot_log.h"
 #include "aws_iot_shadow_json.h"
+#include "aws_iot_pool.h"
+#include "aws_iot_probes.h"
 #include "aws_iot_config.h"
 
 typedef struct {
@@ -61,7 +63,13 @@ typedef enum {
 	SHADOW_ACCEPTED, SHADOW_REJECTED, SHADOW_ACTION
 } ShadowAckTopicTypes_t;
 
-ToBeReceivedAckRecord_t AckWaitList[MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME];
+/* Pending acks are taken from ackWaitPool, which is backed by these arrays unless
+ * aws_iot_shadow_init was given an arena */
+static ToBeReceivedAckRecord_t AckWaitList[MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME];
+static uint32_t AckWaitListLinks[MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME];
+static IoT_Pool_t ackWaitPool;
+/* Arena ackWaitPool was taken from, its memory region and its mark right after the pool, NULL for the arrays */
+static IoT_Arena_t *pAckWaitArena = NULL;
 
 AWS_IoT_Client *pMqttClient;
 
@@ -79,6 +87,8 @@ char shadowRxBuf[SHADOW_MAX_SIZE_OF_RX_BUFFER];
 static JsonTokenTable_t tokenTable[MAX_JSON_TOKEN_EXPECTED];
 static uint32_t tokenTableIndex = 0;
 static bool deltaTopicSubscribedFlag = false;
+static fpShadowDeltaObserver_t deltaObserver = NULL;
+static void *pDeltaObserverContext = NULL;
 uint32_t shadowJsonVersionNum = 0;
 bool shadowDiscardOldDeltaFlag = true;
 
@@ -94,7 +104,7 @@ static void topicNameFromThingAndAction(char *pTopic, const char *pThingName, Sh
 
 static int16_t getNextFreeIndexOfSubscriptionList(void);
 
-static void unsubscribeFromAcceptedAndRejected(uint8_t index);
+static void unsubscribeFromAcceptedAndRejected(ToBeReceivedAckRecord_t *pRecord);
 
 void initDeltaTokens(void) {
 	uint32_t i;
@@ -103,10 +113,11 @@ void initDeltaTokens(void) {
 	}
 	tokenTableIndex = 0;
 	deltaTopicSubscribedFlag = false;
+	deltaObserver = NULL;
+	pDeltaObserverContext = NULL;
 }
 
-IoT_Error_t registerJsonTokenOnDelta(jsonStruct_t *pStruct) {
-
+static IoT_Error_t subscribeToDelta(void) {
 	IoT_Error_t rc = SUCCESS;
 
 	if(!deltaTopicSubscribedFlag) {
@@ -116,6 +127,20 @@ IoT_Error_t registerJsonTokenOnDelta(jsonStruct_t *pStruct) {
 		deltaTopicSubscribedFlag = true;
 	}
 
+	return rc;
+}
+
+IoT_Error_t registerDeltaObserver(fpShadowDeltaObserver_t observer, void *pContext) {
+	deltaObserver = observer;
+	pDeltaObserverContext = pContext;
+
+	return subscribeToDelta();
+}
+
+IoT_Error_t registerJsonTokenOnDelta(jsonStruct_t *pStruct) {
+
+	IoT_Error_t rc = subscribeToDelta();
+
 	if(tokenTableIndex >= MAX_JSON_TOKEN_EXPECTED) {
 		return FAILURE;
 	}
@@ -180,7 +205,8 @@ static bool isValidShadowVersionUpdate(const char *pTopicName) {
 static void AckStatusCallback(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
 							  IoT_Publish_Message_Params *params, void *pData) {
 	int32_t tokenCount;
-	uint8_t i;
+	uint32_t i;
+	ToBeReceivedAckRecord_t *pRecord;
 	void *pJsonHandler = NULL;
 	char temporaryClientToken[MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE];
 
@@ -211,9 +237,10 @@ static void AckStatusCallback(AWS_IoT_Client *pClient, char *topicName, uint16_t
 	}
 
 	if(extractClientToken(shadowRxBuf, SHADOW_MAX_SIZE_OF_RX_BUFFER, temporaryClientToken, MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE)) {
-		for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
-			if(!AckWaitList[i].isFree) {
-				if(strcmp(AckWaitList[i].clientTokenID, temporaryClientToken) == 0) {
+		for(i = 0; i < aws_iot_pool_capacity(&ackWaitPool); i++) {
+			pRecord = (ToBeReceivedAckRecord_t *) aws_iot_pool_block_at(&ackWaitPool, i);
+			if(!pRecord->isFree) {
+				if(strcmp(pRecord->clientTokenID, temporaryClientToken) == 0) {
 					Shadow_Ack_Status_t status = SHADOW_ACK_REJECTED;
 					if(strstr(topicName, "accepted") != NULL) {
 						status = SHADOW_ACK_ACCEPTED;
@@ -221,12 +248,14 @@ static void AckStatusCallback(AWS_IoT_Client *pClient, char *topicName, uint16_t
 						status = SHADOW_ACK_REJECTED;
 					}
 					if(status == SHADOW_ACK_ACCEPTED || status == SHADOW_ACK_REJECTED) {
-						if(AckWaitList[i].callback != NULL) {
-							AckWaitList[i].callback(AckWaitList[i].thingName, AckWaitList[i].action, status,
-													shadowRxBuf, AckWaitList[i].pCallbackContext);
+						IOT_PROBE3(shadow_ack, i, pRecord->action, status);
+						if(pRecord->callback != NULL) {
+							pRecord->callback(pRecord->thingName, pRecord->action, status,
+											  shadowRxBuf, pRecord->pCallbackContext);
 						}
-						unsubscribeFromAcceptedAndRejected(i);
-						AckWaitList[i].isFree = true;
+						unsubscribeFromAcceptedAndRejected(pRecord);
+						pRecord->isFree = true;
+						(void) aws_iot_pool_free(&ackWaitPool, pRecord);
 						return;
 					}
 				}
@@ -247,7 +276,7 @@ static int16_t findIndexOfSubscriptionList(const char *pTopic) {
 	return -1;
 }
 
-static void unsubscribeFromAcceptedAndRejected(uint8_t index) {
+static void unsubscribeFromAcceptedAndRejected(ToBeReceivedAckRecord_t *pRecord) {
 
 	char TemporaryTopicNameAccepted[MAX_SHADOW_TOPIC_LENGTH_BYTES];
 	char TemporaryTopicNameRejected[MAX_SHADOW_TOPIC_LENGTH_BYTES];
@@ -255,10 +284,8 @@ static void unsubscribeFromAcceptedAndRejected(uint8_t index) {
 
 	int16_t indexSubList;
 
-	topicNameFromThingAndAction(TemporaryTopicNameAccepted, AckWaitList[index].thingName, AckWaitList[index].action,
-								SHADOW_ACCEPTED);
-	topicNameFromThingAndAction(TemporaryTopicNameRejected, AckWaitList[index].thingName, AckWaitList[index].action,
-								SHADOW_REJECTED);
+	topicNameFromThingAndAction(TemporaryTopicNameAccepted, pRecord->thingName, pRecord->action, SHADOW_ACCEPTED);
+	topicNameFromThingAndAction(TemporaryTopicNameRejected, pRecord->thingName, pRecord->action, SHADOW_REJECTED);
 
 	indexSubList = findIndexOfSubscriptionList(TemporaryTopicNameAccepted);
 	if((indexSubList >= 0)) {
@@ -287,10 +314,35 @@ static void unsubscribeFromAcceptedAndRejected(uint8_t index) {
 	}
 }
 
+IoT_Error_t initializeAckWaitList(IoT_Arena_t *pArena, uint32_t maxPendingAcks, bool isArenaReused) {
+	IoT_Error_t rc;
+
+	if(NULL != pArena && 0 != maxPendingAcks) {
+		/* The arena can't tell whether it was rewound since, so only the caller knows that the
+		 * records taken last time are still there */
+		if(isArenaReused && pArena == pAckWaitArena && maxPendingAcks == aws_iot_pool_capacity(&ackWaitPool)) {
+			return SUCCESS;
+		}
+		rc = aws_iot_pool_init_from_arena(&ackWaitPool, pArena, sizeof(ToBeReceivedAckRecord_t), maxPendingAcks);
+		pAckWaitArena = (SUCCESS == rc) ? pArena : NULL;
+	} else {
+		rc = aws_iot_pool_init(&ackWaitPool, AckWaitList, sizeof(ToBeReceivedAckRecord_t),
+							   MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME, AckWaitListLinks);
+		pAckWaitArena = NULL;
+	}
+
+	return rc;
+}
+
 void initializeRecords(AWS_IoT_Client *pClient) {
-	uint8_t i;
-	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
-		AckWaitList[i].isFree = true;
+	uint32_t i;
+
+	if(0 == aws_iot_pool_capacity(&ackWaitPool)) {
+		(void) initializeAckWaitList(NULL, 0, false);
+	}
+	aws_iot_pool_reset(&ackWaitPool);
+	for(i = 0; i < aws_iot_pool_capacity(&ackWaitPool); i++) {
+		((ToBeReceivedAckRecord_t *) aws_iot_pool_block_at(&ackWaitPool, i))->isFree = true;
 	}
 	for(i = 0; i < MAX_TOPICS_AT_ANY_GIVEN_TIME; i++) {
 		SubscriptionList[i].isFree = true;
@@ -422,49 +474,66 @@ IoT_Error_t publishToShadowAction(const char *pThingName, ShadowActions_t action
 	return ret_val;
 }
 
-bool getNextFreeIndexOfAckWaitList(uint8_t *pIndex) {
-	uint8_t i;
-	bool rc = false;
+bool reserveAckWaitListIndex(uint32_t *pIndex) {
+	ToBeReceivedAckRecord_t *pRecord;
 
 	if(NULL == pIndex) {
 		return false;
 	}
 
-	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
-		if(AckWaitList[i].isFree) {
-			*pIndex = i;
-			rc = true;
-			break;
-		}
+	pRecord = (ToBeReceivedAckRecord_t *) aws_iot_pool_alloc(&ackWaitPool);
+	if(NULL == pRecord) {
+		return false;
 	}
 
-	return rc;
+	/* Stays free for the callbacks until addToAckWaitList fills it in */
+	pRecord->isFree = true;
+	*pIndex = aws_iot_pool_index_of(&ackWaitPool, pRecord);
+
+	return true;
+}
+
+void releaseAckWaitListIndex(uint32_t indexAckWaitList) {
+	(void) aws_iot_pool_free(&ackWaitPool, aws_iot_pool_block_at(&ackWaitPool, indexAckWaitList));
 }
 
-void addToAckWaitList(uint8_t indexAckWaitList, const char *pThingName, ShadowActions_t action,
+void addToAckWaitList(uint32_t indexAckWaitList, const char *pThingName, ShadowActions_t action,
 					  const char *pExtractedClientToken, fpActionCallback_t callback, void *pCallbackContext,
 					  uint32_t timeout_seconds) {
-	AckWaitList[indexAckWaitList].callback = callback;
-	memcpy(AckWaitList[indexAckWaitList].clientTokenID, pExtractedClientToken, MAX_SIZE_CLIENT_ID_WITH_SEQUENCE);
-	memcpy(AckWaitList[indexAckWaitList].thingName, pThingName, MAX_SIZE_OF_THING_NAME);
-	AckWaitList[indexAckWaitList].pCallbackContext = pCallbackContext;
-	AckWaitList[indexAckWaitList].action = action;
-	init_timer(&(AckWaitList[indexAckWaitList].timer));
-	countdown_sec(&(AckWaitList[indexAckWaitList].timer), timeout_seconds);
-	AckWaitList[indexAckWaitList].isFree = false;
+	ToBeReceivedAckRecord_t *pRecord = (ToBeReceivedAckRecord_t *) aws_iot_pool_block_at(&ackWaitPool,
+																						  indexAckWaitList);
+
+	if(NULL == pRecord) {
+		return;
+	}
+
+	pRecord->callback = callback;
+	memcpy(pRecord->clientTokenID, pExtractedClientToken, MAX_SIZE_CLIENT_ID_WITH_SEQUENCE);
+	memcpy(pRecord->thingName, pThingName, MAX_SIZE_OF_THING_NAME);
+	pRecord->pCallbackContext = pCallbackContext;
+	pRecord->action = action;
+	init_timer(&(pRecord->timer));
+	countdown_sec(&(pRecord->timer), timeout_seconds);
+	pRecord->isFree = false;
+
+	IOT_PROBE3(shadow_ack_wait, indexAckWaitList, action, pRecord->clientTokenID);
 }
 
 void HandleExpiredResponseCallbacks(void) {
-	uint8_t i;
-	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
-		if(!AckWaitList[i].isFree) {
-			if(has_timer_expired(&(AckWaitList[i].timer))) {
-				if(AckWaitList[i].callback != NULL) {
-					AckWaitList[i].callback(AckWaitList[i].thingName, AckWaitList[i].action, SHADOW_ACK_TIMEOUT,
-											shadowRxBuf, AckWaitList[i].pCallbackContext);
+	ToBeReceivedAckRecord_t *pRecord;
+	uint32_t i;
+	for(i = 0; i < aws_iot_pool_capacity(&ackWaitPool); i++) {
+		pRecord = (ToBeReceivedAckRecord_t *) aws_iot_pool_block_at(&ackWaitPool, i);
+		if(!pRecord->isFree) {
+			if(has_timer_expired(&(pRecord->timer))) {
+				IOT_PROBE3(shadow_ack, i, pRecord->action, SHADOW_ACK_TIMEOUT);
+				if(pRecord->callback != NULL) {
+					pRecord->callback(pRecord->thingName, pRecord->action, SHADOW_ACK_TIMEOUT,
+									  shadowRxBuf, pRecord->pCallbackContext);
 				}
-				AckWaitList[i].isFree = true;
-				unsubscribeFromAcceptedAndRejected(i);
+				pRecord->isFree = true;
+				unsubscribeFromAcceptedAndRejected(pRecord);
+				(void) aws_iot_pool_free(&ackWaitPool, pRecord);
 			}
 		}
 	}
@@ -486,6 +555,11 @@ static void shadow_delta_callback(AWS_IoT_Client *pClient, char *topicName,
 	IOT_UNUSED(topicNameLen);
 	IOT_UNUSED(pData);
 
+	/* The observer sees every delta, before the version filter and the size limit of the RX buffer */
+	if(NULL != deltaObserver) {
+		deltaObserver((const char *) params->payload, params->payloadLen, pDeltaObserverContext);
+	}
+
 	if(params->payloadLen >= SHADOW_MAX_SIZE_OF_RX_BUFFER) {
 		IOT_WARN("Payload larger than RX Buffer");
 		return;
@@ -0,0 +1,744 @@
+/*
+ * Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_shadow_replica.c
+ * @brief Local replica of the desired and reported state of the device shadow
+ *
+ * The block starts with a ShadowReplicaHeader_t followed by usedLen bytes of leaf records,
+ * packed back to back in no particular order. A record is an 8 byte head (record length and
+ * value length as uint16_t, section, flags, path length, unused) followed by the path and the
+ * value, each NUL terminated. The checksum is cleared while a message is applied and written
+ * again when it is done, so a block left behind half way fails the check at the next start.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "aws_iot_shadow_replica.h"
+#include "aws_iot_shadow_interface.h"
+#include "aws_iot_shadow_records.h"
+#include "aws_iot_json_utils.h"
+#include "aws_iot_log.h"
+
+#define SHADOW_REPLICA_MAGIC 0x50524853u /* "SHRP" */
+#define SHADOW_REPLICA_RECORD_HEAD_LEN 8
+#define SHADOW_REPLICA_FLAG_SEEN 0x01
+#define SHADOW_REPLICA_PRUNE_DEPTH 1
+#define SHADOW_REPLICA_DOCUMENTS_PRUNE_DEPTH 2
+#define SHADOW_REPLICA_NOT_FOUND 0xFFFFFFFFu
+
+#define SHADOW_REPLICA_FNV_OFFSET 2166136261u
+#define SHADOW_REPLICA_FNV_PRIME 16777619u
+
+typedef struct {
+	uint32_t magic; ///< SHADOW_REPLICA_MAGIC
+	uint32_t storageLen; ///< Size of the block the replica was formatted in
+	uint32_t version; ///< Shadow version, 0 if the replica is empty
+	uint32_t usedLen; ///< Bytes of records after the header
+	uint32_t checksum; ///< FNV-1a of the header without this field and the records, 0 while changing
+	uint32_t reserved; ///< Always 0
+} ShadowReplicaHeader_t;
+
+typedef struct {
+	uint16_t recordLen;
+	uint16_t valueLen;
+	uint8_t section;
+	uint8_t flags;
+	uint8_t pathLen;
+	const char *pPath;
+	const char *pValue;
+} ShadowReplicaRecord_t;
+
+static jsmn_parser replicaJsonParser;
+static jsmntok_t replicaJsonTokens[AWS_IOT_SHADOW_REPLICA_MAX_JSON_TOKENS];
+static char replicaDocumentsTopic[MAX_SHADOW_TOPIC_LENGTH_BYTES];
+
+/* Neither the metadata nor the previous state of a message is used. They are pruned at the top level, and in
+ * current for a documents message; in a delta the second level holds the keys of the application. */
+static const char *const replicaPrunedJsonKeys[] = {"metadata", "previous"};
+
+static ShadowReplicaHeader_t *_aws_iot_shadow_replica_header(const IoT_Shadow_Replica_t *pReplica) {
+	return (ShadowReplicaHeader_t *) pReplica->pStorage;
+}
+
+static unsigned char *_aws_iot_shadow_replica_records(const IoT_Shadow_Replica_t *pReplica) {
+	return pReplica->pStorage + sizeof(ShadowReplicaHeader_t);
+}
+
+static uint32_t _aws_iot_shadow_replica_hash(uint32_t hash, const unsigned char *pData, size_t len) {
+	size_t i;
+
+	for(i = 0; i < len; i++) {
+		hash ^= pData[i];
+		hash *= SHADOW_REPLICA_FNV_PRIME;
+	}
+
+	return hash;
+}
+
+static uint32_t _aws_iot_shadow_replica_checksum(const IoT_Shadow_Replica_t *pReplica) {
+	ShadowReplicaHeader_t *pHeader = _aws_iot_shadow_replica_header(pReplica);
+	uint32_t hash;
+
+	hash = _aws_iot_shadow_replica_hash(SHADOW_REPLICA_FNV_OFFSET, pReplica->pStorage,
+										offsetof(ShadowReplicaHeader_t, checksum));
+	return _aws_iot_shadow_replica_hash(hash, _aws_iot_shadow_replica_records(pReplica), pHeader->usedLen);
+}
+
+static void _aws_iot_shadow_replica_read_record(const IoT_Shadow_Replica_t *pReplica, uint32_t offset,
+												ShadowReplicaRecord_t *pRecord) {
+	const unsigned char *pHead = _aws_iot_shadow_replica_records(pReplica) + offset;
+
+	memcpy(&(pRecord->recordLen), pHead, sizeof(uint16_t));
+	memcpy(&(pRecord->valueLen), pHead + 2, sizeof(uint16_t));
+	pRecord->section = pHead[4];
+	pRecord->flags = pHead[5];
+	pRecord->pathLen = pHead[6];
+	pRecord->pPath = (const char *) pHead + SHADOW_REPLICA_RECORD_HEAD_LEN;
+	pRecord->pValue = pRecord->pPath + pRecord->pathLen + 1;
+}
+
+/* Walks the records of a block that may have been torn, checking every length */
+static bool _aws_iot_shadow_replica_is_valid(const IoT_Shadow_Replica_t *pReplica) {
+	ShadowReplicaHeader_t *pHeader = _aws_iot_shadow_replica_header(pReplica);
+	ShadowReplicaRecord_t record;
+	uint32_t offset = 0;
+
+	if(SHADOW_REPLICA_MAGIC != pHeader->magic || pReplica->storageLen != pHeader->storageLen ||
+	   pHeader->usedLen > pReplica->storageLen - sizeof(ShadowReplicaHeader_t) ||
+	   0 == pHeader->checksum || _aws_iot_shadow_replica_checksum(pReplica) != pHeader->checksum) {
+		return false;
+	}
+
+	while(offset < pHeader->usedLen) {
+		if(pHeader->usedLen - offset < SHADOW_REPLICA_RECORD_HEAD_LEN) {
+			return false;
+		}
+		_aws_iot_shadow_replica_read_record(pReplica, offset, &record);
+		if(record.recordLen != SHADOW_REPLICA_RECORD_HEAD_LEN + record.pathLen + 1 + record.valueLen + 1 ||
+		   record.recordLen > pHeader->usedLen - offset || SHADOW_REPLICA_REPORTED < record.section) {
+			return false;
+		}
+		offset += record.recordLen;
+	}
+
+	return true;
+}
+
+static void _aws_iot_shadow_replica_begin_change(IoT_Shadow_Replica_t *pReplica) {
+	_aws_iot_shadow_replica_header(pReplica)->checksum = 0;
+}
+
+static void _aws_iot_shadow_replica_commit(IoT_Shadow_Replica_t *pReplica) {
+	uint32_t checksum = _aws_iot_shadow_replica_checksum(pReplica);
+
+	/* 0 marks a block that is being changed */
+	_aws_iot_shadow_replica_header(pReplica)->checksum = (0 == checksum) ? 1 : checksum;
+}
+
+static void _aws_iot_shadow_replica_format(IoT_Shadow_Replica_t *pReplica) {
+	ShadowReplicaHeader_t *pHeader = _aws_iot_shadow_replica_header(pReplica);
+
+	pHeader->magic = SHADOW_REPLICA_MAGIC;
+	pHeader->storageLen = (uint32_t) pReplica->storageLen;
+	pHeader->version = 0;
+	pHeader->usedLen = 0;
+	pHeader->reserved = 0;
+	_aws_iot_shadow_replica_commit(pReplica);
+}
+
+static uint32_t _aws_iot_shadow_replica_find(const IoT_Shadow_Replica_t *pReplica, ShadowReplicaSection_t section,
+											 const char *pPath, size_t pathLen) {
+	ShadowReplicaHeader_t *pHeader = _aws_iot_shadow_replica_header(pReplica);
+	ShadowReplicaRecord_t record;
+	uint32_t offset = 0;
+
+	while(offset < pHeader->usedLen) {
+		_aws_iot_shadow_replica_read_record(pReplica, offset, &record);
+		if(record.section == section && record.pathLen == pathLen && 0 == memcmp(record.pPath, pPath, pathLen)) {
+			return offset;
+		}
+		offset += record.recordLen;
+	}
+
+	return SHADOW_REPLICA_NOT_FOUND;
+}
+
+static void _aws_iot_shadow_replica_remove_at(IoT_Shadow_Replica_t *pReplica, uint32_t offset, bool isNotified) {
+	ShadowReplicaHeader_t *pHeader = _aws_iot_shadow_replica_header(pReplica);
+	unsigned char *pRecords = _aws_iot_shadow_replica_records(pReplica);
+	ShadowReplicaRecord_t record;
+
+	_aws_iot_shadow_replica_read_record(pReplica, offset, &record);
+	if(isNotified && NULL != pReplica->changeCallback) {
+		pReplica->changeCallback((ShadowReplicaSection_t) record.section, record.pPath, NULL, 0,
+								 pReplica->pChangeContext);
+	}
+
+	memmove(pRecords + offset, pRecords + offset + record.recordLen, pHeader->usedLen - offset - record.recordLen);
+	pHeader->usedLen -= record.recordLen;
+}
+
+/* Removes the leaf at the path and every leaf below it, only the ones below when isChildrenOnly is set */
+static void _aws_iot_shadow_replica_remove_path(IoT_Shadow_Replica_t *pReplica, ShadowReplicaSection_t section,
+												const char *pPath, size_t pathLen, bool isChildrenOnly) {
+	ShadowReplicaHeader_t *pHeader = _aws_iot_shadow_replica_header(pReplica);
+	ShadowReplicaRecord_t record;
+	uint32_t offset = 0;
+	bool isMatch;
+
+	while(offset < pHeader->usedLen) {
+		_aws_iot_shadow_replica_read_record(pReplica, offset, &record);
+		isMatch = false;
+		if(record.section == section && record.pathLen >= pathLen && 0 == memcmp(record.pPath, pPath, pathLen)) {
+			if(record.pathLen == pathLen) {
+				isMatch = !isChildrenOnly;
+			} else {
+				isMatch = ('.' == record.pPath[pathLen]);
+			}
+		}
+
+		if(isMatch) {
+			_aws_iot_shadow_replica_remove_at(pReplica, offset, true);
+		} else {
+			offset += record.recordLen;
+		}
+	}
+}
+
+static IoT_Error_t _aws_iot_shadow_replica_set(IoT_Shadow_Replica_t *pReplica, ShadowReplicaSection_t section,
+											   const char *pPath, size_t pathLen, const char *pValue,
+											   size_t valueLen) {
+	ShadowReplicaHeader_t *pHeader = _aws_iot_shadow_replica_header(pReplica);
+	unsigned char *pHead;
+	ShadowReplicaRecord_t record;
+	uint32_t offset;
+	uint16_t recordLen, storedValueLen;
+
+	/* A leaf replaces whatever object was at its path */
+	_aws_iot_shadow_replica_remove_path(pReplica, section, pPath, pathLen, true);
+
+	offset = _aws_iot_shadow_replica_find(pReplica, section, pPath, pathLen);
+	if(SHADOW_REPLICA_NOT_FOUND != offset) {
+		_aws_iot_shadow_replica_read_record(pReplica, offset, &record);
+		if(record.valueLen == valueLen && 0 == memcmp(record.pValue, pValue, valueLen)) {
+			_aws_iot_shadow_replica_records(pReplica)[offset + 5] |= SHADOW_REPLICA_FLAG_SEEN;
+			return SUCCESS;
+		}
+		_aws_iot_shadow_replica_remove_at(pReplica, offset, false);
+	}
+
+	if(SHADOW_REPLICA_RECORD_HEAD_LEN + pathLen + 1 + valueLen + 1 > UINT16_MAX) {
+		return MAX_SIZE_ERROR;
+	}
+	recordLen = (uint16_t) (SHADOW_REPLICA_RECORD_HEAD_LEN + pathLen + 1 + valueLen + 1);
+	if(recordLen > pReplica->storageLen - sizeof(ShadowReplicaHeader_t) - pHeader->usedLen) {
+		IOT_WARN("Shadow replica is full");
+		return LIMIT_EXCEEDED_ERROR;
+	}
+
+	pHead = _aws_iot_shadow_replica_records(pReplica) + pHeader->usedLen;
+	storedValueLen = (uint16_t) valueLen;
+	memcpy(pHead, &recordLen, sizeof(uint16_t));
+	memcpy(pHead + 2, &storedValueLen, sizeof(uint16_t));
+	pHead[4] = (unsigned char) section;
+	pHead[5] = SHADOW_REPLICA_FLAG_SEEN;
+	pHead[6] = (unsigned char) pathLen;
+	pHead[7] = 0;
+	memcpy(pHead + SHADOW_REPLICA_RECORD_HEAD_LEN, pPath, pathLen);
+	pHead[SHADOW_REPLICA_RECORD_HEAD_LEN + pathLen] = '\0';
+	memcpy(pHead + SHADOW_REPLICA_RECORD_HEAD_LEN + pathLen + 1, pValue, valueLen);
+	pHead[recordLen - 1] = '\0';
+	pHeader->usedLen += recordLen;
+
+	if(NULL != pReplica->changeCallback) {
+		pReplica->changeCallback(section, (const char *) pHead + SHADOW_REPLICA_RECORD_HEAD_LEN,
+								 (const char *) pHead + SHADOW_REPLICA_RECORD_HEAD_LEN + pathLen + 1, valueLen,
+								 pReplica->pChangeContext);
+	}
+
+	return SUCCESS;
+}
+
+/* Index of the token after the value at index i and everything nested in it */
+static int32_t _aws_iot_shadow_replica_skip(int32_t i, int32_t tokenCount) {
+	int32_t end = replicaJsonTokens[i].end;
+
+	i++;
+	while(i < tokenCount && replicaJsonTokens[i].start < end) {
+		i++;
+	}
+
+	return i;
+}
+
+/* Index of the value of a member of the object at index objectIndex, -1 if it has none */
+static int32_t _aws_iot_shadow_replica_member(const char *pJson, int32_t objectIndex, int32_t tokenCount,
+											  const char *pKey) {
+	int32_t i;
+
+	if(0 > objectIndex || JSMN_OBJECT != replicaJsonTokens[objectIndex].type) {
+		return -1;
+	}
+
+	i = objectIndex + 1;
+	while(i + 1 < tokenCount && replicaJsonTokens[i].start < replicaJsonTokens[objectIndex].end) {
+		if(0 == jsoneq(pJson, &replicaJsonTokens[i], pKey)) {
+			return i + 1;
+		}
+		i = _aws_iot_shadow_replica_skip(i + 1, tokenCount);
+	}
+
+	return -1;
+}
+
+static IoT_Error_t _aws_iot_shadow_replica_merge(IoT_Shadow_Replica_t *pReplica, ShadowReplicaSection_t section,
+												 const char *pJson, int32_t objectIndex, int32_t tokenCount,
+												 char *pPath, size_t pathLen) {
+	jsmntok_t *pKey, *pValue;
+	size_t keyLen, childLen;
+	uint32_t offset;
+	int32_t i;
+	IoT_Error_t rc;
+
+	i = objectIndex + 1;
+	while(i + 1 < tokenCount && replicaJsonTokens[i].start < replicaJsonTokens[objectIndex].end) {
+		pKey = &replicaJsonTokens[i];
+		pValue = &replicaJsonTokens[i + 1];
+		keyLen = (size_t) (pKey->end - pKey->start);
+
+		childLen = pathLen + ((0 < pathLen) ? 1 : 0) + keyLen;
+		if(childLen > AWS_IOT_SHADOW_REPLICA_MAX_PATH_LEN) {
+			IOT_WARN("Shadow replica path too long");
+			return MAX_SIZE_ERROR;
+		}
+		if(0 < pathLen) {
+			pPath[pathLen] = '.';
+		}
+		memcpy(pPath + childLen - keyLen, pJson + pKey->start, keyLen);
+
+		if(JSMN_OBJECT == pValue->type) {
+			/* An object replaces a leaf at its path, leaves below it that it does not mention are kept */
+			offset = _aws_iot_shadow_replica_find(pReplica, section, pPath, childLen);
+			if(SHADOW_REPLICA_NOT_FOUND != offset) {
+				_aws_iot_shadow_replica_remove_at(pReplica, offset, true);
+			}
+			rc = _aws_iot_shadow_replica_merge(pReplica, section, pJson, i + 1, tokenCount, pPath, childLen);
+		} else if(JSMN_PRIMITIVE == pValue->type && 'n' == pJson[pValue->start]) {
+			_aws_iot_shadow_replica_remove_path(pReplica, section, pPath, childLen, false);
+			rc = SUCCESS;
+		} else if(JSMN_STRING == pValue->type) {
+			/* Strings keep their quotes so that every value is JSON text */
+			rc = _aws_iot_shadow_replica_set(pReplica, section, pPath, childLen, pJson + pValue->start - 1,
+											 (size_t) (pValue->end - pValue->start + 2));
+		} else {
+			rc = _aws_iot_shadow_replica_set(pReplica, section, pPath, childLen, pJson + pValue->start,
+											 (size_t) (pValue->end - pValue->start));
+		}
+		if(SUCCESS != rc) {
+			return rc;
+		}
+
+		i = _aws_iot_shadow_replica_skip(i + 1, tokenCount);
+	}
+
+	return SUCCESS;
+}
+
+static IoT_Error_t _aws_iot_shadow_replica_merge_section(IoT_Shadow_Replica_t *pReplica,
+														 ShadowReplicaSection_t section, const char *pJson,
+														 int32_t stateIndex, int32_t tokenCount) {
+	char path[AWS_IOT_SHADOW_REPLICA_MAX_PATH_LEN + 1];
+	int32_t sectionIndex;
+
+	sectionIndex = _aws_iot_shadow_replica_member(pJson, stateIndex, tokenCount,
+												  (SHADOW_REPLICA_DESIRED == section) ? "desired" : "reported");
+	if(0 > sectionIndex || JSMN_OBJECT != replicaJsonTokens[sectionIndex].type) {
+		return SUCCESS;
+	}
+
+	return _aws_iot_shadow_replica_merge(pReplica, section, pJson, sectionIndex, tokenCount, path, 0);
+}
+
+static IoT_Error_t _aws_iot_shadow_replica_parse(const char *pJson, size_t jsonLen, uint32_t pruneDepth,
+												 int32_t *pTokenCount) {
+	int32_t tokenCount;
+
+	tokenCount = parseJsonPruned(&replicaJsonParser, pJson, jsonLen, replicaJsonTokens,
+								 AWS_IOT_SHADOW_REPLICA_MAX_JSON_TOKENS, replicaPrunedJsonKeys,
+								 sizeof(replicaPrunedJsonKeys) / sizeof(replicaPrunedJsonKeys[0]), pruneDepth);
+	if(1 > tokenCount || JSMN_OBJECT != replicaJsonTokens[0].type) {
+		IOT_WARN("Shadow replica could not parse the document: %d", tokenCount);
+		return JSON_PARSE_ERROR;
+	}
+
+	*pTokenCount = tokenCount;
+	return SUCCESS;
+}
+
+static IoT_Error_t _aws_iot_shadow_replica_version(const char *pJson, int32_t objectIndex, int32_t tokenCount,
+												   uint32_t *pVersion) {
+	int32_t versionIndex = _aws_iot_shadow_replica_member(pJson, objectIndex, tokenCount, "version");
+
+	if(0 > versionIndex) {
+		return JSON_PARSE_ERROR;
+	}
+
+	return parseUnsignedInteger32Value(pVersion, pJson, &replicaJsonTokens[versionIndex]);
+}
+
+/* Replaces both sections with the state of a complete document, leaves that stay the same are not reported */
+static IoT_Error_t _aws_iot_shadow_replica_replace(IoT_Shadow_Replica_t *pReplica, const char *pJson,
+												   int32_t stateIndex, int32_t tokenCount, uint32_t version) {
+	ShadowReplicaHeader_t *pHeader = _aws_iot_shadow_replica_header(pReplica);
+	unsigned char *pRecords = _aws_iot_shadow_replica_records(pReplica);
+	ShadowReplicaRecord_t record;
+	uint32_t offset;
+	IoT_Error_t rc;
+
+	_aws_iot_shadow_replica_begin_change(pReplica);
+
+	for(offset = 0; offset < pHeader->usedLen; offset += record.recordLen) {
+		_aws_iot_shadow_replica_read_record(pReplica, offset, &record);
+		pRecords[offset + 5] &= (unsigned char) ~SHADOW_REPLICA_FLAG_SEEN;
+	}
+
+	rc = _aws_iot_shadow_replica_merge_section(pReplica, SHADOW_REPLICA_DESIRED, pJson, stateIndex, tokenCount);
+	if(SUCCESS == rc) {
+		rc = _aws_iot_shadow_replica_merge_section(pReplica, SHADOW_REPLICA_REPORTED, pJson, stateIndex, tokenCount);
+	}
+	if(SUCCESS != rc) {
+		pReplica->isResyncNeeded = true;
+		_aws_iot_shadow_replica_commit(pReplica);
+		return rc;
+	}
+
+	offset = 0;
+	while(offset < pHeader->usedLen) {
+		_aws_iot_shadow_replica_read_record(pReplica, offset, &record);
+		if(0 == (record.flags & SHADOW_REPLICA_FLAG_SEEN)) {
+			_aws_iot_shadow_replica_remove_at(pReplica, offset, true);
+		} else {
+			offset += record.recordLen;
+		}
+	}
+
+	pHeader->version = version;
+	pReplica->stats.documentsApplied++;
+	_aws_iot_shadow_replica_commit(pReplica);
+
+	return SUCCESS;
+}
+
+IoT_Error_t aws_iot_shadow_replica_init(IoT_Shadow_Replica_t *pReplica, void *pStorage, size_t storageLen,
+										fpShadowReplicaChange_t changeCallback, void *pChangeContext) {
+	FUNC_ENTRY;
+
+	if(NULL == pReplica || NULL == pStorage) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(storageLen < 64 || storageLen > UINT32_MAX) {
+		FUNC_EXIT_RC(MAX_SIZE_ERROR);
+	}
+
+	memset(pReplica, 0, sizeof(IoT_Shadow_Replica_t));
+	pReplica->pStorage = (unsigned char *) pStorage;
+	pReplica->storageLen = storageLen;
+	pReplica->changeCallback = changeCallback;
+	pReplica->pChangeContext = pChangeContext;
+
+	pReplica->isWarmStart = _aws_iot_shadow_replica_is_valid(pReplica) &&
+							0 != _aws_iot_shadow_replica_header(pReplica)->version;
+	if(!pReplica->isWarmStart) {
+		_aws_iot_shadow_replica_format(pReplica);
+		pReplica->isResyncNeeded = true;
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_shadow_replica_apply_full(IoT_Shadow_Replica_t *pReplica, const char *pJsonDocument,
+											  size_t jsonLen) {
+	int32_t tokenCount, stateIndex;
+	uint32_t version;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pReplica || NULL == pJsonDocument) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	pReplica->stats.bytesReceived += (uint32_t) jsonLen;
+	rc = _aws_iot_shadow_replica_parse(pJsonDocument, jsonLen, SHADOW_REPLICA_PRUNE_DEPTH, &tokenCount);
+	if(SUCCESS == rc) {
+		rc = _aws_iot_shadow_replica_version(pJsonDocument, 0, tokenCount, &version);
+	}
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* An update that arrived while the GET was on its way is newer than its response */
+	if(!pReplica->isResyncNeeded && version < _aws_iot_shadow_replica_header(pReplica)->version) {
+		pReplica->stats.staleDiscarded++;
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	stateIndex = _aws_iot_shadow_replica_member(pJsonDocument, 0, tokenCount, "state");
+	rc = _aws_iot_shadow_replica_replace(pReplica, pJsonDocument, stateIndex, tokenCount, version);
+	if(SUCCESS == rc) {
+		pReplica->isResyncNeeded = false;
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_replica_apply_documents(IoT_Shadow_Replica_t *pReplica, const char *pJsonDocument,
+												   size_t jsonLen) {
+	int32_t tokenCount, currentIndex;
+	uint32_t version;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pReplica || NULL == pJsonDocument) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	pReplica->stats.bytesReceived += (uint32_t) jsonLen;
+	rc = _aws_iot_shadow_replica_parse(pJsonDocument, jsonLen, SHADOW_REPLICA_DOCUMENTS_PRUNE_DEPTH,
+										&tokenCount);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	currentIndex = _aws_iot_shadow_replica_member(pJsonDocument, 0, tokenCount, "current");
+	rc = _aws_iot_shadow_replica_version(pJsonDocument, currentIndex, tokenCount, &version);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* The same version is applied again, a delta of it may have come first and only has part of it */
+	if(version < _aws_iot_shadow_replica_header(pReplica)->version) {
+		pReplica->stats.staleDiscarded++;
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	/* The document is complete, so it also closes any gap */
+	rc = _aws_iot_shadow_replica_replace(pReplica, pJsonDocument,
+										 _aws_iot_shadow_replica_member(pJsonDocument, currentIndex, tokenCount,
+																		"state"), tokenCount, version);
+	if(SUCCESS == rc) {
+		pReplica->isResyncNeeded = false;
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_replica_apply_delta(IoT_Shadow_Replica_t *pReplica, const char *pJsonDocument,
+											   size_t jsonLen) {
+	char path[AWS_IOT_SHADOW_REPLICA_MAX_PATH_LEN + 1];
+	ShadowReplicaHeader_t *pHeader;
+	int32_t tokenCount, stateIndex;
+	uint32_t version;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pReplica || NULL == pJsonDocument) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	pHeader = _aws_iot_shadow_replica_header(pReplica);
+	pReplica->stats.bytesReceived += (uint32_t) jsonLen;
+	rc = _aws_iot_shadow_replica_parse(pJsonDocument, jsonLen, SHADOW_REPLICA_PRUNE_DEPTH, &tokenCount);
+	if(SUCCESS == rc) {
+		rc = _aws_iot_shadow_replica_version(pJsonDocument, 0, tokenCount, &version);
+	}
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	if(version <= pHeader->version) {
+		pReplica->stats.staleDiscarded++;
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	/* Updates that changed nothing in desired have no delta, only documents fill those versions in */
+	if(version != pHeader->version + 1 && !pReplica->isResyncNeeded) {
+		IOT_INFO("Shadow replica missed versions %u to %u", pHeader->version + 1, version - 1);
+		pReplica->stats.versionGaps++;
+		pReplica->isResyncNeeded = true;
+	}
+
+	stateIndex = _aws_iot_shadow_replica_member(pJsonDocument, 0, tokenCount, "state");
+	if(0 > stateIndex || JSMN_OBJECT != replicaJsonTokens[stateIndex].type) {
+		FUNC_EXIT_RC(JSON_PARSE_ERROR);
+	}
+
+	_aws_iot_shadow_replica_begin_change(pReplica);
+	rc = _aws_iot_shadow_replica_merge(pReplica, SHADOW_REPLICA_DESIRED, pJsonDocument, stateIndex, tokenCount,
+									   path, 0);
+	if(SUCCESS == rc) {
+		pHeader->version = version;
+		pReplica->stats.deltasApplied++;
+	} else {
+		pReplica->isResyncNeeded = true;
+	}
+	_aws_iot_shadow_replica_commit(pReplica);
+
+	FUNC_EXIT_RC(rc);
+}
+
+static void _aws_iot_shadow_replica_documents_callback(AWS_IoT_Client *pClient, char *pTopicName,
+													   uint16_t topicNameLen, IoT_Publish_Message_Params *pParams,
+													   void *pData) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(pTopicName);
+	IOT_UNUSED(topicNameLen);
+
+	(void) aws_iot_shadow_replica_apply_documents((IoT_Shadow_Replica_t *) pData, (const char *) pParams->payload,
+												  pParams->payloadLen);
+}
+
+static void _aws_iot_shadow_replica_delta_observer(const char *pJsonDocument, size_t jsonLen, void *pContext) {
+	(void) aws_iot_shadow_replica_apply_delta((IoT_Shadow_Replica_t *) pContext, pJsonDocument, jsonLen);
+}
+
+static void _aws_iot_shadow_replica_get_callback(const char *pThingName, ShadowActions_t action,
+												 Shadow_Ack_Status_t status, const char *pReceivedJsonDocument,
+												 void *pContextData) {
+	IoT_Shadow_Replica_t *pReplica = (IoT_Shadow_Replica_t *) pContextData;
+
+	IOT_UNUSED(pThingName);
+	IOT_UNUSED(action);
+
+	pReplica->isGetPending = false;
+	if(SHADOW_ACK_ACCEPTED == status) {
+		(void) aws_iot_shadow_replica_apply_full(pReplica, pReceivedJsonDocument, strlen(pReceivedJsonDocument));
+	} else if(SHADOW_ACK_REJECTED == status && NULL != strstr(pReceivedJsonDocument, "\"code\":404")) {
+		/* The thing has no shadow yet, its first update arrives as a document */
+		_aws_iot_shadow_replica_begin_change(pReplica);
+		_aws_iot_shadow_replica_header(pReplica)->usedLen = 0;
+		_aws_iot_shadow_replica_header(pReplica)->version = 0;
+		_aws_iot_shadow_replica_commit(pReplica);
+		pReplica->isResyncNeeded = false;
+	} else {
+		IOT_WARN("Shadow replica GET failed, retrying on the next sync");
+	}
+}
+
+IoT_Error_t aws_iot_shadow_replica_start(AWS_IoT_Client *pClient, IoT_Shadow_Replica_t *pReplica) {
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pReplica) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	snprintf(replicaDocumentsTopic, MAX_SHADOW_TOPIC_LENGTH_BYTES, "$aws/things/%s/shadow/update/documents",
+			 myThingName);
+	rc = aws_iot_mqtt_subscribe(pClient, replicaDocumentsTopic, (uint16_t) strlen(replicaDocumentsTopic), QOS1,
+								_aws_iot_shadow_replica_documents_callback, pReplica);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	rc = registerDeltaObserver(_aws_iot_shadow_replica_delta_observer, pReplica);
+
+	/* Updates made while the device was offline are only queued for a persistent session */
+	if(SUCCESS == rc && pClient->clientData.options.isCleanSession) {
+		pReplica->isResyncNeeded = true;
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_replica_sync(AWS_IoT_Client *pClient, IoT_Shadow_Replica_t *pReplica) {
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pReplica) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(!pReplica->isResyncNeeded || pReplica->isGetPending) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	rc = aws_iot_shadow_get(pClient, myThingName, _aws_iot_shadow_replica_get_callback, pReplica,
+							AWS_IOT_SHADOW_REPLICA_GET_TIMEOUT_SEC, false);
+	if(SUCCESS == rc) {
+		pReplica->isGetPending = true;
+		pReplica->stats.fullGets++;
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+void aws_iot_shadow_replica_request_resync(IoT_Shadow_Replica_t *pReplica) {
+	if(NULL != pReplica) {
+		pReplica->isResyncNeeded = true;
+	}
+}
+
+bool aws_iot_shadow_replica_is_synchronized(const IoT_Shadow_Replica_t *pReplica) {
+	return NULL != pReplica && !pReplica->isResyncNeeded && !pReplica->isGetPending;
+}
+
+uint32_t aws_iot_shadow_replica_get_version(const IoT_Shadow_Replica_t *pReplica) {
+	return _aws_iot_shadow_replica_header(pReplica)->version;
+}
+
+bool aws_iot_shadow_replica_get_value(const IoT_Shadow_Replica_t *pReplica, ShadowReplicaSection_t section,
+									  const char *pPath, const char **ppValue, size_t *pValueLen) {
+	ShadowReplicaRecord_t record;
+	uint32_t offset;
+
+	if(NULL == pReplica || NULL == pPath || NULL == ppValue) {
+		return false;
+	}
+
+	offset = _aws_iot_shadow_replica_find(pReplica, section, pPath, strlen(pPath));
+	if(SHADOW_REPLICA_NOT_FOUND == offset) {
+		return false;
+	}
+
+	_aws_iot_shadow_replica_read_record(pReplica, offset, &record);
+	*ppValue = record.pValue;
+	if(NULL != pValueLen) {
+		*pValueLen = record.valueLen;
+	}
+
+	return true;
+}
+
+void aws_iot_shadow_replica_get_stats(const IoT_Shadow_Replica_t *pReplica, IoT_Shadow_Replica_Stats_t *pStats) {
+	if(NULL != pReplica && NULL != pStats) {
+		*pStats = pReplica->stats;
+	}
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,1037 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_broker.c
+ * @brief Single process MQTT 3.1.1 broker stand-in for offline load tests
+ *
+ * Implements just enough of MQTT for the SDK: CONNECT, SUBSCRIBE, UNSUBSCRIBE, PUBLISH at
+ * QoS0 and QoS1, PINGREQ and DISCONNECT. There is no persistence, no retained messages and
+ * no session state. All connections are served from one thread using poll().
+ *
+ * Disconnects can be injected to exercise reconnect handling in the client:
+ *  -D <ms>  drop every connection periodically
+ *  -N <n>   drop a connection after it has sent n PUBLISH packets
+ *  SIGUSR1  drop every connection once
+ *
+ * With -Q <n> every connection may publish at most n messages per second, like the per
+ * connection limit of AWS IoT. The quota is granted in windows of BROKER_QUOTA_WINDOW_MS, a
+ * connection that used up its window is not read until the next one, so the client sees TCP
+ * backpressure instead of errors.
+ *
+ * With -S <ms> the broker also stands in for the shadow service: a publish on
+ * $aws/things/<thing>/shadow/get, update or delete is answered on its accepted topic after the
+ * given latency, with the client token of the request. The response does not hold a real
+ * shadow, it is there to measure how clients pipeline requests over a round trip.
+ *
+ * When built with BROKER_ENABLE_TLS the listener uses mbedTLS and requires the server
+ * certificate and key to be passed with -c and -k.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#ifdef BROKER_ENABLE_TLS
+#include "mbedtls/config.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/net.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+#endif
+
+#ifndef BROKER_MAX_CONNECTIONS
+#define BROKER_MAX_CONNECTIONS 1024
+#endif
+#define BROKER_MAX_SUBSCRIPTIONS 8 ///< Per connection
+#define BROKER_MAX_TOPIC_LEN 128
+#define BROKER_RX_BUF_LEN 4096 ///< Largest packet accepted from a client
+#define BROKER_TX_BUF_LEN 65536 ///< Outgoing bytes queued per connection before it is dropped as too slow
+#define BROKER_DEFAULT_PORT 1883
+#define BROKER_POLL_INTERVAL_MS 100
+#define BROKER_QUOTA_WINDOW_MS 100
+#define BROKER_MAX_SHADOW_RESPONSES 4096 ///< Shadow responses waiting for their latency to pass
+#define BROKER_MAX_SHADOW_PAYLOAD_LEN 192
+
+typedef struct {
+	char filter[BROKER_MAX_TOPIC_LEN + 1];
+	uint8_t qos;
+	bool inUse;
+} BrokerSubscription_t;
+
+typedef struct {
+	int fd;
+	bool isConnected; ///< CONNECT received
+	bool isClosing;
+	uint16_t nextPacketId;
+	uint32_t publishCount;
+	bool isThrottled; ///< Publish quota of the window used up
+	uint64_t quotaWindowStartMs;
+	uint32_t quotaUsed;
+	BrokerSubscription_t subscriptions[BROKER_MAX_SUBSCRIPTIONS];
+	unsigned char rxBuf[BROKER_RX_BUF_LEN];
+	size_t rxLen;
+	unsigned char txBuf[BROKER_TX_BUF_LEN];
+	size_t txLen;
+#ifdef BROKER_ENABLE_TLS
+	mbedtls_net_context net;
+	mbedtls_ssl_context ssl;
+	bool isHandshakeDone;
+#endif
+} BrokerConnection_t;
+
+typedef struct {
+	uint64_t connects;
+	uint64_t disconnects;
+	uint64_t injectedDrops;
+	uint64_t slowConsumerDrops;
+	uint64_t publishesIn;
+	uint64_t publishesOut;
+	uint64_t pings;
+	uint64_t throttles;
+	uint64_t shadowResponses;
+	uint64_t shadowResponsesDropped;
+} BrokerStats_t;
+
+typedef struct {
+	uint64_t dueMs;
+	char topic[BROKER_MAX_TOPIC_LEN + 1];
+	uint16_t topicLen;
+	char payload[BROKER_MAX_SHADOW_PAYLOAD_LEN];
+	size_t payloadLen;
+} BrokerShadowResponse_t;
+
+static BrokerConnection_t connections[BROKER_MAX_CONNECTIONS];
+static BrokerStats_t stats;
+static volatile sig_atomic_t terminate;
+static volatile sig_atomic_t dropAllRequested;
+static uint32_t dropAfterPublishes;
+static uint32_t publishesPerWindow; ///< 0 without a quota
+static uint32_t subscriptionCount; ///< Of all connections, publishes are not routed without any
+static bool isShadowServiceEnabled;
+static uint32_t shadowLatencyMs;
+/* The latency is the same for every response, so they are due in the order they were queued */
+static BrokerShadowResponse_t shadowResponses[BROKER_MAX_SHADOW_RESPONSES];
+static uint32_t shadowResponseHead;
+static uint32_t shadowResponseCount;
+
+#ifdef BROKER_ENABLE_TLS
+static mbedtls_entropy_context entropy;
+static mbedtls_ctr_drbg_context ctrDrbg;
+static mbedtls_ssl_config sslConf;
+static mbedtls_x509_crt serverCert;
+static mbedtls_pk_context serverKey;
+#endif
+
+static void aws_iot_broker_signal_handler(int signum) {
+	if(SIGUSR1 == signum) {
+		dropAllRequested = 1;
+	} else {
+		terminate = 1;
+	}
+}
+
+static uint64_t aws_iot_broker_now_ms(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t) now.tv_sec * 1000ULL) + ((uint64_t) now.tv_nsec / 1000000ULL);
+}
+
+/* Takes one publish from the quota of the connection, false if the window is used up */
+static bool aws_iot_broker_take_quota(BrokerConnection_t *pConn) {
+	uint64_t now;
+
+	if(0 == publishesPerWindow) {
+		return true;
+	}
+
+	now = aws_iot_broker_now_ms();
+	if(now >= pConn->quotaWindowStartMs + BROKER_QUOTA_WINDOW_MS) {
+		pConn->quotaWindowStartMs = now;
+		pConn->quotaUsed = 0;
+	}
+	if(publishesPerWindow <= pConn->quotaUsed) {
+		if(!pConn->isThrottled) {
+			pConn->isThrottled = true;
+			stats.throttles++;
+		}
+		return false;
+	}
+
+	pConn->quotaUsed++;
+	return true;
+}
+
+static ssize_t aws_iot_broker_recv(BrokerConnection_t *pConn, unsigned char *pBuf, size_t len) {
+#ifdef BROKER_ENABLE_TLS
+	int ret = mbedtls_ssl_read(&pConn->ssl, pBuf, len);
+	if(MBEDTLS_ERR_SSL_WANT_READ == ret || MBEDTLS_ERR_SSL_WANT_WRITE == ret) {
+		errno = EAGAIN;
+		return -1;
+	}
+	if(MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY == ret) {
+		return 0;
+	}
+	if(0 > ret) {
+		errno = EIO;
+		return -1;
+	}
+	return ret;
+#else
+	return recv(pConn->fd, pBuf, len, MSG_DONTWAIT);
+#endif
+}
+
+static ssize_t aws_iot_broker_send(BrokerConnection_t *pConn, const unsigned char *pBuf, size_t len) {
+#ifdef BROKER_ENABLE_TLS
+	int ret = mbedtls_ssl_write(&pConn->ssl, pBuf, len);
+	if(MBEDTLS_ERR_SSL_WANT_READ == ret || MBEDTLS_ERR_SSL_WANT_WRITE == ret) {
+		errno = EAGAIN;
+		return -1;
+	}
+	if(0 > ret) {
+		errno = EIO;
+		return -1;
+	}
+	return ret;
+#else
+	return send(pConn->fd, pBuf, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+#endif
+}
+
+static void aws_iot_broker_close(BrokerConnection_t *pConn) {
+	int s;
+
+	if(0 > pConn->fd) {
+		return;
+	}
+
+	for(s = 0; s < BROKER_MAX_SUBSCRIPTIONS; s++) {
+		if(pConn->subscriptions[s].inUse) {
+			pConn->subscriptions[s].inUse = false;
+			subscriptionCount--;
+		}
+	}
+
+#ifdef BROKER_ENABLE_TLS
+	mbedtls_ssl_free(&pConn->ssl);
+	mbedtls_net_free(&pConn->net);
+#else
+	close(pConn->fd);
+#endif
+	pConn->fd = -1;
+	stats.disconnects++;
+}
+
+static void aws_iot_broker_flush(BrokerConnection_t *pConn) {
+	ssize_t ret;
+
+	while(0 < pConn->txLen) {
+		ret = aws_iot_broker_send(pConn, pConn->txBuf, pConn->txLen);
+		if(0 < ret) {
+			memmove(pConn->txBuf, pConn->txBuf + ret, pConn->txLen - (size_t) ret);
+			pConn->txLen -= (size_t) ret;
+		} else if(0 > ret && (EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno)) {
+			return;
+		} else {
+			pConn->isClosing = true;
+			return;
+		}
+	}
+}
+
+static bool aws_iot_broker_queue(BrokerConnection_t *pConn, const unsigned char *pData, size_t len) {
+	if(len > BROKER_TX_BUF_LEN - pConn->txLen) {
+		/* The client does not read fast enough, drop it instead of buffering without bound */
+		stats.slowConsumerDrops++;
+		pConn->isClosing = true;
+		return false;
+	}
+
+	memcpy(pConn->txBuf + pConn->txLen, pData, len);
+	pConn->txLen += len;
+	return true;
+}
+
+static size_t aws_iot_broker_write_header(unsigned char *pBuf, unsigned char type, uint32_t remLen) {
+	size_t len = 0;
+	unsigned char digit;
+
+	pBuf[len++] = type;
+	do {
+		digit = (unsigned char) (remLen % 128);
+		remLen /= 128;
+		if(0 < remLen) {
+			digit |= 0x80;
+		}
+		pBuf[len++] = digit;
+	} while(0 < remLen);
+
+	return len;
+}
+
+static void aws_iot_broker_send_ack(BrokerConnection_t *pConn, unsigned char type, uint16_t packetId) {
+	unsigned char ack[4];
+
+	ack[0] = type;
+	ack[1] = 2;
+	ack[2] = (unsigned char) (packetId >> 8);
+	ack[3] = (unsigned char) (packetId & 0xFF);
+	(void) aws_iot_broker_queue(pConn, ack, sizeof(ack));
+}
+
+/* Same rules as the SDK: '+' matches one level, '#' matches the rest */
+static bool aws_iot_broker_topic_matches(const char *pFilter, const char *pTopic, size_t topicLen) {
+	const char *pTopicEnd = pTopic + topicLen;
+
+	while('\0' != *pFilter && pTopic < pTopicEnd) {
+		if('#' == *pFilter) {
+			return true;
+		} else if('+' == *pFilter) {
+			while(pTopic < pTopicEnd && '/' != *pTopic) {
+				pTopic++;
+			}
+			pFilter++;
+		} else {
+			if(*pFilter != *pTopic) {
+				return false;
+			}
+			pFilter++;
+			pTopic++;
+		}
+	}
+
+	if(pTopic == pTopicEnd) {
+		/* "a/#" also matches "a" */
+		if(0 == strcmp(pFilter, "/#") || 0 == strcmp(pFilter, "#")) {
+			return true;
+		}
+		return ('\0' == *pFilter);
+	}
+
+	return false;
+}
+
+static void aws_iot_broker_route(const char *pTopic, uint16_t topicLen, uint8_t qos, const unsigned char *pPayload,
+								 size_t payloadLen) {
+	unsigned char header[5];
+	unsigned char variable[2 + BROKER_MAX_TOPIC_LEN + 2];
+	size_t headerLen, variableLen;
+	uint8_t subQos, outQos;
+	int i, s;
+
+	if(0 == subscriptionCount) {
+		return;
+	}
+
+	for(i = 0; i < BROKER_MAX_CONNECTIONS; i++) {
+		BrokerConnection_t *pConn = &connections[i];
+
+		if(0 > pConn->fd || !pConn->isConnected || pConn->isClosing) {
+			continue;
+		}
+
+		/* Deliver at most once per connection, at the highest QoS of the matching filters */
+		subQos = 0xFF;
+		for(s = 0; s < BROKER_MAX_SUBSCRIPTIONS; s++) {
+			if(pConn->subscriptions[s].inUse &&
+			   aws_iot_broker_topic_matches(pConn->subscriptions[s].filter, pTopic, topicLen)) {
+				if(0xFF == subQos || pConn->subscriptions[s].qos > subQos) {
+					subQos = pConn->subscriptions[s].qos;
+				}
+			}
+		}
+		if(0xFF == subQos) {
+			continue;
+		}
+
+		outQos = (qos < subQos) ? qos : subQos;
+		variableLen = 0;
+		variable[variableLen++] = (unsigned char) (topicLen >> 8);
+		variable[variableLen++] = (unsigned char) (topicLen & 0xFF);
+		memcpy(&variable[variableLen], pTopic, topicLen);
+		variableLen += topicLen;
+		if(0 < outQos) {
+			pConn->nextPacketId = (uint16_t) ((0xFFFF == pConn->nextPacketId) ? 1 : pConn->nextPacketId + 1);
+			variable[variableLen++] = (unsigned char) (pConn->nextPacketId >> 8);
+			variable[variableLen++] = (unsigned char) (pConn->nextPacketId & 0xFF);
+		}
+
+		headerLen = aws_iot_broker_write_header(header, (unsigned char) (0x30 | (outQos << 1)),
+												(uint32_t) (variableLen + payloadLen));
+		if(aws_iot_broker_queue(pConn, header, headerLen) &&
+		   aws_iot_broker_queue(pConn, variable, variableLen) &&
+		   aws_iot_broker_queue(pConn, pPayload, payloadLen)) {
+			stats.publishesOut++;
+		}
+	}
+}
+
+/* Queues the accepted response to $aws/things/<thing>/shadow/<get|update|delete> */
+static void aws_iot_broker_shadow_request(const char *pTopic, uint16_t topicLen, const unsigned char *pPayload,
+										  size_t payloadLen) {
+	static const char prefix[] = "$aws/things/";
+	static const char tokenKey[] = "\"clientToken\":\"";
+	const char *pAction, *pToken = NULL, *pTokenEnd;
+	BrokerShadowResponse_t *pResponse;
+	size_t actionLen, i;
+	int len;
+
+	if(topicLen <= sizeof(prefix) - 1 || 0 != memcmp(pTopic, prefix, sizeof(prefix) - 1)) {
+		return;
+	}
+	pAction = memchr(pTopic + sizeof(prefix) - 1, '/', topicLen - (sizeof(prefix) - 1));
+	if(NULL == pAction || (size_t) (pTopic + topicLen - pAction) < sizeof("/shadow/") ||
+	   0 != memcmp(pAction, "/shadow/", sizeof("/shadow/") - 1)) {
+		return;
+	}
+	pAction += sizeof("/shadow/") - 1;
+	actionLen = (size_t) (pTopic + topicLen - pAction);
+	if(!((3 == actionLen && 0 == memcmp(pAction, "get", 3)) ||
+		 (6 == actionLen && 0 == memcmp(pAction, "update", 6)) ||
+		 (6 == actionLen && 0 == memcmp(pAction, "delete", 6)))) {
+		return;
+	}
+
+	if(BROKER_MAX_SHADOW_RESPONSES <= shadowResponseCount ||
+	   BROKER_MAX_TOPIC_LEN < topicLen + sizeof("/accepted") - 1) {
+		stats.shadowResponsesDropped++;
+		return;
+	}
+
+	for(i = 0; i + sizeof(tokenKey) - 1 <= payloadLen; i++) {
+		if(0 == memcmp(pPayload + i, tokenKey, sizeof(tokenKey) - 1)) {
+			pToken = (const char *) pPayload + i + sizeof(tokenKey) - 1;
+			break;
+		}
+	}
+
+	pResponse = &shadowResponses[(shadowResponseHead + shadowResponseCount) % BROKER_MAX_SHADOW_RESPONSES];
+	pResponse->dueMs = aws_iot_broker_now_ms() + shadowLatencyMs;
+	memcpy(pResponse->topic, pTopic, topicLen);
+	memcpy(pResponse->topic + topicLen, "/accepted", sizeof("/accepted"));
+	pResponse->topicLen = (uint16_t) (topicLen + sizeof("/accepted") - 1);
+
+	if(NULL != pToken) {
+		pTokenEnd = memchr(pToken, '"', (size_t) ((const char *) pPayload + payloadLen - pToken));
+		if(NULL == pTokenEnd) {
+			pToken = NULL;
+		} else {
+			len = snprintf(pResponse->payload, sizeof(pResponse->payload),
+						   "{\"state\":{},\"version\":1,\"timestamp\":%llu,\"clientToken\":\"%.*s\"}",
+						   (unsigned long long) (pResponse->dueMs / 1000), (int) (pTokenEnd - pToken), pToken);
+		}
+	}
+	if(NULL == pToken) {
+		len = snprintf(pResponse->payload, sizeof(pResponse->payload),
+					   "{\"state\":{},\"version\":1,\"timestamp\":%llu}",
+					   (unsigned long long) (pResponse->dueMs / 1000));
+	}
+	if(0 > len || sizeof(pResponse->payload) <= (size_t) len) {
+		stats.shadowResponsesDropped++;
+		return;
+	}
+	pResponse->payloadLen = (size_t) len;
+	shadowResponseCount++;
+}
+
+/* Routes the shadow responses whose latency has passed, returns the ms until the next one is due */
+static int aws_iot_broker_shadow_respond(int pollTimeoutMs) {
+	BrokerShadowResponse_t *pResponse;
+	uint64_t now = aws_iot_broker_now_ms();
+
+	while(0 < shadowResponseCount) {
+		pResponse = &shadowResponses[shadowResponseHead];
+		if(pResponse->dueMs > now) {
+			if((uint64_t) pollTimeoutMs > pResponse->dueMs - now) {
+				pollTimeoutMs = (int) (pResponse->dueMs - now);
+			}
+			break;
+		}
+		aws_iot_broker_route(pResponse->topic, pResponse->topicLen, 0, (const unsigned char *) pResponse->payload,
+							 pResponse->payloadLen);
+		stats.shadowResponses++;
+		shadowResponseHead = (shadowResponseHead + 1) % BROKER_MAX_SHADOW_RESPONSES;
+		shadowResponseCount--;
+	}
+
+	return pollTimeoutMs;
+}
+
+static uint16_t aws_iot_broker_read_uint16(const unsigned char *pBuf) {
+	return (uint16_t) ((pBuf[0] << 8) | pBuf[1]);
+}
+
+static bool aws_iot_broker_handle_subscribe(BrokerConnection_t *pConn, const unsigned char *pData, size_t len) {
+	unsigned char suback[4 + BROKER_MAX_SUBSCRIPTIONS];
+	size_t pos = 2, ackLen = 0, filterLen;
+	uint16_t packetId;
+	uint8_t granted;
+	int s, freeSlot;
+
+	if(2 > len) {
+		return false;
+	}
+	packetId = aws_iot_broker_read_uint16(pData);
+
+	while(pos + 2 < len && ackLen < BROKER_MAX_SUBSCRIPTIONS) {
+		filterLen = aws_iot_broker_read_uint16(pData + pos);
+		pos += 2;
+		if(pos + filterLen + 1 > len) {
+			return false;
+		}
+
+		granted = 0x80;
+		if(BROKER_MAX_TOPIC_LEN >= filterLen) {
+			freeSlot = -1;
+			for(s = 0; s < BROKER_MAX_SUBSCRIPTIONS; s++) {
+				if(pConn->subscriptions[s].inUse &&
+				   filterLen == strlen(pConn->subscriptions[s].filter) &&
+				   0 == memcmp(pConn->subscriptions[s].filter, pData + pos, filterLen)) {
+					freeSlot = s;
+					break;
+				}
+				if(!pConn->subscriptions[s].inUse && 0 > freeSlot) {
+					freeSlot = s;
+				}
+			}
+			if(0 <= freeSlot) {
+				BrokerSubscription_t *pSub = &pConn->subscriptions[freeSlot];
+				memcpy(pSub->filter, pData + pos, filterLen);
+				pSub->filter[filterLen] = '\0';
+				pSub->qos = (pData[pos + filterLen] & 0x03) ? 1 : 0;
+				if(!pSub->inUse) {
+					pSub->inUse = true;
+					subscriptionCount++;
+				}
+				granted = pSub->qos;
+			}
+		}
+
+		suback[4 + ackLen++] = granted;
+		pos += filterLen + 1;
+	}
+
+	suback[0] = 0x90;
+	suback[1] = (unsigned char) (2 + ackLen);
+	suback[2] = (unsigned char) (packetId >> 8);
+	suback[3] = (unsigned char) (packetId & 0xFF);
+	return aws_iot_broker_queue(pConn, suback, 4 + ackLen);
+}
+
+static bool aws_iot_broker_handle_unsubscribe(BrokerConnection_t *pConn, const unsigned char *pData, size_t len) {
+	size_t pos = 2, filterLen;
+	int s;
+
+	if(2 > len) {
+		return false;
+	}
+
+	while(pos + 2 <= len) {
+		filterLen = aws_iot_broker_read_uint16(pData + pos);
+		pos += 2;
+		if(pos + filterLen > len) {
+			return false;
+		}
+		for(s = 0; s < BROKER_MAX_SUBSCRIPTIONS; s++) {
+			if(pConn->subscriptions[s].inUse &&
+			   filterLen == strlen(pConn->subscriptions[s].filter) &&
+			   0 == memcmp(pConn->subscriptions[s].filter, pData + pos, filterLen)) {
+				pConn->subscriptions[s].inUse = false;
+				subscriptionCount--;
+			}
+		}
+		pos += filterLen;
+	}
+
+	aws_iot_broker_send_ack(pConn, 0xB0, aws_iot_broker_read_uint16(pData));
+	return true;
+}
+
+static bool aws_iot_broker_handle_publish(BrokerConnection_t *pConn, unsigned char flags,
+										  const unsigned char *pData, size_t len) {
+	uint8_t qos = (uint8_t) ((flags >> 1) & 0x03);
+	size_t pos = 2;
+	uint16_t topicLen, packetId = 0;
+
+	if(2 > len || 1 < qos) {
+		/* QoS2 is not supported by the SDK either */
+		return false;
+	}
+
+	topicLen = aws_iot_broker_read_uint16(pData);
+	if(BROKER_MAX_TOPIC_LEN < topicLen || pos + topicLen > len) {
+		return false;
+	}
+	pos += topicLen;
+
+	if(0 < qos) {
+		if(pos + 2 > len) {
+			return false;
+		}
+		packetId = aws_iot_broker_read_uint16(pData + pos);
+		pos += 2;
+		aws_iot_broker_send_ack(pConn, 0x40, packetId);
+	}
+
+	stats.publishesIn++;
+	aws_iot_broker_route((const char *) pData + 2, topicLen, qos, pData + pos, len - pos);
+	if(isShadowServiceEnabled) {
+		aws_iot_broker_shadow_request((const char *) pData + 2, topicLen, pData + pos, len - pos);
+	}
+
+	pConn->publishCount++;
+	if(0 < dropAfterPublishes && 0 == (pConn->publishCount % dropAfterPublishes)) {
+		stats.injectedDrops++;
+		pConn->isClosing = true;
+	}
+
+	return true;
+}
+
+static bool aws_iot_broker_handle_packet(BrokerConnection_t *pConn, unsigned char header, const unsigned char *pData,
+										 size_t len) {
+	const unsigned char connack[] = {0x20, 0x02, 0x00, 0x00};
+	const unsigned char pingresp[] = {0xD0, 0x00};
+	unsigned char type = (unsigned char) (header >> 4);
+
+	if(!pConn->isConnected && 1 != type) {
+		return false;
+	}
+
+	switch(type) {
+		case 1: /* CONNECT */
+			if(pConn->isConnected) {
+				return false;
+			}
+			pConn->isConnected = true;
+			stats.connects++;
+			return aws_iot_broker_queue(pConn, connack, sizeof(connack));
+		case 3: /* PUBLISH */
+			return aws_iot_broker_handle_publish(pConn, (unsigned char) (header & 0x0F), pData, len);
+		case 4: /* PUBACK, nothing is retransmitted so there is nothing to release */
+			return true;
+		case 8: /* SUBSCRIBE */
+			return aws_iot_broker_handle_subscribe(pConn, pData, len);
+		case 10: /* UNSUBSCRIBE */
+			return aws_iot_broker_handle_unsubscribe(pConn, pData, len);
+		case 12: /* PINGREQ */
+			stats.pings++;
+			return aws_iot_broker_queue(pConn, pingresp, sizeof(pingresp));
+		case 14: /* DISCONNECT */
+		default:
+			return false;
+	}
+}
+
+static void aws_iot_broker_process_rx(BrokerConnection_t *pConn) {
+	size_t pos, consumed = 0;
+	uint32_t remLen, multiplier;
+	size_t headerLen;
+
+	for(;;) {
+		pos = consumed;
+		if(pConn->rxLen - pos < 2) {
+			break;
+		}
+
+		remLen = 0;
+		multiplier = 1;
+		headerLen = 1;
+		do {
+			if(pos + headerLen >= pConn->rxLen) {
+				goto incomplete;
+			}
+			if(4 < headerLen) {
+				pConn->isClosing = true;
+				return;
+			}
+			remLen += (pConn->rxBuf[pos + headerLen] & 127) * multiplier;
+			multiplier *= 128;
+		} while(0 != (pConn->rxBuf[pos + headerLen++] & 128));
+
+		if(BROKER_RX_BUF_LEN < headerLen + remLen) {
+			pConn->isClosing = true;
+			return;
+		}
+		if(pConn->rxLen - pos < headerLen + remLen) {
+			break;
+		}
+		if(3 == (pConn->rxBuf[pos] >> 4) && pConn->isConnected && !aws_iot_broker_take_quota(pConn)) {
+			/* Left in the buffer until the next window */
+			break;
+		}
+
+		if(!aws_iot_broker_handle_packet(pConn, pConn->rxBuf[pos], &pConn->rxBuf[pos + headerLen], remLen)) {
+			pConn->isClosing = true;
+			return;
+		}
+		consumed += headerLen + remLen;
+		if(pConn->isClosing) {
+			return;
+		}
+	}
+
+incomplete:
+	if(0 < consumed) {
+		memmove(pConn->rxBuf, pConn->rxBuf + consumed, pConn->rxLen - consumed);
+		pConn->rxLen -= consumed;
+	}
+}
+
+static void aws_iot_broker_read(BrokerConnection_t *pConn) {
+	ssize_t ret;
+
+	for(;;) {
+#ifdef BROKER_ENABLE_TLS
+		if(!pConn->isHandshakeDone) {
+			int hs = mbedtls_ssl_handshake(&pConn->ssl);
+			if(0 == hs) {
+				pConn->isHandshakeDone = true;
+			} else {
+				if(MBEDTLS_ERR_SSL_WANT_READ != hs && MBEDTLS_ERR_SSL_WANT_WRITE != hs) {
+					pConn->isClosing = true;
+				}
+				return;
+			}
+		}
+#endif
+		if(pConn->isThrottled) {
+			/* The buffer may be full, recv would then look like a closed connection */
+			return;
+		}
+		ret = aws_iot_broker_recv(pConn, pConn->rxBuf + pConn->rxLen, BROKER_RX_BUF_LEN - pConn->rxLen);
+		if(0 < ret) {
+			pConn->rxLen += (size_t) ret;
+			aws_iot_broker_process_rx(pConn);
+			if(pConn->isClosing) {
+				return;
+			}
+		} else if(0 > ret && (EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno)) {
+			return;
+		} else {
+			pConn->isClosing = true;
+			return;
+		}
+	}
+}
+
+static void aws_iot_broker_accept(int listenFd) {
+	BrokerConnection_t *pConn = NULL;
+	int fd, i, flag = 1;
+
+	for(;;) {
+		fd = accept(listenFd, NULL, NULL);
+		if(0 > fd) {
+			return;
+		}
+
+		for(i = 0; i < BROKER_MAX_CONNECTIONS; i++) {
+			if(0 > connections[i].fd) {
+				pConn = &connections[i];
+				break;
+			}
+		}
+		if(NULL == pConn) {
+			close(fd);
+			continue;
+		}
+
+		(void) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+		(void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+		memset(pConn, 0, sizeof(*pConn));
+		pConn->fd = fd;
+#ifdef BROKER_ENABLE_TLS
+		mbedtls_net_init(&pConn->net);
+		pConn->net.fd = fd;
+		mbedtls_ssl_init(&pConn->ssl);
+		if(0 != mbedtls_ssl_setup(&pConn->ssl, &sslConf)) {
+			aws_iot_broker_close(pConn);
+			continue;
+		}
+		mbedtls_ssl_set_bio(&pConn->ssl, &pConn->net, mbedtls_net_send, mbedtls_net_recv, NULL);
+#endif
+		pConn = NULL;
+	}
+}
+
+static void aws_iot_broker_drop_all(void) {
+	int i;
+
+	for(i = 0; i < BROKER_MAX_CONNECTIONS; i++) {
+		if(0 <= connections[i].fd) {
+			stats.injectedDrops++;
+			aws_iot_broker_close(&connections[i]);
+		}
+	}
+}
+
+#ifdef BROKER_ENABLE_TLS
+static int aws_iot_broker_tls_init(const char *pCertFile, const char *pKeyFile) {
+	const char *pers = "aws_iot_benchmark_broker";
+
+	if(NULL == pCertFile || NULL == pKeyFile) {
+		printf("TLS requires -c <server cert> and -k <server key>\n");
+		return -1;
+	}
+
+	mbedtls_entropy_init(&entropy);
+	mbedtls_ctr_drbg_init(&ctrDrbg);
+	mbedtls_ssl_config_init(&sslConf);
+	mbedtls_x509_crt_init(&serverCert);
+	mbedtls_pk_init(&serverKey);
+
+	if(0 != mbedtls_ctr_drbg_seed(&ctrDrbg, mbedtls_entropy_func, &entropy, (const unsigned char *) pers,
+								  strlen(pers)) ||
+	   0 != mbedtls_x509_crt_parse_file(&serverCert, pCertFile) ||
+	   0 != mbedtls_pk_parse_keyfile(&serverKey, pKeyFile, "") ||
+	   0 != mbedtls_ssl_config_defaults(&sslConf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM,
+										MBEDTLS_SSL_PRESET_DEFAULT)) {
+		printf("Failed to set up TLS\n");
+		return -1;
+	}
+
+	mbedtls_ssl_conf_rng(&sslConf, mbedtls_ctr_drbg_random, &ctrDrbg);
+	/* Clients present a certificate but it is not checked, this is not a security boundary */
+	mbedtls_ssl_conf_authmode(&sslConf, MBEDTLS_SSL_VERIFY_NONE);
+	if(0 != mbedtls_ssl_conf_own_cert(&sslConf, &serverCert, &serverKey)) {
+		printf("Failed to load the server certificate\n");
+		return -1;
+	}
+
+	return 0;
+}
+#endif
+
+static void aws_iot_broker_usage(const char *pName) {
+	printf("Usage: %s [-p port] [-D drop_interval_ms] [-N drop_after_publishes] [-Q publishes_per_second] [-S shadow_latency_ms]", pName);
+#ifdef BROKER_ENABLE_TLS
+	printf(" -c server_cert -k server_key");
+#endif
+	printf("\n");
+}
+
+int main(int argc, char **argv) {
+	struct pollfd pfds[BROKER_MAX_CONNECTIONS + 1];
+	int connIndex[BROKER_MAX_CONNECTIONS + 1];
+	struct sockaddr_in addr;
+	uint16_t port = BROKER_DEFAULT_PORT;
+	uint32_t dropIntervalMs = 0;
+	uint64_t nextDropMs = 0;
+	uint64_t now, windowEndMs;
+	uint32_t publishesPerSecond = 0;
+	int pollTimeoutMs;
+	const char *pCertFile = NULL;
+	const char *pKeyFile = NULL;
+	int listenFd, opt, nfds, i, flag = 1;
+
+	while(-1 != (opt = getopt(argc, argv, "p:D:N:Q:S:c:k:h"))) {
+		switch(opt) {
+			case 'p':
+				port = (uint16_t) atoi(optarg);
+				break;
+			case 'D':
+				dropIntervalMs = (uint32_t) atoi(optarg);
+				break;
+			case 'N':
+				dropAfterPublishes = (uint32_t) atoi(optarg);
+				break;
+			case 'Q':
+				publishesPerSecond = (uint32_t) atoi(optarg);
+				break;
+			case 'S':
+				isShadowServiceEnabled = true;
+				shadowLatencyMs = (uint32_t) atoi(optarg);
+				break;
+			case 'c':
+				pCertFile = optarg;
+				break;
+			case 'k':
+				pKeyFile = optarg;
+				break;
+			default:
+				aws_iot_broker_usage(argv[0]);
+				return 1;
+		}
+	}
+
+#ifdef BROKER_ENABLE_TLS
+	if(0 != aws_iot_broker_tls_init(pCertFile, pKeyFile)) {
+		return 1;
+	}
+#else
+	(void) pCertFile;
+	(void) pKeyFile;
+#endif
+
+	if(0 < publishesPerSecond) {
+		publishesPerWindow = publishesPerSecond * BROKER_QUOTA_WINDOW_MS / 1000;
+		if(0 == publishesPerWindow) {
+			publishesPerWindow = 1;
+		}
+	}
+
+	for(i = 0; i < BROKER_MAX_CONNECTIONS; i++) {
+		connections[i].fd = -1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, aws_iot_broker_signal_handler);
+	signal(SIGTERM, aws_iot_broker_signal_handler);
+	signal(SIGUSR1, aws_iot_broker_signal_handler);
+
+	listenFd = socket(AF_INET, SOCK_STREAM, 0);
+	if(0 > listenFd) {
+		perror("socket");
+		return 1;
+	}
+	(void) setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(port);
+	if(0 != bind(listenFd, (struct sockaddr *) &addr, sizeof(addr)) || 0 != listen(listenFd, 64)) {
+		perror("bind/listen");
+		return 1;
+	}
+	(void) fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL, 0) | O_NONBLOCK);
+
+	printf("Benchmark broker listening on port %u%s\n", port,
+#ifdef BROKER_ENABLE_TLS
+		   " (TLS)"
+#else
+		   ""
+#endif
+	);
+	fflush(stdout);
+
+	if(0 < dropIntervalMs) {
+		nextDropMs = aws_iot_broker_now_ms() + dropIntervalMs;
+	}
+
+	while(!terminate) {
+		nfds = 0;
+		pfds[nfds].fd = listenFd;
+		pfds[nfds].events = POLLIN;
+		connIndex[nfds++] = -1;
+		pollTimeoutMs = BROKER_POLL_INTERVAL_MS;
+		if(isShadowServiceEnabled) {
+			/* Before the connections are polled, so the responses are written once they are writable */
+			pollTimeoutMs = aws_iot_broker_shadow_respond(pollTimeoutMs);
+		}
+		now = aws_iot_broker_now_ms();
+		for(i = 0; i < BROKER_MAX_CONNECTIONS; i++) {
+			if(0 <= connections[i].fd) {
+				pfds[nfds].fd = connections[i].fd;
+				pfds[nfds].events = (short) ((connections[i].isThrottled ? 0 : POLLIN) |
+											 ((0 < connections[i].txLen) ? POLLOUT : 0));
+				connIndex[nfds++] = i;
+				if(connections[i].isThrottled) {
+					/* Wake up when the next window opens */
+					windowEndMs = connections[i].quotaWindowStartMs + BROKER_QUOTA_WINDOW_MS;
+					if(windowEndMs <= now) {
+						pollTimeoutMs = 0;
+					} else if((uint64_t) pollTimeoutMs > windowEndMs - now) {
+						pollTimeoutMs = (int) (windowEndMs - now);
+					}
+				}
+			}
+		}
+
+		if(0 > poll(pfds, (nfds_t) nfds, pollTimeoutMs) && EINTR != errno) {
+			perror("poll");
+			break;
+		}
+
+		for(i = 0; i < nfds; i++) {
+			if(0 == pfds[i].revents) {
+				continue;
+			}
+			if(0 > connIndex[i]) {
+				aws_iot_broker_accept(listenFd);
+				continue;
+			}
+			if(connections[connIndex[i]].isThrottled && (pfds[i].revents & (POLLHUP | POLLERR))) {
+				/* Not read while throttled, the client is gone so its pending publishes are dropped */
+				connections[connIndex[i]].isClosing = true;
+			} else if(pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+				aws_iot_broker_read(&connections[connIndex[i]]);
+			}
+		}
+
+		/* Publishes left in the buffer of a throttled connection are handled once the window opens */
+		now = aws_iot_broker_now_ms();
+		for(i = 0; i < BROKER_MAX_CONNECTIONS; i++) {
+			if(0 <= connections[i].fd && connections[i].isThrottled &&
+			   now >= connections[i].quotaWindowStartMs + BROKER_QUOTA_WINDOW_MS) {
+				connections[i].isThrottled = false;
+				aws_iot_broker_process_rx(&connections[i]);
+			}
+		}
+
+		if(isShadowServiceEnabled) {
+			(void) aws_iot_broker_shadow_respond(0);
+		}
+
+		/* Publishes are routed while reading, so flush every connection afterwards */
+		for(i = 0; i < BROKER_MAX_CONNECTIONS; i++) {
+			if(0 <= connections[i].fd) {
+				aws_iot_broker_flush(&connections[i]);
+				if(connections[i].isClosing) {
+					aws_iot_broker_close(&connections[i]);
+				}
+			}
+		}
+
+		if(dropAllRequested || (0 < dropIntervalMs && aws_iot_broker_now_ms() >= nextDropMs)) {
+			dropAllRequested = 0;
+			aws_iot_broker_drop_all();
+			nextDropMs = aws_iot_broker_now_ms() + dropIntervalMs;
+		}
+	}
+
+	for(i = 0; i < BROKER_MAX_CONNECTIONS; i++) {
+		aws_iot_broker_close(&connections[i]);
+	}
+	close(listenFd);
+
+	printf("connects: %llu, disconnects: %llu, injected drops: %llu, slow consumer drops: %llu\n",
+		   (unsigned long long) stats.connects, (unsigned long long) stats.disconnects,
+		   (unsigned long long) stats.injectedDrops, (unsigned long long) stats.slowConsumerDrops);
+	printf("publishes in: %llu, publishes out: %llu, pings: %llu, throttles: %llu\n",
+		   (unsigned long long) stats.publishesIn, (unsigned long long) stats.publishesOut,
+		   (unsigned long long) stats.pings, (unsigned long long) stats.throttles);
+	if(isShadowServiceEnabled) {
+		printf("shadow responses: %llu, dropped: %llu\n", (unsigned long long) stats.shadowResponses,
+			   (unsigned long long) stats.shadowResponsesDropped);
+	}
+
+	return 0;
+}
@@ -0,0 +1,144 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_harness.h
+ * @brief Timing and reporting harness shared by the benchmarks
+ *
+ * Each benchmark is a function that performs the measured operation a given number of
+ * times. The harness calibrates the iteration count until a run takes at least
+ * BENCHMARK_MIN_RUN_TIME_NS, repeats the run BENCHMARK_REPETITIONS times and reports the
+ * median time per operation together with the number of heap allocations per operation.
+ * Results are printed as a table and, if an output file was given, written as JSON.
+ *
+ * Allocations are counted by wrapping malloc, calloc, realloc and free at link time
+ * (-Wl,--wrap=...), so only calls made from the statically linked SDK code are counted.
+ */
+
+#ifndef AWS_IOT_BENCHMARK_HARNESS_H_
+#define AWS_IOT_BENCHMARK_HARNESS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef BENCHMARK_MIN_RUN_TIME_NS
+#define BENCHMARK_MIN_RUN_TIME_NS 50000000ULL ///< Minimum duration of one calibrated run
+#endif
+
+#ifndef BENCHMARK_REPETITIONS
+#define BENCHMARK_REPETITIONS 5 ///< Number of calibrated runs, the median is reported
+#endif
+
+#define BENCHMARK_MAX_RESULTS 64 ///< Maximum number of results per benchmark binary
+
+/**
+ * @brief Benchmark body
+ *
+ * Performs the measured operation iterations times. Returns 0 on success, any other
+ * value aborts the benchmark and marks the suite as failed.
+ */
+typedef int (*BenchmarkFunction_t)(void *pContext, uint32_t iterations);
+
+/**
+ * @brief Start a benchmark suite
+ *
+ * Recognized arguments: "-o <file>" writes the results as JSON to file and
+ * "-f <text>" only runs benchmarks whose name contains text.
+ *
+ * @param pSuiteName Name of the suite, used in the output
+ * @param argc Argument count from main
+ * @param argv Arguments from main
+ */
+void aws_iot_benchmark_init(const char *pSuiteName, int argc, char **argv);
+
+/**
+ * @brief Calibrate, run and record a benchmark
+ *
+ * @param pName Name of the benchmark
+ * @param function Benchmark body
+ * @param pContext Passed through to function
+ *
+ * @return 0 on success or if the benchmark was filtered out
+ */
+int aws_iot_benchmark_run(const char *pName, BenchmarkFunction_t function, void *pContext);
+
+/**
+ * @brief Record a result measured by the caller
+ *
+ * For benchmarks that drive their own loop, e.g. until a number of messages were delivered.
+ *
+ * @param pName Name of the benchmark
+ * @param operations Number of operations performed
+ * @param elapsedNs Total time in nanoseconds
+ * @param allocations Number of allocations made during the run
+ */
+void aws_iot_benchmark_record(const char *pName, uint64_t operations, uint64_t elapsedNs, uint64_t allocations);
+
+/**
+ * @brief Record a throughput result together with a latency distribution
+ *
+ * Reports the 50th, 99th and 99.9th percentile of the samples next to the time per operation.
+ * The samples are sorted in place.
+ *
+ * @param pName Name of the benchmark
+ * @param operations Number of operations performed
+ * @param elapsedNs Total time in nanoseconds
+ * @param pSamples Latency samples in nanoseconds
+ * @param sampleCount Number of samples
+ */
+void aws_iot_benchmark_record_latency(const char *pName, uint64_t operations, uint64_t elapsedNs,
+									  uint64_t *pSamples, uint32_t sampleCount);
+
+/**
+ * @brief Record a value that is not a time per operation
+ *
+ * For simulations that report e.g. a recovery time or a number of lost messages.
+ *
+ * @param pName Name of the metric
+ * @param pUnit Unit of value, e.g. "ms" or "messages"
+ * @param value Measured value
+ */
+void aws_iot_benchmark_record_metric(const char *pName, const char *pUnit, double value);
+
+/**
+ * @brief Whether a benchmark is selected by the "-f" filter
+ */
+int aws_iot_benchmark_is_selected(const char *pName);
+
+/**
+ * @brief Monotonic time in nanoseconds
+ */
+uint64_t aws_iot_benchmark_now_ns(void);
+
+/**
+ * @brief Number of allocations made so far
+ */
+uint64_t aws_iot_benchmark_allocation_count(void);
+
+/**
+ * @brief Write the JSON output and end the suite
+ *
+ * @return 0 if every benchmark succeeded and the output could be written
+ */
+int aws_iot_benchmark_finish(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_BENCHMARK_HARNESS_H_ */
@@ -0,0 +1,68 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_virtual_clock.h
+ * @brief Virtual clock for simulations
+ *
+ * A clock that only moves when it is advanced. Fault schedules are expressed in virtual
+ * time so that a simulation runs the same way on every machine, and layers that simulate
+ * waiting (latency, limited bandwidth) advance the clock instead of sleeping.
+ * The clock can be read and advanced from several threads.
+ */
+
+#ifndef AWS_IOT_BENCHMARK_VIRTUAL_CLOCK_H_
+#define AWS_IOT_BENCHMARK_VIRTUAL_CLOCK_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Set the clock back to 0
+ */
+void aws_iot_benchmark_virtual_clock_reset(void);
+
+/**
+ * @brief Current virtual time in microseconds
+ */
+uint64_t aws_iot_benchmark_virtual_clock_now_us(void);
+
+/**
+ * @brief Current virtual time in milliseconds
+ */
+uint64_t aws_iot_benchmark_virtual_clock_now_ms(void);
+
+/**
+ * @brief Move the clock forward
+ *
+ * @param us Number of microseconds to advance
+ */
+void aws_iot_benchmark_virtual_clock_advance_us(uint64_t us);
+
+/**
+ * @brief Move the clock forward
+ *
+ * @param ms Number of milliseconds to advance
+ */
+void aws_iot_benchmark_virtual_clock_advance_ms(uint32_t ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_BENCHMARK_VIRTUAL_CLOCK_H_ */
@@ -0,0 +1,272 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_network_fault.c
+ * @brief Fault injecting decorator for the network interface
+ */
+
+#include <stddef.h>
+
+#include "aws_iot_error.h"
+#include "aws_iot_benchmark_network_fault.h"
+#include "aws_iot_benchmark_virtual_clock.h"
+
+/* The network callbacks only receive the Network, so wrapped networks are looked up here */
+static FaultNetwork_t *wrappedNetworks[BENCHMARK_FAULT_MAX_NETWORKS];
+
+static FaultNetwork_t *aws_iot_benchmark_network_fault_find(Network *pNetwork) {
+	uint32_t i;
+
+	for(i = 0; i < BENCHMARK_FAULT_MAX_NETWORKS; i++) {
+		if(NULL != wrappedNetworks[i] && pNetwork == wrappedNetworks[i]->pNetwork) {
+			return wrappedNetworks[i];
+		}
+	}
+
+	return NULL;
+}
+
+bool aws_iot_benchmark_network_fault_is_active(const FaultNetwork_t *pFault, FaultType_t type, uint32_t *pParam) {
+	uint64_t now = aws_iot_benchmark_virtual_clock_now_ms();
+	uint32_t i;
+
+	for(i = 0; i < pFault->eventCount; i++) {
+		const FaultEvent_t *pEvent = &pFault->pSchedule[i];
+		if(type == pEvent->type && now >= pEvent->startMs && now - pEvent->startMs < pEvent->durationMs) {
+			if(NULL != pParam) {
+				*pParam = pEvent->param;
+			}
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool aws_iot_benchmark_network_fault_check_drop(FaultNetwork_t *pFault) {
+	if(!pFault->isReset && aws_iot_benchmark_network_fault_is_active(pFault, FAULT_DROP, NULL)) {
+		pFault->isReset = true;
+		pFault->stats.drops++;
+	}
+
+	return pFault->isReset;
+}
+
+static size_t aws_iot_benchmark_network_fault_limit(FaultNetwork_t *pFault, size_t len, uint32_t *pCounter) {
+	uint32_t maxLen;
+
+	if(aws_iot_benchmark_network_fault_is_active(pFault, FAULT_PARTIAL_IO, &maxLen) && 0 < maxLen && len > maxLen) {
+		(*pCounter)++;
+		return maxLen;
+	}
+
+	return len;
+}
+
+static void aws_iot_benchmark_network_fault_delay(FaultNetwork_t *pFault, size_t transferred, bool isRead) {
+	uint32_t param;
+	uint64_t delayUs = 0;
+	uint64_t scaled;
+
+	if(0 == transferred) {
+		return;
+	}
+
+	if(isRead && aws_iot_benchmark_network_fault_is_active(pFault, FAULT_LATENCY, &param)) {
+		delayUs += (uint64_t) param * 1000;
+	}
+
+	if(aws_iot_benchmark_network_fault_is_active(pFault, FAULT_BANDWIDTH, &param) && 0 < param) {
+		scaled = ((uint64_t) transferred * 1000000) + pFault->bandwidthRemainderUs;
+		delayUs += scaled / param;
+		pFault->bandwidthRemainderUs = scaled % param;
+	}
+
+	if(0 < delayUs) {
+		pFault->stats.delayUs += delayUs;
+		aws_iot_benchmark_virtual_clock_advance_us(delayUs);
+	}
+}
+
+static IoT_Error_t aws_iot_benchmark_network_fault_connect(Network *pNetwork, TLSConnectParams *params) {
+	FaultNetwork_t *pFault = aws_iot_benchmark_network_fault_find(pNetwork);
+
+	if(NULL == pFault) {
+		return NULL_VALUE_ERROR;
+	}
+
+	if(aws_iot_benchmark_network_fault_is_active(pFault, FAULT_DROP, NULL)) {
+		pFault->stats.failedConnects++;
+		return NETWORK_ERR_NET_CONNECT_FAILED;
+	}
+
+	pFault->isReset = false;
+	return pFault->connect(pNetwork, params);
+}
+
+static IoT_Error_t aws_iot_benchmark_network_fault_read(Network *pNetwork, unsigned char *pMsg, size_t len,
+														Timer *pTimer, size_t *read_len) {
+	FaultNetwork_t *pFault = aws_iot_benchmark_network_fault_find(pNetwork);
+	size_t allowed;
+	IoT_Error_t rc;
+
+	*read_len = 0;
+	if(NULL == pFault) {
+		return NULL_VALUE_ERROR;
+	}
+
+	if(aws_iot_benchmark_network_fault_check_drop(pFault)) {
+		return NETWORK_SSL_READ_ERROR;
+	}
+
+	if(aws_iot_benchmark_network_fault_is_active(pFault, FAULT_STALL, NULL)) {
+		pFault->stats.stalledReads++;
+		return NETWORK_SSL_NOTHING_TO_READ;
+	}
+
+	allowed = aws_iot_benchmark_network_fault_limit(pFault, len, &pFault->stats.partialReads);
+	rc = pFault->read(pNetwork, pMsg, allowed, pTimer, read_len);
+	aws_iot_benchmark_network_fault_delay(pFault, *read_len, true);
+
+	/* Same as a TLS layer that timed out in the middle of a record, the client resumes later */
+	if(SUCCESS == rc && *read_len < len) {
+		rc = NETWORK_SSL_READ_TIMEOUT_ERROR;
+	}
+
+	return rc;
+}
+
+static IoT_Error_t aws_iot_benchmark_network_fault_write(Network *pNetwork, unsigned char *pMsg, size_t len,
+														 Timer *pTimer, size_t *written_len) {
+	FaultNetwork_t *pFault = aws_iot_benchmark_network_fault_find(pNetwork);
+	size_t allowed;
+	IoT_Error_t rc;
+
+	*written_len = 0;
+	if(NULL == pFault) {
+		return NULL_VALUE_ERROR;
+	}
+
+	if(aws_iot_benchmark_network_fault_check_drop(pFault)) {
+		return NETWORK_SSL_WRITE_ERROR;
+	}
+
+	allowed = aws_iot_benchmark_network_fault_limit(pFault, len, &pFault->stats.partialWrites);
+	rc = pFault->write(pNetwork, pMsg, allowed, pTimer, written_len);
+	aws_iot_benchmark_network_fault_delay(pFault, *written_len, false);
+
+	return rc;
+}
+
+static IoT_Error_t aws_iot_benchmark_network_fault_disconnect(Network *pNetwork) {
+	FaultNetwork_t *pFault = aws_iot_benchmark_network_fault_find(pNetwork);
+
+	if(NULL == pFault) {
+		return NULL_VALUE_ERROR;
+	}
+
+	return pFault->disconnect(pNetwork);
+}
+
+static IoT_Error_t aws_iot_benchmark_network_fault_is_connected(Network *pNetwork) {
+	FaultNetwork_t *pFault = aws_iot_benchmark_network_fault_find(pNetwork);
+
+	if(NULL == pFault) {
+		return NULL_VALUE_ERROR;
+	}
+
+	/* The link is down for as long as the drop lasts */
+	if(aws_iot_benchmark_network_fault_is_active(pFault, FAULT_DROP, NULL)) {
+		return NETWORK_PHYSICAL_LAYER_DISCONNECTED;
+	}
+
+	if(NULL == pFault->isConnected) {
+		return NETWORK_PHYSICAL_LAYER_CONNECTED;
+	}
+
+	return pFault->isConnected(pNetwork);
+}
+
+static IoT_Error_t aws_iot_benchmark_network_fault_destroy(Network *pNetwork) {
+	FaultNetwork_t *pFault = aws_iot_benchmark_network_fault_find(pNetwork);
+
+	if(NULL == pFault) {
+		return NULL_VALUE_ERROR;
+	}
+
+	return pFault->destroy(pNetwork);
+}
+
+IoT_Error_t aws_iot_benchmark_network_fault_wrap(FaultNetwork_t *pFault, Network *pNetwork,
+												 const FaultEvent_t *pSchedule, uint32_t eventCount) {
+	uint32_t i;
+
+	if(NULL == pFault || NULL == pNetwork || (NULL == pSchedule && 0 < eventCount)) {
+		return NULL_VALUE_ERROR;
+	}
+
+	for(i = 0; i < BENCHMARK_FAULT_MAX_NETWORKS; i++) {
+		if(NULL == wrappedNetworks[i]) {
+			break;
+		}
+	}
+	if(BENCHMARK_FAULT_MAX_NETWORKS == i) {
+		return FAILURE;
+	}
+
+	pFault->pNetwork = pNetwork;
+	pFault->connect = pNetwork->connect;
+	pFault->read = pNetwork->read;
+	pFault->write = pNetwork->write;
+	pFault->disconnect = pNetwork->disconnect;
+	pFault->isConnected = pNetwork->isConnected;
+	pFault->destroy = pNetwork->destroy;
+	pFault->pSchedule = pSchedule;
+	pFault->eventCount = eventCount;
+	pFault->isReset = false;
+	pFault->bandwidthRemainderUs = 0;
+	pFault->stats = (FaultStats_t) {0};
+	wrappedNetworks[i] = pFault;
+
+	pNetwork->connect = aws_iot_benchmark_network_fault_connect;
+	pNetwork->read = aws_iot_benchmark_network_fault_read;
+	pNetwork->write = aws_iot_benchmark_network_fault_write;
+	pNetwork->disconnect = aws_iot_benchmark_network_fault_disconnect;
+	pNetwork->isConnected = aws_iot_benchmark_network_fault_is_connected;
+	pNetwork->destroy = aws_iot_benchmark_network_fault_destroy;
+
+	return SUCCESS;
+}
+
+void aws_iot_benchmark_network_fault_unwrap(FaultNetwork_t *pFault) {
+	uint32_t i;
+
+	if(NULL == pFault) {
+		return;
+	}
+
+	for(i = 0; i < BENCHMARK_FAULT_MAX_NETWORKS; i++) {
+		if(pFault == wrappedNetworks[i]) {
+			wrappedNetworks[i] = NULL;
+			pFault->pNetwork->connect = pFault->connect;
+			pFault->pNetwork->read = pFault->read;
+			pFault->pNetwork->write = pFault->write;
+			pFault->pNetwork->disconnect = pFault->disconnect;
+			pFault->pNetwork->isConnected = pFault->isConnected;
+			pFault->pNetwork->destroy = pFault->destroy;
+		}
+	}
+}
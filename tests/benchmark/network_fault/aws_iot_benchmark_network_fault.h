@@ -0,0 +1,133 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_network_fault.h
+ * @brief Fault injecting decorator for the network interface
+ *
+ * Wraps the function pointers of an initialized Network, whatever the backend, and injects
+ * faults according to a schedule. The schedule is a list of events, each active from its
+ * start time for its duration, in virtual time (see aws_iot_benchmark_virtual_clock.h).
+ * Several events can be active at the same time. Layers that simulate waiting advance the
+ * virtual clock, so a run is fully deterministic for a given schedule.
+ *
+ * Typical use:
+ *
+ *     aws_iot_mqtt_init(&client, &initParams);
+ *     aws_iot_benchmark_network_fault_wrap(&fault, &client.networkStack, schedule, count);
+ */
+
+#ifndef AWS_IOT_BENCHMARK_NETWORK_FAULT_H_
+#define AWS_IOT_BENCHMARK_NETWORK_FAULT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "network_interface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BENCHMARK_FAULT_MAX_NETWORKS 4 ///< Maximum number of networks wrapped at the same time
+
+/**
+ * @brief Type of fault
+ */
+typedef enum {
+	FAULT_LATENCY, ///< Every read that returns data advances the clock by param milliseconds
+	FAULT_BANDWIDTH, ///< Reads and writes advance the clock as if limited to param bytes per second
+	FAULT_PARTIAL_IO, ///< Reads and writes transfer at most param bytes per call
+	FAULT_STALL, ///< Reads return nothing, writes are passed through. Models a peer that stopped responding
+	FAULT_DROP ///< The connection is reset and connects fail while the event is active
+} FaultType_t;
+
+/**
+ * @brief Scheduled fault
+ */
+typedef struct {
+	uint64_t startMs; ///< Virtual time at which the fault starts
+	uint64_t durationMs; ///< How long the fault lasts
+	FaultType_t type; ///< Type of fault
+	uint32_t param; ///< Meaning depends on type
+} FaultEvent_t;
+
+/**
+ * @brief Counters kept by the decorator
+ */
+typedef struct {
+	uint32_t drops; ///< Connections reset by FAULT_DROP
+	uint32_t failedConnects; ///< Connects refused by FAULT_DROP
+	uint32_t stalledReads; ///< Reads suppressed by FAULT_STALL
+	uint32_t partialReads; ///< Reads shortened by FAULT_PARTIAL_IO
+	uint32_t partialWrites; ///< Writes shortened by FAULT_PARTIAL_IO
+	uint64_t delayUs; ///< Virtual time added by FAULT_LATENCY and FAULT_BANDWIDTH
+} FaultStats_t;
+
+/**
+ * @brief State of one wrapped network
+ */
+typedef struct {
+	Network *pNetwork;
+	IoT_Error_t (*connect)(Network *, TLSConnectParams *);
+	IoT_Error_t (*read)(Network *, unsigned char *, size_t, Timer *, size_t *);
+	IoT_Error_t (*write)(Network *, unsigned char *, size_t, Timer *, size_t *);
+	IoT_Error_t (*disconnect)(Network *);
+	IoT_Error_t (*isConnected)(Network *);
+	IoT_Error_t (*destroy)(Network *);
+	const FaultEvent_t *pSchedule;
+	uint32_t eventCount;
+	bool isReset; ///< Set by FAULT_DROP, the connection stays broken until the next connect
+	uint64_t bandwidthRemainderUs; ///< Fraction of a microsecond carried over, in units of 1/param
+	FaultStats_t stats;
+} FaultNetwork_t;
+
+/**
+ * @brief Start injecting faults into an initialized network
+ *
+ * Must be called after aws_iot_mqtt_init, which sets up the function pointers of the
+ * network. The schedule is not copied and must outlive the wrapped network.
+ *
+ * @param pFault Decorator state, must outlive the wrapped network
+ * @param pNetwork Network to wrap, usually &client.networkStack
+ * @param pSchedule Fault events
+ * @param eventCount Number of events in pSchedule
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR or FAILURE if BENCHMARK_FAULT_MAX_NETWORKS are wrapped already
+ */
+IoT_Error_t aws_iot_benchmark_network_fault_wrap(FaultNetwork_t *pFault, Network *pNetwork,
+												 const FaultEvent_t *pSchedule, uint32_t eventCount);
+
+/**
+ * @brief Restore the original function pointers of a wrapped network
+ *
+ * @param pFault Decorator state passed to aws_iot_benchmark_network_fault_wrap
+ */
+void aws_iot_benchmark_network_fault_unwrap(FaultNetwork_t *pFault);
+
+/**
+ * @brief Whether an event of the given type is active at the current virtual time
+ *
+ * @param pFault Decorator state
+ * @param type Type of fault
+ * @param pParam Set to the param of the active event, may be NULL
+ */
+bool aws_iot_benchmark_network_fault_is_active(const FaultNetwork_t *pFault, FaultType_t type, uint32_t *pParam);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_BENCHMARK_NETWORK_FAULT_H_ */
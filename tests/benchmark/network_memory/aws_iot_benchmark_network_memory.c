@@ -0,0 +1,375 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_network_memory.c
+ * @brief In-memory network layer used by the benchmarks
+ */
+
+#include <string.h>
+#include "aws_iot_error.h"
+#include "network_interface.h"
+#include "aws_iot_mqtt_client_common_internal.h"
+#include "aws_iot_benchmark_network_memory.h"
+
+static unsigned char queueBuf[BENCHMARK_NETWORK_QUEUE_LEN];
+static size_t queueLen;
+static size_t queueIndex;
+
+static unsigned char replayBuf[BENCHMARK_NETWORK_REPLAY_LEN];
+static size_t replayLen;
+static size_t replayIndex;
+static uint32_t replayRemaining;
+
+static size_t bytesWritten;
+static uint32_t connectCount;
+static uint32_t publishCount;
+static uint32_t pingCount;
+static uint32_t topicAliasErrorCount;
+
+/* Auto respond parser state, the client may write a packet in several chunks */
+static bool isAutoRespondEnabled;
+static unsigned char txPacket[BENCHMARK_NETWORK_QUEUE_LEN];
+static size_t txPacketLen;
+static size_t txPacketExpected; ///< Total length of the current packet, 0 while the header is incomplete
+
+/* MQTT 5.0 connection state, topic aliases are resolved like a broker would */
+static bool isMqtt5Connection;
+static uint16_t topicAliasMaximum;
+static char topicAliases[BENCHMARK_NETWORK_TOPIC_ALIASES][BENCHMARK_NETWORK_TOPIC_LEN + 1];
+
+void aws_iot_benchmark_network_reset(void) {
+	queueLen = 0;
+	queueIndex = 0;
+	replayLen = 0;
+	replayIndex = 0;
+	replayRemaining = 0;
+	bytesWritten = 0;
+	connectCount = 0;
+	publishCount = 0;
+	pingCount = 0;
+	topicAliasErrorCount = 0;
+	isAutoRespondEnabled = false;
+	isMqtt5Connection = false;
+	topicAliasMaximum = 0;
+	txPacketLen = 0;
+	txPacketExpected = 0;
+}
+
+void aws_iot_benchmark_network_queue(const unsigned char *pData, size_t len) {
+	if(queueIndex == queueLen) {
+		queueLen = 0;
+		queueIndex = 0;
+	}
+
+	if(len > BENCHMARK_NETWORK_QUEUE_LEN - queueLen) {
+		len = BENCHMARK_NETWORK_QUEUE_LEN - queueLen;
+	}
+
+	memcpy(&queueBuf[queueLen], pData, len);
+	queueLen += len;
+}
+
+void aws_iot_benchmark_network_set_replay(const unsigned char *pData, size_t len, uint32_t count) {
+	if(len > BENCHMARK_NETWORK_REPLAY_LEN) {
+		len = BENCHMARK_NETWORK_REPLAY_LEN;
+	}
+
+	memcpy(replayBuf, pData, len);
+	replayLen = len;
+	replayIndex = 0;
+	replayRemaining = (0 == len) ? 0 : count;
+}
+
+size_t aws_iot_benchmark_network_bytes_written(void) {
+	return bytesWritten;
+}
+
+void aws_iot_benchmark_network_set_auto_respond(bool enable) {
+	isAutoRespondEnabled = enable;
+}
+
+uint32_t aws_iot_benchmark_network_connect_count(void) {
+	return connectCount;
+}
+
+uint32_t aws_iot_benchmark_network_publish_count(void) {
+	return publishCount;
+}
+
+uint32_t aws_iot_benchmark_network_ping_count(void) {
+	return pingCount;
+}
+
+void aws_iot_benchmark_network_set_topic_alias_maximum(uint16_t aliasMaximum) {
+	if(aliasMaximum > BENCHMARK_NETWORK_TOPIC_ALIASES) {
+		aliasMaximum = BENCHMARK_NETWORK_TOPIC_ALIASES;
+	}
+
+	topicAliasMaximum = aliasMaximum;
+}
+
+uint32_t aws_iot_benchmark_network_topic_alias_error_count(void) {
+	return topicAliasErrorCount;
+}
+
+/* Reads the properties of an MQTT 5.0 PUBLISH starting at index and resolves its topic alias */
+static void aws_iot_benchmark_network_resolve_topic_alias(size_t index, size_t topicIndex, size_t topicLen) {
+	size_t propertiesLen = 0, multiplier = 1;
+	uint16_t alias = 0;
+
+	do {
+		if(index >= txPacketLen) {
+			topicAliasErrorCount++;
+			return;
+		}
+		propertiesLen += (txPacket[index] & 0x7F) * multiplier;
+		multiplier *= 128;
+	} while(0 != (txPacket[index++] & 0x80));
+
+	/* The client only ever sends the Topic Alias property */
+	if(0 != propertiesLen) {
+		if(3 != propertiesLen || index + propertiesLen > txPacketLen || MQTT5_PROPERTY_TOPIC_ALIAS != txPacket[index]) {
+			topicAliasErrorCount++;
+			return;
+		}
+		alias = (uint16_t) ((txPacket[index + 1] << 8) | txPacket[index + 2]);
+	}
+
+	if(0 == alias) {
+		if(0 == topicLen) {
+			topicAliasErrorCount++;
+		}
+	} else if(alias > topicAliasMaximum || topicLen > BENCHMARK_NETWORK_TOPIC_LEN) {
+		topicAliasErrorCount++;
+	} else if(0 != topicLen) {
+		memcpy(topicAliases[alias - 1], &txPacket[topicIndex], topicLen);
+		topicAliases[alias - 1][topicLen] = '\0';
+	} else if('\0' == topicAliases[alias - 1][0]) {
+		topicAliasErrorCount++;
+	}
+}
+
+static void aws_iot_benchmark_network_respond(void) {
+	const unsigned char connack[] = {0x20, 0x02, 0x00, 0x00};
+	const unsigned char pingresp[] = {0xD0, 0x00};
+	unsigned char ack[8];
+	size_t ackLen;
+	size_t headerLen = 2;
+	unsigned char type = (unsigned char) (txPacket[0] >> 4);
+
+	while(headerLen < txPacketLen && 0 != (txPacket[headerLen - 1] & 0x80)) {
+		headerLen++;
+	}
+
+	switch(type) {
+		case CONNECT:
+			/* The protocol level follows the protocol name "MQTT" */
+			isMqtt5Connection = (headerLen + 6 < txPacketLen && MQTT_5_0 == txPacket[headerLen + 6]);
+			if(isMqtt5Connection) {
+				memset(topicAliases, 0, sizeof(topicAliases));
+				/* Topic Alias Maximum and Receive Maximum of 1 like the client would accept anyway */
+				ack[0] = 0x20;
+				ack[1] = 0x09;
+				ack[2] = 0x00;
+				ack[3] = 0x00;
+				ack[4] = 0x06;
+				ack[5] = MQTT5_PROPERTY_TOPIC_ALIAS_MAXIMUM;
+				ack[6] = (unsigned char) (topicAliasMaximum >> 8);
+				ack[7] = (unsigned char) (topicAliasMaximum & 0xFF);
+				aws_iot_benchmark_network_queue(ack, 8);
+				ack[0] = MQTT5_PROPERTY_RECEIVE_MAXIMUM;
+				ack[1] = 0x00;
+				ack[2] = 0x01;
+				aws_iot_benchmark_network_queue(ack, 3);
+			} else {
+				aws_iot_benchmark_network_queue(connack, sizeof(connack));
+			}
+			break;
+		case PUBLISH:
+			publishCount++;
+			if(txPacketLen >= headerLen + 2) {
+				/* The packet id follows the topic name, the properties follow the packet id */
+				size_t topicLen = (size_t) ((txPacket[headerLen] << 8) | txPacket[headerLen + 1]);
+				size_t idIndex = headerLen + 2 + topicLen;
+				if(isMqtt5Connection) {
+					aws_iot_benchmark_network_resolve_topic_alias(idIndex + ((0 != (txPacket[0] & 0x06)) ? 2 : 0),
+																  headerLen + 2, topicLen);
+				}
+				if(0 != (txPacket[0] & 0x06) && idIndex + 2 <= txPacketLen) {
+					ack[0] = 0x40;
+					ack[1] = 0x02;
+					ack[2] = txPacket[idIndex];
+					ack[3] = txPacket[idIndex + 1];
+					aws_iot_benchmark_network_queue(ack, 4);
+				}
+			}
+			break;
+		case SUBSCRIBE:
+			if(txPacketLen >= headerLen + 2) {
+				/* Grant QoS1 for a single topic filter, the SDK subscribes one filter at a time */
+				ackLen = 0;
+				ack[ackLen++] = 0x90;
+				ack[ackLen++] = isMqtt5Connection ? 0x04 : 0x03;
+				ack[ackLen++] = txPacket[headerLen];
+				ack[ackLen++] = txPacket[headerLen + 1];
+				if(isMqtt5Connection) {
+					ack[ackLen++] = 0x00;
+				}
+				ack[ackLen++] = 0x01;
+				aws_iot_benchmark_network_queue(ack, ackLen);
+			}
+			break;
+		case PINGREQ:
+			pingCount++;
+			aws_iot_benchmark_network_queue(pingresp, sizeof(pingresp));
+			break;
+		default:
+			break;
+	}
+}
+
+static void aws_iot_benchmark_network_parse_tx(const unsigned char *pMsg, size_t len) {
+	size_t i, j, remLen, multiplier;
+
+	for(i = 0; i < len; i++) {
+		if(txPacketLen < BENCHMARK_NETWORK_QUEUE_LEN) {
+			txPacket[txPacketLen] = pMsg[i];
+		}
+		txPacketLen++;
+
+		if(0 == txPacketExpected && 2 <= txPacketLen && 0 == (pMsg[i] & 0x80)) {
+			/* Last byte of the remaining length, the total packet length is known now */
+			remLen = 0;
+			multiplier = 1;
+			for(j = 1; j < txPacketLen && j <= 4; j++) {
+				remLen += (txPacket[j] & 0x7F) * multiplier;
+				multiplier *= 128;
+			}
+			txPacketExpected = txPacketLen + remLen;
+		}
+
+		if(0 != txPacketExpected && txPacketLen == txPacketExpected) {
+			aws_iot_benchmark_network_respond();
+			txPacketLen = 0;
+			txPacketExpected = 0;
+		}
+	}
+}
+
+IoT_Error_t iot_tls_init(Network *pNetwork, char *pRootCALocation, char *pDeviceCertLocation,
+						 char *pDevicePrivateKeyLocation, char *pDestinationURL,
+						 uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
+	pNetwork->tlsConnectParams.DestinationPort = destinationPort;
+	pNetwork->tlsConnectParams.pDestinationURL = pDestinationURL;
+	pNetwork->tlsConnectParams.pDeviceCertLocation = pDeviceCertLocation;
+	pNetwork->tlsConnectParams.pDevicePrivateKeyLocation = pDevicePrivateKeyLocation;
+	pNetwork->tlsConnectParams.pRootCALocation = pRootCALocation;
+	pNetwork->tlsConnectParams.timeout_ms = timeout_ms;
+	pNetwork->tlsConnectParams.ServerVerificationFlag = ServerVerificationFlag;
+
+	pNetwork->connect = iot_tls_connect;
+	pNetwork->read = iot_tls_read;
+	pNetwork->write = iot_tls_write;
+	pNetwork->disconnect = iot_tls_disconnect;
+	pNetwork->isConnected = iot_tls_is_connected;
+	pNetwork->destroy = iot_tls_destroy;
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
+	IOT_UNUSED(pNetwork);
+	IOT_UNUSED(params);
+
+	connectCount++;
+	if(isAutoRespondEnabled) {
+		/* New connection, nothing from the previous one can be read anymore */
+		queueLen = 0;
+		queueIndex = 0;
+		txPacketLen = 0;
+		txPacketExpected = 0;
+		isMqtt5Connection = false;
+	}
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_is_connected(Network *pNetwork) {
+	IOT_UNUSED(pNetwork);
+	return NETWORK_PHYSICAL_LAYER_CONNECTED;
+}
+
+IoT_Error_t iot_tls_write(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *written_len) {
+	IOT_UNUSED(pNetwork);
+	IOT_UNUSED(timer);
+
+	if(isAutoRespondEnabled) {
+		aws_iot_benchmark_network_parse_tx(pMsg, len);
+	}
+
+	bytesWritten += len;
+	*written_len = len;
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *pTimer, size_t *read_len) {
+	size_t copied = 0;
+	size_t chunk;
+
+	IOT_UNUSED(pNetwork);
+	IOT_UNUSED(pTimer);
+
+	while(copied < len && queueIndex < queueLen) {
+		chunk = queueLen - queueIndex;
+		if(chunk > len - copied) {
+			chunk = len - copied;
+		}
+		memcpy(pMsg + copied, &queueBuf[queueIndex], chunk);
+		queueIndex += chunk;
+		copied += chunk;
+	}
+
+	while(copied < len && 0 < replayRemaining) {
+		chunk = replayLen - replayIndex;
+		if(chunk > len - copied) {
+			chunk = len - copied;
+		}
+		memcpy(pMsg + copied, &replayBuf[replayIndex], chunk);
+		replayIndex += chunk;
+		copied += chunk;
+		if(replayIndex == replayLen) {
+			replayIndex = 0;
+			replayRemaining--;
+		}
+	}
+
+	*read_len = copied;
+	if(0 == copied) {
+		return NETWORK_SSL_NOTHING_TO_READ;
+	}
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_disconnect(Network *pNetwork) {
+	IOT_UNUSED(pNetwork);
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_destroy(Network *pNetwork) {
+	IOT_UNUSED(pNetwork);
+	return SUCCESS;
+}
@@ -0,0 +1,124 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_network_memory.h
+ * @brief In-memory network layer used by the benchmarks
+ *
+ * Implements the network interface on top of static buffers so that the client can be
+ * driven at full speed without a broker. Incoming data is served first from a one-shot
+ * queue (CONNACK, SUBACK, ...) and then from a single packet that is replayed a given
+ * number of times. Outgoing data is counted and discarded.
+ *
+ * With auto respond enabled the layer behaves like a minimal broker instead: every
+ * connect starts with an empty queue and CONNECT, SUBSCRIBE, QoS1 PUBLISH and PINGREQ
+ * packets written by the client are answered through the queue. This is what the
+ * reconnect benchmarks use, since the client reconnects and resubscribes on its own.
+ * MQTT 5.0 connects are answered with MQTT 5.0 packets, and topic aliases in PUBLISH
+ * packets are resolved against the Topic Alias Maximum set for the layer.
+ */
+
+#ifndef AWS_IOT_BENCHMARK_NETWORK_MEMORY_H_
+#define AWS_IOT_BENCHMARK_NETWORK_MEMORY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BENCHMARK_NETWORK_QUEUE_LEN 256 ///< Maximum number of bytes that can be queued at once
+#define BENCHMARK_NETWORK_REPLAY_LEN 1024 ///< Maximum size of the replayed packet
+#define BENCHMARK_NETWORK_TOPIC_ALIASES 16 ///< Maximum number of topic aliases the layer accepts
+#define BENCHMARK_NETWORK_TOPIC_LEN 128 ///< Maximum length of a topic name a topic alias is resolved for
+
+/**
+ * @brief Drop all queued and replayed data and reset the counters
+ */
+void aws_iot_benchmark_network_reset(void);
+
+/**
+ * @brief Queue bytes to be read once, before any replayed data
+ *
+ * @param pData Bytes to queue
+ * @param len Number of bytes, the queue is silently truncated at BENCHMARK_NETWORK_QUEUE_LEN
+ */
+void aws_iot_benchmark_network_queue(const unsigned char *pData, size_t len);
+
+/**
+ * @brief Set the packet returned once the queue is empty
+ *
+ * @param pData Serialized packet
+ * @param len Length of the packet, at most BENCHMARK_NETWORK_REPLAY_LEN
+ * @param count Number of times the packet is replayed
+ */
+void aws_iot_benchmark_network_set_replay(const unsigned char *pData, size_t len, uint32_t count);
+
+/**
+ * @brief Number of bytes written by the client since the last reset
+ */
+size_t aws_iot_benchmark_network_bytes_written(void);
+
+/**
+ * @brief Answer CONNECT, SUBSCRIBE, QoS1 PUBLISH and PINGREQ like a broker would
+ *
+ * Cleared by aws_iot_benchmark_network_reset.
+ *
+ * @param enable true to enable the responses
+ */
+void aws_iot_benchmark_network_set_auto_respond(bool enable);
+
+/**
+ * @brief Number of connects since the last reset
+ */
+uint32_t aws_iot_benchmark_network_connect_count(void);
+
+/**
+ * @brief Number of PUBLISH packets written by the client since the last reset
+ *
+ * Only counted with auto respond enabled.
+ */
+uint32_t aws_iot_benchmark_network_publish_count(void);
+
+/**
+ * @brief Number of PINGREQ packets written by the client since the last reset
+ *
+ * Only counted with auto respond enabled.
+ */
+uint32_t aws_iot_benchmark_network_ping_count(void);
+
+/**
+ * @brief Set the Topic Alias Maximum sent in the CONNACK of MQTT 5.0 connections
+ *
+ * Cleared by aws_iot_benchmark_network_reset, takes effect on the next connect.
+ *
+ * @param aliasMaximum Number of topic aliases, at most BENCHMARK_NETWORK_TOPIC_ALIASES
+ */
+void aws_iot_benchmark_network_set_topic_alias_maximum(uint16_t aliasMaximum);
+
+/**
+ * @brief Number of MQTT 5.0 PUBLISH packets with a topic alias the layer could not resolve
+ *
+ * Only counted with auto respond enabled.
+ */
+uint32_t aws_iot_benchmark_network_topic_alias_error_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_BENCHMARK_NETWORK_MEMORY_H_ */
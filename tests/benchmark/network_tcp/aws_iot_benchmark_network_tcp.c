@@ -0,0 +1,222 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_network_tcp.c
+ * @brief Plain TCP network layer used by the load generator
+ *
+ * Same semantics as the mbedTLS implementation in platform/linux/mbedtls, without TLS.
+ * Only meant for talking to the local benchmark broker.
+ */
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include "aws_iot_error.h"
+#include "aws_iot_log.h"
+#include "network_interface.h"
+
+/* Upper bound for a single poll, mirrors IOT_SSL_READ_TIMEOUT of the mbedTLS layer */
+#define BENCHMARK_TCP_POLL_TIMEOUT_MS 10
+
+#define BENCHMARK_TCP_COUNT_SYSCALL() __atomic_fetch_add(&syscalls, 1, __ATOMIC_RELAXED)
+
+static uint64_t syscalls;
+
+uint64_t aws_iot_benchmark_network_tcp_syscalls(void) {
+	return __atomic_load_n(&syscalls, __ATOMIC_RELAXED);
+}
+
+IoT_Error_t iot_tls_init(Network *pNetwork, char *pRootCALocation, char *pDeviceCertLocation,
+						 char *pDevicePrivateKeyLocation, char *pDestinationURL,
+						 uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
+	pNetwork->tlsConnectParams.DestinationPort = destinationPort;
+	pNetwork->tlsConnectParams.pDestinationURL = pDestinationURL;
+	pNetwork->tlsConnectParams.pDeviceCertLocation = pDeviceCertLocation;
+	pNetwork->tlsConnectParams.pDevicePrivateKeyLocation = pDevicePrivateKeyLocation;
+	pNetwork->tlsConnectParams.pRootCALocation = pRootCALocation;
+	pNetwork->tlsConnectParams.timeout_ms = timeout_ms;
+	pNetwork->tlsConnectParams.ServerVerificationFlag = ServerVerificationFlag;
+
+	pNetwork->connect = iot_tls_connect;
+	pNetwork->read = iot_tls_read;
+	pNetwork->write = iot_tls_write;
+	pNetwork->disconnect = iot_tls_disconnect;
+	pNetwork->isConnected = iot_tls_is_connected;
+	pNetwork->destroy = iot_tls_destroy;
+
+	pNetwork->tlsDataParams.server_fd = -1;
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_is_connected(Network *pNetwork) {
+	IOT_UNUSED(pNetwork);
+
+	/* Use this to add implementation which can check for physical layer disconnect */
+	return NETWORK_PHYSICAL_LAYER_CONNECTED;
+}
+
+IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
+	struct addrinfo hints, *pAddrList, *pAddr;
+	char port[6];
+	int fd = -1;
+	int flag = 1;
+
+	if(NULL == pNetwork) {
+		return NULL_VALUE_ERROR;
+	}
+
+	if(NULL != params) {
+		pNetwork->tlsConnectParams = *params;
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	snprintf(port, sizeof(port), "%u", pNetwork->tlsConnectParams.DestinationPort);
+
+	if(0 != getaddrinfo(pNetwork->tlsConnectParams.pDestinationURL, port, &hints, &pAddrList)) {
+		return NETWORK_ERR_NET_UNKNOWN_HOST;
+	}
+
+	for(pAddr = pAddrList; NULL != pAddr; pAddr = pAddr->ai_next) {
+		fd = socket(pAddr->ai_family, pAddr->ai_socktype, pAddr->ai_protocol);
+		if(0 > fd) {
+			continue;
+		}
+		if(0 == connect(fd, pAddr->ai_addr, pAddr->ai_addrlen)) {
+			break;
+		}
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(pAddrList);
+
+	if(0 > fd) {
+		return NETWORK_ERR_NET_CONNECT_FAILED;
+	}
+
+	/* MQTT packets are small, do not let Nagle add latency to the measurements */
+	(void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+	pNetwork->tlsDataParams.server_fd = fd;
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_write(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *written_len) {
+	size_t written_so_far = 0;
+	struct pollfd pfd;
+	ssize_t ret;
+
+	pfd.fd = pNetwork->tlsDataParams.server_fd;
+	pfd.events = POLLOUT;
+
+	while(written_so_far < len && !has_timer_expired(timer)) {
+		BENCHMARK_TCP_COUNT_SYSCALL();
+		ret = send(pfd.fd, pMsg + written_so_far, len - written_so_far, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if(0 < ret) {
+			written_so_far += (size_t) ret;
+		} else if(0 > ret && (EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno)) {
+			BENCHMARK_TCP_COUNT_SYSCALL();
+			(void) poll(&pfd, 1, BENCHMARK_TCP_POLL_TIMEOUT_MS);
+		} else {
+			*written_len = written_so_far;
+			return NETWORK_SSL_WRITE_ERROR;
+		}
+	}
+
+	*written_len = written_so_far;
+
+	if(written_so_far != len) {
+		return NETWORK_SSL_WRITE_TIMEOUT_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *read_len) {
+	size_t rxLen = 0;
+	struct pollfd pfd;
+	uint32_t waitMs;
+	ssize_t ret;
+
+	pfd.fd = pNetwork->tlsDataParams.server_fd;
+	pfd.events = POLLIN;
+
+	while(len > 0) {
+		BENCHMARK_TCP_COUNT_SYSCALL();
+		ret = recv(pfd.fd, pMsg, len, MSG_DONTWAIT);
+		if(0 < ret) {
+			rxLen += (size_t) ret;
+			pMsg += ret;
+			len -= (size_t) ret;
+		} else if(0 == ret || (EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno)) {
+			/* Peer closed the connection or the socket failed */
+			return NETWORK_SSL_READ_ERROR;
+		} else {
+			waitMs = left_ms(timer);
+			if(waitMs > BENCHMARK_TCP_POLL_TIMEOUT_MS) {
+				waitMs = BENCHMARK_TCP_POLL_TIMEOUT_MS;
+			}
+			BENCHMARK_TCP_COUNT_SYSCALL();
+			(void) poll(&pfd, 1, (int) waitMs);
+		}
+
+		// Evaluate timeout after the read to make sure read is done at least once
+		if(has_timer_expired(timer)) {
+			break;
+		}
+	}
+
+	/* Unlike the mbedTLS layer, partial reads are reported so the client can resume the packet */
+	*read_len = rxLen;
+
+	if(len == 0) {
+		return SUCCESS;
+	}
+
+	if(rxLen == 0) {
+		return NETWORK_SSL_NOTHING_TO_READ;
+	} else {
+		return NETWORK_SSL_READ_TIMEOUT_ERROR;
+	}
+}
+
+IoT_Error_t iot_tls_disconnect(Network *pNetwork) {
+	if(0 <= pNetwork->tlsDataParams.server_fd) {
+		(void) shutdown(pNetwork->tlsDataParams.server_fd, SHUT_RDWR);
+	}
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_destroy(Network *pNetwork) {
+	if(0 <= pNetwork->tlsDataParams.server_fd) {
+		(void) close(pNetwork->tlsDataParams.server_fd);
+		pNetwork->tlsDataParams.server_fd = -1;
+	}
+
+	return SUCCESS;
+}
@@ -0,0 +1,193 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_batch.c
+ * @brief Samples per second and bytes per sample of the batching publisher
+ *
+ * Publishes small JSON sensor samples one per PUBLISH and through the batching publisher with
+ * 8, 32 and 128 samples per batch, at QoS0 and QoS1. The in-memory network answers every QoS1
+ * publish with a PUBACK, so the numbers do not include a network round trip; on a real
+ * connection QoS1 gains much more from batching than shown here.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_batch.h"
+#include "aws_iot_benchmark_network_memory.h"
+#include "aws_iot_benchmark_harness.h"
+
+#define BENCHMARK_BATCH_TOPIC "dt/plant7/line2/press14/telemetry"
+#define BENCHMARK_BATCH_SAMPLE "{\"t\":1700000000,\"v\":21.53}"
+#define BENCHMARK_BATCH_MAX_SAMPLES 128
+#define BENCHMARK_BATCH_SAMPLES 100000
+#define BENCHMARK_BATCH_BUFFER_LEN (BENCHMARK_BATCH_MAX_SAMPLES * (sizeof(BENCHMARK_BATCH_SAMPLE) + 1) + 2)
+
+typedef struct {
+	AWS_IoT_Client client;
+	IoT_Batch_Publisher_t batch;
+	QoS qos;
+	uint32_t batchSize; ///< Samples per batch, 0 publishes every sample on its own
+} BenchmarkBatch_t;
+
+static unsigned char writeBuf[BENCHMARK_BATCH_BUFFER_LEN + 128];
+static unsigned char batchBuf[BENCHMARK_BATCH_BUFFER_LEN];
+
+static int aws_iot_benchmark_batch_setup(BenchmarkBatch_t *pContext, QoS qos, uint32_t batchSize) {
+	IoT_Client_Init_Params initParams = iotClientInitParamsDefault;
+	IoT_Client_Connect_Params connectParams = iotClientConnectParamsDefault;
+	IoT_Batch_Publisher_Params batchParams;
+	IoT_Error_t rc;
+
+	aws_iot_benchmark_network_reset();
+	aws_iot_benchmark_network_set_auto_respond(true);
+	pContext->qos = qos;
+	pContext->batchSize = batchSize;
+
+	initParams.pHostURL = AWS_IOT_MQTT_HOST;
+	initParams.port = AWS_IOT_MQTT_PORT;
+	initParams.pRootCALocation = AWS_IOT_ROOT_CA_FILENAME;
+	initParams.pDeviceCertLocation = AWS_IOT_CERTIFICATE_FILENAME;
+	initParams.pDevicePrivateKeyLocation = AWS_IOT_PRIVATE_KEY_FILENAME;
+	initParams.mqttCommandTimeout_ms = 2000;
+	initParams.tlsHandshakeTimeout_ms = 2000;
+	initParams.enableAutoReconnect = false;
+	initParams.pWriteBuf = writeBuf;
+	initParams.writeBufLen = sizeof(writeBuf);
+	rc = aws_iot_mqtt_init(&(pContext->client), &initParams);
+	if(SUCCESS != rc) {
+		printf("aws_iot_mqtt_init failed: %d\n", rc);
+		return -1;
+	}
+
+	connectParams.keepAliveIntervalInSec = 600;
+	connectParams.pClientID = AWS_IOT_MQTT_CLIENT_ID;
+	connectParams.clientIDLen = (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID);
+	rc = aws_iot_mqtt_connect(&(pContext->client), &connectParams);
+	if(SUCCESS != rc) {
+		printf("aws_iot_mqtt_connect failed: %d\n", rc);
+		return -1;
+	}
+
+	if(0 != batchSize) {
+		batchParams.pTopicName = BENCHMARK_BATCH_TOPIC;
+		batchParams.topicNameLen = (uint16_t) strlen(BENCHMARK_BATCH_TOPIC);
+		batchParams.qos = qos;
+		batchParams.format = BATCH_FORMAT_JSON_ARRAY;
+		batchParams.pBuffer = batchBuf;
+		batchParams.bufferLen = sizeof(batchBuf);
+		batchParams.maxSamples = batchSize;
+		batchParams.maxAge_ms = 0;
+		rc = aws_iot_mqtt_batch_init(&(pContext->batch), &(pContext->client), &batchParams);
+		if(SUCCESS != rc) {
+			printf("aws_iot_mqtt_batch_init failed: %d\n", rc);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* One iteration is one sample */
+static int aws_iot_benchmark_batch_publish(void *pContext, uint32_t iterations) {
+	BenchmarkBatch_t *pBatch = (BenchmarkBatch_t *) pContext;
+	IoT_Publish_Message_Params params;
+	IoT_Error_t rc = SUCCESS;
+	uint32_t i;
+
+	params.qos = pBatch->qos;
+	params.isRetained = 0;
+	params.payload = (void *) BENCHMARK_BATCH_SAMPLE;
+	params.payloadLen = strlen(BENCHMARK_BATCH_SAMPLE);
+
+	for(i = 0; i < iterations && SUCCESS == rc; i++) {
+		if(0 == pBatch->batchSize) {
+			rc = aws_iot_mqtt_publish(&(pBatch->client), BENCHMARK_BATCH_TOPIC, (uint16_t) strlen(BENCHMARK_BATCH_TOPIC),
+									  &params);
+		} else {
+			rc = aws_iot_mqtt_batch_append(&(pBatch->batch), BENCHMARK_BATCH_SAMPLE, strlen(BENCHMARK_BATCH_SAMPLE));
+		}
+	}
+
+	if(SUCCESS == rc && 0 != pBatch->batchSize) {
+		rc = aws_iot_mqtt_batch_flush(&(pBatch->batch));
+	}
+
+	if(SUCCESS != rc) {
+		printf("Publishing samples failed: %d\n", rc);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int aws_iot_benchmark_batch_run(QoS qos, uint32_t batchSize) {
+	BenchmarkBatch_t batch;
+	char name[64];
+	char label[sizeof("batch_4294967295")];
+	size_t bytesBefore;
+	uint64_t start, elapsed;
+	int rc;
+
+	if(0 != aws_iot_benchmark_batch_setup(&batch, qos, batchSize)) {
+		return -1;
+	}
+
+	if(0 == batchSize) {
+		snprintf(label, sizeof(label), "unbatched");
+	} else {
+		snprintf(label, sizeof(label), "batch_%u", batchSize);
+	}
+
+	bytesBefore = aws_iot_benchmark_network_bytes_written();
+	start = aws_iot_benchmark_now_ns();
+	if(0 != aws_iot_benchmark_batch_publish(&batch, BENCHMARK_BATCH_SAMPLES)) {
+		return -1;
+	}
+	elapsed = aws_iot_benchmark_now_ns() - start;
+
+	snprintf(name, sizeof(name), "%s_qos%d_bytes_per_sample", label, (int) qos);
+	aws_iot_benchmark_record_metric(name, "bytes",
+									(double) (aws_iot_benchmark_network_bytes_written() - bytesBefore) /
+									BENCHMARK_BATCH_SAMPLES);
+	snprintf(name, sizeof(name), "%s_qos%d_samples_per_sec", label, (int) qos);
+	aws_iot_benchmark_record_metric(name, "samples/s", (double) BENCHMARK_BATCH_SAMPLES * 1e9 / (double) elapsed);
+
+	snprintf(name, sizeof(name), "%s_qos%d_append", label, (int) qos);
+	rc = aws_iot_benchmark_run(name, aws_iot_benchmark_batch_publish, &batch);
+
+	(void) aws_iot_mqtt_disconnect(&(batch.client));
+
+	return rc;
+}
+
+int main(int argc, char **argv) {
+	static const uint32_t batchSizes[] = {0, 8, 32, BENCHMARK_BATCH_MAX_SAMPLES};
+	int rc = 0;
+	uint32_t i;
+
+	aws_iot_benchmark_init("batch", argc, argv);
+
+	for(i = 0; i < sizeof(batchSizes) / sizeof(batchSizes[0]); i++) {
+		rc |= aws_iot_benchmark_batch_run(QOS0, batchSizes[i]);
+		rc |= aws_iot_benchmark_batch_run(QOS1, batchSizes[i]);
+	}
+
+	rc |= aws_iot_benchmark_finish();
+
+	return (0 == rc) ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_cbor.c
+ * @brief CBOR against the JSON shadow path for the same jsonStruct_t fields
+ *
+ * A telemetry sample of eight fields is written as a shadow update, once with
+ * aws_iot_shadow_add_reported and once as CBOR with the same nesting and client token, and
+ * read back with isJsonValidAndParse and isJsonKeyMatchingAndUpdateValue against
+ * aws_iot_cbor_decode. The flat map, as sent on a plain telemetry topic, is measured as well.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "aws_iot_cbor.h"
+#include "aws_iot_shadow_json.h"
+#include "aws_iot_shadow_json_data.h"
+#include "aws_iot_shadow_key.h"
+#include "aws_iot_benchmark_harness.h"
+
+#define BENCHMARK_CBOR_BUFFER_LEN 512
+#define BENCHMARK_CBOR_FIELD_COUNT 8
+#define BENCHMARK_CBOR_DEVICE_ID_LEN 16
+#define BENCHMARK_CBOR_CLIENT_TOKEN_LEN 64
+
+#define BENCHMARK_CBOR_FIELDS(f) &(f)[0], &(f)[1], &(f)[2], &(f)[3], &(f)[4], &(f)[5], &(f)[6], &(f)[7]
+
+typedef struct {
+	uint32_t ts;
+	char deviceId[BENCHMARK_CBOR_DEVICE_ID_LEN];
+	float temperature;
+	float humidity;
+	double pressure;
+	float vibration;
+	bool running;
+	int32_t cycles;
+} BenchmarkSample_t;
+
+static BenchmarkSample_t sample = {1700000123u, "press14", 21.87f, 39.95f, 1012.98, 0.034f, true, 48211};
+static BenchmarkSample_t decoded;
+static jsonStruct_t sampleFields[BENCHMARK_CBOR_FIELD_COUNT];
+static jsonStruct_t decodedFields[BENCHMARK_CBOR_FIELD_COUNT];
+static char clientToken[BENCHMARK_CBOR_CLIENT_TOKEN_LEN];
+
+static char jsonDocument[BENCHMARK_CBOR_BUFFER_LEN];
+static size_t jsonDocumentLen;
+static unsigned char cborDocument[BENCHMARK_CBOR_BUFFER_LEN];
+static size_t cborDocumentLen;
+static unsigned char cborTelemetry[BENCHMARK_CBOR_BUFFER_LEN];
+static size_t cborTelemetryLen;
+static unsigned char reportedMap[BENCHMARK_CBOR_BUFFER_LEN];
+static unsigned char stateMap[BENCHMARK_CBOR_BUFFER_LEN];
+
+/* Nested map found by aws_iot_benchmark_cbor_find_map, left in place in the document */
+static const unsigned char *pNestedMap;
+static uint32_t nestedMapLen;
+
+static void aws_iot_benchmark_cbor_bind(BenchmarkSample_t *pSample, jsonStruct_t *pFields) {
+	jsonStruct_t fields[BENCHMARK_CBOR_FIELD_COUNT] = {
+		{"ts", &pSample->ts, sizeof(uint32_t), SHADOW_JSON_UINT32, NULL},
+		{"deviceId", pSample->deviceId, sizeof(pSample->deviceId), SHADOW_JSON_STRING, NULL},
+		{"temperature", &pSample->temperature, sizeof(float), SHADOW_JSON_FLOAT, NULL},
+		{"humidity", &pSample->humidity, sizeof(float), SHADOW_JSON_FLOAT, NULL},
+		{"pressure", &pSample->pressure, sizeof(double), SHADOW_JSON_DOUBLE, NULL},
+		{"vibration", &pSample->vibration, sizeof(float), SHADOW_JSON_FLOAT, NULL},
+		{"running", &pSample->running, sizeof(bool), SHADOW_JSON_BOOL, NULL},
+		{"cycles", &pSample->cycles, sizeof(int32_t), SHADOW_JSON_INT32, NULL}
+	};
+
+	memcpy(pFields, fields, sizeof(fields));
+}
+
+static void aws_iot_benchmark_cbor_record_map(const char *pValue, uint32_t valueLen, jsonStruct_t *pField) {
+	IOT_UNUSED(pField);
+
+	pNestedMap = (const unsigned char *) pValue;
+	nestedMapLen = valueLen;
+}
+
+/* Value of pKey in the map, without copying it */
+static bool aws_iot_benchmark_cbor_find_map(const unsigned char *pMap, size_t mapLen, const char *pKey) {
+	jsonStruct_t field = {pKey, NULL, 0, SHADOW_JSON_OBJECT, aws_iot_benchmark_cbor_record_map};
+
+	pNestedMap = NULL;
+
+	return SUCCESS == aws_iot_cbor_decode(pMap, mapLen, 1, &field) && NULL != pNestedMap;
+}
+
+static int aws_iot_benchmark_json_encode_shadow(void *pContext, uint32_t iterations) {
+	uint32_t i;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		if(SUCCESS != aws_iot_shadow_init_json_document(jsonDocument, sizeof(jsonDocument)) ||
+		   SUCCESS != aws_iot_shadow_add_reported(jsonDocument, sizeof(jsonDocument), BENCHMARK_CBOR_FIELD_COUNT,
+												  BENCHMARK_CBOR_FIELDS(sampleFields)) ||
+		   SUCCESS != aws_iot_finalize_json_document(jsonDocument, sizeof(jsonDocument))) {
+			return -1;
+		}
+	}
+	jsonDocumentLen = strlen(jsonDocument);
+
+	return 0;
+}
+
+/* Same document as CBOR, {"state": {"reported": {...}}, "clientToken": "..."} */
+static int aws_iot_benchmark_cbor_encode_shadow(void *pContext, uint32_t iterations) {
+	jsonStruct_t reported = {"reported", reportedMap, 0, SHADOW_JSON_OBJECT, NULL};
+	jsonStruct_t state = {"state", stateMap, 0, SHADOW_JSON_OBJECT, NULL};
+	jsonStruct_t token = {SHADOW_CLIENT_TOKEN_STRING, clientToken, sizeof(clientToken), SHADOW_JSON_STRING, NULL};
+	uint32_t i;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		if(SUCCESS != aws_iot_cbor_encode(reportedMap, sizeof(reportedMap), &reported.dataLength,
+										  BENCHMARK_CBOR_FIELD_COUNT, BENCHMARK_CBOR_FIELDS(sampleFields)) ||
+		   SUCCESS != aws_iot_cbor_encode(stateMap, sizeof(stateMap), &state.dataLength, 1, &reported) ||
+		   SUCCESS != aws_iot_cbor_encode(cborDocument, sizeof(cborDocument), &cborDocumentLen, 2, &state, &token)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int aws_iot_benchmark_cbor_encode_telemetry(void *pContext, uint32_t iterations) {
+	uint32_t i;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		if(SUCCESS != aws_iot_cbor_encode(cborTelemetry, sizeof(cborTelemetry), &cborTelemetryLen,
+										  BENCHMARK_CBOR_FIELD_COUNT, BENCHMARK_CBOR_FIELDS(sampleFields))) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int aws_iot_benchmark_json_decode_shadow(void *pContext, uint32_t iterations) {
+	int32_t tokenCount, dataPosition;
+	uint32_t dataLength, i, j;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		if(!isJsonValidAndParse(jsonDocument, jsonDocumentLen, NULL, &tokenCount)) {
+			return -1;
+		}
+		for(j = 0; j < BENCHMARK_CBOR_FIELD_COUNT; j++) {
+			if(!isJsonKeyMatchingAndUpdateValue(jsonDocument, NULL, tokenCount, &decodedFields[j], &dataLength,
+												&dataPosition)) {
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int aws_iot_benchmark_cbor_decode_shadow(void *pContext, uint32_t iterations) {
+	uint32_t i;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		if(!aws_iot_benchmark_cbor_find_map(cborDocument, cborDocumentLen, "state") ||
+		   !aws_iot_benchmark_cbor_find_map(pNestedMap, nestedMapLen, "reported") ||
+		   SUCCESS != aws_iot_cbor_decode(pNestedMap, nestedMapLen, BENCHMARK_CBOR_FIELD_COUNT,
+										  BENCHMARK_CBOR_FIELDS(decodedFields))) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int aws_iot_benchmark_cbor_decode_telemetry(void *pContext, uint32_t iterations) {
+	uint32_t i;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		if(SUCCESS != aws_iot_cbor_decode(cborTelemetry, cborTelemetryLen, BENCHMARK_CBOR_FIELD_COUNT,
+										  BENCHMARK_CBOR_FIELDS(decodedFields))) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static bool aws_iot_benchmark_cbor_decoded_matches(void) {
+	return sample.ts == decoded.ts && 0 == strcmp(sample.deviceId, decoded.deviceId) &&
+		   sample.temperature == decoded.temperature && sample.humidity == decoded.humidity &&
+		   sample.pressure == decoded.pressure && sample.vibration == decoded.vibration &&
+		   sample.running == decoded.running && sample.cycles == decoded.cycles;
+}
+
+int main(int argc, char **argv) {
+	int rc = 0;
+
+	aws_iot_benchmark_cbor_bind(&sample, sampleFields);
+	aws_iot_benchmark_cbor_bind(&decoded, decodedFields);
+
+	aws_iot_benchmark_init("cbor", argc, argv);
+
+	/* Build every document once, the CBOR one with the client token of the JSON one */
+	if(0 != aws_iot_benchmark_json_encode_shadow(NULL, 1) ||
+	   !extractClientToken(jsonDocument, jsonDocumentLen, clientToken, sizeof(clientToken)) ||
+	   0 != aws_iot_benchmark_cbor_encode_shadow(NULL, 1) || 0 != aws_iot_benchmark_cbor_encode_telemetry(NULL, 1)) {
+		printf("Building the documents failed\n");
+		return 1;
+	}
+
+	memset(&decoded, 0, sizeof(decoded));
+	if(0 != aws_iot_benchmark_cbor_decode_shadow(NULL, 1) || !aws_iot_benchmark_cbor_decoded_matches()) {
+		printf("CBOR round trip failed\n");
+		return 1;
+	}
+
+	aws_iot_benchmark_record_metric("json_shadow_bytes", "bytes", (double) jsonDocumentLen);
+	aws_iot_benchmark_record_metric("cbor_shadow_bytes", "bytes", (double) cborDocumentLen);
+	aws_iot_benchmark_record_metric("cbor_shadow_saved", "%",
+									100.0 * (1.0 - (double) cborDocumentLen / (double) jsonDocumentLen));
+	aws_iot_benchmark_record_metric("cbor_telemetry_bytes", "bytes", (double) cborTelemetryLen);
+
+	rc |= aws_iot_benchmark_run("json_encode_shadow_8", aws_iot_benchmark_json_encode_shadow, NULL);
+	rc |= aws_iot_benchmark_run("cbor_encode_shadow_8", aws_iot_benchmark_cbor_encode_shadow, NULL);
+	rc |= aws_iot_benchmark_run("cbor_encode_telemetry_8", aws_iot_benchmark_cbor_encode_telemetry, NULL);
+	rc |= aws_iot_benchmark_run("json_decode_shadow_8", aws_iot_benchmark_json_decode_shadow, NULL);
+	rc |= aws_iot_benchmark_run("cbor_decode_shadow_8", aws_iot_benchmark_cbor_decode_shadow, NULL);
+	rc |= aws_iot_benchmark_run("cbor_decode_telemetry_8", aws_iot_benchmark_cbor_decode_telemetry, NULL);
+
+	rc |= aws_iot_benchmark_finish();
+
+	return (0 == rc) ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_client_state.c
+ * @brief Per-message overhead of the client state machine
+ *
+ * Feeds PUBLISH packets to a client through the in-memory network and measures the time
+ * spent in aws_iot_mqtt_yield for each delivered message. Every delivery goes through two
+ * state transitions, so the numbers are dominated by the state machine and the read path.
+ * The Makefile builds this file with and without _ENABLE_THREAD_SUPPORT_ so that the two
+ * configurations can be compared directly.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_client_common_internal.h"
+#include "aws_iot_benchmark_network_memory.h"
+#include "aws_iot_benchmark_harness.h"
+
+#ifndef BENCHMARK_MESSAGE_COUNT
+#define BENCHMARK_MESSAGE_COUNT 1000000
+#endif
+
+#define BENCHMARK_TOPIC "sdk/benchmark/state"
+#define BENCHMARK_PAYLOAD_LEN 64
+
+static uint32_t deliveredCount;
+
+static void aws_iot_benchmark_callback(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+									   IoT_Publish_Message_Params *params, void *pData) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(topicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(params);
+	IOT_UNUSED(pData);
+
+	deliveredCount++;
+}
+
+static size_t aws_iot_benchmark_build_publish(unsigned char *pBuf, QoS qos) {
+	unsigned char *ptr = pBuf;
+	uint16_t topicLen = (uint16_t) strlen(BENCHMARK_TOPIC);
+	uint32_t remLen = 2 + topicLen + BENCHMARK_PAYLOAD_LEN + ((QOS0 == qos) ? 0 : 2);
+
+	aws_iot_mqtt_internal_write_char(&ptr, (unsigned char) (0x30 | (qos << 1)));
+	ptr += aws_iot_mqtt_internal_write_len_to_buffer(ptr, remLen);
+	aws_iot_mqtt_internal_write_utf8_string(&ptr, BENCHMARK_TOPIC, topicLen);
+	if(QOS0 != qos) {
+		aws_iot_mqtt_internal_write_uint_16(&ptr, 1);
+	}
+	memset(ptr, 'x', BENCHMARK_PAYLOAD_LEN);
+	ptr += BENCHMARK_PAYLOAD_LEN;
+
+	return (size_t) (ptr - pBuf);
+}
+
+static int aws_iot_benchmark_setup(AWS_IoT_Client *pClient) {
+	IoT_Client_Init_Params initParams = iotClientInitParamsDefault;
+	IoT_Client_Connect_Params connectParams = iotClientConnectParamsDefault;
+	const unsigned char connack[] = {0x20, 0x02, 0x00, 0x00};
+	const unsigned char suback[] = {0x90, 0x03, 0x00, 0x02, 0x01};
+	IoT_Error_t rc;
+
+	aws_iot_benchmark_network_reset();
+
+	initParams.pHostURL = AWS_IOT_MQTT_HOST;
+	initParams.port = AWS_IOT_MQTT_PORT;
+	initParams.pRootCALocation = AWS_IOT_ROOT_CA_FILENAME;
+	initParams.pDeviceCertLocation = AWS_IOT_CERTIFICATE_FILENAME;
+	initParams.pDevicePrivateKeyLocation = AWS_IOT_PRIVATE_KEY_FILENAME;
+	initParams.mqttCommandTimeout_ms = 2000;
+	initParams.tlsHandshakeTimeout_ms = 2000;
+	initParams.enableAutoReconnect = false;
+#ifdef _ENABLE_THREAD_SUPPORT_
+	initParams.isBlockOnThreadLockEnabled = true;
+#endif
+	rc = aws_iot_mqtt_init(pClient, &initParams);
+	if(SUCCESS != rc) {
+		printf("aws_iot_mqtt_init failed: %d\n", rc);
+		return -1;
+	}
+
+	connectParams.keepAliveIntervalInSec = 600;
+	connectParams.pClientID = AWS_IOT_MQTT_CLIENT_ID;
+	connectParams.clientIDLen = (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID);
+	aws_iot_benchmark_network_queue(connack, sizeof(connack));
+	rc = aws_iot_mqtt_connect(pClient, &connectParams);
+	if(SUCCESS != rc) {
+		printf("aws_iot_mqtt_connect failed: %d\n", rc);
+		return -1;
+	}
+
+	aws_iot_benchmark_network_queue(suback, sizeof(suback));
+	rc = aws_iot_mqtt_subscribe(pClient, BENCHMARK_TOPIC, (uint16_t) strlen(BENCHMARK_TOPIC), QOS1,
+								aws_iot_benchmark_callback, NULL);
+	if(SUCCESS != rc) {
+		printf("aws_iot_mqtt_subscribe failed: %d\n", rc);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int aws_iot_benchmark_deliver(AWS_IoT_Client *pClient, QoS qos, const char *pName) {
+	unsigned char packet[BENCHMARK_NETWORK_REPLAY_LEN];
+	size_t packetLen;
+	uint64_t start, elapsed, allocations;
+	IoT_Error_t rc;
+
+	if(!aws_iot_benchmark_is_selected(pName)) {
+		return 0;
+	}
+
+	packetLen = aws_iot_benchmark_build_publish(packet, qos);
+	deliveredCount = 0;
+	aws_iot_benchmark_network_set_replay(packet, packetLen, BENCHMARK_MESSAGE_COUNT);
+
+	allocations = aws_iot_benchmark_allocation_count();
+	start = aws_iot_benchmark_now_ns();
+	while(deliveredCount < BENCHMARK_MESSAGE_COUNT) {
+		rc = aws_iot_mqtt_yield(pClient, 1);
+		if(SUCCESS != rc) {
+			printf("aws_iot_mqtt_yield failed: %d\n", rc);
+			return -1;
+		}
+	}
+	elapsed = aws_iot_benchmark_now_ns() - start;
+	allocations = aws_iot_benchmark_allocation_count() - allocations;
+
+	aws_iot_benchmark_record(pName, deliveredCount, elapsed, allocations);
+	return 0;
+}
+
+static int aws_iot_benchmark_transitions(void *pContext, uint32_t iterations) {
+	AWS_IoT_Client *pClient = (AWS_IoT_Client *) pContext;
+	uint32_t i;
+
+	for(i = 0; i < iterations; i++) {
+		if(SUCCESS != aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_IDLE,
+													CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN) ||
+		   SUCCESS != aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN,
+													CLIENT_STATE_CONNECTED_IDLE)) {
+			printf("aws_iot_mqtt_set_client_state failed\n");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	AWS_IoT_Client client;
+	int rc = 0;
+
+	aws_iot_benchmark_init("client_state", argc, argv);
+
+	if(0 != aws_iot_benchmark_setup(&client)) {
+		return 1;
+	}
+
+	rc |= aws_iot_benchmark_run("state_transition_pair", aws_iot_benchmark_transitions, &client);
+	rc |= aws_iot_benchmark_deliver(&client, QOS0, "yield_deliver_qos0");
+	rc |= aws_iot_benchmark_deliver(&client, QOS1, "yield_deliver_qos1");
+
+	(void) aws_iot_mqtt_disconnect(&client);
+	(void) aws_iot_mqtt_free(&client);
+
+	rc |= aws_iot_benchmark_finish();
+
+	return (0 == rc) ? 0 : 1;
+}
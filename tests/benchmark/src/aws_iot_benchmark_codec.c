@@ -0,0 +1,299 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_codec.c
+ * @brief Micro-benchmarks for the MQTT codec and the JSON helpers
+ *
+ * Every benchmark uses fixed inputs shaped like real device traffic, so results are
+ * comparable between runs and between commits.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "aws_iot_mqtt_client_common_internal.h"
+#include "aws_iot_shadow_interface.h"
+#include "aws_iot_shadow_json.h"
+#include "aws_iot_shadow_json_data.h"
+#include "aws_iot_benchmark_harness.h"
+
+#define BENCHMARK_CODEC_BUF_LEN 1100
+#define BENCHMARK_SHADOW_TOPIC "$aws/things/" AWS_IOT_MY_THING_NAME "/shadow/update"
+#define BENCHMARK_SHADOW_DOC_LEN 256
+
+typedef struct {
+	QoS qos;
+	size_t payloadLen;
+	unsigned char packet[BENCHMARK_CODEC_BUF_LEN];
+	uint32_t packetLen;
+} BenchmarkPublishContext_t;
+
+typedef struct {
+	const char *pFilter;
+	const char *pTopic;
+	bool expected;
+} BenchmarkTopicContext_t;
+
+typedef struct {
+	unsigned char encoded[4];
+	uint32_t expected;
+} BenchmarkLengthContext_t;
+
+static unsigned char payloadBuf[BENCHMARK_CODEC_BUF_LEN];
+static unsigned char txBuf[BENCHMARK_CODEC_BUF_LEN];
+static volatile uint32_t benchmarkSink;
+
+static const char shadowDeltaDocument[] =
+	"{\"version\":1234,\"timestamp\":1526412345,\"state\":{\"temperature\":23.5,\"windowOpen\":true,"
+	"\"mode\":\"cooling\",\"fan\":{\"speed\":3,\"oscillate\":false}},\"metadata\":{\"temperature\":"
+	"{\"timestamp\":1526412345},\"windowOpen\":{\"timestamp\":1526412345},\"mode\":{\"timestamp\":"
+	"1526412345},\"fan\":{\"speed\":{\"timestamp\":1526412345},\"oscillate\":{\"timestamp\":1526412345}}},"
+	"\"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-17\"}";
+
+static const char shadowAcceptedDocument[] =
+	"{\"state\":{\"desired\":{\"temperature\":21.0,\"mode\":\"cooling\",\"fan\":{\"speed\":3,\"oscillate\":true}},"
+	"\"reported\":{\"temperature\":23.5,\"windowOpen\":true,\"mode\":\"heating\",\"fan\":{\"speed\":1,"
+	"\"oscillate\":false}}},\"metadata\":{\"desired\":{\"temperature\":{\"timestamp\":1526412345},\"mode\":"
+	"{\"timestamp\":1526412345},\"fan\":{\"speed\":{\"timestamp\":1526412345},\"oscillate\":{\"timestamp\":"
+	"1526412345}}},\"reported\":{\"temperature\":{\"timestamp\":1526412301},\"windowOpen\":{\"timestamp\":"
+	"1526412301},\"mode\":{\"timestamp\":1526412301},\"fan\":{\"speed\":{\"timestamp\":1526412301},"
+	"\"oscillate\":{\"timestamp\":1526412301}}}},\"version\":1234,\"timestamp\":1526412345,"
+	"\"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-18\"}";
+
+static int aws_iot_benchmark_serialize_publish(void *pContext, uint32_t iterations) {
+	BenchmarkPublishContext_t *pPublish = (BenchmarkPublishContext_t *) pContext;
+	uint32_t serializedLen = 0;
+	uint32_t i;
+
+	for(i = 0; i < iterations; i++) {
+		if(SUCCESS != aws_iot_mqtt_internal_serialize_publish(txBuf, sizeof(txBuf), 0, pPublish->qos, 0,
+															  (uint16_t) (i | 1), BENCHMARK_SHADOW_TOPIC,
+															  (uint16_t) strlen(BENCHMARK_SHADOW_TOPIC),
+															  payloadBuf, pPublish->payloadLen, &serializedLen)) {
+			return -1;
+		}
+	}
+	benchmarkSink = serializedLen;
+
+	return 0;
+}
+
+static int aws_iot_benchmark_deserialize_publish(void *pContext, uint32_t iterations) {
+	BenchmarkPublishContext_t *pPublish = (BenchmarkPublishContext_t *) pContext;
+	uint8_t dup, retained;
+	QoS qos;
+	uint16_t packetId, topicNameLen;
+	char *pTopicName;
+	unsigned char *pPayload;
+	size_t payloadLen = 0;
+	uint32_t i;
+
+	for(i = 0; i < iterations; i++) {
+		if(SUCCESS != aws_iot_mqtt_internal_deserialize_publish(&dup, &qos, &retained, &packetId, &pTopicName,
+																&topicNameLen, &pPayload, &payloadLen,
+																pPublish->packet, pPublish->packetLen)) {
+			return -1;
+		}
+	}
+	benchmarkSink = (uint32_t) payloadLen;
+
+	return 0;
+}
+
+static int aws_iot_benchmark_decode_remaining_length(void *pContext, uint32_t iterations) {
+	BenchmarkLengthContext_t *pLength = (BenchmarkLengthContext_t *) pContext;
+	uint32_t decodedLen = 0, readBytesLen = 0;
+	uint32_t i;
+
+	for(i = 0; i < iterations; i++) {
+		if(SUCCESS != aws_iot_mqtt_internal_decode_remaining_length_from_buffer(pLength->encoded, &decodedLen,
+																				&readBytesLen)) {
+			return -1;
+		}
+	}
+
+	if(decodedLen != pLength->expected) {
+		return -1;
+	}
+	benchmarkSink = readBytesLen;
+
+	return 0;
+}
+
+static int aws_iot_benchmark_is_topic_matched(void *pContext, uint32_t iterations) {
+	BenchmarkTopicContext_t *pTopic = (BenchmarkTopicContext_t *) pContext;
+	uint16_t topicLen = (uint16_t) strlen(pTopic->pTopic);
+	uint32_t matched = 0;
+	uint32_t i;
+
+	for(i = 0; i < iterations; i++) {
+		if(aws_iot_mqtt_internal_is_topic_matched((char *) pTopic->pFilter, (char *) pTopic->pTopic, topicLen)) {
+			matched++;
+		}
+	}
+
+	if(matched != (pTopic->expected ? iterations : 0)) {
+		return -1;
+	}
+	benchmarkSink = matched;
+
+	return 0;
+}
+
+static int aws_iot_benchmark_json_parse(void *pContext, uint32_t iterations) {
+	int32_t tokenCount = 0;
+	uint32_t i;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		if(!isJsonValidAndParse(shadowDeltaDocument, sizeof(shadowDeltaDocument) - 1, NULL, &tokenCount)) {
+			return -1;
+		}
+	}
+	benchmarkSink = (uint32_t) tokenCount;
+
+	return 0;
+}
+
+static int aws_iot_benchmark_json_parse_accepted(void *pContext, uint32_t iterations) {
+	int32_t tokenCount = 0;
+	uint32_t i;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		if(!isJsonValidAndParse(shadowAcceptedDocument, sizeof(shadowAcceptedDocument) - 1, NULL, &tokenCount)) {
+			return -1;
+		}
+	}
+	benchmarkSink = (uint32_t) tokenCount;
+
+	return 0;
+}
+
+static int aws_iot_benchmark_shadow_build_reported(void *pContext, uint32_t iterations) {
+	char document[BENCHMARK_SHADOW_DOC_LEN];
+	float temperature = 23.5f;
+	bool windowOpen = true;
+	int32_t fanSpeed = 3;
+	jsonStruct_t temperatureHandler = {"temperature", &temperature, sizeof(float), SHADOW_JSON_FLOAT, NULL};
+	jsonStruct_t windowHandler = {"windowOpen", &windowOpen, sizeof(bool), SHADOW_JSON_BOOL, NULL};
+	jsonStruct_t fanHandler = {"fanSpeed", &fanSpeed, sizeof(int32_t), SHADOW_JSON_INT32, NULL};
+	uint32_t i;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		if(SUCCESS != aws_iot_shadow_init_json_document(document, sizeof(document)) ||
+		   SUCCESS != aws_iot_shadow_add_reported(document, sizeof(document), 3, &temperatureHandler,
+												  &windowHandler, &fanHandler) ||
+		   SUCCESS != aws_iot_finalize_json_document(document, sizeof(document))) {
+			return -1;
+		}
+	}
+	benchmarkSink = (uint32_t) strlen(document);
+
+	return 0;
+}
+
+static int aws_iot_benchmark_shadow_build_desired(void *pContext, uint32_t iterations) {
+	char document[BENCHMARK_SHADOW_DOC_LEN];
+	char mode[] = "cooling";
+	bool windowOpen = false;
+	jsonStruct_t modeHandler = {"mode", mode, sizeof(mode), SHADOW_JSON_STRING, NULL};
+	jsonStruct_t windowHandler = {"windowOpen", &windowOpen, sizeof(bool), SHADOW_JSON_BOOL, NULL};
+	uint32_t i;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		if(SUCCESS != aws_iot_shadow_init_json_document(document, sizeof(document)) ||
+		   SUCCESS != aws_iot_shadow_add_desired(document, sizeof(document), 2, &modeHandler, &windowHandler) ||
+		   SUCCESS != aws_iot_finalize_json_document(document, sizeof(document))) {
+			return -1;
+		}
+	}
+	benchmarkSink = (uint32_t) strlen(document);
+
+	return 0;
+}
+
+static void aws_iot_benchmark_prepare_publish(BenchmarkPublishContext_t *pPublish, QoS qos, size_t payloadLen) {
+	pPublish->qos = qos;
+	pPublish->payloadLen = payloadLen;
+	pPublish->packetLen = 0;
+	(void) aws_iot_mqtt_internal_serialize_publish(pPublish->packet, sizeof(pPublish->packet), 0, qos, 0, 1,
+												   BENCHMARK_SHADOW_TOPIC,
+												   (uint16_t) strlen(BENCHMARK_SHADOW_TOPIC), payloadBuf,
+												   payloadLen, &pPublish->packetLen);
+}
+
+int main(int argc, char **argv) {
+	BenchmarkPublishContext_t publishQos0Small, publishQos1Small, publishQos1Large;
+	BenchmarkLengthContext_t length1 = {{0x7F, 0x00, 0x00, 0x00}, 127};
+	BenchmarkLengthContext_t length2 = {{0xC1, 0x02, 0x00, 0x00}, 321};
+	BenchmarkLengthContext_t length4 = {{0xFF, 0xFF, 0xFF, 0x7F}, 268435455};
+	BenchmarkTopicContext_t topicExact = {"$aws/things/thing/shadow/update/delta",
+										  "$aws/things/thing/shadow/update/delta", true};
+	BenchmarkTopicContext_t topicPlus = {"$aws/things/+/shadow/update/+",
+										 "$aws/things/thing/shadow/update/accepted", true};
+	BenchmarkTopicContext_t topicHash = {"$aws/things/thing/#",
+										 "$aws/things/thing/shadow/update/documents", true};
+	BenchmarkTopicContext_t topicMiss = {"$aws/things/thing/shadow/get/+",
+										 "$aws/things/thing/shadow/update/accepted", false};
+	int rc = 0;
+
+	memset(payloadBuf, 'p', sizeof(payloadBuf));
+	aws_iot_benchmark_prepare_publish(&publishQos0Small, QOS0, 64);
+	aws_iot_benchmark_prepare_publish(&publishQos1Small, QOS1, 64);
+	aws_iot_benchmark_prepare_publish(&publishQos1Large, QOS1, 1024);
+
+	aws_iot_benchmark_init("codec", argc, argv);
+
+	rc |= aws_iot_benchmark_run("serialize_publish_qos0_64B", aws_iot_benchmark_serialize_publish,
+								&publishQos0Small);
+	rc |= aws_iot_benchmark_run("serialize_publish_qos1_64B", aws_iot_benchmark_serialize_publish,
+								&publishQos1Small);
+	rc |= aws_iot_benchmark_run("serialize_publish_qos1_1KB", aws_iot_benchmark_serialize_publish,
+								&publishQos1Large);
+	rc |= aws_iot_benchmark_run("deserialize_publish_qos0_64B", aws_iot_benchmark_deserialize_publish,
+								&publishQos0Small);
+	rc |= aws_iot_benchmark_run("deserialize_publish_qos1_64B", aws_iot_benchmark_deserialize_publish,
+								&publishQos1Small);
+	rc |= aws_iot_benchmark_run("deserialize_publish_qos1_1KB", aws_iot_benchmark_deserialize_publish,
+								&publishQos1Large);
+	rc |= aws_iot_benchmark_run("decode_remaining_length_1B", aws_iot_benchmark_decode_remaining_length, &length1);
+	rc |= aws_iot_benchmark_run("decode_remaining_length_2B", aws_iot_benchmark_decode_remaining_length, &length2);
+	rc |= aws_iot_benchmark_run("decode_remaining_length_4B", aws_iot_benchmark_decode_remaining_length, &length4);
+	rc |= aws_iot_benchmark_run("is_topic_matched_exact", aws_iot_benchmark_is_topic_matched, &topicExact);
+	rc |= aws_iot_benchmark_run("is_topic_matched_plus", aws_iot_benchmark_is_topic_matched, &topicPlus);
+	rc |= aws_iot_benchmark_run("is_topic_matched_hash", aws_iot_benchmark_is_topic_matched, &topicHash);
+	rc |= aws_iot_benchmark_run("is_topic_matched_miss", aws_iot_benchmark_is_topic_matched, &topicMiss);
+	rc |= aws_iot_benchmark_run("json_valid_and_parse_delta", aws_iot_benchmark_json_parse, NULL);
+	aws_iot_shadow_disable_metadata_pruning();
+	rc |= aws_iot_benchmark_run("json_parse_accepted_full", aws_iot_benchmark_json_parse_accepted, NULL);
+	aws_iot_benchmark_record_metric("json_parse_accepted_full_tokens", "tokens", (double) benchmarkSink);
+	aws_iot_shadow_enable_metadata_pruning();
+	rc |= aws_iot_benchmark_run("json_parse_accepted_pruned", aws_iot_benchmark_json_parse_accepted, NULL);
+	aws_iot_benchmark_record_metric("json_parse_accepted_pruned_tokens", "tokens", (double) benchmarkSink);
+	rc |= aws_iot_benchmark_run("shadow_build_reported_3", aws_iot_benchmark_shadow_build_reported, NULL);
+	rc |= aws_iot_benchmark_run("shadow_build_desired_2", aws_iot_benchmark_shadow_build_desired, NULL);
+
+	rc |= aws_iot_benchmark_finish();
+
+	return (0 == rc) ? 0 : 1;
+}
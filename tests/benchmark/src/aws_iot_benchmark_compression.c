@@ -0,0 +1,304 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_compression.c
+ * @brief CPU time against bytes saved of the payload codecs
+ *
+ * Encodes and decodes representative payloads through the IoT_Payload_Codec_t interface: one
+ * telemetry sample, a shadow update and a batch of 32 telemetry samples. The built-in LZ codec
+ * runs without and with a shared dictionary. Built with -DBENCHMARK_WITH_ZLIB, zlib with the
+ * same preset dictionary runs through the same interface as a reference, which also serves as
+ * an example of wrapping another compressor.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "aws_iot_mqtt_payload_codec.h"
+#include "aws_iot_benchmark_harness.h"
+
+#ifdef BENCHMARK_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#define BENCHMARK_COMPRESSION_BUFFER_LEN 8192
+#define BENCHMARK_COMPRESSION_PASSES 2000
+#define BENCHMARK_COMPRESSION_BATCH_SAMPLES 32
+
+/* Field names and structure the payloads share, what a dictionary trained on real traffic would hold */
+static const char dictionary[] =
+	"{\"state\":{\"reported\":{\"firmware\":\"1.4.2\",\"connectivity\":{\"rssi\":-67,\"network\":\"lte-m\"},"
+	"\"sensors\":{\"temperature\":21.5,\"humidity\":40.1,\"pressure\":1013.2,\"vibration\":0.02}}},"
+	"\"clientToken\":\"press14-\",\"version\":}"
+	"{\"ts\":1700000000,\"deviceId\":\"press14\",\"temperature\":21.53,\"humidity\":40.12,\"pressure\":1013.25,"
+	"\"vibration\":0.021,\"status\":\"running\"}";
+
+static const char telemetry[] =
+	"{\"ts\":1700000123,\"deviceId\":\"press14\",\"temperature\":21.87,\"humidity\":39.95,\"pressure\":1012.98,"
+	"\"vibration\":0.034,\"status\":\"running\"}";
+
+static const char shadow[] =
+	"{\"state\":{\"reported\":{\"firmware\":\"1.4.2\",\"connectivity\":{\"rssi\":-71,\"network\":\"lte-m\"},"
+	"\"sensors\":{\"temperature\":21.87,\"humidity\":39.95,\"pressure\":1012.98,\"vibration\":0.034},"
+	"\"maintenance\":{\"lastService\":\"2023-10-02\",\"hoursSinceService\":1180,\"nextServiceDue\":\"2024-04-02\"},"
+	"\"alarms\":[]}},\"clientToken\":\"press14-000412\",\"version\":412}";
+
+typedef struct {
+	const char *pName;
+	const unsigned char *pData;
+	size_t len;
+} BenchmarkPayload_t;
+
+typedef struct {
+	const char *pName;
+	IoT_Payload_Codec_t *pCodec;
+} BenchmarkMethod_t;
+
+typedef struct {
+	const BenchmarkMethod_t *pMethod;
+	const BenchmarkPayload_t *pPayload;
+	unsigned char encoded[BENCHMARK_COMPRESSION_BUFFER_LEN];
+	size_t encodedLen;
+	unsigned char decoded[BENCHMARK_COMPRESSION_BUFFER_LEN];
+} BenchmarkCompression_t;
+
+static unsigned char batchPayload[BENCHMARK_COMPRESSION_BUFFER_LEN];
+static IoT_LZ_Codec_Context_t lzContext;
+static IoT_LZ_Codec_Context_t lzDictionaryContext;
+static IoT_Payload_Codec_t lzCodec;
+static IoT_Payload_Codec_t lzDictionaryCodec;
+static BenchmarkCompression_t compression;
+
+#ifdef BENCHMARK_WITH_ZLIB
+/* Raw deflate with a preset dictionary, the streams are set up once and reset for every payload */
+typedef struct {
+	z_stream deflateStream;
+	z_stream inflateStream;
+	const unsigned char *pDictionary;
+	size_t dictionaryLen;
+} BenchmarkZlibContext_t;
+
+static BenchmarkZlibContext_t zlibContext;
+static IoT_Payload_Codec_t zlibCodec;
+
+static IoT_Error_t benchmark_zlib_encode(void *pContext, const unsigned char *pIn, size_t inLen, unsigned char *pOut,
+										 size_t outLen, size_t *pWrittenLen) {
+	BenchmarkZlibContext_t *pZlib = (BenchmarkZlibContext_t *) pContext;
+	z_stream *pStream = &(pZlib->deflateStream);
+
+	if(Z_OK != deflateReset(pStream) ||
+	   Z_OK != deflateSetDictionary(pStream, pZlib->pDictionary, (uInt) pZlib->dictionaryLen)) {
+		return FAILURE;
+	}
+	pStream->next_in = (Bytef *) pIn;
+	pStream->avail_in = (uInt) inLen;
+	pStream->next_out = pOut;
+	pStream->avail_out = (uInt) outLen;
+	if(Z_STREAM_END != deflate(pStream, Z_FINISH)) {
+		return MAX_SIZE_ERROR;
+	}
+	*pWrittenLen = outLen - pStream->avail_out;
+
+	return SUCCESS;
+}
+
+static IoT_Error_t benchmark_zlib_decode(void *pContext, const unsigned char *pIn, size_t inLen, unsigned char *pOut,
+										 size_t outLen, size_t *pWrittenLen) {
+	BenchmarkZlibContext_t *pZlib = (BenchmarkZlibContext_t *) pContext;
+	z_stream *pStream = &(pZlib->inflateStream);
+
+	if(Z_OK != inflateReset(pStream) ||
+	   Z_OK != inflateSetDictionary(pStream, pZlib->pDictionary, (uInt) pZlib->dictionaryLen)) {
+		return FAILURE;
+	}
+	pStream->next_in = (Bytef *) pIn;
+	pStream->avail_in = (uInt) inLen;
+	pStream->next_out = pOut;
+	pStream->avail_out = (uInt) outLen;
+	if(Z_STREAM_END != inflate(pStream, Z_FINISH)) {
+		return FAILURE;
+	}
+	*pWrittenLen = outLen - pStream->avail_out;
+
+	return SUCCESS;
+}
+
+static int benchmark_zlib_codec_init(void) {
+	memset(&zlibContext, 0, sizeof(zlibContext));
+	zlibContext.pDictionary = (const unsigned char *) dictionary;
+	zlibContext.dictionaryLen = strlen(dictionary);
+	if(Z_OK != deflateInit2(&(zlibContext.deflateStream), Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+							Z_DEFAULT_STRATEGY) ||
+	   Z_OK != inflateInit2(&(zlibContext.inflateStream), -15)) {
+		return -1;
+	}
+	zlibCodec.encode = benchmark_zlib_encode;
+	zlibCodec.decode = benchmark_zlib_decode;
+	zlibCodec.pContext = &zlibContext;
+
+	return 0;
+}
+#endif
+
+static int aws_iot_benchmark_compression_encode(void *pContext, uint32_t iterations) {
+	BenchmarkCompression_t *pCompression = (BenchmarkCompression_t *) pContext;
+	IoT_Payload_Codec_t *pCodec = pCompression->pMethod->pCodec;
+	uint32_t i;
+
+	for(i = 0; i < iterations; i++) {
+		if(SUCCESS != pCodec->encode(pCodec->pContext, pCompression->pPayload->pData, pCompression->pPayload->len,
+									 pCompression->encoded, sizeof(pCompression->encoded),
+									 &(pCompression->encodedLen))) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int aws_iot_benchmark_compression_decode(void *pContext, uint32_t iterations) {
+	BenchmarkCompression_t *pCompression = (BenchmarkCompression_t *) pContext;
+	IoT_Payload_Codec_t *pCodec = pCompression->pMethod->pCodec;
+	size_t decodedLen;
+	uint32_t i;
+
+	for(i = 0; i < iterations; i++) {
+		if(SUCCESS != pCodec->decode(pCodec->pContext, pCompression->encoded, pCompression->encodedLen,
+									 pCompression->decoded, sizeof(pCompression->decoded), &decodedLen) ||
+		   decodedLen != pCompression->pPayload->len) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* Time per KB of payload over a fixed number of passes */
+static double aws_iot_benchmark_compression_ns_per_kb(BenchmarkFunction_t function, size_t payloadLen) {
+	uint64_t start = aws_iot_benchmark_now_ns();
+
+	if(0 != function(&compression, BENCHMARK_COMPRESSION_PASSES)) {
+		return -1.0;
+	}
+
+	return (double) (aws_iot_benchmark_now_ns() - start) * 1024.0 /
+		   ((double) BENCHMARK_COMPRESSION_PASSES * (double) payloadLen);
+}
+
+static int aws_iot_benchmark_compression_run(const BenchmarkMethod_t *pMethod, const BenchmarkPayload_t *pPayload) {
+	char name[64];
+	int rc = 0;
+
+	compression.pMethod = pMethod;
+	compression.pPayload = pPayload;
+
+	/* Check the round trip once before timing anything */
+	if(0 != aws_iot_benchmark_compression_encode(&compression, 1) ||
+	   0 != aws_iot_benchmark_compression_decode(&compression, 1) ||
+	   0 != memcmp(compression.decoded, pPayload->pData, pPayload->len)) {
+		printf("%s round trip of %s failed\n", pMethod->pName, pPayload->pName);
+		return -1;
+	}
+
+	snprintf(name, sizeof(name), "%s_%s_bytes", pMethod->pName, pPayload->pName);
+	aws_iot_benchmark_record_metric(name, "bytes", (double) compression.encodedLen);
+	snprintf(name, sizeof(name), "%s_%s_saved", pMethod->pName, pPayload->pName);
+	aws_iot_benchmark_record_metric(name, "%",
+									100.0 * (1.0 - (double) compression.encodedLen / (double) pPayload->len));
+	snprintf(name, sizeof(name), "%s_%s_encode_ns_per_kb", pMethod->pName, pPayload->pName);
+	aws_iot_benchmark_record_metric(name, "ns/KB",
+									aws_iot_benchmark_compression_ns_per_kb(aws_iot_benchmark_compression_encode,
+																			pPayload->len));
+	snprintf(name, sizeof(name), "%s_%s_decode_ns_per_kb", pMethod->pName, pPayload->pName);
+	aws_iot_benchmark_record_metric(name, "ns/KB",
+									aws_iot_benchmark_compression_ns_per_kb(aws_iot_benchmark_compression_decode,
+																			pPayload->len));
+
+	snprintf(name, sizeof(name), "%s_%s_encode", pMethod->pName, pPayload->pName);
+	rc |= aws_iot_benchmark_run(name, aws_iot_benchmark_compression_encode, &compression);
+	snprintf(name, sizeof(name), "%s_%s_decode", pMethod->pName, pPayload->pName);
+	rc |= aws_iot_benchmark_run(name, aws_iot_benchmark_compression_decode, &compression);
+
+	return rc;
+}
+
+/* A JSON array of telemetry samples with changing values, like a batch from aws_iot_mqtt_batch.h */
+static size_t aws_iot_benchmark_compression_make_batch(void) {
+	size_t len = 0;
+	uint32_t i;
+
+	batchPayload[len++] = '[';
+	for(i = 0; i < BENCHMARK_COMPRESSION_BATCH_SAMPLES; i++) {
+		len += (size_t) snprintf((char *) &batchPayload[len], sizeof(batchPayload) - len,
+								 "%s{\"ts\":%u,\"deviceId\":\"press14\",\"temperature\":%.2f,\"humidity\":%.2f,"
+								 "\"pressure\":%.2f,\"vibration\":%.3f,\"status\":\"running\"}",
+								 (0 == i) ? "" : ",", 1700000000u + i, 21.5 + 0.07 * (i % 9), 40.1 - 0.03 * (i % 13),
+								 1013.25 - 0.11 * (i % 7), 0.02 + 0.003 * (i % 5));
+	}
+	batchPayload[len++] = ']';
+
+	return len;
+}
+
+int main(int argc, char **argv) {
+	BenchmarkPayload_t payloads[3];
+	BenchmarkMethod_t methods[3];
+	uint32_t methodCount = 0;
+	uint32_t i, j;
+	int rc = 0;
+
+	aws_iot_benchmark_init("compression", argc, argv);
+
+	payloads[0].pName = "telemetry";
+	payloads[0].pData = (const unsigned char *) telemetry;
+	payloads[0].len = strlen(telemetry);
+	payloads[1].pName = "shadow";
+	payloads[1].pData = (const unsigned char *) shadow;
+	payloads[1].len = strlen(shadow);
+	payloads[2].pName = "batch";
+	payloads[2].pData = batchPayload;
+	payloads[2].len = aws_iot_benchmark_compression_make_batch();
+
+	if(SUCCESS != aws_iot_mqtt_lz_codec_init(&lzCodec, &lzContext, NULL, 0) ||
+	   SUCCESS != aws_iot_mqtt_lz_codec_init(&lzDictionaryCodec, &lzDictionaryContext,
+											 (const unsigned char *) dictionary, strlen(dictionary))) {
+		printf("aws_iot_mqtt_lz_codec_init failed\n");
+		return 1;
+	}
+	methods[methodCount].pName = "lz";
+	methods[methodCount++].pCodec = &lzCodec;
+	methods[methodCount].pName = "lz_dict";
+	methods[methodCount++].pCodec = &lzDictionaryCodec;
+#ifdef BENCHMARK_WITH_ZLIB
+	if(0 != benchmark_zlib_codec_init()) {
+		printf("zlib init failed\n");
+		return 1;
+	}
+	methods[methodCount].pName = "zlib_dict";
+	methods[methodCount++].pCodec = &zlibCodec;
+#endif
+
+	for(i = 0; i < sizeof(payloads) / sizeof(payloads[0]); i++) {
+		aws_iot_benchmark_record_metric(payloads[i].pName, "bytes", (double) payloads[i].len);
+		for(j = 0; j < methodCount; j++) {
+			rc |= aws_iot_benchmark_compression_run(&methods[j], &payloads[i]);
+		}
+	}
+
+	rc |= aws_iot_benchmark_finish();
+
+	return (0 == rc) ? 0 : 1;
+}
@@ -0,0 +1,249 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_connection_pool.c
+ * @brief Publish throughput of a connection pool against the benchmark broker
+ *
+ * Publishes as fast as possible on a fixed set of topics through pools of 1, 2, 4 and 8
+ * connections. Every connection has its own thread, which publishes the topics the pool routes
+ * to that connection, so the publishes on one topic stay in order. Run against a broker with a
+ * per connection publish quota (-Q) this shows how far the pool gets past the limit of one
+ * connection, without a quota it shows how the SDK itself scales with connections.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_connection_pool.h"
+#include "aws_iot_benchmark_harness.h"
+
+#define BENCHMARK_SHARD_MAX_TOPICS 256
+#define BENCHMARK_SHARD_TOPIC_PREFIX "sdk/benchmark/pool/"
+#define BENCHMARK_SHARD_TOPIC_LEN 64
+#define BENCHMARK_SHARD_PAYLOAD_LEN 64
+
+typedef struct {
+	const char *pHost;
+	uint16_t port;
+	uint32_t maxConnections;
+	uint32_t topicCount;
+	uint32_t durationSec;
+	QoS qos;
+} BenchmarkShardConfig_t;
+
+typedef struct {
+	IoT_MQTT_Connection_Pool_t *pPool;
+	uint32_t index;
+	uint64_t deadlineNs;
+	uint64_t published;
+	uint64_t publishFailures;
+	uint32_t topicCount; ///< Topics routed to this connection
+} BenchmarkShardWorker_t;
+
+static BenchmarkShardConfig_t config;
+static char topics[BENCHMARK_SHARD_MAX_TOPICS][BENCHMARK_SHARD_TOPIC_LEN];
+
+static void *aws_iot_benchmark_shard_thread(void *pArg) {
+	BenchmarkShardWorker_t *pWorker = (BenchmarkShardWorker_t *) pArg;
+	AWS_IoT_Client *pClient = aws_iot_mqtt_connection_pool_get_client(pWorker->pPool, pWorker->index);
+	unsigned char payload[BENCHMARK_SHARD_PAYLOAD_LEN];
+	IoT_Publish_Message_Params params;
+	uint16_t own[BENCHMARK_SHARD_MAX_TOPICS];
+	uint32_t i, next = 0;
+	uint16_t topicLen;
+	IoT_Error_t rc;
+
+	for(i = 0; i < config.topicCount; i++) {
+		if(pWorker->index == aws_iot_mqtt_connection_pool_route(pWorker->pPool, topics[i],
+																(uint16_t) strlen(topics[i]))) {
+			own[pWorker->topicCount++] = (uint16_t) i;
+		}
+	}
+	if(0 == pWorker->topicCount) {
+		return NULL;
+	}
+
+	memset(payload, 'x', sizeof(payload));
+	params.qos = config.qos;
+	params.isRetained = 0;
+	params.payload = payload;
+	params.payloadLen = sizeof(payload);
+
+	while(aws_iot_benchmark_now_ns() < pWorker->deadlineNs) {
+		i = own[next];
+		next = (next + 1) % pWorker->topicCount;
+		topicLen = (uint16_t) strlen(topics[i]);
+		rc = aws_iot_mqtt_connection_pool_publish(pWorker->pPool, topics[i], topicLen, &params);
+		if(SUCCESS == rc) {
+			pWorker->published++;
+		} else {
+			pWorker->publishFailures++;
+			/* Lets the client reconnect or read the PUBACK that timed out */
+			(void) aws_iot_mqtt_yield(pClient, 1);
+		}
+	}
+
+	return NULL;
+}
+
+static int aws_iot_benchmark_shard_run(uint32_t connectionCount) {
+	IoT_Client_Init_Params initParams = iotClientInitParamsDefault;
+	IoT_Client_Connect_Params connectParams = iotClientConnectParamsDefault;
+	AWS_IoT_Client clients[AWS_IOT_MQTT_POOL_MAX_CONNECTIONS];
+	BenchmarkShardWorker_t workers[AWS_IOT_MQTT_POOL_MAX_CONNECTIONS];
+	pthread_t threads[AWS_IOT_MQTT_POOL_MAX_CONNECTIONS];
+	IoT_MQTT_Connection_Pool_t pool;
+	uint64_t start, elapsed, published = 0, failures = 0;
+	uint32_t i, minTopics = UINT32_MAX, maxTopics = 0;
+	char clientId[] = "C-SDK_Pool";
+	char name[64];
+	double throughput;
+	IoT_Error_t rc;
+
+	initParams.pHostURL = (char *) config.pHost;
+	initParams.port = config.port;
+	/* Not used by the TCP network layer, but required by aws_iot_mqtt_init */
+	initParams.pRootCALocation = AWS_IOT_ROOT_CA_FILENAME;
+	initParams.pDeviceCertLocation = AWS_IOT_CERTIFICATE_FILENAME;
+	initParams.pDevicePrivateKeyLocation = AWS_IOT_PRIVATE_KEY_FILENAME;
+	initParams.mqttCommandTimeout_ms = 5000;
+	initParams.tlsHandshakeTimeout_ms = 5000;
+	initParams.isSSLHostnameVerify = false;
+	initParams.enableAutoReconnect = true;
+	initParams.isBlockOnThreadLockEnabled = true;
+	rc = aws_iot_mqtt_connection_pool_init(&pool, clients, connectionCount, &initParams);
+	if(SUCCESS != rc) {
+		printf("aws_iot_mqtt_connection_pool_init failed: %d\n", rc);
+		return -1;
+	}
+
+	connectParams.keepAliveIntervalInSec = 30;
+	connectParams.pClientID = clientId;
+	connectParams.clientIDLen = (uint16_t) strlen(clientId);
+	rc = aws_iot_mqtt_connection_pool_connect(&pool, &connectParams);
+	if(SUCCESS != rc) {
+		printf("aws_iot_mqtt_connection_pool_connect failed: %d\n", rc);
+		(void) aws_iot_mqtt_connection_pool_free(&pool);
+		return -1;
+	}
+
+	memset(workers, 0, sizeof(workers));
+	start = aws_iot_benchmark_now_ns();
+	for(i = 0; i < connectionCount; i++) {
+		workers[i].pPool = &pool;
+		workers[i].index = i;
+		workers[i].deadlineNs = start + ((uint64_t) config.durationSec * 1000000000ULL);
+		if(0 != pthread_create(&threads[i], NULL, aws_iot_benchmark_shard_thread, &workers[i])) {
+			printf("Unable to start connection %u\n", i);
+			return -1;
+		}
+	}
+
+	for(i = 0; i < connectionCount; i++) {
+		(void) pthread_join(threads[i], NULL);
+		published += workers[i].published;
+		failures += workers[i].publishFailures;
+		minTopics = (workers[i].topicCount < minTopics) ? workers[i].topicCount : minTopics;
+		maxTopics = (workers[i].topicCount > maxTopics) ? workers[i].topicCount : maxTopics;
+	}
+	elapsed = aws_iot_benchmark_now_ns() - start;
+
+	(void) aws_iot_mqtt_connection_pool_disconnect(&pool);
+	(void) aws_iot_mqtt_connection_pool_free(&pool);
+
+	throughput = (double) published * 1e9 / (double) elapsed;
+	printf("connections: %u, topics per connection: %u to %u, published: %llu, failed publishes: %llu, "
+		   "throughput: %.0f msgs/s\n", connectionCount, minTopics, maxTopics, (unsigned long long) published,
+		   (unsigned long long) failures, throughput);
+
+	snprintf(name, sizeof(name), "publish_qos%d_%uc", (int) config.qos, connectionCount);
+	aws_iot_benchmark_record_metric(name, "msgs/s", throughput);
+	snprintf(name, sizeof(name), "failed_publishes_%uc", connectionCount);
+	aws_iot_benchmark_record_metric(name, "count", (double) failures);
+
+	return 0;
+}
+
+static void aws_iot_benchmark_shard_usage(const char *pName) {
+	printf("Usage: %s [-h host] [-p port] [-n max_connections] [-t topics] [-d duration_sec] [-q qos]"
+		   " [-o results.json]\n", pName);
+}
+
+int main(int argc, char **argv) {
+	uint32_t i, connectionCount;
+	int opt;
+
+	config.pHost = "localhost";
+	config.port = 1883;
+	config.maxConnections = AWS_IOT_MQTT_POOL_MAX_CONNECTIONS;
+	config.topicCount = 64;
+	config.durationSec = 2;
+	config.qos = QOS1;
+
+	while(-1 != (opt = getopt(argc, argv, "h:p:n:t:d:q:o:f:"))) {
+		switch(opt) {
+			case 'h':
+				config.pHost = optarg;
+				break;
+			case 'p':
+				config.port = (uint16_t) atoi(optarg);
+				break;
+			case 'n':
+				config.maxConnections = (uint32_t) atoi(optarg);
+				break;
+			case 't':
+				config.topicCount = (uint32_t) atoi(optarg);
+				break;
+			case 'd':
+				config.durationSec = (uint32_t) atoi(optarg);
+				break;
+			case 'q':
+				config.qos = (0 == atoi(optarg)) ? QOS0 : QOS1;
+				break;
+			case 'o':
+			case 'f':
+				/* Handled by the harness */
+				break;
+			default:
+				aws_iot_benchmark_shard_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if(0 == config.maxConnections || AWS_IOT_MQTT_POOL_MAX_CONNECTIONS < config.maxConnections ||
+	   0 == config.topicCount || BENCHMARK_SHARD_MAX_TOPICS < config.topicCount || 0 == config.durationSec) {
+		aws_iot_benchmark_shard_usage(argv[0]);
+		return 1;
+	}
+
+	aws_iot_benchmark_init("connection_pool", argc, argv);
+
+	for(i = 0; i < config.topicCount; i++) {
+		snprintf(topics[i], sizeof(topics[i]), BENCHMARK_SHARD_TOPIC_PREFIX "%u", i);
+	}
+
+	for(connectionCount = 1; connectionCount <= config.maxConnections; connectionCount *= 2) {
+		if(0 != aws_iot_benchmark_shard_run(connectionCount)) {
+			return 1;
+		}
+	}
+
+	return aws_iot_benchmark_finish();
+}
@@ -0,0 +1,258 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_connections.c
+ * @brief Publish rate and system calls per message of many connections in one thread
+ *
+ * Connects a large number of clients to the benchmark broker and publishes QoS0 from one
+ * thread as fast as possible, one publish per client in every round, the way a gateway
+ * forwards the data of its devices. Built once with the plain TCP network layer and once with
+ * the io_uring layer (BENCHMARK_NETWORK_IO_URING), which keeps a receive posted for every
+ * connection and stages the writes. The io_uring build submits the sends of a round with one
+ * iot_uring_flush and waits for the last ones to be sent before it stops the clock.
+ * Reports the publish rate, the system calls of the network layer per message and the CPU time
+ * of this process per message, which includes the work the kernel does for the sends.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_benchmark_harness.h"
+
+#define BENCHMARK_CONNECTIONS_MAX 1024
+#define BENCHMARK_CONNECTIONS_TOPIC_PREFIX "sdk/benchmark/connections/"
+#define BENCHMARK_CONNECTIONS_TOPIC_LEN 64
+#define BENCHMARK_CONNECTIONS_CLIENT_ID_LEN 32
+#define BENCHMARK_CONNECTIONS_MAX_PAYLOAD_LEN 256
+
+#ifdef BENCHMARK_NETWORK_IO_URING
+#define BENCHMARK_CONNECTIONS_NETWORK "io_uring"
+#else
+#define BENCHMARK_CONNECTIONS_NETWORK "tcp"
+#endif
+
+typedef struct {
+	const char *pHost;
+	uint16_t port;
+	uint32_t connectionCount;
+	uint32_t durationSec;
+	uint32_t payloadLen;
+} BenchmarkConnectionsConfig_t;
+
+static BenchmarkConnectionsConfig_t config;
+static AWS_IoT_Client clients[BENCHMARK_CONNECTIONS_MAX];
+static char topics[BENCHMARK_CONNECTIONS_MAX][BENCHMARK_CONNECTIONS_TOPIC_LEN];
+static char clientIds[BENCHMARK_CONNECTIONS_MAX][BENCHMARK_CONNECTIONS_CLIENT_ID_LEN];
+
+static uint64_t aws_iot_benchmark_connections_syscalls(void) {
+#ifdef BENCHMARK_NETWORK_IO_URING
+	IoT_Uring_Stats_t stats;
+
+	iot_uring_get_stats(&stats);
+	return stats.enters;
+#else
+	return aws_iot_benchmark_network_tcp_syscalls();
+#endif
+}
+
+/* User and system CPU time of the whole process */
+static uint64_t aws_iot_benchmark_connections_cpu_ns(void) {
+	struct rusage usage;
+
+	if(0 != getrusage(RUSAGE_SELF, &usage)) {
+		return 0;
+	}
+
+	return ((uint64_t) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL) +
+		   ((uint64_t) (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL);
+}
+
+static int aws_iot_benchmark_connections_connect(void) {
+	IoT_Client_Init_Params initParams = iotClientInitParamsDefault;
+	IoT_Client_Connect_Params connectParams = iotClientConnectParamsDefault;
+	uint32_t i;
+	IoT_Error_t rc;
+
+	initParams.pHostURL = (char *) config.pHost;
+	initParams.port = config.port;
+	/* Not used by the plain network layers, but required by aws_iot_mqtt_init */
+	initParams.pRootCALocation = AWS_IOT_ROOT_CA_FILENAME;
+	initParams.pDeviceCertLocation = AWS_IOT_CERTIFICATE_FILENAME;
+	initParams.pDevicePrivateKeyLocation = AWS_IOT_PRIVATE_KEY_FILENAME;
+	initParams.mqttCommandTimeout_ms = 5000;
+	initParams.tlsHandshakeTimeout_ms = 5000;
+	initParams.isSSLHostnameVerify = false;
+	initParams.enableAutoReconnect = false;
+
+	/* Nothing is yielded while publishing, keep alive must not expire during the run */
+	connectParams.keepAliveIntervalInSec = 600;
+
+	for(i = 0; i < config.connectionCount; i++) {
+		rc = aws_iot_mqtt_init(&clients[i], &initParams);
+		if(SUCCESS != rc) {
+			printf("aws_iot_mqtt_init failed for connection %u: %d\n", i, rc);
+			return -1;
+		}
+
+		snprintf(clientIds[i], sizeof(clientIds[i]), "C-SDK_Connections-%u", i);
+		connectParams.pClientID = clientIds[i];
+		connectParams.clientIDLen = (uint16_t) strlen(clientIds[i]);
+		rc = aws_iot_mqtt_connect(&clients[i], &connectParams);
+		if(SUCCESS != rc) {
+			printf("aws_iot_mqtt_connect failed for connection %u: %d\n", i, rc);
+			return -1;
+		}
+
+		snprintf(topics[i], sizeof(topics[i]), BENCHMARK_CONNECTIONS_TOPIC_PREFIX "%u", i);
+	}
+
+	return 0;
+}
+
+#ifdef BENCHMARK_NETWORK_IO_URING
+/* Submits the staged sends until the kernel has reported all of them sent, or the deadline passes */
+static void aws_iot_benchmark_connections_drain(uint64_t deadline) {
+	IoT_Uring_Stats_t stats;
+
+	do {
+		(void) iot_uring_flush();
+		iot_uring_get_stats(&stats);
+	} while(stats.bytesSent < stats.bytesStaged && aws_iot_benchmark_now_ns() < deadline);
+}
+#endif
+
+static void aws_iot_benchmark_connections_run(void) {
+	unsigned char payload[BENCHMARK_CONNECTIONS_MAX_PAYLOAD_LEN];
+	IoT_Publish_Message_Params params;
+	uint64_t start, deadline, elapsed, syscallsStart, syscalls, cpuStart, cpu;
+	uint64_t published = 0, failures = 0, rounds = 0;
+	double throughput, syscallsPerMessage, cpuPerMessage;
+	uint32_t i;
+
+	memset(payload, 'x', sizeof(payload));
+	params.qos = QOS0;
+	params.isRetained = 0;
+	params.payload = payload;
+	params.payloadLen = config.payloadLen;
+
+	syscallsStart = aws_iot_benchmark_connections_syscalls();
+	cpuStart = aws_iot_benchmark_connections_cpu_ns();
+	start = aws_iot_benchmark_now_ns();
+	deadline = start + ((uint64_t) config.durationSec * 1000000000ULL);
+
+	while(aws_iot_benchmark_now_ns() < deadline) {
+		for(i = 0; i < config.connectionCount; i++) {
+			if(SUCCESS == aws_iot_mqtt_publish(&clients[i], topics[i], (uint16_t) strlen(topics[i]), &params)) {
+				published++;
+			} else {
+				failures++;
+			}
+		}
+#ifdef BENCHMARK_NETWORK_IO_URING
+		(void) iot_uring_flush();
+#endif
+		rounds++;
+	}
+#ifdef BENCHMARK_NETWORK_IO_URING
+	aws_iot_benchmark_connections_drain(aws_iot_benchmark_now_ns() + 5000000000ULL);
+#endif
+
+	elapsed = aws_iot_benchmark_now_ns() - start;
+	syscalls = aws_iot_benchmark_connections_syscalls() - syscallsStart;
+	cpu = aws_iot_benchmark_connections_cpu_ns() - cpuStart;
+
+	throughput = (double) published * 1e9 / (double) elapsed;
+	syscallsPerMessage = (0 < published) ? (double) syscalls / (double) published : 0.0;
+	cpuPerMessage = (0 < published) ? (double) cpu / 1000.0 / (double) published : 0.0;
+	printf("network: %s, connections: %u, rounds: %llu, published: %llu, failed publishes: %llu\n",
+		   BENCHMARK_CONNECTIONS_NETWORK, config.connectionCount, (unsigned long long) rounds,
+		   (unsigned long long) published, (unsigned long long) failures);
+	printf("throughput: %.0f msgs/s, system calls: %llu, %.4f per message, CPU time: %.2f us per message\n",
+		   throughput, (unsigned long long) syscalls, syscallsPerMessage, cpuPerMessage);
+
+	aws_iot_benchmark_record_metric("publish_qos0", "msgs/s", throughput);
+	aws_iot_benchmark_record_metric("syscalls_per_message", "count", syscallsPerMessage);
+	aws_iot_benchmark_record_metric("cpu_per_message", "us", cpuPerMessage);
+	aws_iot_benchmark_record_metric("failed_publishes", "count", (double) failures);
+}
+
+static void aws_iot_benchmark_connections_usage(const char *pName) {
+	printf("Usage: %s [-h host] [-p port] [-n connections] [-d duration_sec] [-s payload_len]"
+		   " [-o results.json]\n", pName);
+}
+
+int main(int argc, char **argv) {
+	uint32_t i;
+	int opt;
+
+	config.pHost = "localhost";
+	config.port = 1883;
+	config.connectionCount = 1000;
+	config.durationSec = 5;
+	config.payloadLen = 64;
+
+	while(-1 != (opt = getopt(argc, argv, "h:p:n:d:s:o:f:"))) {
+		switch(opt) {
+			case 'h':
+				config.pHost = optarg;
+				break;
+			case 'p':
+				config.port = (uint16_t) atoi(optarg);
+				break;
+			case 'n':
+				config.connectionCount = (uint32_t) atoi(optarg);
+				break;
+			case 'd':
+				config.durationSec = (uint32_t) atoi(optarg);
+				break;
+			case 's':
+				config.payloadLen = (uint32_t) atoi(optarg);
+				break;
+			case 'o':
+			case 'f':
+				/* Handled by the harness */
+				break;
+			default:
+				aws_iot_benchmark_connections_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if(0 == config.connectionCount || BENCHMARK_CONNECTIONS_MAX < config.connectionCount ||
+	   0 == config.durationSec || BENCHMARK_CONNECTIONS_MAX_PAYLOAD_LEN < config.payloadLen) {
+		aws_iot_benchmark_connections_usage(argv[0]);
+		return 1;
+	}
+
+	aws_iot_benchmark_init("connections_" BENCHMARK_CONNECTIONS_NETWORK, argc, argv);
+
+	if(0 != aws_iot_benchmark_connections_connect()) {
+		return 1;
+	}
+
+	aws_iot_benchmark_connections_run();
+
+	for(i = 0; i < config.connectionCount; i++) {
+		(void) aws_iot_mqtt_disconnect(&clients[i]);
+		(void) aws_iot_mqtt_free(&clients[i]);
+	}
+
+	return aws_iot_benchmark_finish();
+}
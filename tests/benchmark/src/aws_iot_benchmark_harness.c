@@ -0,0 +1,310 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_harness.c
+ * @brief Timing and reporting harness shared by the benchmarks
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "aws_iot_benchmark_harness.h"
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+#define BENCHMARK_THREAD_SUPPORT "on"
+#else
+#define BENCHMARK_THREAD_SUPPORT "off"
+#endif
+
+typedef struct {
+	char name[64];
+	uint64_t iterations;
+	double nsPerOp;
+	double minNsPerOp;
+	double allocsPerOp;
+	uint32_t latencySamples; ///< 0 unless recorded with aws_iot_benchmark_record_latency
+	uint64_t p50Ns;
+	uint64_t p99Ns;
+	uint64_t p999Ns;
+} BenchmarkResult_t;
+
+typedef struct {
+	char name[64];
+	char unit[16];
+	double value;
+} BenchmarkMetric_t;
+
+static const char *pBenchmarkSuiteName = "";
+static const char *pBenchmarkOutputFile = NULL;
+static const char *pBenchmarkFilter = NULL;
+static BenchmarkResult_t benchmarkResults[BENCHMARK_MAX_RESULTS];
+static uint32_t benchmarkResultCount;
+static BenchmarkMetric_t benchmarkMetrics[BENCHMARK_MAX_RESULTS];
+static uint32_t benchmarkMetricCount;
+static int benchmarkFailed;
+
+static volatile uint64_t allocationCount;
+
+/* Link time wrappers, see -Wl,--wrap in the Makefile */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size) {
+	allocationCount++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size) {
+	allocationCount++;
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+	allocationCount++;
+	return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr) {
+	__real_free(ptr);
+}
+
+uint64_t aws_iot_benchmark_now_ns(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((uint64_t) now.tv_sec * 1000000000ULL) + (uint64_t) now.tv_nsec;
+}
+
+uint64_t aws_iot_benchmark_allocation_count(void) {
+	return allocationCount;
+}
+
+void aws_iot_benchmark_init(const char *pSuiteName, int argc, char **argv) {
+	int i;
+
+	pBenchmarkSuiteName = pSuiteName;
+	benchmarkResultCount = 0;
+	benchmarkMetricCount = 0;
+	benchmarkFailed = 0;
+
+	for(i = 1; i < argc; i++) {
+		if(0 == strcmp(argv[i], "-o") && i + 1 < argc) {
+			pBenchmarkOutputFile = argv[++i];
+		} else if(0 == strcmp(argv[i], "-f") && i + 1 < argc) {
+			pBenchmarkFilter = argv[++i];
+		}
+	}
+
+	printf("%-36s %-7s %12s %12s %12s %10s\n", pBenchmarkSuiteName, "threads", "iterations", "ns/op",
+		   "min ns/op", "allocs/op");
+}
+
+int aws_iot_benchmark_is_selected(const char *pName) {
+	return (NULL == pBenchmarkFilter || NULL != strstr(pName, pBenchmarkFilter));
+}
+
+static void aws_iot_benchmark_add_result(const char *pName, uint64_t iterations, double nsPerOp,
+										 double minNsPerOp, double allocsPerOp) {
+	BenchmarkResult_t *pResult;
+
+	printf("%-36s %-7s %12llu %12.1f %12.1f %10.2f\n", pName, BENCHMARK_THREAD_SUPPORT,
+		   (unsigned long long) iterations, nsPerOp, minNsPerOp, allocsPerOp);
+
+	if(BENCHMARK_MAX_RESULTS <= benchmarkResultCount) {
+		printf("Too many results, %s is not written to the output file\n", pName);
+		benchmarkFailed = 1;
+		return;
+	}
+
+	pResult = &benchmarkResults[benchmarkResultCount++];
+	memset(pResult, 0, sizeof(*pResult));
+	snprintf(pResult->name, sizeof(pResult->name), "%s", pName);
+	pResult->iterations = iterations;
+	pResult->nsPerOp = nsPerOp;
+	pResult->minNsPerOp = minNsPerOp;
+	pResult->allocsPerOp = allocsPerOp;
+}
+
+void aws_iot_benchmark_record(const char *pName, uint64_t operations, uint64_t elapsedNs, uint64_t allocations) {
+	double nsPerOp;
+
+	if(0 == operations) {
+		return;
+	}
+
+	nsPerOp = (double) elapsedNs / (double) operations;
+	aws_iot_benchmark_add_result(pName, operations, nsPerOp, nsPerOp, (double) allocations / (double) operations);
+}
+
+void aws_iot_benchmark_record_metric(const char *pName, const char *pUnit, double value) {
+	BenchmarkMetric_t *pMetric;
+
+	printf("%-36s %-7s %12.2f %s\n", pName, BENCHMARK_THREAD_SUPPORT, value, pUnit);
+
+	if(BENCHMARK_MAX_RESULTS <= benchmarkMetricCount) {
+		printf("Too many metrics, %s is not written to the output file\n", pName);
+		benchmarkFailed = 1;
+		return;
+	}
+
+	pMetric = &benchmarkMetrics[benchmarkMetricCount++];
+	snprintf(pMetric->name, sizeof(pMetric->name), "%s", pName);
+	snprintf(pMetric->unit, sizeof(pMetric->unit), "%s", pUnit);
+	pMetric->value = value;
+}
+
+static int aws_iot_benchmark_compare_uint64(const void *pA, const void *pB) {
+	uint64_t a = *(const uint64_t *) pA;
+	uint64_t b = *(const uint64_t *) pB;
+
+	return (a > b) - (a < b);
+}
+
+static uint64_t aws_iot_benchmark_percentile(const uint64_t *pSorted, uint32_t count, uint32_t perMille) {
+	uint64_t index = ((uint64_t) count * perMille) / 1000;
+
+	if(index >= count) {
+		index = count - 1;
+	}
+
+	return pSorted[index];
+}
+
+void aws_iot_benchmark_record_latency(const char *pName, uint64_t operations, uint64_t elapsedNs,
+									  uint64_t *pSamples, uint32_t sampleCount) {
+	BenchmarkResult_t *pResult;
+	uint32_t resultCount = benchmarkResultCount;
+
+	aws_iot_benchmark_record(pName, operations, elapsedNs, 0);
+	if(0 == sampleCount || resultCount == benchmarkResultCount) {
+		return;
+	}
+
+	qsort(pSamples, sampleCount, sizeof(pSamples[0]), aws_iot_benchmark_compare_uint64);
+	pResult = &benchmarkResults[benchmarkResultCount - 1];
+	pResult->latencySamples = sampleCount;
+	pResult->p50Ns = aws_iot_benchmark_percentile(pSamples, sampleCount, 500);
+	pResult->p99Ns = aws_iot_benchmark_percentile(pSamples, sampleCount, 990);
+	pResult->p999Ns = aws_iot_benchmark_percentile(pSamples, sampleCount, 999);
+
+	printf("%-36s latency over %u samples: p50 %llu ns, p99 %llu ns, p99.9 %llu ns\n", pName, sampleCount,
+		   (unsigned long long) pResult->p50Ns, (unsigned long long) pResult->p99Ns,
+		   (unsigned long long) pResult->p999Ns);
+}
+
+static int aws_iot_benchmark_compare_double(const void *pA, const void *pB) {
+	double a = *(const double *) pA;
+	double b = *(const double *) pB;
+
+	return (a > b) - (a < b);
+}
+
+int aws_iot_benchmark_run(const char *pName, BenchmarkFunction_t function, void *pContext) {
+	double samples[BENCHMARK_REPETITIONS];
+	uint64_t start, elapsed, allocations;
+	uint32_t iterations = 1;
+	int i;
+
+	if(!aws_iot_benchmark_is_selected(pName)) {
+		return 0;
+	}
+
+	/* Calibrate, this also warms up caches and branch predictors */
+	for(;;) {
+		start = aws_iot_benchmark_now_ns();
+		if(0 != function(pContext, iterations)) {
+			printf("%s FAILED\n", pName);
+			benchmarkFailed = 1;
+			return -1;
+		}
+		elapsed = aws_iot_benchmark_now_ns() - start;
+		if(elapsed >= BENCHMARK_MIN_RUN_TIME_NS || iterations >= (UINT32_MAX / 2)) {
+			break;
+		}
+		iterations *= 2;
+	}
+
+	allocations = aws_iot_benchmark_allocation_count();
+	for(i = 0; i < BENCHMARK_REPETITIONS; i++) {
+		start = aws_iot_benchmark_now_ns();
+		if(0 != function(pContext, iterations)) {
+			printf("%s FAILED\n", pName);
+			benchmarkFailed = 1;
+			return -1;
+		}
+		elapsed = aws_iot_benchmark_now_ns() - start;
+		samples[i] = (double) elapsed / (double) iterations;
+	}
+	allocations = aws_iot_benchmark_allocation_count() - allocations;
+
+	qsort(samples, BENCHMARK_REPETITIONS, sizeof(samples[0]), aws_iot_benchmark_compare_double);
+	aws_iot_benchmark_add_result(pName, iterations, samples[BENCHMARK_REPETITIONS / 2], samples[0],
+								 (double) allocations / ((double) iterations * BENCHMARK_REPETITIONS));
+
+	return 0;
+}
+
+int aws_iot_benchmark_finish(void) {
+	FILE *pFile;
+	uint32_t i;
+
+	if(NULL == pBenchmarkOutputFile) {
+		return benchmarkFailed;
+	}
+
+	pFile = fopen(pBenchmarkOutputFile, "w");
+	if(NULL == pFile) {
+		printf("Unable to open %s\n", pBenchmarkOutputFile);
+		return 1;
+	}
+
+	fprintf(pFile, "{\n");
+	fprintf(pFile, "  \"suite\": \"%s\",\n", pBenchmarkSuiteName);
+	fprintf(pFile, "  \"threads\": \"%s\",\n", BENCHMARK_THREAD_SUPPORT);
+	fprintf(pFile, "  \"repetitions\": %d,\n", BENCHMARK_REPETITIONS);
+	fprintf(pFile, "  \"failed\": %s,\n", benchmarkFailed ? "true" : "false");
+	fprintf(pFile, "  \"results\": [\n");
+	for(i = 0; i < benchmarkResultCount; i++) {
+		fprintf(pFile, "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.2f, "
+					   "\"min_ns_per_op\": %.2f, \"allocs_per_op\": %.4f",
+				benchmarkResults[i].name, (unsigned long long) benchmarkResults[i].iterations,
+				benchmarkResults[i].nsPerOp, benchmarkResults[i].minNsPerOp, benchmarkResults[i].allocsPerOp);
+		if(0 < benchmarkResults[i].latencySamples) {
+			fprintf(pFile, ", \"latency_samples\": %u, \"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu",
+					benchmarkResults[i].latencySamples, (unsigned long long) benchmarkResults[i].p50Ns,
+					(unsigned long long) benchmarkResults[i].p99Ns, (unsigned long long) benchmarkResults[i].p999Ns);
+		}
+		fprintf(pFile, "}%s\n", (i + 1 < benchmarkResultCount) ? "," : "");
+	}
+	fprintf(pFile, "  ],\n");
+	fprintf(pFile, "  \"metrics\": [\n");
+	for(i = 0; i < benchmarkMetricCount; i++) {
+		fprintf(pFile, "    {\"name\": \"%s\", \"value\": %.4f, \"unit\": \"%s\"}%s\n", benchmarkMetrics[i].name,
+				benchmarkMetrics[i].value, benchmarkMetrics[i].unit, (i + 1 < benchmarkMetricCount) ? "," : "");
+	}
+	fprintf(pFile, "  ]\n");
+	fprintf(pFile, "}\n");
+
+	if(0 != fclose(pFile)) {
+		return 1;
+	}
+
+	return benchmarkFailed;
+}
@@ -0,0 +1,331 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_load.c
+ * @brief End to end load generator for the benchmark broker
+ *
+ * Runs a number of clients, each with its own AWS_IoT_Client and thread. Every client
+ * subscribes to its own topic and publishes to it at a fixed rate. The send time is
+ * carried in the payload so the round trip latency through the broker can be measured
+ * when the message comes back. Auto reconnect is enabled so that disconnects injected by
+ * the broker are absorbed by the SDK and show up as reconnects in the report.
+ *
+ * The network layer is selected at link time: the Makefile links the plain TCP layer from
+ * network_tcp for load-test and the mbedTLS layer for load-test-tls and load-test-ktls. The
+ * process CPU time per delivered message is reported as well, to compare the record layer in
+ * mbedTLS with the one in the kernel.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_benchmark_harness.h"
+
+#define BENCHMARK_LOAD_MAX_CLIENTS 64
+#define BENCHMARK_LOAD_MAX_SAMPLES (1U << 20) ///< Latency samples kept, later messages are still counted
+#define BENCHMARK_LOAD_TOPIC_PREFIX "sdk/benchmark/load/"
+#define BENCHMARK_LOAD_TOPIC_LEN 64
+#define BENCHMARK_LOAD_MAX_PAYLOAD_LEN 256
+
+typedef struct {
+	const char *pHost;
+	uint16_t port;
+	uint32_t clientCount;
+	uint32_t ratePerClient; ///< Messages per second
+	uint32_t durationSec;
+	QoS qos;
+	size_t payloadLen;
+	char *pRootCA;
+	char *pCert;
+	char *pKey;
+} BenchmarkLoadConfig_t;
+
+typedef struct {
+	uint32_t id;
+	char topic[BENCHMARK_LOAD_TOPIC_LEN];
+	uint64_t deadlineNs;
+	uint64_t published;
+	uint64_t publishFailures;
+	uint64_t received;
+	uint64_t reconnects;
+	int failed;
+} BenchmarkLoadClient_t;
+
+static BenchmarkLoadConfig_t config;
+static BenchmarkLoadClient_t clients[BENCHMARK_LOAD_MAX_CLIENTS];
+static uint64_t latencySamples[BENCHMARK_LOAD_MAX_SAMPLES];
+static uint32_t latencySampleCount;
+
+/* User and system CPU time of the whole process */
+static uint64_t aws_iot_benchmark_load_cpu_ns(void) {
+	struct rusage usage;
+
+	if(0 != getrusage(RUSAGE_SELF, &usage)) {
+		return 0;
+	}
+
+	return ((uint64_t) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL) +
+		   ((uint64_t) (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL);
+}
+
+static void aws_iot_benchmark_load_callback(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+											IoT_Publish_Message_Params *params, void *pData) {
+	BenchmarkLoadClient_t *pLoadClient = (BenchmarkLoadClient_t *) pData;
+	uint64_t sentNs;
+	uint32_t index;
+
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(topicName);
+	IOT_UNUSED(topicNameLen);
+
+	pLoadClient->received++;
+	if(sizeof(sentNs) > params->payloadLen) {
+		return;
+	}
+
+	memcpy(&sentNs, params->payload, sizeof(sentNs));
+	index = __atomic_fetch_add(&latencySampleCount, 1, __ATOMIC_RELAXED);
+	if(BENCHMARK_LOAD_MAX_SAMPLES > index) {
+		latencySamples[index] = aws_iot_benchmark_now_ns() - sentNs;
+	}
+}
+
+static int aws_iot_benchmark_load_connect(AWS_IoT_Client *pClient, BenchmarkLoadClient_t *pLoadClient) {
+	IoT_Client_Init_Params initParams = iotClientInitParamsDefault;
+	IoT_Client_Connect_Params connectParams = iotClientConnectParamsDefault;
+	char clientId[32];
+	IoT_Error_t rc;
+
+	initParams.pHostURL = (char *) config.pHost;
+	initParams.port = config.port;
+	initParams.pRootCALocation = config.pRootCA;
+	initParams.pDeviceCertLocation = config.pCert;
+	initParams.pDevicePrivateKeyLocation = config.pKey;
+	initParams.mqttCommandTimeout_ms = 5000;
+	initParams.tlsHandshakeTimeout_ms = 5000;
+	/* The broker uses a self signed certificate for localhost */
+	initParams.isSSLHostnameVerify = false;
+	initParams.enableAutoReconnect = true;
+	initParams.isBlockOnThreadLockEnabled = true;
+	rc = aws_iot_mqtt_init(pClient, &initParams);
+	if(SUCCESS != rc) {
+		printf("client %u: aws_iot_mqtt_init failed: %d\n", pLoadClient->id, rc);
+		return -1;
+	}
+
+	snprintf(clientId, sizeof(clientId), "C-SDK_Load_%u", pLoadClient->id);
+	connectParams.keepAliveIntervalInSec = 30;
+	connectParams.pClientID = clientId;
+	connectParams.clientIDLen = (uint16_t) strlen(clientId);
+	rc = aws_iot_mqtt_connect(pClient, &connectParams);
+	if(SUCCESS != rc) {
+		printf("client %u: aws_iot_mqtt_connect failed: %d\n", pLoadClient->id, rc);
+		return -1;
+	}
+
+	rc = aws_iot_mqtt_autoreconnect_set_status(pClient, true);
+	if(SUCCESS != rc) {
+		return -1;
+	}
+
+	rc = aws_iot_mqtt_subscribe(pClient, pLoadClient->topic, (uint16_t) strlen(pLoadClient->topic), config.qos,
+								aws_iot_benchmark_load_callback, pLoadClient);
+	if(SUCCESS != rc) {
+		printf("client %u: aws_iot_mqtt_subscribe failed: %d\n", pLoadClient->id, rc);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void *aws_iot_benchmark_load_thread(void *pArg) {
+	BenchmarkLoadClient_t *pLoadClient = (BenchmarkLoadClient_t *) pArg;
+	unsigned char payload[BENCHMARK_LOAD_MAX_PAYLOAD_LEN];
+	IoT_Publish_Message_Params params;
+	AWS_IoT_Client client;
+	uint64_t now, nextPublishNs, intervalNs;
+	IoT_Error_t rc;
+
+	if(0 != aws_iot_benchmark_load_connect(&client, pLoadClient)) {
+		pLoadClient->failed = 1;
+		return NULL;
+	}
+
+	memset(payload, 'x', sizeof(payload));
+	params.qos = config.qos;
+	params.isRetained = 0;
+	params.payload = payload;
+	params.payloadLen = config.payloadLen;
+
+	intervalNs = 1000000000ULL / config.ratePerClient;
+	nextPublishNs = aws_iot_benchmark_now_ns();
+
+	while((now = aws_iot_benchmark_now_ns()) < pLoadClient->deadlineNs) {
+		if(now >= nextPublishNs) {
+			memcpy(payload, &now, sizeof(now));
+			rc = aws_iot_mqtt_publish(&client, pLoadClient->topic, (uint16_t) strlen(pLoadClient->topic), &params);
+			if(SUCCESS == rc) {
+				pLoadClient->published++;
+			} else {
+				pLoadClient->publishFailures++;
+			}
+			nextPublishNs += intervalNs;
+			/* Do not try to catch up after a reconnect, keep the offered rate constant */
+			if(nextPublishNs + 1000000000ULL < now) {
+				nextPublishNs = now;
+			}
+		}
+
+		rc = aws_iot_mqtt_yield(&client, 1);
+		if(NETWORK_RECONNECTED == rc) {
+			pLoadClient->reconnects++;
+		} else if(NETWORK_ATTEMPTING_RECONNECT == rc || NETWORK_DISCONNECTED_ERROR == rc) {
+			/* Wait for the SDK to reconnect, the back-off is handled inside yield */
+			usleep(1000);
+		}
+	}
+
+	/* Collect the messages that are still in flight */
+	(void) aws_iot_mqtt_yield(&client, 100);
+	(void) aws_iot_mqtt_disconnect(&client);
+	(void) aws_iot_mqtt_free(&client);
+
+	return NULL;
+}
+
+static void aws_iot_benchmark_load_usage(const char *pName) {
+	printf("Usage: %s [-h host] [-p port] [-n clients] [-r msgs_per_sec_per_client] [-d duration_sec]\n"
+		   "          [-q qos] [-s payload_len] [-a root_ca -c cert -k key] [-o results.json]\n", pName);
+}
+
+int main(int argc, char **argv) {
+	pthread_t threads[BENCHMARK_LOAD_MAX_CLIENTS];
+	uint64_t start, elapsed, published = 0, failures = 0, received = 0, reconnects = 0;
+	uint64_t cpuStart, cpu;
+	uint32_t i, samples;
+	char name[64];
+	int opt, failed = 0;
+
+	config.pHost = "localhost";
+	config.port = 1883;
+	config.clientCount = 4;
+	config.ratePerClient = 1000;
+	config.durationSec = 5;
+	config.qos = QOS0;
+	config.payloadLen = 64;
+	config.pRootCA = AWS_IOT_ROOT_CA_FILENAME;
+	config.pCert = AWS_IOT_CERTIFICATE_FILENAME;
+	config.pKey = AWS_IOT_PRIVATE_KEY_FILENAME;
+
+	while(-1 != (opt = getopt(argc, argv, "h:p:n:r:d:q:s:a:c:k:o:f:"))) {
+		switch(opt) {
+			case 'h':
+				config.pHost = optarg;
+				break;
+			case 'p':
+				config.port = (uint16_t) atoi(optarg);
+				break;
+			case 'n':
+				config.clientCount = (uint32_t) atoi(optarg);
+				break;
+			case 'r':
+				config.ratePerClient = (uint32_t) atoi(optarg);
+				break;
+			case 'd':
+				config.durationSec = (uint32_t) atoi(optarg);
+				break;
+			case 'q':
+				config.qos = (0 == atoi(optarg)) ? QOS0 : QOS1;
+				break;
+			case 's':
+				config.payloadLen = (size_t) atoi(optarg);
+				break;
+			case 'a':
+				config.pRootCA = optarg;
+				break;
+			case 'c':
+				config.pCert = optarg;
+				break;
+			case 'k':
+				config.pKey = optarg;
+				break;
+			case 'o':
+			case 'f':
+				/* Handled by the harness */
+				break;
+			default:
+				aws_iot_benchmark_load_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if(0 == config.clientCount || BENCHMARK_LOAD_MAX_CLIENTS < config.clientCount || 0 == config.ratePerClient ||
+	   sizeof(uint64_t) > config.payloadLen || BENCHMARK_LOAD_MAX_PAYLOAD_LEN < config.payloadLen) {
+		aws_iot_benchmark_load_usage(argv[0]);
+		return 1;
+	}
+
+	aws_iot_benchmark_init("load", argc, argv);
+
+	cpuStart = aws_iot_benchmark_load_cpu_ns();
+	start = aws_iot_benchmark_now_ns();
+	for(i = 0; i < config.clientCount; i++) {
+		clients[i].id = i;
+		snprintf(clients[i].topic, sizeof(clients[i].topic), BENCHMARK_LOAD_TOPIC_PREFIX "%u", i);
+		clients[i].deadlineNs = start + ((uint64_t) config.durationSec * 1000000000ULL);
+		if(0 != pthread_create(&threads[i], NULL, aws_iot_benchmark_load_thread, &clients[i])) {
+			printf("Unable to start client %u\n", i);
+			return 1;
+		}
+	}
+
+	for(i = 0; i < config.clientCount; i++) {
+		(void) pthread_join(threads[i], NULL);
+		published += clients[i].published;
+		failures += clients[i].publishFailures;
+		received += clients[i].received;
+		reconnects += clients[i].reconnects;
+		failed |= clients[i].failed;
+	}
+	elapsed = aws_iot_benchmark_now_ns() - start;
+	cpu = aws_iot_benchmark_load_cpu_ns() - cpuStart;
+
+	printf("clients: %u, published: %llu, received: %llu, failed publishes: %llu, reconnects: %llu\n",
+		   config.clientCount, (unsigned long long) published, (unsigned long long) received,
+		   (unsigned long long) failures, (unsigned long long) reconnects);
+	printf("throughput: %.0f msgs/s, cpu: %.1f%% of one core\n", (double) received * 1e9 / (double) elapsed,
+		   (double) cpu * 100.0 / (double) elapsed);
+
+	samples = (latencySampleCount < BENCHMARK_LOAD_MAX_SAMPLES) ? latencySampleCount : BENCHMARK_LOAD_MAX_SAMPLES;
+	snprintf(name, sizeof(name), "round_trip_qos%d_%uc_%ur", (int) config.qos, config.clientCount,
+			 config.ratePerClient);
+	aws_iot_benchmark_record_latency(name, received, elapsed, latencySamples, samples);
+	snprintf(name, sizeof(name), "cpu_per_message_qos%d_%uc_%ur", (int) config.qos, config.clientCount,
+			 config.ratePerClient);
+	aws_iot_benchmark_record_metric(name, "us", (0 < received) ? (double) cpu / 1000.0 / (double) received : 0.0);
+
+	if(failed) {
+		printf("One or more clients failed to connect\n");
+		return 1;
+	}
+
+	return aws_iot_benchmark_finish();
+}
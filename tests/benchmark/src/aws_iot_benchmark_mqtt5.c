@@ -0,0 +1,182 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_mqtt5.c
+ * @brief Bytes on the wire of MQTT 3.1.1 and MQTT 5.0 telemetry publishes
+ *
+ * A vehicle publishes small telemetry messages on a handful of long topics. The in-memory
+ * network answers like a broker and resolves the topic aliases of the client, so every
+ * scenario also checks that the server could map every publish back to its topic.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_benchmark_network_memory.h"
+#include "aws_iot_benchmark_harness.h"
+
+#define BENCHMARK_MQTT5_TOPICS 16
+#define BENCHMARK_MQTT5_TOPIC_LEN 64
+#define BENCHMARK_MQTT5_PUBLISHES 10000
+#define BENCHMARK_MQTT5_PAYLOAD "{\"spd\":87.5,\"rpm\":2350}"
+
+typedef struct {
+	const char *pName;
+	MQTT_Ver_t version;
+	uint16_t topicAliasMaximum; ///< Topic Alias Maximum of the server
+	uint32_t topicCount; ///< Topics the publishes cycle through
+} BenchmarkMqtt5Scenario_t;
+
+typedef struct {
+	AWS_IoT_Client client;
+	const BenchmarkMqtt5Scenario_t *pScenario;
+	uint32_t next;
+} BenchmarkMqtt5_t;
+
+static char topics[BENCHMARK_MQTT5_TOPICS][BENCHMARK_MQTT5_TOPIC_LEN];
+
+static int aws_iot_benchmark_mqtt5_setup(BenchmarkMqtt5_t *pContext, const BenchmarkMqtt5Scenario_t *pScenario) {
+	IoT_Client_Init_Params initParams = iotClientInitParamsDefault;
+	IoT_Client_Connect_Params connectParams = iotClientConnectParamsDefault;
+	IoT_Error_t rc;
+
+	aws_iot_benchmark_network_reset();
+	aws_iot_benchmark_network_set_auto_respond(true);
+	aws_iot_benchmark_network_set_topic_alias_maximum(pScenario->topicAliasMaximum);
+	pContext->pScenario = pScenario;
+	pContext->next = 0;
+
+	initParams.pHostURL = AWS_IOT_MQTT_HOST;
+	initParams.port = AWS_IOT_MQTT_PORT;
+	initParams.pRootCALocation = AWS_IOT_ROOT_CA_FILENAME;
+	initParams.pDeviceCertLocation = AWS_IOT_CERTIFICATE_FILENAME;
+	initParams.pDevicePrivateKeyLocation = AWS_IOT_PRIVATE_KEY_FILENAME;
+	initParams.mqttCommandTimeout_ms = 2000;
+	initParams.tlsHandshakeTimeout_ms = 2000;
+	initParams.enableAutoReconnect = false;
+	rc = aws_iot_mqtt_init(&(pContext->client), &initParams);
+	if(SUCCESS != rc) {
+		printf("aws_iot_mqtt_init failed: %d\n", rc);
+		return -1;
+	}
+
+	connectParams.keepAliveIntervalInSec = 600;
+	connectParams.MQTTVersion = pScenario->version;
+	connectParams.pClientID = AWS_IOT_MQTT_CLIENT_ID;
+	connectParams.clientIDLen = (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID);
+	rc = aws_iot_mqtt_connect(&(pContext->client), &connectParams);
+	if(SUCCESS != rc) {
+		printf("aws_iot_mqtt_connect failed: %d\n", rc);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int aws_iot_benchmark_mqtt5_publish(void *pContext, uint32_t iterations) {
+	BenchmarkMqtt5_t *pMqtt5 = (BenchmarkMqtt5_t *) pContext;
+	IoT_Publish_Message_Params params;
+	char *pTopicName;
+	IoT_Error_t rc;
+	uint32_t i;
+
+	params.qos = QOS0;
+	params.isRetained = 0;
+	params.payload = (void *) BENCHMARK_MQTT5_PAYLOAD;
+	params.payloadLen = strlen(BENCHMARK_MQTT5_PAYLOAD);
+
+	for(i = 0; i < iterations; i++) {
+		pTopicName = topics[pMqtt5->next];
+		pMqtt5->next = (pMqtt5->next + 1) % pMqtt5->pScenario->topicCount;
+		rc = aws_iot_mqtt_publish(&(pMqtt5->client), pTopicName, (uint16_t) strlen(pTopicName), &params);
+		if(SUCCESS != rc) {
+			printf("aws_iot_mqtt_publish failed: %d\n", rc);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* Bytes per publish over BENCHMARK_MQTT5_PUBLISHES publishes, negative on failure */
+static double aws_iot_benchmark_mqtt5_run_scenario(const BenchmarkMqtt5Scenario_t *pScenario) {
+	BenchmarkMqtt5_t mqtt5;
+	char name[64];
+	size_t bytesBefore;
+	double bytesPerPublish;
+	int rc;
+
+	if(0 != aws_iot_benchmark_mqtt5_setup(&mqtt5, pScenario)) {
+		return -1.0;
+	}
+
+	bytesBefore = aws_iot_benchmark_network_bytes_written();
+	if(0 != aws_iot_benchmark_mqtt5_publish(&mqtt5, BENCHMARK_MQTT5_PUBLISHES)) {
+		return -1.0;
+	}
+	bytesPerPublish = (double) (aws_iot_benchmark_network_bytes_written() - bytesBefore) / BENCHMARK_MQTT5_PUBLISHES;
+	snprintf(name, sizeof(name), "%s_bytes_per_publish", pScenario->pName);
+	aws_iot_benchmark_record_metric(name, "bytes", bytesPerPublish);
+
+	snprintf(name, sizeof(name), "%s_publish_qos0", pScenario->pName);
+	rc = aws_iot_benchmark_run(name, aws_iot_benchmark_mqtt5_publish, &mqtt5);
+
+	if(0 != aws_iot_benchmark_network_topic_alias_error_count()) {
+		printf("%s: %u publishes with an unresolvable topic alias\n", pScenario->pName,
+			   aws_iot_benchmark_network_topic_alias_error_count());
+		rc = -1;
+	}
+
+	(void) aws_iot_mqtt_disconnect(&(mqtt5.client));
+
+	return (0 == rc) ? bytesPerPublish : -1.0;
+}
+
+int main(int argc, char **argv) {
+	static const BenchmarkMqtt5Scenario_t scenarios[] = {
+		{"mqtt311", MQTT_3_1_1, 0, 8},
+		{"mqtt5_plain", MQTT_5_0, 0, 8},
+		{"mqtt5_aliases", MQTT_5_0, AWS_IOT_MQTT_MAX_TOPIC_ALIASES, 8},
+		/* More topics than aliases, round robin makes the least recently used alias miss every time */
+		{"mqtt5_alias_churn", MQTT_5_0, AWS_IOT_MQTT_MAX_TOPIC_ALIASES, BENCHMARK_MQTT5_TOPICS},
+	};
+	double bytesPerPublish[sizeof(scenarios) / sizeof(scenarios[0])];
+	int rc = 0;
+	uint32_t i;
+
+	for(i = 0; i < BENCHMARK_MQTT5_TOPICS; i++) {
+		snprintf(topics[i], BENCHMARK_MQTT5_TOPIC_LEN, "dt/fleet/eu-central-1/WVWZZZ1JZXW%06u/signals", i);
+	}
+
+	aws_iot_benchmark_init("mqtt5", argc, argv);
+
+	for(i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+		bytesPerPublish[i] = aws_iot_benchmark_mqtt5_run_scenario(&scenarios[i]);
+		if(0 > bytesPerPublish[i]) {
+			rc = 1;
+		}
+	}
+
+	if(0 == rc) {
+		aws_iot_benchmark_record_metric("topic_alias_bytes_saved", "%",
+										100.0 * (bytesPerPublish[0] - bytesPerPublish[2]) / bytesPerPublish[0]);
+	}
+
+	rc |= aws_iot_benchmark_finish();
+
+	return (0 == rc) ? 0 : 1;
+}
@@ -0,0 +1,268 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_pool.c
+ * @brief Micro-benchmarks for the fixed-block pool allocator
+ *
+ * Compares the pool with malloc/free and with the linear free-slot scan the SDK used for its
+ * record tables. The Makefile builds this file with and without _ENABLE_THREAD_SUPPORT_, so the
+ * cost of the atomic operations can be compared directly. The threaded build also measures
+ * alloc/free pairs from several threads sharing one pool.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+#include <pthread.h>
+#endif
+
+#include "aws_iot_pool.h"
+#include "aws_iot_benchmark_harness.h"
+
+#define BENCHMARK_POOL_BLOCK_COUNT 64
+#define BENCHMARK_POOL_BLOCK_SIZE 128 ///< Roughly the size of a shadow pending ack record
+
+#ifndef BENCHMARK_POOL_THREADS
+#define BENCHMARK_POOL_THREADS 4
+#endif
+
+#ifndef BENCHMARK_POOL_THREAD_ITERATIONS
+#define BENCHMARK_POOL_THREAD_ITERATIONS 1000000
+#endif
+
+typedef struct {
+	bool isFree;
+	unsigned char data[BENCHMARK_POOL_BLOCK_SIZE - sizeof(bool)];
+} BenchmarkRecord_t;
+
+static BenchmarkRecord_t poolRecords[BENCHMARK_POOL_BLOCK_COUNT];
+static uint32_t poolLinks[BENCHMARK_POOL_BLOCK_COUNT];
+static IoT_Pool_t benchmarkPool;
+
+static unsigned char arenaMemory[BENCHMARK_POOL_BLOCK_COUNT * (BENCHMARK_POOL_BLOCK_SIZE + sizeof(uint32_t)) + 64];
+static IoT_Arena_t benchmarkArena;
+static IoT_Pool_t arenaPool;
+
+static BenchmarkRecord_t scanRecords[BENCHMARK_POOL_BLOCK_COUNT];
+static void *pHeld[BENCHMARK_POOL_BLOCK_COUNT];
+static volatile uintptr_t benchmarkSink;
+
+static uint32_t aws_iot_benchmark_burst_length(uint32_t remaining) {
+	return (remaining < BENCHMARK_POOL_BLOCK_COUNT) ? remaining : BENCHMARK_POOL_BLOCK_COUNT;
+}
+
+static int aws_iot_benchmark_pool_alloc_free(void *pContext, uint32_t iterations) {
+	IoT_Pool_t *pPool = (IoT_Pool_t *) pContext;
+	void *pBlock;
+	uint32_t i;
+
+	for(i = 0; i < iterations; i++) {
+		pBlock = aws_iot_pool_alloc(pPool);
+		if(NULL == pBlock) {
+			return -1;
+		}
+		benchmarkSink = (uintptr_t) pBlock;
+		if(SUCCESS != aws_iot_pool_free(pPool, pBlock)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* Takes every block and gives them back, one operation is one alloc/free pair */
+static int aws_iot_benchmark_pool_burst(void *pContext, uint32_t iterations) {
+	IoT_Pool_t *pPool = (IoT_Pool_t *) pContext;
+	uint32_t i, j, count;
+
+	for(i = 0; i < iterations; i += count) {
+		count = aws_iot_benchmark_burst_length(iterations - i);
+		for(j = 0; j < count; j++) {
+			pHeld[j] = aws_iot_pool_alloc(pPool);
+			if(NULL == pHeld[j]) {
+				return -1;
+			}
+		}
+		for(j = 0; j < count; j++) {
+			if(SUCCESS != aws_iot_pool_free(pPool, pHeld[count - 1 - j])) {
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int aws_iot_benchmark_malloc_free(void *pContext, uint32_t iterations) {
+	void *pBlock;
+	uint32_t i;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		pBlock = malloc(BENCHMARK_POOL_BLOCK_SIZE);
+		if(NULL == pBlock) {
+			return -1;
+		}
+		benchmarkSink = (uintptr_t) pBlock;
+		free(pBlock);
+	}
+
+	return 0;
+}
+
+static int aws_iot_benchmark_malloc_burst(void *pContext, uint32_t iterations) {
+	uint32_t i, j, count;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i += count) {
+		count = aws_iot_benchmark_burst_length(iterations - i);
+		for(j = 0; j < count; j++) {
+			pHeld[j] = malloc(BENCHMARK_POOL_BLOCK_SIZE);
+			if(NULL == pHeld[j]) {
+				return -1;
+			}
+		}
+		for(j = 0; j < count; j++) {
+			free(pHeld[count - 1 - j]);
+		}
+	}
+
+	return 0;
+}
+
+/* Free-slot scan over an isFree flag with only the last slot free, the worst case of the old tables */
+static int aws_iot_benchmark_linear_scan(void *pContext, uint32_t iterations) {
+	uint32_t i, j;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		for(j = 0; j < BENCHMARK_POOL_BLOCK_COUNT; j++) {
+			if(((volatile BenchmarkRecord_t *) scanRecords)[j].isFree) {
+				break;
+			}
+		}
+		if(BENCHMARK_POOL_BLOCK_COUNT == j) {
+			return -1;
+		}
+		scanRecords[j].isFree = false;
+		benchmarkSink = (uintptr_t) &scanRecords[j];
+		scanRecords[j].isFree = true;
+	}
+
+	return 0;
+}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+static void *aws_iot_benchmark_pool_thread(void *pArg) {
+	if(0 != aws_iot_benchmark_pool_alloc_free(&benchmarkPool, BENCHMARK_POOL_THREAD_ITERATIONS)) {
+		return pArg;
+	}
+
+	return NULL;
+}
+
+static int aws_iot_benchmark_pool_contended(const char *pName) {
+	pthread_t threads[BENCHMARK_POOL_THREADS];
+	uint32_t threadIndexes[BENCHMARK_POOL_THREADS];
+	uint64_t startNs, elapsedNs, allocations;
+	int rc = 0;
+	void *pResult;
+	uint32_t i;
+
+	if(!aws_iot_benchmark_is_selected(pName)) {
+		return 0;
+	}
+
+	aws_iot_pool_reset(&benchmarkPool);
+	allocations = aws_iot_benchmark_allocation_count();
+	startNs = aws_iot_benchmark_now_ns();
+	for(i = 0; i < BENCHMARK_POOL_THREADS; i++) {
+		threadIndexes[i] = i;
+		if(0 != pthread_create(&threads[i], NULL, aws_iot_benchmark_pool_thread, &threadIndexes[i])) {
+			return -1;
+		}
+	}
+	for(i = 0; i < BENCHMARK_POOL_THREADS; i++) {
+		pResult = NULL;
+		(void) pthread_join(threads[i], &pResult);
+		if(NULL != pResult) {
+			rc = -1;
+		}
+	}
+	elapsedNs = aws_iot_benchmark_now_ns() - startNs;
+
+	/* Every block must be back, otherwise the free stack lost or duplicated one */
+	if(BENCHMARK_POOL_BLOCK_COUNT != aws_iot_pool_available(&benchmarkPool)) {
+		printf("%s: %u blocks free after the run, expected %u\n", pName, aws_iot_pool_available(&benchmarkPool),
+			   BENCHMARK_POOL_BLOCK_COUNT);
+		rc = -1;
+	}
+
+	aws_iot_benchmark_record(pName, (uint64_t) BENCHMARK_POOL_THREADS * BENCHMARK_POOL_THREAD_ITERATIONS, elapsedNs,
+							 aws_iot_benchmark_allocation_count() - allocations);
+
+	return rc;
+}
+#endif
+
+int main(int argc, char **argv) {
+	char name[64];
+	int rc = 0;
+	uint32_t i;
+
+	if(SUCCESS != aws_iot_pool_init(&benchmarkPool, poolRecords, sizeof(BenchmarkRecord_t), BENCHMARK_POOL_BLOCK_COUNT,
+									poolLinks) ||
+	   SUCCESS != aws_iot_arena_init(&benchmarkArena, arenaMemory, sizeof(arenaMemory)) ||
+	   SUCCESS != aws_iot_pool_init_from_arena(&arenaPool, &benchmarkArena, sizeof(BenchmarkRecord_t),
+											   BENCHMARK_POOL_BLOCK_COUNT)) {
+		printf("Failed to set up the pools\n");
+		return 1;
+	}
+
+	for(i = 0; i < BENCHMARK_POOL_BLOCK_COUNT; i++) {
+		scanRecords[i].isFree = (BENCHMARK_POOL_BLOCK_COUNT - 1 == i);
+	}
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	aws_iot_benchmark_init("pool_mt", argc, argv);
+#else
+	aws_iot_benchmark_init("pool", argc, argv);
+#endif
+
+	rc |= aws_iot_benchmark_run("pool_alloc_free", aws_iot_benchmark_pool_alloc_free, &benchmarkPool);
+	rc |= aws_iot_benchmark_run("pool_alloc_free_arena", aws_iot_benchmark_pool_alloc_free, &arenaPool);
+	rc |= aws_iot_benchmark_run("pool_burst_64", aws_iot_benchmark_pool_burst, &benchmarkPool);
+	rc |= aws_iot_benchmark_run("malloc_free", aws_iot_benchmark_malloc_free, NULL);
+	rc |= aws_iot_benchmark_run("malloc_burst_64", aws_iot_benchmark_malloc_burst, NULL);
+	rc |= aws_iot_benchmark_run("linear_scan_64", aws_iot_benchmark_linear_scan, NULL);
+
+#ifdef _ENABLE_THREAD_SUPPORT_
+	snprintf(name, sizeof(name), "pool_alloc_free_%u_threads", BENCHMARK_POOL_THREADS);
+	rc |= aws_iot_benchmark_pool_contended(name);
+#else
+	IOT_UNUSED(name);
+#endif
+
+	rc |= aws_iot_benchmark_finish();
+
+	return (0 == rc) ? 0 : 1;
+}
@@ -0,0 +1,279 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_reconnect.c
+ * @brief Reconnect, resubscribe and keepalive behavior under injected network faults
+ *
+ * Runs a client on the in-memory network in auto respond mode, wrapped by the fault
+ * injecting decorator. The client publishes at a fixed rate while faults from a schedule
+ * are injected, and the simulation reports for each scenario:
+ *
+ *  - recovery_ms: time the client spent disconnected
+ *  - lost_messages: publishes that did not reach the network
+ *  - outage_cpu_ms: CPU time used by the process while the client was disconnected
+ *  - outage_timer_polls: timer polls while disconnected, i.e. how much the client busy waits
+ *  - reconnects: number of reconnects
+ *  - pings: number of keepalive PINGREQs
+ *  - wall_ms: how long the simulation took to run
+ *
+ * All times except wall_ms and outage_cpu_ms are virtual. The binary is built with the
+ * timers in timer_virtual, so keepalives, back-off and timeouts follow the virtual clock
+ * and a day of operation is simulated in seconds.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_benchmark_harness.h"
+#include "aws_iot_benchmark_network_fault.h"
+#include "aws_iot_benchmark_network_memory.h"
+#include "aws_iot_benchmark_timer_virtual.h"
+#include "aws_iot_benchmark_virtual_clock.h"
+
+#define BENCHMARK_RECONNECT_TOPIC "sdk/benchmark/reconnect"
+#define BENCHMARK_HOUR_MS (60ULL * 60ULL * 1000ULL)
+
+typedef struct {
+	const char *pName;
+	const FaultEvent_t *pSchedule;
+	uint32_t eventCount;
+	uint64_t durationMs;
+	uint16_t keepAliveSec;
+	QoS qos;
+	uint32_t publishIntervalMs;
+	uint32_t yieldMs; ///< Timeout passed to aws_iot_mqtt_yield
+	uint32_t pollStepUs; ///< See aws_iot_benchmark_timer_set_poll_step_us
+} BenchmarkReconnectScenario_t;
+
+static const FaultEvent_t dropSchedule[] = {
+	{100, 500, FAULT_DROP, 0},
+};
+
+static const FaultEvent_t stallSchedule[] = {
+	{100, 2500, FAULT_STALL, 0},
+};
+
+static const FaultEvent_t slowLinkSchedule[] = {
+	{0, 60000, FAULT_PARTIAL_IO, 7},
+	{0, 60000, FAULT_BANDWIDTH, 2000},
+	{0, 60000, FAULT_LATENCY, 20},
+};
+
+/* A two minute outage every two hours, recovered by the back-off before it gives up */
+static const FaultEvent_t soakSchedule[] = {
+	{1 * BENCHMARK_HOUR_MS, 120000, FAULT_DROP, 0},
+	{3 * BENCHMARK_HOUR_MS, 120000, FAULT_DROP, 0},
+	{5 * BENCHMARK_HOUR_MS, 120000, FAULT_DROP, 0},
+	{7 * BENCHMARK_HOUR_MS, 120000, FAULT_DROP, 0},
+	{9 * BENCHMARK_HOUR_MS, 120000, FAULT_DROP, 0},
+	{11 * BENCHMARK_HOUR_MS, 120000, FAULT_DROP, 0},
+	{13 * BENCHMARK_HOUR_MS, 120000, FAULT_DROP, 0},
+	{15 * BENCHMARK_HOUR_MS, 120000, FAULT_DROP, 0},
+	{17 * BENCHMARK_HOUR_MS, 120000, FAULT_DROP, 0},
+	{19 * BENCHMARK_HOUR_MS, 120000, FAULT_DROP, 0},
+	{21 * BENCHMARK_HOUR_MS, 120000, FAULT_DROP, 0},
+	{23 * BENCHMARK_HOUR_MS, 120000, FAULT_DROP, 0},
+};
+
+static const BenchmarkReconnectScenario_t scenarios[] = {
+	{"drop_500ms", dropSchedule, sizeof(dropSchedule) / sizeof(dropSchedule[0]), 2500, 600, QOS0, 20, 10, 100},
+	{"keepalive_stall", stallSchedule, sizeof(stallSchedule) / sizeof(stallSchedule[0]), 5000, 1, QOS0, 20, 10,
+	 100},
+	{"slow_link_qos1", slowLinkSchedule, sizeof(slowLinkSchedule) / sizeof(slowLinkSchedule[0]), 2000, 600, QOS1, 20,
+	 10, 100},
+	{"soak_24h", soakSchedule, sizeof(soakSchedule) / sizeof(soakSchedule[0]), 24 * BENCHMARK_HOUR_MS, 30, QOS1,
+	 10000, 1000, 10000},
+};
+
+static void aws_iot_benchmark_reconnect_callback(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+												 IoT_Publish_Message_Params *params, void *pData) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(topicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(params);
+	IOT_UNUSED(pData);
+}
+
+static uint64_t aws_iot_benchmark_reconnect_cpu_ns(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	return ((uint64_t) now.tv_sec * 1000000000ULL) + (uint64_t) now.tv_nsec;
+}
+
+static int aws_iot_benchmark_reconnect_setup(AWS_IoT_Client *pClient, FaultNetwork_t *pFault,
+											 const BenchmarkReconnectScenario_t *pScenario) {
+	IoT_Client_Init_Params initParams = iotClientInitParamsDefault;
+	IoT_Client_Connect_Params connectParams = iotClientConnectParamsDefault;
+	IoT_Error_t rc;
+
+	aws_iot_benchmark_network_reset();
+	aws_iot_benchmark_network_set_auto_respond(true);
+	aws_iot_benchmark_virtual_clock_reset();
+	aws_iot_benchmark_timer_set_poll_step_us(pScenario->pollStepUs);
+
+	initParams.pHostURL = AWS_IOT_MQTT_HOST;
+	initParams.port = AWS_IOT_MQTT_PORT;
+	initParams.pRootCALocation = AWS_IOT_ROOT_CA_FILENAME;
+	initParams.pDeviceCertLocation = AWS_IOT_CERTIFICATE_FILENAME;
+	initParams.pDevicePrivateKeyLocation = AWS_IOT_PRIVATE_KEY_FILENAME;
+	initParams.mqttCommandTimeout_ms = 500;
+	initParams.tlsHandshakeTimeout_ms = 500;
+	initParams.enableAutoReconnect = false;
+#ifdef _ENABLE_THREAD_SUPPORT_
+	initParams.isBlockOnThreadLockEnabled = true;
+#endif
+	rc = aws_iot_mqtt_init(pClient, &initParams);
+	if(SUCCESS != rc) {
+		printf("aws_iot_mqtt_init failed: %d\n", rc);
+		return -1;
+	}
+
+	rc = aws_iot_benchmark_network_fault_wrap(pFault, &pClient->networkStack, pScenario->pSchedule,
+											  pScenario->eventCount);
+	if(SUCCESS != rc) {
+		printf("aws_iot_benchmark_network_fault_wrap failed: %d\n", rc);
+		return -1;
+	}
+
+	connectParams.keepAliveIntervalInSec = pScenario->keepAliveSec;
+	connectParams.pClientID = AWS_IOT_MQTT_CLIENT_ID;
+	connectParams.clientIDLen = (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID);
+	rc = aws_iot_mqtt_connect(pClient, &connectParams);
+	if(SUCCESS != rc) {
+		printf("aws_iot_mqtt_connect failed: %d\n", rc);
+		return -1;
+	}
+
+	rc = aws_iot_mqtt_autoreconnect_set_status(pClient, true);
+	if(SUCCESS != rc) {
+		return -1;
+	}
+
+	rc = aws_iot_mqtt_subscribe(pClient, BENCHMARK_RECONNECT_TOPIC, (uint16_t) strlen(BENCHMARK_RECONNECT_TOPIC),
+								QOS1, aws_iot_benchmark_reconnect_callback, NULL);
+	if(SUCCESS != rc) {
+		printf("aws_iot_mqtt_subscribe failed: %d\n", rc);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int aws_iot_benchmark_reconnect_run(const BenchmarkReconnectScenario_t *pScenario) {
+	unsigned char payload[32];
+	IoT_Publish_Message_Params params;
+	AWS_IoT_Client client;
+	FaultNetwork_t fault;
+	char name[64];
+	uint64_t now, nextPublishMs = 0, outageStartMs = 0, totalRecoveryMs = 0;
+	uint64_t outageCpuStart = 0, outageCpuNs = 0, outagePollStart = 0, outagePolls = 0, wallStart;
+	uint32_t attempted = 0, failed = 0, publishesBefore, connectsBefore;
+	bool isOutage = false;
+	IoT_Error_t rc;
+
+	if(!aws_iot_benchmark_is_selected(pScenario->pName)) {
+		return 0;
+	}
+
+	if(0 != aws_iot_benchmark_reconnect_setup(&client, &fault, pScenario)) {
+		aws_iot_benchmark_network_fault_unwrap(&fault);
+		return -1;
+	}
+
+	memset(payload, 'x', sizeof(payload));
+	params.qos = pScenario->qos;
+	params.isRetained = 0;
+	params.payload = payload;
+	params.payloadLen = sizeof(payload);
+	publishesBefore = aws_iot_benchmark_network_publish_count();
+	connectsBefore = aws_iot_benchmark_network_connect_count();
+	wallStart = aws_iot_benchmark_now_ns();
+	nextPublishMs = aws_iot_benchmark_virtual_clock_now_ms();
+
+	while((now = aws_iot_benchmark_virtual_clock_now_ms()) < pScenario->durationMs) {
+		if(now >= nextPublishMs) {
+			attempted++;
+			rc = aws_iot_mqtt_publish(&client, BENCHMARK_RECONNECT_TOPIC,
+									  (uint16_t) strlen(BENCHMARK_RECONNECT_TOPIC), &params);
+			if(SUCCESS != rc) {
+				failed++;
+			}
+			nextPublishMs += pScenario->publishIntervalMs;
+		}
+
+		(void) aws_iot_mqtt_yield(&client, pScenario->yieldMs);
+
+		if(!isOutage && !aws_iot_mqtt_is_client_connected(&client)) {
+			isOutage = true;
+			outageStartMs = now;
+			outageCpuStart = aws_iot_benchmark_reconnect_cpu_ns();
+			outagePollStart = aws_iot_benchmark_timer_poll_count();
+		} else if(isOutage && aws_iot_mqtt_is_client_connected(&client)) {
+			isOutage = false;
+			totalRecoveryMs += aws_iot_benchmark_virtual_clock_now_ms() - outageStartMs;
+			outageCpuNs += aws_iot_benchmark_reconnect_cpu_ns() - outageCpuStart;
+			outagePolls += aws_iot_benchmark_timer_poll_count() - outagePollStart;
+		}
+	}
+
+	if(isOutage) {
+		printf("%s: client did not recover within %llu ms\n", pScenario->pName,
+			   (unsigned long long) pScenario->durationMs);
+	}
+
+	snprintf(name, sizeof(name), "%s_recovery_ms", pScenario->pName);
+	aws_iot_benchmark_record_metric(name, "ms", (double) totalRecoveryMs);
+	snprintf(name, sizeof(name), "%s_lost_messages", pScenario->pName);
+	aws_iot_benchmark_record_metric(name, "messages",
+									(double) (attempted - (aws_iot_benchmark_network_publish_count() - publishesBefore)));
+	snprintf(name, sizeof(name), "%s_outage_cpu_ms", pScenario->pName);
+	aws_iot_benchmark_record_metric(name, "ms", (double) outageCpuNs / 1e6);
+	snprintf(name, sizeof(name), "%s_outage_timer_polls", pScenario->pName);
+	aws_iot_benchmark_record_metric(name, "polls", (double) outagePolls);
+	snprintf(name, sizeof(name), "%s_reconnects", pScenario->pName);
+	aws_iot_benchmark_record_metric(name, "reconnects",
+									(double) (aws_iot_benchmark_network_connect_count() - connectsBefore));
+	snprintf(name, sizeof(name), "%s_failed_publishes", pScenario->pName);
+	aws_iot_benchmark_record_metric(name, "messages", (double) failed);
+	snprintf(name, sizeof(name), "%s_pings", pScenario->pName);
+	aws_iot_benchmark_record_metric(name, "pings", (double) aws_iot_benchmark_network_ping_count());
+	snprintf(name, sizeof(name), "%s_wall_ms", pScenario->pName);
+	aws_iot_benchmark_record_metric(name, "ms", (double) (aws_iot_benchmark_now_ns() - wallStart) / 1e6);
+
+	(void) aws_iot_mqtt_disconnect(&client);
+	(void) aws_iot_mqtt_free(&client);
+	aws_iot_benchmark_network_fault_unwrap(&fault);
+
+	return isOutage ? -1 : 0;
+}
+
+int main(int argc, char **argv) {
+	uint32_t i;
+	int rc = 0;
+
+	aws_iot_benchmark_init("reconnect", argc, argv);
+
+	for(i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+		rc |= aws_iot_benchmark_reconnect_run(&scenarios[i]);
+	}
+
+	rc |= aws_iot_benchmark_finish();
+
+	return (0 == rc) ? 0 : 1;
+}
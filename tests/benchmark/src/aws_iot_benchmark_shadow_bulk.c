@@ -0,0 +1,224 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_shadow_bulk.c
+ * @brief Time to sync the shadows of many things with a bulk sync, by window size
+ *
+ * Runs against the benchmark broker started with -S, which answers shadow requests after a
+ * fixed latency like the shadow service would over a real connection. A gateway gets and then
+ * updates the shadows of all its things with windows of 1 up to the largest window. With a
+ * window of 1 every request waits for the response to the one before, like a loop over
+ * aws_iot_shadow_get without its subscribe and settling time, so the sync takes one round trip
+ * per thing; a larger window overlaps the round trips.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "aws_iot_shadow_interface.h"
+#include "aws_iot_shadow_bulk.h"
+#include "aws_iot_benchmark_harness.h"
+
+#define BENCHMARK_BULK_MAX_THINGS 4096
+#define BENCHMARK_BULK_THING_PREFIX "bench-child-"
+#define BENCHMARK_BULK_UPDATE_LEN 96
+
+typedef struct {
+	const char *pHost;
+	uint16_t port;
+	uint32_t thingCount;
+	uint32_t maxWindow;
+	uint32_t timeout_ms;
+} BenchmarkBulkConfig_t;
+
+static BenchmarkBulkConfig_t config;
+static char thingNames[BENCHMARK_BULK_MAX_THINGS][MAX_SIZE_OF_THING_NAME];
+static char updateDocuments[BENCHMARK_BULK_MAX_THINGS][BENCHMARK_BULK_UPDATE_LEN];
+static IoT_Shadow_Bulk_Request_t requests[BENCHMARK_BULK_MAX_THINGS];
+static uint32_t acceptedCount;
+
+static void aws_iot_benchmark_bulk_callback(uint32_t requestIndex, const IoT_Shadow_Bulk_Request_t *pRequest,
+											Shadow_Ack_Status_t status, const char *pReceivedJsonDocument,
+											size_t jsonLen) {
+	IOT_UNUSED(requestIndex);
+	IOT_UNUSED(pRequest);
+	IOT_UNUSED(pReceivedJsonDocument);
+	IOT_UNUSED(jsonLen);
+
+	if(SHADOW_ACK_ACCEPTED == status) {
+		acceptedCount++;
+	}
+}
+
+static int aws_iot_benchmark_bulk_sync(AWS_IoT_Client *pClient, ShadowActions_t action, uint32_t window) {
+	IoT_Shadow_Bulk_Params params;
+	IoT_Shadow_Bulk_Stats_t stats;
+	IoT_Shadow_Bulk_t bulk;
+	uint64_t start, elapsed;
+	const char *pActionName = (SHADOW_GET == action) ? "get" : "update";
+	char name[64];
+	double elapsedMs;
+	uint32_t i;
+	IoT_Error_t rc;
+
+	for(i = 0; i < config.thingCount; i++) {
+		requests[i].pThingName = thingNames[i];
+		requests[i].action = action;
+		requests[i].pJsonDocument = (SHADOW_UPDATE == action) ? updateDocuments[i] : NULL;
+		requests[i].pContext = NULL;
+	}
+
+	params.pRequests = requests;
+	params.requestCount = config.thingCount;
+	params.windowSize = window;
+	params.timeout_ms = config.timeout_ms;
+	params.callback = aws_iot_benchmark_bulk_callback;
+	rc = aws_iot_shadow_bulk_init(&bulk, pClient, &params);
+	if(SUCCESS != rc) {
+		printf("aws_iot_shadow_bulk_init failed: %d\n", rc);
+		return -1;
+	}
+
+	acceptedCount = 0;
+	start = aws_iot_benchmark_now_ns();
+	rc = aws_iot_shadow_bulk_start(&bulk);
+	if(SUCCESS != rc) {
+		printf("aws_iot_shadow_bulk_start failed: %d\n", rc);
+		return -1;
+	}
+	while(!aws_iot_shadow_bulk_is_done(&bulk)) {
+		rc = aws_iot_shadow_yield(pClient, 1);
+		if(SUCCESS != rc && NETWORK_ATTEMPTING_RECONNECT != rc) {
+			printf("aws_iot_shadow_yield failed: %d\n", rc);
+			break;
+		}
+		(void) aws_iot_shadow_bulk_poll(&bulk);
+	}
+	elapsed = aws_iot_benchmark_now_ns() - start;
+	(void) aws_iot_shadow_bulk_stop(&bulk);
+	aws_iot_shadow_bulk_get_stats(&bulk, &stats);
+
+	elapsedMs = (double) elapsed / 1e6;
+	printf("%s of %u things, window %u: %.1f ms, accepted: %u, rejected: %u, timed out: %u\n", pActionName,
+		   config.thingCount, window, elapsedMs, stats.accepted, stats.rejected, stats.timedOut);
+
+	snprintf(name, sizeof(name), "bulk_%s_%u_w%u", pActionName, config.thingCount, window);
+	aws_iot_benchmark_record_metric(name, "ms", elapsedMs);
+	snprintf(name, sizeof(name), "bulk_%s_%u_w%u_timeouts", pActionName, config.thingCount, window);
+	aws_iot_benchmark_record_metric(name, "count", (double) stats.timedOut);
+
+	return (acceptedCount == config.thingCount) ? 0 : -1;
+}
+
+static void aws_iot_benchmark_bulk_usage(const char *pName) {
+	printf("Usage: %s [-h host] [-p port] [-n things] [-w max_window] [-t timeout_ms] [-o results.json]\n", pName);
+}
+
+int main(int argc, char **argv) {
+	ShadowInitParameters_t initParams = ShadowInitParametersDefault;
+	ShadowConnectParameters_t connectParams = ShadowConnectParametersDefault;
+	AWS_IoT_Client client;
+	char clientId[] = "C-SDK_BulkGateway";
+	uint32_t i, window;
+	int opt, result = 0;
+	IoT_Error_t rc;
+
+	config.pHost = "localhost";
+	config.port = 1883;
+	config.thingCount = 200;
+	config.maxWindow = AWS_IOT_SHADOW_BULK_MAX_WINDOW;
+	config.timeout_ms = 5000;
+
+	while(-1 != (opt = getopt(argc, argv, "h:p:n:w:t:o:f:"))) {
+		switch(opt) {
+			case 'h':
+				config.pHost = optarg;
+				break;
+			case 'p':
+				config.port = (uint16_t) atoi(optarg);
+				break;
+			case 'n':
+				config.thingCount = (uint32_t) atoi(optarg);
+				break;
+			case 'w':
+				config.maxWindow = (uint32_t) atoi(optarg);
+				break;
+			case 't':
+				config.timeout_ms = (uint32_t) atoi(optarg);
+				break;
+			case 'o':
+			case 'f':
+				/* Handled by the harness */
+				break;
+			default:
+				aws_iot_benchmark_bulk_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if(0 == config.thingCount || BENCHMARK_BULK_MAX_THINGS < config.thingCount || 0 == config.maxWindow ||
+	   AWS_IOT_SHADOW_BULK_MAX_WINDOW < config.maxWindow) {
+		aws_iot_benchmark_bulk_usage(argv[0]);
+		return 1;
+	}
+
+	aws_iot_benchmark_init("shadow_bulk", argc, argv);
+
+	for(i = 0; i < config.thingCount; i++) {
+		snprintf(thingNames[i], sizeof(thingNames[i]), BENCHMARK_BULK_THING_PREFIX "%u", i);
+		snprintf(updateDocuments[i], sizeof(updateDocuments[i]),
+				 "{\"state\":{\"reported\":{\"online\":true,\"slot\":%u}}, \"clientToken\":\"bulk-%u\"}", i, i);
+	}
+
+	initParams.pHost = (char *) config.pHost;
+	initParams.port = config.port;
+	/* Not used by the TCP network layer, but required by aws_iot_mqtt_init */
+	initParams.pRootCA = AWS_IOT_ROOT_CA_FILENAME;
+	initParams.pClientCRT = AWS_IOT_CERTIFICATE_FILENAME;
+	initParams.pClientKey = AWS_IOT_PRIVATE_KEY_FILENAME;
+	rc = aws_iot_shadow_init(&client, &initParams);
+	if(SUCCESS != rc) {
+		printf("aws_iot_shadow_init failed: %d\n", rc);
+		return 1;
+	}
+
+	connectParams.pMyThingName = BENCHMARK_BULK_THING_PREFIX "gateway";
+	connectParams.pMqttClientId = clientId;
+	connectParams.mqttClientIdLen = (uint16_t) strlen(clientId);
+	rc = aws_iot_shadow_connect(&client, &connectParams);
+	if(SUCCESS != rc) {
+		printf("aws_iot_shadow_connect failed: %d\n", rc);
+		return 1;
+	}
+
+	for(window = 1; window <= config.maxWindow && 0 == result; window *= 2) {
+		result = aws_iot_benchmark_bulk_sync(&client, SHADOW_GET, window);
+		if(0 == result) {
+			result = aws_iot_benchmark_bulk_sync(&client, SHADOW_UPDATE, window);
+		}
+	}
+
+	(void) aws_iot_shadow_disconnect(&client);
+
+	if(0 != result) {
+		printf("Not every request was accepted\n");
+		return 1;
+	}
+
+	return aws_iot_benchmark_finish();
+}
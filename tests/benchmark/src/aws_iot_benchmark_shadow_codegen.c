@@ -0,0 +1,194 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_shadow_codegen.c
+ * @brief Generated encoder and decoder against the jsonStruct_t shadow path
+ *
+ * thermostat.c/.h are generated from schema/thermostat.json when the benchmark is built. The
+ * same six fields are written as a reported update with aws_iot_shadow_add_reported and with
+ * the generated thermostat_add_reported, and a delta with metadata is read the way the shadow
+ * client does it, isJsonValidAndParse and isJsonKeyMatchingAndUpdateValue per field, and with
+ * thermostat_decode.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "aws_iot_shadow_interface.h"
+#include "aws_iot_shadow_json.h"
+#include "aws_iot_benchmark_harness.h"
+#include "thermostat.h"
+
+#define BENCHMARK_SHADOW_CODEGEN_BUFFER_LEN 512
+#define BENCHMARK_SHADOW_CODEGEN_FIELD_COUNT 6
+
+#define BENCHMARK_SHADOW_CODEGEN_FIELDS(f) &(f)[0], &(f)[1], &(f)[2], &(f)[3], &(f)[4], &(f)[5]
+
+static thermostat_t state = {22.75, 21.0, false, "heating", 3, 86400};
+static thermostat_t decoded;
+static jsonStruct_t stateFields[BENCHMARK_SHADOW_CODEGEN_FIELD_COUNT];
+static jsonStruct_t decodedFields[BENCHMARK_SHADOW_CODEGEN_FIELD_COUNT];
+
+static char genericDocument[BENCHMARK_SHADOW_CODEGEN_BUFFER_LEN];
+static char generatedDocument[BENCHMARK_SHADOW_CODEGEN_BUFFER_LEN];
+
+static const char deltaDocument[] =
+	"{\"version\":1234,\"timestamp\":1526412345,\"state\":{\"temperature\":23.5,\"targetTemperature\":19.5,"
+	"\"windowOpen\":true,\"mode\":\"cooling\",\"fanSpeed\":2,\"uptime\":90000},\"metadata\":{\"temperature\":"
+	"{\"timestamp\":1526412345},\"targetTemperature\":{\"timestamp\":1526412345},\"windowOpen\":{\"timestamp\":"
+	"1526412345},\"mode\":{\"timestamp\":1526412345},\"fanSpeed\":{\"timestamp\":1526412345},\"uptime\":"
+	"{\"timestamp\":1526412345}}}";
+
+static void aws_iot_benchmark_shadow_codegen_bind(thermostat_t *pState, jsonStruct_t *pFields) {
+	jsonStruct_t fields[BENCHMARK_SHADOW_CODEGEN_FIELD_COUNT] = {
+		{"temperature", &pState->temperature, sizeof(double), SHADOW_JSON_DOUBLE, NULL},
+		{"targetTemperature", &pState->targetTemperature, sizeof(double), SHADOW_JSON_DOUBLE, NULL},
+		{"windowOpen", &pState->windowOpen, sizeof(bool), SHADOW_JSON_BOOL, NULL},
+		{"mode", pState->mode, sizeof(pState->mode), SHADOW_JSON_STRING, NULL},
+		{"fanSpeed", &pState->fanSpeed, sizeof(uint8_t), SHADOW_JSON_UINT8, NULL},
+		{"uptime", &pState->uptime, sizeof(uint32_t), SHADOW_JSON_UINT32, NULL}
+	};
+
+	memcpy(pFields, fields, sizeof(fields));
+}
+
+static int aws_iot_benchmark_generic_encode_reported(void *pContext, uint32_t iterations) {
+	uint32_t i;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		resetClientTokenSequenceNum();
+		if(SUCCESS != aws_iot_shadow_init_json_document(genericDocument, sizeof(genericDocument)) ||
+		   SUCCESS != aws_iot_shadow_add_reported(genericDocument, sizeof(genericDocument),
+												  BENCHMARK_SHADOW_CODEGEN_FIELD_COUNT,
+												  BENCHMARK_SHADOW_CODEGEN_FIELDS(stateFields)) ||
+		   SUCCESS != aws_iot_finalize_json_document(genericDocument, sizeof(genericDocument))) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int aws_iot_benchmark_codegen_encode_reported(void *pContext, uint32_t iterations) {
+	uint32_t i;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		resetClientTokenSequenceNum();
+		if(SUCCESS != aws_iot_shadow_init_json_document(generatedDocument, sizeof(generatedDocument)) ||
+		   SUCCESS != thermostat_add_reported(generatedDocument, sizeof(generatedDocument), &state, THERMOSTAT_ALL) ||
+		   SUCCESS != aws_iot_finalize_json_document(generatedDocument, sizeof(generatedDocument))) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int aws_iot_benchmark_codegen_encode_telemetry(void *pContext, uint32_t iterations) {
+	size_t len = 0;
+	uint32_t i;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		if(SUCCESS != thermostat_encode(generatedDocument, sizeof(generatedDocument), &state, THERMOSTAT_ALL, &len)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int aws_iot_benchmark_generic_decode_delta(void *pContext, uint32_t iterations) {
+	int32_t tokenCount, dataPosition;
+	uint32_t dataLength, i, j;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		if(!isJsonValidAndParse(deltaDocument, sizeof(deltaDocument) - 1, NULL, &tokenCount)) {
+			return -1;
+		}
+		for(j = 0; j < BENCHMARK_SHADOW_CODEGEN_FIELD_COUNT; j++) {
+			if(!isJsonKeyMatchingAndUpdateValue(deltaDocument, NULL, tokenCount, &decodedFields[j], &dataLength,
+												&dataPosition)) {
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int aws_iot_benchmark_codegen_decode_delta(void *pContext, uint32_t iterations) {
+	uint32_t fieldMask = 0, i;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < iterations; i++) {
+		if(SUCCESS != thermostat_decode(deltaDocument, sizeof(deltaDocument) - 1, NULL, &decoded, &fieldMask) ||
+		   THERMOSTAT_ALL != fieldMask) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static bool aws_iot_benchmark_shadow_codegen_decoded_matches(void) {
+	return 23.5 == decoded.temperature && 19.5 == decoded.targetTemperature && decoded.windowOpen &&
+		   0 == strcmp("cooling", decoded.mode) && 2 == decoded.fanSpeed && 90000 == decoded.uptime;
+}
+
+int main(int argc, char **argv) {
+	int rc = 0;
+
+	aws_iot_benchmark_shadow_codegen_bind(&state, stateFields);
+	aws_iot_benchmark_shadow_codegen_bind(&decoded, decodedFields);
+
+	aws_iot_benchmark_init("shadow_codegen", argc, argv);
+
+	/* Both paths have to produce the same document and the same fields */
+	if(0 != aws_iot_benchmark_generic_encode_reported(NULL, 1) ||
+	   0 != aws_iot_benchmark_codegen_encode_reported(NULL, 1) || 0 != strcmp(genericDocument, generatedDocument)) {
+		printf("Generated document differs:\n%s\n%s\n", genericDocument, generatedDocument);
+		return 1;
+	}
+	memset(&decoded, 0, sizeof(decoded));
+	if(0 != aws_iot_benchmark_generic_decode_delta(NULL, 1) || !aws_iot_benchmark_shadow_codegen_decoded_matches()) {
+		printf("Generic delta decode failed\n");
+		return 1;
+	}
+	memset(&decoded, 0, sizeof(decoded));
+	if(0 != aws_iot_benchmark_codegen_decode_delta(NULL, 1) || !aws_iot_benchmark_shadow_codegen_decoded_matches()) {
+		printf("Generated delta decode failed\n");
+		return 1;
+	}
+
+	rc |= aws_iot_benchmark_run("generic_encode_reported_6", aws_iot_benchmark_generic_encode_reported, NULL);
+	rc |= aws_iot_benchmark_run("codegen_encode_reported_6", aws_iot_benchmark_codegen_encode_reported, NULL);
+	rc |= aws_iot_benchmark_run("codegen_encode_telemetry_6", aws_iot_benchmark_codegen_encode_telemetry, NULL);
+	rc |= aws_iot_benchmark_run("generic_decode_delta_6", aws_iot_benchmark_generic_decode_delta, NULL);
+	rc |= aws_iot_benchmark_run("codegen_decode_delta_6", aws_iot_benchmark_codegen_decode_delta, NULL);
+
+	rc |= aws_iot_benchmark_finish();
+
+	return (0 == rc) ? 0 : 1;
+}
@@ -0,0 +1,234 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_subscriptions.c
+ * @brief Micro-benchmarks for the subscription store
+ *
+ * Measures adding, removing and matching subscriptions with 10, 1000 and 10000 subscriptions in
+ * the store, which is taken from an arena like a gateway would set it up. linear_match_* repeats
+ * the scan over every handler that message delivery did before the store, for comparison.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "aws_iot_mqtt_client_common_internal.h"
+#include "aws_iot_benchmark_harness.h"
+
+#define BENCHMARK_SUBSCRIPTIONS_MAX 10000
+#define BENCHMARK_SUBSCRIPTIONS_WILDCARDS 16
+#define BENCHMARK_SUBSCRIPTIONS_TOPIC_LEN 40
+
+typedef struct {
+	uint32_t count; ///< Exact filters in the store
+	SubscriptionStore store;
+	IoT_Arena_t arena;
+} BenchmarkSubscriptions_t;
+
+/* Handlers, links and at most two buckets per handler */
+static unsigned char storeMemory[(BENCHMARK_SUBSCRIPTIONS_MAX + BENCHMARK_SUBSCRIPTIONS_WILDCARDS + 1) *
+								 (sizeof(MessageHandlers) + (AWS_IOT_MQTT_SUBSCRIPTION_LINKS_PER_HANDLER + 2) *
+															sizeof(uint32_t)) + 1024];
+static char topics[BENCHMARK_SUBSCRIPTIONS_MAX + 1][BENCHMARK_SUBSCRIPTIONS_TOPIC_LEN];
+static char wildcards[BENCHMARK_SUBSCRIPTIONS_WILDCARDS][BENCHMARK_SUBSCRIPTIONS_TOPIC_LEN];
+static char wildcardTopic[] = "cmd/gateway/dev00042/reboot";
+static MessageHandlers linearHandlers[BENCHMARK_SUBSCRIPTIONS_MAX];
+static volatile uintptr_t benchmarkSink;
+
+static void aws_iot_benchmark_subscription_handler(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
+												   IoT_Publish_Message_Params *pParams, void *pData) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(pTopicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(pParams);
+	IOT_UNUSED(pData);
+}
+
+static void aws_iot_benchmark_subscription_set(MessageHandlers *pHandler, const char *pFilter) {
+	pHandler->topicName = pFilter;
+	pHandler->topicNameLen = (uint16_t) strlen(pFilter);
+	pHandler->resubscribed = 0;
+	pHandler->qos = QOS1;
+	pHandler->pApplicationHandler = aws_iot_benchmark_subscription_handler;
+	pHandler->pApplicationHandlerData = NULL;
+}
+
+static int aws_iot_benchmark_subscriptions_setup(BenchmarkSubscriptions_t *pContext, uint32_t count,
+												 uint32_t wildcardCount) {
+	MessageHandlers handler;
+	uint32_t i;
+
+	pContext->count = count;
+	if(SUCCESS != aws_iot_arena_init(&(pContext->arena), storeMemory, sizeof(storeMemory)) ||
+	   SUCCESS != aws_iot_mqtt_internal_subscription_store_init_from_arena(&(pContext->store), &(pContext->arena),
+																		   count + wildcardCount + 1)) {
+		return -1;
+	}
+
+	for(i = 0; i < count; i++) {
+		aws_iot_benchmark_subscription_set(&handler, topics[i]);
+		if(NULL == aws_iot_mqtt_internal_subscription_store_add(&(pContext->store), &handler)) {
+			return -1;
+		}
+	}
+
+	for(i = 0; i < wildcardCount; i++) {
+		aws_iot_benchmark_subscription_set(&handler, wildcards[i]);
+		if(NULL == aws_iot_mqtt_internal_subscription_store_add(&(pContext->store), &handler)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static uint32_t aws_iot_benchmark_subscriptions_match(SubscriptionStore *pStore, char *pTopicName) {
+	SubscriptionMatchCursor cursor;
+	MessageHandlers *pHandler;
+	uint16_t topicNameLen = (uint16_t) strlen(pTopicName);
+	uint32_t matches = 0;
+
+	aws_iot_mqtt_internal_subscription_store_match_begin(pStore, pTopicName, topicNameLen, &cursor);
+	while(NULL != (pHandler = aws_iot_mqtt_internal_subscription_store_match_next(pStore, pTopicName, topicNameLen,
+																				  &cursor))) {
+		benchmarkSink = (uintptr_t) pHandler;
+		matches++;
+	}
+	aws_iot_mqtt_internal_subscription_store_match_end(pStore);
+
+	return matches;
+}
+
+/* One subscribe and one unsubscribe with the given number of other subscriptions in place */
+static int aws_iot_benchmark_subscriptions_add_remove(void *pContext, uint32_t iterations) {
+	BenchmarkSubscriptions_t *pSubscriptions = (BenchmarkSubscriptions_t *) pContext;
+	MessageHandlers handler;
+	char *pFilter = topics[BENCHMARK_SUBSCRIPTIONS_MAX];
+	uint32_t i;
+
+	aws_iot_benchmark_subscription_set(&handler, pFilter);
+	for(i = 0; i < iterations; i++) {
+		if(NULL == aws_iot_mqtt_internal_subscription_store_add(&(pSubscriptions->store), &handler) ||
+		   1 != aws_iot_mqtt_internal_subscription_store_remove(&(pSubscriptions->store), pFilter,
+																handler.topicNameLen)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int aws_iot_benchmark_subscriptions_exact_match(void *pContext, uint32_t iterations) {
+	BenchmarkSubscriptions_t *pSubscriptions = (BenchmarkSubscriptions_t *) pContext;
+	uint32_t i;
+
+	for(i = 0; i < iterations; i++) {
+		if(1 != aws_iot_benchmark_subscriptions_match(&(pSubscriptions->store), topics[i % pSubscriptions->count])) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* A topic that only one of the wildcard filters matches, every wildcard filter is tried */
+static int aws_iot_benchmark_subscriptions_wildcard_match(void *pContext, uint32_t iterations) {
+	BenchmarkSubscriptions_t *pSubscriptions = (BenchmarkSubscriptions_t *) pContext;
+	uint32_t i;
+
+	for(i = 0; i < iterations; i++) {
+		if(1 != aws_iot_benchmark_subscriptions_match(&(pSubscriptions->store), wildcardTopic)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* The loop message delivery used before the subscription store */
+static int aws_iot_benchmark_subscriptions_linear_match(void *pContext, uint32_t iterations) {
+	BenchmarkSubscriptions_t *pSubscriptions = (BenchmarkSubscriptions_t *) pContext;
+	char *pTopicName;
+	uint16_t topicNameLen;
+	uint32_t i, itr, matches;
+
+	for(i = 0; i < iterations; i++) {
+		pTopicName = topics[i % pSubscriptions->count];
+		topicNameLen = (uint16_t) strlen(pTopicName);
+		matches = 0;
+		for(itr = 0; itr < pSubscriptions->count; ++itr) {
+			if(NULL != linearHandlers[itr].topicName) {
+				if(((topicNameLen == linearHandlers[itr].topicNameLen) &&
+					(strncmp(pTopicName, (char *) linearHandlers[itr].topicName, topicNameLen) == 0)) ||
+				   aws_iot_mqtt_internal_is_topic_matched((char *) linearHandlers[itr].topicName, pTopicName,
+														  topicNameLen)) {
+					benchmarkSink = (uintptr_t) &linearHandlers[itr];
+					matches++;
+				}
+			}
+		}
+		if(1 != matches) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	static const uint32_t sizes[] = {10, 1000, BENCHMARK_SUBSCRIPTIONS_MAX};
+	BenchmarkSubscriptions_t subscriptions;
+	char name[64];
+	int rc = 0;
+	uint32_t i;
+
+	for(i = 0; i <= BENCHMARK_SUBSCRIPTIONS_MAX; i++) {
+		snprintf(topics[i], BENCHMARK_SUBSCRIPTIONS_TOPIC_LEN, "dt/gateway/dev%05u/telemetry", i);
+	}
+	for(i = 0; i < BENCHMARK_SUBSCRIPTIONS_WILDCARDS; i++) {
+		snprintf(wildcards[i], BENCHMARK_SUBSCRIPTIONS_TOPIC_LEN, "cmd/gateway/+/action%u", i);
+	}
+	snprintf(wildcards[0], BENCHMARK_SUBSCRIPTIONS_TOPIC_LEN, "cmd/gateway/+/reboot");
+	for(i = 0; i < BENCHMARK_SUBSCRIPTIONS_MAX; i++) {
+		aws_iot_benchmark_subscription_set(&linearHandlers[i], topics[i]);
+	}
+
+	aws_iot_benchmark_init("subscriptions", argc, argv);
+
+	for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		if(0 != aws_iot_benchmark_subscriptions_setup(&subscriptions, sizes[i], 0)) {
+			printf("Failed to set up %u subscriptions\n", sizes[i]);
+			return 1;
+		}
+		snprintf(name, sizeof(name), "subscription_add_remove_%u", sizes[i]);
+		rc |= aws_iot_benchmark_run(name, aws_iot_benchmark_subscriptions_add_remove, &subscriptions);
+		snprintf(name, sizeof(name), "subscription_exact_match_%u", sizes[i]);
+		rc |= aws_iot_benchmark_run(name, aws_iot_benchmark_subscriptions_exact_match, &subscriptions);
+		snprintf(name, sizeof(name), "linear_match_%u", sizes[i]);
+		rc |= aws_iot_benchmark_run(name, aws_iot_benchmark_subscriptions_linear_match, &subscriptions);
+
+		if(0 != aws_iot_benchmark_subscriptions_setup(&subscriptions, sizes[i], BENCHMARK_SUBSCRIPTIONS_WILDCARDS)) {
+			printf("Failed to set up %u subscriptions with wildcards\n", sizes[i]);
+			return 1;
+		}
+		snprintf(name, sizeof(name), "subscription_wildcard_match_%u", sizes[i]);
+		rc |= aws_iot_benchmark_run(name, aws_iot_benchmark_subscriptions_wildcard_match, &subscriptions);
+	}
+
+	rc |= aws_iot_benchmark_finish();
+
+	return (0 == rc) ? 0 : 1;
+}
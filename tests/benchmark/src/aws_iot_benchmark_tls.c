@@ -0,0 +1,279 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_tls.c
+ * @brief Handshake rate and bulk throughput of a TLS network layer
+ *
+ * Built once with the mbedTLS network layer and once with the OpenSSL network layer
+ * (BENCHMARK_NETWORK_OPENSSL) and run against the TLS build of the benchmark broker.
+ * Three phases, each for the given duration:
+ *  - connect: MQTT connect and disconnect with a new TLS session every time
+ *  - reconnect: the same with one client, the OpenSSL layer resumes the previous session
+ *  - bulk: back to back QoS0 PUBLISH packets written to the TLS connection in large chunks
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_client_common_internal.h"
+#include "aws_iot_benchmark_harness.h"
+
+#define BENCHMARK_TLS_TOPIC "sdk/benchmark/tls"
+#define BENCHMARK_TLS_MAX_CHUNK_LEN 65536
+#define BENCHMARK_TLS_PAYLOAD_LEN 1024
+
+#ifdef BENCHMARK_NETWORK_OPENSSL
+#define BENCHMARK_TLS_NETWORK "openssl"
+#else
+#define BENCHMARK_TLS_NETWORK "mbedtls"
+#endif
+
+typedef struct {
+	const char *pHost;
+	uint16_t port;
+	char *pRootCA;
+	char *pClientCert;
+	char *pClientKey;
+	uint32_t durationSec;
+	uint32_t chunkLen;
+} BenchmarkTlsConfig_t;
+
+static BenchmarkTlsConfig_t config;
+static AWS_IoT_Client client;
+static unsigned char chunk[BENCHMARK_TLS_MAX_CHUNK_LEN];
+
+/* User and system CPU time of the whole process */
+static uint64_t aws_iot_benchmark_tls_cpu_ns(void) {
+	struct rusage usage;
+
+	if(0 != getrusage(RUSAGE_SELF, &usage)) {
+		return 0;
+	}
+
+	return ((uint64_t) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL) +
+		   ((uint64_t) (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL);
+}
+
+static IoT_Error_t aws_iot_benchmark_tls_init(void) {
+	IoT_Client_Init_Params initParams = iotClientInitParamsDefault;
+
+	initParams.pHostURL = (char *) config.pHost;
+	initParams.port = config.port;
+	initParams.pRootCALocation = config.pRootCA;
+	initParams.pDeviceCertLocation = config.pClientCert;
+	initParams.pDevicePrivateKeyLocation = config.pClientKey;
+	initParams.mqttCommandTimeout_ms = 5000;
+	initParams.tlsHandshakeTimeout_ms = 5000;
+	initParams.isSSLHostnameVerify = false;
+	initParams.enableAutoReconnect = false;
+
+	return aws_iot_mqtt_init(&client, &initParams);
+}
+
+static IoT_Error_t aws_iot_benchmark_tls_connect(void) {
+	IoT_Client_Connect_Params connectParams = iotClientConnectParamsDefault;
+	char clientId[] = "C-SDK_TLS";
+
+	connectParams.keepAliveIntervalInSec = 600;
+	connectParams.pClientID = clientId;
+	connectParams.clientIDLen = (uint16_t) strlen(clientId);
+
+	return aws_iot_mqtt_connect(&client, &connectParams);
+}
+
+/* Connects and disconnects until the duration is over, with or without session resumption */
+static int aws_iot_benchmark_tls_connect_rate(const char *pMetric, bool isResumed) {
+	uint64_t start, deadline, elapsed, cpuStart, cpu, connects = 0;
+	double rate;
+	IoT_Error_t rc;
+
+	if(SUCCESS != aws_iot_benchmark_tls_init()) {
+		return -1;
+	}
+
+	cpuStart = aws_iot_benchmark_tls_cpu_ns();
+	start = aws_iot_benchmark_now_ns();
+	deadline = start + ((uint64_t) config.durationSec * 1000000000ULL);
+	while(aws_iot_benchmark_now_ns() < deadline) {
+#ifdef BENCHMARK_NETWORK_OPENSSL
+		if(!isResumed) {
+			iot_tls_openssl_forget_session(&(client.networkStack.tlsDataParams));
+		}
+#else
+		IOT_UNUSED(isResumed);
+#endif
+		rc = aws_iot_benchmark_tls_connect();
+		if(SUCCESS != rc) {
+			printf("aws_iot_mqtt_connect failed: %d\n", rc);
+			return -1;
+		}
+		(void) aws_iot_mqtt_disconnect(&client);
+		connects++;
+	}
+	elapsed = aws_iot_benchmark_now_ns() - start;
+	cpu = aws_iot_benchmark_tls_cpu_ns() - cpuStart;
+
+#ifdef BENCHMARK_NETWORK_OPENSSL
+	iot_tls_openssl_forget_session(&(client.networkStack.tlsDataParams));
+#endif
+	(void) aws_iot_mqtt_free(&client);
+
+	rate = (double) connects * 1e9 / (double) elapsed;
+	printf("%s: %llu connects, %.0f per second, CPU time %.0f us per connect\n", pMetric,
+		   (unsigned long long) connects, rate, (double) cpu / 1000.0 / (double) connects);
+	aws_iot_benchmark_record_metric(pMetric, "connects/s", rate);
+
+	return 0;
+}
+
+/* Fills the chunk with QoS0 PUBLISH packets, returns the bytes used */
+static size_t aws_iot_benchmark_tls_fill_chunk(uint32_t *pPacketsPerChunk) {
+	unsigned char payload[BENCHMARK_TLS_PAYLOAD_LEN];
+	uint32_t packetLen;
+	size_t used = 0;
+
+	memset(payload, 'x', sizeof(payload));
+	*pPacketsPerChunk = 0;
+	while(SUCCESS == aws_iot_mqtt_internal_serialize_publish(chunk + used, config.chunkLen - used, 0, QOS0, 0, 0,
+															 BENCHMARK_TLS_TOPIC, strlen(BENCHMARK_TLS_TOPIC),
+															 payload, sizeof(payload), &packetLen)) {
+		used += packetLen;
+		(*pPacketsPerChunk)++;
+	}
+
+	return used;
+}
+
+static int aws_iot_benchmark_tls_bulk(void) {
+	uint64_t start, deadline, elapsed, cpuStart, cpu, bytes = 0;
+	uint32_t packetsPerChunk;
+	size_t chunkUsed, written;
+	double throughput;
+	Timer timer;
+	IoT_Error_t rc;
+
+	chunkUsed = aws_iot_benchmark_tls_fill_chunk(&packetsPerChunk);
+	if(0 == chunkUsed) {
+		printf("Chunk length %u is too small for a PUBLISH packet\n", config.chunkLen);
+		return -1;
+	}
+
+	if(SUCCESS != aws_iot_benchmark_tls_init() || SUCCESS != aws_iot_benchmark_tls_connect()) {
+		printf("Unable to connect for the bulk test\n");
+		return -1;
+	}
+
+	init_timer(&timer);
+	cpuStart = aws_iot_benchmark_tls_cpu_ns();
+	start = aws_iot_benchmark_now_ns();
+	deadline = start + ((uint64_t) config.durationSec * 1000000000ULL);
+	while(aws_iot_benchmark_now_ns() < deadline) {
+		/* Straight to the network layer, the client only writes one packet at a time */
+		countdown_ms(&timer, 5000);
+		rc = client.networkStack.write(&(client.networkStack), chunk, chunkUsed, &timer, &written);
+		bytes += written;
+		if(SUCCESS != rc) {
+			printf("Network write failed: %d\n", rc);
+			return -1;
+		}
+	}
+	elapsed = aws_iot_benchmark_now_ns() - start;
+	cpu = aws_iot_benchmark_tls_cpu_ns() - cpuStart;
+
+	(void) aws_iot_mqtt_disconnect(&client);
+#ifdef BENCHMARK_NETWORK_OPENSSL
+	iot_tls_openssl_forget_session(&(client.networkStack.tlsDataParams));
+#endif
+	(void) aws_iot_mqtt_free(&client);
+
+	throughput = (double) bytes * 1e9 / (double) elapsed / (1024.0 * 1024.0);
+	printf("bulk: %u byte writes, %u packets each, %.1f MB/s, CPU time %.2f ms per MB\n", (unsigned) chunkUsed,
+		   packetsPerChunk, throughput, (double) cpu / 1e6 / ((double) bytes / (1024.0 * 1024.0)));
+	aws_iot_benchmark_record_metric("bulk_throughput", "MB/s", throughput);
+	aws_iot_benchmark_record_metric("bulk_cpu_per_mb", "ms",
+									(double) cpu / 1e6 / ((double) bytes / (1024.0 * 1024.0)));
+
+	return 0;
+}
+
+static void aws_iot_benchmark_tls_usage(const char *pName) {
+	printf("Usage: %s [-h host] [-p port] [-a root_ca] [-c cert] [-k key] [-d duration_sec] [-s chunk_len]"
+		   " [-o results.json]\n", pName);
+}
+
+int main(int argc, char **argv) {
+	int opt;
+
+	config.pHost = "localhost";
+	config.port = 8883;
+	config.pRootCA = AWS_IOT_ROOT_CA_FILENAME;
+	config.pClientCert = AWS_IOT_CERTIFICATE_FILENAME;
+	config.pClientKey = AWS_IOT_PRIVATE_KEY_FILENAME;
+	config.durationSec = 3;
+	config.chunkLen = 16384;
+
+	while(-1 != (opt = getopt(argc, argv, "h:p:a:c:k:d:s:o:f:"))) {
+		switch(opt) {
+			case 'h':
+				config.pHost = optarg;
+				break;
+			case 'p':
+				config.port = (uint16_t) atoi(optarg);
+				break;
+			case 'a':
+				config.pRootCA = optarg;
+				break;
+			case 'c':
+				config.pClientCert = optarg;
+				break;
+			case 'k':
+				config.pClientKey = optarg;
+				break;
+			case 'd':
+				config.durationSec = (uint32_t) atoi(optarg);
+				break;
+			case 's':
+				config.chunkLen = (uint32_t) atoi(optarg);
+				break;
+			case 'o':
+			case 'f':
+				/* Handled by the harness */
+				break;
+			default:
+				aws_iot_benchmark_tls_usage(argv[0]);
+				return 1;
+		}
+	}
+
+	if(0 == config.durationSec || BENCHMARK_TLS_MAX_CHUNK_LEN < config.chunkLen) {
+		aws_iot_benchmark_tls_usage(argv[0]);
+		return 1;
+	}
+
+	aws_iot_benchmark_init("tls_" BENCHMARK_TLS_NETWORK, argc, argv);
+
+	if(0 != aws_iot_benchmark_tls_connect_rate("connects_full_handshake", false) ||
+	   0 != aws_iot_benchmark_tls_connect_rate("connects_reconnect", true) ||
+	   0 != aws_iot_benchmark_tls_bulk()) {
+		return 1;
+	}
+
+	return aws_iot_benchmark_finish();
+}
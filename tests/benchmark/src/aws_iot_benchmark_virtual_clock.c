@@ -0,0 +1,43 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_virtual_clock.c
+ * @brief Virtual clock for simulations
+ */
+
+#include "aws_iot_benchmark_virtual_clock.h"
+
+static uint64_t virtualTimeUs;
+
+void aws_iot_benchmark_virtual_clock_reset(void) {
+	__atomic_store_n(&virtualTimeUs, 0, __ATOMIC_SEQ_CST);
+}
+
+uint64_t aws_iot_benchmark_virtual_clock_now_us(void) {
+	return __atomic_load_n(&virtualTimeUs, __ATOMIC_SEQ_CST);
+}
+
+uint64_t aws_iot_benchmark_virtual_clock_now_ms(void) {
+	return aws_iot_benchmark_virtual_clock_now_us() / 1000;
+}
+
+void aws_iot_benchmark_virtual_clock_advance_us(uint64_t us) {
+	(void) __atomic_add_fetch(&virtualTimeUs, us, __ATOMIC_SEQ_CST);
+}
+
+void aws_iot_benchmark_virtual_clock_advance_ms(uint32_t ms) {
+	aws_iot_benchmark_virtual_clock_advance_us((uint64_t) ms * 1000);
+}
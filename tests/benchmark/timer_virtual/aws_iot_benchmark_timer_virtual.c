@@ -0,0 +1,75 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_timer_virtual.c
+ * @brief Timer implementation driven by the virtual clock
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "timer_platform.h"
+#include "aws_iot_benchmark_timer_virtual.h"
+#include "aws_iot_benchmark_virtual_clock.h"
+
+static uint32_t pollStepUs = BENCHMARK_TIMER_DEFAULT_POLL_STEP_US;
+static uint64_t pollCount;
+
+void aws_iot_benchmark_timer_set_poll_step_us(uint32_t stepUs) {
+	__atomic_store_n(&pollStepUs, stepUs, __ATOMIC_RELAXED);
+}
+
+uint64_t aws_iot_benchmark_timer_poll_count(void) {
+	return __atomic_load_n(&pollCount, __ATOMIC_RELAXED);
+}
+
+bool has_timer_expired(Timer *timer) {
+	if(aws_iot_benchmark_virtual_clock_now_us() >= timer->end_us) {
+		return true;
+	}
+
+	/* Somebody is waiting for this timer, let time pass */
+	(void) __atomic_add_fetch(&pollCount, 1, __ATOMIC_RELAXED);
+	aws_iot_benchmark_virtual_clock_advance_us(__atomic_load_n(&pollStepUs, __ATOMIC_RELAXED));
+	return false;
+}
+
+void countdown_ms(Timer *timer, uint32_t timeout) {
+	timer->end_us = aws_iot_benchmark_virtual_clock_now_us() + ((uint64_t) timeout * 1000);
+}
+
+uint32_t left_ms(Timer *timer) {
+	uint64_t now = aws_iot_benchmark_virtual_clock_now_us();
+
+	if(now >= timer->end_us) {
+		return 0;
+	}
+
+	return (uint32_t) ((timer->end_us - now) / 1000);
+}
+
+void countdown_sec(Timer *timer, uint32_t timeout) {
+	timer->end_us = aws_iot_benchmark_virtual_clock_now_us() + ((uint64_t) timeout * 1000000);
+}
+
+void init_timer(Timer *timer) {
+	timer->end_us = 0;
+}
+
+void delay(unsigned milliseconds) {
+	aws_iot_benchmark_virtual_clock_advance_ms(milliseconds);
+}
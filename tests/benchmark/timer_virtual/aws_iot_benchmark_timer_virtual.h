@@ -0,0 +1,59 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_timer_virtual.h
+ * @brief Timer implementation driven by the virtual clock
+ *
+ * Implements the timer interface on top of aws_iot_benchmark_virtual_clock.h, so that
+ * keepalives, reconnect back-off and command timeouts follow virtual time. Build with
+ * timer_virtual instead of platform/linux/common to use it.
+ *
+ * The SDK waits for timers by polling them in a loop. With a clock that only moves when it
+ * is advanced such a loop would never end, so every poll of a timer that has not expired
+ * yet advances the clock by the poll step. The step stands for the time one iteration of
+ * a wait loop takes: a smaller step is more precise, a larger step simulates faster.
+ */
+
+#ifndef AWS_IOT_BENCHMARK_TIMER_VIRTUAL_H_
+#define AWS_IOT_BENCHMARK_TIMER_VIRTUAL_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BENCHMARK_TIMER_DEFAULT_POLL_STEP_US 100 ///< Default virtual time per poll of a running timer
+
+/**
+ * @brief Set the virtual time that passes each time a running timer is polled
+ *
+ * @param stepUs Microseconds per poll, 0 makes the clock only move when advanced explicitly
+ */
+void aws_iot_benchmark_timer_set_poll_step_us(uint32_t stepUs);
+
+/**
+ * @brief Number of polls of running timers so far
+ *
+ * A rough measure of how much the client busy waits, independent of the machine.
+ */
+uint64_t aws_iot_benchmark_timer_poll_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_BENCHMARK_TIMER_VIRTUAL_H_ */
@@ -33,6 +33,15 @@
 /* Interval that each thread sleeps for */
 #define THREAD_SLEEP_INTERVAL_USEC 500000
 
+/* Number of QoS0 messages to publish in each thread of the throughput benchmark */
+#define THROUGHPUT_PUBLISH_COUNT 1000
+
+/* Number of publish threads for the throughput benchmark */
+#define THROUGHPUT_PUB_THREAD_COUNT 4
+
+/* Topic used by the throughput benchmark */
+#define THROUGHPUT_TEST_TOPIC "Tests/Integration/EmbeddedC/Throughput"
+
 /* Test topic to publish on */
 #define INTEGRATION_TEST_TOPIC "Tests/Integration/EmbeddedC"
 
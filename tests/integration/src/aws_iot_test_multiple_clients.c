@@ -69,7 +69,7 @@ static void aws_iot_mqtt_tests_disconnect_callback_handler(AWS_IoT_Client *pClie
 static IoT_Error_t aws_iot_mqtt_tests_connect_client_to_service(AWS_IoT_Client *pClient, struct timeval *pConnectTime,
 															   char *clientId, char *rootCA, char *clientCRT,
 															   char *clientKey) {
-	IoT_Client_Init_Params initParams;
+	IoT_Client_Init_Params initParams = IoT_Client_Init_Params_initializer;
 	IoT_Client_Connect_Params connectParams;
 	IoT_Error_t rc;
 	struct timeval start, end;
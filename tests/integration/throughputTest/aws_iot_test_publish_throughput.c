@@ -0,0 +1,261 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_test_publish_throughput.c
+ * @brief Multithreaded publish throughput benchmark
+ *
+ * One thread yields continuously while THROUGHPUT_PUB_THREAD_COUNT threads publish
+ * QoS0 messages back to back on the same client. Publishes never wait for the yield
+ * thread, so the numbers reported here are bounded by the write side of the connection.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_log.h"
+
+#include "aws_iot_integ_tests_config.h"
+#include "aws_iot_config.h"
+
+static volatile bool terminate_yield_thread;
+
+static unsigned int rxMsgCount;
+static unsigned int yieldCount;
+static unsigned int yieldNotIdleCount;
+static unsigned int pubNotIdleCount[THROUGHPUT_PUB_THREAD_COUNT];
+static unsigned int pubFailCount[THROUGHPUT_PUB_THREAD_COUNT];
+
+typedef struct ThreadData {
+	int threadId;
+	AWS_IoT_Client *client;
+} ThreadData;
+
+static void aws_iot_mqtt_tests_throughput_callback(AWS_IoT_Client *pClient, char *topicName,
+												   uint16_t topicNameLen, IoT_Publish_Message_Params *params,
+												   void *pData) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(topicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(params);
+	IOT_UNUSED(pData);
+
+	/* Only the yield thread delivers messages */
+	rxMsgCount++;
+}
+
+static void aws_iot_mqtt_tests_disconnect_callback_handler(AWS_IoT_Client *pClient, void *param) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(param);
+}
+
+static void *aws_iot_mqtt_tests_yield_thread_runner(void *ptr) {
+	IoT_Error_t rc = SUCCESS;
+	AWS_IoT_Client *pClient = (AWS_IoT_Client *) ptr;
+
+	/* No sleep between calls, the reader owns the read side for the whole test */
+	while(false == terminate_yield_thread) {
+		rc = aws_iot_mqtt_yield(pClient, 100);
+		yieldCount++;
+		if(MQTT_CLIENT_NOT_IDLE_ERROR == rc) {
+			yieldNotIdleCount++;
+		} else if(SUCCESS != rc) {
+			IOT_ERROR("\nYield Returned : %d ", rc);
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static void *aws_iot_mqtt_tests_publish_thread_runner(void *ptr) {
+	int itr = 0;
+	char cPayload[100];
+	IoT_Publish_Message_Params params;
+	IoT_Error_t rc = SUCCESS;
+	ThreadData *threadData = (ThreadData *) ptr;
+	AWS_IoT_Client *pClient = threadData->client;
+	int threadId = threadData->threadId;
+
+	params.qos = QOS0;
+	params.isRetained = 0;
+	params.payload = (void *) cPayload;
+
+	for(itr = 0; itr < THROUGHPUT_PUBLISH_COUNT; itr++) {
+		snprintf(cPayload, 100, "%s_Thread : %d, Msg : %d", AWS_IOT_MY_THING_NAME, threadId, itr);
+		params.payloadLen = strlen(cPayload) + 1;
+
+		do {
+			rc = aws_iot_mqtt_publish(pClient, THROUGHPUT_TEST_TOPIC, strlen(THROUGHPUT_TEST_TOPIC), &params);
+			if(MQTT_CLIENT_NOT_IDLE_ERROR == rc) {
+				pubNotIdleCount[threadId - 1]++;
+			}
+		} while(MUTEX_LOCK_ERROR == rc || MQTT_CLIENT_NOT_IDLE_ERROR == rc);
+
+		if(SUCCESS != rc) {
+			pubFailCount[threadId - 1]++;
+		}
+	}
+
+	return NULL;
+}
+
+static double aws_iot_mqtt_tests_elapsed_sec(struct timeval *pStart, struct timeval *pEnd) {
+	struct timeval diff;
+
+	timersub(pEnd, pStart, &diff);
+	return (double) diff.tv_sec + ((double) diff.tv_usec / 1000000.0);
+}
+
+int aws_iot_mqtt_tests_publish_throughput() {
+	pthread_t publish_thread[THROUGHPUT_PUB_THREAD_COUNT], yield_thread;
+	char certDirectory[15] = "../../certs";
+	char clientCRT[PATH_MAX + 1];
+	char clientKey[PATH_MAX + 1];
+	char CurrentWD[PATH_MAX + 1];
+	char root_CA[PATH_MAX + 1];
+	char clientId[50];
+	IoT_Client_Init_Params initParams = IoT_Client_Init_Params_initializer;
+	IoT_Client_Connect_Params connectParams = iotClientConnectParamsDefault;
+	ThreadData threadData[THROUGHPUT_PUB_THREAD_COUNT];
+	AWS_IoT_Client client;
+	IoT_Error_t rc = SUCCESS;
+	struct timeval start, end;
+	unsigned int totalPublished = 0, totalNotIdle = 0, totalFailed = 0;
+	double elapsedSec;
+	int i;
+
+	terminate_yield_thread = false;
+	rxMsgCount = 0;
+	yieldCount = 0;
+	yieldNotIdleCount = 0;
+	for(i = 0; i < THROUGHPUT_PUB_THREAD_COUNT; i++) {
+		pubNotIdleCount[i] = 0;
+		pubFailCount[i] = 0;
+	}
+
+	getcwd(CurrentWD, sizeof(CurrentWD));
+	snprintf(root_CA, PATH_MAX + 1, "%s/%s/%s", CurrentWD, certDirectory, AWS_IOT_ROOT_CA_FILENAME);
+	snprintf(clientCRT, PATH_MAX + 1, "%s/%s/%s", CurrentWD, certDirectory, AWS_IOT_CERTIFICATE_FILENAME);
+	snprintf(clientKey, PATH_MAX + 1, "%s/%s/%s", CurrentWD, certDirectory, AWS_IOT_PRIVATE_KEY_FILENAME);
+	srand((unsigned int) time(NULL));
+	snprintf(clientId, 50, "%s_%d", INTEGRATION_TEST_CLIENT_ID, rand() % 10000);
+
+	initParams.pHostURL = AWS_IOT_MQTT_HOST;
+	initParams.port = AWS_IOT_MQTT_PORT;
+	initParams.pRootCALocation = root_CA;
+	initParams.pDeviceCertLocation = clientCRT;
+	initParams.pDevicePrivateKeyLocation = clientKey;
+	initParams.mqttCommandTimeout_ms = 10000;
+	initParams.tlsHandshakeTimeout_ms = 10000;
+	initParams.disconnectHandler = aws_iot_mqtt_tests_disconnect_callback_handler;
+	initParams.enableAutoReconnect = false;
+	initParams.isBlockOnThreadLockEnabled = true;
+	rc = aws_iot_mqtt_init(&client, &initParams);
+	if(SUCCESS != rc) {
+		IOT_ERROR("ERROR Initializing %d\n", rc);
+		return -1;
+	}
+
+	connectParams.keepAliveIntervalInSec = 10;
+	connectParams.isCleanSession = true;
+	connectParams.MQTTVersion = MQTT_3_1_1;
+	connectParams.pClientID = clientId;
+	connectParams.clientIDLen = (uint16_t) strlen(clientId);
+	connectParams.isWillMsgPresent = false;
+
+	rc = aws_iot_mqtt_connect(&client, &connectParams);
+	if(SUCCESS != rc) {
+		IOT_ERROR("ERROR Connecting %d\n", rc);
+		return -1;
+	}
+
+	rc = aws_iot_mqtt_subscribe(&client, THROUGHPUT_TEST_TOPIC, strlen(THROUGHPUT_TEST_TOPIC), QOS0,
+								aws_iot_mqtt_tests_throughput_callback, NULL);
+	if(SUCCESS != rc) {
+		IOT_ERROR("ERROR Subscribing %d\n", rc);
+		aws_iot_mqtt_disconnect(&client);
+		return -1;
+	}
+
+	pthread_create(&yield_thread, NULL, aws_iot_mqtt_tests_yield_thread_runner, &client);
+
+	gettimeofday(&start, NULL);
+	for(i = 0; i < THROUGHPUT_PUB_THREAD_COUNT; i++) {
+		threadData[i].client = &client;
+		threadData[i].threadId = i + 1;
+		pthread_create(&publish_thread[i], NULL, aws_iot_mqtt_tests_publish_thread_runner, &threadData[i]);
+	}
+
+	for(i = 0; i < THROUGHPUT_PUB_THREAD_COUNT; i++) {
+		pthread_join(publish_thread[i], NULL);
+	}
+	gettimeofday(&end, NULL);
+
+	/* Give the yield thread time to drain whatever the broker echoes back */
+	sleep(1);
+	terminate_yield_thread = true;
+	pthread_join(yield_thread, NULL);
+
+	for(i = 0; i < THROUGHPUT_PUB_THREAD_COUNT; i++) {
+		totalNotIdle += pubNotIdleCount[i];
+		totalFailed += pubFailCount[i];
+	}
+	totalPublished = (THROUGHPUT_PUB_THREAD_COUNT * THROUGHPUT_PUBLISH_COUNT) - totalFailed;
+	elapsedSec = aws_iot_mqtt_tests_elapsed_sec(&start, &end);
+
+	printf("\n\nResult : \n");
+	printf("Publish threads: %d, messages per thread: %d\n", THROUGHPUT_PUB_THREAD_COUNT, THROUGHPUT_PUBLISH_COUNT);
+	printf("Published Messages: %u in %.3f sec (%.1f msg/s)\n", totalPublished, elapsedSec,
+		   (elapsedSec > 0) ? (double) totalPublished / elapsedSec : 0.0);
+	printf("Received Messages: %u\n", rxMsgCount);
+	printf("Failed publishes: %u\n", totalFailed);
+	printf("Publish retries on MQTT_CLIENT_NOT_IDLE_ERROR: %u\n", totalNotIdle);
+	printf("Yield calls: %u, returned MQTT_CLIENT_NOT_IDLE_ERROR: %u\n", yieldCount, yieldNotIdleCount);
+
+	aws_iot_mqtt_disconnect(&client);
+
+	/* Publishes and yield must never have blocked each other */
+	if(0 != totalFailed || 0 != totalNotIdle || 0 != yieldNotIdleCount) {
+		return -2;
+	}
+
+	return 0;
+}
+
+int main() {
+	printf("\n\n");
+	printf("******************************************************************\n");
+	printf("* Starting MQTT Version 3.1.1 Publish Throughput Benchmark       *\n");
+	printf("******************************************************************\n");
+	int rc = aws_iot_mqtt_tests_publish_throughput();
+	if(0 != rc) {
+		printf("\n*******************************************************************\n");
+		printf("*MQTT Version 3.1.1 Publish Throughput Benchmark FAILED! RC : %d \n", rc);
+		printf("*******************************************************************\n");
+		return 1;
+	}
+
+	printf("******************************************************************\n");
+	printf("* MQTT Version 3.1.1 Publish Throughput Benchmark SUCCESS!!      *\n");
+	printf("******************************************************************\n");
+
+	return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * Generated by tools/shadow_codegen/aws_iot_shadow_codegen.py from codegen_device.json.
+ * Do not edit, run the generator again after changing the schema.
+ */
+
+/**
+ * @file aws_iot_tests_unit_codegen_device.h
+ * @brief Encoder and decoder of the codegen_device shadow state
+ */
+
+#ifndef AWS_IOT_TESTS_UNIT_CODEGEN_DEVICE_H_
+#define AWS_IOT_TESTS_UNIT_CODEGEN_DEVICE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aws_iot_error.h"
+
+/* Field mask, one bit per leaf */
+#define CODEGEN_DEVICE_TEMPERATURE (1u << 0) ///< temperature
+#define CODEGEN_DEVICE_HUMIDITY (1u << 1) ///< humidity
+#define CODEGEN_DEVICE_WINDOWOPEN (1u << 2) ///< windowOpen
+#define CODEGEN_DEVICE_MODE (1u << 3) ///< mode
+#define CODEGEN_DEVICE_OFFSET (1u << 4) ///< offset
+#define CODEGEN_DEVICE_ALTITUDE (1u << 5) ///< altitude
+#define CODEGEN_DEVICE_UPTIME (1u << 6) ///< uptime
+#define CODEGEN_DEVICE_BRIGHTNESS (1u << 7) ///< brightness
+#define CODEGEN_DEVICE_PORT (1u << 8) ///< port
+#define CODEGEN_DEVICE_COUNTER (1u << 9) ///< counter
+#define CODEGEN_DEVICE_FAN_SPEED (1u << 10) ///< fan.speed
+#define CODEGEN_DEVICE_FAN_OSCILLATE (1u << 11) ///< fan.oscillate
+#define CODEGEN_DEVICE_FAN (CODEGEN_DEVICE_FAN_SPEED | CODEGEN_DEVICE_FAN_OSCILLATE) ///< All of fan
+#define CODEGEN_DEVICE_ALL (CODEGEN_DEVICE_TEMPERATURE | CODEGEN_DEVICE_HUMIDITY | CODEGEN_DEVICE_WINDOWOPEN | CODEGEN_DEVICE_MODE | CODEGEN_DEVICE_OFFSET | CODEGEN_DEVICE_ALTITUDE | CODEGEN_DEVICE_UPTIME | CODEGEN_DEVICE_BRIGHTNESS | CODEGEN_DEVICE_PORT | CODEGEN_DEVICE_COUNTER | CODEGEN_DEVICE_FAN) ///< Every field
+
+/**
+ * Tokens the decoder has on the stack. The default fits a get/accepted document with both
+ * sections, members that are not in the schema need more.
+ */
+#ifndef CODEGEN_DEVICE_MAX_JSON_TOKENS
+#define CODEGEN_DEVICE_MAX_JSON_TOKENS 70
+#endif
+
+/**
+ * @brief fan
+ */
+typedef struct {
+	uint8_t speed; ///< fan.speed
+	bool oscillate; ///< fan.oscillate
+} codegen_device_fan_t;
+
+/**
+ * @brief State of the shadow
+ */
+typedef struct {
+	float temperature; ///< temperature
+	double humidity; ///< humidity
+	bool windowOpen; ///< windowOpen
+	char mode[16]; ///< mode
+	int8_t offset; ///< offset
+	int16_t altitude; ///< altitude
+	int32_t uptime; ///< uptime
+	uint8_t brightness; ///< brightness
+	uint16_t port; ///< port
+	uint32_t counter; ///< counter
+	codegen_device_fan_t fan; ///< fan
+} codegen_device_t;
+
+/**
+ * @brief Write the fields as a JSON object, for example a telemetry message
+ *
+ * @param pBuffer Buffer for the NUL terminated object
+ * @param bufferLen Size of the buffer
+ * @param pValue State
+ * @param fieldMask Fields to write, CODEGEN_DEVICE_ALL for all
+ * @param pLen Set to the length of the object, may be NULL
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR or SHADOW_JSON_BUFFER_TRUNCATED
+ */
+IoT_Error_t codegen_device_encode(char *pBuffer, size_t bufferLen, const codegen_device_t *pValue, uint32_t fieldMask,
+		size_t *pLen);
+
+/**
+ * @brief Add the fields as the reported section, like aws_iot_shadow_add_reported
+ *
+ * Call between aws_iot_shadow_init_json_document and aws_iot_finalize_json_document.
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR or SHADOW_JSON_BUFFER_TRUNCATED
+ */
+IoT_Error_t codegen_device_add_reported(char *pJsonDocument, size_t maxSizeOfJsonDocument, const codegen_device_t *pValue,
+		uint32_t fieldMask);
+
+/**
+ * @brief Add the fields as the desired section, like aws_iot_shadow_add_desired
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR or SHADOW_JSON_BUFFER_TRUNCATED
+ */
+IoT_Error_t codegen_device_add_desired(char *pJsonDocument, size_t maxSizeOfJsonDocument, const codegen_device_t *pValue,
+		uint32_t fieldMask);
+
+/**
+ * @brief Read the fields of a received shadow document
+ *
+ * Keys that are not in the schema and values of the wrong type are skipped, the metadata
+ * is not tokenized.
+ *
+ * @param pJsonDocument Document, for example the payload of update/delta or get/accepted
+ * @param jsonLen Length of the document
+ * @param pSection NULL to read the members of "state", as in a delta, or "desired" or
+ * "reported" to read that section of the state
+ * @param pValue Fields found in the document are written here, the others are left alone
+ * @param pFieldMask Set to the fields that were written
+ *
+ * @return SUCCESS, also when the document has no such section, NULL_VALUE_ERROR or
+ * JSON_PARSE_ERROR
+ */
+IoT_Error_t codegen_device_decode(const char *pJsonDocument, size_t jsonLen, const char *pSection, codegen_device_t *pValue,
+		uint32_t *pFieldMask);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_TESTS_UNIT_CODEGEN_DEVICE_H_ */
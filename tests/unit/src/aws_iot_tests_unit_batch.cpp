@@ -0,0 +1,42 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_batch.cpp
+ * @brief IoT Client Unit Testing - Batching Publisher Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(BatchTests) {
+	TEST_GROUP_C_SETUP_WRAPPER(BatchTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(BatchTests)
+};
+
+/* H:1 - Init with invalid parameters */
+TEST_GROUP_C_WRAPPER(BatchTests, InitInvalidParams)
+/* H:2 - JSON array batch published after maxSamples samples */
+TEST_GROUP_C_WRAPPER(BatchTests, JsonArrayFlushOnSampleCount)
+/* H:3 - Length-prefixed batch published when the next sample does not fit */
+TEST_GROUP_C_WRAPPER(BatchTests, LengthPrefixedFlushOnSize)
+/* H:4 - Batch published by poll once its oldest sample is maxAge_ms old */
+TEST_GROUP_C_WRAPPER(BatchTests, PollFlushOnAge)
+/* H:5 - Samples kept while disconnected and published by the first poll after connecting */
+TEST_GROUP_C_WRAPPER(BatchTests, KeepWhileDisconnectedFlushOnConnect)
+/* H:6 - QoS1 batch kept when the PUBACK does not arrive */
+TEST_GROUP_C_WRAPPER(BatchTests, Qos1BatchKeptWithoutPuback)
+/* H:7 - Batch kept within the MQTT 5.0 Maximum Packet Size of the server */
+TEST_GROUP_C_WRAPPER(BatchTests, Mqtt5MaximumPacketSize)
@@ -0,0 +1,279 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_batch_helper.c
+ * @brief IoT Client Unit Testing - Batching Publisher Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_batch.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+#define BATCH_TEST_TOPIC "dt/sensor/batch"
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static AWS_IoT_Client iotClient;
+static IoT_Batch_Publisher_Params batchParams;
+static IoT_Batch_Publisher_t batch;
+static unsigned char batchBuffer[32];
+
+static void connectClient(void) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+}
+
+/* Checks that the last packet written is a QoS0 PUBLISH ending with the given payload */
+static void checkLastPublishPayload(const void *pPayload, size_t payloadLen) {
+	CHECK_EQUAL_C_INT(0x30, TxBuffer.pBuffer[0]);
+	CHECK_C(TxBuffer.len > payloadLen);
+	CHECK_C(0 == memcmp(&TxBuffer.pBuffer[TxBuffer.len - payloadLen], pPayload, payloadLen));
+}
+
+TEST_GROUP_C_SETUP(BatchTests) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	initParams.mqttCommandTimeout_ms = 200;
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+
+	batchParams.pTopicName = BATCH_TEST_TOPIC;
+	batchParams.topicNameLen = (uint16_t) strlen(BATCH_TEST_TOPIC);
+	batchParams.qos = QOS0;
+	batchParams.format = BATCH_FORMAT_JSON_ARRAY;
+	batchParams.pBuffer = batchBuffer;
+	batchParams.bufferLen = sizeof(batchBuffer);
+	batchParams.maxSamples = 0;
+	batchParams.maxAge_ms = 0;
+}
+
+TEST_GROUP_C_TEARDOWN(BatchTests) { }
+
+/* H:1 - Init with invalid parameters */
+TEST_C(BatchTests, InitInvalidParams) {
+	IoT_Batch_Publisher_Params params;
+	static unsigned char largeBuffer[AWS_IOT_MQTT_TX_BUF_LEN];
+
+	IOT_DEBUG("-->Running Batch Tests - H:1 - Init with invalid parameters \n");
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_batch_init(NULL, &iotClient, &batchParams));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_batch_init(&batch, NULL, &batchParams));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_batch_init(&batch, &iotClient, NULL));
+
+	params = batchParams;
+	params.pTopicName = NULL;
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_batch_init(&batch, &iotClient, &params));
+	params = batchParams;
+	params.pBuffer = NULL;
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_batch_init(&batch, &iotClient, &params));
+
+	/* A full batch has to fit in the write buffer of the client */
+	params = batchParams;
+	params.pBuffer = largeBuffer;
+	params.bufferLen = sizeof(largeBuffer);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, aws_iot_mqtt_batch_init(&batch, &iotClient, &params));
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_batch_append(NULL, "1", 1));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_batch_flush(NULL));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_batch_poll(NULL));
+
+	IOT_DEBUG("-->Success - H:1 - Init with invalid parameters \n");
+}
+
+/* H:2 - JSON array batch published after maxSamples samples */
+TEST_C(BatchTests, JsonArrayFlushOnSampleCount) {
+	IOT_DEBUG("-->Running Batch Tests - H:2 - JSON array batch published after maxSamples samples \n");
+
+	connectClient();
+	batchParams.maxSamples = 3;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_init(&batch, &iotClient, &batchParams));
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_append(&batch, "21.5", 4));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_append(&batch, "{\"t\":2}", 7));
+	CHECK_EQUAL_C_INT(2, aws_iot_mqtt_batch_pending_samples(&batch));
+	CHECK_EQUAL_C_INT(0, TxBuffer.len);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_append(&batch, "22", 2));
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_batch_pending_samples(&batch));
+	CHECK_EQUAL_C_INT(1, batch.batchCount);
+	checkLastPublishPayload("[21.5,{\"t\":2},22]", 17);
+
+	/* Flushing an empty batch publishes nothing */
+	ResetTLSBuffer();
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_flush(&batch));
+	CHECK_EQUAL_C_INT(0, TxBuffer.len);
+
+	IOT_DEBUG("-->Success - H:2 - JSON array batch published after maxSamples samples \n");
+}
+
+/* H:3 - Length-prefixed batch published when the next sample does not fit */
+TEST_C(BatchTests, LengthPrefixedFlushOnSize) {
+	unsigned char sample[10];
+
+	IOT_DEBUG("-->Running Batch Tests - H:3 - Length-prefixed batch published when the next sample does not fit \n");
+
+	connectClient();
+	batchParams.format = BATCH_FORMAT_LENGTH_PREFIXED;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_init(&batch, &iotClient, &batchParams));
+
+	/* 12 bytes per record, two fit in 32 bytes */
+	memset(sample, 'a', sizeof(sample));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_append(&batch, sample, sizeof(sample)));
+	memset(sample, 'b', sizeof(sample));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_append(&batch, sample, sizeof(sample)));
+	CHECK_EQUAL_C_INT(0, batch.batchCount);
+
+	memset(sample, 'c', sizeof(sample));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_append(&batch, sample, sizeof(sample)));
+	CHECK_EQUAL_C_INT(1, batch.batchCount);
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_batch_pending_samples(&batch));
+	checkLastPublishPayload("\x00\x0a" "aaaaaaaaaa" "\x00\x0a" "bbbbbbbbbb", 24);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_flush(&batch));
+	checkLastPublishPayload("\x00\x0a" "cccccccccc", 12);
+
+	/* A sample that does not fit in an empty batch */
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, aws_iot_mqtt_batch_append(&batch, batchBuffer, sizeof(batchBuffer) - 1));
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_batch_pending_samples(&batch));
+
+	IOT_DEBUG("-->Success - H:3 - Length-prefixed batch published when the next sample does not fit \n");
+}
+
+/* H:4 - Batch published by poll once its oldest sample is maxAge_ms old */
+TEST_C(BatchTests, PollFlushOnAge) {
+	IOT_DEBUG("-->Running Batch Tests - H:4 - Batch published by poll once its oldest sample is maxAge_ms old \n");
+
+	connectClient();
+	batchParams.maxAge_ms = 20;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_init(&batch, &iotClient, &batchParams));
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_poll(&batch));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_append(&batch, "1", 1));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_poll(&batch));
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_batch_pending_samples(&batch));
+
+	usleep(40 * 1000);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_append(&batch, "2", 1));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_poll(&batch));
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_batch_pending_samples(&batch));
+	checkLastPublishPayload("[1,2]", 5);
+
+	IOT_DEBUG("-->Success - H:4 - Batch published by poll once its oldest sample is maxAge_ms old \n");
+}
+
+/* H:5 - Samples kept while disconnected and published by the first poll after connecting */
+TEST_C(BatchTests, KeepWhileDisconnectedFlushOnConnect) {
+	IOT_DEBUG("-->Running Batch Tests - H:5 - Samples kept while disconnected and published after connecting \n");
+
+	batchParams.maxSamples = 2;
+	batchParams.bufferLen = 8;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_init(&batch, &iotClient, &batchParams));
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_append(&batch, "1", 1));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_append(&batch, "2", 1));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_append(&batch, "3", 1));
+	CHECK_EQUAL_C_INT(3, aws_iot_mqtt_batch_pending_samples(&batch));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_poll(&batch));
+	CHECK_EQUAL_C_INT(3, aws_iot_mqtt_batch_pending_samples(&batch));
+
+	/* "[1,2,3" and the bracket leave no room, the batch cannot be published */
+	CHECK_EQUAL_C_INT(NETWORK_DISCONNECTED_ERROR, aws_iot_mqtt_batch_append(&batch, "4", 1));
+	CHECK_EQUAL_C_INT(NETWORK_DISCONNECTED_ERROR, aws_iot_mqtt_batch_flush(&batch));
+	CHECK_EQUAL_C_INT(3, aws_iot_mqtt_batch_pending_samples(&batch));
+
+	connectClient();
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_poll(&batch));
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_batch_pending_samples(&batch));
+	CHECK_EQUAL_C_INT(1, batch.batchCount);
+	checkLastPublishPayload("[1,2,3]", 7);
+
+	IOT_DEBUG("-->Success - H:5 - Samples kept while disconnected and published after connecting \n");
+}
+
+/* H:6 - QoS1 batch kept when the PUBACK does not arrive */
+TEST_C(BatchTests, Qos1BatchKeptWithoutPuback) {
+	IOT_DEBUG("-->Running Batch Tests - H:6 - QoS1 batch kept when the PUBACK does not arrive \n");
+
+	connectClient();
+	batchParams.qos = QOS1;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_init(&batch, &iotClient, &batchParams));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_append(&batch, "7", 1));
+
+	CHECK_EQUAL_C_INT(MQTT_REQUEST_TIMEOUT_ERROR, aws_iot_mqtt_batch_flush(&batch));
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_batch_pending_samples(&batch));
+
+	ResetTLSBuffer();
+	setTLSRxBufferForPuback();
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_poll(&batch));
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_batch_pending_samples(&batch));
+
+	IOT_DEBUG("-->Success - H:6 - QoS1 batch kept when the PUBACK does not arrive \n");
+}
+
+/* H:7 - Batch kept within the MQTT 5.0 Maximum Packet Size of the server */
+TEST_C(BatchTests, Mqtt5MaximumPacketSize) {
+	/* CONNACK with Maximum Packet Size 36, which leaves 8 bytes for the batch on BATCH_TEST_TOPIC */
+	static const unsigned char connackWithMaximumPacketSize[] = {0x20, 0x08, 0x00, 0x00, 0x05,
+																 0x27, 0x00, 0x00, 0x00, 0x24};
+
+	IOT_DEBUG("-->Running Batch Tests - H:7 - Batch kept within the MQTT 5.0 Maximum Packet Size of the server \n");
+
+	connectParams.MQTTVersion = MQTT_5_0;
+	ResetTLSBuffer();
+	RxBuffer.NoMsgFlag = false;
+	memcpy(RxBuffer.pBuffer, connackWithMaximumPacketSize, sizeof(connackWithMaximumPacketSize));
+	RxBuffer.len = sizeof(connackWithMaximumPacketSize);
+	RxIndex = 0;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_connect(&iotClient, &connectParams));
+	ResetTLSBuffer();
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_init(&batch, &iotClient, &batchParams));
+
+	/* The 32 byte buffer is not used up, "[1,2,3" and the bracket fill the 8 bytes */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_append(&batch, "1", 1));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_append(&batch, "2", 1));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_append(&batch, "3", 1));
+	CHECK_EQUAL_C_INT(0, batch.batchCount);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_append(&batch, "4", 1));
+	CHECK_EQUAL_C_INT(1, batch.batchCount);
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_batch_pending_samples(&batch));
+	checkLastPublishPayload("[1,2,3]", 7);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, aws_iot_mqtt_batch_append(&batch, "12345678", 8));
+
+	/* A lower limit after a reconnect, the pending batch can never be published and is dropped */
+	iotClient.clientData.serverMaximumPacketSize = 20;
+	ResetTLSBuffer();
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, aws_iot_mqtt_batch_flush(&batch));
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_batch_pending_samples(&batch));
+	CHECK_EQUAL_C_INT(0, TxBuffer.len);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_batch_flush(&batch));
+
+	IOT_DEBUG("-->Success - H:7 - Batch kept within the MQTT 5.0 Maximum Packet Size of the server \n");
+}
@@ -0,0 +1,50 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_cbor.cpp
+ * @brief IoT Client Unit Testing - CBOR Encoder and Decoder Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(CborTests) {
+	TEST_GROUP_C_SETUP_WRAPPER(CborTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(CborTests)
+};
+
+/* K:1 - Encode and decode with invalid parameters */
+TEST_GROUP_C_WRAPPER(CborTests, InvalidParams)
+/* K:2 - Encode every scalar type */
+TEST_GROUP_C_WRAPPER(CborTests, EncodeScalarTypes)
+/* K:3 - Integers are encoded in the shortest form */
+TEST_GROUP_C_WRAPPER(CborTests, EncodeShortestIntegers)
+/* K:4 - Doubles are encoded as floats only when exact */
+TEST_GROUP_C_WRAPPER(CborTests, EncodeDoubleAsFloat)
+/* K:5 - Encode into a buffer that is too small */
+TEST_GROUP_C_WRAPPER(CborTests, EncodeBufferTooSmall)
+/* K:6 - Decode what was encoded, including a nested object */
+TEST_GROUP_C_WRAPPER(CborTests, RoundTrip)
+/* K:7 - String decoded in place through the callback */
+TEST_GROUP_C_WRAPPER(CborTests, ZeroCopyString)
+/* K:8 - Unknown keys, nested values and non-text keys are skipped */
+TEST_GROUP_C_WRAPPER(CborTests, SkipUnknownEntries)
+/* K:9 - Value out of range or of the wrong type */
+TEST_GROUP_C_WRAPPER(CborTests, DecodeTypeMismatch)
+/* K:10 - Truncated, indefinite length and too deeply nested input */
+TEST_GROUP_C_WRAPPER(CborTests, DecodeMalformed)
+/* K:11 - Half floats and integers decoded into floating point fields */
+TEST_GROUP_C_WRAPPER(CborTests, DecodeFloatForms)
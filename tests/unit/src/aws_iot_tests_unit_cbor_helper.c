@@ -0,0 +1,448 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_cbor_helper.c
+ * @brief IoT Client Unit Testing - CBOR Encoder and Decoder Tests Helper
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_cbor.h"
+#include "aws_iot_log.h"
+
+#define CBOR_TEST_BUFFER_LEN 128
+
+static unsigned char encodeBuffer[CBOR_TEST_BUFFER_LEN];
+static size_t encodedLen;
+
+static const char *pCallbackValue;
+static uint32_t callbackValueLen;
+static uint32_t callbackCount;
+
+static void setField(jsonStruct_t *pField, const char *pKey, void *pData, size_t dataLength, JsonPrimitiveType type) {
+	pField->pKey = pKey;
+	pField->pData = pData;
+	pField->dataLength = dataLength;
+	pField->type = type;
+	pField->cb = NULL;
+}
+
+static void recordValueCallback(const char *pJsonValueBuffer, uint32_t valueLength, jsonStruct_t *pContext) {
+	IOT_UNUSED(pContext);
+
+	pCallbackValue = pJsonValueBuffer;
+	callbackValueLen = valueLength;
+	callbackCount++;
+}
+
+TEST_GROUP_C_SETUP(CborTests) {
+	memset(encodeBuffer, 0, sizeof(encodeBuffer));
+	encodedLen = 0;
+	pCallbackValue = NULL;
+	callbackValueLen = 0;
+	callbackCount = 0;
+}
+
+TEST_GROUP_C_TEARDOWN(CborTests) { }
+
+/* K:1 - Encode and decode with invalid parameters */
+TEST_C(CborTests, InvalidParams) {
+	jsonStruct_t field;
+	int32_t value = 1;
+
+	IOT_DEBUG("-->Running CBOR Tests - K:1 - Encode and decode with invalid parameters \n");
+
+	setField(&field, "v", &value, sizeof(value), SHADOW_JSON_INT32);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_cbor_encode(NULL, sizeof(encodeBuffer), &encodedLen, 1, &field));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_cbor_encode(encodeBuffer, sizeof(encodeBuffer), NULL, 1, &field));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR,
+					  aws_iot_cbor_encode(encodeBuffer, sizeof(encodeBuffer), &encodedLen, 1, (jsonStruct_t *) NULL));
+
+	field.pKey = NULL;
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_cbor_encode(encodeBuffer, sizeof(encodeBuffer), &encodedLen, 1, &field));
+	setField(&field, "v", NULL, 0, SHADOW_JSON_STRING);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_cbor_encode(encodeBuffer, sizeof(encodeBuffer), &encodedLen, 1, &field));
+	setField(&field, "v", encodeBuffer, 0, SHADOW_JSON_OBJECT);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_cbor_encode(encodeBuffer, sizeof(encodeBuffer), &encodedLen, 1, &field));
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_cbor_decode(NULL, 1, 1, &field));
+	CHECK_EQUAL_C_INT(0, encodedLen);
+
+	IOT_DEBUG("-->Success - K:1 - Encode and decode with invalid parameters \n");
+}
+
+/* K:2 - Encode every scalar type */
+TEST_C(CborTests, EncodeScalarTypes) {
+	static const unsigned char expected[] = {
+		0xA9,
+		0x61, 'a', 0x24,
+		0x61, 'b', 0x39, 0x03, 0xE7,
+		0x61, 'c', 0x38, 0x7F,
+		0x61, 'd', 0x19, 0x01, 0xF4,
+		0x61, 'e', 0x19, 0xFF, 0xFF,
+		0x61, 'f', 0x18, 0xFF,
+		0x61, 'g', 0xFA, 0x3F, 0xC0, 0x00, 0x00,
+		0x61, 'h', 0xF5,
+		0x61, 's', 0x62, 'o', 'k'
+	};
+	int32_t i32 = -5;
+	int16_t i16 = -1000;
+	int8_t i8 = -128;
+	uint32_t u32 = 500;
+	uint16_t u16 = 65535;
+	uint8_t u8 = 255;
+	float f = 1.5f;
+	bool b = true;
+	char s[] = "ok";
+	jsonStruct_t fields[9];
+
+	IOT_DEBUG("-->Running CBOR Tests - K:2 - Encode every scalar type \n");
+
+	setField(&fields[0], "a", &i32, sizeof(i32), SHADOW_JSON_INT32);
+	setField(&fields[1], "b", &i16, sizeof(i16), SHADOW_JSON_INT16);
+	setField(&fields[2], "c", &i8, sizeof(i8), SHADOW_JSON_INT8);
+	setField(&fields[3], "d", &u32, sizeof(u32), SHADOW_JSON_UINT32);
+	setField(&fields[4], "e", &u16, sizeof(u16), SHADOW_JSON_UINT16);
+	setField(&fields[5], "f", &u8, sizeof(u8), SHADOW_JSON_UINT8);
+	setField(&fields[6], "g", &f, sizeof(f), SHADOW_JSON_FLOAT);
+	setField(&fields[7], "h", &b, sizeof(b), SHADOW_JSON_BOOL);
+	setField(&fields[8], "s", s, sizeof(s), SHADOW_JSON_STRING);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_cbor_encode(encodeBuffer, sizeof(encodeBuffer), &encodedLen, 9, &fields[0],
+												   &fields[1], &fields[2], &fields[3], &fields[4], &fields[5],
+												   &fields[6], &fields[7], &fields[8]));
+	CHECK_EQUAL_C_INT(sizeof(expected), encodedLen);
+	CHECK_C(0 == memcmp(expected, encodeBuffer, sizeof(expected)));
+
+	IOT_DEBUG("-->Success - K:2 - Encode every scalar type \n");
+}
+
+/* K:3 - Integers are encoded in the shortest form */
+TEST_C(CborTests, EncodeShortestIntegers) {
+	static const struct {
+		int32_t value;
+		unsigned char encoded[5];
+		size_t len;
+	} cases[] = {
+		{0, {0x00}, 1},
+		{23, {0x17}, 1},
+		{24, {0x18, 0x18}, 2},
+		{255, {0x18, 0xFF}, 2},
+		{256, {0x19, 0x01, 0x00}, 3},
+		{65536, {0x1A, 0x00, 0x01, 0x00, 0x00}, 5},
+		{-1, {0x20}, 1},
+		{-24, {0x37}, 1},
+		{-25, {0x38, 0x18}, 2},
+		{-257, {0x39, 0x01, 0x00}, 3},
+		{INT32_MIN, {0x3A, 0x7F, 0xFF, 0xFF, 0xFF}, 5}
+	};
+	jsonStruct_t field;
+	int32_t value;
+	size_t i;
+
+	IOT_DEBUG("-->Running CBOR Tests - K:3 - Integers are encoded in the shortest form \n");
+
+	setField(&field, "v", &value, sizeof(value), SHADOW_JSON_INT32);
+	for(i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		value = cases[i].value;
+		CHECK_EQUAL_C_INT(SUCCESS, aws_iot_cbor_encode(encodeBuffer, sizeof(encodeBuffer), &encodedLen, 1, &field));
+		/* Map head and the one character key come first */
+		CHECK_EQUAL_C_INT(3 + cases[i].len, encodedLen);
+		CHECK_C(0 == memcmp(cases[i].encoded, &encodeBuffer[3], cases[i].len));
+	}
+
+	IOT_DEBUG("-->Success - K:3 - Integers are encoded in the shortest form \n");
+}
+
+/* K:4 - Doubles are encoded as floats only when exact */
+TEST_C(CborTests, EncodeDoubleAsFloat) {
+	static const unsigned char half[] = {0xFA, 0x3F, 0x00, 0x00, 0x00};
+	static const unsigned char tenth[] = {0xFB, 0x3F, 0xB9, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9A};
+	jsonStruct_t field;
+	double value;
+
+	IOT_DEBUG("-->Running CBOR Tests - K:4 - Doubles are encoded as floats only when exact \n");
+
+	setField(&field, "v", &value, sizeof(value), SHADOW_JSON_DOUBLE);
+	value = 0.5;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_cbor_encode(encodeBuffer, sizeof(encodeBuffer), &encodedLen, 1, &field));
+	CHECK_EQUAL_C_INT(3 + sizeof(half), encodedLen);
+	CHECK_C(0 == memcmp(half, &encodeBuffer[3], sizeof(half)));
+
+	value = 0.1;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_cbor_encode(encodeBuffer, sizeof(encodeBuffer), &encodedLen, 1, &field));
+	CHECK_EQUAL_C_INT(3 + sizeof(tenth), encodedLen);
+	CHECK_C(0 == memcmp(tenth, &encodeBuffer[3], sizeof(tenth)));
+
+	IOT_DEBUG("-->Success - K:4 - Doubles are encoded as floats only when exact \n");
+}
+
+/* K:5 - Encode into a buffer that is too small */
+TEST_C(CborTests, EncodeBufferTooSmall) {
+	jsonStruct_t fields[3];
+	double d = 0.1;
+	uint32_t u32 = 70000;
+	char s[] = "telemetry";
+	size_t fullLen, len;
+
+	IOT_DEBUG("-->Running CBOR Tests - K:5 - Encode into a buffer that is too small \n");
+
+	setField(&fields[0], "temperature", &d, sizeof(d), SHADOW_JSON_DOUBLE);
+	setField(&fields[1], "count", &u32, sizeof(u32), SHADOW_JSON_UINT32);
+	setField(&fields[2], "source", s, sizeof(s), SHADOW_JSON_STRING);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_cbor_encode(encodeBuffer, sizeof(encodeBuffer), &fullLen, 3, &fields[0],
+												   &fields[1], &fields[2]));
+	for(len = 0; len < fullLen; len++) {
+		CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, aws_iot_cbor_encode(encodeBuffer, len, &encodedLen, 3, &fields[0],
+															  &fields[1], &fields[2]));
+	}
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_cbor_encode(encodeBuffer, fullLen, &encodedLen, 3, &fields[0], &fields[1],
+												   &fields[2]));
+	CHECK_EQUAL_C_INT(fullLen, encodedLen);
+
+	IOT_DEBUG("-->Success - K:5 - Encode into a buffer that is too small \n");
+}
+
+/* K:6 - Decode what was encoded, including a nested object */
+TEST_C(CborTests, RoundTrip) {
+	static const unsigned char nested[] = {0xA1, 0x61, 'x', 0x82, 0x01, 0xF4};
+	int32_t i32 = INT32_MIN, i32Out = 0;
+	uint32_t u32 = UINT32_MAX, u32Out = 0;
+	int8_t i8 = 127, i8Out = 0;
+	float f = -273.15f, fOut = 0;
+	double d = 6.02214076e23, dOut = 0;
+	bool b = false, bOut = true;
+	char s[] = "sensor-17", sOut[16];
+	unsigned char nestedOut[16];
+	jsonStruct_t in[8], out[8];
+
+	IOT_DEBUG("-->Running CBOR Tests - K:6 - Decode what was encoded \n");
+
+	setField(&in[0], "i32", &i32, sizeof(i32), SHADOW_JSON_INT32);
+	setField(&in[1], "u32", &u32, sizeof(u32), SHADOW_JSON_UINT32);
+	setField(&in[2], "i8", &i8, sizeof(i8), SHADOW_JSON_INT8);
+	setField(&in[3], "f", &f, sizeof(f), SHADOW_JSON_FLOAT);
+	setField(&in[4], "d", &d, sizeof(d), SHADOW_JSON_DOUBLE);
+	setField(&in[5], "b", &b, sizeof(b), SHADOW_JSON_BOOL);
+	setField(&in[6], "s", s, sizeof(s), SHADOW_JSON_STRING);
+	setField(&in[7], "o", (void *) nested, sizeof(nested), SHADOW_JSON_OBJECT);
+
+	setField(&out[0], "i32", &i32Out, sizeof(i32Out), SHADOW_JSON_INT32);
+	setField(&out[1], "u32", &u32Out, sizeof(u32Out), SHADOW_JSON_UINT32);
+	setField(&out[2], "i8", &i8Out, sizeof(i8Out), SHADOW_JSON_INT8);
+	setField(&out[3], "f", &fOut, sizeof(fOut), SHADOW_JSON_FLOAT);
+	setField(&out[4], "d", &dOut, sizeof(dOut), SHADOW_JSON_DOUBLE);
+	setField(&out[5], "b", &bOut, sizeof(bOut), SHADOW_JSON_BOOL);
+	setField(&out[6], "s", sOut, sizeof(sOut), SHADOW_JSON_STRING);
+	setField(&out[7], "o", nestedOut, sizeof(nestedOut), SHADOW_JSON_OBJECT);
+	out[7].cb = recordValueCallback;
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_cbor_encode(encodeBuffer, sizeof(encodeBuffer), &encodedLen, 8, &in[0], &in[1],
+												   &in[2], &in[3], &in[4], &in[5], &in[6], &in[7]));
+	/* Fields are matched by key, not by position */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_cbor_decode(encodeBuffer, encodedLen, 8, &out[7], &out[6], &out[5], &out[4],
+												   &out[3], &out[2], &out[1], &out[0]));
+
+	CHECK_EQUAL_C_INT(i32, i32Out);
+	CHECK_C(u32 == u32Out);
+	CHECK_EQUAL_C_INT(i8, i8Out);
+	CHECK_C(f == fOut);
+	CHECK_C(d == dOut);
+	CHECK_C(b == bOut);
+	CHECK_EQUAL_C_STRING(s, sOut);
+	CHECK_EQUAL_C_INT(1, callbackCount);
+	CHECK_EQUAL_C_INT(sizeof(nested), callbackValueLen);
+	CHECK_C(0 == memcmp(nested, nestedOut, sizeof(nested)));
+
+	IOT_DEBUG("-->Success - K:6 - Decode what was encoded \n");
+}
+
+/* K:7 - String decoded in place through the callback */
+TEST_C(CborTests, ZeroCopyString) {
+	char s[] = "firmware-2.4.1";
+	char small[4] = "abc";
+	jsonStruct_t field;
+
+	IOT_DEBUG("-->Running CBOR Tests - K:7 - String decoded in place through the callback \n");
+
+	setField(&field, "version", s, sizeof(s), SHADOW_JSON_STRING);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_cbor_encode(encodeBuffer, sizeof(encodeBuffer), &encodedLen, 1, &field));
+
+	setField(&field, "version", NULL, 0, SHADOW_JSON_STRING);
+	field.cb = recordValueCallback;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_cbor_decode(encodeBuffer, encodedLen, 1, &field));
+	CHECK_EQUAL_C_INT(1, callbackCount);
+	CHECK_EQUAL_C_INT(strlen(s), callbackValueLen);
+	CHECK_C((const unsigned char *) pCallbackValue > encodeBuffer &&
+			(const unsigned char *) pCallbackValue + callbackValueLen == encodeBuffer + encodedLen);
+	CHECK_C(0 == memcmp(s, pCallbackValue, callbackValueLen));
+
+	/* A copy that does not fit with its terminator is an error */
+	setField(&field, "version", small, sizeof(small), SHADOW_JSON_STRING);
+	CHECK_EQUAL_C_INT(CBOR_ERROR, aws_iot_cbor_decode(encodeBuffer, encodedLen, 1, &field));
+	CHECK_EQUAL_C_STRING("abc", small);
+
+	IOT_DEBUG("-->Success - K:7 - String decoded in place through the callback \n");
+}
+
+/* K:8 - Unknown keys, nested values and non-text keys are skipped */
+TEST_C(CborTests, SkipUnknownEntries) {
+	static const unsigned char input[] = {
+		0xA4,
+		/* "x": {"a": [1, 2], "b": 1(1)} */
+		0x61, 'x', 0xA2, 0x61, 'a', 0x82, 0x01, 0x02, 0x61, 'b', 0xC1, 0x1A, 0x00, 0x00, 0x00, 0x01,
+		/* 1: true */
+		0x01, 0xF5,
+		/* "n": 42 */
+		0x61, 'n', 0x18, 0x2A,
+		/* "nn": h'' */
+		0x62, 'n', 'n', 0x40
+	};
+	int32_t value = 0;
+	jsonStruct_t field;
+
+	IOT_DEBUG("-->Running CBOR Tests - K:8 - Unknown keys and nested values are skipped \n");
+
+	setField(&field, "n", &value, sizeof(value), SHADOW_JSON_INT32);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_cbor_decode(input, sizeof(input), 1, &field));
+	CHECK_EQUAL_C_INT(42, value);
+
+	IOT_DEBUG("-->Success - K:8 - Unknown keys and nested values are skipped \n");
+}
+
+/* K:9 - Value out of range or of the wrong type */
+TEST_C(CborTests, DecodeTypeMismatch) {
+	static const unsigned char int8Overflow[] = {0xA1, 0x61, 'v', 0x18, 0xC8};
+	static const unsigned char negative[] = {0xA1, 0x61, 'v', 0x20};
+	static const unsigned char uint32Overflow[] = {0xA1, 0x61, 'v', 0x1B, 0, 0, 0, 0x01, 0, 0, 0, 0};
+	static const unsigned char text[] = {0xA1, 0x61, 'v', 0x61, 'a'};
+	static const unsigned char one[] = {0xA1, 0x61, 'v', 0x01};
+	static const unsigned char hugeDouble[] = {0xA1, 0x61, 'v', 0xFB, 0x7E, 0x37, 0xE4, 0x3C, 0x88, 0x00, 0x75, 0x9C};
+	static const unsigned char notMap[] = {0x81, 0x01};
+	int8_t i8 = 0;
+	uint8_t u8 = 0;
+	uint32_t u32 = 0;
+	int32_t i32 = 0;
+	bool b = false;
+	float f = 0;
+	jsonStruct_t field;
+
+	IOT_DEBUG("-->Running CBOR Tests - K:9 - Value out of range or of the wrong type \n");
+
+	setField(&field, "v", &i8, sizeof(i8), SHADOW_JSON_INT8);
+	CHECK_EQUAL_C_INT(CBOR_ERROR, aws_iot_cbor_decode(int8Overflow, sizeof(int8Overflow), 1, &field));
+	setField(&field, "v", &u8, sizeof(u8), SHADOW_JSON_UINT8);
+	CHECK_EQUAL_C_INT(CBOR_ERROR, aws_iot_cbor_decode(negative, sizeof(negative), 1, &field));
+	setField(&field, "v", &u32, sizeof(u32), SHADOW_JSON_UINT32);
+	CHECK_EQUAL_C_INT(CBOR_ERROR, aws_iot_cbor_decode(uint32Overflow, sizeof(uint32Overflow), 1, &field));
+	setField(&field, "v", &i32, sizeof(i32), SHADOW_JSON_INT32);
+	CHECK_EQUAL_C_INT(CBOR_ERROR, aws_iot_cbor_decode(text, sizeof(text), 1, &field));
+	setField(&field, "v", &i32, sizeof(int16_t), SHADOW_JSON_INT32);
+	CHECK_EQUAL_C_INT(CBOR_ERROR, aws_iot_cbor_decode(one, sizeof(one), 1, &field));
+	setField(&field, "v", &b, sizeof(b), SHADOW_JSON_BOOL);
+	CHECK_EQUAL_C_INT(CBOR_ERROR, aws_iot_cbor_decode(one, sizeof(one), 1, &field));
+	setField(&field, "v", &f, sizeof(f), SHADOW_JSON_FLOAT);
+	CHECK_EQUAL_C_INT(CBOR_ERROR, aws_iot_cbor_decode(hugeDouble, sizeof(hugeDouble), 1, &field));
+	CHECK_EQUAL_C_INT(CBOR_ERROR, aws_iot_cbor_decode(notMap, sizeof(notMap), 1, &field));
+
+	CHECK_EQUAL_C_INT(0, i8);
+	CHECK_EQUAL_C_INT(0, u8);
+	CHECK_EQUAL_C_INT(0, u32);
+	CHECK_EQUAL_C_INT(0, i32);
+	CHECK_C(!b);
+	CHECK_C(0 == f);
+
+	IOT_DEBUG("-->Success - K:9 - Value out of range or of the wrong type \n");
+}
+
+/* K:10 - Truncated, indefinite length and too deeply nested input */
+TEST_C(CborTests, DecodeMalformed) {
+	static const unsigned char indefiniteMap[] = {0xBF, 0x61, 'v', 0x01, 0xFF};
+	static const unsigned char indefiniteValue[] = {0xA1, 0x61, 'x', 0x9F, 0x01, 0xFF};
+	static const unsigned char reserved[] = {0xA1, 0x61, 'x', 0x1C};
+	unsigned char nested[3 + AWS_IOT_CBOR_MAX_DEPTH + 2];
+	int32_t i32 = 0;
+	char s[] = "abcdef";
+	jsonStruct_t fields[2];
+	size_t len;
+
+	IOT_DEBUG("-->Running CBOR Tests - K:10 - Truncated and malformed input \n");
+
+	setField(&fields[0], "v", &i32, sizeof(i32), SHADOW_JSON_INT32);
+	setField(&fields[1], "s", s, sizeof(s), SHADOW_JSON_STRING);
+	i32 = 100000;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_cbor_encode(encodeBuffer, sizeof(encodeBuffer), &encodedLen, 2, &fields[0],
+												   &fields[1]));
+	for(len = 0; len < encodedLen; len++) {
+		CHECK_EQUAL_C_INT(CBOR_ERROR, aws_iot_cbor_decode(encodeBuffer, len, 2, &fields[0], &fields[1]));
+	}
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_cbor_decode(encodeBuffer, encodedLen, 2, &fields[0], &fields[1]));
+
+	CHECK_EQUAL_C_INT(CBOR_ERROR, aws_iot_cbor_decode(indefiniteMap, sizeof(indefiniteMap), 1, &fields[0]));
+	CHECK_EQUAL_C_INT(CBOR_ERROR, aws_iot_cbor_decode(indefiniteValue, sizeof(indefiniteValue), 1, &fields[0]));
+	CHECK_EQUAL_C_INT(CBOR_ERROR, aws_iot_cbor_decode(reserved, sizeof(reserved), 1, &fields[0]));
+
+	/* {"x": [[...[1]...]]} skipped up to the maximum depth */
+	nested[0] = 0xA1;
+	nested[1] = 0x61;
+	nested[2] = 'x';
+	memset(&nested[3], 0x81, AWS_IOT_CBOR_MAX_DEPTH + 1);
+	nested[sizeof(nested) - 1] = 0x01;
+	CHECK_EQUAL_C_INT(CBOR_ERROR, aws_iot_cbor_decode(nested, sizeof(nested), 1, &fields[0]));
+	nested[1] = 0xA1;
+	nested[2] = 0x61;
+	nested[3] = 'x';
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_cbor_decode(&nested[1], sizeof(nested) - 1, 1, &fields[0]));
+
+	IOT_DEBUG("-->Success - K:10 - Truncated and malformed input \n");
+}
+
+/* K:11 - Half floats and integers decoded into floating point fields */
+TEST_C(CborTests, DecodeFloatForms) {
+	static const unsigned char input[] = {
+		0xA5,
+		0x61, 'a', 0xF9, 0x3E, 0x00,
+		0x61, 'b', 0xF9, 0xC0, 0x00,
+		0x61, 'c', 0xF9, 0x00, 0x01,
+		0x61, 'd', 0x07,
+		0x61, 'e', 0xFA, 0x3F, 0xC0, 0x00, 0x00
+	};
+	float a = 0, c = 0, d = 0;
+	double b = 0, e = 0;
+	jsonStruct_t fields[5];
+
+	IOT_DEBUG("-->Running CBOR Tests - K:11 - Half floats and integers into floating point fields \n");
+
+	setField(&fields[0], "a", &a, sizeof(a), SHADOW_JSON_FLOAT);
+	setField(&fields[1], "b", &b, sizeof(b), SHADOW_JSON_DOUBLE);
+	setField(&fields[2], "c", &c, sizeof(c), SHADOW_JSON_FLOAT);
+	setField(&fields[3], "d", &d, sizeof(d), SHADOW_JSON_FLOAT);
+	setField(&fields[4], "e", &e, sizeof(e), SHADOW_JSON_DOUBLE);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_cbor_decode(input, sizeof(input), 5, &fields[0], &fields[1], &fields[2],
+												   &fields[3], &fields[4]));
+	CHECK_C(1.5f == a);
+	CHECK_C(-2.0 == b);
+	CHECK_C(5.9604644775390625e-08f == c);
+	CHECK_C(7.0f == d);
+	CHECK_C(1.5 == e);
+
+	IOT_DEBUG("-->Success - K:11 - Half floats and integers into floating point fields \n");
+}
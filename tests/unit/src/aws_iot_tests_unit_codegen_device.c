@@ -0,0 +1,294 @@
+/*
+ * Generated by tools/shadow_codegen/aws_iot_shadow_codegen.py from codegen_device.json.
+ * Do not edit, run the generator again after changing the schema.
+ */
+
+/**
+ * @file aws_iot_tests_unit_codegen_device.c
+ * @brief Encoder and decoder of the codegen_device shadow state
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+
+#include "aws_iot_tests_unit_codegen_device.h"
+#include "aws_iot_shadow_codegen.h"
+#include "aws_iot_json_utils.h"
+
+#define CODEGEN_DEVICE_FAN_SEED 0x1F54177Eu
+#define CODEGEN_DEVICE_FAN_SLOT_MASK 1u
+
+static const ShadowCodegenKey_t codegen_device_fan_keys[2] = {
+	{"speed", 5, 0},
+	{"oscillate", 9, 1},
+};
+
+static void codegen_device_fan_write(ShadowCodegenWriter_t *pWriter, const codegen_device_fan_t *pValue, uint32_t fieldMask) {
+	aws_iot_shadow_codegen_write(pWriter, "{", 1);
+	if(fieldMask & CODEGEN_DEVICE_FAN_SPEED) {
+		aws_iot_shadow_codegen_write(pWriter, "\"speed\":", 8);
+		aws_iot_shadow_codegen_write_uint32(pWriter, (uint32_t) pValue->speed);
+		aws_iot_shadow_codegen_write(pWriter, ",", 1);
+	}
+	if(fieldMask & CODEGEN_DEVICE_FAN_OSCILLATE) {
+		aws_iot_shadow_codegen_write(pWriter, "\"oscillate\":", 12);
+		aws_iot_shadow_codegen_write_bool(pWriter, pValue->oscillate);
+		aws_iot_shadow_codegen_write(pWriter, ",", 1);
+	}
+	aws_iot_shadow_codegen_end_object(pWriter);
+}
+
+static void codegen_device_fan_read(const char *pJsonDocument, jsmntok_t *pTokens, int32_t tokenCount,
+		int32_t objectIndex, codegen_device_fan_t *pValue, uint32_t *pFieldMask) {
+	int32_t end = aws_iot_shadow_codegen_skip(pTokens, tokenCount, objectIndex);
+	int32_t i = objectIndex + 1;
+	jsmntok_t *pKey;
+
+	while(i + 1 < end) {
+		pKey = &pTokens[i];
+		switch(aws_iot_shadow_codegen_lookup(codegen_device_fan_keys, CODEGEN_DEVICE_FAN_SEED, CODEGEN_DEVICE_FAN_SLOT_MASK,
+				pJsonDocument + pKey->start, (size_t) (pKey->end - pKey->start))) {
+		case 0: /* speed */
+			if(parseUnsignedInteger8Value(&pValue->speed, pJsonDocument, &pTokens[i + 1]) == SUCCESS) {
+				*pFieldMask |= CODEGEN_DEVICE_FAN_SPEED;
+			}
+			break;
+		case 1: /* oscillate */
+			if(parseBooleanValue(&pValue->oscillate, pJsonDocument, &pTokens[i + 1]) == SUCCESS) {
+				*pFieldMask |= CODEGEN_DEVICE_FAN_OSCILLATE;
+			}
+			break;
+		default:
+			break;
+		}
+		i = aws_iot_shadow_codegen_skip(pTokens, tokenCount, i + 1);
+	}
+}
+
+#define CODEGEN_DEVICE_SEED 0x9B9028F4u
+#define CODEGEN_DEVICE_SLOT_MASK 15u
+
+static const ShadowCodegenKey_t codegen_device_keys[16] = {
+	{"humidity", 8, 1},
+	{"altitude", 8, 5},
+	{NULL, 0, -1},
+	{"temperature", 11, 0},
+	{"windowOpen", 10, 2},
+	{NULL, 0, -1},
+	{NULL, 0, -1},
+	{"brightness", 10, 7},
+	{"fan", 3, 10},
+	{"mode", 4, 3},
+	{NULL, 0, -1},
+	{"uptime", 6, 6},
+	{"port", 4, 8},
+	{"offset", 6, 4},
+	{"counter", 7, 9},
+	{NULL, 0, -1},
+};
+
+static void codegen_device_write(ShadowCodegenWriter_t *pWriter, const codegen_device_t *pValue, uint32_t fieldMask) {
+	aws_iot_shadow_codegen_write(pWriter, "{", 1);
+	if(fieldMask & CODEGEN_DEVICE_TEMPERATURE) {
+		aws_iot_shadow_codegen_write(pWriter, "\"temperature\":", 14);
+		aws_iot_shadow_codegen_write_double(pWriter, (double) pValue->temperature);
+		aws_iot_shadow_codegen_write(pWriter, ",", 1);
+	}
+	if(fieldMask & CODEGEN_DEVICE_HUMIDITY) {
+		aws_iot_shadow_codegen_write(pWriter, "\"humidity\":", 11);
+		aws_iot_shadow_codegen_write_double(pWriter, pValue->humidity);
+		aws_iot_shadow_codegen_write(pWriter, ",", 1);
+	}
+	if(fieldMask & CODEGEN_DEVICE_WINDOWOPEN) {
+		aws_iot_shadow_codegen_write(pWriter, "\"windowOpen\":", 13);
+		aws_iot_shadow_codegen_write_bool(pWriter, pValue->windowOpen);
+		aws_iot_shadow_codegen_write(pWriter, ",", 1);
+	}
+	if(fieldMask & CODEGEN_DEVICE_MODE) {
+		aws_iot_shadow_codegen_write(pWriter, "\"mode\":", 7);
+		aws_iot_shadow_codegen_write_string(pWriter, pValue->mode);
+		aws_iot_shadow_codegen_write(pWriter, ",", 1);
+	}
+	if(fieldMask & CODEGEN_DEVICE_OFFSET) {
+		aws_iot_shadow_codegen_write(pWriter, "\"offset\":", 9);
+		aws_iot_shadow_codegen_write_int32(pWriter, (int32_t) pValue->offset);
+		aws_iot_shadow_codegen_write(pWriter, ",", 1);
+	}
+	if(fieldMask & CODEGEN_DEVICE_ALTITUDE) {
+		aws_iot_shadow_codegen_write(pWriter, "\"altitude\":", 11);
+		aws_iot_shadow_codegen_write_int32(pWriter, (int32_t) pValue->altitude);
+		aws_iot_shadow_codegen_write(pWriter, ",", 1);
+	}
+	if(fieldMask & CODEGEN_DEVICE_UPTIME) {
+		aws_iot_shadow_codegen_write(pWriter, "\"uptime\":", 9);
+		aws_iot_shadow_codegen_write_int32(pWriter, pValue->uptime);
+		aws_iot_shadow_codegen_write(pWriter, ",", 1);
+	}
+	if(fieldMask & CODEGEN_DEVICE_BRIGHTNESS) {
+		aws_iot_shadow_codegen_write(pWriter, "\"brightness\":", 13);
+		aws_iot_shadow_codegen_write_uint32(pWriter, (uint32_t) pValue->brightness);
+		aws_iot_shadow_codegen_write(pWriter, ",", 1);
+	}
+	if(fieldMask & CODEGEN_DEVICE_PORT) {
+		aws_iot_shadow_codegen_write(pWriter, "\"port\":", 7);
+		aws_iot_shadow_codegen_write_uint32(pWriter, (uint32_t) pValue->port);
+		aws_iot_shadow_codegen_write(pWriter, ",", 1);
+	}
+	if(fieldMask & CODEGEN_DEVICE_COUNTER) {
+		aws_iot_shadow_codegen_write(pWriter, "\"counter\":", 10);
+		aws_iot_shadow_codegen_write_uint32(pWriter, pValue->counter);
+		aws_iot_shadow_codegen_write(pWriter, ",", 1);
+	}
+	if(fieldMask & CODEGEN_DEVICE_FAN) {
+		aws_iot_shadow_codegen_write(pWriter, "\"fan\":", 6);
+		codegen_device_fan_write(pWriter, &pValue->fan, fieldMask);
+		aws_iot_shadow_codegen_write(pWriter, ",", 1);
+	}
+	aws_iot_shadow_codegen_end_object(pWriter);
+}
+
+static void codegen_device_read(const char *pJsonDocument, jsmntok_t *pTokens, int32_t tokenCount,
+		int32_t objectIndex, codegen_device_t *pValue, uint32_t *pFieldMask) {
+	int32_t end = aws_iot_shadow_codegen_skip(pTokens, tokenCount, objectIndex);
+	int32_t i = objectIndex + 1;
+	jsmntok_t *pKey;
+
+	while(i + 1 < end) {
+		pKey = &pTokens[i];
+		switch(aws_iot_shadow_codegen_lookup(codegen_device_keys, CODEGEN_DEVICE_SEED, CODEGEN_DEVICE_SLOT_MASK,
+				pJsonDocument + pKey->start, (size_t) (pKey->end - pKey->start))) {
+		case 0: /* temperature */
+			if(parseFloatValue(&pValue->temperature, pJsonDocument, &pTokens[i + 1]) == SUCCESS) {
+				*pFieldMask |= CODEGEN_DEVICE_TEMPERATURE;
+			}
+			break;
+		case 1: /* humidity */
+			if(parseDoubleValue(&pValue->humidity, pJsonDocument, &pTokens[i + 1]) == SUCCESS) {
+				*pFieldMask |= CODEGEN_DEVICE_HUMIDITY;
+			}
+			break;
+		case 2: /* windowOpen */
+			if(parseBooleanValue(&pValue->windowOpen, pJsonDocument, &pTokens[i + 1]) == SUCCESS) {
+				*pFieldMask |= CODEGEN_DEVICE_WINDOWOPEN;
+			}
+			break;
+		case 3: /* mode */
+			if(parseStringValue(pValue->mode, sizeof(pValue->mode), pJsonDocument, &pTokens[i + 1]) == SUCCESS) {
+				*pFieldMask |= CODEGEN_DEVICE_MODE;
+			}
+			break;
+		case 4: /* offset */
+			if(parseInteger8Value(&pValue->offset, pJsonDocument, &pTokens[i + 1]) == SUCCESS) {
+				*pFieldMask |= CODEGEN_DEVICE_OFFSET;
+			}
+			break;
+		case 5: /* altitude */
+			if(parseInteger16Value(&pValue->altitude, pJsonDocument, &pTokens[i + 1]) == SUCCESS) {
+				*pFieldMask |= CODEGEN_DEVICE_ALTITUDE;
+			}
+			break;
+		case 6: /* uptime */
+			if(parseInteger32Value(&pValue->uptime, pJsonDocument, &pTokens[i + 1]) == SUCCESS) {
+				*pFieldMask |= CODEGEN_DEVICE_UPTIME;
+			}
+			break;
+		case 7: /* brightness */
+			if(parseUnsignedInteger8Value(&pValue->brightness, pJsonDocument, &pTokens[i + 1]) == SUCCESS) {
+				*pFieldMask |= CODEGEN_DEVICE_BRIGHTNESS;
+			}
+			break;
+		case 8: /* port */
+			if(parseUnsignedInteger16Value(&pValue->port, pJsonDocument, &pTokens[i + 1]) == SUCCESS) {
+				*pFieldMask |= CODEGEN_DEVICE_PORT;
+			}
+			break;
+		case 9: /* counter */
+			if(parseUnsignedInteger32Value(&pValue->counter, pJsonDocument, &pTokens[i + 1]) == SUCCESS) {
+				*pFieldMask |= CODEGEN_DEVICE_COUNTER;
+			}
+			break;
+		case 10: /* fan */
+			if(pTokens[i + 1].type == JSMN_OBJECT) {
+				codegen_device_fan_read(pJsonDocument, pTokens, tokenCount, i + 1, &pValue->fan, pFieldMask);
+			}
+			break;
+		default:
+			break;
+		}
+		i = aws_iot_shadow_codegen_skip(pTokens, tokenCount, i + 1);
+	}
+}
+
+IoT_Error_t codegen_device_encode(char *pBuffer, size_t bufferLen, const codegen_device_t *pValue, uint32_t fieldMask,
+		size_t *pLen) {
+	ShadowCodegenWriter_t writer;
+
+	if(pBuffer == NULL || pValue == NULL) {
+		return NULL_VALUE_ERROR;
+	}
+
+	aws_iot_shadow_codegen_writer_init(&writer, pBuffer, 0, bufferLen);
+	codegen_device_write(&writer, pValue, fieldMask);
+
+	return aws_iot_shadow_codegen_writer_finish(&writer, pBuffer, pLen);
+}
+
+static IoT_Error_t codegen_device_add_section(char *pJsonDocument, size_t maxSizeOfJsonDocument, const char *pSectionKey,
+		size_t sectionKeyLen, const codegen_device_t *pValue, uint32_t fieldMask) {
+	ShadowCodegenWriter_t writer;
+
+	if(pJsonDocument == NULL || pValue == NULL) {
+		return NULL_VALUE_ERROR;
+	}
+
+	aws_iot_shadow_codegen_writer_init(&writer, pJsonDocument, strlen(pJsonDocument), maxSizeOfJsonDocument);
+	aws_iot_shadow_codegen_write(&writer, pSectionKey, sectionKeyLen);
+	codegen_device_write(&writer, pValue, fieldMask);
+	aws_iot_shadow_codegen_write(&writer, ",", 1);
+
+	return aws_iot_shadow_codegen_writer_finish(&writer, pJsonDocument, NULL);
+}
+
+IoT_Error_t codegen_device_add_reported(char *pJsonDocument, size_t maxSizeOfJsonDocument, const codegen_device_t *pValue,
+		uint32_t fieldMask) {
+	return codegen_device_add_section(pJsonDocument, maxSizeOfJsonDocument, "\"reported\":", 11, pValue, fieldMask);
+}
+
+IoT_Error_t codegen_device_add_desired(char *pJsonDocument, size_t maxSizeOfJsonDocument, const codegen_device_t *pValue,
+		uint32_t fieldMask) {
+	return codegen_device_add_section(pJsonDocument, maxSizeOfJsonDocument, "\"desired\":", 10, pValue, fieldMask);
+}
+
+IoT_Error_t codegen_device_decode(const char *pJsonDocument, size_t jsonLen, const char *pSection, codegen_device_t *pValue,
+		uint32_t *pFieldMask) {
+	jsmntok_t tokens[CODEGEN_DEVICE_MAX_JSON_TOKENS];
+	int32_t tokenCount, stateIndex;
+
+	if(pJsonDocument == NULL || pValue == NULL || pFieldMask == NULL) {
+		return NULL_VALUE_ERROR;
+	}
+
+	*pFieldMask = 0;
+	tokenCount = aws_iot_shadow_codegen_parse(pJsonDocument, jsonLen, tokens, CODEGEN_DEVICE_MAX_JSON_TOKENS);
+	if(tokenCount < 1 || tokens[0].type != JSMN_OBJECT) {
+		return JSON_PARSE_ERROR;
+	}
+
+	stateIndex = aws_iot_shadow_codegen_find_member(pJsonDocument, tokens, tokenCount, 0, "state", 5);
+	if(stateIndex >= 0 && pSection != NULL) {
+		stateIndex = aws_iot_shadow_codegen_find_member(pJsonDocument, tokens, tokenCount, stateIndex, pSection,
+				strlen(pSection));
+	}
+	if(stateIndex >= 0 && tokens[stateIndex].type == JSMN_OBJECT) {
+		codegen_device_read(pJsonDocument, tokens, tokenCount, stateIndex, pValue, pFieldMask);
+	}
+
+	return SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
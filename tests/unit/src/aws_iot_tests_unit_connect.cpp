@@ -84,3 +84,9 @@ TEST_GROUP_C_WRAPPER(ConnectTests, cleanSessionInitSubscribers)
 TEST_GROUP_C_WRAPPER(ConnectTests, PowerCycleWithCleanSessionFalse)
 /* B:29 - Reconnect attempt succeeds, but resubscribes fail */
 TEST_GROUP_C_WRAPPER(ConnectTests, ReconnectAndResubscribe)
+/* B:30 - Init with caller supplied buffers, packets larger than the buffer are rejected */
+TEST_GROUP_C_WRAPPER(ConnectTests, InitWithCallerBuffers)
+/* B:31 - Init with buffers taken from an arena, exhausted arena */
+TEST_GROUP_C_WRAPPER(ConnectTests, InitWithArenaBuffers)
+/* B:32 - Init failing on the read buffer gives the write buffer back to the arena */
+TEST_GROUP_C_WRAPPER(ConnectTests, InitArenaTooSmallForReadBuffer)
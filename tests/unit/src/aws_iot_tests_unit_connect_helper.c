@@ -40,6 +40,13 @@ static AWS_IoT_Client iotClient;
 static IoT_Publish_Message_Params testPubMsgParams;
 static ConnectBufferProofread prfrdParams;
 
+/* Caller supplied buffers must outlive the client, the teardown still sends a DISCONNECT */
+static unsigned char callerWriteBuf[64];
+static unsigned char callerReadBuf[64];
+static unsigned char arenaMemory[512];
+static IoT_Arena_t bufferArena;
+static AWS_IoT_Client secondClient;
+
 static char subTopic1[12] = "sdk/Topic1";
 static char subTopic2[12] = "sdk/Topic2";
 
@@ -774,9 +781,9 @@ TEST_C(ConnectTests, ReconnectAndResubscribe) {
 	// buffer, 2 resubscribes must fail. Client should be in a pending
 	// resubscribe state and the auto reconnect interval should have doubled.
 	CHECK_EQUAL_C_INT(NETWORK_ATTEMPTING_RECONNECT, rc);
-	CHECK_EQUAL_C_INT(1, iotClient.clientData.messageHandlers[0].resubscribed);
-	CHECK_EQUAL_C_INT(0, iotClient.clientData.messageHandlers[1].resubscribed);
-	CHECK_EQUAL_C_INT(0, iotClient.clientData.messageHandlers[2].resubscribed);
+	CHECK_EQUAL_C_INT(1, iotClient.clientData.subscriptions.pHandlers[0].resubscribed);
+	CHECK_EQUAL_C_INT(0, iotClient.clientData.subscriptions.pHandlers[1].resubscribed);
+	CHECK_EQUAL_C_INT(0, iotClient.clientData.subscriptions.pHandlers[2].resubscribed);
 	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_RESUBSCRIBE_IN_PROGRESS, aws_iot_mqtt_get_client_state(&iotClient));
 	CHECK_EQUAL_C_INT(2 * AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL, (int) iotClient.clientData.currentReconnectWaitInterval);
 
@@ -784,9 +791,122 @@ TEST_C(ConnectTests, ReconnectAndResubscribe) {
 	setTLSRxBufferForDoubleSuback("sdk/topic1", 10, QOS0, publish);
 	rc = aws_iot_mqtt_yield(&iotClient, 2 * AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL * 2);
 	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
-	CHECK_EQUAL_C_INT(1, iotClient.clientData.messageHandlers[0].resubscribed);
-	CHECK_EQUAL_C_INT(1, iotClient.clientData.messageHandlers[1].resubscribed);
-	CHECK_EQUAL_C_INT(1, iotClient.clientData.messageHandlers[2].resubscribed);
+	CHECK_EQUAL_C_INT(1, iotClient.clientData.subscriptions.pHandlers[0].resubscribed);
+	CHECK_EQUAL_C_INT(1, iotClient.clientData.subscriptions.pHandlers[1].resubscribed);
+	CHECK_EQUAL_C_INT(1, iotClient.clientData.subscriptions.pHandlers[2].resubscribed);
 
 	IOT_DEBUG("-->Success - B:29 - Reconnect attempt succeeds, but resubscribes fail \n");
 }
+
+/* B:30 - Init with caller supplied buffers, packets larger than the buffer are rejected */
+TEST_C(ConnectTests, InitWithCallerBuffers) {
+	IoT_Error_t rc = SUCCESS;
+	IoT_Client_Init_Params bufferParams;
+	char payload[100];
+
+	IOT_DEBUG("-->Running Connect Tests - B:30 - Init with caller supplied buffers \n");
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	bufferParams = initParams;
+
+	/* A buffer without a length is rejected */
+	bufferParams.pWriteBuf = callerWriteBuf;
+	bufferParams.writeBufLen = 0;
+	rc = aws_iot_mqtt_init(&iotClient, &bufferParams);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	bufferParams.writeBufLen = sizeof(callerWriteBuf);
+	bufferParams.pReadBuf = callerReadBuf;
+	bufferParams.readBufLen = sizeof(callerReadBuf);
+	rc = aws_iot_mqtt_init(&iotClient, &bufferParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(callerWriteBuf == iotClient.clientData.writeBuf);
+	CHECK_C(callerReadBuf == iotClient.clientData.readBuf);
+	CHECK_EQUAL_C_INT(sizeof(callerWriteBuf), iotClient.clientData.writeBufSize);
+	CHECK_EQUAL_C_INT(sizeof(callerReadBuf), iotClient.clientData.readBufSize);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	memset(payload, 'x', sizeof(payload));
+	testPubMsgParams.qos = QOS0;
+	testPubMsgParams.isRetained = false;
+	testPubMsgParams.payload = payload;
+	testPubMsgParams.payloadLen = sizeof(payload);
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic1, (uint16_t) strlen(subTopic1), &testPubMsgParams);
+	CHECK_EQUAL_C_INT(MQTT_TX_BUFFER_TOO_SHORT_ERROR, rc);
+
+	IOT_DEBUG("-->Success - B:30 - Init with caller supplied buffers \n");
+}
+
+/* B:31 - Init with buffers taken from an arena, exhausted arena */
+TEST_C(ConnectTests, InitWithArenaBuffers) {
+	IoT_Error_t rc = SUCCESS;
+	IoT_Client_Init_Params bufferParams;
+
+	IOT_DEBUG("-->Running Connect Tests - B:31 - Init with buffers taken from an arena \n");
+
+	rc = aws_iot_arena_init(&bufferArena, arenaMemory, sizeof(arenaMemory));
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	bufferParams = initParams;
+	bufferParams.pBufferArena = &bufferArena;
+	bufferParams.writeBufLen = 200;
+	bufferParams.readBufLen = 100;
+	rc = aws_iot_mqtt_init(&iotClient, &bufferParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(iotClient.clientData.writeBuf >= arenaMemory);
+	CHECK_C(iotClient.clientData.readBuf + 100 <= arenaMemory + sizeof(arenaMemory));
+	CHECK_EQUAL_C_INT(0, (int) ((uintptr_t) iotClient.clientData.readBuf % AWS_IOT_ARENA_ALIGNMENT));
+	CHECK_EQUAL_C_INT(200, iotClient.clientData.writeBufSize);
+	CHECK_EQUAL_C_INT(100, iotClient.clientData.readBufSize);
+	CHECK_C(aws_iot_arena_remaining(&bufferArena) <= sizeof(arenaMemory) - 300);
+
+	/* Not enough left for a second client of the same size */
+	bufferParams.readBufLen = 200;
+	rc = aws_iot_mqtt_init(&secondClient, &bufferParams);
+	CHECK_EQUAL_C_INT(ARENA_EXHAUSTED_ERROR, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	IOT_DEBUG("-->Success - B:31 - Init with buffers taken from an arena \n");
+}
+
+/* B:32 - Init failing on the read buffer gives the write buffer back to the arena */
+TEST_C(ConnectTests, InitArenaTooSmallForReadBuffer) {
+	IoT_Error_t rc = SUCCESS;
+	IoT_Client_Init_Params bufferParams;
+	int i;
+
+	IOT_DEBUG("-->Running Connect Tests - B:32 - Init failing on the read buffer gives the write buffer back \n");
+
+	rc = aws_iot_arena_init(&bufferArena, arenaMemory, sizeof(arenaMemory));
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	bufferParams = initParams;
+	bufferParams.pBufferArena = &bufferArena;
+	bufferParams.writeBufLen = 300;
+	bufferParams.readBufLen = 300;
+
+	/* The write buffer fits, the read buffer does not. Retrying must not use up the arena */
+	for(i = 0; i < 3; i++) {
+		rc = aws_iot_mqtt_init(&iotClient, &bufferParams);
+		CHECK_EQUAL_C_INT(ARENA_EXHAUSTED_ERROR, rc);
+		CHECK_EQUAL_C_INT(sizeof(arenaMemory), aws_iot_arena_remaining(&bufferArena));
+	}
+
+	bufferParams.readBufLen = 200;
+	rc = aws_iot_mqtt_init(&iotClient, &bufferParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(300, iotClient.clientData.writeBufSize);
+	CHECK_EQUAL_C_INT(200, iotClient.clientData.readBufSize);
+
+	IOT_DEBUG("-->Success - B:32 - Init failing on the read buffer gives the write buffer back \n");
+}
@@ -0,0 +1,46 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_connection_pool.cpp
+ * @brief IoT Client Unit Testing - Connection Pool Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(ConnectionPoolTests) {
+	TEST_GROUP_C_SETUP_WRAPPER(ConnectionPoolTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(ConnectionPoolTests)
+};
+
+/* N:1 - Init and connect with invalid parameters */
+TEST_GROUP_C_WRAPPER(ConnectionPoolTests, InvalidParams)
+/* N:2 - Every connection gets its own client ID */
+TEST_GROUP_C_WRAPPER(ConnectionPoolTests, DistinctClientIds)
+/* N:3 - Client ID too long for the pool */
+TEST_GROUP_C_WRAPPER(ConnectionPoolTests, ClientIdTooLong)
+/* N:4 - Topics are spread over the connections and stay put when the pool grows */
+TEST_GROUP_C_WRAPPER(ConnectionPoolTests, ConsistentRouting)
+/* N:5 - Publish goes to the connection of the topic, a disconnected connection only affects its topics */
+TEST_GROUP_C_WRAPPER(ConnectionPoolTests, PublishOnOwnConnection)
+/* N:6 - Subscription is made on the connection of the filter */
+TEST_GROUP_C_WRAPPER(ConnectionPoolTests, SubscribeOnOwnConnection)
+/* N:7 - Connect again only connects the clients that are down */
+TEST_GROUP_C_WRAPPER(ConnectionPoolTests, ReconnectOnlyDisconnected)
+/* N:8 - Yield and disconnect every client */
+TEST_GROUP_C_WRAPPER(ConnectionPoolTests, YieldAndDisconnect)
+/* N:9 - Init failing on a later client gives the arena blocks of the earlier ones back */
+TEST_GROUP_C_WRAPPER(ConnectionPoolTests, InitArenaTooSmall)
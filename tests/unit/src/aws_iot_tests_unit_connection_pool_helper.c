@@ -0,0 +1,365 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_connection_pool_helper.c
+ * @brief IoT Client Unit Testing - Connection Pool Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_connection_pool.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+#define POOL_TEST_CONNECTIONS 3
+#define POOL_TEST_TOPIC_LEN 32
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static AWS_IoT_Client poolClients[POOL_TEST_CONNECTIONS];
+static IoT_MQTT_Connection_Pool_t pool;
+
+static AWS_IoT_Client *pHandlerClient;
+static uint32_t handlerCount;
+
+static void poolTestHandler(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
+							IoT_Publish_Message_Params *pParams, void *pClientData) {
+	IOT_UNUSED(pTopicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(pParams);
+	IOT_UNUSED(pClientData);
+
+	pHandlerClient = pClient;
+	handlerCount++;
+}
+
+/* One CONNACK for each of count connects */
+static void setTLSRxBufferForConnacks(uint32_t count) {
+	uint32_t i;
+
+	ResetTLSBuffer();
+	for(i = 0; i < count; i++) {
+		RxBuffer.pBuffer[4 * i] = 0x20;
+		RxBuffer.pBuffer[4 * i + 1] = 0x02;
+		RxBuffer.pBuffer[4 * i + 2] = 0x00;
+		RxBuffer.pBuffer[4 * i + 3] = 0x00;
+	}
+	RxBuffer.len = 4 * count;
+	RxBuffer.NoMsgFlag = false;
+	RxIndex = 0;
+}
+
+static void connectPool(void) {
+	setTLSRxBufferForConnacks(POOL_TEST_CONNECTIONS);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_connection_pool_connect(&pool, &connectParams));
+	ResetTLSBuffer();
+}
+
+/* Writes a topic owned by connection index, other than pExclude, to pTopic */
+static void findTopicOfConnection(uint32_t index, char *pTopic, const char *pExclude) {
+	uint32_t i;
+
+	for(i = 0; i < 1000; i++) {
+		snprintf(pTopic, POOL_TEST_TOPIC_LEN, "dt/sensor/%u", i);
+		if(index == aws_iot_mqtt_connection_pool_route(&pool, pTopic, (uint16_t) strlen(pTopic)) &&
+		   (NULL == pExclude || 0 != strcmp(pTopic, pExclude))) {
+			return;
+		}
+	}
+	FAIL_C();
+}
+
+TEST_GROUP_C_SETUP(ConnectionPoolTests) {
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	initParams.mqttCommandTimeout_ms = 200;
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	CHECK_EQUAL_C_INT(SUCCESS,
+					  aws_iot_mqtt_connection_pool_init(&pool, poolClients, POOL_TEST_CONNECTIONS, &initParams));
+	pHandlerClient = NULL;
+	handlerCount = 0;
+}
+
+TEST_GROUP_C_TEARDOWN(ConnectionPoolTests) {
+	(void) aws_iot_mqtt_connection_pool_free(&pool);
+}
+
+/* N:1 - Init and connect with invalid parameters */
+TEST_C(ConnectionPoolTests, InvalidParams) {
+	IoT_MQTT_Connection_Pool_t otherPool;
+	IoT_Client_Init_Params sharedBufferParams;
+	IoT_Client_Connect_Params params;
+	unsigned char sharedBuffer[AWS_IOT_MQTT_TX_BUF_LEN];
+
+	IOT_DEBUG("-->Running Connection Pool Tests - N:1 - Init and connect with invalid parameters \n");
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_connection_pool_init(NULL, poolClients, 1, &initParams));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_connection_pool_init(&otherPool, NULL, 1, &initParams));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_connection_pool_init(&otherPool, poolClients, 1, NULL));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_connection_pool_init(&otherPool, poolClients, 0, &initParams));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_connection_pool_init(&otherPool, poolClients,
+																		  AWS_IOT_MQTT_POOL_MAX_CONNECTIONS + 1,
+																		  &initParams));
+
+	/* A buffer given in the parameters would be shared by every client */
+	sharedBufferParams = initParams;
+	sharedBufferParams.pWriteBuf = sharedBuffer;
+	sharedBufferParams.writeBufLen = sizeof(sharedBuffer);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_connection_pool_init(&otherPool, poolClients, 1,
+																		  &sharedBufferParams));
+	sharedBufferParams = initParams;
+	sharedBufferParams.pReadBuf = sharedBuffer;
+	sharedBufferParams.readBufLen = sizeof(sharedBuffer);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_connection_pool_init(&otherPool, poolClients, 1,
+																		  &sharedBufferParams));
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_connection_pool_connect(NULL, &connectParams));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_connection_pool_connect(&pool, NULL));
+	params = connectParams;
+	params.pClientID = NULL;
+	params.clientIDLen = 0;
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_connection_pool_connect(&pool, &params));
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_connection_pool_publish(NULL, "a", 1, NULL));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_connection_pool_subscribe(NULL, "a", 1, QOS0, poolTestHandler,
+																			   NULL));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_connection_pool_unsubscribe(NULL, "a", 1));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_connection_pool_yield(NULL, 10));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_connection_pool_disconnect(NULL));
+	CHECK_C(NULL == aws_iot_mqtt_connection_pool_get_client(&pool, POOL_TEST_CONNECTIONS));
+	CHECK_C(&poolClients[1] == aws_iot_mqtt_connection_pool_get_client(&pool, 1));
+
+	IOT_DEBUG("-->Success - N:1 - Init and connect with invalid parameters \n");
+}
+
+/* N:2 - Every connection gets its own client ID */
+TEST_C(ConnectionPoolTests, DistinctClientIds) {
+	char expected[AWS_IOT_MQTT_POOL_CLIENT_ID_LEN];
+	uint32_t i;
+
+	IOT_DEBUG("-->Running Connection Pool Tests - N:2 - Every connection gets its own client ID \n");
+
+	connectPool();
+	for(i = 0; i < POOL_TEST_CONNECTIONS; i++) {
+		CHECK_C(aws_iot_mqtt_is_client_connected(&poolClients[i]));
+		snprintf(expected, sizeof(expected), "%s-%u", AWS_IOT_MQTT_CLIENT_ID, i);
+		CHECK_EQUAL_C_INT(strlen(expected), poolClients[i].clientData.options.clientIDLen);
+		CHECK_C(0 == strncmp(expected, poolClients[i].clientData.options.pClientID, strlen(expected)));
+	}
+
+	IOT_DEBUG("-->Success - N:2 - Every connection gets its own client ID \n");
+}
+
+/* N:3 - Client ID too long for the pool */
+TEST_C(ConnectionPoolTests, ClientIdTooLong) {
+	char longId[AWS_IOT_MQTT_POOL_CLIENT_ID_LEN];
+	IoT_Client_Connect_Params params = connectParams;
+
+	IOT_DEBUG("-->Running Connection Pool Tests - N:3 - Client ID too long for the pool \n");
+
+	/* Room for the ID but not for the suffix */
+	memset(longId, 'c', sizeof(longId));
+	params.pClientID = longId;
+	params.clientIDLen = (uint16_t) (sizeof(longId) - 2);
+	setTLSRxBufferForConnacks(POOL_TEST_CONNECTIONS);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, aws_iot_mqtt_connection_pool_connect(&pool, &params));
+	CHECK_C(!aws_iot_mqtt_is_client_connected(&poolClients[0]));
+
+	IOT_DEBUG("-->Success - N:3 - Client ID too long for the pool \n");
+}
+
+/* N:4 - Topics are spread over the connections and stay put when the pool grows */
+TEST_C(ConnectionPoolTests, ConsistentRouting) {
+	IoT_MQTT_Connection_Pool_t smaller, larger;
+	uint32_t perConnection[5] = {0};
+	uint32_t moved = 0;
+	uint32_t i, before, after;
+	char topic[POOL_TEST_TOPIC_LEN];
+
+	IOT_DEBUG("-->Running Connection Pool Tests - N:4 - Consistent routing \n");
+
+	smaller.clientCount = 4;
+	larger.clientCount = 5;
+	for(i = 0; i < 1000; i++) {
+		snprintf(topic, sizeof(topic), "dt/gateway/device-%u/telemetry", i);
+		before = aws_iot_mqtt_connection_pool_route(&smaller, topic, (uint16_t) strlen(topic));
+		after = aws_iot_mqtt_connection_pool_route(&larger, topic, (uint16_t) strlen(topic));
+		CHECK_C(before < 4 && after < 5);
+		CHECK_EQUAL_C_INT(before, aws_iot_mqtt_connection_pool_route(&smaller, topic, (uint16_t) strlen(topic)));
+		perConnection[after]++;
+		if(before != after) {
+			/* Topics only move to the new connection */
+			CHECK_EQUAL_C_INT(4, after);
+			moved++;
+		}
+	}
+
+	/* About 200 per connection and 1 / 5 of the topics moved */
+	for(i = 0; i < 5; i++) {
+		CHECK_C(150 < perConnection[i] && 250 > perConnection[i]);
+	}
+	CHECK_EQUAL_C_INT(perConnection[4], moved);
+
+	larger.clientCount = 1;
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_connection_pool_route(&larger, topic, (uint16_t) strlen(topic)));
+
+	IOT_DEBUG("-->Success - N:4 - Consistent routing \n");
+}
+
+/* N:5 - Publish goes to the connection of the topic, a disconnected connection only affects its topics */
+TEST_C(ConnectionPoolTests, PublishOnOwnConnection) {
+	IoT_Publish_Message_Params params;
+	char topicA[POOL_TEST_TOPIC_LEN], topicB[POOL_TEST_TOPIC_LEN];
+
+	IOT_DEBUG("-->Running Connection Pool Tests - N:5 - Publish on the connection of the topic \n");
+
+	connectPool();
+	findTopicOfConnection(0, topicA, NULL);
+	findTopicOfConnection(2, topicB, NULL);
+
+	params.qos = QOS0;
+	params.isRetained = 0;
+	params.payload = (void *) "1";
+	params.payloadLen = 1;
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_disconnect(&poolClients[0]));
+	CHECK_EQUAL_C_INT(NETWORK_DISCONNECTED_ERROR,
+					  aws_iot_mqtt_connection_pool_publish(&pool, topicA, (uint16_t) strlen(topicA), &params));
+
+	ResetTLSBuffer();
+	CHECK_EQUAL_C_INT(SUCCESS,
+					  aws_iot_mqtt_connection_pool_publish(&pool, topicB, (uint16_t) strlen(topicB), &params));
+	CHECK_EQUAL_C_STRING(topicB, LastPublishMessageTopic);
+
+	IOT_DEBUG("-->Success - N:5 - Publish on the connection of the topic \n");
+}
+
+/* N:6 - Subscription is made on the connection of the filter */
+TEST_C(ConnectionPoolTests, SubscribeOnOwnConnection) {
+	IoT_Publish_Message_Params params;
+	char topic[POOL_TEST_TOPIC_LEN];
+	uint32_t owner, other;
+
+	IOT_DEBUG("-->Running Connection Pool Tests - N:6 - Subscribe on the connection of the filter \n");
+
+	connectPool();
+	findTopicOfConnection(1, topic, NULL);
+	owner = aws_iot_mqtt_connection_pool_route(&pool, topic, (uint16_t) strlen(topic));
+	other = (owner + 1) % POOL_TEST_CONNECTIONS;
+
+	params.qos = QOS0;
+	params.isRetained = 0;
+	params.payload = NULL;
+	params.payloadLen = 0;
+	setTLSRxBufferForSuback(topic, strlen(topic), QOS0, params);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_connection_pool_subscribe(&pool, topic, (uint16_t) strlen(topic), QOS0,
+																	  poolTestHandler, NULL));
+
+	/* Only the owner has the subscription */
+	setTLSRxBufferWithMsgOnSubscribedTopic(topic, strlen(topic), QOS0, params, "m");
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_yield(&poolClients[other], 20));
+	CHECK_EQUAL_C_INT(0, handlerCount);
+
+	setTLSRxBufferWithMsgOnSubscribedTopic(topic, strlen(topic), QOS0, params, "m");
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_yield(&poolClients[owner], 20));
+	CHECK_EQUAL_C_INT(1, handlerCount);
+	CHECK_C(&poolClients[owner] == pHandlerClient);
+
+	ResetTLSBuffer();
+	setTLSRxBufferForUnsuback();
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_connection_pool_unsubscribe(&pool, topic, (uint16_t) strlen(topic)));
+
+	IOT_DEBUG("-->Success - N:6 - Subscribe on the connection of the filter \n");
+}
+
+/* N:7 - Connect again only connects the clients that are down */
+TEST_C(ConnectionPoolTests, ReconnectOnlyDisconnected) {
+	uint32_t i;
+
+	IOT_DEBUG("-->Running Connection Pool Tests - N:7 - Connect again only connects the clients that are down \n");
+
+	/* Only the first connection gets a CONNACK */
+	setTLSRxBufferForConnacks(1);
+	CHECK_C(SUCCESS != aws_iot_mqtt_connection_pool_connect(&pool, &connectParams));
+	CHECK_C(aws_iot_mqtt_is_client_connected(&poolClients[0]));
+	CHECK_C(!aws_iot_mqtt_is_client_connected(&poolClients[1]));
+
+	/* Two CONNACKs are enough for the rest */
+	setTLSRxBufferForConnacks(POOL_TEST_CONNECTIONS - 1);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_connection_pool_connect(&pool, &connectParams));
+	for(i = 0; i < POOL_TEST_CONNECTIONS; i++) {
+		CHECK_C(aws_iot_mqtt_is_client_connected(&poolClients[i]));
+	}
+
+	IOT_DEBUG("-->Success - N:7 - Connect again only connects the clients that are down \n");
+}
+
+/* N:8 - Yield and disconnect every client */
+TEST_C(ConnectionPoolTests, YieldAndDisconnect) {
+	uint32_t i;
+
+	IOT_DEBUG("-->Running Connection Pool Tests - N:8 - Yield and disconnect every client \n");
+
+	connectPool();
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_connection_pool_yield(&pool, 30));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_connection_pool_yield(&pool, 1));
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_disconnect(&poolClients[1]));
+	CHECK_EQUAL_C_INT(NETWORK_MANUALLY_DISCONNECTED, aws_iot_mqtt_connection_pool_yield(&pool, 30));
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_connection_pool_disconnect(&pool));
+	for(i = 0; i < POOL_TEST_CONNECTIONS; i++) {
+		CHECK_C(!aws_iot_mqtt_is_client_connected(&poolClients[i]));
+	}
+
+	IOT_DEBUG("-->Success - N:8 - Yield and disconnect every client \n");
+}
+
+/* N:9 - Init failing on a later client gives the arena blocks of the earlier ones back */
+TEST_C(ConnectionPoolTests, InitArenaTooSmall) {
+	IoT_MQTT_Connection_Pool_t otherPool;
+	AWS_IoT_Client otherClients[POOL_TEST_CONNECTIONS];
+	IoT_Client_Init_Params arenaParams;
+	IoT_Arena_t bufferArena;
+	unsigned char arenaMemory[512];
+	int i;
+
+	IOT_DEBUG("-->Running Connection Pool Tests - N:9 - Init failing on a later client gives the arena blocks back \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_arena_init(&bufferArena, arenaMemory, sizeof(arenaMemory)));
+	arenaParams = initParams;
+	arenaParams.pBufferArena = &bufferArena;
+	arenaParams.writeBufLen = 100;
+	arenaParams.readBufLen = 100;
+
+	/* Two clients fit, the third does not. Retrying must not use up the arena */
+	for(i = 0; i < 3; i++) {
+		CHECK_EQUAL_C_INT(ARENA_EXHAUSTED_ERROR,
+						  aws_iot_mqtt_connection_pool_init(&otherPool, otherClients, POOL_TEST_CONNECTIONS,
+															&arenaParams));
+		CHECK_EQUAL_C_INT(sizeof(arenaMemory), aws_iot_arena_remaining(&bufferArena));
+	}
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_connection_pool_init(&otherPool, otherClients, 2, &arenaParams));
+	CHECK_C(aws_iot_arena_remaining(&bufferArena) < sizeof(arenaMemory) - 400);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_connection_pool_free(&otherPool));
+
+	IOT_DEBUG("-->Success - N:9 - Init failing on a later client gives the arena blocks back \n");
+}
@@ -0,0 +1,40 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_duplicate.cpp
+ * @brief IoT Client Unit Testing - QoS1 Duplicate Suppression Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(DuplicateSuppressionTests) {
+	TEST_GROUP_C_SETUP_WRAPPER(DuplicateSuppressionTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(DuplicateSuppressionTests)
+};
+
+/* D:1 - Set suppression and read counters with invalid parameters */
+TEST_GROUP_C_WRAPPER(DuplicateSuppressionTests, InvalidParams)
+/* D:2 - Redelivered message acknowledged but not delivered again */
+TEST_GROUP_C_WRAPPER(DuplicateSuppressionTests, DuplicateAckedNotDelivered)
+/* D:3 - Redelivered message delivered again while suppression is disabled */
+TEST_GROUP_C_WRAPPER(DuplicateSuppressionTests, DuplicateDeliveredWhenDisabled)
+/* D:4 - New message on a reused packet ID delivered */
+TEST_GROUP_C_WRAPPER(DuplicateSuppressionTests, ReusedPacketIdDelivered)
+/* D:5 - Oldest message leaves the window when it is full */
+TEST_GROUP_C_WRAPPER(DuplicateSuppressionTests, WindowEvictsOldest)
+/* D:6 - Window kept with a present session, cleared with a new one */
+TEST_GROUP_C_WRAPPER(DuplicateSuppressionTests, WindowFollowsSession)
@@ -0,0 +1,265 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_duplicate_helper.c
+ * @brief IoT Client Unit Testing - QoS1 Duplicate Suppression Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+#define DUPLICATE_TEST_TOPIC "dt/press14/alarm"
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static IoT_Publish_Message_Params testPubMsgParams;
+static AWS_IoT_Client iotClient;
+static uint32_t deliveredCount;
+
+static void iot_duplicate_callback_handler(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
+										   IoT_Publish_Message_Params *pParams, void *pData) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(pTopicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(pParams);
+	IOT_UNUSED(pData);
+
+	deliveredCount++;
+}
+
+static void connectClient(unsigned char sessionPresent) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	setTLSRxBufferForConnack(&connectParams, sessionPresent, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+}
+
+static void subscribeClient(void) {
+	IoT_Error_t rc;
+
+	setTLSRxBufferForSuback(DUPLICATE_TEST_TOPIC, strlen(DUPLICATE_TEST_TOPIC), QOS1, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, DUPLICATE_TEST_TOPIC, (uint16_t) strlen(DUPLICATE_TEST_TOPIC), QOS1,
+								iot_duplicate_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+}
+
+/* Lets the client read a QoS1 PUBLISH and checks that it was acknowledged */
+static void receivePublish(uint16_t packetId, bool isDup, const char *pPayload) {
+	size_t topicNameLen = strlen(DUPLICATE_TEST_TOPIC);
+	size_t payloadLen = strlen(pPayload);
+	size_t pos = 1;
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	RxBuffer.NoMsgFlag = false;
+	RxBuffer.pBuffer[0] = (unsigned char) (0x32 | (isDup ? 0x08 : 0x00));
+	encodeRemainingLength(RxBuffer.pBuffer, &pos, 2 + topicNameLen + 2 + payloadLen);
+	RxBuffer.pBuffer[pos++] = (unsigned char) (topicNameLen >> 8);
+	RxBuffer.pBuffer[pos++] = (unsigned char) (topicNameLen & 0xFF);
+	memcpy(&RxBuffer.pBuffer[pos], DUPLICATE_TEST_TOPIC, topicNameLen);
+	pos += topicNameLen;
+	RxBuffer.pBuffer[pos++] = (unsigned char) (packetId >> 8);
+	RxBuffer.pBuffer[pos++] = (unsigned char) (packetId & 0xFF);
+	memcpy(&RxBuffer.pBuffer[pos], pPayload, payloadLen);
+	RxBuffer.len = pos + payloadLen;
+	RxIndex = 0;
+
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, isLastTLSTxMessagePuback());
+	CHECK_EQUAL_C_INT(packetId, (TxBuffer.pBuffer[2] << 8) | TxBuffer.pBuffer[3]);
+}
+
+TEST_GROUP_C_SETUP(DuplicateSuppressionTests) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	initParams.mqttCommandTimeout_ms = 200;
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	deliveredCount = 0;
+}
+
+TEST_GROUP_C_TEARDOWN(DuplicateSuppressionTests) { }
+
+/* D:1 - Set suppression and read counters with invalid parameters */
+TEST_C(DuplicateSuppressionTests, InvalidParams) {
+	IoT_Duplicate_Stats_t stats;
+
+	IOT_DEBUG("-->Running Duplicate Suppression Tests - D:1 - Set suppression and read counters with invalid parameters \n");
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_set_duplicate_suppression(NULL, true));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_get_duplicate_stats(NULL, &stats));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_get_duplicate_stats(&iotClient, NULL));
+
+	/* Off after init */
+	CHECK_EQUAL_C_INT(0, iotClient.clientData.duplicateWindow.isEnabled);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_get_duplicate_stats(&iotClient, &stats));
+	CHECK_EQUAL_C_INT(0, stats.duplicatesReceived);
+	CHECK_EQUAL_C_INT(0, stats.duplicatesSuppressed);
+
+	IOT_DEBUG("-->Success - D:1 - Set suppression and read counters with invalid parameters \n");
+}
+
+/* D:2 - Redelivered message acknowledged but not delivered again */
+TEST_C(DuplicateSuppressionTests, DuplicateAckedNotDelivered) {
+	IoT_Duplicate_Stats_t stats;
+
+	IOT_DEBUG("-->Running Duplicate Suppression Tests - D:2 - Redelivered message acknowledged but not delivered again \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_duplicate_suppression(&iotClient, true));
+	connectClient(0);
+	subscribeClient();
+
+	receivePublish(10, false, "{\"alarm\":\"overpressure\"}");
+	CHECK_EQUAL_C_INT(1, deliveredCount);
+
+	/* The PUBACK got lost, the server sends the message again */
+	receivePublish(10, true, "{\"alarm\":\"overpressure\"}");
+	receivePublish(10, true, "{\"alarm\":\"overpressure\"}");
+	CHECK_EQUAL_C_INT(1, deliveredCount);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_get_duplicate_stats(&iotClient, &stats));
+	CHECK_EQUAL_C_INT(2, stats.duplicatesReceived);
+	CHECK_EQUAL_C_INT(2, stats.duplicatesSuppressed);
+
+	aws_iot_mqtt_reset_duplicate_stats(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_get_duplicate_stats(&iotClient, &stats));
+	CHECK_EQUAL_C_INT(0, stats.duplicatesReceived);
+	CHECK_EQUAL_C_INT(0, stats.duplicatesSuppressed);
+
+	IOT_DEBUG("-->Success - D:2 - Redelivered message acknowledged but not delivered again \n");
+}
+
+/* D:3 - Redelivered message delivered again while suppression is disabled */
+TEST_C(DuplicateSuppressionTests, DuplicateDeliveredWhenDisabled) {
+	IoT_Duplicate_Stats_t stats;
+
+	IOT_DEBUG("-->Running Duplicate Suppression Tests - D:3 - Redelivered message delivered again while suppression is disabled \n");
+
+	connectClient(0);
+	subscribeClient();
+
+	receivePublish(10, false, "{\"alarm\":\"overpressure\"}");
+	receivePublish(10, true, "{\"alarm\":\"overpressure\"}");
+	CHECK_EQUAL_C_INT(2, deliveredCount);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_get_duplicate_stats(&iotClient, &stats));
+	CHECK_EQUAL_C_INT(1, stats.duplicatesReceived);
+	CHECK_EQUAL_C_INT(0, stats.duplicatesSuppressed);
+
+	/* Disabling forgets the window */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_duplicate_suppression(&iotClient, true));
+	receivePublish(11, false, "{\"alarm\":\"cleared\"}");
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_duplicate_suppression(&iotClient, false));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_duplicate_suppression(&iotClient, true));
+	receivePublish(11, true, "{\"alarm\":\"cleared\"}");
+	CHECK_EQUAL_C_INT(4, deliveredCount);
+
+	IOT_DEBUG("-->Success - D:3 - Redelivered message delivered again while suppression is disabled \n");
+}
+
+/* D:4 - New message on a reused packet ID delivered */
+TEST_C(DuplicateSuppressionTests, ReusedPacketIdDelivered) {
+	IoT_Duplicate_Stats_t stats;
+
+	IOT_DEBUG("-->Running Duplicate Suppression Tests - D:4 - New message on a reused packet ID delivered \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_duplicate_suppression(&iotClient, true));
+	connectClient(0);
+	subscribeClient();
+
+	receivePublish(10, false, "{\"alarm\":\"overpressure\"}");
+	/* The first delivery of the new message was lost, only the redelivery arrives */
+	receivePublish(10, true, "{\"alarm\":\"cleared\"}");
+	CHECK_EQUAL_C_INT(2, deliveredCount);
+	/* Without the DUP flag a message is never a duplicate */
+	receivePublish(10, false, "{\"alarm\":\"cleared\"}");
+	CHECK_EQUAL_C_INT(3, deliveredCount);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_get_duplicate_stats(&iotClient, &stats));
+	CHECK_EQUAL_C_INT(1, stats.duplicatesReceived);
+	CHECK_EQUAL_C_INT(0, stats.duplicatesSuppressed);
+
+	IOT_DEBUG("-->Success - D:4 - New message on a reused packet ID delivered \n");
+}
+
+/* D:5 - Oldest message leaves the window when it is full */
+TEST_C(DuplicateSuppressionTests, WindowEvictsOldest) {
+	char payload[32];
+	uint16_t id;
+
+	IOT_DEBUG("-->Running Duplicate Suppression Tests - D:5 - Oldest message leaves the window when it is full \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_duplicate_suppression(&iotClient, true));
+	connectClient(0);
+	subscribeClient();
+
+	for(id = 1; id <= AWS_IOT_MQTT_DUPLICATE_WINDOW_LEN + 1; id++) {
+		snprintf(payload, sizeof(payload), "{\"seq\":%u}", id);
+		receivePublish(id, false, payload);
+	}
+	CHECK_EQUAL_C_INT(AWS_IOT_MQTT_DUPLICATE_WINDOW_LEN + 1, deliveredCount);
+
+	/* The newest is still known, the first one was replaced */
+	snprintf(payload, sizeof(payload), "{\"seq\":%u}", AWS_IOT_MQTT_DUPLICATE_WINDOW_LEN + 1);
+	receivePublish(AWS_IOT_MQTT_DUPLICATE_WINDOW_LEN + 1, true, payload);
+	CHECK_EQUAL_C_INT(AWS_IOT_MQTT_DUPLICATE_WINDOW_LEN + 1, deliveredCount);
+	receivePublish(1, true, "{\"seq\":1}");
+	CHECK_EQUAL_C_INT(AWS_IOT_MQTT_DUPLICATE_WINDOW_LEN + 2, deliveredCount);
+
+	IOT_DEBUG("-->Success - D:5 - Oldest message leaves the window when it is full \n");
+}
+
+/* D:6 - Window kept with a present session, cleared with a new one */
+TEST_C(DuplicateSuppressionTests, WindowFollowsSession) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Duplicate Suppression Tests - D:6 - Window kept with a present session, cleared with a new one \n");
+
+	connectParams.isCleanSession = false;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_duplicate_suppression(&iotClient, true));
+	connectClient(0);
+	subscribeClient();
+	receivePublish(10, false, "{\"alarm\":\"overpressure\"}");
+
+	/* Reconnect to the same session, the server redelivers the unacknowledged message */
+	rc = aws_iot_mqtt_disconnect(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	connectClient(1);
+	receivePublish(10, true, "{\"alarm\":\"overpressure\"}");
+	CHECK_EQUAL_C_INT(1, deliveredCount);
+
+	/* The session is gone, so the message must be new */
+	rc = aws_iot_mqtt_disconnect(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	connectClient(0);
+	receivePublish(10, true, "{\"alarm\":\"overpressure\"}");
+	CHECK_EQUAL_C_INT(2, deliveredCount);
+
+	IOT_DEBUG("-->Success - D:6 - Window kept with a present session, cleared with a new one \n");
+}
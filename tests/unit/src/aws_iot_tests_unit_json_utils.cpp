@@ -89,3 +89,9 @@ TEST_GROUP_C_WRAPPER(JsonUtils, ParseUnsignedInteger8bitLargeInteger)
 TEST_GROUP_C_WRAPPER(JsonUtils, ParseUnsignedInteger8bitErrorOnNegativeInteger)
 TEST_GROUP_C_WRAPPER(JsonUtils, ParseUnsignedInteger8bitErrorOnBoolean)
 TEST_GROUP_C_WRAPPER(JsonUtils, ParseUnsignedInteger8bitErrorOnString)
+
+TEST_GROUP_C_WRAPPER(JsonUtils, ParsePrunedSkipsMember)
+TEST_GROUP_C_WRAPPER(JsonUtils, ParsePrunedSkipsLastMember)
+TEST_GROUP_C_WRAPPER(JsonUtils, ParsePrunedKeepsDeeperKeys)
+TEST_GROUP_C_WRAPPER(JsonUtils, ParsePrunedIgnoresStringValues)
+TEST_GROUP_C_WRAPPER(JsonUtils, ParsePrunedErrorOnIncompleteMember)
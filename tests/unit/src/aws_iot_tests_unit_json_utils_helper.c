@@ -832,3 +832,69 @@ TEST_C(JsonUtils, ParseUnsignedInteger8bitErrorOnString) {
 	CHECK_EQUAL_C_INT(3, r);
 	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, rc);
 }
+
+static const char *const prunedKeys[] = {"metadata", "skip"};
+
+/* Pruning a document must give the tokens of the same document written without those members */
+static void checkPrunedTokens(const char *pPruned, const char *pExpected, int expectedCount, uint32_t maxDepth) {
+	jsmntok_t expected[32];
+	int32_t r;
+	int i;
+
+	r = parseJsonPruned(&test_parser, pPruned, strlen(pPruned), t, sizeof(t) / sizeof(t[0]), prunedKeys, 2, maxDepth);
+	CHECK_EQUAL_C_INT(expectedCount, r);
+
+	jsmn_init(&test_parser);
+	CHECK_EQUAL_C_INT(expectedCount, jsmn_parse(&test_parser, pExpected, strlen(pExpected), expected, 32));
+
+	for(i = 0; i < expectedCount; i++) {
+		CHECK_EQUAL_C_INT(expected[i].type, t[i].type);
+		CHECK_EQUAL_C_INT(expected[i].size, t[i].size);
+		/* Objects and arrays still span the pruned bytes */
+		if(JSMN_OBJECT != t[i].type && JSMN_ARRAY != t[i].type) {
+			CHECK_EQUAL_C_INT(expected[i].end - expected[i].start, t[i].end - t[i].start);
+			CHECK_C(0 == strncmp(pExpected + expected[i].start, pPruned + t[i].start,
+								 (size_t) (t[i].end - t[i].start)));
+		}
+	}
+}
+
+TEST_C(JsonUtils, ParsePrunedSkipsMember) {
+	IOT_DEBUG("\n-->Running Json Utils Tests - Parse pruned skips a member \n");
+
+	checkPrunedTokens("{\"state\":{\"on\":true},\"metadata\":{\"on\":{\"timestamp\":1}}, \"version\":3}",
+					  "{\"state\":{\"on\":true},\"version\":3}", 7, 1);
+	checkPrunedTokens("{ \"metadata\" : [1,{\"a\":\"}\"}], \"skip\":12,\"version\":3}", "{\"version\":3}", 3, 1);
+}
+
+TEST_C(JsonUtils, ParsePrunedSkipsLastMember) {
+	IOT_DEBUG("\n-->Running Json Utils Tests - Parse pruned skips the last member \n");
+
+	checkPrunedTokens("{\"version\":3,\"metadata\":{\"on\":{\"timestamp\":1}}}", "{\"version\":3}", 3, 1);
+	checkPrunedTokens("{\"version\":3,\"skip\":\"x\\\"}\"}", "{\"version\":3}", 3, 1);
+}
+
+TEST_C(JsonUtils, ParsePrunedKeepsDeeperKeys) {
+	IOT_DEBUG("\n-->Running Json Utils Tests - Parse pruned keeps keys deeper than the prune depth \n");
+
+	checkPrunedTokens("{\"current\":{\"metadata\":{},\"state\":{\"metadata\":1}},\"metadata\":{}}",
+					  "{\"current\":{\"state\":{\"metadata\":1}}}", 7, 2);
+	checkPrunedTokens("{\"state\":{\"metadata\":1}}", "{\"state\":{\"metadata\":1}}", 5, 1);
+}
+
+TEST_C(JsonUtils, ParsePrunedIgnoresStringValues) {
+	IOT_DEBUG("\n-->Running Json Utils Tests - Parse pruned ignores values equal to a key \n");
+
+	checkPrunedTokens("{\"a\":\"metadata\",\"b\":[\"skip\",\"metadata\"]}",
+					  "{\"a\":\"metadata\",\"b\":[\"skip\",\"metadata\"]}", 7, 2);
+}
+
+TEST_C(JsonUtils, ParsePrunedErrorOnIncompleteMember) {
+	int32_t r;
+	const char *json = "{\"version\":3,\"metadata\":{\"on\":{\"timestamp\":1}";
+
+	IOT_DEBUG("\n-->Running Json Utils Tests - Parse pruned returns error on an incomplete member \n");
+
+	r = parseJsonPruned(&test_parser, json, strlen(json), t, sizeof(t) / sizeof(t[0]), prunedKeys, 2, 1);
+	CHECK_EQUAL_C_INT(JSMN_ERROR_PART, r);
+}
@@ -0,0 +1,50 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_mqtt5.cpp
+ * @brief IoT Client Unit Testing - MQTT 5.0 Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(Mqtt5Tests){
+	TEST_GROUP_C_SETUP_WRAPPER(Mqtt5Tests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(Mqtt5Tests)
+};
+
+/* V:1 - MQTT 5.0 CONNECT properties and CONNACK properties */
+TEST_GROUP_C_WRAPPER(Mqtt5Tests, ConnectWithProperties)
+/* V:2 - CONNACK reason codes, MQTT 3.1.1 CONNACK from a server without MQTT 5.0 */
+TEST_GROUP_C_WRAPPER(Mqtt5Tests, ConnackReasonCodes)
+/* V:3 - Topic aliases, least recently used alias is reassigned */
+TEST_GROUP_C_WRAPPER(Mqtt5Tests, PublishTopicAliasLru)
+/* V:4 - No topic aliases when the server allows none, aliases reset on reconnect */
+TEST_GROUP_C_WRAPPER(Mqtt5Tests, PublishWithoutTopicAlias)
+/* V:5 - PUBACK reason codes */
+TEST_GROUP_C_WRAPPER(Mqtt5Tests, PubackReasonCodes)
+/* V:6 - Subscribe, receive a publish with properties and unsubscribe */
+TEST_GROUP_C_WRAPPER(Mqtt5Tests, SubscribeReceiveUnsubscribe)
+/* V:7 - Publish larger than the maximum packet size of the server */
+TEST_GROUP_C_WRAPPER(Mqtt5Tests, PublishLargerThanServerMaximum)
+/* V:8 - Reading properties, unknown and truncated properties */
+TEST_GROUP_C_WRAPPER(Mqtt5Tests, ReadProperties)
+/* V:9 - MQTT 3.1.1 client rejects an MQTT 5.0 CONNACK */
+TEST_GROUP_C_WRAPPER(Mqtt5Tests, Mqtt311RejectsConnackWithProperties)
+/* V:10 - Resubscribe drops filters the server refuses and restores the others */
+TEST_GROUP_C_WRAPPER(Mqtt5Tests, ResubscribeReasonCodes)
+/* V:11 - A DISCONNECT from the server closes the connection and keeps its reason code */
+TEST_GROUP_C_WRAPPER(Mqtt5Tests, ServerDisconnect)
@@ -0,0 +1,472 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_mqtt5_helper.c
+ * @brief IoT Client Unit Testing - MQTT 5.0 Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_client_common_internal.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+#define TELEMETRY_TOPIC_A "dt/fleet/eu-west-1/WVWZZZ1JZXW000001/signals"
+#define TELEMETRY_TOPIC_B "dt/fleet/eu-west-1/WVWZZZ1JZXW000002/signals"
+#define TELEMETRY_TOPIC_C "dt/fleet/eu-west-1/WVWZZZ1JZXW000003/signals"
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static IoT_Publish_Message_Params testPubMsgParams;
+static AWS_IoT_Client iotClient;
+static char mqtt5CallbackMessage[100];
+static uint8_t mqtt5DisconnectReason;
+
+/* CONNACK with Receive Maximum 10, Topic Alias Maximum 2 and Server Keep Alive 30 */
+static const unsigned char connackWithProperties[] = {0x20, 0x0C, 0x00, 0x00, 0x09,
+													  0x21, 0x00, 0x0A, 0x22, 0x00, 0x02, 0x13, 0x00, 0x1E};
+
+static void setRxBuffer(const unsigned char *pData, size_t len) {
+	ResetTLSBuffer();
+	RxBuffer.NoMsgFlag = false;
+	memcpy(RxBuffer.pBuffer, pData, len);
+	RxBuffer.len = len;
+	RxIndex = 0;
+}
+
+/* Index of the first byte after the fixed header of the last packet written */
+static size_t txVariableHeaderStart(void) {
+	size_t pos = 1;
+
+	while(0 != (TxBuffer.pBuffer[pos] & 0x80)) {
+		pos++;
+	}
+
+	return pos + 1;
+}
+
+/* Checks the topic, property length and topic alias of the last PUBLISH written at QoS0 */
+static void checkLastPublish(const char *pTopicName, unsigned char propertiesLen, uint16_t topicAlias) {
+	size_t pos = txVariableHeaderStart();
+	size_t topicNameLen = (NULL == pTopicName) ? 0 : strlen(pTopicName);
+
+	CHECK_EQUAL_C_INT(0x30, TxBuffer.pBuffer[0] & 0xF0);
+	CHECK_EQUAL_C_INT(topicNameLen, (TxBuffer.pBuffer[pos] << 8) | TxBuffer.pBuffer[pos + 1]);
+	if(0 != topicNameLen) {
+		CHECK_C(0 == memcmp(&TxBuffer.pBuffer[pos + 2], pTopicName, topicNameLen));
+	}
+	pos += 2 + topicNameLen;
+	CHECK_EQUAL_C_INT(propertiesLen, TxBuffer.pBuffer[pos]);
+	if(0 != topicAlias) {
+		CHECK_EQUAL_C_INT(MQTT5_PROPERTY_TOPIC_ALIAS, TxBuffer.pBuffer[pos + 1]);
+		CHECK_EQUAL_C_INT(topicAlias, (TxBuffer.pBuffer[pos + 2] << 8) | TxBuffer.pBuffer[pos + 3]);
+	}
+}
+
+static void publishQoS0(const char *pTopicName) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	testPubMsgParams.qos = QOS0;
+	rc = aws_iot_mqtt_publish(&iotClient, pTopicName, (uint16_t) strlen(pTopicName), &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+}
+
+static void iot_mqtt5_callback_handler(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
+									   IoT_Publish_Message_Params *pParams, void *pData) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(pTopicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(pData);
+
+	snprintf(mqtt5CallbackMessage, sizeof(mqtt5CallbackMessage), "%.*s", (int) pParams->payloadLen,
+			 (char *) pParams->payload);
+}
+
+static void iot_mqtt5_disconnect_handler(AWS_IoT_Client *pClient, void *pData) {
+	IOT_UNUSED(pData);
+
+	mqtt5DisconnectReason = aws_iot_mqtt_get_server_disconnect_reason(pClient);
+}
+
+TEST_GROUP_C_SETUP(Mqtt5Tests) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	connectParams.MQTTVersion = MQTT_5_0;
+
+	testPubMsgParams.qos = QOS0;
+	testPubMsgParams.isRetained = 0;
+	testPubMsgParams.payload = (void *) "21.5";
+	testPubMsgParams.payloadLen = 4;
+}
+
+TEST_GROUP_C_TEARDOWN(Mqtt5Tests) { }
+
+/* V:1 - MQTT 5.0 CONNECT properties and CONNACK properties */
+TEST_C(Mqtt5Tests, ConnectWithProperties) {
+	IoT_Error_t rc;
+	size_t pos;
+
+	IOT_DEBUG("-->Running MQTT 5.0 Tests - V:1 - MQTT 5.0 CONNECT properties and CONNACK properties \n");
+
+	ConnectMQTTParamsSetup_Detailed(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID),
+									QOS1, false, true, "will/topic", 10, "gone", 4, NULL, 0, NULL, 0);
+	connectParams.MQTTVersion = MQTT_5_0;
+	setRxBuffer(connackWithProperties, sizeof(connackWithProperties));
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	/* Protocol name and level, flags, keep alive, properties */
+	pos = txVariableHeaderStart();
+	CHECK_C(0 == memcmp(&TxBuffer.pBuffer[pos], "\x00\x04MQTT\x05", 7));
+	pos += 7 + 1 + 2;
+	CHECK_EQUAL_C_INT(10, TxBuffer.pBuffer[pos]);
+	CHECK_EQUAL_C_INT(MQTT5_PROPERTY_MAXIMUM_PACKET_SIZE, TxBuffer.pBuffer[pos + 1]);
+	CHECK_EQUAL_C_INT(iotClient.clientData.readBufSize,
+					  ((size_t) TxBuffer.pBuffer[pos + 2] << 24) | ((size_t) TxBuffer.pBuffer[pos + 3] << 16) |
+					  ((size_t) TxBuffer.pBuffer[pos + 4] << 8) | TxBuffer.pBuffer[pos + 5]);
+	CHECK_EQUAL_C_INT(MQTT5_PROPERTY_SESSION_EXPIRY_INTERVAL, TxBuffer.pBuffer[pos + 6]);
+	CHECK_C(0 == memcmp(&TxBuffer.pBuffer[pos + 7], "\xFF\xFF\xFF\xFF", 4));
+
+	/* Client id, then the empty will properties before the will topic */
+	pos += 11 + 2 + strlen(AWS_IOT_MQTT_CLIENT_ID);
+	CHECK_EQUAL_C_INT(0, TxBuffer.pBuffer[pos]);
+	CHECK_C(0 == memcmp(&TxBuffer.pBuffer[pos + 1], "\x00\x0Awill/topic", 12));
+
+	CHECK_EQUAL_C_INT(10, iotClient.clientData.serverReceiveMaximum);
+	CHECK_EQUAL_C_INT(2, iotClient.clientData.topicAliases.aliasCount);
+	CHECK_EQUAL_C_INT(30, iotClient.clientData.keepAliveInterval);
+
+	IOT_DEBUG("-->Success - V:1 - MQTT 5.0 CONNECT properties and CONNACK properties \n");
+}
+
+/* V:2 - CONNACK reason codes, MQTT 3.1.1 CONNACK from a server without MQTT 5.0 */
+TEST_C(Mqtt5Tests, ConnackReasonCodes) {
+	IoT_Error_t rc;
+	const unsigned char notAuthorized[] = {0x20, 0x03, 0x00, 0x87, 0x00};
+	const unsigned char unacceptableVersion[] = {0x20, 0x02, 0x00, 0x01};
+	const unsigned char truncatedProperties[] = {0x20, 0x05, 0x00, 0x00, 0x03, 0x21, 0x00};
+
+	IOT_DEBUG("-->Running MQTT 5.0 Tests - V:2 - CONNACK reason codes \n");
+
+	setRxBuffer(notAuthorized, sizeof(notAuthorized));
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(MQTT_CONNACK_NOT_AUTHORIZED_ERROR, rc);
+
+	setRxBuffer(unacceptableVersion, sizeof(unacceptableVersion));
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(MQTT_CONNACK_UNACCEPTABLE_PROTOCOL_VERSION_ERROR, rc);
+
+	setRxBuffer(truncatedProperties, sizeof(truncatedProperties));
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(FAILURE, rc);
+
+	IOT_DEBUG("-->Success - V:2 - CONNACK reason codes \n");
+}
+
+/* V:3 - Topic aliases, least recently used alias is reassigned */
+TEST_C(Mqtt5Tests, PublishTopicAliasLru) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running MQTT 5.0 Tests - V:3 - Topic aliases, least recently used alias is reassigned \n");
+
+	setRxBuffer(connackWithProperties, sizeof(connackWithProperties));
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	publishQoS0(TELEMETRY_TOPIC_A);
+	checkLastPublish(TELEMETRY_TOPIC_A, 3, 1);
+	publishQoS0(TELEMETRY_TOPIC_A);
+	checkLastPublish(NULL, 3, 1);
+	CHECK_EQUAL_C_STRING("21.5", (char *) &TxBuffer.pBuffer[TxBuffer.len - 4]);
+
+	publishQoS0(TELEMETRY_TOPIC_B);
+	checkLastPublish(TELEMETRY_TOPIC_B, 3, 2);
+	publishQoS0(TELEMETRY_TOPIC_A);
+	checkLastPublish(NULL, 3, 1);
+
+	/* B is the least recently used */
+	publishQoS0(TELEMETRY_TOPIC_C);
+	checkLastPublish(TELEMETRY_TOPIC_C, 3, 2);
+	publishQoS0(TELEMETRY_TOPIC_B);
+	checkLastPublish(TELEMETRY_TOPIC_B, 3, 1);
+	publishQoS0(TELEMETRY_TOPIC_C);
+	checkLastPublish(NULL, 3, 2);
+
+	IOT_DEBUG("-->Success - V:3 - Topic aliases, least recently used alias is reassigned \n");
+}
+
+/* V:4 - No topic aliases when the server allows none, aliases reset on reconnect */
+TEST_C(Mqtt5Tests, PublishWithoutTopicAlias) {
+	IoT_Error_t rc;
+	const unsigned char connackNoAliases[] = {0x20, 0x03, 0x00, 0x00, 0x00};
+
+	IOT_DEBUG("-->Running MQTT 5.0 Tests - V:4 - No topic aliases when the server allows none \n");
+
+	setRxBuffer(connackWithProperties, sizeof(connackWithProperties));
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	publishQoS0(TELEMETRY_TOPIC_A);
+	checkLastPublish(TELEMETRY_TOPIC_A, 3, 1);
+
+	aws_iot_mqtt_force_client_state(&iotClient, CLIENT_STATE_DISCONNECTED_ERROR);
+	setRxBuffer(connackNoAliases, sizeof(connackNoAliases));
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(MQTT5_DEFAULT_RECEIVE_MAXIMUM, iotClient.clientData.serverReceiveMaximum);
+	CHECK_EQUAL_C_INT(10, iotClient.clientData.keepAliveInterval);
+
+	publishQoS0(TELEMETRY_TOPIC_A);
+	checkLastPublish(TELEMETRY_TOPIC_A, 0, 0);
+	publishQoS0(TELEMETRY_TOPIC_A);
+	checkLastPublish(TELEMETRY_TOPIC_A, 0, 0);
+
+	IOT_DEBUG("-->Success - V:4 - No topic aliases when the server allows none \n");
+}
+
+/* V:5 - PUBACK reason codes */
+TEST_C(Mqtt5Tests, PubackReasonCodes) {
+	IoT_Error_t rc;
+	const unsigned char pubackShort[] = {0x40, 0x02, 0x00, 0x01};
+	const unsigned char pubackNoSubscribers[] = {0x40, 0x0A, 0x00, 0x01, 0x10, 0x06, 0x1F, 0x00, 0x03, 'n', 'o', 'p'};
+	const unsigned char pubackQuotaExceeded[] = {0x40, 0x03, 0x00, 0x01, 0x97};
+
+	IOT_DEBUG("-->Running MQTT 5.0 Tests - V:5 - PUBACK reason codes \n");
+
+	setRxBuffer(connackWithProperties, sizeof(connackWithProperties));
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	testPubMsgParams.qos = QOS1;
+	setRxBuffer(pubackShort, sizeof(pubackShort));
+	rc = aws_iot_mqtt_publish(&iotClient, TELEMETRY_TOPIC_A, strlen(TELEMETRY_TOPIC_A), &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	setRxBuffer(pubackNoSubscribers, sizeof(pubackNoSubscribers));
+	rc = aws_iot_mqtt_publish(&iotClient, TELEMETRY_TOPIC_A, strlen(TELEMETRY_TOPIC_A), &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	setRxBuffer(pubackQuotaExceeded, sizeof(pubackQuotaExceeded));
+	rc = aws_iot_mqtt_publish(&iotClient, TELEMETRY_TOPIC_A, strlen(TELEMETRY_TOPIC_A), &testPubMsgParams);
+	CHECK_EQUAL_C_INT(MQTT_REQUEST_REJECTED_ERROR, rc);
+
+	IOT_DEBUG("-->Success - V:5 - PUBACK reason codes \n");
+}
+
+/* V:6 - Subscribe, receive a publish with properties and unsubscribe */
+TEST_C(Mqtt5Tests, SubscribeReceiveUnsubscribe) {
+	IoT_Error_t rc;
+	size_t pos;
+	const unsigned char suback[] = {0x90, 0x04, 0x00, 0x02, 0x00, 0x01};
+	const unsigned char subackNotAuthorized[] = {0x90, 0x04, 0x00, 0x03, 0x00, 0x87};
+	const unsigned char unsuback[] = {0xB0, 0x04, 0x00, 0x04, 0x00, 0x00};
+	/* QoS0 PUBLISH on "cmd/1" with Payload Format Indicator and a User Property */
+	const unsigned char publish[] = {0x30, 0x16, 0x00, 0x05, 'c', 'm', 'd', '/', '1',
+									 0x0A, 0x01, 0x01, 0x26, 0x00, 0x01, 'k', 0x00, 0x02, 'v', 'v',
+									 'o', 'p', 'e', 'n'};
+
+	IOT_DEBUG("-->Running MQTT 5.0 Tests - V:6 - Subscribe, receive a publish with properties and unsubscribe \n");
+
+	setRxBuffer(connackWithProperties, sizeof(connackWithProperties));
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	setRxBuffer(suback, sizeof(suback));
+	rc = aws_iot_mqtt_subscribe(&iotClient, "cmd/1", 5, QOS1, iot_mqtt5_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	/* Packet identifier, empty properties, topic filter */
+	pos = txVariableHeaderStart();
+	CHECK_EQUAL_C_INT(0, TxBuffer.pBuffer[pos + 2]);
+	CHECK_C(0 == memcmp(&TxBuffer.pBuffer[pos + 3], "\x00\x05" "cmd/1\x01", 8));
+
+	setRxBuffer(subackNotAuthorized, sizeof(subackNotAuthorized));
+	rc = aws_iot_mqtt_subscribe(&iotClient, "cmd/2", 5, QOS1, iot_mqtt5_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(MQTT_REQUEST_REJECTED_ERROR, rc);
+	CHECK_C(NULL == aws_iot_mqtt_internal_subscription_store_find(&(iotClient.clientData.subscriptions), "cmd/2", 5));
+
+	snprintf(mqtt5CallbackMessage, sizeof(mqtt5CallbackMessage), "NOT_VISITED");
+	setRxBuffer(publish, sizeof(publish));
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("open", mqtt5CallbackMessage);
+
+	setRxBuffer(unsuback, sizeof(unsuback));
+	rc = aws_iot_mqtt_unsubscribe(&iotClient, "cmd/1", 5);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	pos = txVariableHeaderStart();
+	CHECK_EQUAL_C_INT(0, TxBuffer.pBuffer[pos + 2]);
+
+	IOT_DEBUG("-->Success - V:6 - Subscribe, receive a publish with properties and unsubscribe \n");
+}
+
+/* V:7 - Publish larger than the maximum packet size of the server */
+TEST_C(Mqtt5Tests, PublishLargerThanServerMaximum) {
+	IoT_Error_t rc;
+	const unsigned char connackSmallPackets[] = {0x20, 0x0B, 0x00, 0x00, 0x08,
+												 0x22, 0x00, 0x02, 0x27, 0x00, 0x00, 0x00, 0x40};
+	char payload[64];
+
+	IOT_DEBUG("-->Running MQTT 5.0 Tests - V:7 - Publish larger than the maximum packet size of the server \n");
+
+	setRxBuffer(connackSmallPackets, sizeof(connackSmallPackets));
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(64, iotClient.clientData.serverMaximumPacketSize);
+
+	memset(payload, 'x', sizeof(payload));
+	testPubMsgParams.payload = payload;
+	testPubMsgParams.payloadLen = sizeof(payload);
+	rc = aws_iot_mqtt_publish(&iotClient, TELEMETRY_TOPIC_A, strlen(TELEMETRY_TOPIC_A), &testPubMsgParams);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, rc);
+
+	/* The alias was never sent, so the topic has to be sent in full */
+	testPubMsgParams.payload = (void *) "21.5";
+	testPubMsgParams.payloadLen = 4;
+	publishQoS0(TELEMETRY_TOPIC_A);
+	checkLastPublish(TELEMETRY_TOPIC_A, 3, 1);
+
+	IOT_DEBUG("-->Success - V:7 - Publish larger than the maximum packet size of the server \n");
+}
+
+/* V:8 - Reading properties, unknown and truncated properties */
+TEST_C(Mqtt5Tests, ReadProperties) {
+	MQTT5_Properties properties;
+	unsigned char *ptr;
+	unsigned char valid[] = {0x10, 0x27, 0x00, 0x01, 0x00, 0x00, 0x1F, 0x00, 0x02, 'o', 'k', 0x0B, 0x81, 0x01,
+							 0x23, 0x00, 0x07};
+	unsigned char unknown[] = {0x02, 0x7E, 0x00};
+	unsigned char truncatedString[] = {0x04, 0x1F, 0x00, 0x05, 'a'};
+	unsigned char lengthPastEnd[] = {0x05, 0x01, 0x00};
+
+	IOT_DEBUG("-->Running MQTT 5.0 Tests - V:8 - Reading properties \n");
+
+	ptr = valid;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_internal_read_properties(&ptr, valid + sizeof(valid), &properties));
+	CHECK_C(valid + sizeof(valid) == ptr);
+	CHECK_EQUAL_C_INT(65536, properties.maximumPacketSize);
+	CHECK_EQUAL_C_INT(7, properties.topicAlias);
+	CHECK_EQUAL_C_INT(MQTT5_DEFAULT_RECEIVE_MAXIMUM, properties.receiveMaximum);
+	CHECK_EQUAL_C_INT(0, properties.topicAliasMaximum);
+
+	ptr = unknown;
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_mqtt_internal_read_properties(&ptr, unknown + sizeof(unknown), NULL));
+	ptr = truncatedString;
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_mqtt_internal_read_properties(&ptr, truncatedString + sizeof(truncatedString),
+																	   NULL));
+	ptr = lengthPastEnd;
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_mqtt_internal_read_properties(&ptr, lengthPastEnd + sizeof(lengthPastEnd),
+																	   NULL));
+
+	IOT_DEBUG("-->Success - V:8 - Reading properties \n");
+}
+
+/* V:9 - MQTT 3.1.1 client rejects an MQTT 5.0 CONNACK */
+TEST_C(Mqtt5Tests, Mqtt311RejectsConnackWithProperties) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running MQTT 5.0 Tests - V:9 - MQTT 3.1.1 client rejects an MQTT 5.0 CONNACK \n");
+
+	connectParams.MQTTVersion = MQTT_3_1_1;
+	setRxBuffer(connackWithProperties, sizeof(connackWithProperties));
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(MQTT_DECODE_REMAINING_LENGTH_ERROR, rc);
+
+	IOT_DEBUG("-->Success - V:9 - MQTT 3.1.1 client rejects an MQTT 5.0 CONNACK \n");
+}
+
+/* V:10 - Resubscribe drops filters the server refuses and restores the others */
+TEST_C(Mqtt5Tests, ResubscribeReasonCodes) {
+	IoT_Error_t rc;
+	MessageHandlers *pHandler;
+	const unsigned char suback[] = {0x90, 0x04, 0x00, 0x02, 0x00, 0x01};
+	const unsigned char subackNotAuthorized[] = {0x90, 0x04, 0x00, 0x03, 0x00, 0x87};
+	unsigned char subacks[sizeof(subackNotAuthorized) + sizeof(suback)];
+
+	IOT_DEBUG("-->Running MQTT 5.0 Tests - V:10 - Resubscribe drops filters the server refuses and restores the others \n");
+
+	setRxBuffer(connackWithProperties, sizeof(connackWithProperties));
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	setRxBuffer(suback, sizeof(suback));
+	rc = aws_iot_mqtt_subscribe(&iotClient, "cmd/1", 5, QOS1, iot_mqtt5_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	setRxBuffer(suback, sizeof(suback));
+	rc = aws_iot_mqtt_subscribe(&iotClient, "cmd/2", 5, QOS1, iot_mqtt5_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	/* The first filter is refused after the session was lost */
+	memcpy(subacks, subackNotAuthorized, sizeof(subackNotAuthorized));
+	memcpy(&subacks[sizeof(subackNotAuthorized)], suback, sizeof(suback));
+	setRxBuffer(subacks, sizeof(subacks));
+	rc = aws_iot_mqtt_resubscribe(&iotClient);
+	CHECK_EQUAL_C_INT(MQTT_REQUEST_REJECTED_ERROR, rc);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+	CHECK_C(NULL == aws_iot_mqtt_internal_subscription_store_find(&(iotClient.clientData.subscriptions), "cmd/1", 5));
+	pHandler = aws_iot_mqtt_internal_subscription_store_find(&(iotClient.clientData.subscriptions), "cmd/2", 5);
+	CHECK_C(NULL != pHandler);
+	CHECK_EQUAL_C_INT(1, pHandler->resubscribed);
+
+	IOT_DEBUG("-->Success - V:10 - Resubscribe drops filters the server refuses and restores the others \n");
+}
+
+/* V:11 - A DISCONNECT from the server closes the connection and keeps its reason code */
+TEST_C(Mqtt5Tests, ServerDisconnect) {
+	IoT_Error_t rc;
+	const unsigned char sessionTakenOver[] = {0xE0, 0x02, 0x8E, 0x00};
+	const unsigned char normalDisconnect[] = {0xE0, 0x00};
+
+	IOT_DEBUG("-->Running MQTT 5.0 Tests - V:11 - A DISCONNECT from the server closes the connection and keeps its reason code \n");
+
+	rc = aws_iot_mqtt_set_disconnect_handler(&iotClient, iot_mqtt5_disconnect_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	mqtt5DisconnectReason = 0;
+
+	setRxBuffer(connackWithProperties, sizeof(connackWithProperties));
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	setRxBuffer(sessionTakenOver, sizeof(sessionTakenOver));
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(MQTT_SERVER_DISCONNECTED_ERROR, rc);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_DISCONNECTED_ERROR, aws_iot_mqtt_get_client_state(&iotClient));
+	CHECK_EQUAL_C_INT(0x8E, aws_iot_mqtt_get_server_disconnect_reason(&iotClient));
+	CHECK_EQUAL_C_INT(0x8E, mqtt5DisconnectReason);
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_get_network_disconnected_count(&iotClient));
+
+	/* Cleared by the next connect, a DISCONNECT without a reason code is a normal disconnection */
+	setRxBuffer(connackWithProperties, sizeof(connackWithProperties));
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_get_server_disconnect_reason(&iotClient));
+
+	setRxBuffer(normalDisconnect, sizeof(normalDisconnect));
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(MQTT_SERVER_DISCONNECTED_ERROR, rc);
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_get_server_disconnect_reason(&iotClient));
+
+	IOT_DEBUG("-->Success - V:11 - A DISCONNECT from the server closes the connection and keeps its reason code \n");
+}
@@ -0,0 +1,46 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_payload_codec.cpp
+ * @brief IoT Client Unit Testing - Payload Codec Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(PayloadCodecTests) {
+	TEST_GROUP_C_SETUP_WRAPPER(PayloadCodecTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(PayloadCodecTests)
+};
+
+/* L:1 - LZ round trip without a dictionary */
+TEST_GROUP_C_WRAPPER(PayloadCodecTests, LzRoundTrip)
+/* L:2 - LZ round trip with a shared dictionary */
+TEST_GROUP_C_WRAPPER(PayloadCodecTests, LzRoundTripWithDictionary)
+/* L:3 - Incompressible payload stored as is */
+TEST_GROUP_C_WRAPPER(PayloadCodecTests, IncompressiblePayloadStored)
+/* L:4 - Malformed compressed data rejected */
+TEST_GROUP_C_WRAPPER(PayloadCodecTests, MalformedInputRejected)
+/* L:5 - Set codecs with invalid parameters, replace and remove them */
+TEST_GROUP_C_WRAPPER(PayloadCodecTests, SetCodecParams)
+/* L:6 - Publish on a matching topic is encoded */
+TEST_GROUP_C_WRAPPER(PayloadCodecTests, PublishEncoded)
+/* L:7 - Incoming message decoded before delivery */
+TEST_GROUP_C_WRAPPER(PayloadCodecTests, IncomingMessageDecoded)
+/* L:8 - Publish fails while every codec buffer is in use */
+TEST_GROUP_C_WRAPPER(PayloadCodecTests, PublishPoolExhausted)
+/* L:9 - QoS1 message that cannot be decoded is not acknowledged */
+TEST_GROUP_C_WRAPPER(PayloadCodecTests, UndecodableMessageAckedAndCounted)
@@ -0,0 +1,477 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_payload_codec_helper.c
+ * @brief IoT Client Unit Testing - Payload Codec Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_payload_codec.h"
+#include "aws_iot_lz.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+#define CODEC_TEST_FILTER "dt/+/telemetry"
+#define CODEC_TEST_TOPIC "dt/press14/telemetry"
+#define CODEC_TEST_PLAIN_TOPIC "dt/press14/status"
+#define CODEC_TEST_BLOCK_SIZE 256
+#define CODEC_TEST_BLOCKS 2
+
+static const char telemetry[] = "{\"ts\":1700000000,\"temperature\":21.5,\"humidity\":40.1},"
+								"{\"ts\":1700000001,\"temperature\":21.6,\"humidity\":40.0},"
+								"{\"ts\":1700000002,\"temperature\":21.6,\"humidity\":39.9}";
+static const char dictionary[] = "{\"state\":{\"reported\":{\"temperature\":,\"humidity\":,\"ts\":}}}";
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static IoT_Publish_Message_Params testPubMsgParams;
+static AWS_IoT_Client iotClient;
+static IoT_LZ_Context_t lzContext;
+static IoT_LZ_Codec_Context_t codecContext;
+static IoT_Payload_Codec_t codec;
+static IoT_Pool_t codecPool;
+static unsigned char codecBlocks[CODEC_TEST_BLOCKS][CODEC_TEST_BLOCK_SIZE];
+static uint32_t codecLinks[CODEC_TEST_BLOCKS];
+static char codecCallbackMessage[CODEC_TEST_BLOCK_SIZE];
+
+static void iot_codec_callback_handler(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
+									   IoT_Publish_Message_Params *pParams, void *pData) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(pTopicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(pData);
+
+	snprintf(codecCallbackMessage, sizeof(codecCallbackMessage), "%.*s", (int) pParams->payloadLen,
+			 (char *) pParams->payload);
+}
+
+static void connectClient(void) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+}
+
+/* Sets the network up to deliver a PUBLISH with the given payload, QoS1 with a non-zero packet ID */
+static void setRxBufferForPublish(const char *pTopicName, uint16_t packetId, const unsigned char *pPayload,
+								  size_t payloadLen) {
+	size_t topicNameLen = strlen(pTopicName);
+	size_t idLen = (0 == packetId) ? 0 : 2;
+	size_t pos = 1;
+
+	ResetTLSBuffer();
+	RxBuffer.NoMsgFlag = false;
+	RxBuffer.pBuffer[0] = (0 == packetId) ? 0x30 : 0x32;
+	encodeRemainingLength(RxBuffer.pBuffer, &pos, 2 + topicNameLen + idLen + payloadLen);
+	RxBuffer.pBuffer[pos++] = (unsigned char) (topicNameLen >> 8);
+	RxBuffer.pBuffer[pos++] = (unsigned char) (topicNameLen & 0xFF);
+	memcpy(&RxBuffer.pBuffer[pos], pTopicName, topicNameLen);
+	pos += topicNameLen;
+	if(0 != packetId) {
+		RxBuffer.pBuffer[pos++] = (unsigned char) (packetId >> 8);
+		RxBuffer.pBuffer[pos++] = (unsigned char) (packetId & 0xFF);
+	}
+	memcpy(&RxBuffer.pBuffer[pos], pPayload, payloadLen);
+	RxBuffer.len = pos + payloadLen;
+	RxIndex = 0;
+}
+
+TEST_GROUP_C_SETUP(PayloadCodecTests) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	initParams.mqttCommandTimeout_ms = 200;
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+
+	rc = aws_iot_pool_init(&codecPool, codecBlocks, CODEC_TEST_BLOCK_SIZE, CODEC_TEST_BLOCKS, codecLinks);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	rc = aws_iot_mqtt_lz_codec_init(&codec, &codecContext, NULL, 0);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	snprintf(codecCallbackMessage, sizeof(codecCallbackMessage), "NOT_VISITED");
+}
+
+TEST_GROUP_C_TEARDOWN(PayloadCodecTests) { }
+
+/* L:1 - LZ round trip without a dictionary */
+TEST_C(PayloadCodecTests, LzRoundTrip) {
+	static unsigned char run[600];
+	unsigned char compressed[sizeof(telemetry)];
+	unsigned char decompressed[sizeof(telemetry)];
+	size_t compressedLen, decompressedLen;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Payload Codec Tests - L:1 - LZ round trip without a dictionary \n");
+
+	rc = aws_iot_lz_compress(&lzContext, NULL, 0, (const unsigned char *) telemetry, strlen(telemetry),
+							 compressed, sizeof(compressed), &compressedLen);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(compressedLen < strlen(telemetry) / 2);
+
+	rc = aws_iot_lz_decompress(NULL, 0, compressed, compressedLen, decompressed, sizeof(decompressed),
+							   &decompressedLen);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(strlen(telemetry), decompressedLen);
+	CHECK_C(0 == memcmp(telemetry, decompressed, decompressedLen));
+
+	/* A run longer than 15 + 255 bytes needs several length bytes and an overlapping match */
+	memset(run, 'a', sizeof(run));
+	rc = aws_iot_lz_compress(&lzContext, NULL, 0, run, sizeof(run), compressed, sizeof(compressed), &compressedLen);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(compressedLen < 16);
+	memset(run, 0, sizeof(run));
+	rc = aws_iot_lz_decompress(NULL, 0, compressed, compressedLen, run, sizeof(run), &decompressedLen);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(sizeof(run), decompressedLen);
+	CHECK_EQUAL_C_INT('a', run[0]);
+	CHECK_EQUAL_C_INT('a', run[sizeof(run) - 1]);
+
+	IOT_DEBUG("-->Success - L:1 - LZ round trip without a dictionary \n");
+}
+
+/* L:2 - LZ round trip with a shared dictionary */
+TEST_C(PayloadCodecTests, LzRoundTripWithDictionary) {
+	const char *pShadow = "{\"state\":{\"reported\":{\"temperature\":21.5,\"humidity\":40.1,\"ts\":1700000000}}}";
+	unsigned char compressed[128];
+	unsigned char decompressed[128];
+	size_t plainLen, dictionaryLen;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Payload Codec Tests - L:2 - LZ round trip with a shared dictionary \n");
+
+	rc = aws_iot_lz_compress(&lzContext, NULL, 0, (const unsigned char *) pShadow, strlen(pShadow), compressed,
+							 sizeof(compressed), &plainLen);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	rc = aws_iot_lz_compress(&lzContext, (const unsigned char *) dictionary, strlen(dictionary),
+							 (const unsigned char *) pShadow, strlen(pShadow), compressed, sizeof(compressed),
+							 &dictionaryLen);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(dictionaryLen < plainLen);
+
+	rc = aws_iot_lz_decompress((const unsigned char *) dictionary, strlen(dictionary), compressed, dictionaryLen,
+							   decompressed, sizeof(decompressed), &plainLen);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(strlen(pShadow), plainLen);
+	CHECK_C(0 == memcmp(pShadow, decompressed, plainLen));
+
+	/* Without the dictionary the references into it are out of range */
+	rc = aws_iot_lz_decompress(NULL, 0, compressed, dictionaryLen, decompressed, sizeof(decompressed), &plainLen);
+	CHECK_EQUAL_C_INT(FAILURE, rc);
+
+	IOT_DEBUG("-->Success - L:2 - LZ round trip with a shared dictionary \n");
+}
+
+/* L:3 - Incompressible payload stored as is */
+TEST_C(PayloadCodecTests, IncompressiblePayloadStored) {
+	const unsigned char random[] = {0x3A, 0x91, 0x0C, 0xE7, 0x55, 0x18, 0xB2, 0x6F, 0x04, 0xD9, 0x7E, 0x23};
+	unsigned char encoded[sizeof(random) + 1];
+	unsigned char decoded[sizeof(random)];
+	size_t encodedLen, decodedLen;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Payload Codec Tests - L:3 - Incompressible payload stored as is \n");
+
+	rc = codec.encode(codec.pContext, random, sizeof(random), encoded, sizeof(encoded), &encodedLen);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(sizeof(random) + 1, encodedLen);
+	CHECK_EQUAL_C_INT(0x00, encoded[0]);
+	CHECK_C(0 == memcmp(random, &encoded[1], sizeof(random)));
+
+	rc = codec.decode(codec.pContext, encoded, encodedLen, decoded, sizeof(decoded), &decodedLen);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(sizeof(random), decodedLen);
+	CHECK_C(0 == memcmp(random, decoded, decodedLen));
+
+	/* Neither form fits */
+	rc = codec.encode(codec.pContext, random, sizeof(random), encoded, sizeof(random), &encodedLen);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, rc);
+
+	IOT_DEBUG("-->Success - L:3 - Incompressible payload stored as is \n");
+}
+
+/* L:4 - Malformed compressed data rejected */
+TEST_C(PayloadCodecTests, MalformedInputRejected) {
+	/* 4 literals, then a match 5 bytes back although only 4 bytes were produced */
+	const unsigned char badDistance[] = {0x40, 'a', 'b', 'c', 'd', 0x05, 0x00};
+	/* 15 literals announced, the length byte is missing */
+	const unsigned char truncatedLength[] = {0xF0};
+	/* 3 literals announced, 2 present */
+	const unsigned char truncatedLiterals[] = {0x30, 'a', 'b'};
+	/* Match without its distance */
+	const unsigned char truncatedDistance[] = {0x11, 'a', 0x01};
+	const unsigned char unknownMethod[] = {0x07, 'a'};
+	const unsigned char valid[] = {0x14, 'a', 0x01, 0x00, 0x30, 'b', 'c', 'd'};
+	unsigned char out[16];
+	size_t outLen;
+
+	IOT_DEBUG("-->Running Payload Codec Tests - L:4 - Malformed compressed data rejected \n");
+
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_lz_decompress(NULL, 0, badDistance, sizeof(badDistance), out, sizeof(out),
+													 &outLen));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_lz_decompress(NULL, 0, truncatedLength, sizeof(truncatedLength), out,
+													 sizeof(out), &outLen));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_lz_decompress(NULL, 0, truncatedLiterals, sizeof(truncatedLiterals), out,
+													 sizeof(out), &outLen));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_lz_decompress(NULL, 0, truncatedDistance, sizeof(truncatedDistance), out,
+													 sizeof(out), &outLen));
+	CHECK_EQUAL_C_INT(FAILURE, codec.decode(codec.pContext, unknownMethod, sizeof(unknownMethod), out, sizeof(out),
+											&outLen));
+	CHECK_EQUAL_C_INT(FAILURE, codec.decode(codec.pContext, unknownMethod, 0, out, sizeof(out), &outLen));
+
+	/* "a" repeated 9 times by a match 1 byte back, then "bcd" */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_lz_decompress(NULL, 0, valid, sizeof(valid), out, sizeof(out), &outLen));
+	CHECK_EQUAL_C_INT(12, outLen);
+	CHECK_C(0 == memcmp("aaaaaaaaabcd", out, outLen));
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, aws_iot_lz_decompress(NULL, 0, valid, sizeof(valid), out, 11, &outLen));
+
+	IOT_DEBUG("-->Success - L:4 - Malformed compressed data rejected \n");
+}
+
+/* L:5 - Set codecs with invalid parameters, replace and remove them */
+TEST_C(PayloadCodecTests, SetCodecParams) {
+	IoT_Payload_Codec_t incomplete = {NULL, NULL, NULL};
+	char filters[AWS_IOT_MQTT_NUM_PAYLOAD_CODECS + 1][16];
+	uint32_t i;
+
+	IOT_DEBUG("-->Running Payload Codec Tests - L:5 - Set codecs with invalid parameters, replace and remove them \n");
+
+	/* No pool yet */
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_set_payload_codec(&iotClient, CODEC_TEST_FILTER, &codec));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_set_payload_codec_pool(&iotClient, NULL));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_payload_codec_pool(&iotClient, &codecPool));
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_set_payload_codec(NULL, CODEC_TEST_FILTER, &codec));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_set_payload_codec(&iotClient, NULL, &codec));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_set_payload_codec(&iotClient, "", &codec));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_set_payload_codec(&iotClient, CODEC_TEST_FILTER, &incomplete));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_lz_codec_init(&codec, NULL, NULL, 0));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_mqtt_lz_codec_init(&codec, &codecContext, NULL, 4));
+
+	for(i = 0; i < AWS_IOT_MQTT_NUM_PAYLOAD_CODECS; i++) {
+		snprintf(filters[i], sizeof(filters[i]), "codec/%u", (unsigned) i);
+		CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_payload_codec(&iotClient, filters[i], &codec));
+	}
+	snprintf(filters[i], sizeof(filters[i]), "codec/%u", (unsigned) i);
+	CHECK_EQUAL_C_INT(LIMIT_EXCEEDED_ERROR, aws_iot_mqtt_set_payload_codec(&iotClient, filters[i], &codec));
+
+	/* Setting a filter again replaces its codec without taking another entry */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_payload_codec(&iotClient, "codec/0", &codec));
+
+	/* Removing a filter frees its entry, removing an unknown filter does nothing */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_payload_codec(&iotClient, "codec/1", NULL));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_payload_codec(&iotClient, "codec/unknown", NULL));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_payload_codec(&iotClient, filters[i], &codec));
+
+	IOT_DEBUG("-->Success - L:5 - Set codecs with invalid parameters, replace and remove them \n");
+}
+
+/* L:6 - Publish on a matching topic is encoded */
+TEST_C(PayloadCodecTests, PublishEncoded) {
+	unsigned char expected[CODEC_TEST_BLOCK_SIZE];
+	size_t expectedLen;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Payload Codec Tests - L:6 - Publish on a matching topic is encoded \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_payload_codec_pool(&iotClient, &codecPool));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_payload_codec(&iotClient, CODEC_TEST_FILTER, &codec));
+	connectClient();
+
+	testPubMsgParams.qos = QOS0;
+	testPubMsgParams.isRetained = 0;
+	testPubMsgParams.payload = (void *) telemetry;
+	testPubMsgParams.payloadLen = strlen(telemetry);
+	rc = aws_iot_mqtt_publish(&iotClient, CODEC_TEST_TOPIC, (uint16_t) strlen(CODEC_TEST_TOPIC), &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = codec.encode(codec.pContext, (const unsigned char *) telemetry, strlen(telemetry), expected,
+					  sizeof(expected), &expectedLen);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0x01, expected[0]);
+	/* Fixed header, topic and the compressed payload */
+	CHECK_EQUAL_C_INT(2 + 2 + strlen(CODEC_TEST_TOPIC) + expectedLen, TxBuffer.len);
+	CHECK_C(0 == memcmp(&TxBuffer.pBuffer[TxBuffer.len - expectedLen], expected, expectedLen));
+	CHECK_EQUAL_C_INT(CODEC_TEST_BLOCKS, aws_iot_pool_available(&codecPool));
+
+	/* Other topics are sent as they are */
+	rc = aws_iot_mqtt_publish(&iotClient, CODEC_TEST_PLAIN_TOPIC, (uint16_t) strlen(CODEC_TEST_PLAIN_TOPIC),
+							  &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(0 == memcmp(&TxBuffer.pBuffer[TxBuffer.len - strlen(telemetry)], telemetry, strlen(telemetry)));
+
+	IOT_DEBUG("-->Success - L:6 - Publish on a matching topic is encoded \n");
+}
+
+/* L:7 - Incoming message decoded before delivery */
+TEST_C(PayloadCodecTests, IncomingMessageDecoded) {
+	unsigned char encoded[CODEC_TEST_BLOCK_SIZE];
+	size_t encodedLen;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Payload Codec Tests - L:7 - Incoming message decoded before delivery \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_payload_codec_pool(&iotClient, &codecPool));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_payload_codec(&iotClient, CODEC_TEST_FILTER, &codec));
+	connectClient();
+
+	setTLSRxBufferForSuback(CODEC_TEST_FILTER, strlen(CODEC_TEST_FILTER), QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, CODEC_TEST_FILTER, (uint16_t) strlen(CODEC_TEST_FILTER), QOS0,
+								iot_codec_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = codec.encode(codec.pContext, (const unsigned char *) telemetry, strlen(telemetry), encoded,
+					  sizeof(encoded), &encodedLen);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	setRxBufferForPublish(CODEC_TEST_TOPIC, 0, encoded, encodedLen);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING(telemetry, codecCallbackMessage);
+	CHECK_EQUAL_C_INT(CODEC_TEST_BLOCKS, aws_iot_pool_available(&codecPool));
+
+	/* A payload the codec cannot decode is dropped */
+	snprintf(codecCallbackMessage, sizeof(codecCallbackMessage), "NOT_VISITED");
+	encoded[0] = 0x07;
+	setRxBufferForPublish(CODEC_TEST_TOPIC, 0, encoded, encodedLen);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(PAYLOAD_CODEC_ERROR, rc);
+	CHECK_EQUAL_C_STRING("NOT_VISITED", codecCallbackMessage);
+	CHECK_EQUAL_C_INT(CODEC_TEST_BLOCKS, aws_iot_pool_available(&codecPool));
+
+	IOT_DEBUG("-->Success - L:7 - Incoming message decoded before delivery \n");
+}
+
+/* L:8 - Publish fails while every codec buffer is in use */
+TEST_C(PayloadCodecTests, PublishPoolExhausted) {
+	static unsigned char noise[CODEC_TEST_BLOCK_SIZE];
+	void *pBlocks[CODEC_TEST_BLOCKS];
+	uint32_t i, seed = 12345;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Payload Codec Tests - L:8 - Publish fails while every codec buffer is in use \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_payload_codec_pool(&iotClient, &codecPool));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_payload_codec(&iotClient, CODEC_TEST_FILTER, &codec));
+	connectClient();
+
+	for(i = 0; i < CODEC_TEST_BLOCKS; i++) {
+		pBlocks[i] = aws_iot_pool_alloc(&codecPool);
+		CHECK_C(NULL != pBlocks[i]);
+	}
+
+	testPubMsgParams.qos = QOS0;
+	testPubMsgParams.isRetained = 0;
+	testPubMsgParams.payload = (void *) telemetry;
+	testPubMsgParams.payloadLen = strlen(telemetry);
+	rc = aws_iot_mqtt_publish(&iotClient, CODEC_TEST_TOPIC, (uint16_t) strlen(CODEC_TEST_TOPIC), &testPubMsgParams);
+	CHECK_EQUAL_C_INT(LIMIT_EXCEEDED_ERROR, rc);
+	CHECK_EQUAL_C_INT(0, TxBuffer.len);
+
+	/* The write buffer was released, the next publish goes through */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_pool_free(&codecPool, pBlocks[0]));
+	rc = aws_iot_mqtt_publish(&iotClient, CODEC_TEST_TOPIC, (uint16_t) strlen(CODEC_TEST_TOPIC), &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0x30, TxBuffer.pBuffer[0]);
+
+	/* An encoded payload larger than a block fails the publish */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_pool_free(&codecPool, pBlocks[1]));
+	for(i = 0; i < sizeof(noise); i++) {
+		seed = seed * 1103515245u + 12345u;
+		noise[i] = (unsigned char) (seed >> 16);
+	}
+	testPubMsgParams.payload = noise;
+	testPubMsgParams.payloadLen = sizeof(noise);
+	rc = aws_iot_mqtt_publish(&iotClient, CODEC_TEST_TOPIC, (uint16_t) strlen(CODEC_TEST_TOPIC), &testPubMsgParams);
+	CHECK_EQUAL_C_INT(PAYLOAD_CODEC_ERROR, rc);
+	CHECK_EQUAL_C_INT(CODEC_TEST_BLOCKS, aws_iot_pool_available(&codecPool));
+
+	IOT_DEBUG("-->Success - L:8 - Publish fails while every codec buffer is in use \n");
+}
+
+/* L:9 - QoS1 message that cannot be decoded is not acknowledged */
+TEST_C(PayloadCodecTests, UndecodableMessageAckedAndCounted) {
+	unsigned char encoded[CODEC_TEST_BLOCK_SIZE];
+	unsigned char firstByte;
+	void *pBlocks[CODEC_TEST_BLOCKS];
+	size_t encodedLen;
+	uint32_t i;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Payload Codec Tests - L:9 - QoS1 message that cannot be decoded is acknowledged and counted \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_payload_codec_pool(&iotClient, &codecPool));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_payload_codec(&iotClient, CODEC_TEST_FILTER, &codec));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_set_duplicate_suppression(&iotClient, true));
+	connectClient();
+
+	setTLSRxBufferForSuback(CODEC_TEST_FILTER, strlen(CODEC_TEST_FILTER), QOS1, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, CODEC_TEST_FILTER, (uint16_t) strlen(CODEC_TEST_FILTER), QOS1,
+								iot_codec_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = codec.encode(codec.pContext, (const unsigned char *) telemetry, strlen(telemetry), encoded,
+					  sizeof(encoded), &encodedLen);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	/* No PUBACK while every codec buffer is in use */
+	for(i = 0; i < CODEC_TEST_BLOCKS; i++) {
+		pBlocks[i] = aws_iot_pool_alloc(&codecPool);
+		CHECK_C(NULL != pBlocks[i]);
+	}
+	setRxBufferForPublish(CODEC_TEST_TOPIC, 7, encoded, encodedLen);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(LIMIT_EXCEEDED_ERROR, rc);
+	CHECK_EQUAL_C_INT(0, TxBuffer.len);
+	CHECK_EQUAL_C_STRING("NOT_VISITED", codecCallbackMessage);
+	for(i = 0; i < CODEC_TEST_BLOCKS; i++) {
+		CHECK_EQUAL_C_INT(SUCCESS, aws_iot_pool_free(&codecPool, pBlocks[i]));
+	}
+
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_get_undecodable_payload_count(&iotClient));
+
+	/* A payload the codec rejects is acknowledged, counted and not delivered */
+	firstByte = encoded[0];
+	encoded[0] = 0x07;
+	setRxBufferForPublish(CODEC_TEST_TOPIC, 8, encoded, encodedLen);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(PAYLOAD_CODEC_ERROR, rc);
+	CHECK_EQUAL_C_INT(0x40, TxBuffer.pBuffer[0]);
+	CHECK_EQUAL_C_INT(8, TxBuffer.pBuffer[3]);
+	CHECK_EQUAL_C_STRING("NOT_VISITED", codecCallbackMessage);
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_get_undecodable_payload_count(&iotClient));
+	CHECK_EQUAL_C_INT(CODEC_TEST_BLOCKS, aws_iot_pool_available(&codecPool));
+
+	/* The message that found no free block was not recorded as a duplicate, its redelivery is delivered */
+	encoded[0] = firstByte;
+	setRxBufferForPublish(CODEC_TEST_TOPIC, 7, encoded, encodedLen);
+	RxBuffer.pBuffer[0] |= 0x08;
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING(telemetry, codecCallbackMessage);
+	CHECK_EQUAL_C_INT(0x40, TxBuffer.pBuffer[0]);
+	CHECK_EQUAL_C_INT(CODEC_TEST_BLOCKS, aws_iot_pool_available(&codecPool));
+
+	IOT_DEBUG("-->Success - L:9 - QoS1 message that cannot be decoded is acknowledged and counted \n");
+}
@@ -0,0 +1,38 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_pool.cpp
+ * @brief IoT Client Unit Testing - Fixed-Block Pool Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(PoolTests) {
+	TEST_GROUP_C_SETUP_WRAPPER(PoolTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(PoolTests)
+};
+
+/* P:1 - Init with invalid parameters */
+TEST_GROUP_C_WRAPPER(PoolTests, InitInvalidParams)
+/* P:2 - Allocate every block, pool exhausted, release and allocate again */
+TEST_GROUP_C_WRAPPER(PoolTests, AllocUntilExhausted)
+/* P:3 - Release of foreign and already released blocks is rejected */
+TEST_GROUP_C_WRAPPER(PoolTests, InvalidFree)
+/* P:4 - Released block keeps its content */
+TEST_GROUP_C_WRAPPER(PoolTests, FreeKeepsContent)
+/* P:5 - Init from an arena, aligned blocks, arena exhausted */
+TEST_GROUP_C_WRAPPER(PoolTests, InitFromArena)
@@ -0,0 +1,166 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_pool_helper.c
+ * @brief IoT Client Unit Testing - Fixed-Block Pool Tests Helper
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_pool.h"
+#include "aws_iot_log.h"
+
+#define TEST_POOL_BLOCK_COUNT 4
+
+typedef struct {
+	uint32_t id;
+	char name[12];
+} TestRecord_t;
+
+static TestRecord_t testRecords[TEST_POOL_BLOCK_COUNT];
+static uint32_t testLinks[TEST_POOL_BLOCK_COUNT];
+static IoT_Pool_t testPool;
+
+static unsigned char arenaMemory[256];
+static IoT_Arena_t testArena;
+
+TEST_GROUP_C_SETUP(PoolTests) {
+	IoT_Error_t rc = aws_iot_pool_init(&testPool, testRecords, sizeof(TestRecord_t), TEST_POOL_BLOCK_COUNT, testLinks);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+}
+
+TEST_GROUP_C_TEARDOWN(PoolTests) { }
+
+/* P:1 - Init with invalid parameters */
+TEST_C(PoolTests, InitInvalidParams) {
+	IoT_Pool_t pool;
+
+	IOT_DEBUG("-->Running Pool Tests - P:1 - Init with invalid parameters \n");
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_pool_init(NULL, testRecords, sizeof(TestRecord_t), 1, testLinks));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_pool_init(&pool, NULL, sizeof(TestRecord_t), 1, testLinks));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_pool_init(&pool, testRecords, 0, 1, testLinks));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_pool_init(&pool, testRecords, sizeof(TestRecord_t), 0, testLinks));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_pool_init(&pool, testRecords, sizeof(TestRecord_t), 1, NULL));
+	CHECK_C(NULL == aws_iot_pool_alloc(NULL));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_pool_free(&testPool, NULL));
+
+	IOT_DEBUG("-->Success - P:1 - Init with invalid parameters \n");
+}
+
+/* P:2 - Allocate every block, pool exhausted, release and allocate again */
+TEST_C(PoolTests, AllocUntilExhausted) {
+	TestRecord_t *pRecords[TEST_POOL_BLOCK_COUNT];
+	TestRecord_t *pRecord;
+	uint32_t i, j;
+
+	IOT_DEBUG("-->Running Pool Tests - P:2 - Allocate until the pool is exhausted \n");
+
+	CHECK_EQUAL_C_INT(TEST_POOL_BLOCK_COUNT, aws_iot_pool_capacity(&testPool));
+	for(i = 0; i < TEST_POOL_BLOCK_COUNT; i++) {
+		pRecords[i] = (TestRecord_t *) aws_iot_pool_alloc(&testPool);
+		CHECK_C(NULL != pRecords[i]);
+		CHECK_EQUAL_C_INT(i, aws_iot_pool_index_of(&testPool, pRecords[i]));
+		for(j = 0; j < i; j++) {
+			CHECK_C(pRecords[i] != pRecords[j]);
+		}
+	}
+	CHECK_EQUAL_C_INT(0, aws_iot_pool_available(&testPool));
+	CHECK_C(NULL == aws_iot_pool_alloc(&testPool));
+
+	/* The last block released is the next one handed out */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_pool_free(&testPool, pRecords[2]));
+	CHECK_EQUAL_C_INT(1, aws_iot_pool_available(&testPool));
+	pRecord = (TestRecord_t *) aws_iot_pool_alloc(&testPool);
+	CHECK_C(pRecords[2] == pRecord);
+
+	for(i = 0; i < TEST_POOL_BLOCK_COUNT; i++) {
+		CHECK_EQUAL_C_INT(SUCCESS, aws_iot_pool_free(&testPool, pRecords[i]));
+	}
+	CHECK_EQUAL_C_INT(TEST_POOL_BLOCK_COUNT, aws_iot_pool_available(&testPool));
+
+	IOT_DEBUG("-->Success - P:2 - Allocate until the pool is exhausted \n");
+}
+
+/* P:3 - Release of foreign and already released blocks is rejected */
+TEST_C(PoolTests, InvalidFree) {
+	TestRecord_t foreignRecord;
+	TestRecord_t *pRecord;
+
+	IOT_DEBUG("-->Running Pool Tests - P:3 - Invalid release \n");
+
+	pRecord = (TestRecord_t *) aws_iot_pool_alloc(&testPool);
+	CHECK_C(NULL != pRecord);
+
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_pool_free(&testPool, &foreignRecord));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_pool_free(&testPool, ((unsigned char *) pRecord) + 1));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_pool_free(&testPool, &testRecords[TEST_POOL_BLOCK_COUNT - 1]));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_pool_free(&testPool, pRecord));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_pool_free(&testPool, pRecord));
+	CHECK_EQUAL_C_INT(TEST_POOL_BLOCK_COUNT, aws_iot_pool_available(&testPool));
+
+	IOT_DEBUG("-->Success - P:3 - Invalid release \n");
+}
+
+/* P:4 - Released block keeps its content */
+TEST_C(PoolTests, FreeKeepsContent) {
+	TestRecord_t *pRecord;
+
+	IOT_DEBUG("-->Running Pool Tests - P:4 - Released block keeps its content \n");
+
+	pRecord = (TestRecord_t *) aws_iot_pool_alloc(&testPool);
+	CHECK_C(NULL != pRecord);
+	pRecord->id = 0xCAFEF00D;
+	strcpy(pRecord->name, "record");
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_pool_free(&testPool, pRecord));
+
+	CHECK_C(0xCAFEF00D == pRecord->id);
+	CHECK_EQUAL_C_STRING("record", pRecord->name);
+	CHECK_C(pRecord == aws_iot_pool_block_at(&testPool, aws_iot_pool_index_of(&testPool, pRecord)));
+	CHECK_C(NULL == aws_iot_pool_block_at(&testPool, TEST_POOL_BLOCK_COUNT));
+
+	IOT_DEBUG("-->Success - P:4 - Released block keeps its content \n");
+}
+
+/* P:5 - Init from an arena, aligned blocks, arena exhausted */
+TEST_C(PoolTests, InitFromArena) {
+	IoT_Pool_t pool;
+	unsigned char *pBlock;
+	uint32_t i;
+
+	IOT_DEBUG("-->Running Pool Tests - P:5 - Init from an arena \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_arena_init(&testArena, arenaMemory, sizeof(arenaMemory)));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_pool_init_from_arena(&pool, &testArena, 13, 6));
+	CHECK_EQUAL_C_INT(6, aws_iot_pool_capacity(&pool));
+
+	for(i = 0; i < 6; i++) {
+		pBlock = (unsigned char *) aws_iot_pool_alloc(&pool);
+		CHECK_C(NULL != pBlock);
+		CHECK_C(pBlock >= arenaMemory && pBlock + 13 <= arenaMemory + sizeof(arenaMemory));
+		CHECK_EQUAL_C_INT(0, (int) ((uintptr_t) pBlock % AWS_IOT_ARENA_ALIGNMENT));
+	}
+	CHECK_C(NULL == aws_iot_pool_alloc(&pool));
+
+	CHECK_EQUAL_C_INT(ARENA_EXHAUSTED_ERROR, aws_iot_pool_init_from_arena(&pool, &testArena, 64, 4));
+
+	aws_iot_arena_reset(&testArena);
+	CHECK_EQUAL_C_INT(sizeof(arenaMemory), aws_iot_arena_remaining(&testArena));
+
+	IOT_DEBUG("-->Success - P:5 - Init from an arena \n");
+}
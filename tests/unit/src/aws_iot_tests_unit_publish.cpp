@@ -46,3 +46,5 @@ TEST_GROUP_C_WRAPPER(PublishTests, publishQoS1Success10msDelayedPuback)
 TEST_GROUP_C_WRAPPER(PublishTests, publishQoS0NoPubackSuccess)
 /* E:10 - Publish with QoS1 send success, Puback received */
 TEST_GROUP_C_WRAPPER(PublishTests, publishQoS1Success)
+/* E:11 - Publish QoS0 while yield is in progress */
+TEST_GROUP_C_WRAPPER(PublishTests, publishQoS0DuringYieldSuccess)
@@ -23,7 +23,9 @@
 #include <CppUTest/TestHarness_c.h>
 
 #include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_client_common_internal.h"
 #include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
 #include "aws_iot_log.h"
 
 static IoT_Client_Init_Params initParams;
@@ -203,3 +205,31 @@ TEST_C(PublishTests, publishQoS1Success) {
 
 	IOT_DEBUG("-->Success - E:10 - Publish with QoS1 send success, Puback received \n");
 }
+
+/* E:11 - Publish QoS0 while yield is in progress */
+TEST_C(PublishTests, publishQoS0DuringYieldSuccess) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Publish Tests - E:11 - Publish QoS0 while yield is in progress \n");
+
+	rc = aws_iot_mqtt_set_client_state(&iotClient, CLIENT_STATE_CONNECTED_IDLE,
+									   CLIENT_STATE_CONNECTED_YIELD_IN_PROGRESS);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	testPubMsgParams.qos = QOS0;
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &testPubMsgParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0x30, TxBuffer.pBuffer[0]);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_YIELD_IN_PROGRESS, aws_iot_mqtt_get_client_state(&iotClient));
+
+	/* QoS1 still has to wait for its PUBACK, which the yielding thread would consume */
+	testPubMsgParams.qos = QOS1;
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic, subTopicLen, &testPubMsgParams);
+	CHECK_EQUAL_C_INT(MQTT_CLIENT_NOT_IDLE_ERROR, rc);
+
+	rc = aws_iot_mqtt_set_client_state(&iotClient, CLIENT_STATE_CONNECTED_YIELD_IN_PROGRESS,
+									   CLIENT_STATE_CONNECTED_IDLE);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	IOT_DEBUG("-->Success - E:11 - Publish QoS0 while yield is in progress \n");
+}
@@ -0,0 +1,36 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_rx_lease.cpp
+ * @brief IoT Client Unit Testing - RX Buffer Lease Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(RxLeaseTests) {
+	TEST_GROUP_C_SETUP_WRAPPER(RxLeaseTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(RxLeaseTests)
+};
+
+/* X:1 - Set and remove the pool with invalid parameters and while connected */
+TEST_GROUP_C_WRAPPER(RxLeaseTests, SetPool)
+/* X:2 - Retain outside of a callback or without a pool fails */
+TEST_GROUP_C_WRAPPER(RxLeaseTests, RetainNotAllowed)
+/* X:3 - Retained payload stays valid while the next message is read */
+TEST_GROUP_C_WRAPPER(RxLeaseTests, RetainedPayloadKept)
+/* X:4 - Nothing is read while every buffer is retained */
+TEST_GROUP_C_WRAPPER(RxLeaseTests, ExhaustedPoolStopsReading)
@@ -0,0 +1,279 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_rx_lease_helper.c
+ * @brief IoT Client Unit Testing - RX Buffer Lease Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_rx_lease.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+#define RX_LEASE_TEST_TOPIC "dt/line3/weight"
+#define RX_LEASE_TEST_BLOCKS 3
+#define RX_LEASE_TEST_MAX_LEASES 4
+
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static IoT_Publish_Message_Params testPubMsgParams;
+static AWS_IoT_Client iotClient;
+
+static unsigned char rxBlocks[RX_LEASE_TEST_BLOCKS][AWS_IOT_MQTT_RX_BUF_LEN];
+static uint32_t rxLinks[RX_LEASE_TEST_BLOCKS];
+static IoT_Pool_t rxPool;
+
+static bool retainInCallback;
+static uint32_t deliveredCount;
+static uint32_t leaseCount;
+static IoT_Mqtt_Rx_Lease_t leases[RX_LEASE_TEST_MAX_LEASES];
+static const char *pLeasedPayloads[RX_LEASE_TEST_MAX_LEASES];
+static IoT_Error_t retainRc;
+static IoT_Error_t secondRetainRc;
+
+static void iot_rx_lease_callback_handler(AWS_IoT_Client *pClient, char *pTopicName, uint16_t topicNameLen,
+										  IoT_Publish_Message_Params *pParams, void *pData) {
+	IoT_Mqtt_Rx_Lease_t extraLease;
+
+	IOT_UNUSED(pTopicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(pData);
+
+	deliveredCount++;
+	if(!retainInCallback) {
+		return;
+	}
+
+	retainRc = aws_iot_mqtt_retain_rx_buffer(pClient, &leases[leaseCount]);
+	if(SUCCESS == retainRc) {
+		pLeasedPayloads[leaseCount] = (const char *) pParams->payload;
+		leaseCount++;
+	}
+	secondRetainRc = aws_iot_mqtt_retain_rx_buffer(pClient, &extraLease);
+}
+
+static void connectAndSubscribe(void) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback(RX_LEASE_TEST_TOPIC, strlen(RX_LEASE_TEST_TOPIC), QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, RX_LEASE_TEST_TOPIC, (uint16_t) strlen(RX_LEASE_TEST_TOPIC), QOS0,
+								iot_rx_lease_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+}
+
+static void queueMessage(char *pPayload) {
+	testPubMsgParams.qos = QOS0;
+	testPubMsgParams.isRetained = 0;
+	testPubMsgParams.payload = pPayload;
+	testPubMsgParams.payloadLen = strlen(pPayload);
+	ResetTLSBuffer();
+	setTLSRxBufferWithMsgOnSubscribedTopic(RX_LEASE_TEST_TOPIC, strlen(RX_LEASE_TEST_TOPIC), QOS0, testPubMsgParams,
+										   pPayload);
+}
+
+static void receiveMessage(char *pPayload) {
+	IoT_Error_t rc;
+
+	queueMessage(pPayload);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+}
+
+TEST_GROUP_C_SETUP(RxLeaseTests) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	initParams.mqttCommandTimeout_ms = 200;
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+
+	rc = aws_iot_pool_init(&rxPool, rxBlocks, AWS_IOT_MQTT_RX_BUF_LEN, RX_LEASE_TEST_BLOCKS, rxLinks);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	retainInCallback = false;
+	deliveredCount = 0;
+	leaseCount = 0;
+	memset(leases, 0, sizeof(leases));
+	memset(pLeasedPayloads, 0, sizeof(pLeasedPayloads));
+	retainRc = SUCCESS;
+	secondRetainRc = SUCCESS;
+}
+
+TEST_GROUP_C_TEARDOWN(RxLeaseTests) { }
+
+/* X:1 - Set and remove the pool with invalid parameters and while connected */
+TEST_C(RxLeaseTests, SetPool) {
+	unsigned char *pInitReadBuf = iotClient.clientData.readBuf;
+	size_t initReadBufSize = iotClient.clientData.readBufSize;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running RX Buffer Lease Tests - X:1 - Set and remove the pool with invalid parameters and while connected \n");
+
+	rc = aws_iot_mqtt_set_rx_buffer_pool(NULL, &rxPool);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	/* The client reads into a block of the pool */
+	rc = aws_iot_mqtt_set_rx_buffer_pool(&iotClient, &rxPool);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(RX_LEASE_TEST_BLOCKS > aws_iot_pool_index_of(&rxPool, iotClient.clientData.readBuf));
+	CHECK_EQUAL_C_INT(AWS_IOT_MQTT_RX_BUF_LEN, iotClient.clientData.readBufSize);
+	CHECK_EQUAL_C_INT(RX_LEASE_TEST_BLOCKS - 1, aws_iot_pool_available(&rxPool));
+
+	/* Removing the pool goes back to the buffer from init */
+	rc = aws_iot_mqtt_set_rx_buffer_pool(&iotClient, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(pInitReadBuf == iotClient.clientData.readBuf);
+	CHECK_EQUAL_C_INT(initReadBufSize, iotClient.clientData.readBufSize);
+	CHECK_EQUAL_C_INT(RX_LEASE_TEST_BLOCKS, aws_iot_pool_available(&rxPool));
+
+	connectAndSubscribe();
+	rc = aws_iot_mqtt_set_rx_buffer_pool(&iotClient, &rxPool);
+	CHECK_EQUAL_C_INT(NETWORK_ALREADY_CONNECTED_ERROR, rc);
+	CHECK_C(pInitReadBuf == iotClient.clientData.readBuf);
+
+	IOT_DEBUG("-->Success - X:1 - Set and remove the pool with invalid parameters and while connected \n");
+}
+
+/* X:2 - Retain outside of a callback or without a pool fails */
+TEST_C(RxLeaseTests, RetainNotAllowed) {
+	IoT_Mqtt_Rx_Lease_t lease = {NULL};
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running RX Buffer Lease Tests - X:2 - Retain outside of a callback or without a pool fails \n");
+
+	rc = aws_iot_mqtt_retain_rx_buffer(NULL, &lease);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+	rc = aws_iot_mqtt_retain_rx_buffer(&iotClient, NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+	rc = aws_iot_mqtt_release_rx_buffer(&iotClient, &lease);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	/* Without a pool the read buffer is reused for the next packet */
+	retainInCallback = true;
+	connectAndSubscribe();
+	receiveMessage("{\"grams\":512}");
+	CHECK_EQUAL_C_INT(1, deliveredCount);
+	CHECK_EQUAL_C_INT(FAILURE, retainRc);
+	CHECK_EQUAL_C_INT(0, leaseCount);
+
+	/* Only while a message is delivered */
+	rc = aws_iot_mqtt_disconnect(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	rc = aws_iot_mqtt_set_rx_buffer_pool(&iotClient, &rxPool);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	rc = aws_iot_mqtt_retain_rx_buffer(&iotClient, &lease);
+	CHECK_EQUAL_C_INT(FAILURE, rc);
+	CHECK_C(NULL == lease.pBlock);
+
+	IOT_DEBUG("-->Success - X:2 - Retain outside of a callback or without a pool fails \n");
+}
+
+/* X:3 - Retained payload stays valid while the next message is read */
+TEST_C(RxLeaseTests, RetainedPayloadKept) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running RX Buffer Lease Tests - X:3 - Retained payload stays valid while the next message is read \n");
+
+	rc = aws_iot_mqtt_set_rx_buffer_pool(&iotClient, &rxPool);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	connectAndSubscribe();
+
+	retainInCallback = true;
+	receiveMessage("{\"grams\":512}");
+	CHECK_EQUAL_C_INT(SUCCESS, retainRc);
+	CHECK_EQUAL_C_INT(1, leaseCount);
+	/* Once per message */
+	CHECK_EQUAL_C_INT(FAILURE, secondRetainRc);
+	CHECK_C(leases[0].pBlock != iotClient.clientData.readBuf);
+	CHECK_EQUAL_C_INT(RX_LEASE_TEST_BLOCKS - 2, aws_iot_pool_available(&rxPool));
+
+	retainInCallback = false;
+	receiveMessage("{\"grams\":733}");
+	CHECK_EQUAL_C_INT(2, deliveredCount);
+	CHECK_C(0 == strncmp("{\"grams\":512}", pLeasedPayloads[0], strlen("{\"grams\":512}")));
+	CHECK_EQUAL_C_INT(RX_LEASE_TEST_BLOCKS - 2, aws_iot_pool_available(&rxPool));
+
+	rc = aws_iot_mqtt_release_rx_buffer(&iotClient, &leases[0]);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(NULL == leases[0].pBlock);
+	CHECK_EQUAL_C_INT(RX_LEASE_TEST_BLOCKS - 1, aws_iot_pool_available(&rxPool));
+	rc = aws_iot_mqtt_release_rx_buffer(&iotClient, &leases[0]);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	IOT_DEBUG("-->Success - X:3 - Retained payload stays valid while the next message is read \n");
+}
+
+/* X:4 - Nothing is read while every buffer is retained */
+TEST_C(RxLeaseTests, ExhaustedPoolStopsReading) {
+	IoT_Error_t rc;
+	uint32_t i;
+
+	IOT_DEBUG("-->Running RX Buffer Lease Tests - X:4 - Nothing is read while every buffer is retained \n");
+
+	rc = aws_iot_mqtt_set_rx_buffer_pool(&iotClient, &rxPool);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	connectAndSubscribe();
+
+	retainInCallback = true;
+	receiveMessage("{\"grams\":101}");
+	receiveMessage("{\"grams\":102}");
+	/* Retaining the last block stops the yield that delivered it */
+	queueMessage("{\"grams\":103}");
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(LIMIT_EXCEEDED_ERROR, rc);
+	CHECK_EQUAL_C_INT(RX_LEASE_TEST_BLOCKS, leaseCount);
+	CHECK_C(NULL == iotClient.clientData.readBuf);
+	CHECK_EQUAL_C_INT(0, aws_iot_pool_available(&rxPool));
+
+	/* The next message stays in the network */
+	queueMessage("{\"grams\":104}");
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(LIMIT_EXCEEDED_ERROR, rc);
+	CHECK_EQUAL_C_INT(RX_LEASE_TEST_BLOCKS, deliveredCount);
+	CHECK_EQUAL_C_INT(0, RxIndex);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+
+	for(i = 0; i < RX_LEASE_TEST_BLOCKS; i++) {
+		CHECK_C(0 == strncmp("{\"grams\":10", pLeasedPayloads[i], strlen("{\"grams\":10")));
+		CHECK_EQUAL_C_INT('1' + i, pLeasedPayloads[i][strlen("{\"grams\":10")]);
+	}
+
+	/* A released buffer takes the message that waited */
+	retainInCallback = false;
+	rc = aws_iot_mqtt_release_rx_buffer(&iotClient, &leases[1]);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(RX_LEASE_TEST_BLOCKS + 1, deliveredCount);
+	CHECK_C(NULL != iotClient.clientData.readBuf);
+	CHECK_C(0 == strncmp("{\"grams\":101}", pLeasedPayloads[0], strlen("{\"grams\":101}")));
+	CHECK_C(0 == strncmp("{\"grams\":103}", pLeasedPayloads[2], strlen("{\"grams\":103}")));
+
+	IOT_DEBUG("-->Success - X:4 - Nothing is read while every buffer is retained \n");
+}
@@ -43,6 +43,8 @@ TEST_GROUP_C_WRAPPER(ShadowActionTests, PublishFailsGetRequest)
 TEST_GROUP_C_WRAPPER(ShadowActionTests, GetVersionFromAckStatus)
 TEST_GROUP_C_WRAPPER(ShadowActionTests, StickyNonStickyNeverConflict)
 TEST_GROUP_C_WRAPPER(ShadowActionTests, ACKWaitingMoreThanAllowed)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, ACKWaitListSizedFromArena)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, ACKWaitListReusedOnReinit)
 TEST_GROUP_C_WRAPPER(ShadowActionTests, InboundDataTooBigForBuffer)
 TEST_GROUP_C_WRAPPER(ShadowActionTests, NoClientTokenForShadowAction)
 TEST_GROUP_C_WRAPPER(ShadowActionTests, NoCallbackForShadowAction)
@@ -762,6 +762,92 @@ TEST_C(ShadowActionTests, ACKWaitingMoreThanAllowed) {
 	IOT_DEBUG("-->Success - Ack waiting more than allowed wait time \n");
 }
 
+TEST_C(ShadowActionTests, ACKWaitListSizedFromArena) {
+	static unsigned char recordMemory[1024];
+	IoT_Arena_t recordArena;
+	ShadowInitParameters_t arenaInitParams = shadowInitParams;
+	IoT_Error_t ret_val = SUCCESS;
+	char getRequestJson[TEST_JSON_SIZE];
+	char topic[120];
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Ack wait list sized from an arena \n");
+
+	ret_val = aws_iot_shadow_disconnect(&client);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	ret_val = aws_iot_arena_init(&recordArena, recordMemory, sizeof(recordMemory));
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	arenaInitParams.pRecordArena = &recordArena;
+	arenaInitParams.maxPendingAcks = 2;
+	ret_val = aws_iot_shadow_init(&client, &arenaInitParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_C(aws_iot_arena_remaining(&recordArena) < sizeof(recordMemory));
+
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	ret_val = aws_iot_shadow_connect(&client, &shadowConnectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	topicNameFromThingAndAction(topic, AWS_IOT_MY_THING_NAME, SHADOW_GET);
+	setTLSRxBufferForDoubleSuback(topic, strlen(topic), QOS1, testPubMsgParams);
+
+	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
+											 100, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
+											 100, false);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	// Only two records were taken from the arena
+	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, actionCallback, NULL,
+											 100, false);
+	CHECK_EQUAL_C_INT(FAILURE, ret_val);
+
+	IOT_DEBUG("-->Success - Ack wait list sized from an arena \n");
+}
+
+TEST_C(ShadowActionTests, ACKWaitListReusedOnReinit) {
+	static unsigned char recordMemory[2048];
+	IoT_Arena_t recordArena;
+	ShadowInitParameters_t arenaInitParams = shadowInitParams;
+	IoT_Error_t ret_val = SUCCESS;
+	size_t remaining;
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Ack wait list reused on reinit \n");
+
+	ret_val = aws_iot_shadow_disconnect(&client);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	ret_val = aws_iot_arena_init(&recordArena, recordMemory, sizeof(recordMemory));
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	arenaInitParams.pRecordArena = &recordArena;
+	arenaInitParams.maxPendingAcks = 2;
+	ret_val = aws_iot_shadow_init(&client, &arenaInitParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	remaining = aws_iot_arena_remaining(&recordArena);
+
+	// Same arena and size with reuse asked for, the records are taken only once
+	arenaInitParams.isRecordArenaReused = true;
+	ret_val = aws_iot_shadow_init(&client, &arenaInitParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_INT(remaining, aws_iot_arena_remaining(&recordArena));
+
+	// Another size takes new records
+	arenaInitParams.maxPendingAcks = 3;
+	ret_val = aws_iot_shadow_init(&client, &arenaInitParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_C(aws_iot_arena_remaining(&recordArena) < remaining);
+	remaining = aws_iot_arena_remaining(&recordArena);
+
+	// Without reuse asked for the records are taken again, the arena may have been rewound
+	arenaInitParams.isRecordArenaReused = false;
+	ret_val = aws_iot_shadow_init(&client, &arenaInitParams);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_C(aws_iot_arena_remaining(&recordArena) < remaining);
+
+	IOT_DEBUG("-->Success - Ack wait list reused on reinit \n");
+}
+
 TEST_C(ShadowActionTests, InboundDataTooBigForBuffer) {
 	uint32_t i = 0;
 	IoT_Error_t ret_val = SUCCESS;
@@ -0,0 +1,44 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_shadow_bulk.cpp
+ * @brief IoT Client Unit Testing - Bulk Shadow Sync Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(ShadowBulkTests) {
+	TEST_GROUP_C_SETUP_WRAPPER(ShadowBulkTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(ShadowBulkTests)
+};
+
+/* U:1 - Init with invalid parameters */
+TEST_GROUP_C_WRAPPER(ShadowBulkTests, InitValidation)
+/* U:2 - Start sends no more requests than the window */
+TEST_GROUP_C_WRAPPER(ShadowBulkTests, WindowLimitsRequestsInFlight)
+/* U:3 - Accepted response completes the request and sends the next one */
+TEST_GROUP_C_WRAPPER(ShadowBulkTests, ResponseCompletesAndRefills)
+/* U:4 - Rejected response is reported with its document */
+TEST_GROUP_C_WRAPPER(ShadowBulkTests, RejectedResponse)
+/* U:5 - Responses with another client token or for no request in flight are ignored */
+TEST_GROUP_C_WRAPPER(ShadowBulkTests, UnmatchedResponsesIgnored)
+/* U:6 - Updates of one thing are sent one after the other in list order */
+TEST_GROUP_C_WRAPPER(ShadowBulkTests, SameThingKeepsOrder)
+/* U:7 - Poll times out requests and fills the window again */
+TEST_GROUP_C_WRAPPER(ShadowBulkTests, PollTimesOutRequests)
+/* U:8 - Stop unsubscribes and reports the requests in flight */
+TEST_GROUP_C_WRAPPER(ShadowBulkTests, StopReportsRequestsInFlight)
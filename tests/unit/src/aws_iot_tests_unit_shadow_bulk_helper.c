@@ -0,0 +1,469 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_shadow_bulk_helper.c
+ * @brief IoT Client Unit Testing - Bulk Shadow Sync Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_shadow_interface.h"
+#include "aws_iot_shadow_bulk.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+#undef AWS_IOT_MY_THING_NAME
+#define AWS_IOT_MY_THING_NAME "AWS-IoT-C-SDK"
+
+#define BULK_TEST_TIMEOUT_MS 20000
+#define BULK_TEST_TOKEN_RESPONSE "{\"state\":{},\"version\":1,\"clientToken\":\"%s\"}"
+
+static IoT_Shadow_Bulk_t bulk;
+static IoT_Shadow_Bulk_Params bulkParams;
+static uint32_t callbackCount;
+static uint32_t lastIndex;
+static Shadow_Ack_Status_t lastStatus;
+static char lastDocument[128];
+
+static AWS_IoT_Client client;
+static IoT_Client_Connect_Params connectParams;
+static ShadowInitParameters_t shadowInitParams;
+static ShadowConnectParameters_t shadowConnectParams;
+
+static const IoT_Shadow_Bulk_Request_t getRequests[] = {
+	{"thing-0", SHADOW_GET, NULL, NULL},
+	{"thing-1", SHADOW_GET, NULL, NULL},
+	{"thing-2", SHADOW_GET, NULL, NULL},
+	{"thing-3", SHADOW_GET, NULL, NULL},
+	{"thing-4", SHADOW_GET, NULL, NULL}
+};
+
+static const IoT_Shadow_Bulk_Request_t updateRequests[] = {
+	{"thing-0", SHADOW_UPDATE, "{\"state\":{\"reported\":{\"on\":true}}, \"clientToken\":\"bulk-1\"}", NULL},
+	{"thing-0", SHADOW_UPDATE, "{\"state\":{\"reported\":{\"on\":false}}, \"clientToken\":\"bulk-2\"}", NULL},
+	{"thing-1", SHADOW_UPDATE, "{\"state\":{\"reported\":{\"on\":true}}}", NULL}
+};
+
+static void iot_bulk_callback(uint32_t requestIndex, const IoT_Shadow_Bulk_Request_t *pRequest,
+							  Shadow_Ack_Status_t status, const char *pReceivedJsonDocument, size_t jsonLen) {
+	IOT_UNUSED(pRequest);
+
+	callbackCount++;
+	lastIndex = requestIndex;
+	lastStatus = status;
+	if(NULL == pReceivedJsonDocument) {
+		lastDocument[0] = '\0';
+	} else {
+		snprintf(lastDocument, sizeof(lastDocument), "%.*s", (int) jsonLen, pReceivedJsonDocument);
+	}
+}
+
+static void setBulkParams(const IoT_Shadow_Bulk_Request_t *pRequests, uint32_t requestCount, uint32_t windowSize,
+						  uint32_t timeout_ms) {
+	bulkParams.pRequests = pRequests;
+	bulkParams.requestCount = requestCount;
+	bulkParams.windowSize = windowSize;
+	bulkParams.timeout_ms = timeout_ms;
+	bulkParams.callback = iot_bulk_callback;
+}
+
+static void connectClient(void) {
+	IoT_Error_t rc;
+
+	shadowInitParams.pHost = AWS_IOT_MQTT_HOST;
+	shadowInitParams.port = AWS_IOT_MQTT_PORT;
+	shadowInitParams.pClientCRT = AWS_IOT_CERTIFICATE_FILENAME;
+	shadowInitParams.pRootCA = AWS_IOT_ROOT_CA_FILENAME;
+	shadowInitParams.pClientKey = AWS_IOT_PRIVATE_KEY_FILENAME;
+	shadowInitParams.disconnectHandler = NULL;
+	shadowInitParams.enableAutoReconnect = false;
+	rc = aws_iot_shadow_init(&client, &shadowInitParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	shadowConnectParams.pMyThingName = AWS_IOT_MY_THING_NAME;
+	shadowConnectParams.pMqttClientId = AWS_IOT_MQTT_CLIENT_ID;
+	shadowConnectParams.mqttClientIdLen = (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID);
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	ResetTLSBuffer();
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_shadow_connect(&client, &shadowConnectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+}
+
+/* Queues one SUBACK for the accepted and one for the rejected filter of every action */
+static IoT_Error_t startBulk(uint32_t actionCount) {
+	IoT_Publish_Message_Params params;
+	uint32_t i;
+
+	params.qos = QOS0;
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback("", 0, QOS0, params);
+	for(i = 0; i < actionCount; i++) {
+		memcpy(RxBuffer.pBuffer + RxBuffer.len, RxBuffer.pBuffer, RxBuffer.len);
+		RxBuffer.len *= 2;
+	}
+
+	return aws_iot_shadow_bulk_start(&bulk);
+}
+
+static void deliverResponse(const char *pThingName, const char *pAction, const char *pAck, const char *pDocument) {
+	char topic[MAX_SHADOW_TOPIC_LENGTH_BYTES];
+	char document[128];
+	IoT_Publish_Message_Params params;
+	IoT_Error_t rc;
+
+	snprintf(topic, sizeof(topic), "$aws/things/%s/shadow/%s/%s", pThingName, pAction, pAck);
+	snprintf(document, sizeof(document), "%s", pDocument);
+
+	params.qos = QOS0;
+	params.isRetained = 0;
+	params.payload = document;
+	params.payloadLen = strlen(document);
+	ResetTLSBuffer();
+	setTLSRxBufferWithMsgOnSubscribedTopic(topic, strlen(topic), QOS0, params, document);
+	rc = aws_iot_shadow_yield(&client, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+}
+
+/* Answers the request in flight for the thing with the client token it was sent with */
+static void deliverTokenResponse(const char *pThingName, const char *pAck) {
+	char document[sizeof(BULK_TEST_TOKEN_RESPONSE) + MAX_SIZE_CLIENT_ID_WITH_SEQUENCE];
+	uint32_t i;
+
+	for(i = 0; i < bulk.params.windowSize; i++) {
+		if(bulk.slots[i].isInFlight &&
+		   0 == strcmp(pThingName, bulk.params.pRequests[bulk.slots[i].requestIndex].pThingName)) {
+			break;
+		}
+	}
+	CHECK_C(i < bulk.params.windowSize);
+
+	snprintf(document, sizeof(document), BULK_TEST_TOKEN_RESPONSE, bulk.slots[i].clientToken);
+	deliverResponse(pThingName, "get", pAck, document);
+}
+
+TEST_GROUP_C_SETUP(ShadowBulkTests) {
+	callbackCount = 0;
+	lastIndex = 0;
+	lastStatus = SHADOW_ACK_TIMEOUT;
+	lastDocument[0] = '\0';
+	memset(&bulkParams, 0, sizeof(bulkParams));
+}
+
+TEST_GROUP_C_TEARDOWN(ShadowBulkTests) {
+}
+
+/* U:1 - Init with invalid parameters */
+TEST_C(ShadowBulkTests, InitValidation) {
+	IoT_Shadow_Bulk_Request_t badRequests[2];
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Bulk Shadow Sync Tests - Init with invalid parameters \n");
+
+	setBulkParams(getRequests, 5, 2, BULK_TEST_TIMEOUT_MS);
+	rc = aws_iot_shadow_bulk_init(NULL, &client, &bulkParams);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+	rc = aws_iot_shadow_bulk_init(&bulk, NULL, &bulkParams);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+	rc = aws_iot_shadow_bulk_init(&bulk, &client, NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	bulkParams.callback = NULL;
+	rc = aws_iot_shadow_bulk_init(&bulk, &client, &bulkParams);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	setBulkParams(getRequests, 5, 0, BULK_TEST_TIMEOUT_MS);
+	rc = aws_iot_shadow_bulk_init(&bulk, &client, &bulkParams);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, rc);
+	setBulkParams(getRequests, 5, AWS_IOT_SHADOW_BULK_MAX_WINDOW + 1, BULK_TEST_TIMEOUT_MS);
+	rc = aws_iot_shadow_bulk_init(&bulk, &client, &bulkParams);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, rc);
+
+	/* An update without a document */
+	badRequests[0] = getRequests[0];
+	badRequests[1] = updateRequests[2];
+	badRequests[1].pJsonDocument = NULL;
+	setBulkParams(badRequests, 2, 2, BULK_TEST_TIMEOUT_MS);
+	rc = aws_iot_shadow_bulk_init(&bulk, &client, &bulkParams);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	badRequests[1] = getRequests[1];
+	badRequests[1].pThingName = "a-thing-name-longer-than-MAX_SIZE_OF_THING_NAME";
+	rc = aws_iot_shadow_bulk_init(&bulk, &client, &bulkParams);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, rc);
+
+	setBulkParams(getRequests, 5, 2, BULK_TEST_TIMEOUT_MS);
+	rc = aws_iot_shadow_bulk_init(&bulk, &client, &bulkParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1u << SHADOW_GET, bulk.actionMask);
+	CHECK_C(false == aws_iot_shadow_bulk_is_done(&bulk));
+
+	IOT_DEBUG("-->Success - Init with invalid parameters \n");
+}
+
+/* U:2 - Start sends no more requests than the window */
+TEST_C(ShadowBulkTests, WindowLimitsRequestsInFlight) {
+	IoT_Shadow_Bulk_Stats_t stats;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Bulk Shadow Sync Tests - Start sends no more requests than the window \n");
+
+	connectClient();
+	setBulkParams(getRequests, 5, 2, BULK_TEST_TIMEOUT_MS);
+	rc = aws_iot_shadow_bulk_init(&bulk, &client, &bulkParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = startBulk(1);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1u << SHADOW_GET, bulk.subscribedMask);
+	CHECK_EQUAL_C_STRING("$aws/things/+/shadow/get/rejected", LastSubscribeMessage);
+
+	aws_iot_shadow_bulk_get_stats(&bulk, &stats);
+	CHECK_EQUAL_C_INT(2, stats.sent);
+	CHECK_EQUAL_C_INT(2, bulk.inFlightCount);
+	CHECK_EQUAL_C_STRING("$aws/things/thing-1/shadow/get", LastPublishMessageTopic);
+	CHECK_C(NULL != strstr(LastPublishMessagePayload, "\"clientToken\":\"" AWS_IOT_MQTT_CLIENT_ID "-"));
+
+	/* Nothing timed out and the window is full */
+	rc = aws_iot_shadow_bulk_poll(&bulk);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	aws_iot_shadow_bulk_get_stats(&bulk, &stats);
+	CHECK_EQUAL_C_INT(2, stats.sent);
+	CHECK_EQUAL_C_INT(0, callbackCount);
+
+	IOT_DEBUG("-->Success - Start sends no more requests than the window \n");
+}
+
+/* U:3 - Accepted response completes the request and sends the next one */
+TEST_C(ShadowBulkTests, ResponseCompletesAndRefills) {
+	IoT_Shadow_Bulk_Stats_t stats;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Bulk Shadow Sync Tests - Accepted response completes the request and sends the next one \n");
+
+	connectClient();
+	setBulkParams(getRequests, 5, 2, BULK_TEST_TIMEOUT_MS);
+	aws_iot_shadow_bulk_init(&bulk, &client, &bulkParams);
+	rc = startBulk(1);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	/* Responses can arrive in any order */
+	deliverTokenResponse("thing-1", "accepted");
+	CHECK_EQUAL_C_INT(1, callbackCount);
+	CHECK_EQUAL_C_INT(1, lastIndex);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_ACCEPTED, lastStatus);
+	CHECK_C(0 == strncmp("{\"state\":{},\"version\":1", lastDocument, strlen("{\"state\":{},\"version\":1")));
+	CHECK_EQUAL_C_STRING("$aws/things/thing-2/shadow/get", LastPublishMessageTopic);
+
+	deliverTokenResponse("thing-0", "accepted");
+	deliverTokenResponse("thing-2", "accepted");
+	deliverTokenResponse("thing-3", "accepted");
+	CHECK_C(false == aws_iot_shadow_bulk_is_done(&bulk));
+	deliverTokenResponse("thing-4", "accepted");
+	CHECK_EQUAL_C_INT(5, callbackCount);
+	CHECK_EQUAL_C_INT(4, lastIndex);
+	CHECK_C(aws_iot_shadow_bulk_is_done(&bulk));
+
+	aws_iot_shadow_bulk_get_stats(&bulk, &stats);
+	CHECK_EQUAL_C_INT(5, stats.sent);
+	CHECK_EQUAL_C_INT(5, stats.accepted);
+	CHECK_EQUAL_C_INT(0, stats.ignored);
+	CHECK_EQUAL_C_INT(0, bulk.inFlightCount);
+
+	IOT_DEBUG("-->Success - Accepted response completes the request and sends the next one \n");
+}
+
+/* U:4 - Rejected response is reported with its document */
+TEST_C(ShadowBulkTests, RejectedResponse) {
+	IoT_Shadow_Bulk_Stats_t stats;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Bulk Shadow Sync Tests - Rejected response is reported with its document \n");
+
+	connectClient();
+	setBulkParams(getRequests, 1, 1, BULK_TEST_TIMEOUT_MS);
+	aws_iot_shadow_bulk_init(&bulk, &client, &bulkParams);
+	rc = startBulk(1);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	deliverTokenResponse("thing-0", "rejected");
+	CHECK_EQUAL_C_INT(1, callbackCount);
+	CHECK_EQUAL_C_INT(0, lastIndex);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_REJECTED, lastStatus);
+	CHECK_C(aws_iot_shadow_bulk_is_done(&bulk));
+
+	aws_iot_shadow_bulk_get_stats(&bulk, &stats);
+	CHECK_EQUAL_C_INT(0, stats.accepted);
+	CHECK_EQUAL_C_INT(1, stats.rejected);
+
+	IOT_DEBUG("-->Success - Rejected response is reported with its document \n");
+}
+
+/* U:5 - Responses with another client token or for no request in flight are ignored */
+TEST_C(ShadowBulkTests, UnmatchedResponsesIgnored) {
+	IoT_Shadow_Bulk_Stats_t stats;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Bulk Shadow Sync Tests - Responses with another client token or for no request in flight are ignored \n");
+
+	connectClient();
+	setBulkParams(getRequests, 2, 1, BULK_TEST_TIMEOUT_MS);
+	aws_iot_shadow_bulk_init(&bulk, &client, &bulkParams);
+	rc = startBulk(1);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	/* Late response to an earlier request on the same thing */
+	deliverResponse("thing-0", "get", "accepted", "{\"state\":{},\"clientToken\":\"earlier-1\"}");
+	/* No token at all */
+	deliverResponse("thing-0", "get", "accepted", "{\"state\":{}}");
+	/* Thing that is not in flight */
+	deliverResponse("thing-1", "get", "accepted", "{\"state\":{},\"clientToken\":\"earlier-2\"}");
+	/* Thing name that only shares a prefix with the one in flight */
+	deliverResponse("thing-01", "get", "accepted", "{\"state\":{},\"clientToken\":\"earlier-3\"}");
+
+	CHECK_EQUAL_C_INT(0, callbackCount);
+	aws_iot_shadow_bulk_get_stats(&bulk, &stats);
+	CHECK_EQUAL_C_INT(4, stats.ignored);
+	CHECK_EQUAL_C_INT(1, stats.sent);
+	CHECK_EQUAL_C_INT(1, bulk.inFlightCount);
+
+	deliverTokenResponse("thing-0", "accepted");
+	CHECK_EQUAL_C_INT(1, callbackCount);
+	CHECK_EQUAL_C_STRING("$aws/things/thing-1/shadow/get", LastPublishMessageTopic);
+
+	IOT_DEBUG("-->Success - Responses with another client token or for no request in flight are ignored \n");
+}
+
+/* U:6 - Updates of one thing are sent one after the other in list order */
+TEST_C(ShadowBulkTests, SameThingKeepsOrder) {
+	IoT_Shadow_Bulk_Stats_t stats;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Bulk Shadow Sync Tests - Updates of one thing are sent one after the other in list order \n");
+
+	connectClient();
+	setBulkParams(updateRequests, 3, 3, BULK_TEST_TIMEOUT_MS);
+	aws_iot_shadow_bulk_init(&bulk, &client, &bulkParams);
+	rc = startBulk(1);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1u << SHADOW_UPDATE, bulk.subscribedMask);
+
+	/* The second update waits for the first, the third waits behind it */
+	aws_iot_shadow_bulk_get_stats(&bulk, &stats);
+	CHECK_EQUAL_C_INT(1, stats.sent);
+	CHECK_EQUAL_C_STRING("$aws/things/thing-0/shadow/update", LastPublishMessageTopic);
+	CHECK_EQUAL_C_STRING(updateRequests[0].pJsonDocument, LastPublishMessagePayload);
+
+	rc = aws_iot_shadow_bulk_poll(&bulk);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	aws_iot_shadow_bulk_get_stats(&bulk, &stats);
+	CHECK_EQUAL_C_INT(1, stats.sent);
+
+	deliverResponse("thing-0", "update", "accepted", "{\"state\":{},\"clientToken\":\"bulk-1\"}");
+	CHECK_EQUAL_C_INT(1, callbackCount);
+	CHECK_EQUAL_C_INT(0, lastIndex);
+	aws_iot_shadow_bulk_get_stats(&bulk, &stats);
+	CHECK_EQUAL_C_INT(3, stats.sent);
+	CHECK_EQUAL_C_STRING("$aws/things/thing-1/shadow/update", LastPublishMessageTopic);
+
+	/* The third update has no client token and is matched by thing and action */
+	deliverResponse("thing-1", "update", "accepted", "{\"state\":{}}");
+	CHECK_EQUAL_C_INT(2, callbackCount);
+	CHECK_EQUAL_C_INT(2, lastIndex);
+
+	deliverResponse("thing-0", "update", "accepted", "{\"state\":{},\"clientToken\":\"bulk-2\"}");
+	CHECK_EQUAL_C_INT(3, callbackCount);
+	CHECK_EQUAL_C_INT(1, lastIndex);
+	CHECK_C(aws_iot_shadow_bulk_is_done(&bulk));
+
+	IOT_DEBUG("-->Success - Updates of one thing are sent one after the other in list order \n");
+}
+
+/* U:7 - Poll times out requests and fills the window again */
+TEST_C(ShadowBulkTests, PollTimesOutRequests) {
+	IoT_Shadow_Bulk_Stats_t stats;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Bulk Shadow Sync Tests - Poll times out requests and fills the window again \n");
+
+	connectClient();
+	setBulkParams(getRequests, 3, 2, 10);
+	aws_iot_shadow_bulk_init(&bulk, &client, &bulkParams);
+	rc = startBulk(1);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	usleep(20000);
+	rc = aws_iot_shadow_bulk_poll(&bulk);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(2, callbackCount);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, lastStatus);
+	CHECK_EQUAL_C_STRING("", lastDocument);
+	CHECK_EQUAL_C_STRING("$aws/things/thing-2/shadow/get", LastPublishMessageTopic);
+
+	/* A response after the timeout does not complete the request again */
+	deliverResponse("thing-0", "get", "accepted", "{\"state\":{}}");
+	CHECK_EQUAL_C_INT(2, callbackCount);
+
+	usleep(20000);
+	rc = aws_iot_shadow_bulk_poll(&bulk);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(3, callbackCount);
+	CHECK_EQUAL_C_INT(2, lastIndex);
+	CHECK_C(aws_iot_shadow_bulk_is_done(&bulk));
+
+	aws_iot_shadow_bulk_get_stats(&bulk, &stats);
+	CHECK_EQUAL_C_INT(3, stats.timedOut);
+	CHECK_EQUAL_C_INT(1, stats.ignored);
+
+	IOT_DEBUG("-->Success - Poll times out requests and fills the window again \n");
+}
+
+/* U:8 - Stop unsubscribes and reports the requests in flight */
+TEST_C(ShadowBulkTests, StopReportsRequestsInFlight) {
+	IoT_Shadow_Bulk_Stats_t stats;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Bulk Shadow Sync Tests - Stop unsubscribes and reports the requests in flight \n");
+
+	connectClient();
+	setBulkParams(getRequests, 5, 2, BULK_TEST_TIMEOUT_MS);
+	aws_iot_shadow_bulk_init(&bulk, &client, &bulkParams);
+	rc = startBulk(1);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ResetTLSBuffer();
+	setTLSRxBufferForUnsuback();
+	memcpy(RxBuffer.pBuffer + RxBuffer.len, RxBuffer.pBuffer, RxBuffer.len);
+	RxBuffer.len *= 2;
+	rc = aws_iot_shadow_bulk_stop(&bulk);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0, bulk.subscribedMask);
+	CHECK_EQUAL_C_INT(2, callbackCount);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, lastStatus);
+
+	/* The requests that were never sent are not reported */
+	CHECK_C(false == aws_iot_shadow_bulk_is_done(&bulk));
+	aws_iot_shadow_bulk_get_stats(&bulk, &stats);
+	CHECK_EQUAL_C_INT(2, stats.sent);
+	CHECK_EQUAL_C_INT(2, stats.timedOut);
+	CHECK_EQUAL_C_INT(0, bulk.inFlightCount);
+
+	IOT_DEBUG("-->Success - Stop unsubscribes and reports the requests in flight \n");
+}
@@ -0,0 +1,46 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_shadow_codegen.cpp
+ * @brief IoT Client Unit Testing - Generated Shadow Encoder and Decoder Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(ShadowCodegenTests) {
+	TEST_GROUP_C_SETUP_WRAPPER(ShadowCodegenTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(ShadowCodegenTests)
+};
+
+/* S:1 - Generated reported section is the same as aws_iot_shadow_add_reported */
+TEST_GROUP_C_WRAPPER(ShadowCodegenTests, EncodeMatchesGeneric)
+/* S:2 - Field mask selects the fields and nested objects */
+TEST_GROUP_C_WRAPPER(ShadowCodegenTests, EncodeFieldMask)
+/* S:3 - Every buffer that is too small is reported and not overrun */
+TEST_GROUP_C_WRAPPER(ShadowCodegenTests, EncodeBufferTooSmall)
+/* S:4 - Integer limits are written like snprintf */
+TEST_GROUP_C_WRAPPER(ShadowCodegenTests, EncodeIntegerLimits)
+/* S:5 - Delta fields decoded through the perfect hash */
+TEST_GROUP_C_WRAPPER(ShadowCodegenTests, DecodeDelta)
+/* S:6 - Section of a get/accepted document with metadata */
+TEST_GROUP_C_WRAPPER(ShadowCodegenTests, DecodeSection)
+/* S:7 - Unknown keys, wrong types and null values are skipped */
+TEST_GROUP_C_WRAPPER(ShadowCodegenTests, DecodeSkipsMismatches)
+/* S:8 - Invalid parameters and documents */
+TEST_GROUP_C_WRAPPER(ShadowCodegenTests, InvalidInput)
+/* S:9 - Encoded state decodes to the same struct */
+TEST_GROUP_C_WRAPPER(ShadowCodegenTests, RoundTrip)
@@ -0,0 +1,324 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_shadow_codegen_helper.c
+ * @brief IoT Client Unit Testing - Generated Shadow Encoder and Decoder Tests Helper
+ *
+ * aws_iot_tests_unit_codegen_device.c/.h are generated from tests/unit/schema/codegen_device.json
+ * with tools/shadow_codegen/aws_iot_shadow_codegen.py.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_shadow_interface.h"
+#include "aws_iot_tests_unit_codegen_device.h"
+#include "aws_iot_log.h"
+
+#define CODEGEN_TEST_BUFFER_LEN 512
+
+static char genericBuffer[CODEGEN_TEST_BUFFER_LEN];
+static char generatedBuffer[CODEGEN_TEST_BUFFER_LEN];
+static codegen_device_t device;
+
+static void setField(jsonStruct_t *pField, const char *pKey, void *pData, size_t dataLength, JsonPrimitiveType type) {
+	pField->pKey = pKey;
+	pField->pData = pData;
+	pField->dataLength = dataLength;
+	pField->type = type;
+	pField->cb = NULL;
+}
+
+TEST_GROUP_C_SETUP(ShadowCodegenTests) {
+	memset(genericBuffer, 0, sizeof(genericBuffer));
+	memset(generatedBuffer, 0, sizeof(generatedBuffer));
+	memset(&device, 0, sizeof(device));
+	device.temperature = 21.5f;
+	device.humidity = 40.25;
+	device.windowOpen = true;
+	strcpy(device.mode, "cooling");
+	device.offset = -3;
+	device.altitude = -120;
+	device.uptime = 86400;
+	device.brightness = 200;
+	device.port = 8883;
+	device.counter = 4000000000u;
+	device.fan.speed = 3;
+	device.fan.oscillate = false;
+}
+
+TEST_GROUP_C_TEARDOWN(ShadowCodegenTests) { }
+
+/* S:1 - Generated reported section is the same as aws_iot_shadow_add_reported */
+TEST_C(ShadowCodegenTests, EncodeMatchesGeneric) {
+	jsonStruct_t fields[11];
+	char fanObject[] = "{\"speed\":3,\"oscillate\":false}";
+
+	IOT_DEBUG("-->Running Shadow Codegen Tests - S:1 - Generated reported section is the same as aws_iot_shadow_add_reported \n");
+
+	setField(&fields[0], "temperature", &device.temperature, sizeof(float), SHADOW_JSON_FLOAT);
+	setField(&fields[1], "humidity", &device.humidity, sizeof(double), SHADOW_JSON_DOUBLE);
+	setField(&fields[2], "windowOpen", &device.windowOpen, sizeof(bool), SHADOW_JSON_BOOL);
+	setField(&fields[3], "mode", device.mode, sizeof(device.mode), SHADOW_JSON_STRING);
+	setField(&fields[4], "offset", &device.offset, sizeof(int8_t), SHADOW_JSON_INT8);
+	setField(&fields[5], "altitude", &device.altitude, sizeof(int16_t), SHADOW_JSON_INT16);
+	setField(&fields[6], "uptime", &device.uptime, sizeof(int32_t), SHADOW_JSON_INT32);
+	setField(&fields[7], "brightness", &device.brightness, sizeof(uint8_t), SHADOW_JSON_UINT8);
+	setField(&fields[8], "port", &device.port, sizeof(uint16_t), SHADOW_JSON_UINT16);
+	setField(&fields[9], "counter", &device.counter, sizeof(uint32_t), SHADOW_JSON_UINT32);
+	setField(&fields[10], "fan", fanObject, sizeof(fanObject), SHADOW_JSON_OBJECT);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_init_json_document(genericBuffer, sizeof(genericBuffer)));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_add_reported(genericBuffer, sizeof(genericBuffer), 11, &fields[0],
+														   &fields[1], &fields[2], &fields[3], &fields[4], &fields[5],
+														   &fields[6], &fields[7], &fields[8], &fields[9], &fields[10]));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_add_desired(genericBuffer, sizeof(genericBuffer), 2, &fields[3],
+														  &fields[7]));
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_init_json_document(generatedBuffer, sizeof(generatedBuffer)));
+	CHECK_EQUAL_C_INT(SUCCESS, codegen_device_add_reported(generatedBuffer, sizeof(generatedBuffer), &device,
+														   CODEGEN_DEVICE_ALL));
+	CHECK_EQUAL_C_INT(SUCCESS, codegen_device_add_desired(generatedBuffer, sizeof(generatedBuffer), &device,
+														  CODEGEN_DEVICE_MODE | CODEGEN_DEVICE_BRIGHTNESS));
+	CHECK_EQUAL_C_STRING(genericBuffer, generatedBuffer);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_finalize_json_document(generatedBuffer, sizeof(generatedBuffer)));
+	CHECK_C(NULL != strstr(generatedBuffer, "\"desired\":{\"mode\":\"cooling\",\"brightness\":200}}, \"clientToken\":"));
+
+	IOT_DEBUG("-->Success - S:1 - Generated reported section is the same as aws_iot_shadow_add_reported \n");
+}
+
+/* S:2 - Field mask selects the fields and nested objects */
+TEST_C(ShadowCodegenTests, EncodeFieldMask) {
+	size_t len = 0;
+
+	IOT_DEBUG("-->Running Shadow Codegen Tests - S:2 - Field mask selects the fields and nested objects \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, codegen_device_encode(generatedBuffer, sizeof(generatedBuffer), &device,
+													 CODEGEN_DEVICE_TEMPERATURE | CODEGEN_DEVICE_FAN_SPEED, &len));
+	CHECK_EQUAL_C_STRING("{\"temperature\":21.500000,\"fan\":{\"speed\":3}}", generatedBuffer);
+	CHECK_EQUAL_C_INT(strlen(generatedBuffer), len);
+
+	CHECK_EQUAL_C_INT(SUCCESS, codegen_device_encode(generatedBuffer, sizeof(generatedBuffer), &device,
+													 CODEGEN_DEVICE_FAN, &len));
+	CHECK_EQUAL_C_STRING("{\"fan\":{\"speed\":3,\"oscillate\":false}}", generatedBuffer);
+
+	CHECK_EQUAL_C_INT(SUCCESS, codegen_device_encode(generatedBuffer, sizeof(generatedBuffer), &device, 0, &len));
+	CHECK_EQUAL_C_STRING("{}", generatedBuffer);
+	CHECK_EQUAL_C_INT(2, len);
+
+	IOT_DEBUG("-->Success - S:2 - Field mask selects the fields and nested objects \n");
+}
+
+/* S:3 - Every buffer that is too small is reported and not overrun */
+TEST_C(ShadowCodegenTests, EncodeBufferTooSmall) {
+	size_t fullLen = 0, bufferLen, len, i;
+	char reference[CODEGEN_TEST_BUFFER_LEN];
+
+	IOT_DEBUG("-->Running Shadow Codegen Tests - S:3 - Every buffer that is too small is reported and not overrun \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, codegen_device_encode(reference, sizeof(reference), &device, CODEGEN_DEVICE_ALL,
+													 &fullLen));
+
+	for(bufferLen = 0; bufferLen <= fullLen; bufferLen++) {
+		memset(generatedBuffer, 'x', sizeof(generatedBuffer));
+		CHECK_EQUAL_C_INT(SHADOW_JSON_BUFFER_TRUNCATED,
+						  codegen_device_encode(generatedBuffer, bufferLen, &device, CODEGEN_DEVICE_ALL, &len));
+		for(i = bufferLen; i < sizeof(generatedBuffer); i++) {
+			CHECK_EQUAL_C_CHAR('x', generatedBuffer[i]);
+		}
+	}
+	CHECK_EQUAL_C_INT(SUCCESS, codegen_device_encode(generatedBuffer, fullLen + 1, &device, CODEGEN_DEVICE_ALL, &len));
+	CHECK_EQUAL_C_STRING(reference, generatedBuffer);
+
+	/* The section has to fit after what is already in the document */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_init_json_document(generatedBuffer, sizeof(generatedBuffer)));
+	CHECK_EQUAL_C_INT(SHADOW_JSON_BUFFER_TRUNCATED,
+					  codegen_device_add_reported(generatedBuffer, strlen(generatedBuffer) + 20, &device,
+												  CODEGEN_DEVICE_ALL));
+	CHECK_EQUAL_C_INT(SHADOW_JSON_BUFFER_TRUNCATED,
+					  codegen_device_add_reported(generatedBuffer, 4, &device, CODEGEN_DEVICE_ALL));
+
+	IOT_DEBUG("-->Success - S:3 - Every buffer that is too small is reported and not overrun \n");
+}
+
+/* S:4 - Integer limits are written like snprintf */
+TEST_C(ShadowCodegenTests, EncodeIntegerLimits) {
+	IOT_DEBUG("-->Running Shadow Codegen Tests - S:4 - Integer limits are written like snprintf \n");
+
+	device.offset = INT8_MIN;
+	device.altitude = INT16_MAX;
+	device.uptime = INT32_MIN;
+	device.brightness = 0;
+	device.port = UINT16_MAX;
+	device.counter = UINT32_MAX;
+	CHECK_EQUAL_C_INT(SUCCESS, codegen_device_encode(generatedBuffer, sizeof(generatedBuffer), &device,
+													 CODEGEN_DEVICE_OFFSET | CODEGEN_DEVICE_ALTITUDE
+													 | CODEGEN_DEVICE_UPTIME | CODEGEN_DEVICE_BRIGHTNESS
+													 | CODEGEN_DEVICE_PORT | CODEGEN_DEVICE_COUNTER, NULL));
+	snprintf(genericBuffer, sizeof(genericBuffer),
+			 "{\"offset\":%hhi,\"altitude\":%hi,\"uptime\":%i,\"brightness\":%hhu,\"port\":%hu,\"counter\":%u}",
+			 device.offset, device.altitude, device.uptime, device.brightness, device.port, device.counter);
+	CHECK_EQUAL_C_STRING(genericBuffer, generatedBuffer);
+
+	device.uptime = INT32_MAX;
+	CHECK_EQUAL_C_INT(SUCCESS, codegen_device_encode(generatedBuffer, sizeof(generatedBuffer), &device,
+													 CODEGEN_DEVICE_UPTIME, NULL));
+	CHECK_EQUAL_C_STRING("{\"uptime\":2147483647}", generatedBuffer);
+
+	IOT_DEBUG("-->Success - S:4 - Integer limits are written like snprintf \n");
+}
+
+/* S:5 - Delta fields decoded through the perfect hash */
+TEST_C(ShadowCodegenTests, DecodeDelta) {
+	const char delta[] = "{\"version\":7,\"timestamp\":1526412345,\"state\":{\"mode\":\"heating\","
+						 "\"fan\":{\"oscillate\":true},\"counter\":12},\"metadata\":{\"mode\":{\"timestamp\":1526412345},"
+						 "\"fan\":{\"oscillate\":{\"timestamp\":1526412345}},\"counter\":{\"timestamp\":1526412345}}}";
+	uint32_t fieldMask = 0;
+
+	IOT_DEBUG("-->Running Shadow Codegen Tests - S:5 - Delta fields decoded through the perfect hash \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, codegen_device_decode(delta, sizeof(delta) - 1, NULL, &device, &fieldMask));
+	CHECK_EQUAL_C_INT(CODEGEN_DEVICE_MODE | CODEGEN_DEVICE_FAN_OSCILLATE | CODEGEN_DEVICE_COUNTER, fieldMask);
+	CHECK_EQUAL_C_STRING("heating", device.mode);
+	CHECK_EQUAL_C_INT(true, device.fan.oscillate);
+	CHECK_EQUAL_C_INT(12, device.counter);
+	CHECK_EQUAL_C_INT(3, device.fan.speed);
+	CHECK_EQUAL_C_INT(86400, device.uptime);
+
+	IOT_DEBUG("-->Success - S:5 - Delta fields decoded through the perfect hash \n");
+}
+
+/* S:6 - Section of a get/accepted document with metadata */
+TEST_C(ShadowCodegenTests, DecodeSection) {
+	const char accepted[] = "{\"state\":{\"desired\":{\"mode\":\"off\",\"brightness\":10},\"reported\":{\"mode\":"
+							"\"cooling\",\"brightness\":90,\"port\":443}},\"metadata\":{\"desired\":{\"mode\":"
+							"{\"timestamp\":1},\"brightness\":{\"timestamp\":1}},\"reported\":{\"mode\":{\"timestamp\":2},"
+							"\"brightness\":{\"timestamp\":2},\"port\":{\"timestamp\":2}}},\"version\":3,\"timestamp\":4,"
+							"\"clientToken\":\"CSDK-test-1\"}";
+	uint32_t fieldMask = 0;
+
+	IOT_DEBUG("-->Running Shadow Codegen Tests - S:6 - Section of a get/accepted document with metadata \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, codegen_device_decode(accepted, sizeof(accepted) - 1, "reported", &device, &fieldMask));
+	CHECK_EQUAL_C_INT(CODEGEN_DEVICE_MODE | CODEGEN_DEVICE_BRIGHTNESS | CODEGEN_DEVICE_PORT, fieldMask);
+	CHECK_EQUAL_C_STRING("cooling", device.mode);
+	CHECK_EQUAL_C_INT(90, device.brightness);
+	CHECK_EQUAL_C_INT(443, device.port);
+
+	CHECK_EQUAL_C_INT(SUCCESS, codegen_device_decode(accepted, sizeof(accepted) - 1, "desired", &device, &fieldMask));
+	CHECK_EQUAL_C_INT(CODEGEN_DEVICE_MODE | CODEGEN_DEVICE_BRIGHTNESS, fieldMask);
+	CHECK_EQUAL_C_STRING("off", device.mode);
+	CHECK_EQUAL_C_INT(10, device.brightness);
+
+	CHECK_EQUAL_C_INT(SUCCESS, codegen_device_decode(accepted, sizeof(accepted) - 1, "delta", &device, &fieldMask));
+	CHECK_EQUAL_C_INT(0, fieldMask);
+
+	IOT_DEBUG("-->Success - S:6 - Section of a get/accepted document with metadata \n");
+}
+
+/* S:7 - Unknown keys, wrong types and null values are skipped */
+TEST_C(ShadowCodegenTests, DecodeSkipsMismatches) {
+	const char delta[] = "{\"state\":{\"other\":{\"mode\":\"x\",\"uptime\":1},\"mode\":12,\"windowOpen\":null,"
+						 "\"temperature\":\"hot\",\"fan\":7,\"port\":{\"speed\":1},\"modes\":\"y\",\"mode\":"
+						 "\"much too long for the field\",\"uptime\":5}}";
+	uint32_t fieldMask = 0;
+
+	IOT_DEBUG("-->Running Shadow Codegen Tests - S:7 - Unknown keys, wrong types and null values are skipped \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, codegen_device_decode(delta, sizeof(delta) - 1, NULL, &device, &fieldMask));
+	CHECK_EQUAL_C_INT(CODEGEN_DEVICE_UPTIME, fieldMask);
+	CHECK_EQUAL_C_INT(5, device.uptime);
+	CHECK_EQUAL_C_STRING("cooling", device.mode);
+	CHECK_EQUAL_C_INT(true, device.windowOpen);
+	CHECK_EQUAL_C_INT(8883, device.port);
+	CHECK_EQUAL_C_INT(3, device.fan.speed);
+
+	IOT_DEBUG("-->Success - S:7 - Unknown keys, wrong types and null values are skipped \n");
+}
+
+/* S:8 - Invalid parameters and documents */
+TEST_C(ShadowCodegenTests, InvalidInput) {
+	const char valid[] = "{\"state\":{\"uptime\":1}}";
+	const char truncated[] = "{\"state\":{\"uptime\":1}";
+	const char array[] = "[{\"state\":{\"uptime\":1}}]";
+	char manyMembers[CODEGEN_TEST_BUFFER_LEN];
+	size_t len;
+	uint32_t fieldMask = 0, i;
+
+	IOT_DEBUG("-->Running Shadow Codegen Tests - S:8 - Invalid parameters and documents \n");
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, codegen_device_encode(NULL, 10, &device, CODEGEN_DEVICE_ALL, NULL));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, codegen_device_encode(generatedBuffer, 10, NULL, CODEGEN_DEVICE_ALL, NULL));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, codegen_device_add_reported(NULL, 10, &device, CODEGEN_DEVICE_ALL));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, codegen_device_add_desired(generatedBuffer, 10, NULL, CODEGEN_DEVICE_ALL));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, codegen_device_decode(NULL, 1, NULL, &device, &fieldMask));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, codegen_device_decode(valid, sizeof(valid) - 1, NULL, NULL, &fieldMask));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, codegen_device_decode(valid, sizeof(valid) - 1, NULL, &device, NULL));
+
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, codegen_device_decode(truncated, sizeof(truncated) - 1, NULL, &device,
+															  &fieldMask));
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, codegen_device_decode(array, sizeof(array) - 1, NULL, &device, &fieldMask));
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, codegen_device_decode(valid, 0, NULL, &device, &fieldMask));
+
+	/* More members than CODEGEN_DEVICE_MAX_JSON_TOKENS */
+	len = (size_t) snprintf(manyMembers, sizeof(manyMembers), "{\"state\":{\"uptime\":1");
+	for(i = 0; i < CODEGEN_DEVICE_MAX_JSON_TOKENS / 2; i++) {
+		len += (size_t) snprintf(manyMembers + len, sizeof(manyMembers) - len, ",\"x%u\":1", (unsigned) i);
+	}
+	snprintf(manyMembers + len, sizeof(manyMembers) - len, "}}");
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, codegen_device_decode(manyMembers, strlen(manyMembers), NULL, &device,
+															  &fieldMask));
+	CHECK_EQUAL_C_INT(0, fieldMask);
+	CHECK_EQUAL_C_INT(86400, device.uptime);
+
+	IOT_DEBUG("-->Success - S:8 - Invalid parameters and documents \n");
+}
+
+/* S:9 - Encoded state decodes to the same struct */
+TEST_C(ShadowCodegenTests, RoundTrip) {
+	codegen_device_t decoded;
+	size_t len = 0;
+	uint32_t fieldMask = 0;
+
+	IOT_DEBUG("-->Running Shadow Codegen Tests - S:9 - Encoded state decodes to the same struct \n");
+
+	memcpy(generatedBuffer, "{\"state\":", 9);
+	CHECK_EQUAL_C_INT(SUCCESS, codegen_device_encode(generatedBuffer + 9, sizeof(generatedBuffer) - 10, &device,
+													 CODEGEN_DEVICE_ALL, &len));
+	memcpy(generatedBuffer + 9 + len, "}", 2);
+
+	memset(&decoded, 0, sizeof(decoded));
+	CHECK_EQUAL_C_INT(SUCCESS, codegen_device_decode(generatedBuffer, strlen(generatedBuffer), NULL, &decoded,
+													 &fieldMask));
+	CHECK_EQUAL_C_INT(CODEGEN_DEVICE_ALL, fieldMask);
+	CHECK_EQUAL_C_REAL(device.temperature, decoded.temperature, 0.0);
+	CHECK_EQUAL_C_REAL(device.humidity, decoded.humidity, 0.0);
+	CHECK_EQUAL_C_INT(device.windowOpen, decoded.windowOpen);
+	CHECK_EQUAL_C_STRING(device.mode, decoded.mode);
+	CHECK_EQUAL_C_INT(device.offset, decoded.offset);
+	CHECK_EQUAL_C_INT(device.altitude, decoded.altitude);
+	CHECK_EQUAL_C_INT(device.uptime, decoded.uptime);
+	CHECK_EQUAL_C_INT(device.brightness, decoded.brightness);
+	CHECK_EQUAL_C_INT(device.port, decoded.port);
+	CHECK_EQUAL_C_INT(device.counter, decoded.counter);
+	CHECK_EQUAL_C_INT(device.fan.speed, decoded.fan.speed);
+	CHECK_EQUAL_C_INT(device.fan.oscillate, decoded.fan.oscillate);
+
+	IOT_DEBUG("-->Success - S:9 - Encoded state decodes to the same struct \n");
+}
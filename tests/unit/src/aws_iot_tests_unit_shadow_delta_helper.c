@@ -322,3 +322,53 @@ TEST_C(ShadowDeltaTest, DeltaVersionIgnoreOldVersion) {
 	aws_iot_shadow_yield(&client, 100);
 	CHECK_EQUAL_C_STRING(sentNestedObjectData, receivedNestedObject);
 }
+
+// Metadata that alone has more tokens than MAX_JSON_TOKEN_EXPECTED is skipped before tokenizing
+TEST_C(ShadowDeltaTest, DeltaLargeMetadataPruned) {
+	IoT_Error_t ret_val = SUCCESS;
+	jsonStruct_t intHandler;
+	int32_t intData = 0;
+	char deltaJSONString[SHADOW_MAX_SIZE_OF_RX_BUFFER];
+	size_t deltaLen;
+	uint32_t i;
+	IoT_Publish_Message_Params params;
+
+	IOT_DEBUG("\n-->Running Shadow Delta Tests - Delta with large metadata pruned \n");
+
+	intHandler.cb = NULL;
+	intHandler.pKey = "length_meta";
+	intHandler.type = SHADOW_JSON_INT32;
+	intHandler.pData = &intData;
+	intHandler.dataLength = sizeof(int32_t);
+
+	deltaLen = (size_t) snprintf(deltaJSONString, sizeof(deltaJSONString),
+								 "{\"state\":{\"delta\":{\"length_meta\":42}},\"metadata\":{\"ids\":[1");
+	for(i = 0; i < MAX_JSON_TOKEN_EXPECTED; i++) {
+		deltaLen += (size_t) snprintf(deltaJSONString + deltaLen, sizeof(deltaJSONString) - deltaLen, ",1");
+	}
+	snprintf(deltaJSONString + deltaLen, sizeof(deltaJSONString) - deltaLen, "]},\"version\":1}");
+
+	params.payloadLen = strlen(deltaJSONString);
+	params.payload = deltaJSONString;
+	params.qos = QOS0;
+
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params);
+
+	ret_val = aws_iot_shadow_register_delta(&client, &intHandler);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	aws_iot_shadow_disable_metadata_pruning();
+	ResetTLSBuffer();
+	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
+	aws_iot_shadow_yield(&client, 100);
+	CHECK_EQUAL_C_INT(0, intData);
+
+	aws_iot_shadow_enable_metadata_pruning();
+	ResetTLSBuffer();
+	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
+	aws_iot_shadow_yield(&client, 100);
+	CHECK_EQUAL_C_INT(42, intData);
+
+	IOT_DEBUG("-->Success - Delta with large metadata pruned \n");
+}
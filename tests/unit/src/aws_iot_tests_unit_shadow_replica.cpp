@@ -0,0 +1,48 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_shadow_replica.cpp
+ * @brief IoT Client Unit Testing - Shadow Replica Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(ShadowReplicaTests) {
+	TEST_GROUP_C_SETUP_WRAPPER(ShadowReplicaTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(ShadowReplicaTests)
+};
+
+/* R:1 - Init with invalid parameters and an empty block */
+TEST_GROUP_C_WRAPPER(ShadowReplicaTests, InitValidation)
+/* R:2 - Full document fills both sections */
+TEST_GROUP_C_WRAPPER(ShadowReplicaTests, FullDocumentApplied)
+/* R:3 - Documents message reports only the leaves that changed */
+TEST_GROUP_C_WRAPPER(ShadowReplicaTests, DocumentsReportChangedLeaves)
+/* R:4 - Stale, next and skipping deltas */
+TEST_GROUP_C_WRAPPER(ShadowReplicaTests, DeltaVersionOrdering)
+/* R:5 - Null removes a subtree and a leaf can become an object */
+TEST_GROUP_C_WRAPPER(ShadowReplicaTests, DeltaNullAndObjects)
+/* R:6 - Block kept across init, a corrupted block starts empty */
+TEST_GROUP_C_WRAPPER(ShadowReplicaTests, WarmAndColdStart)
+/* R:7 - Full block fails the message and asks for a GET */
+TEST_GROUP_C_WRAPPER(ShadowReplicaTests, StorageFull)
+/* R:8 - Replica kept in a mapped file */
+TEST_GROUP_C_WRAPPER(ShadowReplicaTests, MappedFileRoundTrip)
+/* R:9 - Documents and delta messages applied through the client */
+TEST_GROUP_C_WRAPPER(ShadowReplicaTests, MessagesThroughClient)
+/* R:10 - Application keys named like pruned members are kept in every message */
+TEST_GROUP_C_WRAPPER(ShadowReplicaTests, ApplicationKeysNamedLikeMetadata)
@@ -0,0 +1,463 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_shadow_replica_helper.c
+ * @brief IoT Client Unit Testing - Shadow Replica Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_shadow_interface.h"
+#include "aws_iot_shadow_replica.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+#undef AWS_IOT_MY_THING_NAME
+#define AWS_IOT_MY_THING_NAME "AWS-IoT-C-SDK"
+
+#define REPLICA_TEST_FILE "/tmp/aws_iot_tests_unit_shadow_replica.bin"
+
+#define REPLICA_TEST_FULL_DOCUMENT "{\"state\":{\"desired\":{\"light\":{\"color\":\"red\",\"on\":true}}," \
+	"\"reported\":{\"light\":{\"color\":\"blue\"},\"temp\":21}},\"metadata\":{\"desired\":{\"light\":{" \
+	"\"color\":{\"timestamp\":1},\"on\":{\"timestamp\":1}}}},\"version\":5,\"timestamp\":1}"
+
+static IoT_Shadow_Replica_t replica;
+static uint32_t replicaStorage[128];
+static uint32_t changeCount;
+static uint32_t removeCount;
+static char lastChangePath[AWS_IOT_SHADOW_REPLICA_MAX_PATH_LEN + 1];
+static char lastChangeValue[32];
+
+static AWS_IoT_Client client;
+static IoT_Client_Connect_Params connectParams;
+static ShadowInitParameters_t shadowInitParams;
+static ShadowConnectParameters_t shadowConnectParams;
+
+static void iot_replica_change_handler(ShadowReplicaSection_t section, const char *pPath, const char *pValue,
+									  size_t valueLen, void *pContext) {
+	IOT_UNUSED(section);
+	IOT_UNUSED(pContext);
+
+	snprintf(lastChangePath, sizeof(lastChangePath), "%s", pPath);
+	if(NULL == pValue) {
+		removeCount++;
+		lastChangeValue[0] = '\0';
+	} else {
+		changeCount++;
+		snprintf(lastChangeValue, sizeof(lastChangeValue), "%.*s", (int) valueLen, pValue);
+	}
+}
+
+static void resetChanges(void) {
+	changeCount = 0;
+	removeCount = 0;
+	lastChangePath[0] = '\0';
+	lastChangeValue[0] = '\0';
+}
+
+static IoT_Error_t applyFull(const char *pJson) {
+	return aws_iot_shadow_replica_apply_full(&replica, pJson, strlen(pJson));
+}
+
+static IoT_Error_t applyDelta(const char *pJson) {
+	return aws_iot_shadow_replica_apply_delta(&replica, pJson, strlen(pJson));
+}
+
+static bool isValue(ShadowReplicaSection_t section, const char *pPath, const char *pExpected) {
+	const char *pValue;
+	size_t valueLen;
+
+	if(!aws_iot_shadow_replica_get_value(&replica, section, pPath, &pValue, &valueLen)) {
+		return false;
+	}
+
+	return strlen(pExpected) == valueLen && 0 == strcmp(pExpected, pValue);
+}
+
+static bool isPresent(ShadowReplicaSection_t section, const char *pPath) {
+	const char *pValue;
+
+	return aws_iot_shadow_replica_get_value(&replica, section, pPath, &pValue, NULL);
+}
+
+TEST_GROUP_C_SETUP(ShadowReplicaTests) {
+	memset(replicaStorage, 0, sizeof(replicaStorage));
+	resetChanges();
+}
+
+TEST_GROUP_C_TEARDOWN(ShadowReplicaTests) {
+	unlink(REPLICA_TEST_FILE);
+}
+
+/* R:1 - Init with invalid parameters and an empty block */
+TEST_C(ShadowReplicaTests, InitValidation) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Shadow Replica Tests - Init with invalid parameters and an empty block \n");
+
+	rc = aws_iot_shadow_replica_init(NULL, replicaStorage, sizeof(replicaStorage), NULL, NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+	rc = aws_iot_shadow_replica_init(&replica, NULL, sizeof(replicaStorage), NULL, NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+	rc = aws_iot_shadow_replica_init(&replica, replicaStorage, 32, NULL, NULL);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, rc);
+
+	rc = aws_iot_shadow_replica_init(&replica, replicaStorage, sizeof(replicaStorage), NULL, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(false == replica.isWarmStart);
+	CHECK_C(false == aws_iot_shadow_replica_is_synchronized(&replica));
+	CHECK_EQUAL_C_INT(0, aws_iot_shadow_replica_get_version(&replica));
+	CHECK_C(false == isPresent(SHADOW_REPLICA_DESIRED, "light.color"));
+
+	IOT_DEBUG("-->Success - Init with invalid parameters and an empty block \n");
+}
+
+/* R:2 - Full document fills both sections */
+TEST_C(ShadowReplicaTests, FullDocumentApplied) {
+	IoT_Shadow_Replica_Stats_t stats;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Shadow Replica Tests - Full document fills both sections \n");
+
+	aws_iot_shadow_replica_init(&replica, replicaStorage, sizeof(replicaStorage), iot_replica_change_handler, NULL);
+	rc = applyFull(REPLICA_TEST_FULL_DOCUMENT);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	CHECK_EQUAL_C_INT(5, aws_iot_shadow_replica_get_version(&replica));
+	CHECK_C(aws_iot_shadow_replica_is_synchronized(&replica));
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "light.color", "\"red\""));
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "light.on", "true"));
+	CHECK_C(isValue(SHADOW_REPLICA_REPORTED, "light.color", "\"blue\""));
+	CHECK_C(isValue(SHADOW_REPLICA_REPORTED, "temp", "21"));
+	CHECK_C(false == isPresent(SHADOW_REPLICA_REPORTED, "light.on"));
+	CHECK_C(false == isPresent(SHADOW_REPLICA_DESIRED, "light.color.timestamp"));
+	CHECK_EQUAL_C_INT(4, changeCount);
+
+	/* The same document again changes nothing */
+	resetChanges();
+	rc = applyFull(REPLICA_TEST_FULL_DOCUMENT);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0, changeCount);
+	CHECK_EQUAL_C_INT(0, removeCount);
+
+	aws_iot_shadow_replica_get_stats(&replica, &stats);
+	CHECK_EQUAL_C_INT(2, stats.documentsApplied);
+	CHECK_EQUAL_C_INT(2 * strlen(REPLICA_TEST_FULL_DOCUMENT), stats.bytesReceived);
+
+	IOT_DEBUG("-->Success - Full document fills both sections \n");
+}
+
+/* R:3 - Documents message reports only the leaves that changed */
+TEST_C(ShadowReplicaTests, DocumentsReportChangedLeaves) {
+	char documents[] = "{\"previous\":{\"state\":{\"desired\":{\"light\":{\"color\":\"red\",\"on\":true}}},"
+		"\"version\":5},\"current\":{\"state\":{\"desired\":{\"light\":{\"color\":\"green\"}},"
+		"\"reported\":{\"light\":{\"color\":\"blue\"},\"temp\":21}},\"version\":6},\"timestamp\":2}";
+	char oldDocuments[] = "{\"current\":{\"state\":{\"desired\":{}},\"version\":4}}";
+	IoT_Shadow_Replica_Stats_t stats;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Shadow Replica Tests - Documents message reports only the leaves that changed \n");
+
+	aws_iot_shadow_replica_init(&replica, replicaStorage, sizeof(replicaStorage), iot_replica_change_handler, NULL);
+	applyFull(REPLICA_TEST_FULL_DOCUMENT);
+	resetChanges();
+
+	rc = aws_iot_shadow_replica_apply_documents(&replica, documents, strlen(documents));
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(6, aws_iot_shadow_replica_get_version(&replica));
+	CHECK_EQUAL_C_INT(1, changeCount);
+	CHECK_EQUAL_C_INT(1, removeCount);
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "light.color", "\"green\""));
+	CHECK_C(false == isPresent(SHADOW_REPLICA_DESIRED, "light.on"));
+	CHECK_C(isValue(SHADOW_REPLICA_REPORTED, "temp", "21"));
+
+	resetChanges();
+	rc = aws_iot_shadow_replica_apply_documents(&replica, oldDocuments, strlen(oldDocuments));
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(6, aws_iot_shadow_replica_get_version(&replica));
+	CHECK_EQUAL_C_INT(0, removeCount);
+
+	aws_iot_shadow_replica_get_stats(&replica, &stats);
+	CHECK_EQUAL_C_INT(1, stats.staleDiscarded);
+
+	IOT_DEBUG("-->Success - Documents message reports only the leaves that changed \n");
+}
+
+/* R:4 - Stale, next and skipping deltas */
+TEST_C(ShadowReplicaTests, DeltaVersionOrdering) {
+	IoT_Shadow_Replica_Stats_t stats;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Shadow Replica Tests - Stale, next and skipping deltas \n");
+
+	aws_iot_shadow_replica_init(&replica, replicaStorage, sizeof(replicaStorage), iot_replica_change_handler, NULL);
+	applyFull(REPLICA_TEST_FULL_DOCUMENT);
+	resetChanges();
+
+	rc = applyDelta("{\"version\":5,\"state\":{\"light\":{\"color\":\"white\"}}}");
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "light.color", "\"red\""));
+	CHECK_EQUAL_C_INT(0, changeCount);
+
+	rc = applyDelta("{\"version\":6,\"state\":{\"light\":{\"color\":\"green\"}}}");
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "light.color", "\"green\""));
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "light.on", "true"));
+	CHECK_EQUAL_C_INT(6, aws_iot_shadow_replica_get_version(&replica));
+	CHECK_EQUAL_C_INT(1, changeCount);
+	CHECK_C(aws_iot_shadow_replica_is_synchronized(&replica));
+
+	rc = applyDelta("{\"version\":9,\"state\":{\"light\":{\"on\":false}}}");
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "light.on", "false"));
+	CHECK_EQUAL_C_INT(9, aws_iot_shadow_replica_get_version(&replica));
+	CHECK_C(false == aws_iot_shadow_replica_is_synchronized(&replica));
+
+	aws_iot_shadow_replica_get_stats(&replica, &stats);
+	CHECK_EQUAL_C_INT(1, stats.staleDiscarded);
+	CHECK_EQUAL_C_INT(2, stats.deltasApplied);
+	CHECK_EQUAL_C_INT(1, stats.versionGaps);
+
+	/* The GET answer replaces the replica even though it is not newer */
+	rc = applyFull(REPLICA_TEST_FULL_DOCUMENT);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(5, aws_iot_shadow_replica_get_version(&replica));
+	CHECK_C(aws_iot_shadow_replica_is_synchronized(&replica));
+
+	IOT_DEBUG("-->Success - Stale, next and skipping deltas \n");
+}
+
+/* R:5 - Null removes a subtree and a leaf can become an object */
+TEST_C(ShadowReplicaTests, DeltaNullAndObjects) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Shadow Replica Tests - Null removes a subtree and a leaf can become an object \n");
+
+	aws_iot_shadow_replica_init(&replica, replicaStorage, sizeof(replicaStorage), iot_replica_change_handler, NULL);
+	applyFull(REPLICA_TEST_FULL_DOCUMENT);
+	resetChanges();
+
+	rc = applyDelta("{\"version\":6,\"state\":{\"light\":null,\"fan\":3}}");
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(2, removeCount);
+	CHECK_C(false == isPresent(SHADOW_REPLICA_DESIRED, "light.color"));
+	CHECK_C(false == isPresent(SHADOW_REPLICA_DESIRED, "light.on"));
+	CHECK_C(isValue(SHADOW_REPLICA_REPORTED, "light.color", "\"blue\""));
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "fan", "3"));
+
+	resetChanges();
+	rc = applyDelta("{\"version\":7,\"state\":{\"fan\":{\"speed\":2,\"mode\":\"auto\"}}}");
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, removeCount);
+	CHECK_EQUAL_C_INT(2, changeCount);
+	CHECK_C(false == isPresent(SHADOW_REPLICA_DESIRED, "fan"));
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "fan.speed", "2"));
+
+	resetChanges();
+	rc = applyDelta("{\"version\":8,\"state\":{\"fan\":1}}");
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(2, removeCount);
+	CHECK_C(false == isPresent(SHADOW_REPLICA_DESIRED, "fan.mode"));
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "fan", "1"));
+
+	IOT_DEBUG("-->Success - Null removes a subtree and a leaf can become an object \n");
+}
+
+/* R:6 - Block kept across init, a corrupted block starts empty */
+TEST_C(ShadowReplicaTests, WarmAndColdStart) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Shadow Replica Tests - Block kept across init, a corrupted block starts empty \n");
+
+	aws_iot_shadow_replica_init(&replica, replicaStorage, sizeof(replicaStorage), NULL, NULL);
+	applyFull(REPLICA_TEST_FULL_DOCUMENT);
+
+	rc = aws_iot_shadow_replica_init(&replica, replicaStorage, sizeof(replicaStorage), NULL, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(replica.isWarmStart);
+	CHECK_C(aws_iot_shadow_replica_is_synchronized(&replica));
+	CHECK_EQUAL_C_INT(5, aws_iot_shadow_replica_get_version(&replica));
+	CHECK_C(isValue(SHADOW_REPLICA_REPORTED, "temp", "21"));
+
+	/* A block of another size is not trusted */
+	rc = aws_iot_shadow_replica_init(&replica, replicaStorage, sizeof(replicaStorage) - 4, NULL, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(false == replica.isWarmStart);
+
+	aws_iot_shadow_replica_init(&replica, replicaStorage, sizeof(replicaStorage), NULL, NULL);
+	applyFull(REPLICA_TEST_FULL_DOCUMENT);
+	((unsigned char *) replicaStorage)[40] ^= 0x20;
+	rc = aws_iot_shadow_replica_init(&replica, replicaStorage, sizeof(replicaStorage), NULL, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(false == replica.isWarmStart);
+	CHECK_C(false == aws_iot_shadow_replica_is_synchronized(&replica));
+	CHECK_EQUAL_C_INT(0, aws_iot_shadow_replica_get_version(&replica));
+	CHECK_C(false == isPresent(SHADOW_REPLICA_REPORTED, "temp"));
+
+	IOT_DEBUG("-->Success - Block kept across init, a corrupted block starts empty \n");
+}
+
+/* R:7 - Full block fails the message and asks for a GET */
+TEST_C(ShadowReplicaTests, StorageFull) {
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Shadow Replica Tests - Full block fails the message and asks for a GET \n");
+
+	aws_iot_shadow_replica_init(&replica, replicaStorage, 80, NULL, NULL);
+	rc = applyFull(REPLICA_TEST_FULL_DOCUMENT);
+	CHECK_EQUAL_C_INT(LIMIT_EXCEEDED_ERROR, rc);
+	CHECK_C(false == aws_iot_shadow_replica_is_synchronized(&replica));
+
+	/* The block is still consistent */
+	rc = aws_iot_shadow_replica_init(&replica, replicaStorage, 80, NULL, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	IOT_DEBUG("-->Success - Full block fails the message and asks for a GET \n");
+}
+
+/* R:8 - Replica kept in a mapped file */
+TEST_C(ShadowReplicaTests, MappedFileRoundTrip) {
+	void *pStorage = NULL;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Shadow Replica Tests - Replica kept in a mapped file \n");
+
+	unlink(REPLICA_TEST_FILE);
+	rc = aws_iot_shadow_replica_map_file(REPLICA_TEST_FILE, 4096, &pStorage);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	aws_iot_shadow_replica_init(&replica, pStorage, 4096, NULL, NULL);
+	CHECK_C(false == replica.isWarmStart);
+	applyFull(REPLICA_TEST_FULL_DOCUMENT);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_replica_flush_file(pStorage, 4096));
+	aws_iot_shadow_replica_unmap_file(pStorage, 4096);
+
+	rc = aws_iot_shadow_replica_map_file(REPLICA_TEST_FILE, 4096, &pStorage);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	aws_iot_shadow_replica_init(&replica, pStorage, 4096, NULL, NULL);
+	CHECK_C(replica.isWarmStart);
+	CHECK_EQUAL_C_INT(5, aws_iot_shadow_replica_get_version(&replica));
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "light.on", "true"));
+	aws_iot_shadow_replica_unmap_file(pStorage, 4096);
+
+	IOT_DEBUG("-->Success - Replica kept in a mapped file \n");
+}
+
+/* R:9 - Documents and delta messages applied through the client */
+TEST_C(ShadowReplicaTests, MessagesThroughClient) {
+	char documentsTopic[MAX_SHADOW_TOPIC_LENGTH_BYTES];
+	char deltaTopic[MAX_SHADOW_TOPIC_LENGTH_BYTES];
+	char documents[] = "{\"current\":{\"state\":{\"desired\":{\"mode\":\"eco\"},\"reported\":{\"mode\":\"eco\"}},"
+		"\"version\":3}}";
+	char delta[] = "{\"version\":4,\"state\":{\"mode\":\"boost\"}}";
+	IoT_Publish_Message_Params params;
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Shadow Replica Tests - Documents and delta messages applied through the client \n");
+
+	shadowInitParams.pHost = AWS_IOT_MQTT_HOST;
+	shadowInitParams.port = AWS_IOT_MQTT_PORT;
+	shadowInitParams.pClientCRT = AWS_IOT_CERTIFICATE_FILENAME;
+	shadowInitParams.pRootCA = AWS_IOT_ROOT_CA_FILENAME;
+	shadowInitParams.pClientKey = AWS_IOT_PRIVATE_KEY_FILENAME;
+	shadowInitParams.disconnectHandler = NULL;
+	shadowInitParams.enableAutoReconnect = false;
+	rc = aws_iot_shadow_init(&client, &shadowInitParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	shadowConnectParams.pMyThingName = AWS_IOT_MY_THING_NAME;
+	shadowConnectParams.pMqttClientId = AWS_IOT_MQTT_CLIENT_ID;
+	shadowConnectParams.mqttClientIdLen = (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID);
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	ResetTLSBuffer();
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_shadow_connect(&client, &shadowConnectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	snprintf(documentsTopic, sizeof(documentsTopic), "$aws/things/%s/shadow/update/documents", AWS_IOT_MY_THING_NAME);
+	snprintf(deltaTopic, sizeof(deltaTopic), "$aws/things/%s/shadow/update/delta", AWS_IOT_MY_THING_NAME);
+	aws_iot_shadow_replica_init(&replica, replicaStorage, sizeof(replicaStorage), iot_replica_change_handler, NULL);
+
+	/* One SUBACK for the documents topic and one for the delta topic */
+	params.qos = QOS1;
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback(documentsTopic, strlen(documentsTopic), QOS1, params);
+	memcpy(RxBuffer.pBuffer + RxBuffer.len, RxBuffer.pBuffer, RxBuffer.len);
+	RxBuffer.len *= 2;
+	rc = aws_iot_shadow_replica_start(&client, &replica);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	params.payload = documents;
+	params.payloadLen = strlen(documents);
+	ResetTLSBuffer();
+	setTLSRxBufferWithMsgOnSubscribedTopic(documentsTopic, strlen(documentsTopic), QOS1, params, documents);
+	rc = aws_iot_shadow_yield(&client, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(3, aws_iot_shadow_replica_get_version(&replica));
+	CHECK_C(isValue(SHADOW_REPLICA_REPORTED, "mode", "\"eco\""));
+	CHECK_C(aws_iot_shadow_replica_is_synchronized(&replica));
+
+	params.qos = QOS0;
+	params.payload = delta;
+	params.payloadLen = strlen(delta);
+	ResetTLSBuffer();
+	setTLSRxBufferWithMsgOnSubscribedTopic(deltaTopic, strlen(deltaTopic), QOS0, params, delta);
+	rc = aws_iot_shadow_yield(&client, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(4, aws_iot_shadow_replica_get_version(&replica));
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "mode", "\"boost\""));
+	CHECK_C(isValue(SHADOW_REPLICA_REPORTED, "mode", "\"eco\""));
+
+	IOT_DEBUG("-->Success - Documents and delta messages applied through the client \n");
+}
+
+/* R:10 - Application keys named like pruned members are kept in every message */
+TEST_C(ShadowReplicaTests, ApplicationKeysNamedLikeMetadata) {
+	char full[] = "{\"state\":{\"desired\":{\"previous\":1,\"metadata\":{\"a\":2}}},"
+		"\"metadata\":{\"desired\":{\"previous\":{\"timestamp\":1}}},\"version\":5}";
+	char delta[] = "{\"version\":6,\"state\":{\"previous\":3,\"metadata\":{\"a\":4}},"
+		"\"metadata\":{\"previous\":{\"timestamp\":2}}}";
+	char documents[] = "{\"previous\":{\"state\":{\"desired\":{\"previous\":3}},\"version\":6},"
+		"\"current\":{\"state\":{\"desired\":{\"previous\":5,\"metadata\":{\"a\":6}}},"
+		"\"metadata\":{\"desired\":{\"previous\":{\"timestamp\":3}}},\"version\":7}}";
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Shadow Replica Tests - Application keys named like pruned members are kept in every message \n");
+
+	aws_iot_shadow_replica_init(&replica, replicaStorage, sizeof(replicaStorage), iot_replica_change_handler, NULL);
+	rc = applyFull(full);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "previous", "1"));
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "metadata.a", "2"));
+
+	rc = applyDelta(delta);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(6, aws_iot_shadow_replica_get_version(&replica));
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "previous", "3"));
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "metadata.a", "4"));
+	CHECK_C(false == isPresent(SHADOW_REPLICA_DESIRED, "previous.timestamp"));
+
+	rc = aws_iot_shadow_replica_apply_documents(&replica, documents, strlen(documents));
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(7, aws_iot_shadow_replica_get_version(&replica));
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "previous", "5"));
+	CHECK_C(isValue(SHADOW_REPLICA_DESIRED, "metadata.a", "6"));
+
+	IOT_DEBUG("-->Success - Application keys named like pruned members are kept in every message \n");
+}
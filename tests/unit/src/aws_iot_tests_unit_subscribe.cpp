@@ -77,3 +77,14 @@ TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeTopicHashkeyMustBeTheLastFail)
 TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeTopicWithPluskeySuccess)
 /* C:22 - Subscribe with '+' as last character in topic name, Success */
 TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeTopicPluskeyComesLastSuccess)
+
+/* C:23 - Subscribe, more topics than built-in handlers with a store from an arena */
+TEST_GROUP_C_WRAPPER(SubscribeTests, SubscribeBeyondBuiltInHandlersFromArena)
+/* C:24 - Subscribe to a topic and to a wildcard covering it, message reaches both handlers */
+TEST_GROUP_C_WRAPPER(SubscribeTests, SubscribeExactAndWildcardBothDelivered)
+/* C:25 - Init with a subscription store that does not fit in the arena */
+TEST_GROUP_C_WRAPPER(SubscribeTests, InitSubscriptionStoreArenaTooSmall)
+/* C:26 - Wildcard handler unsubscribing itself from its callback, the other wildcard handlers still get the message */
+TEST_GROUP_C_WRAPPER(SubscribeTests, UnsubscribeWildcardInsideCallback)
+/* C:27 - Slot removed during a match is not reused before the match ends */
+TEST_GROUP_C_WRAPPER(SubscribeTests, RemovedSlotNotReusedDuringMatch)
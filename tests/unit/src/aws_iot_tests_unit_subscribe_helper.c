@@ -23,6 +23,7 @@
 #include <CppUTest/TestHarness_c.h>
 
 #include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_mqtt_client_common_internal.h"
 #include "aws_iot_log.h"
 
 static IoT_Client_Init_Params initParams;
@@ -604,3 +605,220 @@ TEST_C(SubscribeTests, subscribeTopicPluskeyComesLastSuccess) {
 
 	IOT_DEBUG("-->Success - C:22 - Subscribe with '+' as last character in topic name, Success \n");
 }
+
+/* C:23 - Subscribe, more topics than built-in handlers with a store from an arena */
+TEST_C(SubscribeTests, SubscribeBeyondBuiltInHandlersFromArena) {
+	IoT_Error_t rc = SUCCESS;
+	static unsigned char storeMemory[4096];
+	static char topics[3 * AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS + 1][12];
+	IoT_Arena_t storeArena;
+	char expectedCallbackString[100] = "Message on the last topic";
+	int i;
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:23 - Subscribe, more topics than built-in handlers with a store from an arena \n");
+
+	rc = aws_iot_arena_init(&storeArena, storeMemory, sizeof(storeMemory));
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	initParams.maxSubscriptions = 3 * AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS;
+	initParams.pSubscriptionArena = &storeArena;
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	initParams.maxSubscriptions = 0;
+	initParams.pSubscriptionArena = NULL;
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ResetTLSBuffer();
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	for(i = 0; i < 3 * AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; i++) {
+		snprintf(topics[i], 12, "sdk/Test%d", i);
+		setTLSRxBufferForSuback(topics[i], strlen(topics[i]), QOS1, testPubMsgParams);
+		rc = aws_iot_mqtt_subscribe(&iotClient, topics[i], (uint16_t) strlen(topics[i]), QOS1,
+									iot_subscribe_callback_handler, NULL);
+		CHECK_EQUAL_C_INT(SUCCESS, rc);
+	}
+
+	snprintf(topics[i], 12, "sdk/Test%d", i);
+	setTLSRxBufferForSuback(topics[i], strlen(topics[i]), QOS1, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, topics[i], (uint16_t) strlen(topics[i]), QOS1,
+								iot_subscribe_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR, rc);
+
+	ResetTLSBuffer();
+	setTLSRxBufferWithMsgOnSubscribedTopic(topics[i - 1], strlen(topics[i - 1]), QOS1, testPubMsgParams,
+										   expectedCallbackString);
+	snprintf(CallbackMsgString, 100, "NOT_VISITED");
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING(expectedCallbackString, CallbackMsgString);
+
+	IOT_DEBUG("-->Success - C:23 - Subscribe, more topics than built-in handlers with a store from an arena \n");
+}
+
+/* C:24 - Subscribe to a topic and to a wildcard covering it, message reaches both handlers */
+TEST_C(SubscribeTests, SubscribeExactAndWildcardBothDelivered) {
+	IoT_Error_t rc = SUCCESS;
+	char expectedCallbackString[100] = "Message for both";
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:24 - Subscribe to a topic and to a wildcard covering it \n");
+
+	setTLSRxBufferForSuback("sdk/Test/foo", strlen("sdk/Test/foo"), QOS1, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, "sdk/Test/foo", strlen("sdk/Test/foo"), QOS1,
+								iot_subscribe_callback_handler1, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	setTLSRxBufferForSuback("sdk/Test/+", strlen("sdk/Test/+"), QOS1, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, "sdk/Test/+", strlen("sdk/Test/+"), QOS1,
+								iot_subscribe_callback_handler2, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	snprintf(CallbackMsgString1, 100, "NOT_VISITED");
+	snprintf(CallbackMsgString2, 100, "NOT_VISITED");
+	setTLSRxBufferWithMsgOnSubscribedTopic("sdk/Test/foo", strlen("sdk/Test/foo"), QOS1, testPubMsgParams,
+										   expectedCallbackString);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING(expectedCallbackString, CallbackMsgString1);
+	CHECK_EQUAL_C_STRING(expectedCallbackString, CallbackMsgString2);
+
+	IOT_DEBUG("-->Success - C:24 - Subscribe to a topic and to a wildcard covering it \n");
+}
+
+/* C:25 - Init with a subscription store that does not fit in the arena */
+TEST_C(SubscribeTests, InitSubscriptionStoreArenaTooSmall) {
+	IoT_Error_t rc = SUCCESS;
+	static unsigned char storeMemory[64];
+	IoT_Arena_t storeArena;
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:25 - Init with a subscription store that does not fit in the arena \n");
+
+	initParams.maxSubscriptions = 100;
+	initParams.pSubscriptionArena = NULL;
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	rc = aws_iot_arena_init(&storeArena, storeMemory, sizeof(storeMemory));
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	initParams.pSubscriptionArena = &storeArena;
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	initParams.maxSubscriptions = 0;
+	initParams.pSubscriptionArena = NULL;
+	CHECK_EQUAL_C_INT(ARENA_EXHAUSTED_ERROR, rc);
+
+	IOT_DEBUG("-->Success - C:25 - Init with a subscription store that does not fit in the arena \n");
+}
+
+static uint32_t wildcardCallbackCounts[3];
+
+static void iot_subscribe_callback_unsubscribe_self(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+													IoT_Publish_Message_Params *params, void *pData) {
+	IOT_UNUSED(topicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(params);
+	IOT_UNUSED(pData);
+
+	wildcardCallbackCounts[0]++;
+	setTLSRxBufferForUnsuback();
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_unsubscribe(pClient, "a/+", 3));
+}
+
+static void iot_subscribe_callback_count(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+										 IoT_Publish_Message_Params *params, void *pData) {
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(topicName);
+	IOT_UNUSED(topicNameLen);
+	IOT_UNUSED(params);
+
+	(*(uint32_t *) pData)++;
+}
+
+/* C:26 - Wildcard handler unsubscribing itself from its callback, the other wildcard handlers still get the message */
+TEST_C(SubscribeTests, UnsubscribeWildcardInsideCallback) {
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:26 - Wildcard handler unsubscribing itself from its callback \n");
+
+	memset(wildcardCallbackCounts, 0, sizeof(wildcardCallbackCounts));
+	setTLSRxBufferForSuback("a/+", strlen("a/+"), QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, "a/+", strlen("a/+"), QOS0, iot_subscribe_callback_unsubscribe_self, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	setTLSRxBufferForSuback("+/b", strlen("+/b"), QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, "+/b", strlen("+/b"), QOS0, iot_subscribe_callback_count,
+								&wildcardCallbackCounts[1]);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	setTLSRxBufferForSuback("#", strlen("#"), QOS0, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, "#", strlen("#"), QOS0, iot_subscribe_callback_count,
+								&wildcardCallbackCounts[2]);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	testPubMsgParams.qos = QOS0;
+	setTLSRxBufferWithMsgOnSubscribedTopic("a/b", strlen("a/b"), QOS0, testPubMsgParams, "first");
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, wildcardCallbackCounts[0]);
+	CHECK_EQUAL_C_INT(1, wildcardCallbackCounts[1]);
+	CHECK_EQUAL_C_INT(1, wildcardCallbackCounts[2]);
+	CHECK_C(NULL == aws_iot_mqtt_internal_subscription_store_find(&(iotClient.clientData.subscriptions), "a/+", 3));
+
+	/* The removed entry is gone once the delivery is over */
+	CHECK_EQUAL_C_INT(2, iotClient.clientData.subscriptions.wildcardCount);
+	setTLSRxBufferWithMsgOnSubscribedTopic("a/b", strlen("a/b"), QOS0, testPubMsgParams, "second");
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, wildcardCallbackCounts[0]);
+	CHECK_EQUAL_C_INT(2, wildcardCallbackCounts[1]);
+	CHECK_EQUAL_C_INT(2, wildcardCallbackCounts[2]);
+
+	IOT_DEBUG("-->Success - C:26 - Wildcard handler unsubscribing itself from its callback \n");
+}
+
+/* C:27 - Slot removed during a match is not reused before the match ends */
+TEST_C(SubscribeTests, RemovedSlotNotReusedDuringMatch) {
+	MessageHandlers handlers[4];
+	uint32_t links[4 * AWS_IOT_MQTT_SUBSCRIPTION_LINKS_PER_HANDLER];
+	uint32_t bucket;
+	SubscriptionStore store;
+	SubscriptionMatchCursor cursor;
+	MessageHandlers handler;
+	MessageHandlers *pFirst, *pRemoved, *pLast, *pAdded, *pMatch;
+	char topic[] = "t";
+	IoT_Error_t rc;
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:27 - Slot removed during a match is not reused before the match ends \n");
+
+	/* One bucket, so every handler is in the same chain */
+	rc = aws_iot_mqtt_internal_subscription_store_init(&store, handlers, 4, links, &bucket, 1);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	memset(&handler, 0, sizeof(handler));
+	handler.topicName = "t";
+	handler.topicNameLen = 1;
+	pLast = aws_iot_mqtt_internal_subscription_store_add(&store, &handler);
+	handler.topicName = "a";
+	pRemoved = aws_iot_mqtt_internal_subscription_store_add(&store, &handler);
+	handler.topicName = "t";
+	pFirst = aws_iot_mqtt_internal_subscription_store_add(&store, &handler);
+	CHECK_C(NULL != pLast && NULL != pRemoved && NULL != pFirst);
+
+	/* The chain is pFirst, pRemoved, pLast. A callback of pFirst removes the handler the cursor
+	 * follows next and adds another one, which must not relink that slot */
+	aws_iot_mqtt_internal_subscription_store_match_begin(&store, topic, 1, &cursor);
+	pMatch = aws_iot_mqtt_internal_subscription_store_match_next(&store, topic, 1, &cursor);
+	CHECK_C(pFirst == pMatch);
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_internal_subscription_store_remove(&store, "a", 1));
+	handler.topicName = "c";
+	pAdded = aws_iot_mqtt_internal_subscription_store_add(&store, &handler);
+	CHECK_C(NULL != pAdded && pRemoved != pAdded);
+	CHECK_C(aws_iot_mqtt_internal_subscription_store_is_full(&store));
+	pMatch = aws_iot_mqtt_internal_subscription_store_match_next(&store, topic, 1, &cursor);
+	CHECK_C(pLast == pMatch);
+	CHECK_C(NULL == aws_iot_mqtt_internal_subscription_store_match_next(&store, topic, 1, &cursor));
+	aws_iot_mqtt_internal_subscription_store_match_end(&store);
+
+	/* The slot is back in the pool once the match is over */
+	CHECK_C(!aws_iot_mqtt_internal_subscription_store_is_full(&store));
+	handler.topicName = "d";
+	CHECK_C(pRemoved == aws_iot_mqtt_internal_subscription_store_add(&store, &handler));
+
+	IOT_DEBUG("-->Success - C:27 - Slot removed during a match is not reused before the match ends \n");
+}
@@ -0,0 +1,40 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_threads.cpp
+ * @brief IoT Client Unit Testing - pthread Wrapper Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(ThreadsTests) {
+	TEST_GROUP_C_SETUP_WRAPPER(ThreadsTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(ThreadsTests)
+};
+
+/* T:1 - Condition variable timed wait expires */
+TEST_GROUP_C_WRAPPER(ThreadsTests, CondTimedWaitExpires)
+/* T:2 - Condition variable wakes a waiter signaled from another thread */
+TEST_GROUP_C_WRAPPER(ThreadsTests, CondSignalWakesWaiter)
+/* T:3 - Semaphore posted before the wait */
+TEST_GROUP_C_WRAPPER(ThreadsTests, SemaphorePostBeforeWait)
+/* T:4 - Semaphore count limits */
+TEST_GROUP_C_WRAPPER(ThreadsTests, SemaphoreCountLimits)
+/* T:5 - Event set before the wait stays set until cleared */
+TEST_GROUP_C_WRAPPER(ThreadsTests, EventSetBeforeWait)
+/* T:6 - Thread ID is only current on the thread that got it */
+TEST_GROUP_C_WRAPPER(ThreadsTests, ThreadIdIsCurrent)
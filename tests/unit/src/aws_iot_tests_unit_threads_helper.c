@@ -0,0 +1,221 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_threads_helper.c
+ * @brief IoT Client Unit Testing - pthread Wrapper Tests Helper
+ *
+ * The unit tests build the client without thread support. The Makefile builds the pthread
+ * wrapper with _ENABLE_THREAD_SUPPORT_, and this file defines it to get the declarations.
+ */
+
+#define _ENABLE_THREAD_SUPPORT_
+
+#include <stdint.h>
+#include <pthread.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "threads_interface.h"
+#include "timer_interface.h"
+#include "aws_iot_log.h"
+
+#define THREADS_TEST_SHORT_WAIT_MS 20
+#define THREADS_TEST_LONG_WAIT_MS 2000
+
+static IoT_Mutex_t mutex;
+static IoT_Cond_t cond;
+static IoT_Semaphore_t semaphore;
+static IoT_Event_t event;
+static IoT_Thread_Id_t threadId;
+static bool isConditionMet;
+
+static void *condSignalThread(void *pArg) {
+	IOT_UNUSED(pArg);
+	aws_iot_thread_mutex_lock(&mutex);
+	isConditionMet = true;
+	aws_iot_thread_cond_signal(&cond);
+	aws_iot_thread_mutex_unlock(&mutex);
+	return NULL;
+}
+
+static void *semaphorePostThread(void *pArg) {
+	IOT_UNUSED(pArg);
+	aws_iot_thread_semaphore_post(&semaphore);
+	return NULL;
+}
+
+static void *eventSetThread(void *pArg) {
+	IOT_UNUSED(pArg);
+	aws_iot_thread_event_set(&event);
+	return NULL;
+}
+
+static void *threadIdCheckThread(void *pArg) {
+	IOT_UNUSED(pArg);
+	isConditionMet = aws_iot_thread_id_is_current(&threadId);
+	return NULL;
+}
+
+TEST_GROUP_C_SETUP(ThreadsTests) {
+	isConditionMet = false;
+}
+
+TEST_GROUP_C_TEARDOWN(ThreadsTests) { }
+
+/* T:1 - Condition variable timed wait expires */
+TEST_C(ThreadsTests, CondTimedWaitExpires) {
+	Timer timer;
+
+	IOT_DEBUG("-->Running Threads Tests - T:1 - Condition variable timed wait expires \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_mutex_init(&mutex));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_cond_init(&cond));
+
+	/* A signal with no waiter is lost, the wait still runs until the timeout */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_cond_signal(&cond));
+	init_timer(&timer);
+	countdown_ms(&timer, THREADS_TEST_SHORT_WAIT_MS);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_mutex_lock(&mutex));
+	CHECK_EQUAL_C_INT(THREAD_WAIT_TIMEOUT_ERROR, aws_iot_thread_cond_timedwait(&cond, &mutex, THREADS_TEST_SHORT_WAIT_MS));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_mutex_unlock(&mutex));
+	CHECK_C(has_timer_expired(&timer));
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_cond_destroy(&cond));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_mutex_destroy(&mutex));
+
+	IOT_DEBUG("-->Success - T:1 - Condition variable timed wait expires \n");
+}
+
+/* T:2 - Condition variable wakes a waiter signaled from another thread */
+TEST_C(ThreadsTests, CondSignalWakesWaiter) {
+	pthread_t thread;
+	IoT_Error_t rc = SUCCESS;
+
+	IOT_DEBUG("-->Running Threads Tests - T:2 - Condition variable wakes a waiter signaled from another thread \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_mutex_init(&mutex));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_cond_init(&cond));
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_mutex_lock(&mutex));
+	CHECK_EQUAL_C_INT(0, pthread_create(&thread, NULL, condSignalThread, NULL));
+	while(!isConditionMet && SUCCESS == rc) {
+		rc = aws_iot_thread_cond_timedwait(&cond, &mutex, THREADS_TEST_LONG_WAIT_MS);
+	}
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_C(isConditionMet);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_mutex_unlock(&mutex));
+	pthread_join(thread, NULL);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_cond_destroy(&cond));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_mutex_destroy(&mutex));
+
+	IOT_DEBUG("-->Success - T:2 - Condition variable wakes a waiter signaled from another thread \n");
+}
+
+/* T:3 - Semaphore posted before the wait */
+TEST_C(ThreadsTests, SemaphorePostBeforeWait) {
+	pthread_t thread;
+	Timer timer;
+
+	IOT_DEBUG("-->Running Threads Tests - T:3 - Semaphore posted before the wait \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_semaphore_init(&semaphore, 0));
+	CHECK_EQUAL_C_INT(THREAD_WAIT_TIMEOUT_ERROR, aws_iot_thread_semaphore_wait(&semaphore, 0));
+
+	/* The post is kept until a wait takes it */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_semaphore_post(&semaphore));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_semaphore_wait(&semaphore, 0));
+
+	init_timer(&timer);
+	countdown_ms(&timer, THREADS_TEST_SHORT_WAIT_MS);
+	CHECK_EQUAL_C_INT(THREAD_WAIT_TIMEOUT_ERROR, aws_iot_thread_semaphore_wait(&semaphore, THREADS_TEST_SHORT_WAIT_MS));
+	CHECK_C(has_timer_expired(&timer));
+
+	CHECK_EQUAL_C_INT(0, pthread_create(&thread, NULL, semaphorePostThread, NULL));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_semaphore_wait(&semaphore, THREADS_TEST_LONG_WAIT_MS));
+	pthread_join(thread, NULL);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_semaphore_destroy(&semaphore));
+
+	IOT_DEBUG("-->Success - T:3 - Semaphore posted before the wait \n");
+}
+
+/* T:4 - Semaphore count limits */
+TEST_C(ThreadsTests, SemaphoreCountLimits) {
+	IOT_DEBUG("-->Running Threads Tests - T:4 - Semaphore count limits \n");
+
+	/* The initial count is taken exactly that many times */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_semaphore_init(&semaphore, 2));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_semaphore_wait(&semaphore, 0));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_semaphore_wait(&semaphore, 0));
+	CHECK_EQUAL_C_INT(THREAD_WAIT_TIMEOUT_ERROR, aws_iot_thread_semaphore_wait(&semaphore, 0));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_semaphore_destroy(&semaphore));
+
+	/* A post at the largest count fails instead of wrapping to 0 */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_semaphore_init(&semaphore, UINT32_MAX));
+	CHECK_EQUAL_C_INT(LIMIT_EXCEEDED_ERROR, aws_iot_thread_semaphore_post(&semaphore));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_semaphore_wait(&semaphore, 0));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_semaphore_post(&semaphore));
+	CHECK_EQUAL_C_INT(LIMIT_EXCEEDED_ERROR, aws_iot_thread_semaphore_post(&semaphore));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_semaphore_destroy(&semaphore));
+
+	IOT_DEBUG("-->Success - T:4 - Semaphore count limits \n");
+}
+
+/* T:5 - Event set before the wait stays set until cleared */
+TEST_C(ThreadsTests, EventSetBeforeWait) {
+	pthread_t thread;
+	Timer timer;
+
+	IOT_DEBUG("-->Running Threads Tests - T:5 - Event set before the wait stays set until cleared \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_event_init(&event));
+	CHECK_EQUAL_C_INT(THREAD_WAIT_TIMEOUT_ERROR, aws_iot_thread_event_wait(&event, 0));
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_event_set(&event));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_event_wait(&event, 0));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_event_wait(&event, THREADS_TEST_SHORT_WAIT_MS));
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_event_clear(&event));
+	init_timer(&timer);
+	countdown_ms(&timer, THREADS_TEST_SHORT_WAIT_MS);
+	CHECK_EQUAL_C_INT(THREAD_WAIT_TIMEOUT_ERROR, aws_iot_thread_event_wait(&event, THREADS_TEST_SHORT_WAIT_MS));
+	CHECK_C(has_timer_expired(&timer));
+
+	CHECK_EQUAL_C_INT(0, pthread_create(&thread, NULL, eventSetThread, NULL));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_event_wait(&event, THREADS_TEST_LONG_WAIT_MS));
+	pthread_join(thread, NULL);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_thread_event_destroy(&event));
+
+	IOT_DEBUG("-->Success - T:5 - Event set before the wait stays set until cleared \n");
+}
+
+/* T:6 - Thread ID is only current on the thread that got it */
+TEST_C(ThreadsTests, ThreadIdIsCurrent) {
+	pthread_t thread;
+
+	IOT_DEBUG("-->Running Threads Tests - T:6 - Thread ID is only current on the thread that got it \n");
+
+	aws_iot_thread_id_get_current(&threadId);
+	CHECK_C(aws_iot_thread_id_is_current(&threadId));
+
+	isConditionMet = true;
+	CHECK_EQUAL_C_INT(0, pthread_create(&thread, NULL, threadIdCheckThread, NULL));
+	pthread_join(thread, NULL);
+	CHECK_C(!isConditionMet);
+
+	IOT_DEBUG("-->Success - T:6 - Thread ID is only current on the thread that got it \n");
+}
@@ -0,0 +1,567 @@
+#!/usr/bin/env python3
+#
+# Copyright 2010-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License").
+# You may not use this file except in compliance with the License.
+# A copy of the License is located at
+#
+#  http://aws.amazon.com/apache2.0
+#
+# or in the "license" file accompanying this file. This file is distributed
+# on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+# express or implied. See the License for the specific language governing
+# permissions and limitations under the License.
+
+"""Generate a C encoder and decoder for a shadow state described by a JSON Schema.
+
+The schema is an object schema whose properties are the fields of the state:
+
+    {
+      "title": "thermostat",
+      "type": "object",
+      "properties": {
+        "temperature": {"type": "number", "format": "float"},
+        "mode": {"type": "string", "maxLength": 15},
+        "fan": {"type": "object", "properties": {"speed": {"type": "integer", "format": "uint8"}}}
+      }
+    }
+
+integer takes the format int8, int16, int32 (default), uint8, uint16 or uint32, number takes
+float or double (default), string needs maxLength and boolean and nested objects take nothing
+else. Other JSON Schema keywords are ignored.
+
+The output is <name>.h with a struct for the state, one mask bit per leaf and the functions,
+and <name>.c with the code, which only needs the SDK (aws_iot_shadow_codegen.c and jsmn).
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+FNV_OFFSET = 2166136261
+FNV_PRIME = 16777619
+MAX_LEAVES = 32
+MAX_SEED_TRIES = 1 << 16
+SEED_STEP = 0x9E3779B9
+
+C_KEYWORDS = {
+    'auto', 'bool', 'break', 'case', 'char', 'const', 'continue', 'default', 'do', 'double', 'else', 'enum',
+    'extern', 'float', 'for', 'goto', 'if', 'inline', 'int', 'long', 'register', 'restrict', 'return', 'short',
+    'signed', 'sizeof', 'static', 'struct', 'switch', 'typedef', 'union', 'unsigned', 'void', 'volatile', 'while'
+}
+
+# format: (C type, writer function, cast, parser function)
+INTEGER_FORMATS = {
+    'int8': ('int8_t', 'aws_iot_shadow_codegen_write_int32', 'int32_t', 'parseInteger8Value'),
+    'int16': ('int16_t', 'aws_iot_shadow_codegen_write_int32', 'int32_t', 'parseInteger16Value'),
+    'int32': ('int32_t', 'aws_iot_shadow_codegen_write_int32', None, 'parseInteger32Value'),
+    'uint8': ('uint8_t', 'aws_iot_shadow_codegen_write_uint32', 'uint32_t', 'parseUnsignedInteger8Value'),
+    'uint16': ('uint16_t', 'aws_iot_shadow_codegen_write_uint32', 'uint32_t', 'parseUnsignedInteger16Value'),
+    'uint32': ('uint32_t', 'aws_iot_shadow_codegen_write_uint32', None, 'parseUnsignedInteger32Value'),
+}
+
+NUMBER_FORMATS = {
+    'float': ('float', 'aws_iot_shadow_codegen_write_double', 'double', 'parseFloatValue'),
+    'double': ('double', 'aws_iot_shadow_codegen_write_double', None, 'parseDoubleValue'),
+}
+
+
+class SchemaError(Exception):
+    pass
+
+
+class Field(object):
+    def __init__(self, key, c_name, path):
+        self.key = key
+        self.c_name = c_name
+        self.path = path
+        self.children = None
+        self.c_type = None
+        self.writer = None
+        self.cast = None
+        self.parser = None
+        self.string_len = 0
+        self.bit = None
+
+    @property
+    def is_object(self):
+        return self.children is not None
+
+
+def fnv1a(seed, text):
+    value = seed
+    for byte in text.encode('utf-8'):
+        value ^= byte
+        value = (value * FNV_PRIME) & 0xFFFFFFFF
+    return value
+
+
+def slot_of(seed, key, mask):
+    """Same as aws_iot_shadow_codegen_lookup: the low bits of FNV-1a only depend on the low bits of
+    the seed, so the high half is folded in."""
+    value = fnv1a(seed, key)
+    return (value ^ (value >> 16)) & mask
+
+
+def perfect_hash(keys):
+    """Find a seed and a power of two table size for which no two keys share a slot."""
+    size = 1
+    while size < len(keys):
+        size <<= 1
+    for _ in range(4):
+        for attempt in range(MAX_SEED_TRIES):
+            seed = (FNV_OFFSET + attempt * SEED_STEP) & 0xFFFFFFFF
+            slots = set(slot_of(seed, key, size - 1) for key in keys)
+            if len(slots) == len(keys):
+                return seed, size
+        size <<= 1
+    raise SchemaError('no perfect hash found for keys %s' % ', '.join(keys))
+
+
+def c_identifier(key):
+    name = re.sub(r'[^A-Za-z0-9_]', '_', key)
+    if not name or name[0].isdigit():
+        name = '_' + name
+    if name in C_KEYWORDS:
+        name += '_'
+    return name
+
+
+def parse_object(schema, path):
+    if schema.get('type') != 'object':
+        raise SchemaError('%s: expected "type": "object"' % (path or 'schema'))
+    properties = schema.get('properties')
+    if not isinstance(properties, dict) or not properties:
+        raise SchemaError('%s: an object needs at least one property' % (path or 'schema'))
+
+    fields = []
+    names = set()
+    for key, prop in properties.items():
+        if '"' in key or '\\' in key:
+            raise SchemaError('%s: key %r would need escaping' % (path or 'schema', key))
+        field_path = key if not path else path + '.' + key
+        field = Field(key, c_identifier(key), field_path)
+        if field.c_name in names:
+            raise SchemaError('%s: two keys map to the C name %s' % (field_path, field.c_name))
+        names.add(field.c_name)
+
+        kind = prop.get('type')
+        if kind == 'object':
+            field.children = parse_object(prop, field_path)
+        elif kind == 'integer':
+            fmt = prop.get('format', 'int32')
+            if fmt not in INTEGER_FORMATS:
+                raise SchemaError('%s: unknown integer format %r' % (field_path, fmt))
+            field.c_type, field.writer, field.cast, field.parser = INTEGER_FORMATS[fmt]
+        elif kind == 'number':
+            fmt = prop.get('format', 'double')
+            if fmt not in NUMBER_FORMATS:
+                raise SchemaError('%s: unknown number format %r' % (field_path, fmt))
+            field.c_type, field.writer, field.cast, field.parser = NUMBER_FORMATS[fmt]
+        elif kind == 'boolean':
+            field.c_type, field.writer, field.parser = 'bool', 'aws_iot_shadow_codegen_write_bool', 'parseBooleanValue'
+        elif kind == 'string':
+            max_length = prop.get('maxLength')
+            if not isinstance(max_length, int) or max_length < 1:
+                raise SchemaError('%s: a string needs a positive maxLength' % field_path)
+            field.c_type, field.writer, field.parser = 'char', 'aws_iot_shadow_codegen_write_string', None
+            field.string_len = max_length + 1
+        else:
+            raise SchemaError('%s: unsupported type %r' % (field_path, kind))
+        fields.append(field)
+    return fields
+
+
+def assign_bits(fields, leaves):
+    for field in fields:
+        if field.is_object:
+            assign_bits(field.children, leaves)
+        else:
+            field.bit = len(leaves)
+            leaves.append(field)
+
+
+def count_tokens(fields):
+    """Tokens of an object with all the fields, the object itself included."""
+    tokens = 1
+    for field in fields:
+        tokens += 1 + (count_tokens(field.children) if field.is_object else 1)
+    return tokens
+
+
+class Generator(object):
+    def __init__(self, name, prefix, fields, schema_name):
+        self.name = name
+        self.prefix = prefix
+        self.upper = prefix.upper()
+        self.fields = fields
+        self.schema_name = schema_name
+        self.leaves = []
+        assign_bits(fields, self.leaves)
+        if len(self.leaves) > MAX_LEAVES:
+            raise SchemaError('%d leaves, the field mask holds %d' % (len(self.leaves), MAX_LEAVES))
+        # A get/accepted document has the state twice, plus state, version, timestamp and clientToken
+        self.max_tokens = 2 * count_tokens(fields) + 16
+
+    def type_name(self, path):
+        return '%s_t' % self.func_name(path)
+
+    def func_name(self, path):
+        return '_'.join([self.prefix] + [c_identifier(p) for p in path])
+
+    def mask_name(self, field):
+        return '%s_%s' % (self.upper, '_'.join(c_identifier(p) for p in field.path.split('.')).upper())
+
+    def object_mask(self, fields):
+        return ' | '.join(self.mask_name(field) for field in fields)
+
+    def banner(self):
+        return ['/*',
+                ' * Generated by tools/shadow_codegen/aws_iot_shadow_codegen.py from %s.' % self.schema_name,
+                ' * Do not edit, run the generator again after changing the schema.',
+                ' */',
+                '']
+
+    # Header
+
+    def struct_lines(self, fields, path, out):
+        for field in fields:
+            if field.is_object:
+                self.struct_lines(field.children, path + [field.key], out)
+        out.append('/**')
+        if path:
+            out.append(' * @brief %s' % '.'.join(path))
+        else:
+            out.append(' * @brief State of the shadow')
+        out.append(' */')
+        out.append('typedef struct {')
+        for field in fields:
+            if field.is_object:
+                out.append('\t%s %s; ///< %s' % (self.type_name(path + [field.key]), field.c_name, field.path))
+            elif field.string_len:
+                out.append('\tchar %s[%d]; ///< %s' % (field.c_name, field.string_len, field.path))
+            else:
+                out.append('\t%s %s; ///< %s' % (field.c_type, field.c_name, field.path))
+        out.append('} %s;' % self.type_name(path))
+        out.append('')
+
+    def masks_lines(self, fields, out):
+        for field in fields:
+            if field.is_object:
+                self.masks_lines(field.children, out)
+                out.append('#define %s (%s) ///< All of %s' % (self.mask_name(field), self.object_mask(field.children),
+                                                              field.path))
+            else:
+                out.append('#define %s (1u << %d) ///< %s' % (self.mask_name(field), field.bit, field.path))
+
+    def header(self):
+        guard = '%s_H_' % re.sub(r'[^A-Za-z0-9]', '_', self.name).upper()
+        t = self.type_name([])
+        p = self.prefix
+        out = self.banner()
+        out += ['/**',
+                ' * @file %s.h' % self.name,
+                ' * @brief Encoder and decoder of the %s shadow state' % self.prefix,
+                ' */',
+                '',
+                '#ifndef %s' % guard,
+                '#define %s' % guard,
+                '',
+                '#ifdef __cplusplus',
+                'extern "C" {',
+                '#endif',
+                '',
+                '#include <stdbool.h>',
+                '#include <stddef.h>',
+                '#include <stdint.h>',
+                '',
+                '#include "aws_iot_error.h"',
+                '',
+                '/* Field mask, one bit per leaf */']
+        self.masks_lines(self.fields, out)
+        out += ['#define %s_ALL (%s) ///< Every field' % (self.upper, self.object_mask(self.fields)),
+                '',
+                '/**',
+                ' * Tokens the decoder has on the stack. The default fits a get/accepted document with both',
+                ' * sections, members that are not in the schema need more.',
+                ' */',
+                '#ifndef %s_MAX_JSON_TOKENS' % self.upper,
+                '#define %s_MAX_JSON_TOKENS %d' % (self.upper, self.max_tokens),
+                '#endif',
+                '']
+        self.struct_lines(self.fields, [], out)
+        out += ['/**',
+                ' * @brief Write the fields as a JSON object, for example a telemetry message',
+                ' *',
+                ' * @param pBuffer Buffer for the NUL terminated object',
+                ' * @param bufferLen Size of the buffer',
+                ' * @param pValue State',
+                ' * @param fieldMask Fields to write, %s_ALL for all' % self.upper,
+                ' * @param pLen Set to the length of the object, may be NULL',
+                ' *',
+                ' * @return SUCCESS, NULL_VALUE_ERROR or SHADOW_JSON_BUFFER_TRUNCATED',
+                ' */',
+                'IoT_Error_t %s_encode(char *pBuffer, size_t bufferLen, const %s *pValue, uint32_t fieldMask,' % (p, t),
+                '\t\tsize_t *pLen);',
+                '',
+                '/**',
+                ' * @brief Add the fields as the reported section, like aws_iot_shadow_add_reported',
+                ' *',
+                ' * Call between aws_iot_shadow_init_json_document and aws_iot_finalize_json_document.',
+                ' *',
+                ' * @return SUCCESS, NULL_VALUE_ERROR or SHADOW_JSON_BUFFER_TRUNCATED',
+                ' */',
+                'IoT_Error_t %s_add_reported(char *pJsonDocument, size_t maxSizeOfJsonDocument, const %s *pValue,' % (p, t),
+                '\t\tuint32_t fieldMask);',
+                '',
+                '/**',
+                ' * @brief Add the fields as the desired section, like aws_iot_shadow_add_desired',
+                ' *',
+                ' * @return SUCCESS, NULL_VALUE_ERROR or SHADOW_JSON_BUFFER_TRUNCATED',
+                ' */',
+                'IoT_Error_t %s_add_desired(char *pJsonDocument, size_t maxSizeOfJsonDocument, const %s *pValue,' % (p, t),
+                '\t\tuint32_t fieldMask);',
+                '',
+                '/**',
+                ' * @brief Read the fields of a received shadow document',
+                ' *',
+                ' * Keys that are not in the schema and values of the wrong type are skipped, the metadata',
+                ' * is not tokenized.',
+                ' *',
+                ' * @param pJsonDocument Document, for example the payload of update/delta or get/accepted',
+                ' * @param jsonLen Length of the document',
+                ' * @param pSection NULL to read the members of "state", as in a delta, or "desired" or',
+                ' * "reported" to read that section of the state',
+                ' * @param pValue Fields found in the document are written here, the others are left alone',
+                ' * @param pFieldMask Set to the fields that were written',
+                ' *',
+                ' * @return SUCCESS, also when the document has no such section, NULL_VALUE_ERROR or',
+                ' * JSON_PARSE_ERROR',
+                ' */',
+                'IoT_Error_t %s_decode(const char *pJsonDocument, size_t jsonLen, const char *pSection, %s *pValue,' % (p, t),
+                '\t\tuint32_t *pFieldMask);',
+                '',
+                '#ifdef __cplusplus',
+                '}',
+                '#endif',
+                '',
+                '#endif /* %s */' % guard,
+                '']
+        return '\n'.join(out)
+
+    # Source
+
+    def object_lines(self, fields, path, out):
+        for field in fields:
+            if field.is_object:
+                self.object_lines(field.children, path + [field.key], out)
+
+        fn = self.func_name(path)
+        upper = fn.upper()
+        t = self.type_name(path)
+        seed, size = perfect_hash([field.key for field in fields])
+        slots = [None] * size
+        for index, field in enumerate(fields):
+            slots[slot_of(seed, field.key, size - 1)] = (index, field)
+
+        out.append('#define %s_SEED 0x%08Xu' % (upper, seed))
+        out.append('#define %s_SLOT_MASK %du' % (upper, size - 1))
+        out.append('')
+        out.append('static const ShadowCodegenKey_t %s_keys[%d] = {' % (fn, size))
+        for slot in slots:
+            if slot is None:
+                out.append('\t{NULL, 0, -1},')
+            else:
+                out.append('\t{"%s", %d, %d},' % (slot[1].key, len(slot[1].key.encode('utf-8')), slot[0]))
+        out.append('};')
+        out.append('')
+
+        out.append('static void %s_write(ShadowCodegenWriter_t *pWriter, const %s *pValue, uint32_t fieldMask) {'
+                   % (fn, t))
+        out.append('\taws_iot_shadow_codegen_write(pWriter, "{", 1);')
+        for field in fields:
+            key_text = '"%s":' % field.key
+            out.append('\tif(fieldMask & %s) {' % self.mask_name(field))
+            out.append('\t\taws_iot_shadow_codegen_write(pWriter, "%s", %d);'
+                       % (key_text.replace('"', '\\"'), len(key_text.encode('utf-8'))))
+            if field.is_object:
+                out.append('\t\t%s_write(pWriter, &pValue->%s, fieldMask);'
+                           % (self.func_name(path + [field.key]), field.c_name))
+            elif field.cast:
+                out.append('\t\t%s(pWriter, (%s) pValue->%s);' % (field.writer, field.cast, field.c_name))
+            else:
+                out.append('\t\t%s(pWriter, pValue->%s);' % (field.writer, field.c_name))
+            out.append('\t\taws_iot_shadow_codegen_write(pWriter, ",", 1);')
+            out.append('\t}')
+        out.append('\taws_iot_shadow_codegen_end_object(pWriter);')
+        out.append('}')
+        out.append('')
+
+        out.append('static void %s_read(const char *pJsonDocument, jsmntok_t *pTokens, int32_t tokenCount,' % fn)
+        out.append('\t\tint32_t objectIndex, %s *pValue, uint32_t *pFieldMask) {' % t)
+        out.append('\tint32_t end = aws_iot_shadow_codegen_skip(pTokens, tokenCount, objectIndex);')
+        out.append('\tint32_t i = objectIndex + 1;')
+        out.append('\tjsmntok_t *pKey;')
+        out.append('')
+        out.append('\twhile(i + 1 < end) {')
+        out.append('\t\tpKey = &pTokens[i];')
+        out.append('\t\tswitch(aws_iot_shadow_codegen_lookup(%s_keys, %s_SEED, %s_SLOT_MASK,' % (fn, upper, upper))
+        out.append('\t\t\t\tpJsonDocument + pKey->start, (size_t) (pKey->end - pKey->start))) {')
+        for index, field in enumerate(fields):
+            out.append('\t\tcase %d: /* %s */' % (index, field.key))
+            if field.is_object:
+                out.append('\t\t\tif(pTokens[i + 1].type == JSMN_OBJECT) {')
+                out.append('\t\t\t\t%s_read(pJsonDocument, pTokens, tokenCount, i + 1, &pValue->%s, pFieldMask);'
+                           % (self.func_name(path + [field.key]), field.c_name))
+                out.append('\t\t\t}')
+            elif field.string_len:
+                out.append('\t\t\tif(parseStringValue(pValue->%s, sizeof(pValue->%s), pJsonDocument, &pTokens[i + 1]) == SUCCESS) {'
+                           % (field.c_name, field.c_name))
+                out.append('\t\t\t\t*pFieldMask |= %s;' % self.mask_name(field))
+                out.append('\t\t\t}')
+            else:
+                out.append('\t\t\tif(%s(&pValue->%s, pJsonDocument, &pTokens[i + 1]) == SUCCESS) {'
+                           % (field.parser, field.c_name))
+                out.append('\t\t\t\t*pFieldMask |= %s;' % self.mask_name(field))
+                out.append('\t\t\t}')
+            out.append('\t\t\tbreak;')
+        out.append('\t\tdefault:')
+        out.append('\t\t\tbreak;')
+        out.append('\t\t}')
+        out.append('\t\ti = aws_iot_shadow_codegen_skip(pTokens, tokenCount, i + 1);')
+        out.append('\t}')
+        out.append('}')
+        out.append('')
+
+    def source(self):
+        p = self.prefix
+        t = self.type_name([])
+        out = self.banner()
+        out += ['/**',
+                ' * @file %s.c' % self.name,
+                ' * @brief Encoder and decoder of the %s shadow state' % self.prefix,
+                ' */',
+                '',
+                '#ifdef __cplusplus',
+                'extern "C" {',
+                '#endif',
+                '',
+                '#include <string.h>',
+                '',
+                '#include "%s.h"' % self.name,
+                '#include "aws_iot_shadow_codegen.h"',
+                '#include "aws_iot_json_utils.h"',
+                '']
+        self.object_lines(self.fields, [], out)
+        out += ['IoT_Error_t %s_encode(char *pBuffer, size_t bufferLen, const %s *pValue, uint32_t fieldMask,' % (p, t),
+                '\t\tsize_t *pLen) {',
+                '\tShadowCodegenWriter_t writer;',
+                '',
+                '\tif(pBuffer == NULL || pValue == NULL) {',
+                '\t\treturn NULL_VALUE_ERROR;',
+                '\t}',
+                '',
+                '\taws_iot_shadow_codegen_writer_init(&writer, pBuffer, 0, bufferLen);',
+                '\t%s_write(&writer, pValue, fieldMask);' % p,
+                '',
+                '\treturn aws_iot_shadow_codegen_writer_finish(&writer, pBuffer, pLen);',
+                '}',
+                '',
+                'static IoT_Error_t %s_add_section(char *pJsonDocument, size_t maxSizeOfJsonDocument, const char *pSectionKey,' % p,
+                '\t\tsize_t sectionKeyLen, const %s *pValue, uint32_t fieldMask) {' % t,
+                '\tShadowCodegenWriter_t writer;',
+                '',
+                '\tif(pJsonDocument == NULL || pValue == NULL) {',
+                '\t\treturn NULL_VALUE_ERROR;',
+                '\t}',
+                '',
+                '\taws_iot_shadow_codegen_writer_init(&writer, pJsonDocument, strlen(pJsonDocument), maxSizeOfJsonDocument);',
+                '\taws_iot_shadow_codegen_write(&writer, pSectionKey, sectionKeyLen);',
+                '\t%s_write(&writer, pValue, fieldMask);' % p,
+                '\taws_iot_shadow_codegen_write(&writer, ",", 1);',
+                '',
+                '\treturn aws_iot_shadow_codegen_writer_finish(&writer, pJsonDocument, NULL);',
+                '}',
+                '',
+                'IoT_Error_t %s_add_reported(char *pJsonDocument, size_t maxSizeOfJsonDocument, const %s *pValue,' % (p, t),
+                '\t\tuint32_t fieldMask) {',
+                '\treturn %s_add_section(pJsonDocument, maxSizeOfJsonDocument, "\\"reported\\":", 11, pValue, fieldMask);' % p,
+                '}',
+                '',
+                'IoT_Error_t %s_add_desired(char *pJsonDocument, size_t maxSizeOfJsonDocument, const %s *pValue,' % (p, t),
+                '\t\tuint32_t fieldMask) {',
+                '\treturn %s_add_section(pJsonDocument, maxSizeOfJsonDocument, "\\"desired\\":", 10, pValue, fieldMask);' % p,
+                '}',
+                '',
+                'IoT_Error_t %s_decode(const char *pJsonDocument, size_t jsonLen, const char *pSection, %s *pValue,' % (p, t),
+                '\t\tuint32_t *pFieldMask) {',
+                '\tjsmntok_t tokens[%s_MAX_JSON_TOKENS];' % self.upper,
+                '\tint32_t tokenCount, stateIndex;',
+                '',
+                '\tif(pJsonDocument == NULL || pValue == NULL || pFieldMask == NULL) {',
+                '\t\treturn NULL_VALUE_ERROR;',
+                '\t}',
+                '',
+                '\t*pFieldMask = 0;',
+                '\ttokenCount = aws_iot_shadow_codegen_parse(pJsonDocument, jsonLen, tokens, %s_MAX_JSON_TOKENS);' % self.upper,
+                '\tif(tokenCount < 1 || tokens[0].type != JSMN_OBJECT) {',
+                '\t\treturn JSON_PARSE_ERROR;',
+                '\t}',
+                '',
+                '\tstateIndex = aws_iot_shadow_codegen_find_member(pJsonDocument, tokens, tokenCount, 0, "state", 5);',
+                '\tif(stateIndex >= 0 && pSection != NULL) {',
+                '\t\tstateIndex = aws_iot_shadow_codegen_find_member(pJsonDocument, tokens, tokenCount, stateIndex, pSection,',
+                '\t\t\t\tstrlen(pSection));',
+                '\t}',
+                '\tif(stateIndex >= 0 && tokens[stateIndex].type == JSMN_OBJECT) {',
+                '\t\t%s_read(pJsonDocument, tokens, tokenCount, stateIndex, pValue, pFieldMask);' % p,
+                '\t}',
+                '',
+                '\treturn SUCCESS;',
+                '}',
+                '',
+                '#ifdef __cplusplus',
+                '}',
+                '#endif',
+                '']
+        return '\n'.join(out)
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description='Generate a C encoder and decoder for a shadow JSON Schema')
+    parser.add_argument('schema', help='JSON Schema of the shadow state')
+    parser.add_argument('-o', '--output-dir', default='.', help='directory for the .c file and, by default, the .h file')
+    parser.add_argument('--header-dir', help='directory for the .h file')
+    parser.add_argument('-n', '--name', help='base name of the files, default is the prefix')
+    parser.add_argument('-p', '--prefix', help='prefix of the C names, default is the title of the schema')
+    args = parser.parse_args(argv)
+
+    try:
+        with open(args.schema) as schema_file:
+            schema = json.load(schema_file)
+        prefix = args.prefix or schema.get('title')
+        if not prefix:
+            raise SchemaError('the schema has no title, give --prefix')
+        prefix = c_identifier(prefix).lower()
+        fields = parse_object(schema, '')
+        generator = Generator(args.name or prefix, prefix, fields, os.path.basename(args.schema))
+        header = generator.header()
+        source = generator.source()
+    except (IOError, ValueError, SchemaError) as error:
+        sys.stderr.write('%s: %s\n' % (args.schema, error))
+        return 1
+
+    header_dir = args.header_dir or args.output_dir
+    for directory, extension, text in ((header_dir, '.h', header), (args.output_dir, '.c', source)):
+        if not os.path.isdir(directory):
+            os.makedirs(directory)
+        with open(os.path.join(directory, generator.name + extension), 'w') as output:
+            output.write(text)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))